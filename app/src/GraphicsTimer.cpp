@@ -52,16 +52,21 @@ namespace mars {
 
 
     void GraphicsTimer::runOnce(){
+      runMutex.lock();
       runFinished=false;
       emit internalRun();
       while(!runFinished){
-        mars::utils::msleep(1);
+        runCondition.wait(&runMutex);
       }
+      runMutex.unlock();
     }
 
     void GraphicsTimer::runOnceInternal(){
       timerEvent();
+      runMutex.lock();
       runFinished=true;
+      runCondition.wakeAll();
+      runMutex.unlock();
     }
 
     void GraphicsTimer::timerEvent(void) {
@@ -26,6 +26,8 @@
 
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
 
 namespace mars {
   namespace app {
@@ -56,6 +58,8 @@ namespace mars {
       mars::interfaces::GraphicsManagerInterface *graphics;
       mars::interfaces::SimulatorInterface *sim;
       bool runFinished;
+      mars::utils::Mutex runMutex;
+      mars::utils::WaitCondition runCondition;
 
     }; // end of class GraphicsTimer
 
@@ -36,6 +36,7 @@
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/utils/Thread.h>
 #include <mars/utils/misc.h>
+#include <mars/utils/Trace.h>
 #include <mars/cfg_manager/CFGManagerInterface.h>
 
 #include <QDir>
@@ -177,6 +178,8 @@ namespace mars {
                      bool handleLibraryLoading) {
 
       if(!initialized) init();
+      // the gui and graphics thread
+      utils::Trace::setThreadName("main");
 
       FILE *plugin_config;
       if(handleLibraryLoading) {
@@ -364,10 +367,12 @@ namespace mars {
 
     int MARS::runWoQApp() {
       while(!quit) {
+        // without a graphics timer, wait for the next frame instead of
+        // spinning; the timeout paces the loop in unsynchronized mode
+        control->sim->waitForDraw(10);
         if(control->sim->getAllowDraw() || !control->sim->getSyncGraphics()) {
           control->sim->finishedDraw();
         }
-        //mars::utils::msleep(2);
       }
       return 0;
     }
@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "AllocCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifndef WIN32
+  #include <sys/resource.h>
+#endif
+
+// dynamic exception specifications are not allowed anymore in C++17
+#if __cplusplus >= 201103L
+  #define THROW_BAD_ALLOC
+  #define NO_THROW noexcept
+#else
+  #define THROW_BAD_ALLOC throw(std::bad_alloc)
+  #define NO_THROW throw()
+#endif
+
+static volatile unsigned long numAllocations = 0;
+static volatile unsigned long long numBytes = 0;
+
+static inline void* countedAlloc(size_t size) {
+#ifdef __GNUC__
+  __sync_fetch_and_add(&numAllocations, 1UL);
+  __sync_fetch_and_add(&numBytes, (unsigned long long)size);
+#else
+  ++numAllocations;
+  numBytes += size;
+#endif
+  void *p = malloc(size ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t size) THROW_BAD_ALLOC {
+  return countedAlloc(size);
+}
+
+void* operator new[](size_t size) THROW_BAD_ALLOC {
+  return countedAlloc(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) NO_THROW {
+  try {
+    return countedAlloc(size);
+  } catch(...) {
+    return NULL;
+  }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) NO_THROW {
+  try {
+    return countedAlloc(size);
+  } catch(...) {
+    return NULL;
+  }
+}
+
+void operator delete(void *p) NO_THROW {
+  free(p);
+}
+
+void operator delete[](void *p) NO_THROW {
+  free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t&) NO_THROW {
+  free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t&) NO_THROW {
+  free(p);
+}
+
+namespace mars {
+  namespace bench {
+
+    AllocStats getAllocStats() {
+      AllocStats stats;
+      stats.allocations = numAllocations;
+      stats.bytes = numBytes;
+      return stats;
+    }
+
+    long getPeakRssKb() {
+#ifdef WIN32
+      return 0;
+#else
+      struct rusage usage;
+      if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  #ifdef __APPLE__
+      // bytes on Mac OS, kB on Linux
+      return usage.ru_maxrss / 1024;
+  #else
+      return usage.ru_maxrss;
+  #endif
+#endif
+    }
+
+    double getCpuTimeMs() {
+#ifdef WIN32
+      return -1.0;
+#else
+      struct rusage usage;
+      if(getrusage(RUSAGE_SELF, &usage) != 0) return -1.0;
+      return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#endif
+    }
+
+  } // end of namespace bench
+} // end of namespace mars
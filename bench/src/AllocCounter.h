@@ -0,0 +1,63 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file AllocCounter.h
+ * \brief Counts the heap allocations of the whole process.
+ *
+ * The global operator new and delete are replaced in the executable, so
+ * the allocations of the loaded libraries are counted as well.
+ */
+
+#ifndef MARS_BENCH_ALLOC_COUNTER_H
+#define MARS_BENCH_ALLOC_COUNTER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "AllocCounter.h"
+#endif
+
+namespace mars {
+  namespace bench {
+
+    struct AllocStats {
+      unsigned long allocations;
+      unsigned long long bytes;
+    };
+
+    /** \brief allocations since the start of the process */
+    AllocStats getAllocStats();
+
+    /**
+     * \brief peak resident set size of the process in kB
+     * \return 0 if it is not available on the platform
+     */
+    long getPeakRssKb();
+
+    /**
+     * \brief user and system CPU time of all threads of the process in ms
+     * \return a negative value if it is not available on the platform
+     */
+    double getCpuTimeMs();
+
+  } // end of namespace bench
+} // end of namespace mars
+
+#endif // MARS_BENCH_ALLOC_COUNTER_H
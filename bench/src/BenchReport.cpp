@@ -0,0 +1,161 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "BenchReport.h"
+
+#include <configmaps/ConfigData.h>
+
+#include <cmath>
+#include <exception>
+
+namespace mars {
+  namespace bench {
+
+    using namespace mars::interfaces;
+
+    static std::string quote(const std::string &s) {
+      std::string result = "\"";
+      for(size_t i=0; i<s.size(); ++i) {
+        if(s[i] == '"' || s[i] == '\\') result += '\\';
+        result += s[i];
+      }
+      return result + "\"";
+    }
+
+    static void writeNumber(FILE *file, const char *name, double value,
+                            const char *separator=", ") {
+      if(value != value || fabs(value) > 1e300) value = 0.0;
+      fprintf(file, "%s: %.6g%s", quote(name).c_str(), value, separator);
+    }
+
+    void writeReport(FILE *file, const BenchRun &run) {
+      fprintf(file, "{\n  \"mars_bench\": 1,\n");
+      fprintf(file, "  \"warm_up_steps\": %lu,\n  \"steps\": %lu,\n",
+              run.warmUp, run.steps);
+      fprintf(file, "  \"overrides\": [");
+      for(size_t i=0; i<run.overrides.size(); ++i) {
+        fprintf(file, "%s%s", i ? ", " : "", quote(run.overrides[i]).c_str());
+      }
+      fprintf(file, "],\n  \"skipped\": [");
+      bool first = true;
+      for(size_t i=0; i<run.results.size(); ++i) {
+        if(run.results[i].ok) continue;
+        fprintf(file, "%s%s", first ? "" : ", ",
+                quote(run.results[i].name).c_str());
+        first = false;
+      }
+      fprintf(file, "],\n  \"results\": {");
+      first = true;
+      for(size_t i=0; i<run.results.size(); ++i) {
+        const BenchResult &r = run.results[i];
+        if(!r.ok) continue;
+        fprintf(file, "%s\n    %s: {\n      ", first ? "" : ",",
+                quote(r.name).c_str());
+        first = false;
+        writeNumber(file, "setup_ms", r.setupMs);
+        writeNumber(file, "run_ms", r.runMs);
+        writeNumber(file, "steps", r.steps);
+        writeNumber(file, "steps_per_s", r.stepsPerSecond, ",\n      ");
+        writeNumber(file, "allocations_per_step", r.allocationsPerStep);
+        writeNumber(file, "bytes_per_step", r.bytesPerStep);
+        writeNumber(file, "peak_rss_kb", r.peakRssKb, ",\n      ");
+        if(r.profile.steps) {
+          writeNumber(file, "step_ms", r.profile.totalMs);
+          fprintf(file, "\"stage_ms\": {");
+          for(int s=0; s<NUMBER_OF_STEP_STAGES; ++s) {
+            writeNumber(file, StepProfile::stageName(s), r.profile.stageMs[s],
+                        s+1 < NUMBER_OF_STEP_STAGES ? ", " : "");
+          }
+          fprintf(file, "},\n      ");
+        }
+        fprintf(file, "\"values\": {");
+        std::map<std::string, double>::const_iterator it;
+        for(it=r.values.begin(); it!=r.values.end(); ++it) {
+          if(it != r.values.begin()) fprintf(file, ", ");
+          writeNumber(file, it->first.c_str(), it->second, "");
+        }
+        fprintf(file, "}\n    }");
+      }
+      fprintf(file, "\n  }\n}\n");
+    }
+
+    void printSummary(FILE *file, const BenchRun &run) {
+      fprintf(file, "%-22s %10s %10s %12s %10s %12s\n", "benchmark",
+              "setup ms", "steps/s", "ms/step", "allocs", "peak RSS kB");
+      for(size_t i=0; i<run.results.size(); ++i) {
+        const BenchResult &r = run.results[i];
+        if(!r.ok) {
+          fprintf(file, "%-22s %10s\n", r.name.c_str(), "skipped");
+          continue;
+        }
+        fprintf(file, "%-22s %10.1f %10.1f %12.4f %10.1f %12ld\n",
+                r.name.c_str(), r.setupMs, r.stepsPerSecond,
+                r.steps ? r.runMs / r.steps : 0.0, r.allocationsPerStep,
+                r.peakRssKb);
+      }
+    }
+
+    int compareWithBaseline(const std::string &filename, const BenchRun &run,
+                            double tolerance, FILE *out) {
+      configmaps::ConfigMap baseline, results;
+      try {
+        // JSON is read by the YAML parser
+        baseline = configmaps::ConfigMap::fromYamlFile(filename);
+      } catch(std::exception &e) {
+        fprintf(stderr, "mars_bench: can not read baseline \"%s\": %s\n",
+                filename.c_str(), e.what());
+        return -1;
+      }
+      if(!baseline.hasKey("results")) {
+        fprintf(stderr, "mars_bench: \"%s\" is not a mars_bench report\n",
+                filename.c_str());
+        return -1;
+      }
+      results = baseline["results"];
+
+      int regressions = 0;
+      double factor = tolerance / 100.0;
+      fprintf(out, "%-22s %12s %12s %8s %10s %10s\n", "benchmark",
+              "base steps/s", "steps/s", "change", "base alloc", "allocs");
+      for(size_t i=0; i<run.results.size(); ++i) {
+        const BenchResult &r = run.results[i];
+        if(!r.ok || !results.hasKey(r.name)) continue;
+        configmaps::ConfigMap entry = results[r.name];
+        double baseSpeed = entry["steps_per_s"];
+        double baseAllocs = entry["allocations_per_step"];
+        double change = baseSpeed > 0.0 ?
+          100.0 * (r.stepsPerSecond - baseSpeed) / baseSpeed : 0.0;
+        bool slower = r.stepsPerSecond < baseSpeed * (1.0 - factor);
+        // a single allocation more per step is not worth a failure
+        bool allocates = (r.allocationsPerStep >
+                          baseAllocs * (1.0 + factor) + 1.0);
+        fprintf(out, "%-22s %12.1f %12.1f %7.1f%% %10.1f %10.1f%s%s\n",
+                r.name.c_str(), baseSpeed, r.stepsPerSecond, change,
+                baseAllocs, r.allocationsPerStep,
+                slower ? "  SLOWER" : "", allocates ? "  ALLOCATES" : "");
+        if(slower) ++regressions;
+        if(allocates) ++regressions;
+      }
+      return regressions;
+    }
+
+  } // end of namespace bench
+} // end of namespace mars
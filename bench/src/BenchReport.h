@@ -0,0 +1,81 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file BenchReport.h
+ * \brief Writes the results of mars_bench as JSON and compares them with
+ *        a stored baseline.
+ *
+ * The report has one entry per benchmark under "results":
+ *
+ *   "walker": {
+ *     "setup_ms": 41.2, "run_ms": 1530.1, "steps": 1000,
+ *     "steps_per_s": 653.5, "allocations_per_step": 3.0,
+ *     "bytes_per_step": 96.0, "peak_rss_kb": 81232,
+ *     "step_ms": 1.52, "stage_ms": {"collision": 0.41, ...},
+ *     "values": {"motors": 60}
+ *   }
+ *
+ * A report can be used as the baseline of a later run.
+ */
+
+#ifndef MARS_BENCH_REPORT_H
+#define MARS_BENCH_REPORT_H
+
+#ifdef _PRINT_HEADER_
+  #warning "BenchReport.h"
+#endif
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace bench {
+
+    struct BenchRun {
+      unsigned long warmUp;
+      unsigned long steps;
+      /** the cfg_manager overrides of the run ("group/name=value") */
+      std::vector<std::string> overrides;
+      std::vector<BenchResult> results;
+    };
+
+    void writeReport(FILE *file, const BenchRun &run);
+    /** \brief prints a short table for the terminal */
+    void printSummary(FILE *file, const BenchRun &run);
+
+    /**
+     * \brief compares the steps per second and the allocations per step
+     *        with the baseline report in \a filename.
+     * \param tolerance The allowed change in percent.
+     * \return The number of regressions or -1 if the baseline could not be
+     *         read.
+     */
+    int compareWithBaseline(const std::string &filename, const BenchRun &run,
+                            double tolerance, FILE *out);
+
+  } // end of namespace bench
+} // end of namespace mars
+
+#endif // MARS_BENCH_REPORT_H
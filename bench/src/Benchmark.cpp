@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "Benchmark.h"
+#include "AllocCounter.h"
+#include "MicroBenchmarks.h"
+#include "SceneBenchmarks.h"
+#ifdef HAVE_MARS_GRAPHICS
+  #include "GraphicsBenchmarks.h"
+#endif
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/utils/misc.h>
+
+#include <cstdio>
+
+namespace mars {
+  namespace bench {
+
+    using namespace mars::interfaces;
+
+    BenchResult::BenchResult() : ok(false), setupMs(0.0), steps(0),
+                                 runMs(0.0), stepsPerSecond(0.0),
+                                 allocationsPerStep(0.0), bytesPerStep(0.0),
+                                 peakRssKb(0) {
+      profile.steps = 0;
+      profile.totalMs = 0.0;
+      for(int i=0; i<NUMBER_OF_STEP_STAGES; ++i) profile.stageMs[i] = 0.0;
+    }
+
+    BenchResult runBenchmark(Benchmark *benchmark, BenchContext *context,
+                             unsigned long warmUp, unsigned long steps) {
+      BenchResult result;
+      SimulatorInterface *sim = context->control->sim;
+      bool profile = benchmark->stepsSimulation();
+      result.name = benchmark->getName();
+
+      double start = utils::getClockMs();
+      if(!benchmark->setup(context)) {
+        fprintf(stderr, "mars_bench: skipping \"%s\"\n",
+                benchmark->getName().c_str());
+        benchmark->teardown();
+        return result;
+      }
+      result.setupMs = utils::getClockMs() - start;
+
+      for(unsigned long i=0; i<warmUp; ++i) {
+        benchmark->step(i);
+      }
+
+      benchmark->startMeasurement();
+      if(profile) {
+        sim->resetStepProfile();
+        sim->setStepProfiling(true);
+      }
+      AllocStats allocStart = getAllocStats();
+      start = utils::getClockMs();
+      for(unsigned long i=0; i<steps; ++i) {
+        benchmark->step(warmUp + i);
+      }
+      result.runMs = utils::getClockMs() - start;
+      AllocStats allocEnd = getAllocStats();
+      if(profile) {
+        sim->setStepProfiling(false);
+        sim->getStepProfile(&result.profile);
+        if(result.profile.steps) {
+          result.profile.totalMs /= result.profile.steps;
+          for(int i=0; i<NUMBER_OF_STEP_STAGES; ++i) {
+            result.profile.stageMs[i] /= result.profile.steps;
+          }
+        }
+      }
+
+      result.ok = true;
+      result.steps = steps;
+      if(steps) {
+        result.allocationsPerStep = (double)(allocEnd.allocations -
+                                             allocStart.allocations) / steps;
+        result.bytesPerStep = (double)(allocEnd.bytes -
+                                       allocStart.bytes) / steps;
+      }
+      if(result.runMs > 0.0) {
+        result.stepsPerSecond = steps * 1000.0 / result.runMs;
+      }
+      benchmark->addValues(&result);
+      benchmark->teardown();
+      // the process high water mark; includes the benchmarks run before
+      result.peakRssKb = getPeakRssKb();
+      return result;
+    }
+
+    void createBenchmarks(std::vector<Benchmark*> *benchmarks) {
+      createSceneBenchmarks(benchmarks);
+      createMicroBenchmarks(benchmarks);
+#ifdef HAVE_MARS_GRAPHICS
+      createGraphicsBenchmarks(benchmarks);
+#endif
+    }
+
+  } // end of namespace bench
+} // end of namespace mars
@@ -0,0 +1,125 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file Benchmark.h
+ * \brief Base class of the mars_bench cases and the loop that measures
+ *        them.
+ *
+ * A benchmark builds its scene in setup() and then runs a fixed number
+ * of steps. Only the steps after the warm up are measured. Benchmarks
+ * that step the simulation also report the time of the stages of
+ * Simulator::step (see interfaces::StepProfile).
+ */
+
+#ifndef MARS_BENCH_BENCHMARK_H
+#define MARS_BENCH_BENCHMARK_H
+
+#ifdef _PRINT_HEADER_
+  #warning "Benchmark.h"
+#endif
+
+#include <mars/interfaces/sim/SimulatorInterface.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lib_manager {
+  class LibManager;
+}
+
+namespace mars {
+
+  namespace interfaces {
+    class ControlCenter;
+  }
+
+  namespace bench {
+
+    struct BenchContext {
+      lib_manager::LibManager *libManager;
+      interfaces::ControlCenter *control;
+      /** a directory for temporary files (e.g. recordings) */
+      std::string tmpDir;
+    };
+
+    struct BenchResult {
+      BenchResult();
+
+      std::string name;
+      bool ok;
+      double setupMs;
+      unsigned long steps;
+      double runMs;
+      double stepsPerSecond;
+      double allocationsPerStep;
+      double bytesPerStep;
+      long peakRssKb;
+      /** steps/totalMs/stageMs in ms per step; steps is 0 if not used */
+      interfaces::StepProfile profile;
+      /** benchmark specific values, e.g. latencies or object counts */
+      std::map<std::string, double> values;
+    };
+
+    class Benchmark {
+    public:
+      Benchmark(const std::string &name, const std::string &description)
+        : name(name), description(description) {}
+      virtual ~Benchmark() {}
+
+      const std::string& getName() const {return name;}
+      const std::string& getDescription() const {return description;}
+
+      /**
+       * \brief builds the scene.
+       * \return \c false if the benchmark can not run, e.g. because an
+       *         optional library is missing.
+       */
+      virtual bool setup(BenchContext *context) = 0;
+      /** \brief one warm up or measured step */
+      virtual void step(unsigned long index) = 0;
+      /** \brief called after the warm up steps */
+      virtual void startMeasurement() {}
+      /** \brief adds benchmark specific values to the result */
+      virtual void addValues(BenchResult *result) {(void)result;}
+      virtual void teardown() {}
+      /** \brief whether step() runs Simulator::step */
+      virtual bool stepsSimulation() const {return true;}
+
+    protected:
+      std::string name, description;
+    }; // end of class Benchmark
+
+    /**
+     * \brief runs \a warmUp unmeasured and \a steps measured steps of
+     *        \a benchmark.
+     */
+    BenchResult runBenchmark(Benchmark *benchmark, BenchContext *context,
+                             unsigned long warmUp, unsigned long steps);
+
+    /** \brief all benchmarks in the order they are run by default */
+    void createBenchmarks(std::vector<Benchmark*> *benchmarks);
+
+  } // end of namespace bench
+} // end of namespace mars
+
+#endif // MARS_BENCH_BENCHMARK_H
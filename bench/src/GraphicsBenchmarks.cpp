@@ -0,0 +1,320 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GraphicsBenchmarks.h"
+#include "SceneBenchmarks.h"
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/sim/NodeManagerInterface.h>
+#include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/interfaces/terrainStruct.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/utils/misc.h>
+
+#include <osg/Camera>
+#include <osg/Stats>
+#include <osgViewer/View>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace mars {
+  namespace bench {
+
+    using namespace mars::interfaces;
+    using mars::utils::Vector;
+
+    /**
+     * A scene that is drawn after every step. The measured frames report
+     * the time of GraphicsManagerInterface::draw and the drawables culled
+     * by the main view.
+     */
+    class GraphicsScene : public SceneBenchmark {
+    public:
+      GraphicsScene(const std::string &name, const std::string &description)
+        : SceneBenchmark(name, description), view(NULL) {}
+
+      bool setup(BenchContext *context) {
+        if(!context->control->graphics || !context->control->cfg) {
+          return false;
+        }
+        view = (osgViewer::View*)context->control->graphics->getView(1);
+        if(!view || !view->getCamera()->getStats()) return false;
+        // the renderer only records the culled drawables on request
+        view->getCamera()->getStats()->collectStats("scene", true);
+        return SceneBenchmark::setup(context);
+      }
+
+      void step(unsigned long index) {
+        SceneBenchmark::step(index);
+        draw(&frames);
+      }
+
+      void startMeasurement() {
+        frames = FrameStats();
+      }
+
+    protected:
+      struct FrameStats {
+        FrameStats() : frames(0), drawMs(0.0), drawables(0.0) {}
+
+        double msPerFrame() const {return frames ? drawMs / frames : 0.0;}
+        double drawablesPerFrame() const {
+          return frames ? drawables / frames : 0.0;
+        }
+
+        unsigned long frames;
+        double drawMs, drawables;
+      };
+
+      void draw(FrameStats *stats) {
+        double start = utils::getClockMs();
+        control->graphics->draw();
+        stats->drawMs += utils::getClockMs() - start;
+        osg::Stats *viewStats = view->getCamera()->getStats();
+        double drawables = 0.0;
+        if(viewStats->getAttribute(viewStats->getLatestFrameNumber(),
+                                   "Visible number of drawables",
+                                   drawables)) {
+          stats->drawables += drawables;
+        }
+        stats->frames++;
+      }
+
+      /** \brief steps and draws the scene \a steps times */
+      FrameStats run(unsigned long steps) {
+        FrameStats stats;
+        for(unsigned long i=0; i<steps; ++i) {
+          control->sim->step(true);
+          draw(&stats);
+        }
+        return stats;
+      }
+
+      void setGraphicsProperty(const std::string &name, bool value) {
+        control->cfg->setPropertyValue("Graphics", name, "value", value);
+      }
+
+      bool getGraphicsProperty(const std::string &name) {
+        bool value = false;
+        control->cfg->getPropertyValue("Graphics", name, "value", &value);
+        return value;
+      }
+
+      void lookAt(double x, double y, double z,
+                  double qx, double qy, double qz, double qw) {
+        GraphicsWindowInterface *window = control->graphics->get3DWindow(1);
+        if(window) {
+          window->getCameraInterface()->updateViewportQuat(x, y, z,
+                                                           qx, qy, qz, qw);
+        }
+      }
+
+      osgViewer::View *view;
+      FrameStats frames;
+    }; // end of class GraphicsScene
+
+    /**
+     * 3000 boxes of the same size and material dropped on a grid, seen
+     * from above. The frames are measured with "Graphics/instancing";
+     * addValues() restores the state of the start of the measurement and
+     * repeats the steps without it.
+     */
+    class Instancing : public GraphicsScene {
+    public:
+      Instancing()
+        : GraphicsScene("instancing",
+                        "3000 identical boxes, draw calls with and without "
+                        "instancing"),
+          numObjects(0), previousInstancing(true) {}
+
+      bool build() {
+        const int side = 55;
+        const double edge = 0.5;
+        Random random(17);
+        previousInstancing = getGraphicsProperty("instancing");
+        setGraphicsProperty("instancing", true);
+        addGround(control, side + 10.0);
+        numObjects = 0;
+        for(int x=0; x<side && numObjects<3000; ++x) {
+          for(int y=0; y<side && numObjects<3000; ++y) {
+            char name[64];
+            snprintf(name, sizeof(name), "box_%lu", numObjects++);
+            Vector pos(x - side*0.5, y - side*0.5,
+                       edge*0.5 + random.uniform(0.5, 1.5));
+            control->nodes->createPrimitiveNode(name, NODE_TYPE_BOX, true,
+                                                pos, Vector(edge, edge, edge),
+                                                1.0);
+          }
+        }
+        // the whole grid is in the view
+        lookAt(0.0, 0.0, 70.0, 0.0, 0.0, 0.0, 1.0);
+        return true;
+      }
+
+      void startMeasurement() {
+        GraphicsScene::startMeasurement();
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["objects"] = numObjects;
+        result->values["drawables_per_frame_instancing"] =
+          frames.drawablesPerFrame();
+        result->values["frame_ms_instancing"] = frames.msPerFrame();
+        if(!result->steps || !control->sim->restoreSnapshot(snapshot)) return;
+        setGraphicsProperty("instancing", false);
+        FrameStats plain = run(result->steps);
+        result->values["drawables_per_frame_no_instancing"] =
+          plain.drawablesPerFrame();
+        result->values["frame_ms_no_instancing"] = plain.msPerFrame();
+        if(frames.drawablesPerFrame() > 0.0) {
+          result->values["draw_call_reduction"] =
+            plain.drawablesPerFrame() / frames.drawablesPerFrame();
+        }
+        if(frames.msPerFrame() > 0.0) {
+          result->values["frame_speedup"] =
+            plain.msPerFrame() / frames.msPerFrame();
+        }
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(control && control->cfg) {
+          setGraphicsProperty("instancing", previousInstancing);
+        }
+      }
+
+    private:
+      unsigned long numObjects;
+      bool previousInstancing;
+      std::vector<char> snapshot;
+    };
+
+    /**
+     * A 1 km height map with 400 static rocks and 200 falling objects,
+     * seen from its edge so that the shadow cascades span the terrain.
+     * The frames are measured with the cascaded shadow map and its static
+     * caster cache; addValues() restores the state of the start of the
+     * measurement and repeats the steps without the cache and without
+     * shadows.
+     */
+    class ShadowTerrain : public GraphicsScene {
+    public:
+      ShadowTerrain()
+        : GraphicsScene("shadow_terrain",
+                        "1 km height map, frame time of the shadow cache"),
+          previousShadow(false), previousCache(true) {}
+
+      bool build() {
+        const int resolution = 513;
+        const double size = 1000.0, height = 40.0;
+        Random random(23);
+        previousShadow = getGraphicsProperty("marsShadow");
+        previousCache = getGraphicsProperty("shadowStaticCache");
+        setGraphicsProperty("marsShadow", true);
+        setGraphicsProperty("shadowStaticCache", true);
+
+        terrainStruct terrain;
+        terrain.name = "terrain";
+        terrain.width = terrain.height = resolution;
+        terrain.targetWidth = terrain.targetHeight = size;
+        terrain.scale = height;
+        // freed by the SimNode of the terrain
+        terrain.pixelData = (double*)calloc(resolution*resolution,
+                                            sizeof(double));
+        for(int y=0; y<resolution; ++y) {
+          for(int x=0; x<resolution; ++x) {
+            double h = 0.5 + 0.25*sin(x*0.023) * cos(y*0.017) +
+              0.1*sin((x+y)*0.09) + random.uniform(-0.01, 0.01);
+            terrain.pixelData[y*resolution+x] = h * height;
+          }
+        }
+        for(int i=0; i<600; ++i) {
+          char name[64];
+          bool rock = i < 400;
+          snprintf(name, sizeof(name), "%s_%d", rock ? "rock" : "object", i);
+          double s = rock ? random.uniform(1.0, 4.0) : random.uniform(0.5, 1.0);
+          // the objects fall onto the part of the terrain in the view
+          Vector pos(random.uniform(-size*0.4, size*0.4),
+                     rock ? random.uniform(-size*0.4, size*0.4) :
+                     random.uniform(-size*0.45, -size*0.2),
+                     height*1.5);
+          if(rock) {
+            // half buried in the terrain below
+            int x = (int)((pos.x()/size + 0.5) * (resolution-1));
+            int y = (int)((pos.y()/size + 0.5) * (resolution-1));
+            pos.z() = terrain.pixelData[y*resolution+x];
+          }
+          control->nodes->createPrimitiveNode(name, NODE_TYPE_BOX, !rock, pos,
+                                              Vector(s, s, s), 1.0);
+        }
+        // the rocks are placed first, the pixels belong to the terrain then
+        control->nodes->addTerrain(&terrain);
+        // at the southern edge, 70 degrees from looking down
+        lookAt(0.0, -size*0.5, height*2.0, sin(35.0*M_PI/180.0), 0.0, 0.0,
+               cos(35.0*M_PI/180.0));
+        return true;
+      }
+
+      void startMeasurement() {
+        GraphicsScene::startMeasurement();
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["terrain_cells"] = 512*512;
+        result->values["frame_ms_cached"] = frames.msPerFrame();
+        if(!result->steps || !control->sim->restoreSnapshot(snapshot)) return;
+        setGraphicsProperty("shadowStaticCache", false);
+        FrameStats uncached = run(result->steps);
+        result->values["frame_ms_uncached"] = uncached.msPerFrame();
+        if(frames.msPerFrame() > 0.0) {
+          result->values["cache_speedup"] =
+            uncached.msPerFrame() / frames.msPerFrame();
+        }
+        if(!control->sim->restoreSnapshot(snapshot)) return;
+        setGraphicsProperty("marsShadow", false);
+        FrameStats plain = run(result->steps);
+        result->values["frame_ms_no_shadows"] = plain.msPerFrame();
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(control && control->cfg) {
+          setGraphicsProperty("marsShadow", previousShadow);
+          setGraphicsProperty("shadowStaticCache", previousCache);
+        }
+      }
+
+    private:
+      bool previousShadow, previousCache;
+      std::vector<char> snapshot;
+    };
+
+    void createGraphicsBenchmarks(std::vector<Benchmark*> *benchmarks) {
+      benchmarks->push_back(new Instancing());
+      benchmarks->push_back(new ShadowTerrain());
+    }
+
+  } // end of namespace bench
+} // end of namespace mars
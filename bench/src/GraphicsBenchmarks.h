@@ -0,0 +1,55 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file GraphicsBenchmarks.h
+ * \brief Scenes that are stepped and drawn by mars_graphics.
+ *
+ * They only run if mars_bench is started with --graphics, which opens a
+ * window and thus needs a display. The drawables are the ones the main
+ * view culls per frame; every drawable is one draw call. The shadow
+ * passes are not included.
+ *  - instancing: 3000 identical boxes drawn with and without
+ *    "Graphics/instancing"; drawables and ms per frame of both
+ *  - shadow_terrain: a 1 km height map with static rocks and falling
+ *    objects; ms per frame with the cascaded shadow map and its static
+ *    caster cache, without the cache and without shadows
+ *
+ * The graphics benchmarks are only built if mars_graphics is available.
+ */
+
+#ifndef MARS_BENCH_GRAPHICS_BENCHMARKS_H
+#define MARS_BENCH_GRAPHICS_BENCHMARKS_H
+
+#ifdef _PRINT_HEADER_
+  #warning "GraphicsBenchmarks.h"
+#endif
+
+#include "Benchmark.h"
+
+namespace mars {
+  namespace bench {
+
+    void createGraphicsBenchmarks(std::vector<Benchmark*> *benchmarks);
+
+  } // end of namespace bench
+} // end of namespace mars
+
+#endif // MARS_BENCH_GRAPHICS_BENCHMARKS_H
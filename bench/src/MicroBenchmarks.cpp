@@ -0,0 +1,749 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "MicroBenchmarks.h"
+#include "SceneBenchmarks.h"
+
+#include <lib_manager/LibManager.hpp>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/sim/NodeManagerInterface.h>
+#include <mars/interfaces/sim/PhysicsInterface.h>
+#include <mars/interfaces/NodeData.h>
+#include <mars/interfaces/utils.h>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/data_broker/DataPackage.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/utils/misc.h>
+#include <mars/utils/MeshSimplifier.h>
+
+#ifdef HAVE_DATA_BROKER_RECORDER
+  #include <mars/data_broker_recorder/DataBrokerRecorder.h>
+#endif
+#ifdef HAVE_DATA_BROKER_BRIDGE
+  #include <mars/data_broker_bridge/DataBrokerBridge.h>
+  #include <mars/data_broker_bridge/BridgeClient.h>
+#endif
+#ifdef HAVE_MARS_GUI
+  #include <mars/gui/ImageProcess.h>
+#endif
+
+#include <sys/stat.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace mars {
+  namespace bench {
+
+    using namespace mars::interfaces;
+    using namespace mars::data_broker;
+
+    static const unsigned long numStreams = 1000;
+    static const unsigned long itemsPerStream = 10;
+
+    /**
+     * \brief pushes numStreams packages of itemsPerStream doubles in each
+     *        step and closes the step with an (empty) simulation step.
+     */
+    class StreamBenchmark : public Benchmark {
+    public:
+      StreamBenchmark(const std::string &name, const std::string &description)
+        : Benchmark(name, description), control(NULL), dataBroker(NULL) {}
+
+      bool setup(BenchContext *context) {
+        control = context->control;
+        dataBroker = control->dataBroker;
+        if(!dataBroker) return false;
+        control->sim->newWorld(true);
+        package.clear();
+        for(unsigned long i=0; i<itemsPerStream; ++i) {
+          char name[16];
+          snprintf(name, sizeof(name), "item%lu", i);
+          package.add(name, 0.0);
+        }
+        ids.resize(numStreams);
+        for(unsigned long i=0; i<numStreams; ++i) {
+          char name[32];
+          snprintf(name, sizeof(name), "stream%lu", i);
+          ids[i] = dataBroker->pushData("bench", name, package, NULL,
+                                        DATA_PACKAGE_NO_FLAG);
+        }
+        return setupStreams(context);
+      }
+
+      void pushStep(unsigned long index) {
+        for(unsigned long i=0; i<numStreams; ++i) {
+          package[0].d = (double)index;
+          dataBroker->pushData(ids[i], package);
+        }
+        control->sim->step(true);
+      }
+
+      void step(unsigned long index) {
+        pushStep(index);
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        result->values["items_per_step"] = numStreams * itemsPerStream;
+      }
+
+    protected:
+      virtual bool setupStreams(BenchContext *context) {
+        (void)context;
+        return true;
+      }
+
+      ControlCenter *control;
+      DataBrokerInterface *dataBroker;
+      DataPackage package;
+      std::vector<unsigned long> ids;
+    };
+
+    class CountingReceiver : public ReceiverInterface {
+    public:
+      CountingReceiver() : count(0) {}
+      void receiveData(const DataInfo &info, const DataPackage &dataPackage,
+                       int callbackParam) {
+        (void)info; (void)dataPackage; (void)callbackParam;
+        ++count;
+      }
+      unsigned long count;
+    };
+
+    class DataBrokerBenchmark : public StreamBenchmark {
+    public:
+      DataBrokerBenchmark()
+        : StreamBenchmark("data_broker",
+                          "10000 items per step to a sync receiver") {}
+
+      void startMeasurement() {
+        receiver.count = 0;
+      }
+
+      void addValues(BenchResult *result) {
+        StreamBenchmark::addValues(result);
+        if(result->steps) {
+          result->values["received_per_step"] =
+            (double)receiver.count / result->steps;
+        }
+      }
+
+      void teardown() {
+        if(dataBroker) dataBroker->unregisterSyncReceiver(&receiver, "bench",
+                                                          "*");
+      }
+
+    protected:
+      bool setupStreams(BenchContext *context) {
+        (void)context;
+        dataBroker->registerSyncReceiver(&receiver, "bench", "*");
+        return true;
+      }
+
+    private:
+      CountingReceiver receiver;
+    };
+
+#ifdef HAVE_DATA_BROKER_RECORDER
+    class RecorderBenchmark : public StreamBenchmark {
+    public:
+      RecorderBenchmark()
+        : StreamBenchmark("data_broker_recorder",
+                          "records 10000 items per step"),
+          libManager(NULL), recorder(NULL) {}
+
+      void addValues(BenchResult *result) {
+        StreamBenchmark::addValues(result);
+        recorder->stopRecording();
+        struct stat info;
+        if(stat(filename.c_str(), &info) == 0) {
+          result->values["file_kb"] = info.st_size / 1024.0;
+        }
+      }
+
+      void teardown() {
+        if(recorder) {
+          recorder->stopRecording();
+          libManager->releaseLibrary("data_broker_recorder");
+          recorder = NULL;
+        }
+        remove(filename.c_str());
+      }
+
+    protected:
+      bool setupStreams(BenchContext *context) {
+        libManager = context->libManager;
+        libManager->loadLibrary("data_broker_recorder", NULL, true);
+        recorder = libManager->getLibraryAs<data_broker_recorder::DataBrokerRecorder>("data_broker_recorder");
+        if(!recorder) return false;
+        filename = context->tmpDir + "/mars_bench.rec";
+        return recorder->startRecording(filename, "bench", "*");
+      }
+
+    private:
+      lib_manager::LibManager *libManager;
+      data_broker_recorder::DataBrokerRecorder *recorder;
+      std::string filename;
+    };
+#endif
+
+#ifdef HAVE_DATA_BROKER_BRIDGE
+    class BridgeBenchmark : public StreamBenchmark {
+    public:
+      BridgeBenchmark()
+        : StreamBenchmark("data_broker_bridge",
+                          "10000 items per step to a Unix socket client"),
+          libManager(NULL), bridge(NULL), latencySum(0.0), latencyMax(0.0),
+          measuredSteps(0), failedSteps(0) {}
+
+      void step(unsigned long index) {
+        double start = utils::getClockMs();
+        pushStep(index);
+        if(!client.receiveStep(2000)) {
+          ++failedSteps;
+          return;
+        }
+        double latency = utils::getClockMs() - start;
+        latencySum += latency;
+        if(latency > latencyMax) latencyMax = latency;
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        latencySum = latencyMax = 0.0;
+        measuredSteps = failedSteps = 0;
+      }
+
+      void addValues(BenchResult *result) {
+        StreamBenchmark::addValues(result);
+        if(measuredSteps) {
+          result->values["latency_avg_ms"] = latencySum / measuredSteps;
+        }
+        result->values["latency_max_ms"] = latencyMax;
+        result->values["missed_steps"] = client.getMissedSteps();
+        result->values["failed_steps"] = failedSteps;
+      }
+
+      void teardown() {
+        client.disconnect();
+        if(bridge) {
+          libManager->releaseLibrary("data_broker_bridge");
+          bridge = NULL;
+        }
+      }
+
+    protected:
+      bool setupStreams(BenchContext *context) {
+        libManager = context->libManager;
+        std::string socket = context->tmpDir + "/mars_bench.sock";
+        cfg_manager::CFGManagerInterface *cfg = control->cfg;
+        if(cfg) {
+          // the bridge reads its configuration when it is created
+          cfg->getOrCreateProperty("DataBrokerBridge", "tcpPort", 0);
+          cfg->setPropertyValue("DataBrokerBridge", "tcpPort", "value", 0);
+          cfg->getOrCreateProperty("DataBrokerBridge", "unixSocket", socket);
+          cfg->setPropertyValue("DataBrokerBridge", "unixSocket", "value",
+                                socket);
+        }
+        libManager->loadLibrary("data_broker_bridge", NULL, true);
+        bridge = libManager->getLibraryAs<data_broker_bridge::DataBrokerBridge>("data_broker_bridge");
+        if(!bridge) return false;
+        if(!bridge->isServing() && !bridge->startServer()) return false;
+        if(!client.connectUnix(socket)) return false;
+        client.subscribe("bench", "*");
+
+        // the subscription is handled by the IO thread of the bridge
+        for(int i=0; i<100; ++i) {
+          pushStep(0);
+          if(client.receiveStep(100) && client.getNumSamples() == numStreams) {
+            break;
+          }
+        }
+        return client.getNumSamples() == numStreams;
+      }
+
+    private:
+      lib_manager::LibManager *libManager;
+      data_broker_bridge::DataBrokerBridge *bridge;
+      data_broker_bridge::BridgeClient client;
+      double latencySum, latencyMax;
+      unsigned long measuredSteps, failedSteps;
+    };
+#endif
+
+    class SnapshotBenchmark : public Benchmark {
+    public:
+      SnapshotBenchmark()
+        : Benchmark("snapshot", "saves and restores 10000 objects"),
+          control(NULL) {}
+
+      bool setup(BenchContext *context) {
+        control = context->control;
+        control->sim->newWorld(true);
+        buildRubbleField(control, 10000);
+        control->sim->step(true);
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        control->sim->saveSnapshot(&snapshot);
+        control->sim->restoreSnapshot(snapshot);
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        result->values["snapshot_kb"] = snapshot.size() / 1024.0;
+      }
+
+      void teardown() {
+        if(control) control->sim->newWorld(true);
+      }
+
+    private:
+      ControlCenter *control;
+      std::vector<char> snapshot;
+    };
+
+    /**
+     * An episode is a reset of 500 falling objects followed by ten steps.
+     * The reset either restores a snapshot taken after the setup or
+     * rebuilds the scene with Simulator::resetSim.
+     */
+    class EpisodeBenchmark : public Benchmark {
+    public:
+      explicit EpisodeBenchmark(bool snapshots)
+        : Benchmark(snapshots ? "episodes_snapshot" : "episodes_reset",
+                    snapshots ? "500 objects reset by restoreSnapshot" :
+                    "500 objects reset by resetSim"),
+          control(NULL), snapshots(snapshots) {}
+
+      bool setup(BenchContext *context) {
+        control = context->control;
+        control->sim->newWorld(true);
+        buildRubbleField(control, 500);
+        control->sim->saveSnapshot(&snapshot);
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        if(snapshots) {
+          control->sim->restoreSnapshot(snapshot);
+        } else {
+          // the reset is done by the next finishedDraw of the graphics
+          control->sim->resetSim(false);
+          control->sim->finishedDraw();
+        }
+        for(int i=0; i<episodeSteps; ++i) {
+          control->sim->step(true);
+        }
+      }
+
+      void addValues(BenchResult *result) {
+        // every measured step is one episode
+        result->values["episodes_per_second"] = result->stepsPerSecond;
+        result->values["steps_per_episode"] = episodeSteps;
+      }
+
+      void teardown() {
+        if(control) control->sim->newWorld(true);
+      }
+
+    private:
+      static const int episodeSteps = 10;
+      ControlCenter *control;
+      bool snapshots;
+      std::vector<char> snapshot;
+    };
+
+    class NodeLookupBenchmark : public Benchmark {
+    public:
+      NodeLookupBenchmark()
+        : Benchmark("node_lookup", "looks up 10000 nodes by name"),
+          control(NULL), found(0) {}
+
+      bool setup(BenchContext *context) {
+        control = context->control;
+        control->sim->newWorld(true);
+        unsigned long n = buildRubbleField(control, 10000);
+        names.resize(n);
+        for(unsigned long i=0; i<n; ++i) {
+          char name[32];
+          snprintf(name, sizeof(name), "rubble_%lu", i);
+          names[i] = name;
+        }
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        found = 0;
+        for(size_t i=0; i<names.size(); ++i) {
+          if(control->nodes->getID(names[i])) ++found;
+        }
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        result->values["lookups_per_step"] = names.size();
+        result->values["found_per_step"] = found;
+      }
+
+      void teardown() {
+        if(control) control->sim->newWorld(true);
+      }
+
+    private:
+      ControlCenter *control;
+      std::vector<std::string> names;
+      unsigned long found;
+    };
+
+    /**
+     * \brief a sphere of rows*columns*2 triangles with bumps, so the
+     *        reduction and the collision mesh do not get trivial
+     */
+    static void buildBumpySphere(int rows, int columns,
+                                 utils::BinaryMeshSource *mesh) {
+      *mesh = utils::BinaryMeshSource();
+      for(int r=0; r<=rows; ++r) {
+        for(int c=0; c<=columns; ++c) {
+          double theta = M_PI*r/rows, phi = 2.0*M_PI*c/columns;
+          double radius = 1.0 + 0.05*sin(7.0*phi)*sin(5.0*theta);
+          double n[3] = {sin(theta)*cos(phi), sin(theta)*sin(phi),
+                         cos(theta)};
+          for(int k=0; k<3; ++k) {
+            mesh->positions.push_back(radius*n[k]);
+            mesh->normals.push_back(n[k]);
+          }
+          mesh->texcoords.push_back((double)c/columns);
+          mesh->texcoords.push_back((double)r/rows);
+        }
+      }
+      for(int r=0; r<rows; ++r) {
+        for(int c=0; c<columns; ++c) {
+          uint32_t a = r*(columns+1) + c, b = a + columns + 1;
+          uint32_t t[6] = {a, b, a+1, a+1, b, b+1};
+          mesh->indices.insert(mesh->indices.end(), t, t+6);
+        }
+      }
+    }
+
+    /**
+     * \brief reduces a bumpy sphere to the default ratios of the automatic
+     *        levels of detail (see graphics "autoLODRatios"); every level
+     *        is reduced from the previous one like the graphics does.
+     */
+    class MeshLODBenchmark : public Benchmark {
+    public:
+      MeshLODBenchmark()
+        : Benchmark("mesh_lod", "reduces a mesh with 8192 triangles to "
+                    "50, 20 and 5 %") {}
+
+      bool setup(BenchContext *context) {
+        (void)context;
+        buildBumpySphere(64, 64, &mesh);
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        const double ratios[3] = {0.5, 0.2, 0.05};
+        const utils::BinaryMeshSource *source = &mesh;
+        double ratio = 1.0;
+        for(int i=0; i<3; ++i) {
+          utils::simplifyMesh(*source, ratios[i]/ratio, &levels[i]);
+          source = &levels[i];
+          ratio = ratios[i];
+        }
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        result->values["triangles"] = mesh.indices.size()/3;
+        result->values["triangles_lod1"] = levels[0].indices.size()/3;
+        result->values["triangles_lod2"] = levels[1].indices.size()/3;
+        result->values["triangles_lod3"] = levels[2].indices.size()/3;
+      }
+
+    private:
+      utils::BinaryMeshSource mesh;
+      utils::BinaryMeshSource levels[3];
+    };
+
+    /**
+     * \brief loads the collision mesh and the mass of a mesh node from a
+     *        .bobj file with 131072 triangles like NodeManager::addNode
+     *        does, without the graphics.
+     */
+    class MeshLoadBenchmark : public Benchmark {
+    public:
+      MeshLoadBenchmark()
+        : Benchmark("mesh_load", "loads the physics of a .bobj mesh with "
+                    "131072 triangles"),
+          triangles(0), mass(0.0) {}
+
+      bool setup(BenchContext *context) {
+        std::vector<utils::BinaryMeshSource> parts(1);
+        buildBumpySphere(256, 256, &parts[0]);
+        parts[0].name = "sphere";
+        triangles = parts[0].indices.size()/3;
+        filename = context->tmpDir + "/mars_bench_mesh_load.bobj";
+        return utils::BinaryMesh::write(filename, parts);
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        NodeData node;
+        node.init("sphere");
+        node.physicMode = NODE_TYPE_MESH;
+        node.filename = filename;
+        node.origName = "sphere";
+        node.ext = utils::Vector(2.0, 2.0, 2.0);
+        if(getPhysicsFromBinaryMesh(&node)) mass = node.mass;
+        delete[] node.mesh.vertices;
+        delete[] node.mesh.indices;
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        struct stat info;
+        result->values["triangles"] = triangles;
+        result->values["mass"] = mass;
+        if(stat(filename.c_str(), &info) == 0) {
+          result->values["file_kb"] = info.st_size / 1024.0;
+        }
+      }
+
+      void teardown() {
+        if(!filename.empty()) remove(filename.c_str());
+      }
+
+    private:
+      std::string filename;
+      unsigned long triangles;
+      double mass;
+    };
+
+    /**
+     * \brief casts 1000 horizontal rays of 20 m through the obstacles of
+     *        obstacle_field via PhysicsInterface::getVectorCollision.
+     */
+    class RayCastBenchmark : public Benchmark {
+    public:
+      explicit RayCastBenchmark(bool baked)
+        : Benchmark(baked ? "ray_cast_baked" : "ray_cast",
+                    baked ? "1000 rays through 5000 baked static meshes" :
+                    "1000 rays through 5000 static meshes"),
+          control(NULL), baked(baked), previousBaking(false), hits(0) {}
+
+      bool setup(BenchContext *context) {
+        const int numRays = 1000;
+        const double length = 20.0, size = 100.0;
+        Random random(5);
+        control = context->control;
+        previousBaking = setStaticBaking(control, baked);
+        control->sim->newWorld(true);
+        if(!buildObstacleField(control, 5000,
+                               context->tmpDir + "/mars_bench_obstacle.bobj")) {
+          return false;
+        }
+        // the static meshes are baked before the first step
+        control->sim->step(true);
+        origins.clear();
+        rays.clear();
+        for(int i=0; i<numRays; ++i) {
+          double a = random.uniform(0.0, 2*M_PI);
+          origins.push_back(utils::Vector(random.uniform(-size*0.5, size*0.5),
+                                          random.uniform(-size*0.5, size*0.5),
+                                          random.uniform(0.1, 1.0)));
+          rays.push_back(utils::Vector(length*cos(a), length*sin(a), 0.0));
+        }
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        PhysicsInterface *physics = control->sim->getPhysics();
+        hits = 0;
+        for(size_t i=0; i<rays.size(); ++i) {
+          if(physics->getVectorCollision(origins[i], rays[i]) <
+             rays[i].norm()) {
+            ++hits;
+          }
+        }
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        result->values["rays_per_step"] = rays.size();
+        // compare with ray_cast, the baked mesh has to hit the same meshes
+        result->values["hits_per_step"] = hits;
+      }
+
+      void teardown() {
+        if(!control) return;
+        control->sim->newWorld(true);
+        setStaticBaking(control, previousBaking);
+      }
+
+    private:
+      ControlCenter *control;
+      bool baked, previousBaking;
+      std::vector<utils::Vector> origins, rays;
+      unsigned long hits;
+    };
+
+#ifdef HAVE_MARS_GUI
+    /**
+     * \brief feeds 1280x720 frames into the capture pipeline of the gui
+     *        (gui::ImageProcess): the pool of 8 buffers, the converter
+     *        threads and the video writer. A step copies a frame into a
+     *        free buffer like the grab does and waits if the pool is
+     *        full, so no frame is dropped and the frames/s are the
+     *        throughput of the pipeline including the frames that are
+     *        still written after the last step. The converter alone is
+     *        measured in addValues().
+     */
+    class CaptureBenchmark : public Benchmark {
+    public:
+      CaptureBenchmark()
+        : Benchmark("capture", "1280x720 frames through the capture "
+                    "buffer pool, converters and writer"),
+          process(NULL), addedFrames(0), measuredFrames(0), waitMs(0.0) {}
+
+      bool setup(BenchContext *context) {
+        tmpDir = context->tmpDir;
+        frame.resize((size_t)width*height*4);
+        for(size_t i=0; i<frame.size(); ++i) {
+          frame[i] = (unsigned char)(i*7 + i/4096);
+        }
+        addedFrames = 0;
+        process = new gui::ImageProcess(QString::fromStdString(tmpDir), 25);
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        gui::myImage *image = process->getFreeImage();
+        if(!image) {
+          double start = utils::getClockMs();
+          while(!image) {
+            utils::msleep(1);
+            image = process->getFreeImage();
+          }
+          waitMs += utils::getClockMs() - start;
+        }
+        process->resizeImage(image, width, height);
+        memcpy(image->data, &frame[0], frame.size());
+        process->addImage(image);
+        ++addedFrames;
+        ++measuredFrames;
+      }
+
+      void startMeasurement() {
+        measuredFrames = 0;
+        waitMs = 0.0;
+      }
+
+      bool stepsSimulation() const {return false;}
+
+      void addValues(BenchResult *result) {
+        double start = utils::getClockMs();
+        while(process->getWritten() + process->getDropped() < addedFrames) {
+          utils::msleep(1);
+        }
+        double flushMs = utils::getClockMs() - start;
+        result->values["width"] = width;
+        result->values["height"] = height;
+        result->values["written_frames"] = process->getWritten();
+        // all frames are dropped if the video writer could not be opened
+        result->values["dropped_frames"] = process->getDropped();
+        if(measuredFrames && result->runMs + flushMs > 0.0) {
+          result->values["frames_per_second"] =
+            measuredFrames * 1000.0 / (result->runMs + flushMs);
+          result->values["wait_for_buffer_ms_per_frame"] =
+            waitMs / measuredFrames;
+        }
+
+        const int conversions = 100;
+        int stride = (width*3 + 3) & ~3;
+        std::vector<unsigned char> converted((size_t)stride*height);
+        start = utils::getClockMs();
+        for(int i=0; i<conversions; ++i) {
+          gui::ImageProcess::convertImage(&frame[0], &converted[0], width,
+                                          height, stride);
+        }
+        double ms = utils::getClockMs() - start;
+        if(ms > 0.0) {
+          result->values["convert_frames_per_second"] =
+            conversions * 1000.0 / ms;
+        }
+      }
+
+      void teardown() {
+        delete process;
+        process = NULL;
+        remove((tmpDir + "/image_process_1.avi").c_str());
+      }
+
+    private:
+      static const int width = 1280, height = 720;
+      gui::ImageProcess *process;
+      std::string tmpDir;
+      std::vector<unsigned char> frame;
+      unsigned long addedFrames, measuredFrames;
+      double waitMs;
+    };
+#endif
+
+    void createMicroBenchmarks(std::vector<Benchmark*> *benchmarks) {
+      benchmarks->push_back(new DataBrokerBenchmark());
+#ifdef HAVE_DATA_BROKER_RECORDER
+      benchmarks->push_back(new RecorderBenchmark());
+#endif
+#ifdef HAVE_DATA_BROKER_BRIDGE
+      benchmarks->push_back(new BridgeBenchmark());
+#endif
+      benchmarks->push_back(new SnapshotBenchmark());
+      benchmarks->push_back(new EpisodeBenchmark(true));
+      benchmarks->push_back(new EpisodeBenchmark(false));
+      benchmarks->push_back(new NodeLookupBenchmark());
+      benchmarks->push_back(new MeshLODBenchmark());
+      benchmarks->push_back(new MeshLoadBenchmark());
+      benchmarks->push_back(new RayCastBenchmark(false));
+      benchmarks->push_back(new RayCastBenchmark(true));
+#ifdef HAVE_MARS_GUI
+      benchmarks->push_back(new CaptureBenchmark());
+#endif
+    }
+
+  } // end of namespace bench
+} // end of namespace mars
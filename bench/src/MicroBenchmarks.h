@@ -0,0 +1,65 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file MicroBenchmarks.h
+ * \brief Benchmarks of single components that run next to the scenes.
+ *
+ *  - data_broker: pushes 10000 items per step to a sync receiver
+ *  - data_broker_recorder: records the same streams to a file
+ *  - data_broker_bridge: sends them to a client over a Unix socket and
+ *    measures the latency until the client has received the step
+ *  - snapshot: saves and restores a scene with 10000 objects
+ *  - episodes_snapshot, episodes_reset: episodes of ten steps of 500
+ *    falling objects that start with restoreSnapshot or resetSim
+ *  - node_lookup: looks up 10000 nodes by name
+ *  - mesh_lod: reduces a mesh with 8192 triangles to the default levels
+ *    of detail of loaded meshes
+ *  - mesh_load: loads the collision mesh and mass of a mesh node from a
+ *    .bobj file with 131072 triangles
+ *  - ray_cast: casts 1000 rays through the field of obstacle_field
+ *  - ray_cast_baked: the same with the static meshes baked into one
+ *  - capture: 1280x720 frames through the buffer pool, converter threads
+ *    and video writer of the capture window; frames/s of the pipeline
+ *    and of the converter alone
+ *
+ * The recorder, bridge and capture benchmarks are only built if the
+ * libraries are available.
+ */
+
+#ifndef MARS_BENCH_MICRO_BENCHMARKS_H
+#define MARS_BENCH_MICRO_BENCHMARKS_H
+
+#ifdef _PRINT_HEADER_
+  #warning "MicroBenchmarks.h"
+#endif
+
+#include "Benchmark.h"
+
+namespace mars {
+  namespace bench {
+
+    void createMicroBenchmarks(std::vector<Benchmark*> *benchmarks);
+
+  } // end of namespace bench
+} // end of namespace mars
+
+#endif // MARS_BENCH_MICRO_BENCHMARKS_H
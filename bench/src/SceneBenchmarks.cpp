@@ -0,0 +1,1727 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "SceneBenchmarks.h"
+#include "AllocCounter.h"
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/sim/NodeManagerInterface.h>
+#include <mars/interfaces/sim/JointManagerInterface.h>
+#include <mars/interfaces/sim/MotorManagerInterface.h>
+#include <mars/interfaces/sim/SensorManagerInterface.h>
+#include <mars/interfaces/sim/PhysicsInterface.h>
+#include <mars/interfaces/sim/EntityManagerInterface.h>
+#include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/sim/PluginInterface.h>
+#include <mars/interfaces/sensor_bases.h>
+#include <mars/interfaces/terrainStruct.h>
+#include <mars/interfaces/JointData.h>
+#include <mars/interfaces/MotorData.h>
+#include <mars/interfaces/NodeData.h>
+#include <mars/utils/BinaryMesh.h>
+#include <mars/utils/mathUtils.h>
+#include <mars/utils/misc.h>
+#include <mars/utils/TiledHeightMap.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/Trace.h>
+#include <mars/sim/SimEntity.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <configmaps/ConfigData.h>
+#include <lib_manager/LibManager.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef WIN32
+  #include <unistd.h>
+#endif
+
+namespace mars {
+  namespace bench {
+
+    using namespace mars::interfaces;
+    using mars::utils::Vector;
+    using mars::utils::Quaternion;
+
+    double Random::uniform(double min, double max) {
+      // the 32 bit LCG from Numerical Recipes; the scenes only need to be
+      // the same on all platforms, not random
+      state = (1664525UL * state + 1013904223UL) & 0xffffffffUL;
+      return min + (max - min) * (state / 4294967296.0);
+    }
+
+    static Quaternion randomRotation(Random *random) {
+      Vector axis(random->uniform(-1.0, 1.0), random->uniform(-1.0, 1.0),
+                  random->uniform(-1.0, 1.0));
+      if(axis.norm() < 1e-6) axis = Vector(0.0, 0.0, 1.0);
+      return utils::angleAxisToQuaternion(random->uniform(0.0, 2*M_PI),
+                                          axis.normalized());
+    }
+
+    static std::string indexedName(const char *prefix, unsigned long i) {
+      char name[64];
+      snprintf(name, sizeof(name), "%s_%lu", prefix, i);
+      return name;
+    }
+
+    static unsigned long addHinge(ControlCenter *control,
+                                  const std::string &name,
+                                  NodeId node1, NodeId node2,
+                                  const Vector &anchor, const Vector &axis) {
+      JointData joint(name, JOINT_TYPE_HINGE, node1, node2);
+      joint.anchorPos = ANCHOR_CUSTOM;
+      joint.anchor = anchor;
+      joint.axis1 = axis;
+      return control->joints->addJoint(&joint);
+    }
+
+    static unsigned long addMotor(ControlCenter *control,
+                                  const std::string &name,
+                                  unsigned long jointId, MotorType type) {
+      MotorData motor(name, type);
+      motor.jointIndex = jointId;
+      motor.maxEffort = 50.0;
+      motor.maxSpeed = 5.0;
+      motor.p = 10.0;
+      motor.i = 0.0;
+      motor.d = 0.0;
+      return control->motors->addMotor(&motor);
+    }
+
+    /**
+     * \brief adds a four wheeled rover with velocity controlled wheels of
+     *        radius 0.15 whose axes are centered at \a pos.
+     * \return the chassis
+     */
+    static NodeId addRover(ControlCenter *control, const Vector &pos,
+                           std::vector<NodeId> *wheelNodes,
+                           std::vector<unsigned long> *motors) {
+      NodeId chassis = control->nodes->createPrimitiveNode(
+        "chassis", NODE_TYPE_BOX, true, pos + Vector(0.0, 0.0, 0.2),
+        Vector(1.0, 0.6, 0.2), 10.0);
+      // cylinders are aligned with z; turn the wheel axes to y
+      Quaternion wheelRotation = utils::angleAxisToQuaternion(
+        M_PI*0.5, Vector(1.0, 0.0, 0.0));
+      if(wheelNodes) wheelNodes->clear();
+      motors->clear();
+      for(int i=0; i<4; ++i) {
+        Vector offset((i < 2) ? 0.35 : -0.35, (i % 2) ? 0.4 : -0.4, 0.0);
+        std::string name = indexedName("wheel", i);
+        NodeId wheel = control->nodes->createPrimitiveNode(
+          name, NODE_TYPE_CYLINDER, true, pos + offset,
+          Vector(0.15, 0.1, 0.0), 1.0, wheelRotation);
+        unsigned long joint = addHinge(control, name, chassis, wheel,
+                                       pos + offset,
+                                       Vector(0.0, 1.0, 0.0));
+        motors->push_back(addMotor(control, name, joint,
+                                   MOTOR_TYPE_VELOCITY));
+        if(wheelNodes) wheelNodes->push_back(wheel);
+      }
+      return chassis;
+    }
+
+    NodeId addGround(ControlCenter *control, double size) {
+      return control->nodes->createPrimitiveNode("ground", NODE_TYPE_BOX,
+                                                 false, Vector(0.0, 0.0, -0.5),
+                                                 Vector(size, size, 1.0));
+    }
+
+    unsigned long buildBoxStacks(ControlCenter *control) {
+      const int stacksX = 5, stacksY = 4, height = 10;
+      const double edge = 0.5;
+      unsigned long n = 0;
+      addGround(control, 50.0);
+      for(int x=0; x<stacksX; ++x) {
+        for(int y=0; y<stacksY; ++y) {
+          for(int z=0; z<height; ++z) {
+            Vector pos((x - stacksX/2) * 2.0, (y - stacksY/2) * 2.0,
+                       edge*0.5 + z*(edge + 0.001));
+            control->nodes->createPrimitiveNode(indexedName("box", n++),
+                                                NODE_TYPE_BOX, true, pos,
+                                                Vector(edge, edge, edge),
+                                                1.0);
+          }
+        }
+      }
+      return n;
+    }
+
+    unsigned long buildRubbleField(ControlCenter *control,
+                                   unsigned long numObjects) {
+      Random random(42);
+      unsigned long side = (unsigned long)ceil(sqrt((double)numObjects));
+      addGround(control, side + 20.0);
+      for(unsigned long i=0; i<numObjects; ++i) {
+        Vector pos((double)(i % side) - side*0.5, (double)(i / side) - side*0.5,
+                   random.uniform(0.3, 2.0));
+        double size = random.uniform(0.1, 0.4);
+        double mass = random.uniform(0.5, 2.0);
+        NodeType type;
+        Vector ext;
+        switch(i % 3) {
+        case 0:
+          type = NODE_TYPE_BOX;
+          ext = Vector(size, random.uniform(0.1, 0.4), random.uniform(0.1, 0.4));
+          break;
+        case 1:
+          type = NODE_TYPE_SPHERE;
+          ext = Vector(size*0.5, 0.0, 0.0);
+          break;
+        default:
+          type = NODE_TYPE_CAPSULE;
+          ext = Vector(size*0.3, size, 0.0);
+        }
+        control->nodes->createPrimitiveNode(indexedName("rubble", i), type,
+                                            true, pos, ext, mass,
+                                            randomRotation(&random));
+      }
+      return numObjects;
+    }
+
+    /**
+     * \brief drops spheres and boxes with random rotations from 2 to 4 m
+     *        onto a square of \a size around the origin.
+     */
+    static void addFallingObjects(ControlCenter *control, double size,
+                                  unsigned long numObjects) {
+      Random random(31);
+      for(unsigned long i=0; i<numObjects; ++i) {
+        Vector pos(random.uniform(-size*0.5, size*0.5),
+                   random.uniform(-size*0.5, size*0.5),
+                   random.uniform(2.0, 4.0));
+        double s = random.uniform(0.2, 0.5);
+        bool box = (i % 2) == 0;
+        control->nodes->createPrimitiveNode(
+          indexedName("object", i), box ? NODE_TYPE_BOX : NODE_TYPE_SPHERE,
+          true, pos, box ? Vector(s, s, s) : Vector(s*0.5, 0.0, 0.0), 1.0,
+          randomRotation(&random));
+      }
+    }
+
+    bool setStaticBaking(ControlCenter *control, bool bake) {
+      bool previous = false;
+      if(!control->cfg) return false;
+      control->cfg->getPropertyValue("Simulator", "bake static geometry",
+                                     "value", &previous);
+      control->cfg->setPropertyValue("Simulator", "bake static geometry",
+                                     "value", bake);
+      return previous;
+    }
+
+    bool SceneBenchmark::setup(BenchContext *context) {
+      control = context->control;
+      control->sim->newWorld(true);
+      return build();
+    }
+
+    void SceneBenchmark::step(unsigned long index) {
+      update(index);
+      control->sim->step(true);
+    }
+
+    void SceneBenchmark::teardown() {
+      if(control) control->sim->newWorld(true);
+    }
+
+    class BoxStacks : public SceneBenchmark {
+    public:
+      BoxStacks() : SceneBenchmark("box_stacks", "20 stacks of 10 boxes"),
+                    numObjects(0) {}
+
+      bool build() {
+        numObjects = buildBoxStacks(control);
+        return true;
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["objects"] = numObjects;
+      }
+
+    private:
+      unsigned long numObjects;
+    };
+
+    static void addVertex(utils::BinaryMeshSource *mesh, const Vector &p,
+                          const Vector &n) {
+      for(int k=0; k<3; ++k) {
+        mesh->positions.push_back(p[k]);
+        mesh->normals.push_back(n[k]);
+      }
+    }
+
+    /**
+     * \brief adds the outer faces of the \a filled cells of a voxel grid
+     *        with \a n cells of size \a cell; every face is split into
+     *        \a subdivisions x \a subdivisions quads. The grid is centered
+     *        at the origin and x runs fastest in \a filled.
+     */
+    static void addVoxelSurface(const std::vector<bool> &filled, const int n[3],
+                                const Vector &cell, int subdivisions,
+                                utils::BinaryMeshSource *mesh) {
+      Vector origin(-n[0]*cell.x()*0.5, -n[1]*cell.y()*0.5,
+                    -n[2]*cell.z()*0.5);
+      for(int i=0; i<n[0]*n[1]*n[2]; ++i) {
+        if(!filled[i]) continue;
+        int c[3] = {i % n[0], (i / n[0]) % n[1], i / (n[0]*n[1])};
+        for(int face=0; face<6; ++face) {
+          int a = face / 2, side = (face % 2) ? 1 : -1;
+          int d[3] = {c[0], c[1], c[2]};
+          d[a] += side;
+          if(d[a] >= 0 && d[a] < n[a] &&
+             filled[(d[2]*n[1] + d[1])*n[0] + d[0]]) {
+            continue;
+          }
+          // u x v points along axis a
+          int u = (a + 1) % 3, v = (a + 2) % 3;
+          Vector normal(0.0, 0.0, 0.0);
+          normal[a] = side;
+          uint32_t base = mesh->positions.size() / 3;
+          for(int y=0; y<=subdivisions; ++y) {
+            for(int x=0; x<=subdivisions; ++x) {
+              Vector p;
+              p[a] = origin[a] + (c[a] + (side > 0 ? 1 : 0)) * cell[a];
+              p[u] = origin[u] + (c[u] + (double)x/subdivisions) * cell[u];
+              p[v] = origin[v] + (c[v] + (double)y/subdivisions) * cell[v];
+              addVertex(mesh, p, normal);
+            }
+          }
+          for(int y=0; y<subdivisions; ++y) {
+            for(int x=0; x<subdivisions; ++x) {
+              uint32_t p00 = base + y*(subdivisions+1) + x, p10 = p00 + 1;
+              uint32_t p01 = p00 + subdivisions + 1, p11 = p01 + 1;
+              uint32_t t[6] = {p00, p10, p11, p00, p11, p01};
+              if(side < 0) {
+                std::swap(t[1], t[2]);
+                std::swap(t[4], t[5]);
+              }
+              mesh->indices.insert(mesh->indices.end(), t, t+6);
+            }
+          }
+        }
+      }
+    }
+
+    /** \brief adds a closed cylinder along z centered at the origin */
+    static void addCylinderSurface(double radius, double length, int sides,
+                                   int rings, utils::BinaryMeshSource *mesh) {
+      uint32_t base = mesh->positions.size() / 3;
+      for(int r=0; r<=rings; ++r) {
+        for(int i=0; i<sides; ++i) {
+          double a = 2*M_PI*i/sides;
+          Vector normal(cos(a), sin(a), 0.0);
+          addVertex(mesh, Vector(radius*normal.x(), radius*normal.y(),
+                                 length*((double)r/rings - 0.5)), normal);
+        }
+      }
+      for(int r=0; r<rings; ++r) {
+        for(int i=0; i<sides; ++i) {
+          uint32_t a = base + r*sides + i, b = base + r*sides + (i+1) % sides;
+          uint32_t t[6] = {a, b, b + sides, a, b + sides, a + sides};
+          mesh->indices.insert(mesh->indices.end(), t, t+6);
+        }
+      }
+      for(int cap=-1; cap<=1; cap+=2) {
+        Vector normal(0.0, 0.0, cap);
+        uint32_t center = mesh->positions.size() / 3;
+        addVertex(mesh, normal*length*0.5, normal);
+        for(int i=0; i<sides; ++i) {
+          double a = 2*M_PI*i/sides;
+          addVertex(mesh, Vector(radius*cos(a), radius*sin(a), cap*length*0.5),
+                    normal);
+        }
+        for(int i=0; i<sides; ++i) {
+          uint32_t t[3] = {center, center + 1 + i, center + 1 + (i+1) % sides};
+          if(cap < 0) std::swap(t[1], t[2]);
+          mesh->indices.insert(mesh->indices.end(), t, t+3);
+        }
+      }
+    }
+
+    static bool writeMesh(const std::string &filename,
+                          const utils::BinaryMeshSource &mesh) {
+      return utils::BinaryMesh::write(
+        filename, std::vector<utils::BinaryMeshSource>(1, mesh));
+    }
+
+    unsigned long buildObstacleField(ControlCenter *control,
+                                     unsigned long numObstacles,
+                                     const std::string &meshFile) {
+      const double spacing = 1.5;
+      Random random(23);
+      unsigned long side = (unsigned long)ceil(sqrt((double)numObstacles));
+      if(!meshFile.empty()) {
+        // a unit cube, the mesh nodes scale it to their extent
+        utils::BinaryMeshSource cube;
+        const int cells[3] = {1, 1, 1};
+        cube.name = "obstacle";
+        addVoxelSurface(std::vector<bool>(1, true), cells,
+                        Vector(1.0, 1.0, 1.0), 1, &cube);
+        if(!writeMesh(meshFile, cube)) return 0;
+      }
+      addGround(control, side*spacing + 10.0);
+      for(unsigned long i=0; i<numObstacles; ++i) {
+        Vector ext(random.uniform(0.2, 1.0), random.uniform(0.2, 1.0),
+                   random.uniform(0.2, 1.5));
+        Vector pos(((double)(i % side) - side*0.5) * spacing,
+                   ((double)(i / side) - side*0.5) * spacing, ext.z()*0.5);
+        Quaternion rotation = utils::angleAxisToQuaternion(
+          random.uniform(0.0, M_PI), Vector(0.0, 0.0, 1.0));
+        if(meshFile.empty()) {
+          control->nodes->createPrimitiveNode(indexedName("obstacle", i),
+                                              NODE_TYPE_BOX, false, pos, ext,
+                                              0.0, rotation);
+          continue;
+        }
+        NodeData node;
+        node.initPrimitive(NODE_TYPE_MESH, ext, 0.0);
+        node.name = indexedName("obstacle", i);
+        node.filename = meshFile;
+        node.pos = pos;
+        node.rot = rotation;
+        node.movable = false;
+        control->nodes->addNode(&node);
+      }
+      return numObstacles;
+    }
+
+    /**
+     * The walker has ten body segments in a row. Each segment carries two
+     * legs with a yaw and a pitch joint at the hip and a knee, 60 motors
+     * in total. The legs swing with a phase shift along the body.
+     *
+     * The mesh walkers replace the segments by open trays and the thighs
+     * and shanks by finely tessellated meshes. They collide as trimeshes
+     * or through the given collision proxy. The meshes and the proxy
+     * cache are kept in the tmp directory, so only the first run includes
+     * the decomposition in the setup time.
+     */
+    class Walker : public SceneBenchmark {
+    public:
+      Walker() : SceneBenchmark("walker", "walker with 60 hinge joints"),
+                 meshes(false), proxy(COLLISION_PROXY_NONE),
+                 meshTriangles(0), contacts(0), measuredSteps(0) {}
+
+      explicit Walker(CollisionProxy proxy)
+        : SceneBenchmark(meshWalkerName(proxy),
+                         "walker with 60 hinge joints built from meshes"),
+          meshes(true), proxy(proxy), meshTriangles(0), contacts(0),
+          measuredSteps(0) {}
+
+      bool setup(BenchContext *context) {
+        tmpDir = context->tmpDir;
+        return SceneBenchmark::setup(context);
+      }
+
+      bool build() {
+        const int numSegments = 10;
+        const double z = 0.6;
+        NodeId previous = 0;
+        if(meshes && !writeMeshes()) return false;
+        addGround(control, 50.0);
+        motors.clear();
+        phases.clear();
+        for(int s=0; s<numSegments; ++s) {
+          double x = s * 0.45;
+          NodeId segment = createPart(indexedName("segment", s), "segment",
+                                      Vector(x, 0.0, z),
+                                      Vector(0.4, 0.3, 0.15), 2.0);
+          if(previous) {
+            JointData joint(indexedName("spine", s), JOINT_TYPE_FIXED,
+                            previous, segment);
+            joint.anchorPos = ANCHOR_CENTER;
+            control->joints->addJoint(&joint);
+          }
+          previous = segment;
+          for(int side=-1; side<=1; side+=2) {
+            std::string leg = indexedName(side < 0 ? "right" : "left", s);
+            double phase = s * M_PI / 5.0 + (side < 0 ? M_PI : 0.0);
+            NodeId hip = createBox(leg + "_hip", Vector(x, side*0.2, z),
+                                   Vector(0.1, 0.1, 0.1), 0.2);
+            NodeId thigh = createPart(leg + "_thigh", "thigh",
+                                      Vector(x, side*0.375, z),
+                                      Vector(0.05, 0.25, 0.05), 0.3);
+            NodeId shank = createPart(leg + "_shank", "shank",
+                                      Vector(x, side*0.5, z - 0.25),
+                                      Vector(0.05, 0.05, 0.5), 0.3);
+            addLegMotor(leg + "_yaw", segment, hip, Vector(x, side*0.15, z),
+                        Vector(0.0, 0.0, 1.0), phase);
+            addLegMotor(leg + "_pitch", hip, thigh, Vector(x, side*0.25, z),
+                        Vector(1.0, 0.0, 0.0), phase + M_PI*0.5);
+            addLegMotor(leg + "_knee", thigh, shank, Vector(x, side*0.5, z),
+                        Vector(1.0, 0.0, 0.0), phase + M_PI*0.5);
+          }
+        }
+        return true;
+      }
+
+      void update(unsigned long index) {
+        double t = index * 0.01;
+        for(size_t i=0; i<motors.size(); ++i) {
+          control->motors->setMotorValue(motors[i],
+                                         0.3 * sin(2*M_PI*t + phases[i]));
+        }
+        contacts += control->sim->getPhysics()->getContactCacheStats().contacts;
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        contacts = measuredSteps = 0;
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["motors"] = motors.size();
+        result->values["contacts_per_step"] =
+          measuredSteps ? (double)contacts / measuredSteps : 0.0;
+        if(meshes) result->values["mesh_triangles"] = meshTriangles;
+      }
+
+    private:
+      static std::string meshWalkerName(CollisionProxy proxy) {
+        switch(proxy) {
+        case COLLISION_PROXY_HULLS: return "mesh_walker_hulls";
+        case COLLISION_PROXY_BOXES: return "mesh_walker_boxes";
+        case COLLISION_PROXY_CAPSULES: return "mesh_walker_capsules";
+        default: return "mesh_walker";
+        }
+      }
+
+      std::string meshFile(const char *part) const {
+        return tmpDir + "/mars_bench_" + part + ".bobj";
+      }
+
+      /** \brief writes the segment, thigh and shank meshes */
+      bool writeMeshes() {
+        // a tray: the bottom layer and a rim of two layers
+        const int segmentCells[3] = {8, 6, 3};
+        std::vector<bool> tray(8*6*3, false);
+        for(int i=0; i<8*6*3; ++i) {
+          int x = i % 8, y = (i / 8) % 6, z = i / 48;
+          tray[i] = z == 0 || x == 0 || x == 7 || y == 0 || y == 5;
+        }
+        utils::BinaryMeshSource segment, thigh, shank;
+        segment.name = "segment";
+        addVoxelSurface(tray, segmentCells, Vector(0.05, 0.05, 0.05), 3,
+                        &segment);
+        const int thighCells[3] = {1, 5, 1};
+        thigh.name = "thigh";
+        addVoxelSurface(std::vector<bool>(5, true), thighCells,
+                        Vector(0.05, 0.05, 0.05), 3, &thigh);
+        shank.name = "shank";
+        addCylinderSurface(0.025, 0.5, 16, 10, &shank);
+        // every segment has two thighs and two shanks
+        meshTriangles = 10 * (segment.indices.size() +
+                              2*thigh.indices.size() +
+                              2*shank.indices.size()) / 3;
+        return (writeMesh(meshFile("segment"), segment) &&
+                writeMesh(meshFile("thigh"), thigh) &&
+                writeMesh(meshFile("shank"), shank));
+      }
+
+      NodeId createBox(const std::string &name, const Vector &pos,
+                       const Vector &ext, double mass) {
+        return control->nodes->createPrimitiveNode(name, NODE_TYPE_BOX, true,
+                                                   pos, ext, mass);
+      }
+
+      /** \brief a box or, for the mesh walkers, the mesh \a part */
+      NodeId createPart(const std::string &name, const char *part,
+                        const Vector &pos, const Vector &ext, double mass) {
+        if(!meshes) return createBox(name, pos, ext, mass);
+        NodeData node;
+        node.initPrimitive(NODE_TYPE_MESH, ext, mass);
+        node.name = name;
+        node.filename = meshFile(part);
+        node.pos = pos;
+        node.movable = true;
+        node.collision_proxy = proxy;
+        return control->nodes->addNode(&node);
+      }
+
+      void addLegMotor(const std::string &name, NodeId node1, NodeId node2,
+                       const Vector &anchor, const Vector &axis,
+                       double phase) {
+        unsigned long joint = addHinge(control, name, node1, node2, anchor,
+                                       axis);
+        motors.push_back(addMotor(control, name, joint,
+                                  MOTOR_TYPE_POSITION));
+        phases.push_back(phase);
+      }
+
+      bool meshes;
+      CollisionProxy proxy;
+      std::string tmpDir;
+      unsigned long meshTriangles, contacts, measuredSteps;
+      std::vector<unsigned long> motors;
+      std::vector<double> phases;
+    };
+
+    /**
+     * A four wheeled rover drives a circle inside a ring of pillars and
+     * scans them with a 1000 ray laser scanner in every step.
+     */
+    /** \brief counts the points published by a scanning sensor */
+    class PointCounter : public PointCloudReceiver {
+    public:
+      PointCounter() : points(0) {}
+      void receivePoints(unsigned long sensorId, const float *points,
+                         const float *intensities, size_t numPoints,
+                         double time) {
+        (void)sensorId; (void)points; (void)intensities; (void)time;
+        this->points += numPoints;
+      }
+      unsigned long points;
+    };
+
+    /**
+     * A rover drives circles in a ring of pillars and scans them with a
+     * 1000 ray laser scanner. The high resolution variant carries a
+     * RotatingRaySensor with 32 lasers in 512 bands instead, which
+     * publishes every step's scan slice to a PointCloudReceiver like the
+     * point cloud visualization, and reports the published points per
+     * second of wall clock time.
+     */
+    class LidarRover : public SceneBenchmark {
+    public:
+      explicit LidarRover(bool highResolution)
+        : SceneBenchmark(highResolution ? "lidar_rover_hires" : "lidar_rover",
+                         highResolution ?
+                         "rover with a 32x512 ray rotating laser scanner" :
+                         "rover with a 1000 ray laser scanner"),
+          highResolution(highResolution), source(NULL) {}
+
+      bool build() {
+        const int numPillars = 60;
+        addGround(control, 50.0);
+        for(int i=0; i<numPillars; ++i) {
+          double a = i * 2*M_PI / numPillars;
+          control->nodes->createPrimitiveNode(indexedName("pillar", i),
+                                              NODE_TYPE_BOX, false,
+                                              Vector(8*cos(a), 8*sin(a), 1.0),
+                                              Vector(0.5, 0.5, 2.0));
+        }
+        NodeId chassis = addRover(control, Vector(0.0, 0.0, 0.15), NULL,
+                                  &wheels);
+        // different speeds on both sides drive a circle
+        for(size_t i=0; i<wheels.size(); ++i) {
+          control->motors->setMotorValue(wheels[i], (i % 2) ? 2.0 : 1.0);
+        }
+
+        configmaps::ConfigMap config;
+        config["name"] = "laser_scanner";
+        config["mapIndex"] = 0;
+        config["attached_node"] = chassis;
+        config["opening_width"] = 2*M_PI;
+        config["max_distance"] = 20.0;
+        config["draw_rays"] = false;
+        // every step with the default calc_ms
+        config["rate"] = 10;
+        if(!highResolution) {
+          config["type"] = "RaySensor";
+          config["width"] = 1000;
+          return control->sensors->createAndAddSensor(&config) != NULL;
+        }
+        config["type"] = "RotatingRaySensor";
+        config["bands"] = (int)bands;
+        config["lasers"] = (int)lasers;
+        // half of the lasers look down to the ground
+        config["opening_height"] = 40.0/180.0*M_PI;
+        config["vertical_offset"] = 0.0;
+        BaseSensor *sensor = control->sensors->createAndAddSensor(&config);
+        source = dynamic_cast<PointCloudSource*>(sensor);
+        if(!source) return false;
+        source->addPointCloudReceiver(&counter);
+        return true;
+      }
+
+      void startMeasurement() {
+        counter.points = 0;
+      }
+
+      void addValues(BenchResult *result) {
+        if(!highResolution) {
+          result->values["rays"] = 1000;
+          return;
+        }
+        result->values["rays"] = bands * lasers;
+        if(result->steps) {
+          result->values["points_per_step"] =
+            (double)counter.points / result->steps;
+        }
+        if(result->runMs > 0.0) {
+          result->values["points_per_second"] =
+            counter.points * 1000.0 / result->runMs;
+        }
+      }
+
+      void teardown() {
+        // the sensor is destroyed with the world
+        if(source) source->removePointCloudReceiver(&counter);
+        source = NULL;
+        SceneBenchmark::teardown();
+      }
+
+    private:
+      static const int bands = 512, lasers = 32;
+      bool highResolution;
+      std::vector<unsigned long> wheels;
+      PointCloudSource *source;
+      PointCounter counter;
+    };
+
+    class RubbleField : public SceneBenchmark {
+    public:
+      RubbleField() : SceneBenchmark("rubble_field",
+                                     "10000 boxes, spheres and capsules"),
+                      numObjects(0) {}
+
+      bool build() {
+        numObjects = buildRubbleField(control, 10000);
+        return true;
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["objects"] = numObjects;
+      }
+
+    private:
+      unsigned long numObjects;
+    };
+
+    /**
+     * 2000 objects of the rubble field settle with "Simulator/contact
+     * cache" enabled, so the pairs at rest are served from the cache. The
+     * cache counters of the measured steps are reported. addValues() then
+     * restores the state of the start of the measurement and repeats the
+     * steps without the cache.
+     */
+    class ContactCacheScene : public SceneBenchmark {
+    public:
+      ContactCacheScene()
+        : SceneBenchmark("contact_cache",
+                         "2000 settling objects with the contact cache"),
+          previousCache(false), measuredSteps(0), sum() {}
+
+      bool build() {
+        if(!control->cfg) return false;
+        control->cfg->getPropertyValue("Simulator", "contact cache", "value",
+                                       &previousCache);
+        setContactCache(true);
+        buildRubbleField(control, 2000);
+        return true;
+      }
+
+      void update(unsigned long index) {
+        (void)index;
+        addStats(&sum);
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        sum = ContactCacheStats();
+        measuredSteps = 0;
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["objects"] = 2000;
+        if(!measuredSteps) return;
+        unsigned long tested = sum.narrowPhaseCalls + sum.narrowPhaseSkipped;
+        result->values["narrow_phase_calls_per_step"] =
+          (double)sum.narrowPhaseCalls / measuredSteps;
+        result->values["narrow_phase_skipped_per_step"] =
+          (double)sum.narrowPhaseSkipped / measuredSteps;
+        result->values["cached_pairs_per_step"] =
+          (double)sum.cachedPairs / measuredSteps;
+        result->values["cache_hit_percent"] =
+          tested ? sum.narrowPhaseSkipped * 100.0 / tested : 0.0;
+        if(result->stepsPerSecond <= 0.0 ||
+           !control->sim->restoreSnapshot(snapshot)) {
+          return;
+        }
+
+        setContactCache(false);
+        ContactCacheStats uncached = ContactCacheStats();
+        double start = utils::getClockMs();
+        for(unsigned long i=0; i<result->steps; ++i) {
+          control->sim->step(true);
+          addStats(&uncached);
+        }
+        double ms = utils::getClockMs() - start;
+        if(ms <= 0.0) return;
+        double stepsPerSecond = result->steps * 1000.0 / ms;
+        result->values["narrow_phase_calls_per_step_without_cache"] =
+          (double)uncached.narrowPhaseCalls / result->steps;
+        result->values["steps_per_second_without_cache"] = stepsPerSecond;
+        result->values["speedup_cache"] =
+          result->stepsPerSecond / stepsPerSecond;
+      }
+
+      void teardown() {
+        if(control && control->cfg) setContactCache(previousCache);
+        SceneBenchmark::teardown();
+      }
+
+    private:
+      bool previousCache;
+      unsigned long measuredSteps;
+      ContactCacheStats sum;
+      std::vector<char> snapshot;
+
+      void setContactCache(bool enabled) {
+        control->cfg->setPropertyValue("Simulator", "contact cache", "value",
+                                       enabled);
+      }
+
+      /** \brief adds the counters of the last step to \a stats */
+      void addStats(ContactCacheStats *stats) {
+        ContactCacheStats last =
+          control->sim->getPhysics()->getContactCacheStats();
+        stats->broadphasePairs += last.broadphasePairs;
+        stats->narrowPhaseCalls += last.narrowPhaseCalls;
+        stats->narrowPhaseSkipped += last.narrowPhaseSkipped;
+        stats->cachedPairs += last.cachedPairs;
+        stats->contacts += last.contacts;
+      }
+    };
+
+    /**
+     * 10000 boxes resting on a grid around the rover of lidar_rover, which
+     * drives circles in a free area in the middle. The boxes may sleep
+     * ("Simulator/sleeping" and NodeData::sleep) and fall asleep during
+     * the warm up, the rover stays active. addValues() restores the state
+     * of the start of the measurement and repeats the steps without
+     * sleeping.
+     */
+    class SleepingField : public SceneBenchmark {
+    public:
+      SleepingField()
+        : SceneBenchmark("sleeping_field",
+                         "10000 resting boxes and a driving rover"),
+          previousSleeping(false), sleepingSum(0), measuredSteps(0),
+          numDynamic(0) {}
+
+      bool build() {
+        const unsigned long side = 100;
+        const double spacing = 1.0, edge = 0.4, freeRadius = 4.0;
+        unsigned long n = 0;
+        if(!control->cfg) return false;
+        control->cfg->getPropertyValue("Simulator", "sleeping", "value",
+                                       &previousSleeping);
+        setSleeping(true);
+        addGround(control, side*spacing + 10.0);
+        for(unsigned long i=0; n<numBoxes; ++i) {
+          Vector pos(((double)(i % side) - side*0.5) * spacing,
+                     ((double)(i / side) - side*0.5) * spacing, edge*0.5);
+          if(pos.x()*pos.x() + pos.y()*pos.y() < freeRadius*freeRadius) {
+            continue;
+          }
+          NodeData node;
+          node.initPrimitive(NODE_TYPE_BOX, Vector(edge, edge, edge), 1.0);
+          node.name = indexedName("box", n++);
+          node.pos = pos;
+          node.movable = true;
+          node.sleep = true;
+          // the boxes start at rest and fall asleep during the warm up
+          node.sleep_time = 0.2;
+          control->nodes->addNode(&node);
+        }
+        std::vector<unsigned long> motors;
+        addRover(control, Vector(0.0, -2.0, 0.15), NULL, &motors);
+        for(size_t i=0; i<motors.size(); ++i) {
+          control->motors->setMotorValue(motors[i], (i % 2) ? 2.0 : 1.0);
+        }
+        return true;
+      }
+
+      void update(unsigned long index) {
+        (void)index;
+        unsigned long numSleeping = 0;
+        control->nodes->getSleepingStats(&numSleeping, &numDynamic);
+        sleepingSum += numSleeping;
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        sleepingSum = measuredSteps = 0;
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["boxes"] = numBoxes;
+        result->values["dynamic_bodies"] = numDynamic;
+        if(!measuredSteps) return;
+        double sleeping = (double)sleepingSum / measuredSteps;
+        result->values["sleeping_bodies"] = sleeping;
+        result->values["sleeping_percent"] =
+          numDynamic ? sleeping * 100.0 / numDynamic : 0.0;
+        if(result->stepsPerSecond <= 0.0 ||
+           !control->sim->restoreSnapshot(snapshot)) {
+          return;
+        }
+
+        // wakes all bodies with the next step
+        setSleeping(false);
+        double start = utils::getClockMs();
+        for(unsigned long i=0; i<result->steps; ++i) {
+          control->sim->step(true);
+        }
+        double ms = utils::getClockMs() - start;
+        if(ms <= 0.0) return;
+        double stepsPerSecond = result->steps * 1000.0 / ms;
+        result->values["steps_per_second_without_sleeping"] = stepsPerSecond;
+        result->values["speedup_sleeping"] =
+          result->stepsPerSecond / stepsPerSecond;
+      }
+
+      void teardown() {
+        if(control && control->cfg) setSleeping(previousSleeping);
+        SceneBenchmark::teardown();
+      }
+
+    private:
+      static const unsigned long numBoxes = 10000;
+      bool previousSleeping;
+      unsigned long sleepingSum, measuredSteps, numDynamic;
+      std::vector<char> snapshot;
+
+      void setSleeping(bool enabled) {
+        control->cfg->setPropertyValue("Simulator", "sleeping", "value",
+                                       enabled);
+      }
+    };
+
+    class Terrain : public SceneBenchmark {
+    public:
+      Terrain() : SceneBenchmark("terrain",
+                                 "500 objects on a 257x257 height map") {}
+
+      bool build() {
+        const int resolution = 257;
+        const double size = 128.0, height = 4.0;
+        Random random(7);
+        terrainStruct terrain;
+        terrain.name = "terrain";
+        terrain.width = terrain.height = resolution;
+        terrain.targetWidth = terrain.targetHeight = size;
+        terrain.scale = height;
+        // freed by the SimNode of the terrain
+        terrain.pixelData = (double*)calloc(resolution*resolution,
+                                            sizeof(double));
+        for(int y=0; y<resolution; ++y) {
+          for(int x=0; x<resolution; ++x) {
+            double h = 0.5 + 0.25*sin(x*0.11) * cos(y*0.07) +
+              0.15*sin((x+y)*0.31) + random.uniform(-0.05, 0.05);
+            terrain.pixelData[y*resolution+x] = h * height;
+          }
+        }
+        control->nodes->addTerrain(&terrain);
+
+        for(int i=0; i<500; ++i) {
+          Vector pos(random.uniform(-size*0.4, size*0.4),
+                     random.uniform(-size*0.4, size*0.4),
+                     height*1.5 + random.uniform(0.0, 2.0));
+          double s = random.uniform(0.2, 0.6);
+          bool box = (i % 2) == 0;
+          control->nodes->createPrimitiveNode(
+            indexedName("object", i), box ? NODE_TYPE_BOX : NODE_TYPE_SPHERE,
+            true, pos, box ? Vector(s, s, s) : Vector(s*0.5, 0.0, 0.0), 1.0,
+            randomRotation(&random));
+        }
+        return true;
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["height_map_cells"] = 256*256;
+        result->values["objects"] = 500;
+      }
+
+    protected:
+      Terrain(const std::string &name, const std::string &description)
+        : SceneBenchmark(name, description) {}
+    };
+
+    /**
+     * The terrain scene with "Simulator/collision threads". The steps are
+     * measured with one thread; addValues() restores the state of the
+     * start of the measurement and repeats the steps with 2, 4, 8 and 16
+     * threads, up to the number of cores. The pairs of the height map are
+     * spread over the threads, thus nearly all pairs run in parallel.
+     */
+    class CollisionThreads : public Terrain {
+    public:
+      CollisionThreads()
+        : Terrain("collision_threads",
+                  "terrain, speedup per collision thread count"),
+          previousThreads(1) {}
+
+      bool build() {
+        if(!control->cfg) return false;
+        control->cfg->getPropertyValue("Simulator", "collision threads",
+                                       "value", &previousThreads);
+        setCollisionThreads(1);
+        return Terrain::build();
+      }
+
+      void startMeasurement() {
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        const int maxThreads = 16;
+        int cores = 1;
+#ifndef WIN32
+        cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        Terrain::addValues(result);
+        result->values["cores"] = cores;
+        if(!result->steps || result->stepsPerSecond <= 0.0) return;
+        for(int threads=2; threads<=maxThreads && threads<=cores; threads*=2) {
+          if(!control->sim->restoreSnapshot(snapshot)) return;
+          setCollisionThreads(threads);
+          double start = utils::getClockMs();
+          for(unsigned long i=0; i<result->steps; ++i) {
+            control->sim->step(true);
+          }
+          double ms = utils::getClockMs() - start;
+          if(ms <= 0.0) continue;
+          double stepsPerSecond = result->steps * 1000.0 / ms;
+          result->values[indexedName("steps_per_second_threads", threads)] =
+            stepsPerSecond;
+          result->values[indexedName("speedup_threads", threads)] =
+            stepsPerSecond / result->stepsPerSecond;
+        }
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(control && control->cfg) setCollisionThreads(previousThreads);
+      }
+
+    private:
+      int previousThreads;
+      std::vector<char> snapshot;
+
+      void setCollisionThreads(int threads) {
+        control->cfg->setPropertyValue("Simulator", "collision threads",
+                                       "value", threads);
+      }
+    };
+
+    /**
+     * The rover of lidar_rover drives circles over soft soil. Every step
+     * the soil under each wheel is pressed a little below the wheel until
+     * the rut is maxSinkage deep. The height map is shared by the physics
+     * and the graphics, so the step includes the heightfield refit of the
+     * changed tiles.
+     */
+    class SoftSoil : public SceneBenchmark {
+    public:
+      SoftSoil() : SceneBenchmark("soft_soil",
+                                  "rover leaving ruts in soft soil"),
+                   heightMap(NULL), deformations(0), changedTiles(0),
+                   measuredSteps(0) {}
+
+      bool build() {
+        Random random(11);
+        terrainStruct terrain;
+        terrain.name = "soil";
+        terrain.width = terrain.height = resolution;
+        terrain.targetWidth = terrain.targetHeight = size;
+        terrain.scale = 1.0;
+        // freed by the SimNode of the terrain
+        terrain.pixelData = (double*)calloc(resolution*resolution,
+                                            sizeof(double));
+        double step = size / (resolution-1);
+        for(int y=0; y<resolution; ++y) {
+          for(int x=0; x<resolution; ++x) {
+            terrain.pixelData[y*resolution+x] =
+              soilHeight(x*step - size*0.5, y*step - size*0.5) +
+              random.uniform(-0.002, 0.002);
+          }
+        }
+        NodeId id = control->nodes->addTerrain(&terrain);
+        if(!id) return false;
+        // the terrain is centered at the origin
+        heightMap = control->nodes->getFullNode(id).terrain->heightMap;
+        if(!heightMap) return false;
+
+        addRover(control, Vector(0.0, 0.0, 0.35), &wheelNodes, &wheels);
+        for(size_t i=0; i<wheels.size(); ++i) {
+          control->motors->setMotorValue(wheels[i], (i % 2) ? 3.0 : 2.0);
+        }
+        return true;
+      }
+
+      void update(unsigned long index) {
+        (void)index;
+        unsigned long version = heightMap->getVersion();
+        for(size_t i=0; i<wheelNodes.size(); ++i) {
+          Vector p = control->nodes->getPosition(wheelNodes[i]);
+          if(p.z() - wheelRadius < soilHeight(p.x(), p.y()) - maxSinkage) {
+            continue;
+          }
+          if(heightMap->deformSphere(p.x() + size*0.5, p.y() + size*0.5,
+                                     p.z() - sinkage, wheelRadius)) {
+            ++deformations;
+          }
+        }
+        std::vector<int> tiles;
+        heightMap->lockForRead();
+        heightMap->getChangedTiles(version, &tiles);
+        heightMap->unlock();
+        changedTiles += tiles.size();
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        deformations = changedTiles = measuredSteps = 0;
+      }
+
+      void addValues(BenchResult *result) {
+        double step = size / (resolution-1);
+        double rutDepth = 0.0;
+        heightMap->lockForRead();
+        for(int y=0; y<resolution; ++y) {
+          for(int x=0; x<resolution; ++x) {
+            double depth = soilHeight(x*step - size*0.5, y*step - size*0.5) -
+              heightMap->getHeight(x, y);
+            if(depth > rutDepth) rutDepth = depth;
+          }
+        }
+        heightMap->unlock();
+        result->values["height_map_cells"] = (resolution-1)*(resolution-1);
+        result->values["deformations"] = deformations;
+        result->values["changed_tiles_per_step"] =
+          measuredSteps ? (double)changedTiles / measuredSteps : 0.0;
+        result->values["rut_depth"] = rutDepth;
+      }
+
+    private:
+      static const int resolution = 257;
+      static const double size, wheelRadius, sinkage, maxSinkage;
+
+      static double soilHeight(double x, double y) {
+        return 0.1 + 0.05*sin(x*0.7) * cos(y*0.5);
+      }
+
+      utils::TiledHeightMap *heightMap;
+      std::vector<NodeId> wheelNodes;
+      std::vector<unsigned long> wheels;
+      unsigned long deformations, changedTiles, measuredSteps;
+    };
+
+    const double SoftSoil::size = 16.0;
+    const double SoftSoil::wheelRadius = 0.15;
+    const double SoftSoil::sinkage = 0.005;
+    const double SoftSoil::maxSinkage = 0.05;
+
+    /**
+     * 500 boxes and spheres fall on a field of 5000 static box shaped
+     * meshes. With \a baked set, the meshes are merged into one, so the
+     * broadphase only sees the falling objects and the merged mesh. With
+     * \a boxes set, the obstacles are static boxes, which baking moves
+     * into one sub-space instead (see PhysicsInterface::bake_static_geoms).
+     */
+    class ObstacleField : public SceneBenchmark {
+    public:
+      ObstacleField(bool baked, bool boxes=false)
+        : SceneBenchmark(fieldName(baked, boxes),
+                         std::string(baked ? "500 objects on 5000 baked " :
+                                     "500 objects on 5000 ") +
+                         (boxes ? "static boxes" : "static meshes")),
+          baked(baked), boxes(boxes), previousBaking(false),
+          broadphasePairs(0), measuredSteps(0) {}
+
+      bool setup(BenchContext *context) {
+        tmpDir = context->tmpDir;
+        return SceneBenchmark::setup(context);
+      }
+
+      bool build() {
+        previousBaking = setStaticBaking(control, baked);
+        unsigned long side = (unsigned long)ceil(sqrt(5000.0));
+        if(!buildObstacleField(control, 5000, boxes ? std::string() :
+                               tmpDir + "/mars_bench_obstacle.bobj")) {
+          return false;
+        }
+        addFallingObjects(control, side * 1.5, 500);
+        return true;
+      }
+
+      void update(unsigned long index) {
+        (void)index;
+        broadphasePairs +=
+          control->sim->getPhysics()->getContactCacheStats().broadphasePairs;
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        broadphasePairs = measuredSteps = 0;
+      }
+
+      void addValues(BenchResult *result) {
+        result->values[boxes ? "static_boxes" : "static_meshes"] = 5000;
+        result->values["objects"] = 500;
+        result->values["broadphase_pairs_per_step"] =
+          measuredSteps ? (double)broadphasePairs / measuredSteps : 0.0;
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(control) setStaticBaking(control, previousBaking);
+      }
+
+    private:
+      bool baked, boxes, previousBaking;
+      std::string tmpDir;
+      unsigned long broadphasePairs, measuredSteps;
+
+      static std::string fieldName(bool baked, bool boxes) {
+        std::string name = boxes ? "obstacle_boxes" : "obstacle_field";
+        return baked ? name + "_baked" : name;
+      }
+    };
+
+    /**
+     * One scene stepped with each broadphase of "Simulator/broadphase".
+     * The steps are measured with the hash space; addValues() restores
+     * the state of the start of the measurement and repeats the steps with
+     * the sweep and prune space, the quadtree and the simple space. The
+     * simple space tests all pairs and is left out for the obstacles.
+     */
+    class BroadphaseMatrix : public SceneBenchmark {
+    public:
+      enum Scene {BOX_STACKS, RUBBLE, OBSTACLES};
+
+      explicit BroadphaseMatrix(Scene scene)
+        : SceneBenchmark(sceneName(scene),
+                         "a scene stepped with each broadphase"),
+          scene(scene), broadphasePairs(0), measuredSteps(0) {}
+
+      bool build() {
+        if(!control->cfg) return false;
+        control->cfg->getPropertyValue("Simulator", "broadphase", "value",
+                                       &previousBroadphase);
+        setBroadphase("hash");
+        switch(scene) {
+        case BOX_STACKS:
+          buildBoxStacks(control);
+          break;
+        case RUBBLE:
+          buildRubbleField(control, 2000);
+          break;
+        default:
+          buildObstacleField(control, 5000);
+          addFallingObjects(control, ceil(sqrt(5000.0)) * 1.5, 500);
+        }
+        return true;
+      }
+
+      void update(unsigned long index) {
+        (void)index;
+        broadphasePairs += getBroadphasePairs();
+        ++measuredSteps;
+      }
+
+      void startMeasurement() {
+        broadphasePairs = measuredSteps = 0;
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        const char *broadphases[] = {"sap", "quadtree", "simple"};
+        if(!measuredSteps) return;
+        result->values["pairs_per_step_hash"] =
+          (double)broadphasePairs / measuredSteps;
+        if(result->stepsPerSecond <= 0.0) return;
+        for(int b=0; b<3; ++b) {
+          std::string name = broadphases[b];
+          if(scene == OBSTACLES && name == "simple") continue;
+          if(!control->sim->restoreSnapshot(snapshot)) return;
+          setBroadphase(name);
+          unsigned long pairs = 0;
+          double start = utils::getClockMs();
+          for(unsigned long i=0; i<result->steps; ++i) {
+            control->sim->step(true);
+            pairs += getBroadphasePairs();
+          }
+          double ms = utils::getClockMs() - start;
+          if(ms <= 0.0) continue;
+          double stepsPerSecond = result->steps * 1000.0 / ms;
+          result->values["pairs_per_step_" + name] =
+            (double)pairs / result->steps;
+          result->values["steps_per_second_" + name] = stepsPerSecond;
+          result->values["speedup_" + name] =
+            stepsPerSecond / result->stepsPerSecond;
+        }
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(control && control->cfg && !previousBroadphase.empty()) {
+          setBroadphase(previousBroadphase);
+        }
+      }
+
+    private:
+      Scene scene;
+      std::string previousBroadphase;
+      unsigned long broadphasePairs, measuredSteps;
+      std::vector<char> snapshot;
+
+      static std::string sceneName(Scene scene) {
+        switch(scene) {
+        case BOX_STACKS: return "broadphase_box_stacks";
+        case RUBBLE: return "broadphase_rubble";
+        default: return "broadphase_obstacles";
+        }
+      }
+
+      void setBroadphase(const std::string &name) {
+        control->cfg->setPropertyValue("Simulator", "broadphase", "value",
+                                       name);
+      }
+
+      unsigned long getBroadphasePairs() {
+        ContactCacheStats stats =
+          control->sim->getPhysics()->getContactCacheStats();
+        return stats.broadphasePairs;
+      }
+    };
+
+    /**
+     * 32 rovers drive circles on a common ground. The static ground does
+     * not connect the rovers, so the world consists of 32 islands. The
+     * steps are measured with one island thread; addValues() then repeats
+     * the measurement for 2, 4, 8, 16 and 32 threads, up to the number
+     * of cores, and reports the speedup over one thread.
+     */
+    class IslandRovers : public SceneBenchmark {
+    public:
+      IslandRovers()
+        : SceneBenchmark("rovers_islands",
+                         "32 rovers, speedup per island thread count"),
+          previousFastStep(false), previousThreads(1) {}
+
+      bool build() {
+        const int numRovers = 32, columns = 8;
+        const double spacing = 4.0;
+        if(!control->cfg) return false;
+        // the islands are only solved in parallel by dWorldStep
+        control->cfg->getPropertyValue("Simulator", "faststep", "value",
+                                       &previousFastStep);
+        control->cfg->getPropertyValue("Simulator", "island threads",
+                                       "value", &previousThreads);
+        control->cfg->setPropertyValue("Simulator", "faststep", "value",
+                                       false);
+        setIslandThreads(1);
+
+        addGround(control, 50.0);
+        std::vector<unsigned long> motors;
+        for(int r=0; r<numRovers; ++r) {
+          Vector pos(((r % columns) - columns*0.5 + 0.5) * spacing,
+                     ((r / columns) - numRovers/columns*0.5 + 0.5) * spacing,
+                     0.15);
+          addRover(control, pos, NULL, &motors);
+          // different speeds on both sides drive a circle of about 2.4 m
+          for(size_t i=0; i<motors.size(); ++i) {
+            control->motors->setMotorValue(motors[i], (i % 2) ? 2.0 : 1.0);
+          }
+        }
+        return true;
+      }
+
+      void addValues(BenchResult *result) {
+        const int maxThreads = 32;
+        int cores = 1;
+#ifndef WIN32
+        cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        result->values["rovers"] = 32;
+        result->values["cores"] = cores;
+        if(!result->steps || result->stepsPerSecond <= 0.0) return;
+        for(int threads=2; threads<=maxThreads && threads<=cores; threads*=2) {
+          setIslandThreads(threads);
+          // the thread pool is created by the first step
+          control->sim->step(true);
+          double start = utils::getClockMs();
+          for(unsigned long i=0; i<result->steps; ++i) {
+            control->sim->step(true);
+          }
+          double ms = utils::getClockMs() - start;
+          if(ms <= 0.0) continue;
+          double stepsPerSecond = result->steps * 1000.0 / ms;
+          result->values[indexedName("steps_per_second_threads", threads)] =
+            stepsPerSecond;
+          result->values[indexedName("speedup_threads", threads)] =
+            stepsPerSecond / result->stepsPerSecond;
+        }
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(control && control->cfg) {
+          control->cfg->setPropertyValue("Simulator", "faststep", "value",
+                                         previousFastStep);
+          setIslandThreads(previousThreads);
+        }
+      }
+
+    private:
+      bool previousFastStep;
+      int previousThreads;
+
+      void setIslandThreads(int threads) {
+        control->cfg->setPropertyValue("Simulator", "island threads",
+                                       "value", threads);
+      }
+    };
+
+    /**
+     * 1000 modules on a grid, each an entity with a male and a female
+     * connector, with "Connectors/autoconnect" enabled. The modules are
+     * static and too far apart to mate, thus every step runs the full
+     * connection check of the connectors plugin on 1000 free connector
+     * pairs and the step time is dominated by that check.
+     */
+    class ConnectorModules : public SceneBenchmark {
+    public:
+      ConnectorModules()
+        : SceneBenchmark("connectors",
+                         "auto-connect check of 1000 modules"),
+          libManager(NULL), loaded(false), previousAutoconnect(false) {}
+
+      bool setup(BenchContext *context) {
+        libManager = context->libManager;
+        control = context->control;
+        if(!control->cfg || !control->entities) return false;
+        if(!loaded) {
+          // the plugin registers itself and is initialized by the next
+          // finishedDraw; it stays loaded until the benchmark ends
+          libManager->loadLibrary("connectors", NULL, true);
+          if(!libManager->getLibrary("connectors")) return false;
+          libManager->releaseLibrary("connectors");
+          loaded = true;
+        }
+        control->sim->finishedDraw();
+        control->cfg->getOrCreateProperty("Connectors", "autoconnect", false);
+        control->cfg->getPropertyValue("Connectors", "autoconnect", "value",
+                                       &previousAutoconnect);
+        return SceneBenchmark::setup(context);
+      }
+
+      bool build() {
+        const unsigned long columns = 40;
+        const double spacing = 0.5;
+        for(unsigned long i=0; i<numModules; ++i) {
+          std::string name = indexedName("module", i);
+          Vector pos((i % columns) * spacing, (i / columns) * spacing, 0.15);
+          control->nodes->createPrimitiveNode(name, NODE_TYPE_BOX, false,
+                                              pos, Vector(0.3, 0.3, 0.3));
+
+          // the connectors plugin reads the connectors from the entity
+          // configuration when the entity is added
+          configmaps::ConfigMap type, male, female, entity;
+          type["name"] = std::string("bench_connector");
+          type["distance"] = 0.1;
+          type["angle"] = 0.5;
+          male["name"] = name + "_male";
+          male["link"] = name;
+          male["gender"] = std::string("male");
+          male["type"] = std::string("bench_connector");
+          female = male;
+          female["name"] = name + "_female";
+          female["gender"] = std::string("female");
+          entity["name"] = name;
+          entity["connectors"]["types"].push_back(type);
+          entity["connectors"]["connectors"].push_back(male);
+          entity["connectors"]["connectors"].push_back(female);
+          control->entities->addEntity(new sim::SimEntity(control, entity));
+        }
+        control->cfg->setPropertyValue("Connectors", "autoconnect", "value",
+                                       true);
+        return true;
+      }
+
+      void addValues(BenchResult *result) {
+        result->values["modules"] = numModules;
+        result->values["connectors"] = numModules * 2;
+      }
+
+      void teardown() {
+        if(control && control->cfg) {
+          control->cfg->setPropertyValue("Connectors", "autoconnect", "value",
+                                         previousAutoconnect);
+        }
+        SceneBenchmark::teardown();
+      }
+
+    private:
+      static const unsigned long numModules = 1000;
+      lib_manager::LibManager *libManager;
+      bool loaded, previousAutoconnect;
+    };
+
+    /**
+     * \brief records the wall clock of the plugin stage of the last step,
+     *        shortly before the step hands the frame to the drawing thread
+     */
+    class StepClock : public PluginInterface {
+    public:
+      explicit StepClock(ControlCenter *control)
+        : PluginInterface(control), lastStepMs(0.0) {}
+
+      void init() {}
+      void reset() {}
+      void update(sReal time_ms) {
+        (void)time_ms;
+        lastStepMs = utils::getClockMs();
+      }
+
+      volatile double lastStepMs;
+    };
+
+    /**
+     * The box stacks with tracing. The steps are measured without tracing;
+     * addValues() restores the state of the start of the measurement and
+     * repeats the steps with tracing and once more without it. The box
+     * stacks have cheap steps, thus the spans of a step weigh more than in
+     * larger scenes. The difference of the two runs without tracing is
+     * reported as the noise of the measurement.
+     */
+    class TraceOverhead : public SceneBenchmark {
+    public:
+      TraceOverhead()
+        : SceneBenchmark("trace_overhead",
+                         "box stacks, step time with and without tracing"),
+          wasTracing(false) {}
+
+      bool build() {
+        // switched directly, "Simulator/trace" would write a file each run
+        wasTracing = utils::Trace::isEnabled();
+        utils::Trace::setEnabled(false);
+        buildBoxStacks(control);
+        return true;
+      }
+
+      void startMeasurement() {
+        control->sim->saveSnapshot(&snapshot);
+      }
+
+      void addValues(BenchResult *result) {
+        if(!result->steps || result->stepsPerSecond <= 0.0) return;
+        double traced = run(result->steps, true);
+        double untraced = run(result->steps, false);
+        if(traced <= 0.0 || untraced <= 0.0) return;
+        result->values["steps_per_second_traced"] = traced;
+        result->values["overhead_percent"] =
+          (result->stepsPerSecond / traced - 1.0) * 100.0;
+        result->values["noise_percent"] =
+          fabs(result->stepsPerSecond / untraced - 1.0) * 100.0;
+      }
+
+      void teardown() {
+        SceneBenchmark::teardown();
+        if(!wasTracing) utils::Trace::clear();
+        utils::Trace::setEnabled(wasTracing);
+      }
+
+    private:
+      bool wasTracing;
+      std::vector<char> snapshot;
+
+      /** \return the steps/s from the snapshot or 0 on failure */
+      double run(unsigned long steps, bool trace) {
+        if(!control->sim->restoreSnapshot(snapshot)) return 0.0;
+        utils::Trace::setEnabled(trace);
+        double start = utils::getClockMs();
+        for(unsigned long i=0; i<steps; ++i) {
+          control->sim->step(true);
+        }
+        double ms = utils::getClockMs() - start;
+        utils::Trace::setEnabled(false);
+        return ms > 0.0 ? steps * 1000.0 / ms : 0.0;
+      }
+    };
+
+    /**
+     * The box stacks stepped by the physics thread with "sync gui"
+     * enabled and one step per frame. step() plays the drawing thread: it
+     * hands the frame back with finishedDraw() and waits for the next one
+     * with waitForDraw(). The latency is taken from the plugin stage of
+     * the step to the return of waitForDraw(). addValues() then pauses the
+     * simulation and measures the CPU usage of the process while the
+     * physics thread is idle and the drawing thread waits for frames.
+     *
+     * The physics thread can not be restarted after exitMars(), thus the
+     * benchmark runs once and after the other scene benchmarks.
+     */
+    class FrameHandoff : public SceneBenchmark {
+    public:
+      FrameHandoff()
+        : SceneBenchmark("frame_handoff",
+                         "step to frame latency and idle CPU usage"),
+          clock(NULL), thread(NULL), used(false), frames(0),
+          missedFrames(0), latencySum(0.0), latencyMax(0.0),
+          previousSync(false), previousSyncTime(40.0) {}
+
+      bool setup(BenchContext *context) {
+        control = context->control;
+        thread = dynamic_cast<utils::Thread*>(control->sim);
+        if(!thread || used || !control->cfg) return false;
+        used = true;
+        return SceneBenchmark::setup(context);
+      }
+
+      bool build() {
+        sReal calcMs = 10.0;
+        buildBoxStacks(control);
+        control->cfg->getPropertyValue("Simulator", "calc_ms", "value",
+                                       &calcMs);
+        control->cfg->getPropertyValue("Simulator", "sync gui", "value",
+                                       &previousSync);
+        control->cfg->getPropertyValue("Simulator", "sync time", "value",
+                                       &previousSyncTime);
+        // one step per frame
+        control->cfg->setPropertyValue("Simulator", "sync time", "value",
+                                       calcMs);
+        control->cfg->setPropertyValue("Simulator", "sync gui", "value",
+                                       true);
+
+        clock = new StepClock(control);
+        pluginStruct plugin;
+        plugin.name = "bench_step_clock";
+        plugin.p_interface = clock;
+        plugin.p_destroy = NULL;
+        plugin.timer = plugin.timer_gui = 0.0;
+        plugin.t_count = plugin.t_count_gui = 0;
+        control->sim->addPlugin(plugin);
+        // initializes the plugin; the first frame is handed out by step()
+        control->sim->finishedDraw();
+        thread->start();
+        control->sim->StartSimulation();
+        return true;
+      }
+
+      void step(unsigned long index) {
+        (void)index;
+        control->sim->finishedDraw();
+        if(!control->sim->waitForDraw(1000)) {
+          ++missedFrames;
+          return;
+        }
+        double latency = utils::getClockMs() - clock->lastStepMs;
+        latencySum += latency;
+        latencyMax = std::max(latencyMax, latency);
+        ++frames;
+      }
+
+      void startMeasurement() {
+        frames = missedFrames = 0;
+        latencySum = latencyMax = 0.0;
+      }
+
+      void addValues(BenchResult *result) {
+        const double idleMs = 1000.0;
+        if(frames) {
+          result->values["latency_avg_ms"] = latencySum / frames;
+          result->values["latency_max_ms"] = latencyMax;
+        }
+        result->values["missed_frames"] = missedFrames;
+
+        control->sim->StopSimulation();
+        while(control->sim->isSimRunning()) {
+          utils::msleep(1);
+        }
+        // takes the frame back, so waitForDraw blocks until its timeout
+        // like the main loop without Qt does while the simulation is paused
+        control->sim->finishedDraw();
+        double cpuStart = getCpuTimeMs();
+        double start = utils::getClockMs();
+        while(utils::getClockMs() - start < idleMs) {
+          control->sim->waitForDraw(100);
+        }
+        double wallMs = utils::getClockMs() - start;
+        double cpuMs = getCpuTimeMs() - cpuStart;
+        if(cpuStart >= 0.0 && wallMs > 0.0) {
+          result->values["idle_cpu_percent"] = cpuMs * 100.0 / wallMs;
+        }
+      }
+
+      void teardown() {
+        if(thread && thread->isRunning()) {
+          control->sim->exitMars();
+        }
+        if(control && control->cfg && clock) {
+          control->cfg->setPropertyValue("Simulator", "sync gui", "value",
+                                         previousSync);
+          control->cfg->setPropertyValue("Simulator", "sync time", "value",
+                                         previousSyncTime);
+        }
+        if(clock) {
+          control->sim->removePlugin(clock);
+          delete clock;
+          clock = NULL;
+        }
+        SceneBenchmark::teardown();
+      }
+
+    private:
+      StepClock *clock;
+      utils::Thread *thread;
+      bool used;
+      unsigned long frames, missedFrames;
+      double latencySum, latencyMax;
+      bool previousSync;
+      sReal previousSyncTime;
+    };
+
+    void createSceneBenchmarks(std::vector<Benchmark*> *benchmarks) {
+      benchmarks->push_back(new BoxStacks());
+      benchmarks->push_back(new Walker());
+      benchmarks->push_back(new Walker(COLLISION_PROXY_NONE));
+      benchmarks->push_back(new Walker(COLLISION_PROXY_HULLS));
+      benchmarks->push_back(new Walker(COLLISION_PROXY_BOXES));
+      benchmarks->push_back(new LidarRover(false));
+      benchmarks->push_back(new LidarRover(true));
+      benchmarks->push_back(new RubbleField());
+      benchmarks->push_back(new ContactCacheScene());
+      benchmarks->push_back(new SleepingField());
+      benchmarks->push_back(new Terrain());
+      benchmarks->push_back(new CollisionThreads());
+      benchmarks->push_back(new SoftSoil());
+      benchmarks->push_back(new ObstacleField(false));
+      benchmarks->push_back(new ObstacleField(true));
+      benchmarks->push_back(new ObstacleField(false, true));
+      benchmarks->push_back(new ObstacleField(true, true));
+      benchmarks->push_back(new BroadphaseMatrix(BroadphaseMatrix::BOX_STACKS));
+      benchmarks->push_back(new BroadphaseMatrix(BroadphaseMatrix::RUBBLE));
+      benchmarks->push_back(new BroadphaseMatrix(BroadphaseMatrix::OBSTACLES));
+      benchmarks->push_back(new IslandRovers());
+      benchmarks->push_back(new ConnectorModules());
+      benchmarks->push_back(new TraceOverhead());
+      benchmarks->push_back(new FrameHandoff());
+    }
+
+  } // end of namespace bench
+} // end of namespace mars
@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file SceneBenchmarks.h
+ * \brief Generated scenes that are stepped by mars_bench.
+ *
+ * The scenes are built from primitives with a fixed random seed, so every
+ * run simulates the same scene:
+ *  - box_stacks: 20 stacks of 10 boxes
+ *  - walker: a walker with 60 position controlled hinge joints
+ *  - mesh_walker: the walker built from concave and finely tessellated
+ *    meshes that collide as trimeshes
+ *  - mesh_walker_hulls, mesh_walker_boxes: the same with the meshes
+ *    replaced by convex hulls or fitted boxes (NodeData::collision_proxy)
+ *  - lidar_rover: a four wheeled rover with a 1000 ray laser scanner
+ *  - lidar_rover_hires: the same with a rotating scanner of 32x512 rays
+ *    whose points are streamed to a point cloud receiver; points/s
+ *  - rubble_field: 10000 boxes, spheres and capsules
+ *  - contact_cache: 2000 objects of the rubble field settling with the
+ *    contact cache; cache hits and the speedup over a run without it
+ *  - sleeping_field: 10000 boxes at rest that fall asleep and a rover
+ *    driving between them; sleeping bodies and the speedup of sleeping
+ *  - terrain: 500 objects dropped on a 257x257 height map
+ *  - collision_threads: the terrain measured with 1 to 16 collision
+ *    threads
+ *  - soft_soil: a four wheeled rover leaving ruts in a deformable height map
+ *  - obstacle_field: 500 objects falling on 5000 static box shaped meshes
+ *  - obstacle_field_baked: the same with the static meshes baked into one
+ *    collision mesh
+ *  - obstacle_boxes, obstacle_boxes_baked: the same on 5000 static boxes;
+ *    baking groups them in one sub-space
+ *  - broadphase_box_stacks, broadphase_rubble, broadphase_obstacles: the
+ *    box stacks, 2000 objects of the rubble field and 500 objects on 5000
+ *    static boxes, each stepped with the hash, sweep and prune, quadtree
+ *    and (but for the obstacles) simple broadphase; pairs and steps/s per
+ *    broadphase
+ *  - rovers_islands: 32 rovers, measured with 1 to 32 island threads
+ *  - connectors: the auto-connect check of the connectors plugin on 1000
+ *    modules that are too far apart to mate
+ *  - trace_overhead: the box stacks with and without tracing; the
+ *    overhead of tracing and the noise of the measurement
+ *  - frame_handoff: the box stacks stepped by the physics thread in sync
+ *    with a drawing loop; step to frame latency and idle CPU usage
+ */
+
+#ifndef MARS_BENCH_SCENE_BENCHMARKS_H
+#define MARS_BENCH_SCENE_BENCHMARKS_H
+
+#ifdef _PRINT_HEADER_
+  #warning "SceneBenchmarks.h"
+#endif
+
+#include "Benchmark.h"
+
+#include <mars/interfaces/MARSDefs.h>
+
+namespace mars {
+  namespace bench {
+
+    /** \brief a deterministic random number generator for the scenes */
+    class Random {
+    public:
+      explicit Random(unsigned long seed=1) : state(seed) {}
+      /** \return a value in [min, max) */
+      double uniform(double min, double max);
+
+    private:
+      unsigned long state;
+    };
+
+    /**
+     * \brief clears the world before the scene is built and after the
+     *        benchmark.
+     */
+    class SceneBenchmark : public Benchmark {
+    public:
+      SceneBenchmark(const std::string &name, const std::string &description)
+        : Benchmark(name, description), control(NULL) {}
+
+      bool setup(BenchContext *context);
+      void step(unsigned long index);
+      void teardown();
+
+    protected:
+      virtual bool build() = 0;
+      /** \brief called before each step, e.g. to set motor values */
+      virtual void update(unsigned long index) {(void)index;}
+
+      interfaces::ControlCenter *control;
+    }; // end of class SceneBenchmark
+
+    // the scene builders are shared with the micro benchmarks
+    interfaces::NodeId addGround(interfaces::ControlCenter *control,
+                                 double size);
+    unsigned long buildBoxStacks(interfaces::ControlCenter *control);
+    unsigned long buildRubbleField(interfaces::ControlCenter *control,
+                                   unsigned long numObjects);
+    /**
+     * \brief adds static boxes of 0.2 to 1.5 m on a grid of 1.5 m. If
+     *        \a meshFile is given, a cube mesh is written to it and the
+     *        obstacles are mesh nodes of that cube.
+     * \return The number of obstacles or 0 if the mesh was not written.
+     */
+    unsigned long buildObstacleField(interfaces::ControlCenter *control,
+                                     unsigned long numObstacles,
+                                     const std::string &meshFile =
+                                     std::string());
+    /**
+     * \brief sets "Simulator/bake static geometry".
+     * \return The previous value.
+     */
+    bool setStaticBaking(interfaces::ControlCenter *control, bool bake);
+
+    void createSceneBenchmarks(std::vector<Benchmark*> *benchmarks);
+
+  } // end of namespace bench
+} // end of namespace mars
+
+#endif // MARS_BENCH_SCENE_BENCHMARKS_H
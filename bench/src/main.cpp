@@ -0,0 +1,344 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file main.cpp
+ * \brief mars_bench: runs the generated benchmark scenes without the gui
+ *        and reports the results as JSON. mars_graphics is only loaded
+ *        with --graphics.
+ *
+ *   mars_bench -o current.json
+ *   mars_bench -b walker,terrain -n 2000 -B baseline.json
+ *   mars_bench -S "Simulator/contact cache=true" -B current.json
+ *   mars_bench -b walker -T walker_trace.json
+ *   mars_bench -b episodes_snapshot,episodes_reset,connectors
+ *   mars_bench -b rovers_islands,frame_handoff,mesh_load
+ *   mars_bench -g -b instancing,shadow_terrain
+ *
+ * The benchmarks in the order they run; "mars_bench -l" lists them with
+ * a short description:
+ *  - scenes (SceneBenchmarks.h): box_stacks, walker, mesh_walker,
+ *    mesh_walker_hulls, mesh_walker_boxes, lidar_rover, lidar_rover_hires,
+ *    rubble_field, contact_cache, sleeping_field, terrain,
+ *    collision_threads, soft_soil, obstacle_field, obstacle_field_baked,
+ *    obstacle_boxes, obstacle_boxes_baked,
+ *    broadphase_box_stacks, broadphase_rubble, broadphase_obstacles,
+ *    rovers_islands, connectors, trace_overhead, frame_handoff
+ *  - components (MicroBenchmarks.h): data_broker, data_broker_recorder,
+ *    data_broker_bridge, snapshot, episodes_snapshot, episodes_reset,
+ *    node_lookup, mesh_lod, mesh_load, ray_cast, ray_cast_baked, capture
+ *  - graphics (GraphicsBenchmarks.h): instancing, shadow_terrain
+ *
+ * data_broker_recorder, data_broker_bridge, capture and the graphics
+ * benchmarks are only built if their libraries are installed. The
+ * graphics benchmarks need --graphics and a display and are skipped
+ * otherwise.
+ *
+ * The exit code is 1 if a result is worse than the baseline by more than
+ * the tolerance and 2 if the benchmark could not be run.
+ */
+
+#include "Benchmark.h"
+#include "BenchReport.h"
+
+#include <lib_manager/LibManager.hpp>
+#include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/utils/misc.h>
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace mars;
+using namespace mars::bench;
+
+struct Options {
+  Options() : configDir("."), warmUp(100), steps(1000), tolerance(10.0),
+              list(false), graphics(false) {}
+
+  std::string configDir;
+  std::vector<std::string> benchmarks;
+  std::vector<std::string> overrides;
+  std::string output, baseline, trace;
+  unsigned long warmUp, steps;
+  double tolerance;
+  bool list, graphics;
+};
+
+static void printUsage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  -b, --bench NAME[,NAME]  run only the given benchmarks\n"
+          "  -l, --list               list the benchmarks\n"
+          "  -n, --steps N            measured steps per benchmark (1000)\n"
+          "  -w, --warm-up N          steps before the measurement (100)\n"
+          "  -o, --output FILE        write the JSON report to FILE\n"
+          "                           instead of stdout\n"
+          "  -B, --baseline FILE      compare with a previous report\n"
+          "  -t, --tolerance PERCENT  allowed change against the\n"
+          "                           baseline (10)\n"
+          "  -S, --set GROUP/NAME=VALUE\n"
+          "                           set a cfg_manager property, e.g.\n"
+          "                           \"Simulator/broadphase=sap\"\n"
+          "  -T, --trace FILE         write a Chrome trace of the run to\n"
+          "                           FILE (chrome://tracing, Perfetto)\n"
+          "  -g, --graphics           load mars_graphics and open a window\n"
+          "                           for the graphics benchmarks\n"
+          "  -C, --config_dir DIR     the configuration directory\n",
+          name);
+}
+
+static bool readArguments(int argc, char **argv, Options *options) {
+  static struct option longOptions[] = {
+    {"bench", required_argument, 0, 'b'},
+    {"list", no_argument, 0, 'l'},
+    {"steps", required_argument, 0, 'n'},
+    {"warm-up", required_argument, 0, 'w'},
+    {"output", required_argument, 0, 'o'},
+    {"baseline", required_argument, 0, 'B'},
+    {"tolerance", required_argument, 0, 't'},
+    {"set", required_argument, 0, 'S'},
+    {"trace", required_argument, 0, 'T'},
+    {"graphics", no_argument, 0, 'g'},
+    {"config_dir", required_argument, 0, 'C'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  std::vector<std::string> names;
+  int c;
+
+  if(utils::pathExists(DEFAULT_CONFIG_DIR)) {
+    options->configDir = DEFAULT_CONFIG_DIR;
+  }
+  while((c = getopt_long(argc, argv, "b:ln:w:o:B:t:S:T:gC:h", longOptions,
+                         NULL)) != -1) {
+    switch(c) {
+    case 'b':
+      names = utils::explodeString(',', optarg);
+      options->benchmarks.insert(options->benchmarks.end(), names.begin(),
+                                 names.end());
+      break;
+    case 'l':
+      options->list = true;
+      break;
+    case 'n':
+      options->steps = strtoul(optarg, NULL, 10);
+      break;
+    case 'w':
+      options->warmUp = strtoul(optarg, NULL, 10);
+      break;
+    case 'o':
+      options->output = optarg;
+      break;
+    case 'B':
+      options->baseline = optarg;
+      break;
+    case 't':
+      options->tolerance = atof(optarg);
+      break;
+    case 'S':
+      options->overrides.push_back(optarg);
+      break;
+    case 'T':
+      options->trace = optarg;
+      break;
+    case 'g':
+      options->graphics = true;
+      break;
+    case 'C':
+      options->configDir = optarg;
+      break;
+    default:
+      printUsage(argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief sets "group/name=value" with the type of the existing property.
+ */
+static bool setProperty(cfg_manager::CFGManagerInterface *cfg,
+                        const std::string &assignment) {
+  size_t slash = assignment.find('/');
+  size_t equal = assignment.find('=', slash);
+  if(slash == std::string::npos || equal == std::string::npos) {
+    fprintf(stderr, "mars_bench: expected GROUP/NAME=VALUE: \"%s\"\n",
+            assignment.c_str());
+    return false;
+  }
+  std::string group = assignment.substr(0, slash);
+  std::string name = assignment.substr(slash + 1, equal - slash - 1);
+  std::string value = assignment.substr(equal + 1);
+  if(!cfg->getParamId(group, name)) {
+    fprintf(stderr, "mars_bench: unknown property \"%s/%s\"\n",
+            group.c_str(), name.c_str());
+    return false;
+  }
+  switch(cfg->getParamInfo(group, name).type) {
+  case cfg_manager::doubleParam:
+    return cfg->setPropertyValue(group, name, "value", atof(value.c_str()));
+  case cfg_manager::intParam:
+    return cfg->setPropertyValue(group, name, "value", atoi(value.c_str()));
+  case cfg_manager::boolParam:
+    return cfg->setPropertyValue(group, name, "value",
+                                 value == "true" || value == "1");
+  default:
+    return cfg->setPropertyValue(group, name, "value", value);
+  }
+}
+
+static bool selected(const Options &options, const std::string &name) {
+  if(options.benchmarks.empty()) return true;
+  for(size_t i=0; i<options.benchmarks.size(); ++i) {
+    if(options.benchmarks[i] == name) return true;
+  }
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  std::vector<Benchmark*> benchmarks;
+  int result = 0;
+
+  if(!readArguments(argc, argv, &options)) return 2;
+  createBenchmarks(&benchmarks);
+  if(options.list) {
+    for(size_t i=0; i<benchmarks.size(); ++i) {
+      printf("%-22s %s\n", benchmarks[i]->getName().c_str(),
+             benchmarks[i]->getDescription().c_str());
+      delete benchmarks[i];
+    }
+    return 0;
+  }
+  for(size_t i=0; i<options.benchmarks.size(); ++i) {
+    bool known = false;
+    for(size_t k=0; k<benchmarks.size(); ++k) {
+      if(benchmarks[k]->getName() == options.benchmarks[i]) known = true;
+    }
+    if(!known) {
+      fprintf(stderr, "mars_bench: unknown benchmark \"%s\"\n",
+              options.benchmarks[i].c_str());
+      return 2;
+    }
+  }
+
+  // the core libraries only; no main_gui and mars_graphics on request
+  lib_manager::LibManager *libManager = new lib_manager::LibManager();
+  libManager->loadLibrary("cfg_manager");
+  libManager->loadLibrary("data_broker");
+  libManager->loadLibrary("mars_sim");
+  if(options.graphics) libManager->loadLibrary("mars_graphics");
+  cfg_manager::CFGManagerInterface *cfg;
+  cfg = libManager->getLibraryAs<cfg_manager::CFGManagerInterface>("cfg_manager");
+  interfaces::SimulatorInterface *sim;
+  sim = libManager->getLibraryAs<interfaces::SimulatorInterface>("mars_sim");
+  if(!cfg || !sim) {
+    fprintf(stderr, "mars_bench: could not load the core libraries\n");
+    return 2;
+  }
+  cfg->getOrCreateProperty("Config", "config_path", options.configDir);
+  interfaces::GraphicsManagerInterface *graphics = NULL;
+  if(options.graphics) {
+    graphics = libManager->getLibraryAs<interfaces::GraphicsManagerInterface>("mars_graphics");
+    if(!graphics) {
+      fprintf(stderr, "mars_bench: could not load mars_graphics\n");
+      return 2;
+    }
+    // without a widget the graphics opens its own window
+    graphics->initializeOSG(NULL, true);
+  }
+
+  BenchContext context;
+  context.libManager = libManager;
+  context.control = sim->getControlCenter();
+  const char *tmpDir = getenv("TMPDIR");
+  context.tmpDir = tmpDir ? tmpDir : "/tmp";
+  // creates the managers and the physics without starting the thread
+  sim->runSimulation(false);
+
+  for(size_t i=0; i<options.overrides.size(); ++i) {
+    if(!setProperty(cfg, options.overrides[i])) result = 2;
+  }
+  if(!options.trace.empty()) {
+    cfg->setPropertyValue("Simulator", "trace file", "value", options.trace);
+    cfg->setPropertyValue("Simulator", "trace", "value", true);
+  }
+
+  BenchRun run;
+  run.warmUp = options.warmUp;
+  run.steps = options.steps;
+  run.overrides = options.overrides;
+  for(size_t i=0; i<benchmarks.size() && !result; ++i) {
+    if(!selected(options, benchmarks[i]->getName())) continue;
+    fprintf(stderr, "mars_bench: %s\n", benchmarks[i]->getName().c_str());
+    run.results.push_back(runBenchmark(benchmarks[i], &context,
+                                       options.warmUp, options.steps));
+  }
+  if(!options.trace.empty()) {
+    // writes the trace file
+    cfg->setPropertyValue("Simulator", "trace", "value", false);
+  }
+
+  if(!result) {
+    printSummary(stderr, run);
+    FILE *file = stdout;
+    if(!options.output.empty()) {
+      file = fopen(options.output.c_str(), "w");
+      if(!file) {
+        fprintf(stderr, "mars_bench: can not write \"%s\"\n",
+                options.output.c_str());
+        result = 2;
+      }
+    }
+    if(file) {
+      writeReport(file, run);
+      if(file != stdout) fclose(file);
+    }
+  }
+
+  if(!result && !options.baseline.empty()) {
+    int regressions = compareWithBaseline(options.baseline, run,
+                                          options.tolerance, stderr);
+    if(regressions < 0) result = 2;
+    else if(regressions > 0) {
+      fprintf(stderr, "mars_bench: %d regression(s) against \"%s\"\n",
+              regressions, options.baseline.c_str());
+      result = 1;
+    }
+  }
+
+  for(size_t i=0; i<benchmarks.size(); ++i) {
+    delete benchmarks[i];
+  }
+  if(graphics) libManager->releaseLibrary("mars_graphics");
+  libManager->releaseLibrary("mars_sim");
+  libManager->releaseLibrary("data_broker");
+  libManager->releaseLibrary("cfg_manager");
+  delete libManager;
+  return result;
+}
@@ -47,6 +47,7 @@
 
 #include <mars/utils/MutexLocker.h>
 #include <mars/utils/misc.h>
+#include <mars/utils/Trace.h>
 
 #include <cstdio>
 #include <cerrno>
@@ -286,6 +287,7 @@ namespace mars {
     }
 
     bool DataBroker::stepTimer(const std::string &timerName, long step) {
+      MARS_TRACE_SCOPE("data_broker", "stepTimer");
       std::map<std::string, Timer>::iterator timerIt, endIt;
       std::list<DeferredCallback> deferredCallbacks;
       std::set<DataItemConnection> activeConnections;
@@ -321,9 +323,13 @@ namespace mars {
           deferredCallback.receivers.clear();
 
           element->bufferLock->lockForWrite();
-          producerIt->producer->produceData(element->info,
-                                            element->backBuffer,
-                                            producerIt->callbackParam);
+          {
+            // the timed producers are mostly the sensors
+            MARS_TRACE_SCOPE("producer", element->traceName);
+            producerIt->producer->produceData(element->info,
+                                              element->backBuffer,
+                                              producerIt->callbackParam);
+          }
           std::swap(element->backBuffer, element->frontBuffer);
           element->receiverLock->lockForRead();
           if(!element->syncReceivers.empty()) {
@@ -384,6 +390,7 @@ namespace mars {
           timedReceiverIt != deferredReceivers.end();
           ++timedReceiverIt) {
         DataElement *element = timedReceiverIt->element;
+        MARS_TRACE_SCOPE("receiver", element->traceName);
         element->bufferLock->lockForRead();
         timedReceiverIt->receiver->receiveData(element->info,
                                                *element->frontBuffer,
@@ -629,9 +636,10 @@ namespace mars {
         triggers[triggerName] = Trigger();
         triggers[triggerName].receivers.clear();
         triggers[triggerName].lock = new ReadWriteLock;
+        triggerIt = triggers.find(triggerName);
         ok = true;
       }
-      // check for pending timer registrations
+      // check for pending trigger registrations
       std::map<std::pair<std::string, std::string>, DataElement*>::iterator elementIt;
       std::list<PendingTriggeredRegistration>::iterator pendingIt;
       pendingRegistrationLock.lock();
@@ -651,6 +659,8 @@ namespace mars {
             ++pendingIt;
           }
           elementsLock.unlock();
+        } else {
+          ++pendingIt;
         }
       }
       pendingRegistrationLock.unlock();
@@ -707,6 +717,18 @@ namespace mars {
         }
         elementsLock.unlock();
       }
+      // if there was a problem add to pending receivers
+      if(!ok) {
+        PendingTriggeredRegistration tmp;
+        tmp.receiver = receiver;
+        tmp.groupName = groupName.c_str();
+        tmp.dataName = dataName.c_str();
+        tmp.triggerName = triggerName.c_str();
+        tmp.callbackParam = callbackParam;
+        pendingRegistrationLock.lock();
+        pendingTriggeredRegistrations.push_back(tmp);
+        pendingRegistrationLock.unlock();
+      }
       return ok;
     }
 
@@ -915,6 +937,7 @@ namespace mars {
     unsigned long DataBroker::pushData(unsigned long id,
                                        const DataPackage &dataPackage,
                                        const ReceiverInterface *producer) {
+      MARS_TRACE_SCOPE("data_broker", "pushData");
       std::list<Receiver>::iterator syncReceiverIt;
       std::map<unsigned long, DataElement*>::iterator elementIt;
       std::set<DataElement*> connectionActivatedElements;
@@ -1050,8 +1073,10 @@ namespace mars {
       std::list<DeferredCallback> deferredCallbacks;
       std::list<DeferredCallback>::iterator callbackIt;
 
+      Trace::setThreadName("data_broker");
       wakeupMutex.lock();
       while(!stop_thread) {
+        double traceStart = Trace::isEnabled() ? getClockMs() : -1.0;
         elementsLock.lockForRead();
         updatedElementsLock.lock();
         std::swap(updatedElementsBackBuffer, updatedElementsFrontBuffer);
@@ -1093,6 +1118,10 @@ namespace mars {
           }
         }
         deferredCallbacks.clear();
+        if(traceStart >= 0.0) {
+          Trace::complete("data_broker", "dispatch", traceStart,
+                          getClockMs());
+        }
 
         // If there is no data to process go to sleep. pushData() will wake us up.
         updatedElementsLock.lock();
@@ -1180,6 +1209,7 @@ namespace mars {
       element->frontBuffer = new DataPackage;
       element->bufferLock = new ReadWriteLock;
       element->receiverLock = new ReadWriteLock;
+      element->traceName = Trace::intern(groupName + "/" + dataName);
       elementsByName[std::make_pair(groupName.c_str(),
                                     dataName.c_str())] = element;
       elementsById[element->info.dataId] = element;
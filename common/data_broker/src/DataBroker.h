@@ -141,6 +141,8 @@ namespace mars {
       mars::utils::ReadWriteLock *receiverLock;
       const ReceiverInterface *lastProducer;
       std::list<DataItemConnection> connections;
+      /// "group/data", the span name of the producer and receiver calls
+      const char *traceName;
     };
     /// \endcond
 
@@ -0,0 +1,250 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BridgeClient.h"
+
+#include <mars/utils/misc.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <cstdio>
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+namespace mars {
+  namespace data_broker_bridge {
+
+    using namespace mars::data_broker;
+    using namespace mars::data_broker_recorder;
+
+    static const size_t receiveChunk = 1 << 16;
+
+    BridgeClient::BridgeClient() : fd(-1), numSamples(0), sequence(0),
+                                   simTime(0.0), missedSteps(0),
+                                   firstStep(true), nextStreamIndex(0) {
+    }
+
+    BridgeClient::~BridgeClient() {
+      disconnect();
+    }
+
+    bool BridgeClient::connectTCP(const std::string &host, int port) {
+      disconnect();
+      return connected(net::connectTCP(host, port));
+    }
+
+    bool BridgeClient::connectUnix(const std::string &path) {
+      disconnect();
+      return connected(net::connectUnix(path));
+    }
+
+    bool BridgeClient::connected(int fd) {
+      if(fd < 0) return false;
+      this->fd = fd;
+      received.clear();
+      schemas.clear();
+      numSamples = 0;
+      sequence = 0;
+      missedSteps = 0;
+      firstStep = true;
+      nextStreamIndex = 0;
+      return true;
+    }
+
+    void BridgeClient::disconnect() {
+      net::close(fd);
+      fd = -1;
+    }
+
+    bool BridgeClient::sendAll(const std::vector<char> &buffer) {
+      size_t offset = 0;
+      while(fd >= 0 && offset < buffer.size()) {
+        ssize_t n = send(fd, &buffer[offset], buffer.size() - offset,
+                         MSG_NOSIGNAL);
+        if(n < 0) {
+          if(errno == EINTR) continue;
+          disconnect();
+          return false;
+        }
+        offset += n;
+      }
+      return fd >= 0;
+    }
+
+    bool BridgeClient::subscribe(const std::string &groupPattern,
+                                 const std::string &dataPattern) {
+      outgoing.clear();
+      frame::writePatterns(&outgoing, FRAME_SUBSCRIBE, groupPattern,
+                           dataPattern);
+      return sendAll(outgoing);
+    }
+
+    bool BridgeClient::unsubscribe(const std::string &groupPattern,
+                                   const std::string &dataPattern) {
+      outgoing.clear();
+      frame::writePatterns(&outgoing, FRAME_UNSUBSCRIBE, groupPattern,
+                           dataPattern);
+      return sendAll(outgoing);
+    }
+
+    uint32_t BridgeClient::advertise(const std::string &groupName,
+                                     const std::string &dataName,
+                                     const DataPackage &package,
+                                     PackageFlag flags) {
+      StreamSchema schema;
+      schema.streamIndex = nextStreamIndex++;
+      schema.groupName = groupName;
+      schema.dataName = dataName;
+      schema.flags = flags;
+      schema.items.resize(package.size());
+      for(size_t i=0; i<package.size(); ++i) {
+        schema.items[i].name = package[i].getName();
+        schema.items[i].type = package[i].type;
+      }
+      outgoing.clear();
+      frame::writeSchema(&outgoing, schema);
+      sendAll(outgoing);
+      return schema.streamIndex;
+    }
+
+    bool BridgeClient::push(uint32_t streamIndex, const DataPackage &package) {
+      outgoing.clear();
+      frame::writePush(&outgoing, streamIndex, package);
+      return sendAll(outgoing);
+    }
+
+    const StreamSchema* BridgeClient::getSchema(uint32_t index) const {
+      std::map<uint32_t, StreamSchema>::const_iterator it;
+      it = schemas.find(index);
+      return (it == schemas.end()) ? NULL : &it->second;
+    }
+
+    bool BridgeClient::readStep(const char *payload, const char *end) {
+      uint64_t seq;
+      uint32_t count;
+      if(!frame::readStepHeader(&payload, end, &seq, &simTime, &count)) {
+        return false;
+      }
+      if(!firstStep && seq > sequence + 1) {
+        missedSteps += seq - sequence - 1;
+      }
+      firstStep = false;
+      sequence = seq;
+      if(samples.size() < count) samples.resize(count);
+      for(numSamples=0; numSamples<count; ++numSamples) {
+        BridgeSample &sample = samples[numSamples];
+        uint32_t index;
+        if(!frame::getUInt32(&payload, end, &index)) return false;
+        const StreamSchema *schema = getSchema(index);
+        if(!schema) return false;
+        if(sample.schema != schema || sample.streamIndex != index) {
+          // steps usually contain the same streams in the same order
+          sample.streamIndex = index;
+          sample.schema = schema;
+          serialize::preparePackage(*schema, &sample.package);
+        }
+        if(!serialize::readValues(&payload, end, *schema, &sample.package)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool BridgeClient::receiveStep(int timeoutMs) {
+      long long start = utils::getTime();
+      size_t consumed = 0;
+      bool gotStep = false;
+
+      while(fd >= 0) {
+        // handle all complete frames up to the first step
+        const char *base = received.empty() ? NULL : &received[0];
+        const char *pos = base + consumed;
+        const char *end = base + received.size();
+        const char *payload, *payloadEnd;
+        uint8_t type;
+        bool error = false;
+        while(!gotStep && frame::next(&pos, end, &type, &payload,
+                                      &payloadEnd, &error)) {
+          if(type == FRAME_HELLO) {
+            uint32_t version = 0;
+            frame::getUInt32(&payload, payloadEnd, &version);
+            if(version != BRIDGE_VERSION) {
+              fprintf(stderr, "BridgeClient: bridge has protocol version "
+                      "%u; expected %u\n", version, BRIDGE_VERSION);
+              error = true;
+              break;
+            }
+          } else if(type == FRAME_SCHEMA) {
+            StreamSchema schema;
+            if(!serialize::readSchema(&payload, payloadEnd, &schema)) {
+              error = true;
+              break;
+            }
+            schemas[schema.streamIndex] = schema;
+            // the cached packages point to the old schemas
+            for(size_t i=0; i<samples.size(); ++i) samples[i].schema = NULL;
+          } else if(type == FRAME_STEP) {
+            if(!readStep(payload, payloadEnd)) {
+              error = true;
+              break;
+            }
+            gotStep = true;
+          }
+        }
+        consumed = pos - base;
+        if(error) {
+          disconnect();
+          return false;
+        }
+        if(gotStep) break;
+
+        // wait for more data
+        int wait = -1;
+        if(timeoutMs >= 0) {
+          wait = timeoutMs - (int)utils::getTimeDiff(start);
+          if(wait < 0) break;
+        }
+        struct pollfd p;
+        p.fd = fd;
+        p.events = POLLIN;
+        p.revents = 0;
+        int r = poll(&p, 1, wait);
+        if(r < 0 && errno == EINTR) continue;
+        if(r <= 0) break;
+        size_t size = received.size();
+        received.resize(size + receiveChunk);
+        ssize_t n = recv(fd, &received[size], receiveChunk, 0);
+        received.resize(size + (n > 0 ? n : 0));
+        if(n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) {
+          disconnect();
+        }
+      }
+      if(consumed) {
+        received.erase(received.begin(), received.begin() + consumed);
+      }
+      return gotStep;
+    }
+
+  } // end of namespace data_broker_bridge
+} // end of namespace mars
@@ -0,0 +1,126 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file BridgeClient.h
+ * \brief Blocking client for the DataBrokerBridge.
+ *
+ * The client does not depend on a running simulation and can be linked
+ * into monitoring or learning processes:
+ *
+ *   BridgeClient client;
+ *   client.connectUnix("/tmp/mars.sock");
+ *   client.subscribe("mars_sim", "*");
+ *   while(client.receiveStep()) {
+ *     for(size_t i=0; i<client.getNumSamples(); ++i) {
+ *       const BridgeSample &s = client.getSample(i);
+ *       // s.schema->dataName, s.package
+ *     }
+ *   }
+ */
+
+#ifndef DATA_BROKER_BRIDGE_CLIENT_H
+#define DATA_BROKER_BRIDGE_CLIENT_H
+
+#ifdef _PRINT_HEADER_
+  #warning "BridgeClient.h"
+#endif
+
+#include "BridgeProtocol.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace data_broker_bridge {
+
+    struct BridgeSample {
+      BridgeSample() : streamIndex(0), schema(NULL) {}
+
+      uint32_t streamIndex;
+      const data_broker_recorder::StreamSchema *schema;
+      data_broker::DataPackage package;
+    };
+
+    class BridgeClient {
+    public:
+      BridgeClient();
+      ~BridgeClient();
+
+      bool connectTCP(const std::string &host, int port);
+      bool connectUnix(const std::string &path);
+      void disconnect();
+      bool isConnected() const {return fd >= 0;}
+
+      bool subscribe(const std::string &groupPattern,
+                     const std::string &dataPattern);
+      bool unsubscribe(const std::string &groupPattern,
+                       const std::string &dataPattern);
+
+      /**
+       * \brief announces a stream that is pushed into the DataBroker of
+       *        the simulation. The layout is taken from \a package.
+       * \return The index to pass to push().
+       */
+      uint32_t advertise(const std::string &groupName,
+                         const std::string &dataName,
+                         const data_broker::DataPackage &package,
+                         data_broker::PackageFlag flags =
+                         data_broker::DATA_PACKAGE_NO_FLAG);
+      bool push(uint32_t streamIndex, const data_broker::DataPackage &package);
+
+      /**
+       * \brief waits for the next step and unpacks its samples.
+       * \param timeoutMs The maximum time to wait; -1 waits forever.
+       * \return \c false on timeout or if the connection was lost.
+       */
+      bool receiveStep(int timeoutMs=-1);
+
+      uint64_t getSequence() const {return sequence;}
+      double getSimTime() const {return simTime;}
+      size_t getNumSamples() const {return numSamples;}
+      const BridgeSample& getSample(size_t i) const {return samples[i];}
+      /** \brief steps the bridge dropped because this client was too slow */
+      unsigned long getMissedSteps() const {return missedSteps;}
+      const data_broker_recorder::StreamSchema* getSchema(uint32_t index) const;
+
+    private:
+      bool connected(int fd);
+      bool sendAll(const std::vector<char> &buffer);
+      bool readStep(const char *payload, const char *end);
+
+      int fd;
+      std::vector<char> outgoing;
+      std::vector<char> received;
+      std::map<uint32_t, data_broker_recorder::StreamSchema> schemas;
+      std::vector<BridgeSample> samples;
+      size_t numSamples;
+      uint64_t sequence;
+      double simTime;
+      unsigned long missedSteps;
+      bool firstStep;
+      uint32_t nextStreamIndex;
+    }; // end of class BridgeClient
+
+  } // end of namespace data_broker_bridge
+} // end of namespace mars
+
+#endif // DATA_BROKER_BRIDGE_CLIENT_H
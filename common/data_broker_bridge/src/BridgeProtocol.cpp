@@ -0,0 +1,277 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BridgeProtocol.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace mars {
+  namespace data_broker_bridge {
+
+    using namespace mars::data_broker;
+    using namespace mars::data_broker_recorder;
+
+    template<typename T>
+    static inline void put(std::vector<char> *buffer, const T &value) {
+      size_t pos = buffer->size();
+      buffer->resize(pos + sizeof(T));
+      memcpy(&(*buffer)[pos], &value, sizeof(T));
+    }
+
+    template<typename T>
+    static inline bool get(const char **pos, const char *end, T *value) {
+      if(end - *pos < (long)sizeof(T)) return false;
+      memcpy(value, *pos, sizeof(T));
+      *pos += sizeof(T);
+      return true;
+    }
+
+    namespace frame {
+
+      size_t begin(std::vector<char> *buffer, FrameType type) {
+        size_t start = buffer->size();
+        put(buffer, (uint32_t)0);
+        put(buffer, (uint8_t)type);
+        return start;
+      }
+
+      void end(std::vector<char> *buffer, size_t start) {
+        uint32_t length = buffer->size() - start - sizeof(uint32_t);
+        memcpy(&(*buffer)[start], &length, sizeof(length));
+      }
+
+      void putUInt32(std::vector<char> *buffer, uint32_t value) {
+        put(buffer, value);
+      }
+
+      void putString(std::vector<char> *buffer, const std::string &s) {
+        put(buffer, (uint32_t)s.size());
+        buffer->insert(buffer->end(), s.begin(), s.end());
+      }
+
+      bool getUInt32(const char **pos, const char *end, uint32_t *value) {
+        return get(pos, end, value);
+      }
+
+      bool getString(const char **pos, const char *end, std::string *s) {
+        uint32_t length;
+        if(!get(pos, end, &length)) return false;
+        if((uint32_t)(end - *pos) < length) return false;
+        s->assign(*pos, length);
+        *pos += length;
+        return true;
+      }
+
+      void writeHello(std::vector<char> *buffer) {
+        size_t start = begin(buffer, FRAME_HELLO);
+        put(buffer, BRIDGE_VERSION);
+        end(buffer, start);
+      }
+
+      void writeSchema(std::vector<char> *buffer, const StreamSchema &schema) {
+        // the schema record starts with its own type byte (RECORD_SCHEMA)
+        size_t start = buffer->size();
+        put(buffer, (uint32_t)0);
+        serialize::writeSchema(buffer, schema);
+        end(buffer, start);
+      }
+
+      void writePatterns(std::vector<char> *buffer, FrameType type,
+                         const std::string &groupPattern,
+                         const std::string &dataPattern) {
+        size_t start = begin(buffer, type);
+        putString(buffer, groupPattern);
+        putString(buffer, dataPattern);
+        end(buffer, start);
+      }
+
+      void writePush(std::vector<char> *buffer, uint32_t streamIndex,
+                     const DataPackage &package) {
+        size_t start = begin(buffer, FRAME_PUSH);
+        put(buffer, streamIndex);
+        serialize::writeValues(buffer, package);
+        end(buffer, start);
+      }
+
+      size_t beginStep(std::vector<char> *buffer) {
+        size_t start = buffer->size();
+        buffer->resize(start + STEP_HEADER_SIZE);
+        return start;
+      }
+
+      void addSample(std::vector<char> *buffer, uint32_t streamIndex,
+                     const DataPackage &package) {
+        put(buffer, streamIndex);
+        serialize::writeValues(buffer, package);
+      }
+
+      void endStep(std::vector<char> *buffer, size_t start, uint64_t sequence,
+                   double simTime, uint32_t numSamples) {
+        char *p = &(*buffer)[start];
+        uint32_t length = buffer->size() - start - sizeof(uint32_t);
+        uint8_t type = FRAME_STEP;
+        memcpy(p, &length, sizeof(length)); p += sizeof(length);
+        memcpy(p, &type, sizeof(type)); p += sizeof(type);
+        memcpy(p, &sequence, sizeof(sequence)); p += sizeof(sequence);
+        memcpy(p, &simTime, sizeof(simTime)); p += sizeof(simTime);
+        memcpy(p, &numSamples, sizeof(numSamples));
+      }
+
+      bool readStepHeader(const char **pos, const char *end,
+                          uint64_t *sequence, double *simTime,
+                          uint32_t *numSamples) {
+        return (get(pos, end, sequence) && get(pos, end, simTime) &&
+                get(pos, end, numSamples));
+      }
+
+      bool next(const char **pos, const char *end, uint8_t *type,
+                const char **payload, const char **payloadEnd, bool *error) {
+        const char *p = *pos;
+        uint32_t length;
+        *error = false;
+        if(!get(&p, end, &length)) return false;
+        if(length == 0 || length > MAX_FRAME_SIZE) {
+          *error = true;
+          return false;
+        }
+        if((uint32_t)(end - p) < length) return false;
+        *type = (uint8_t)*p;
+        *payload = p + 1;
+        *payloadEnd = p + length;
+        *pos = p + length;
+        return true;
+      }
+
+    } // end of namespace frame
+
+    namespace net {
+
+      int listenTCP(int port, bool allInterfaces) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0) return -1;
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(allInterfaces ? INADDR_ANY
+                                                   : INADDR_LOOPBACK);
+        if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+           listen(fd, 8) != 0) {
+          ::close(fd);
+          return -1;
+        }
+        return fd;
+      }
+
+      int listenUnix(const std::string &path) {
+        struct sockaddr_un addr;
+        if(path.size() >= sizeof(addr.sun_path)) return -1;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0) return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        // a socket file left behind by a crashed simulation
+        unlink(path.c_str());
+        if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+           listen(fd, 8) != 0) {
+          ::close(fd);
+          return -1;
+        }
+        return fd;
+      }
+
+      int connectTCP(const std::string &host, int port) {
+        struct addrinfo hints, *result;
+        char service[16];
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        snprintf(service, sizeof(service), "%d", port);
+        if(getaddrinfo(host.c_str(), service, &hints, &result) != 0) {
+          return -1;
+        }
+        int fd = socket(result->ai_family, result->ai_socktype,
+                        result->ai_protocol);
+        if(fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+          ::close(fd);
+          fd = -1;
+        }
+        freeaddrinfo(result);
+        if(fd >= 0) {
+          // steps are written in one piece; don't wait for more data
+          int on = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        return fd;
+      }
+
+      int connectUnix(const std::string &path) {
+        struct sockaddr_un addr;
+        if(path.size() >= sizeof(addr.sun_path)) return -1;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0) return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+          ::close(fd);
+          return -1;
+        }
+        return fd;
+      }
+
+      int accept(int listenSocket) {
+        int fd = ::accept(listenSocket, NULL, NULL);
+        if(fd < 0) return -1;
+        int on = 1;
+        // fails for Unix domain sockets, which don't need it
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        return fd;
+      }
+
+      bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+      }
+
+      void close(int fd) {
+        if(fd >= 0) ::close(fd);
+      }
+
+    } // end of namespace net
+
+  } // end of namespace data_broker_bridge
+} // end of namespace mars
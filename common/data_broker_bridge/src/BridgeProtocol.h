@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file BridgeProtocol.h
+ * \brief Wire format of the DataBrokerBridge.
+ *
+ * The bridge exchanges frames of the form
+ *
+ *   uint32 length    (number of bytes following the length field)
+ *   uint8  type      (FrameType)
+ *   payload
+ *
+ * in the byte order of the host, as the bridge is meant for local
+ * connections. Frames sent by the bridge:
+ *  - HELLO:  uint32 protocol version; the first frame of a connection
+ *  - SCHEMA: a stream schema as written by serialize::writeSchema() of the
+ *            data_broker_recorder (the type byte is the RECORD_SCHEMA of
+ *            the record). Sent once per stream and connection before the
+ *            first step that contains the stream, and again with a new
+ *            stream index if the layout of the stream changes.
+ *  - STEP:   uint64 sequence, double simTime, uint32 numSamples followed
+ *            by numSamples times uint32 streamIndex + packed values. All
+ *            samples received during one simulation step. The sequence
+ *            is incremented per step, so a gap tells the client how many
+ *            steps were dropped.
+ *
+ * Frames sent by a client:
+ *  - SUBSCRIBE/UNSUBSCRIBE: string groupPattern, string dataPattern
+ *  - SCHEMA: announces a command stream; the stream index is chosen by
+ *            the client
+ *  - PUSH:   uint32 streamIndex + packed values; republished via
+ *            DataBrokerInterface::pushData
+ *
+ * Strings are encoded as uint32 length + characters.
+ */
+
+#ifndef DATA_BROKER_BRIDGE_PROTOCOL_H
+#define DATA_BROKER_BRIDGE_PROTOCOL_H
+
+#ifdef _PRINT_HEADER_
+  #warning "BridgeProtocol.h"
+#endif
+
+#include <mars/data_broker_recorder/RecorderLog.h>
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace mars {
+  namespace data_broker_bridge {
+
+    const uint32_t BRIDGE_VERSION = 1;
+    /** \brief frames larger than this are treated as a protocol error */
+    const uint32_t MAX_FRAME_SIZE = 64 << 20;
+    const size_t FRAME_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+    const size_t STEP_HEADER_SIZE = (FRAME_HEADER_SIZE + sizeof(uint64_t) +
+                                     sizeof(double) + sizeof(uint32_t));
+
+    enum FrameType {
+      FRAME_SCHEMA = data_broker_recorder::RECORD_SCHEMA,
+      FRAME_HELLO = 16,
+      FRAME_STEP,
+      FRAME_SUBSCRIBE,
+      FRAME_UNSUBSCRIBE,
+      FRAME_PUSH
+    };
+
+    namespace frame {
+      /**
+       * \brief appends the header of a frame of type \a type.
+       * \return The offset of the frame which has to be passed to end().
+       */
+      size_t begin(std::vector<char> *buffer, FrameType type);
+      /** \brief writes the length of the frame started at \a start */
+      void end(std::vector<char> *buffer, size_t start);
+
+      void putUInt32(std::vector<char> *buffer, uint32_t value);
+      void putString(std::vector<char> *buffer, const std::string &s);
+      bool getUInt32(const char **pos, const char *end, uint32_t *value);
+      bool getString(const char **pos, const char *end, std::string *s);
+
+      void writeHello(std::vector<char> *buffer);
+      void writeSchema(std::vector<char> *buffer,
+                       const data_broker_recorder::StreamSchema &schema);
+      void writePatterns(std::vector<char> *buffer, FrameType type,
+                         const std::string &groupPattern,
+                         const std::string &dataPattern);
+      void writePush(std::vector<char> *buffer, uint32_t streamIndex,
+                     const data_broker::DataPackage &package);
+
+      /**
+       * \brief starts a STEP frame at the end of \a buffer. The header is
+       *        reserved and filled by endStep().
+       */
+      size_t beginStep(std::vector<char> *buffer);
+      void addSample(std::vector<char> *buffer, uint32_t streamIndex,
+                     const data_broker::DataPackage &package);
+      void endStep(std::vector<char> *buffer, size_t start, uint64_t sequence,
+                   double simTime, uint32_t numSamples);
+      bool readStepHeader(const char **pos, const char *end,
+                          uint64_t *sequence, double *simTime,
+                          uint32_t *numSamples);
+
+      /**
+       * \brief splits the next complete frame off the received bytes.
+       * \return \c false if the frame is not complete yet. \a *error is
+       *         set if the length field exceeds MAX_FRAME_SIZE.
+       */
+      bool next(const char **pos, const char *end, uint8_t *type,
+                const char **payload, const char **payloadEnd, bool *error);
+    } // end of namespace frame
+
+    /**
+     * \brief thin wrappers around the POSIX socket calls used by the bridge
+     *        and the client. All functions return -1 on error.
+     */
+    namespace net {
+      /** \brief listens on \a port of the loopback or all interfaces */
+      int listenTCP(int port, bool allInterfaces);
+      /** \brief listens on a Unix domain socket; removes a stale \a path */
+      int listenUnix(const std::string &path);
+      int connectTCP(const std::string &host, int port);
+      int connectUnix(const std::string &path);
+      int accept(int listenSocket);
+      bool setNonBlocking(int fd);
+      void close(int fd);
+    } // end of namespace net
+
+  } // end of namespace data_broker_bridge
+} // end of namespace mars
+
+#endif // DATA_BROKER_BRIDGE_PROTOCOL_H
@@ -0,0 +1,613 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DataBrokerBridge.h"
+
+#include <mars/utils/MutexLocker.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#ifndef MSG_NOSIGNAL
+// SO_NOSIGPIPE is set on the socket instead
+#  define MSG_NOSIGNAL 0
+#endif
+
+namespace mars {
+  namespace data_broker_bridge {
+
+    using namespace mars::utils;
+    using namespace mars::data_broker;
+    using namespace mars::data_broker_recorder;
+    using namespace mars::cfg_manager;
+
+    // read from a socket in pieces of this size
+    static const size_t receiveChunk = 1 << 16;
+
+    static DropPolicy dropPolicyFromString(const std::string &s) {
+      if(s == "dropNewest") return DROP_NEWEST;
+      if(s == "disconnect") return DROP_DISCONNECT;
+      if(s != "dropOldest") {
+        fprintf(stderr, "DataBrokerBridge: unknown drop policy \"%s\"; "
+                "using \"dropOldest\"\n", s.c_str());
+      }
+      return DROP_OLDEST;
+    }
+
+    void Subscription::receiveData(const DataInfo &info,
+                                   const DataPackage &dataPackage,
+                                   int callbackParam) {
+      bridge->addSample(this, info, dataPackage);
+    }
+
+
+    DataBrokerBridge::DataBrokerBridge(lib_manager::LibManager *theManager)
+      : lib_manager::LibInterface(theManager), dataBroker(NULL), cfg(NULL),
+        tcpSocket(-1), unixSocket(-1), nextConnectionId(1), droppedSteps(0),
+        maxQueuedSteps(32), dropPolicy(DROP_OLDEST), allowPush(true),
+        simTime(0.0), stop(false) {
+
+      wakePipe[0] = wakePipe[1] = -1;
+      dataBroker = libManager->getLibraryAs<DataBrokerInterface>("data_broker");
+      if(!dataBroker) {
+        fprintf(stderr, "DataBrokerBridge: could not find data_broker\n");
+        return;
+      }
+
+      cfg = libManager->getLibraryAs<CFGManagerInterface>("cfg_manager");
+      if(cfg) {
+        std::string group = "DataBrokerBridge";
+        cfgTcpPort = cfg->getOrCreateProperty(group, "tcpPort", 7090, this);
+        cfgTcpAllInterfaces = cfg->getOrCreateProperty(group,
+                                                       "tcpAllInterfaces",
+                                                       false, this);
+        cfgUnixSocket = cfg->getOrCreateProperty(group, "unixSocket",
+                                                 std::string(""), this);
+        cfgMaxQueuedSteps = cfg->getOrCreateProperty(group, "maxQueuedSteps",
+                                                     (int)maxQueuedSteps,
+                                                     this);
+        cfgDropPolicy = cfg->getOrCreateProperty(group, "dropPolicy",
+                                                 std::string("dropOldest"),
+                                                 this);
+        cfgAllowPush = cfg->getOrCreateProperty(group, "allowPush", true,
+                                                this);
+        maxQueuedSteps = cfgMaxQueuedSteps.iValue > 0 ?
+          cfgMaxQueuedSteps.iValue : 1;
+        dropPolicy = dropPolicyFromString(cfgDropPolicy.sValue);
+        allowPush = cfgAllowPush.bValue;
+      }
+
+      // the step is finished after the plugins ran; the simTime is pushed
+      // before them
+      dataBroker->registerTriggeredReceiver(this, "mars_sim", "simTime",
+                                            "mars_sim/postPhysicsUpdate",
+                                            CALLBACK_STEP_END);
+      startServer();
+    }
+
+    DataBrokerBridge::~DataBrokerBridge() {
+      stopServer();
+      if(cfg) {
+        cfg->unregisterFromParam(cfgTcpPort.paramId, this);
+        cfg->unregisterFromParam(cfgTcpAllInterfaces.paramId, this);
+        cfg->unregisterFromParam(cfgUnixSocket.paramId, this);
+        cfg->unregisterFromParam(cfgMaxQueuedSteps.paramId, this);
+        cfg->unregisterFromParam(cfgDropPolicy.paramId, this);
+        cfg->unregisterFromParam(cfgAllowPush.paramId, this);
+        libManager->releaseLibrary("cfg_manager");
+      }
+      if(dataBroker) {
+        dataBroker->unregisterTriggeredReceiver(this, "mars_sim", "simTime",
+                                                "mars_sim/postPhysicsUpdate");
+        libManager->releaseLibrary("data_broker");
+      }
+    }
+
+    bool DataBrokerBridge::startServer() {
+      if(!dataBroker || isRunning()) return false;
+      int port = cfg ? cfgTcpPort.iValue : 7090;
+      bool allInterfaces = cfg ? cfgTcpAllInterfaces.bValue : false;
+      unixSocketPath = cfg ? cfgUnixSocket.sValue : std::string("");
+
+      if(port > 0) {
+        tcpSocket = net::listenTCP(port, allInterfaces);
+        if(tcpSocket < 0) {
+          fprintf(stderr, "DataBrokerBridge: could not listen on port %d\n",
+                  port);
+        }
+      }
+      if(!unixSocketPath.empty()) {
+        unixSocket = net::listenUnix(unixSocketPath);
+        if(unixSocket < 0) {
+          fprintf(stderr, "DataBrokerBridge: could not listen on \"%s\"\n",
+                  unixSocketPath.c_str());
+        }
+      }
+      if(tcpSocket < 0 && unixSocket < 0) return false;
+
+      if(pipe(wakePipe) != 0) {
+        fprintf(stderr, "DataBrokerBridge: could not create wake pipe\n");
+        stopServer();
+        return false;
+      }
+      net::setNonBlocking(wakePipe[0]);
+      net::setNonBlocking(wakePipe[1]);
+      if(tcpSocket >= 0) net::setNonBlocking(tcpSocket);
+      if(unixSocket >= 0) net::setNonBlocking(unixSocket);
+      stop = false;
+      start();
+      return true;
+    }
+
+    void DataBrokerBridge::stopServer() {
+      if(isRunning()) {
+        stop = true;
+        wake();
+        wait();
+      }
+      // the IO thread is gone; the connections can be closed from here
+      while(!connections.empty()) {
+        closeConnection(connections.front());
+      }
+      net::close(tcpSocket);
+      net::close(unixSocket);
+      if(unixSocket >= 0) unlink(unixSocketPath.c_str());
+      net::close(wakePipe[0]);
+      net::close(wakePipe[1]);
+      tcpSocket = unixSocket = -1;
+      wakePipe[0] = wakePipe[1] = -1;
+    }
+
+    unsigned long DataBrokerBridge::getNumConnections() {
+      MutexLocker locker(&connectionsMutex);
+      return connections.size();
+    }
+
+    void DataBrokerBridge::wake() {
+      char c = 0;
+      // a full pipe already wakes the IO thread
+      if(write(wakePipe[1], &c, 1) < 0) return;
+    }
+
+    Connection* DataBrokerBridge::newConnection(int fd) {
+      Connection *c = new Connection;
+      c->fd = fd;
+      c->id = nextConnectionId++;
+      c->numSubscriptions = 0;
+      c->sequence = 0;
+      c->droppedSteps = 0;
+      c->closing = false;
+      c->sending = NULL;
+      c->sendOffset = 0;
+      c->current = getFreeStep(c);
+      frame::writeHello(&c->control);
+      net::setNonBlocking(fd);
+
+      MutexLocker locker(&connectionsMutex);
+      connections.push_back(c);
+      return c;
+    }
+
+    void DataBrokerBridge::closeConnection(Connection *c) {
+      // after unregistering no sample can arrive for the connection anymore
+      while(!c->subscriptions.empty()) {
+        unsubscribe(c, c->subscriptions.front());
+      }
+      connectionsMutex.lock();
+      connections.remove(c);
+      connectionsMutex.unlock();
+
+      net::close(c->fd);
+      if(c->droppedSteps) {
+        fprintf(stderr, "DataBrokerBridge: client %lu dropped %lu of %lu "
+                "steps because it could not keep up\n", c->id,
+                c->droppedSteps, (unsigned long)c->sequence);
+        dataBroker->pushWarning("DataBrokerBridge: client %lu dropped %lu "
+                                "steps", c->id, c->droppedSteps);
+      }
+      delete c->current;
+      delete c->sending;
+      std::list<StepBuffer*>::iterator it;
+      for(it=c->queue.begin(); it!=c->queue.end(); ++it) delete *it;
+      for(it=c->freeBuffers.begin(); it!=c->freeBuffers.end(); ++it) {
+        delete *it;
+      }
+      delete c;
+    }
+
+    StepBuffer* DataBrokerBridge::getFreeStep(Connection *c) {
+      StepBuffer *step;
+      if(c->freeBuffers.empty()) {
+        step = new StepBuffer;
+      } else {
+        step = c->freeBuffers.front();
+        c->freeBuffers.pop_front();
+      }
+      step->data.clear();
+      step->numSamples = 0;
+      frame::beginStep(&step->data);
+      return step;
+    }
+
+    // has to be called with c->mutex locked
+    void DataBrokerBridge::finishStep(Connection *c, double simTime) {
+      StepBuffer *step = c->current;
+      frame::endStep(&step->data, 0, c->sequence++, simTime,
+                     step->numSamples);
+      if(c->queue.size() >= maxQueuedSteps) {
+        ++c->droppedSteps;
+        ++droppedSteps;
+        switch(dropPolicy) {
+        case DROP_OLDEST:
+          c->freeBuffers.push_back(c->queue.front());
+          c->queue.pop_front();
+          c->queue.push_back(step);
+          break;
+        case DROP_NEWEST:
+          c->freeBuffers.push_back(step);
+          break;
+        case DROP_DISCONNECT:
+          c->freeBuffers.push_back(step);
+          c->closing = true;
+          break;
+        }
+      } else {
+        c->queue.push_back(step);
+      }
+      c->current = getFreeStep(c);
+    }
+
+    // has to be called with c->mutex locked
+    uint32_t DataBrokerBridge::addSchema(Connection *c, const DataInfo &info,
+                                         const DataPackage &package) {
+      StreamSchema schema;
+      schema.streamIndex = c->schemas.size();
+      schema.groupName = info.groupName;
+      schema.dataName = info.dataName;
+      schema.flags = info.flags;
+      schema.items.resize(package.size());
+      for(size_t i=0; i<package.size(); ++i) {
+        schema.items[i].name = package[i].getName();
+        schema.items[i].type = package[i].type;
+      }
+      c->schemas.push_back(schema);
+      frame::writeSchema(&c->control, schema);
+      return schema.streamIndex;
+    }
+
+    void DataBrokerBridge::addSample(Subscription *subscription,
+                                     const DataInfo &info,
+                                     const DataPackage &package) {
+      Connection *c = subscription->connection;
+      MutexLocker locker(&c->mutex);
+      if(c->closing) return;
+
+      std::map<unsigned long, SentStream>::iterator it;
+      it = c->streams.find(info.dataId);
+      if(it == c->streams.end()) {
+        SentStream stream;
+        stream.streamIndex = addSchema(c, info, package);
+        stream.owner = subscription;
+        c->streams[info.dataId] = stream;
+      } else if(it->second.owner != subscription) {
+        // matched by more than one pattern of the client
+        return;
+      } else if(!c->schemas[it->second.streamIndex].matches(package)) {
+        // the layout of the stream changed
+        it->second.streamIndex = addSchema(c, info, package);
+      }
+      frame::addSample(&c->current->data, c->streams[info.dataId].streamIndex,
+                       package);
+      ++c->current->numSamples;
+      if(c->current->data.size() >= MAX_FRAME_SIZE / 2) {
+        // no simTime for a long time (e.g. the simulation is paused)
+        finishStep(c, simTime);
+        wake();
+      }
+    }
+
+    void DataBrokerBridge::receiveData(const DataInfo &info,
+                                       const DataPackage &dataPackage,
+                                       int callbackParam) {
+      if(callbackParam != CALLBACK_STEP_END) return;
+      dataPackage.get(0, &simTime);
+
+      // the Simulator triggers postPhysicsUpdate at the end of each step,
+      // after the plugins and parallel plugins pushed their samples
+      bool finished = false;
+      connectionsMutex.lock();
+      std::list<Connection*>::iterator it;
+      for(it=connections.begin(); it!=connections.end(); ++it) {
+        Connection *c = *it;
+        MutexLocker locker(&c->mutex);
+        if(c->numSubscriptions && !c->closing) {
+          finishStep(c, simTime);
+          finished = true;
+        }
+      }
+      connectionsMutex.unlock();
+      if(finished) wake();
+    }
+
+    void DataBrokerBridge::subscribe(Connection *c,
+                                     const std::string &groupPattern,
+                                     const std::string &dataPattern) {
+      Subscription *subscription = new Subscription(this, c, groupPattern,
+                                                    dataPattern);
+      c->subscriptions.push_back(subscription);
+      c->mutex.lock();
+      ++c->numSubscriptions;
+      c->mutex.unlock();
+      dataBroker->registerSyncReceiver(subscription, groupPattern,
+                                       dataPattern, 0);
+    }
+
+    void DataBrokerBridge::unsubscribe(Connection *c,
+                                       Subscription *subscription) {
+      dataBroker->unregisterSyncReceiver(subscription,
+                                         subscription->groupPattern,
+                                         subscription->dataPattern);
+      c->mutex.lock();
+      --c->numSubscriptions;
+      // another pattern of the client may still match these streams
+      std::map<unsigned long, SentStream>::iterator it;
+      for(it=c->streams.begin(); it!=c->streams.end(); ) {
+        if(it->second.owner == subscription) c->streams.erase(it++);
+        else ++it;
+      }
+      c->mutex.unlock();
+      c->subscriptions.remove(subscription);
+      delete subscription;
+    }
+
+    bool DataBrokerBridge::handleFrame(Connection *c, uint8_t type,
+                                       const char *payload,
+                                       const char *end) {
+      switch(type) {
+      case FRAME_SUBSCRIBE:
+      case FRAME_UNSUBSCRIBE: {
+        std::string groupPattern, dataPattern;
+        if(!frame::getString(&payload, end, &groupPattern) ||
+           !frame::getString(&payload, end, &dataPattern)) {
+          return false;
+        }
+        if(type == FRAME_SUBSCRIBE) {
+          subscribe(c, groupPattern, dataPattern);
+          return true;
+        }
+        std::list<Subscription*>::iterator it;
+        for(it=c->subscriptions.begin(); it!=c->subscriptions.end(); ++it) {
+          if((*it)->groupPattern == groupPattern &&
+             (*it)->dataPattern == dataPattern) {
+            unsubscribe(c, *it);
+            break;
+          }
+        }
+        return true;
+      }
+      case FRAME_SCHEMA: {
+        RemoteStream stream;
+        if(!serialize::readSchema(&payload, end, &stream.schema)) {
+          return false;
+        }
+        serialize::preparePackage(stream.schema, &stream.package);
+        stream.dataId = 0;
+        c->remoteStreams[stream.schema.streamIndex] = stream;
+        return true;
+      }
+      case FRAME_PUSH: {
+        uint32_t streamIndex;
+        if(!frame::getUInt32(&payload, end, &streamIndex)) return false;
+        std::map<uint32_t, RemoteStream>::iterator it;
+        it = c->remoteStreams.find(streamIndex);
+        if(it == c->remoteStreams.end()) return false;
+        RemoteStream &stream = it->second;
+        if(!serialize::readValues(&payload, end, stream.schema,
+                                  &stream.package)) {
+          return false;
+        }
+        if(!allowPush) return true;
+        if(stream.dataId) {
+          dataBroker->pushData(stream.dataId, stream.package, this);
+        } else {
+          stream.dataId = dataBroker->pushData(stream.schema.groupName,
+                                               stream.schema.dataName,
+                                               stream.package, this,
+                                               stream.schema.flags);
+        }
+        return true;
+      }
+      default:
+        fprintf(stderr, "DataBrokerBridge: client %lu sent unknown frame "
+                "type %d\n", c->id, (int)type);
+        return false;
+      }
+    }
+
+    bool DataBrokerBridge::readFrom(Connection *c) {
+      std::vector<char> &received = c->received;
+      while(true) {
+        size_t size = received.size();
+        received.resize(size + receiveChunk);
+        ssize_t n = recv(c->fd, &received[size], receiveChunk, 0);
+        received.resize(size + (n > 0 ? n : 0));
+        if(n > 0) continue;
+        if(n == 0) return false;
+        if(errno == EINTR) continue;
+        if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+      }
+
+      const char *pos = received.empty() ? NULL : &received[0];
+      const char *end = pos + received.size();
+      const char *payload, *payloadEnd;
+      uint8_t type;
+      bool error;
+      while(frame::next(&pos, end, &type, &payload, &payloadEnd, &error)) {
+        if(!handleFrame(c, type, payload, payloadEnd)) return false;
+      }
+      if(error) return false;
+      if(pos) received.erase(received.begin(), received.begin() +
+                             (pos - &received[0]));
+      return true;
+    }
+
+    bool DataBrokerBridge::hasOutgoing(Connection *c) {
+      if(c->sending || !c->sendControl.empty()) return true;
+      MutexLocker locker(&c->mutex);
+      return !c->control.empty() || !c->queue.empty();
+    }
+
+    bool DataBrokerBridge::writeTo(Connection *c) {
+      while(true) {
+        if(!c->sending && c->sendControl.empty()) {
+          MutexLocker locker(&c->mutex);
+          if(!c->control.empty()) {
+            // schemas have to arrive before the steps that use them
+            c->sendControl.swap(c->control);
+          } else if(!c->queue.empty()) {
+            c->sending = c->queue.front();
+            c->queue.pop_front();
+          } else {
+            return true;
+          }
+          c->sendOffset = 0;
+        }
+        std::vector<char> &data = (c->sending ? c->sending->data
+                                              : c->sendControl);
+        ssize_t n = send(c->fd, &data[c->sendOffset],
+                         data.size() - c->sendOffset, MSG_NOSIGNAL);
+        if(n < 0) {
+          if(errno == EINTR) continue;
+          return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        c->sendOffset += n;
+        if(c->sendOffset < data.size()) continue;
+        if(c->sending) {
+          MutexLocker locker(&c->mutex);
+          c->freeBuffers.push_back(c->sending);
+          c->sending = NULL;
+        } else {
+          c->sendControl.clear();
+        }
+      }
+    }
+
+    void DataBrokerBridge::run() {
+      std::vector<struct pollfd> fds;
+      std::vector<Connection*> polled;
+      struct pollfd p;
+      char buffer[64];
+
+      while(!stop) {
+        fds.clear();
+        polled.clear();
+        p.events = POLLIN;
+        p.revents = 0;
+        p.fd = wakePipe[0];
+        fds.push_back(p);
+        if(tcpSocket >= 0) {
+          p.fd = tcpSocket;
+          fds.push_back(p);
+        }
+        if(unixSocket >= 0) {
+          p.fd = unixSocket;
+          fds.push_back(p);
+        }
+        size_t firstConnection = fds.size();
+        // only the IO thread modifies the list, so no lock is needed here
+        std::list<Connection*>::iterator it;
+        for(it=connections.begin(); it!=connections.end(); ++it) {
+          p.fd = (*it)->fd;
+          p.events = POLLIN | (hasOutgoing(*it) ? POLLOUT : 0);
+          fds.push_back(p);
+          polled.push_back(*it);
+        }
+
+        if(poll(&fds[0], fds.size(), 100) < 0) {
+          if(errno == EINTR) continue;
+          fprintf(stderr, "DataBrokerBridge: poll failed\n");
+          break;
+        }
+
+        while(read(wakePipe[0], buffer, sizeof(buffer)) > 0) {}
+        for(size_t i=1; i<firstConnection; ++i) {
+          if(!(fds[i].revents & POLLIN)) continue;
+          int fd;
+          while((fd = net::accept(fds[i].fd)) >= 0) {
+            Connection *c = newConnection(fd);
+            fprintf(stderr, "DataBrokerBridge: client %lu connected\n",
+                    c->id);
+          }
+        }
+        for(size_t i=0; i<polled.size(); ++i) {
+          Connection *c = polled[i];
+          short revents = fds[firstConnection+i].revents;
+          bool ok = !(revents & (POLLERR | POLLNVAL));
+          if(ok && (revents & (POLLIN | POLLHUP))) ok = readFrom(c);
+          // the queue may have been filled since poll() was called
+          if(ok) ok = writeTo(c);
+          c->mutex.lock();
+          ok = ok && !c->closing;
+          c->mutex.unlock();
+          if(!ok) {
+            fprintf(stderr, "DataBrokerBridge: client %lu disconnected\n",
+                    c->id);
+            closeConnection(c);
+          }
+        }
+      }
+    }
+
+    void DataBrokerBridge::cfgUpdateProperty(cfgPropertyStruct _property) {
+      if(_property.paramId == cfgTcpPort.paramId) {
+        cfgTcpPort.iValue = _property.iValue;
+        stopServer();
+        startServer();
+      } else if(_property.paramId == cfgTcpAllInterfaces.paramId) {
+        cfgTcpAllInterfaces.bValue = _property.bValue;
+        stopServer();
+        startServer();
+      } else if(_property.paramId == cfgUnixSocket.paramId) {
+        cfgUnixSocket.sValue = _property.sValue;
+        stopServer();
+        startServer();
+      } else if(_property.paramId == cfgMaxQueuedSteps.paramId) {
+        cfgMaxQueuedSteps.iValue = _property.iValue;
+        maxQueuedSteps = _property.iValue > 0 ? _property.iValue : 1;
+      } else if(_property.paramId == cfgDropPolicy.paramId) {
+        cfgDropPolicy.sValue = _property.sValue;
+        dropPolicy = dropPolicyFromString(_property.sValue);
+      } else if(_property.paramId == cfgAllowPush.paramId) {
+        cfgAllowPush.bValue = _property.bValue;
+        allowPush = _property.bValue;
+      }
+    }
+
+  } // end of namespace data_broker_bridge
+} // end of namespace mars
+
+DESTROY_LIB(mars::data_broker_bridge::DataBrokerBridge);
+CREATE_LIB(mars::data_broker_bridge::DataBrokerBridge);
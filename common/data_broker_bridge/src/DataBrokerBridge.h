@@ -0,0 +1,242 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerBridge.h
+ * \brief Serves DataBroker streams to other processes.
+ *
+ * Clients connect via TCP or a Unix domain socket, subscribe to group/data
+ * patterns and receive all matching samples batched per simulation step
+ * (see BridgeProtocol.h). Clients can also push command streams back into
+ * the DataBroker.
+ *
+ * The samples are serialized on the thread that pushes them into the
+ * step buffer of each connection. A finished step is queued and sent by
+ * the IO thread of the bridge. If a client does not read fast enough its
+ * queue fills up and the drop policy decides what happens; the pushing
+ * thread never waits for a socket.
+ *
+ * The bridge is configured via the cfg_manager group "DataBrokerBridge":
+ *  - tcpPort: TCP port to listen on, 0 disables TCP
+ *  - tcpAllInterfaces: listen on all interfaces instead of the loopback
+ *  - unixSocket: path of a Unix domain socket, empty disables it
+ *  - maxQueuedSteps: steps queued per client before steps are dropped
+ *  - dropPolicy: "dropOldest", "dropNewest" or "disconnect"
+ *  - allowPush: whether clients may push data into the DataBroker
+ *
+ * The bridge uses POSIX sockets and is not available on Windows.
+ */
+
+#ifndef DATA_BROKER_BRIDGE_H
+#define DATA_BROKER_BRIDGE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "DataBrokerBridge.h"
+#endif
+
+#include "BridgeProtocol.h"
+
+#include <lib_manager/LibInterface.hpp>
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/cfg_manager/CFGClient.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+namespace mars {
+  namespace data_broker_bridge {
+
+    class DataBrokerBridge;
+    struct Connection;
+
+    enum DropPolicy {
+      DROP_OLDEST,
+      DROP_NEWEST,
+      DROP_DISCONNECT
+    };
+
+    /**
+     * \brief one subscribed pattern of a connection; registered as its own
+     *        receiver so that it can be unregistered independently.
+     */
+    class Subscription : public data_broker::ReceiverInterface {
+    public:
+      Subscription(DataBrokerBridge *bridge, Connection *connection,
+                   const std::string &groupPattern,
+                   const std::string &dataPattern)
+        : bridge(bridge), connection(connection),
+          groupPattern(groupPattern), dataPattern(dataPattern) {}
+
+      void receiveData(const data_broker::DataInfo &info,
+                       const data_broker::DataPackage &dataPackage,
+                       int callbackParam);
+
+      DataBrokerBridge *bridge;
+      Connection *connection;
+      std::string groupPattern, dataPattern;
+    }; // end of class Subscription
+
+    /** \brief the serialized samples of one simulation step */
+    struct StepBuffer {
+      std::vector<char> data;
+      uint32_t numSamples;
+    };
+
+    /** \brief a stream the client announced to push commands */
+    struct RemoteStream {
+      data_broker_recorder::StreamSchema schema;
+      data_broker::DataPackage package;
+      unsigned long dataId;
+    };
+
+    /** \brief a stream that is sent to the client */
+    struct SentStream {
+      uint32_t streamIndex;
+      /** the subscription that delivers the stream; others ignore it */
+      Subscription *owner;
+    };
+
+    struct Connection {
+      int fd;
+      unsigned long id;
+
+      // written by the pushing threads, guarded by mutex
+      utils::Mutex mutex;
+      StepBuffer *current;
+      std::list<StepBuffer*> queue;
+      std::list<StepBuffer*> freeBuffers;
+      /** schema frames; never dropped and always sent before the steps */
+      std::vector<char> control;
+      std::map<unsigned long, SentStream> streams;
+      std::vector<data_broker_recorder::StreamSchema> schemas;
+      unsigned int numSubscriptions;
+      uint64_t sequence;
+      unsigned long droppedSteps;
+      bool closing;
+
+      // only used by the IO thread
+      std::vector<char> sendControl;
+      StepBuffer *sending;
+      size_t sendOffset;
+      std::vector<char> received;
+      std::list<Subscription*> subscriptions;
+      std::map<uint32_t, RemoteStream> remoteStreams;
+    };
+
+    class DataBrokerBridge : public lib_manager::LibInterface,
+                             public data_broker::ReceiverInterface,
+                             public cfg_manager::CFGClient,
+                             public utils::Thread {
+
+    public:
+      DataBrokerBridge(lib_manager::LibManager *theManager);
+      virtual ~DataBrokerBridge();
+
+      // LibInterface methods
+      int getLibVersion() const {return 1;}
+      const std::string getLibName() const {
+        return std::string("data_broker_bridge");
+      }
+      CREATE_MODULE_INFO();
+
+      /**
+       * \brief opens the configured sockets and starts the IO thread.
+       * \return \c false if no socket could be opened.
+       */
+      bool startServer();
+      /** \brief closes all connections and the listening sockets */
+      void stopServer();
+      bool isServing() const {return isRunning();}
+
+      unsigned long getNumConnections();
+      /** \brief steps dropped for all connections since the start */
+      unsigned long getDroppedSteps() const {return droppedSteps;}
+
+      /**
+       * \brief serializes a sample into the current step of the
+       *        connection of \a subscription.
+       */
+      void addSample(Subscription *subscription,
+                     const data_broker::DataInfo &info,
+                     const data_broker::DataPackage &package);
+
+      // DataBroker method
+      void receiveData(const data_broker::DataInfo &info,
+                       const data_broker::DataPackage &dataPackage,
+                       int callbackParam);
+
+      // CFGClient method
+      void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
+
+    protected:
+      void run();
+
+    private:
+      enum CallbackParam {
+        CALLBACK_STEP_END
+      };
+
+      Connection* newConnection(int fd);
+      void closeConnection(Connection *c);
+      void finishStep(Connection *c, double simTime);
+      StepBuffer* getFreeStep(Connection *c);
+      uint32_t addSchema(Connection *c, const data_broker::DataInfo &info,
+                         const data_broker::DataPackage &package);
+      bool hasOutgoing(Connection *c);
+      bool readFrom(Connection *c);
+      bool writeTo(Connection *c);
+      bool handleFrame(Connection *c, uint8_t type,
+                       const char *payload, const char *end);
+      void subscribe(Connection *c, const std::string &groupPattern,
+                     const std::string &dataPattern);
+      void unsubscribe(Connection *c, Subscription *subscription);
+      void wake();
+
+      data_broker::DataBrokerInterface *dataBroker;
+      cfg_manager::CFGManagerInterface *cfg;
+
+      utils::Mutex connectionsMutex;
+      std::list<Connection*> connections;
+      int tcpSocket, unixSocket;
+      int wakePipe[2];
+      std::string unixSocketPath;
+      unsigned long nextConnectionId;
+      unsigned long droppedSteps;
+      unsigned int maxQueuedSteps;
+      DropPolicy dropPolicy;
+      bool allowPush;
+      double simTime;
+      bool stop;
+
+      cfg_manager::cfgPropertyStruct cfgTcpPort, cfgTcpAllInterfaces;
+      cfg_manager::cfgPropertyStruct cfgUnixSocket, cfgMaxQueuedSteps;
+      cfg_manager::cfgPropertyStruct cfgDropPolicy, cfgAllowPush;
+    }; // end of class DataBrokerBridge
+
+  } // end of namespace data_broker_bridge
+} // end of namespace mars
+
+#endif // DATA_BROKER_BRIDGE_H
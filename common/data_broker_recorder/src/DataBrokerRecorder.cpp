@@ -0,0 +1,389 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DataBrokerRecorder.h"
+
+#include <mars/utils/MutexLocker.h>
+#include <mars/utils/misc.h>
+
+#include <cstdio>
+#include <zlib.h>
+
+namespace mars {
+  namespace data_broker_recorder {
+
+    using namespace mars::utils;
+    using namespace mars::data_broker;
+    using namespace mars::cfg_manager;
+
+    LogReplayer::LogReplayer(DataBrokerRecorder *recorder,
+                             DataBrokerInterface *dataBroker)
+      : recorder(recorder), dataBroker(dataBroker), speed(1.0),
+        startTime(0.0), lastSimTime(0.0), stepSimTimer(true), stop(false) {
+    }
+
+    LogReplayer::~LogReplayer() {
+      stopReplay();
+    }
+
+    bool LogReplayer::startReplay(const std::string &filename, double speed,
+                                  double startTime, bool stepSimTimer) {
+      if(isRunning()) return false;
+      if(!reader.open(filename)) return false;
+      this->speed = speed;
+      this->startTime = startTime;
+      this->stepSimTimer = stepSimTimer;
+      streams.clear();
+      stop = false;
+      start();
+      return true;
+    }
+
+    void LogReplayer::stopReplay() {
+      stop = true;
+      if(isRunning()) wait();
+      reader.close();
+    }
+
+    void LogReplayer::run() {
+      std::vector<char> records;
+      const StreamSchema *schema;
+      const std::vector<ChunkInfo> &chunks = reader.getChunks();
+      long long wallStart = getTime();
+      bool started = false;
+      double simStart = startTime;
+      double t;
+
+      for(size_t i=reader.findChunk(startTime); i<chunks.size() && !stop; ++i) {
+        if(!reader.readChunk(i, &records)) {
+          fprintf(stderr, "DataBrokerRecorder: error reading chunk %lu\n",
+                  (unsigned long)i);
+          break;
+        }
+        const char *pos = records.empty() ? NULL : &records[0];
+        const char *end = pos + records.size();
+        while(!stop && (schema = reader.nextSample(&pos, end, &t))) {
+          std::map<uint32_t, ReplayStream>::iterator it;
+          it = streams.find(schema->streamIndex);
+          if(it == streams.end()) {
+            ReplayStream stream;
+            stream.dataId = 0;
+            serialize::preparePackage(*schema, &stream.package);
+            it = streams.insert(std::make_pair(schema->streamIndex,
+                                               stream)).first;
+          }
+          if(!serialize::readValues(&pos, end, *schema, &it->second.package)) {
+            stop = true;
+            break;
+          }
+          if(t < startTime) continue;
+          if(!started) {
+            started = true;
+            simStart = lastSimTime = t;
+          }
+          if(speed > 0.0) {
+            long long target = wallStart + (long long)((t - simStart) / speed);
+            long long now;
+            // sleep in small slices to stay responsive to stopReplay()
+            while(!stop && (now = getTime()) < target) {
+              msleep(target - now < 10 ? target - now : 10);
+            }
+          }
+          publish(*schema, &it->second);
+        }
+      }
+    }
+
+    void LogReplayer::publish(const StreamSchema &schema,
+                              ReplayStream *stream) {
+      if(stream->dataId) {
+        dataBroker->pushData(stream->dataId, stream->package, recorder);
+      } else {
+        stream->dataId = dataBroker->pushData(schema.groupName,
+                                              schema.dataName,
+                                              stream->package, recorder,
+                                              schema.flags);
+      }
+      if(stepSimTimer && schema.groupName == "mars_sim" &&
+         schema.dataName == "simTime") {
+        // drive timed receivers as the Simulator would do in step()
+        double simTime;
+        if(stream->package.get(0, &simTime)) {
+          long dt = (long)(simTime - lastSimTime);
+          if(dt > 0) {
+            dataBroker->stepTimer("mars_sim/simTimer", dt);
+            lastSimTime += dt;
+          }
+        }
+      }
+    }
+
+
+    DataBrokerRecorder::DataBrokerRecorder(lib_manager::LibManager *theManager)
+      : lib_manager::LibInterface(theManager), dataBroker(NULL), cfg(NULL),
+        replayer(NULL), currentChunk(NULL), simTime(0.0), recording(false),
+        chunkSize(1 << 20), numSamples(0) {
+
+      dataBroker = libManager->getLibraryAs<DataBrokerInterface>("data_broker");
+      if(!dataBroker) {
+        fprintf(stderr, "DataBrokerRecorder: could not find data_broker\n");
+        return;
+      }
+      replayer = new LogReplayer(this, dataBroker);
+
+      cfg = libManager->getLibraryAs<CFGManagerInterface>("cfg_manager");
+      if(cfg) {
+        std::string group = "DataBrokerRecorder";
+        cfgFile = cfg->getOrCreateProperty(group, "file",
+                                           std::string("recording.mdbr"), this);
+        cfgGroupPattern = cfg->getOrCreateProperty(group, "groupPattern",
+                                                   std::string("*"), this);
+        cfgDataPattern = cfg->getOrCreateProperty(group, "dataPattern",
+                                                  std::string("*"), this);
+        cfgCompression = cfg->getOrCreateProperty(group, "compressionLevel",
+                                                  (int)Z_BEST_SPEED, this);
+        cfgChunkSize = cfg->getOrCreateProperty(group, "chunkSize",
+                                                (int)chunkSize, this);
+        cfgMaxPending = cfg->getOrCreateProperty(group, "maxPendingChunks",
+                                                 64, this);
+        cfgReplaySpeed = cfg->getOrCreateProperty(group, "replaySpeed",
+                                                  1.0, this);
+        cfgReplayStart = cfg->getOrCreateProperty(group, "replayStart",
+                                                  0.0, this);
+        cfgStepSimTimer = cfg->getOrCreateProperty(group, "stepSimTimer",
+                                                   true, this);
+        cfgRecord = cfg->getOrCreateProperty(group, "record", false, this);
+        cfgReplay = cfg->getOrCreateProperty(group, "replay", false, this);
+        chunkSize = cfgChunkSize.iValue;
+        if(cfgRecord.bValue) {
+          startRecording(cfgFile.sValue, cfgGroupPattern.sValue,
+                         cfgDataPattern.sValue);
+        } else if(cfgReplay.bValue) {
+          startReplay(cfgFile.sValue, cfgReplaySpeed.dValue,
+                      cfgReplayStart.dValue);
+        }
+      }
+    }
+
+    DataBrokerRecorder::~DataBrokerRecorder() {
+      stopRecording();
+      if(replayer) {
+        stopReplay();
+        delete replayer;
+      }
+      if(cfg) {
+        cfg->unregisterFromParam(cfgFile.paramId, this);
+        cfg->unregisterFromParam(cfgGroupPattern.paramId, this);
+        cfg->unregisterFromParam(cfgDataPattern.paramId, this);
+        cfg->unregisterFromParam(cfgCompression.paramId, this);
+        cfg->unregisterFromParam(cfgChunkSize.paramId, this);
+        cfg->unregisterFromParam(cfgMaxPending.paramId, this);
+        cfg->unregisterFromParam(cfgReplaySpeed.paramId, this);
+        cfg->unregisterFromParam(cfgReplayStart.paramId, this);
+        cfg->unregisterFromParam(cfgStepSimTimer.paramId, this);
+        cfg->unregisterFromParam(cfgRecord.paramId, this);
+        cfg->unregisterFromParam(cfgReplay.paramId, this);
+        libManager->releaseLibrary("cfg_manager");
+      }
+      if(dataBroker) libManager->releaseLibrary("data_broker");
+    }
+
+    bool DataBrokerRecorder::startRecording(const std::string &filename,
+                                            const std::string &groupPattern,
+                                            const std::string &dataPattern) {
+      if(!dataBroker || recording) return false;
+      int compressionLevel = cfg ? cfgCompression.iValue : Z_BEST_SPEED;
+      unsigned int maxPending = cfg ? cfgMaxPending.iValue : 64;
+      if(!writer.open(filename, compressionLevel, maxPending)) return false;
+
+      recordMutex.lock();
+      recordedStreams.clear();
+      schemas.clear();
+      chunkSchemas.clear();
+      numSamples = 0;
+      currentChunk = writer.getFreeChunk();
+      currentChunk->data.reserve(chunkSize + chunkSize/4);
+      this->groupPattern = groupPattern;
+      this->dataPattern = dataPattern;
+      recording = true;
+      recordMutex.unlock();
+
+      dataBroker->registerSyncReceiver(this, "mars_sim", "simTime",
+                                       CALLBACK_SIM_TIME);
+      dataBroker->registerSyncReceiver(this, groupPattern, dataPattern,
+                                       CALLBACK_RECORD);
+      return true;
+    }
+
+    void DataBrokerRecorder::stopRecording() {
+      if(!recording) return;
+      dataBroker->unregisterSyncReceiver(this, groupPattern, dataPattern);
+      dataBroker->unregisterSyncReceiver(this, "mars_sim", "simTime");
+
+      recordMutex.lock();
+      recording = false;
+      flushChunk();
+      recordMutex.unlock();
+      writer.close(schemas);
+
+      fprintf(stderr, "DataBrokerRecorder: wrote %lu samples of %lu streams "
+              "in %lu chunks (%lu bytes)",
+              numSamples, (unsigned long)schemas.size(),
+              writer.getWrittenChunks(),
+              (unsigned long)writer.getBytesWritten());
+      if(writer.getDroppedChunks()) {
+        fprintf(stderr, "; dropped %lu chunks because the writer could not "
+                "keep up", writer.getDroppedChunks());
+        dataBroker->pushWarning("DataBrokerRecorder: dropped %lu chunks",
+                                writer.getDroppedChunks());
+      }
+      fprintf(stderr, "\n");
+    }
+
+    bool DataBrokerRecorder::startReplay(const std::string &filename,
+                                         double speed, double startTime) {
+      if(!replayer) return false;
+      bool stepSimTimer = cfg ? cfgStepSimTimer.bValue : true;
+      return replayer->startReplay(filename, speed, startTime, stepSimTimer);
+    }
+
+    void DataBrokerRecorder::stopReplay() {
+      if(replayer) replayer->stopReplay();
+    }
+
+    void DataBrokerRecorder::receiveData(const DataInfo &info,
+                                         const DataPackage &dataPackage,
+                                         int callbackParam) {
+      if(callbackParam == CALLBACK_SIM_TIME) {
+        dataPackage.get(0, &simTime);
+        return;
+      }
+
+      MutexLocker locker(&recordMutex);
+      if(!recording) return;
+
+      uint32_t streamIndex;
+      std::map<unsigned long, RecordedStream>::iterator it;
+      it = recordedStreams.find(info.dataId);
+      if(it == recordedStreams.end() ||
+         !schemas[it->second.streamIndex].matches(dataPackage)) {
+        // new stream or the layout of the stream changed
+        streamIndex = addSchema(info, dataPackage);
+        recordedStreams[info.dataId].streamIndex = streamIndex;
+      } else {
+        streamIndex = it->second.streamIndex;
+      }
+
+      if(currentChunk->numRecords == 0) {
+        currentChunk->firstTime = simTime;
+      }
+      serialize::writeSample(&currentChunk->data, streamIndex, simTime,
+                             dataPackage);
+      currentChunk->lastTime = simTime;
+      ++currentChunk->numRecords;
+      ++numSamples;
+      if(currentChunk->data.size() >= chunkSize) {
+        flushChunk();
+      }
+    }
+
+    uint32_t DataBrokerRecorder::addSchema(const DataInfo &info,
+                                           const DataPackage &package) {
+      StreamSchema schema;
+      schema.streamIndex = schemas.size();
+      schema.groupName = info.groupName;
+      schema.dataName = info.dataName;
+      schema.flags = info.flags;
+      schema.items.resize(package.size());
+      for(size_t i=0; i<package.size(); ++i) {
+        schema.items[i].name = package[i].getName();
+        schema.items[i].type = package[i].type;
+      }
+      schemas.push_back(schema);
+      chunkSchemas.push_back(schema.streamIndex);
+      serialize::writeSchema(&currentChunk->data, schema);
+      return schema.streamIndex;
+    }
+
+    void DataBrokerRecorder::flushChunk() {
+      if(!currentChunk) return;
+      if(currentChunk->numRecords) {
+        bool written = writer.pushChunk(currentChunk);
+        currentChunk = recording ? writer.getFreeChunk() : NULL;
+        if(written) {
+          chunkSchemas.clear();
+        } else if(currentChunk) {
+          // later samples can not be decoded without their schemas
+          for(size_t i=0; i<chunkSchemas.size(); ++i) {
+            serialize::writeSchema(&currentChunk->data,
+                                   schemas[chunkSchemas[i]]);
+          }
+        }
+      } else if(!recording) {
+        writer.pushChunk(currentChunk);
+        currentChunk = NULL;
+      }
+    }
+
+    void DataBrokerRecorder::cfgUpdateProperty(cfgPropertyStruct _property) {
+      if(_property.paramId == cfgRecord.paramId) {
+        cfgRecord.bValue = _property.bValue;
+        if(_property.bValue) {
+          startRecording(cfgFile.sValue, cfgGroupPattern.sValue,
+                         cfgDataPattern.sValue);
+        } else {
+          stopRecording();
+        }
+      } else if(_property.paramId == cfgReplay.paramId) {
+        cfgReplay.bValue = _property.bValue;
+        if(_property.bValue) {
+          startReplay(cfgFile.sValue, cfgReplaySpeed.dValue,
+                      cfgReplayStart.dValue);
+        } else {
+          stopReplay();
+        }
+      } else if(_property.paramId == cfgFile.paramId) {
+        cfgFile.sValue = _property.sValue;
+      } else if(_property.paramId == cfgGroupPattern.paramId) {
+        cfgGroupPattern.sValue = _property.sValue;
+      } else if(_property.paramId == cfgDataPattern.paramId) {
+        cfgDataPattern.sValue = _property.sValue;
+      } else if(_property.paramId == cfgCompression.paramId) {
+        cfgCompression.iValue = _property.iValue;
+      } else if(_property.paramId == cfgChunkSize.paramId) {
+        cfgChunkSize.iValue = _property.iValue;
+        MutexLocker locker(&recordMutex);
+        chunkSize = _property.iValue;
+      } else if(_property.paramId == cfgMaxPending.paramId) {
+        cfgMaxPending.iValue = _property.iValue;
+      } else if(_property.paramId == cfgReplaySpeed.paramId) {
+        cfgReplaySpeed.dValue = _property.dValue;
+      } else if(_property.paramId == cfgReplayStart.paramId) {
+        cfgReplayStart.dValue = _property.dValue;
+      } else if(_property.paramId == cfgStepSimTimer.paramId) {
+        cfgStepSimTimer.bValue = _property.bValue;
+      }
+    }
+
+  } // end of namespace data_broker_recorder
+} // end of namespace mars
+
+DESTROY_LIB(mars::data_broker_recorder::DataBrokerRecorder);
+CREATE_LIB(mars::data_broker_recorder::DataBrokerRecorder);
@@ -0,0 +1,184 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerRecorder.h
+ * \brief Records DataBroker streams into a binary log and replays them.
+ *
+ * The recorder is configured via the cfg_manager group
+ * "DataBrokerRecorder":
+ *  - file: the log file to write or read
+ *  - groupPattern/dataPattern: wildcard patterns of the recorded streams
+ *  - record: start/stop a recording
+ *  - replay: start/stop a replay of \c file
+ *  - replaySpeed: replay speed relative to the recorded sim time.
+ *                 0 replays as fast as possible.
+ *  - replayStart: sim time in ms at which the replay starts
+ *  - compressionLevel, chunkSize, maxPendingChunks: tuning of the writer
+ */
+
+#ifndef DATA_BROKER_RECORDER_H
+#define DATA_BROKER_RECORDER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "DataBrokerRecorder.h"
+#endif
+
+#include "RecorderLog.h"
+
+#include <lib_manager/LibInterface.hpp>
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/cfg_manager/CFGClient.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace mars {
+  namespace data_broker_recorder {
+
+    class DataBrokerRecorder;
+
+    /**
+     * \brief Republishes the content of a log file via the DataBroker.
+     */
+    class LogReplayer : public utils::Thread {
+    public:
+      LogReplayer(DataBrokerRecorder *recorder,
+                  data_broker::DataBrokerInterface *dataBroker);
+      ~LogReplayer();
+
+      bool startReplay(const std::string &filename, double speed,
+                       double startTime, bool stepSimTimer);
+      void stopReplay();
+      bool isReplaying() const {return isRunning();}
+
+    protected:
+      void run();
+
+    private:
+      struct ReplayStream {
+        unsigned long dataId;
+        data_broker::DataPackage package;
+      };
+
+      void publish(const StreamSchema &schema, ReplayStream *stream);
+
+      DataBrokerRecorder *recorder;
+      data_broker::DataBrokerInterface *dataBroker;
+      LogReader reader;
+      std::map<uint32_t, ReplayStream> streams;
+      double speed, startTime, lastSimTime;
+      bool stepSimTimer;
+      /** set by stopReplay() while run() is reading */
+      volatile bool stop;
+    }; // end of class LogReplayer
+
+    class DataBrokerRecorder : public lib_manager::LibInterface,
+                               public data_broker::ReceiverInterface,
+                               public cfg_manager::CFGClient {
+
+    public:
+      DataBrokerRecorder(lib_manager::LibManager *theManager);
+      virtual ~DataBrokerRecorder();
+
+      // LibInterface methods
+      int getLibVersion() const {return 1;}
+      const std::string getLibName() const {
+        return std::string("data_broker_recorder");
+      }
+      CREATE_MODULE_INFO();
+
+      /**
+       * \brief starts recording all streams matching the patterns.
+       * \return \c false if a recording is already running or the file
+       *         could not be opened.
+       */
+      bool startRecording(const std::string &filename,
+                          const std::string &groupPattern,
+                          const std::string &dataPattern);
+      void stopRecording();
+      bool isRecording() const {return recording;}
+
+      /**
+       * \brief republishes the streams stored in \a filename.
+       * \param speed Replay speed relative to the recorded sim time.
+       *              A value <= 0 replays as fast as possible.
+       * \param startTime The sim time (in ms) from which to start.
+       */
+      bool startReplay(const std::string &filename, double speed=1.0,
+                       double startTime=0.0);
+      void stopReplay();
+
+      // DataBroker method
+      void receiveData(const data_broker::DataInfo &info,
+                       const data_broker::DataPackage &dataPackage,
+                       int callbackParam);
+
+      // CFGClient method
+      void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
+
+    private:
+      enum CallbackParam {
+        CALLBACK_RECORD,
+        CALLBACK_SIM_TIME
+      };
+
+      struct RecordedStream {
+        uint32_t streamIndex;
+      };
+
+      uint32_t addSchema(const data_broker::DataInfo &info,
+                         const data_broker::DataPackage &package);
+      void flushChunk();
+
+      data_broker::DataBrokerInterface *dataBroker;
+      cfg_manager::CFGManagerInterface *cfg;
+      LogWriter writer;
+      LogReplayer *replayer;
+
+      utils::Mutex recordMutex;
+      ChunkBuffer *currentChunk;
+      std::map<unsigned long, RecordedStream> recordedStreams;
+      std::vector<StreamSchema> schemas;
+      /**
+       * the schemas written into the current chunk; repeated in the next
+       * chunk if the current one is dropped
+       */
+      std::vector<uint32_t> chunkSchemas;
+      std::string groupPattern, dataPattern;
+      double simTime;
+      bool recording;
+      unsigned long chunkSize;
+      unsigned long numSamples;
+
+      cfg_manager::cfgPropertyStruct cfgFile, cfgGroupPattern, cfgDataPattern;
+      cfg_manager::cfgPropertyStruct cfgRecord, cfgReplay, cfgReplaySpeed;
+      cfg_manager::cfgPropertyStruct cfgReplayStart, cfgStepSimTimer;
+      cfg_manager::cfgPropertyStruct cfgCompression, cfgChunkSize;
+      cfg_manager::cfgPropertyStruct cfgMaxPending;
+    }; // end of class DataBrokerRecorder
+
+  } // end of namespace data_broker_recorder
+} // end of namespace mars
+
+#endif // DATA_BROKER_RECORDER_H
@@ -0,0 +1,579 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RecorderLog.h"
+
+#include <mars/utils/MutexLocker.h>
+
+#include <cstring>
+#include <zlib.h>
+
+namespace mars {
+  namespace data_broker_recorder {
+
+    using namespace mars::utils;
+    using namespace mars::data_broker;
+
+    static const char fileMagic[8] = {'M', 'D', 'B', 'R', 'L', 'O', 'G', 0};
+    static const char footerMagic[8] = {'M', 'D', 'B', 'R', 'I', 'D', 'X', 0};
+    static const char chunkMagic[4] = {'C', 'H', 'N', 'K'};
+    static const char indexMagic[4] = {'I', 'N', 'D', 'X'};
+    // magic + compressedSize + rawSize + numRecords + firstTime + lastTime
+    static const size_t chunkHeaderSize = 4 + 3*sizeof(uint32_t) + 2*sizeof(double);
+    static const size_t footerSize = sizeof(uint64_t) + sizeof(footerMagic);
+
+    static uint64_t tell64(FILE *file) {
+#ifdef WIN32
+      return (uint64_t)_ftelli64(file);
+#else
+      return (uint64_t)ftello(file);
+#endif
+    }
+
+    static bool seek64(FILE *file, uint64_t offset, int whence=SEEK_SET) {
+#ifdef WIN32
+      return _fseeki64(file, (__int64)offset, whence) == 0;
+#else
+      return fseeko(file, (off_t)offset, whence) == 0;
+#endif
+    }
+
+    template<typename T>
+    static inline void put(std::vector<char> *buffer, const T &value) {
+      size_t pos = buffer->size();
+      buffer->resize(pos + sizeof(T));
+      memcpy(&(*buffer)[pos], &value, sizeof(T));
+    }
+
+    static inline void putString(std::vector<char> *buffer,
+                                 const std::string &s) {
+      put(buffer, (uint32_t)s.size());
+      buffer->insert(buffer->end(), s.begin(), s.end());
+    }
+
+    template<typename T>
+    static inline bool get(const char **pos, const char *end, T *value) {
+      if(end - *pos < (long)sizeof(T)) return false;
+      memcpy(value, *pos, sizeof(T));
+      *pos += sizeof(T);
+      return true;
+    }
+
+    static inline bool getString(const char **pos, const char *end,
+                                 std::string *s) {
+      uint32_t length;
+      if(!get(pos, end, &length)) return false;
+      if((uint32_t)(end - *pos) < length) return false;
+      s->assign(*pos, length);
+      *pos += length;
+      return true;
+    }
+
+    bool StreamSchema::matches(const DataPackage &package) const {
+      if(package.size() != items.size()) return false;
+      for(size_t i=0; i<items.size(); ++i) {
+        if(package[i].type != items[i].type) return false;
+      }
+      return true;
+    }
+
+    namespace serialize {
+
+      void writeSchema(std::vector<char> *buffer, const StreamSchema &schema) {
+        put(buffer, (uint8_t)RECORD_SCHEMA);
+        put(buffer, schema.streamIndex);
+        putString(buffer, schema.groupName);
+        putString(buffer, schema.dataName);
+        put(buffer, (uint32_t)schema.flags);
+        put(buffer, (uint32_t)schema.items.size());
+        for(size_t i=0; i<schema.items.size(); ++i) {
+          putString(buffer, schema.items[i].name);
+          put(buffer, (uint8_t)schema.items[i].type);
+        }
+      }
+
+      void writeSample(std::vector<char> *buffer, uint32_t streamIndex,
+                       double simTime, const DataPackage &package) {
+        put(buffer, (uint8_t)RECORD_SAMPLE);
+        put(buffer, streamIndex);
+        put(buffer, simTime);
+        writeValues(buffer, package);
+      }
+
+      void writeValues(std::vector<char> *buffer, const DataPackage &package) {
+        for(size_t i=0; i<package.size(); ++i) {
+          const DataItem &item = package[i];
+          switch(item.type) {
+          case INT_TYPE: put(buffer, (int32_t)item.i); break;
+          case UINT_TYPE: put(buffer, (uint32_t)item.ui); break;
+          case LONG_TYPE: put(buffer, (int64_t)item.l); break;
+          case ULONG_TYPE: put(buffer, (uint64_t)item.ul); break;
+          case FLOAT_TYPE: put(buffer, item.f); break;
+          case DOUBLE_TYPE: put(buffer, item.d); break;
+          case BOOL_TYPE: put(buffer, (uint8_t)item.b); break;
+          case STRING_TYPE: putString(buffer, item.s); break;
+          case UNDEFINED_TYPE: break;
+          }
+        }
+      }
+
+      bool readSchema(const char **pos, const char *end, StreamSchema *schema) {
+        uint32_t flags, numItems;
+        if(!get(pos, end, &schema->streamIndex)) return false;
+        if(!getString(pos, end, &schema->groupName)) return false;
+        if(!getString(pos, end, &schema->dataName)) return false;
+        if(!get(pos, end, &flags)) return false;
+        if(!get(pos, end, &numItems)) return false;
+        schema->flags = (PackageFlag)flags;
+        schema->items.resize(numItems);
+        for(uint32_t i=0; i<numItems; ++i) {
+          uint8_t type;
+          if(!getString(pos, end, &schema->items[i].name)) return false;
+          if(!get(pos, end, &type)) return false;
+          schema->items[i].type = (DataType)type;
+        }
+        return true;
+      }
+
+      void preparePackage(const StreamSchema &schema, DataPackage *package) {
+        package->clear();
+        for(size_t i=0; i<schema.items.size(); ++i) {
+          const std::string &name = schema.items[i].name;
+          switch(schema.items[i].type) {
+          case INT_TYPE: package->add(name, (int)0); break;
+          case UINT_TYPE: package->add(name, (unsigned int)0); break;
+          case LONG_TYPE: package->add(name, (long)0); break;
+          case ULONG_TYPE: package->add(name, (unsigned long)0); break;
+          case FLOAT_TYPE: package->add(name, 0.0f); break;
+          case DOUBLE_TYPE: package->add(name, 0.0); break;
+          case BOOL_TYPE: package->add(name, false); break;
+          case STRING_TYPE: package->add(name, std::string()); break;
+          case UNDEFINED_TYPE: {
+            DataItem item;
+            item.setName(name);
+            package->add(item);
+            break;
+          }
+          }
+        }
+      }
+
+      bool readValues(const char **pos, const char *end,
+                      const StreamSchema &schema, DataPackage *package) {
+        for(size_t i=0; i<schema.items.size(); ++i) {
+          DataItem &item = (*package)[i];
+          bool ok = true;
+          switch(schema.items[i].type) {
+          case INT_TYPE: {
+            int32_t v; ok = get(pos, end, &v); item.i = v; break;
+          }
+          case UINT_TYPE: {
+            uint32_t v; ok = get(pos, end, &v); item.ui = v; break;
+          }
+          case LONG_TYPE: {
+            int64_t v; ok = get(pos, end, &v); item.l = (long)v; break;
+          }
+          case ULONG_TYPE: {
+            uint64_t v; ok = get(pos, end, &v); item.ul = (unsigned long)v;
+            break;
+          }
+          case FLOAT_TYPE: ok = get(pos, end, &item.f); break;
+          case DOUBLE_TYPE: ok = get(pos, end, &item.d); break;
+          case BOOL_TYPE: {
+            uint8_t v; ok = get(pos, end, &v); item.b = (v != 0); break;
+          }
+          case STRING_TYPE: ok = getString(pos, end, &item.s); break;
+          case UNDEFINED_TYPE: break;
+          }
+          if(!ok) return false;
+        }
+        return true;
+      }
+
+      bool skipValues(const char **pos, const char *end,
+                      const StreamSchema &schema) {
+        for(size_t i=0; i<schema.items.size(); ++i) {
+          size_t size = 0;
+          switch(schema.items[i].type) {
+          case INT_TYPE: case UINT_TYPE: case FLOAT_TYPE: size = 4; break;
+          case LONG_TYPE: case ULONG_TYPE: case DOUBLE_TYPE: size = 8; break;
+          case BOOL_TYPE: size = 1; break;
+          case STRING_TYPE: {
+            uint32_t length;
+            if(!get(pos, end, &length)) return false;
+            size = length;
+            break;
+          }
+          case UNDEFINED_TYPE: break;
+          }
+          if((size_t)(end - *pos) < size) return false;
+          *pos += size;
+        }
+        return true;
+      }
+
+    } // end of namespace serialize
+
+
+    LogWriter::LogWriter() : file(NULL), compressionLevel(Z_BEST_SPEED),
+                             maxPendingChunks(64), stop(false),
+                             droppedChunks(0), writtenChunks(0),
+                             bytesWritten(0) {
+    }
+
+    LogWriter::~LogWriter() {
+      if(file) {
+        close(std::vector<StreamSchema>());
+      }
+      std::list<ChunkBuffer*>::iterator it;
+      for(it=freeChunks.begin(); it!=freeChunks.end(); ++it) {
+        delete *it;
+      }
+    }
+
+    bool LogWriter::open(const std::string &filename, int compressionLevel,
+                         unsigned int maxPendingChunks) {
+      if(file) return false;
+      file = fopen(filename.c_str(), "wb");
+      if(!file) {
+        fprintf(stderr, "DataBrokerRecorder: could not open \"%s\"\n",
+                filename.c_str());
+        return false;
+      }
+      this->compressionLevel = compressionLevel;
+      this->maxPendingChunks = maxPendingChunks;
+      fwrite(fileMagic, sizeof(fileMagic), 1, file);
+      fwrite(&LOG_VERSION, sizeof(LOG_VERSION), 1, file);
+      chunkIndex.clear();
+      droppedChunks = writtenChunks = 0;
+      bytesWritten = tell64(file);
+      stop = false;
+      start();
+      return true;
+    }
+
+    void LogWriter::close(const std::vector<StreamSchema> &schemas) {
+      if(!file) return;
+      queueMutex.lock();
+      stop = true;
+      queueCondition.wakeAll();
+      queueMutex.unlock();
+      wait();
+
+      // write the index
+      std::vector<char> buffer;
+      uint64_t indexOffset = tell64(file);
+      buffer.insert(buffer.end(), indexMagic, indexMagic+sizeof(indexMagic));
+      put(&buffer, (uint32_t)schemas.size());
+      put(&buffer, (uint32_t)chunkIndex.size());
+      for(size_t i=0; i<schemas.size(); ++i) {
+        serialize::writeSchema(&buffer, schemas[i]);
+      }
+      for(size_t i=0; i<chunkIndex.size(); ++i) {
+        put(&buffer, chunkIndex[i].offset);
+        put(&buffer, chunkIndex[i].firstTime);
+        put(&buffer, chunkIndex[i].lastTime);
+        put(&buffer, chunkIndex[i].numRecords);
+      }
+      put(&buffer, indexOffset);
+      buffer.insert(buffer.end(), footerMagic, footerMagic+sizeof(footerMagic));
+      fwrite(&buffer[0], buffer.size(), 1, file);
+      bytesWritten += buffer.size();
+      fclose(file);
+      file = NULL;
+    }
+
+    bool LogWriter::pushChunk(ChunkBuffer *chunk) {
+      MutexLocker locker(&queueMutex);
+      if(pendingChunks.size() >= maxPendingChunks) {
+        // never block the caller; the data is lost instead
+        ++droppedChunks;
+        chunk->data.clear();
+        freeChunks.push_back(chunk);
+        return false;
+      }
+      pendingChunks.push_back(chunk);
+      queueCondition.wakeOne();
+      return true;
+    }
+
+    ChunkBuffer* LogWriter::getFreeChunk() {
+      ChunkBuffer *chunk = NULL;
+      queueMutex.lock();
+      if(!freeChunks.empty()) {
+        chunk = freeChunks.front();
+        freeChunks.pop_front();
+      }
+      queueMutex.unlock();
+      if(!chunk) {
+        chunk = new ChunkBuffer;
+      }
+      chunk->data.clear();
+      chunk->firstTime = chunk->lastTime = 0.0;
+      chunk->numRecords = 0;
+      return chunk;
+    }
+
+    void LogWriter::run() {
+      ChunkBuffer *chunk;
+      queueMutex.lock();
+      while(true) {
+        while(pendingChunks.empty() && !stop) {
+          queueCondition.wait(&queueMutex);
+        }
+        if(pendingChunks.empty()) break;
+        chunk = pendingChunks.front();
+        pendingChunks.pop_front();
+        queueMutex.unlock();
+        writeChunk(chunk);
+        chunk->data.clear();
+        queueMutex.lock();
+        freeChunks.push_back(chunk);
+      }
+      queueMutex.unlock();
+    }
+
+    void LogWriter::writeChunk(ChunkBuffer *chunk) {
+      if(chunk->data.empty()) return;
+      uLongf compressedSize = compressBound(chunk->data.size());
+      if(compressBuffer.size() < compressedSize) {
+        compressBuffer.resize(compressedSize);
+      }
+      if(compress2(&compressBuffer[0], &compressedSize,
+                   (const Bytef*)&chunk->data[0], chunk->data.size(),
+                   compressionLevel) != Z_OK) {
+        fprintf(stderr, "DataBrokerRecorder: error compressing chunk\n");
+        ++droppedChunks;
+        return;
+      }
+      ChunkInfo info;
+      info.offset = tell64(file);
+      info.firstTime = chunk->firstTime;
+      info.lastTime = chunk->lastTime;
+      info.numRecords = chunk->numRecords;
+      uint32_t cSize = compressedSize;
+      uint32_t rawSize = chunk->data.size();
+      fwrite(chunkMagic, sizeof(chunkMagic), 1, file);
+      fwrite(&cSize, sizeof(cSize), 1, file);
+      fwrite(&rawSize, sizeof(rawSize), 1, file);
+      fwrite(&info.numRecords, sizeof(info.numRecords), 1, file);
+      fwrite(&info.firstTime, sizeof(info.firstTime), 1, file);
+      fwrite(&info.lastTime, sizeof(info.lastTime), 1, file);
+      fwrite(&compressBuffer[0], cSize, 1, file);
+      chunkIndex.push_back(info);
+      bytesWritten += chunkHeaderSize + cSize;
+      ++writtenChunks;
+    }
+
+
+    LogReader::LogReader() : file(NULL) {
+    }
+
+    LogReader::~LogReader() {
+      close();
+    }
+
+    bool LogReader::open(const std::string &filename) {
+      char magic[sizeof(fileMagic)];
+      uint32_t version;
+      close();
+      file = fopen(filename.c_str(), "rb");
+      if(!file) {
+        fprintf(stderr, "DataBrokerRecorder: could not open \"%s\"\n",
+                filename.c_str());
+        return false;
+      }
+      if(fread(magic, sizeof(magic), 1, file) != 1 ||
+         memcmp(magic, fileMagic, sizeof(magic)) != 0 ||
+         fread(&version, sizeof(version), 1, file) != 1 ||
+         version != LOG_VERSION) {
+        fprintf(stderr, "DataBrokerRecorder: \"%s\" is no valid log file\n",
+                filename.c_str());
+        close();
+        return false;
+      }
+      if(!readIndex()) {
+        fprintf(stderr, "DataBrokerRecorder: no index in \"%s\"; scanning file\n",
+                filename.c_str());
+        if(!scanChunks()) {
+          close();
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void LogReader::close() {
+      if(file) {
+        fclose(file);
+        file = NULL;
+      }
+      chunks.clear();
+      schemas.clear();
+    }
+
+    bool LogReader::readIndex() {
+      char magic[sizeof(footerMagic)];
+      uint64_t indexOffset, fileSize;
+      if(!seek64(file, 0, SEEK_END)) return false;
+      fileSize = tell64(file);
+      if(fileSize < footerSize) return false;
+      if(!seek64(file, fileSize - footerSize)) return false;
+      if(fread(&indexOffset, sizeof(indexOffset), 1, file) != 1) return false;
+      if(fread(magic, sizeof(magic), 1, file) != 1) return false;
+      if(memcmp(magic, footerMagic, sizeof(magic)) != 0) return false;
+      if(indexOffset >= fileSize - footerSize) return false;
+
+      std::vector<char> buffer(fileSize - footerSize - indexOffset);
+      if(!seek64(file, indexOffset)) return false;
+      if(fread(&buffer[0], buffer.size(), 1, file) != 1) return false;
+      const char *pos = &buffer[0];
+      const char *end = pos + buffer.size();
+      uint32_t numStreams, numChunks;
+      if(memcmp(pos, indexMagic, sizeof(indexMagic)) != 0) return false;
+      pos += sizeof(indexMagic);
+      if(!get(&pos, end, &numStreams) || !get(&pos, end, &numChunks)) {
+        return false;
+      }
+      for(uint32_t i=0; i<numStreams; ++i) {
+        uint8_t type;
+        StreamSchema schema;
+        if(!get(&pos, end, &type) || type != RECORD_SCHEMA) return false;
+        if(!serialize::readSchema(&pos, end, &schema)) return false;
+        schemas[schema.streamIndex] = schema;
+      }
+      chunks.resize(numChunks);
+      for(uint32_t i=0; i<numChunks; ++i) {
+        if(!get(&pos, end, &chunks[i].offset) ||
+           !get(&pos, end, &chunks[i].firstTime) ||
+           !get(&pos, end, &chunks[i].lastTime) ||
+           !get(&pos, end, &chunks[i].numRecords)) {
+          chunks.clear();
+          schemas.clear();
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool LogReader::scanChunks() {
+      uint64_t offset = sizeof(fileMagic) + sizeof(LOG_VERSION);
+      uint32_t compressedSize, rawSize;
+      ChunkInfo info;
+      chunks.clear();
+      while(readChunkHeader(offset, &info, &compressedSize, &rawSize)) {
+        chunks.push_back(info);
+        offset += chunkHeaderSize + compressedSize;
+      }
+      // collect the schemas which are otherwise stored in the index
+      std::vector<char> records;
+      for(size_t i=0; i<chunks.size(); ++i) {
+        if(!readChunk(i, &records)) {
+          chunks.resize(i);
+          break;
+        }
+        const char *pos = records.empty() ? NULL : &records[0];
+        const char *end = pos + records.size();
+        double t;
+        const StreamSchema *schema;
+        while((schema = nextSample(&pos, end, &t))) {
+          if(!serialize::skipValues(&pos, end, *schema)) break;
+        }
+      }
+      return !chunks.empty();
+    }
+
+    bool LogReader::readChunkHeader(uint64_t offset, ChunkInfo *info,
+                                    uint32_t *compressedSize,
+                                    uint32_t *rawSize) {
+      char magic[sizeof(chunkMagic)];
+      if(!seek64(file, offset)) return false;
+      if(fread(magic, sizeof(magic), 1, file) != 1 ||
+         memcmp(magic, chunkMagic, sizeof(magic)) != 0) {
+        return false;
+      }
+      info->offset = offset;
+      return (fread(compressedSize, sizeof(uint32_t), 1, file) == 1 &&
+              fread(rawSize, sizeof(uint32_t), 1, file) == 1 &&
+              fread(&info->numRecords, sizeof(uint32_t), 1, file) == 1 &&
+              fread(&info->firstTime, sizeof(double), 1, file) == 1 &&
+              fread(&info->lastTime, sizeof(double), 1, file) == 1);
+    }
+
+    size_t LogReader::findChunk(double simTime) const {
+      // chunks are written in time order; binary search on lastTime
+      size_t lo = 0, hi = chunks.size();
+      while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(chunks[mid].lastTime < simTime) lo = mid + 1;
+        else hi = mid;
+      }
+      return lo;
+    }
+
+    bool LogReader::readChunk(size_t chunkIndex, std::vector<char> *records) {
+      ChunkInfo info;
+      uint32_t compressedSize, rawSize;
+      if(!file || chunkIndex >= chunks.size()) return false;
+      if(!readChunkHeader(chunks[chunkIndex].offset, &info,
+                          &compressedSize, &rawSize)) {
+        return false;
+      }
+      if(compressBuffer.size() < compressedSize) {
+        compressBuffer.resize(compressedSize);
+      }
+      if(fread(&compressBuffer[0], compressedSize, 1, file) != 1) return false;
+      records->resize(rawSize);
+      uLongf destSize = rawSize;
+      if(uncompress((Bytef*)&(*records)[0], &destSize,
+                    &compressBuffer[0], compressedSize) != Z_OK ||
+         destSize != rawSize) {
+        return false;
+      }
+
+      return true;
+    }
+
+    const StreamSchema* LogReader::nextSample(const char **pos,
+                                              const char *end,
+                                              double *simTime) {
+      uint8_t type;
+      uint32_t streamIndex;
+      std::map<uint32_t, StreamSchema>::iterator it;
+      while(get(pos, end, &type)) {
+        if(type == RECORD_SCHEMA) {
+          StreamSchema schema;
+          if(!serialize::readSchema(pos, end, &schema)) return NULL;
+          schemas[schema.streamIndex] = schema;
+        } else if(type == RECORD_SAMPLE) {
+          if(!get(pos, end, &streamIndex) || !get(pos, end, simTime)) {
+            return NULL;
+          }
+          it = schemas.find(streamIndex);
+          return (it == schemas.end()) ? NULL : &it->second;
+        } else {
+          return NULL;
+        }
+      }
+      return NULL;
+    }
+
+  } // end of namespace data_broker_recorder
+} // end of namespace mars
@@ -0,0 +1,246 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file RecorderLog.h
+ * \brief Binary log format used by the DataBrokerRecorder.
+ *
+ * A log file has the following layout:
+ *
+ *   FileHeader
+ *   Chunk*           (ChunkHeader + zlib compressed records)
+ *   Index            (stream schemas + chunk table)
+ *   FileFooter       (offset of the index)
+ *
+ * Each chunk contains a sequence of records. A SCHEMA record describes
+ * a stream (group/data name and the names and types of its items) and
+ * is written into the chunk in which the stream first appears; if that
+ * chunk is dropped, the schema is repeated in the next one. A SAMPLE
+ * record contains the stream index, the simulation time and the packed
+ * item values in schema order. The index at the end of the file
+ * repeats all schemas and lists the file offset and time range of
+ * every chunk so that a reader can seek without scanning the file. If
+ * the index is missing (e.g. the recording was not closed properly) the
+ * reader falls back to a sequential scan of the chunks.
+ */
+
+#ifndef DATA_BROKER_RECORDER_LOG_H
+#define DATA_BROKER_RECORDER_LOG_H
+
+#ifdef _PRINT_HEADER_
+  #warning "RecorderLog.h"
+#endif
+
+#include <mars/data_broker/DataPackage.h>
+#include <mars/data_broker/DataInfo.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+#include <stdint.h>
+
+namespace mars {
+  namespace data_broker_recorder {
+
+    const uint32_t LOG_VERSION = 1;
+
+    enum RecordType {
+      RECORD_SCHEMA = 1,
+      RECORD_SAMPLE = 2
+    };
+
+    /** \brief name and type of a single DataItem within a stream */
+    struct ItemSchema {
+      std::string name;
+      data_broker::DataType type;
+    };
+
+    /** \brief layout of the DataPackages of one recorded stream */
+    struct StreamSchema {
+      uint32_t streamIndex;
+      std::string groupName;
+      std::string dataName;
+      data_broker::PackageFlag flags;
+      std::vector<ItemSchema> items;
+
+      /**
+       * \brief returns \c true if \a package has exactly the item types
+       *        described by this schema.
+       */
+      bool matches(const data_broker::DataPackage &package) const;
+    };
+
+    /** \brief the location and time range of one chunk in the log file */
+    struct ChunkInfo {
+      uint64_t offset;
+      double firstTime;
+      double lastTime;
+      uint32_t numRecords;
+    };
+
+    /** \brief an uncompressed chunk that is filled by the recorder */
+    struct ChunkBuffer {
+      std::vector<char> data;
+      double firstTime;
+      double lastTime;
+      uint32_t numRecords;
+    };
+
+    /**
+     * \brief helper functions to (de)serialize records into a byte buffer
+     */
+    namespace serialize {
+      void writeSchema(std::vector<char> *buffer, const StreamSchema &schema);
+      void writeSample(std::vector<char> *buffer, uint32_t streamIndex,
+                       double simTime,
+                       const data_broker::DataPackage &package);
+      /** \brief appends only the packed item values of \a package */
+      void writeValues(std::vector<char> *buffer,
+                       const data_broker::DataPackage &package);
+
+      bool readSchema(const char **pos, const char *end, StreamSchema *schema);
+      /**
+       * \brief fills \a package with default initialized items matching
+       *        the names and types of \a schema.
+       */
+      void preparePackage(const StreamSchema &schema,
+                          data_broker::DataPackage *package);
+      /**
+       * \brief unpacks the values of a SAMPLE record into \a package.
+       *        \a package has to be prepared with the items of the schema.
+       */
+      bool readValues(const char **pos, const char *end,
+                      const StreamSchema &schema,
+                      data_broker::DataPackage *package);
+      bool skipValues(const char **pos, const char *end,
+                      const StreamSchema &schema);
+    } // end of namespace serialize
+
+    /**
+     * \brief Writes chunks to a log file on its own thread.
+     *
+     * The recorder hands filled ChunkBuffers over via pushChunk() and gets
+     * empty ones back via getFreeChunk() so that no memory is allocated on
+     * the recording path once the pool is warmed up. Compression and file
+     * IO only ever happen on the writer thread.
+     */
+    class LogWriter : public utils::Thread {
+    public:
+      LogWriter();
+      ~LogWriter();
+
+      bool open(const std::string &filename, int compressionLevel,
+                unsigned int maxPendingChunks);
+      /**
+       * \brief writes all pending chunks and the index and closes the file.
+       * \param schemas All streams that were recorded.
+       */
+      void close(const std::vector<StreamSchema> &schemas);
+
+      /**
+       * \brief queues a chunk for writing.
+       * \return \c false if the queue was full and the chunk was dropped.
+       */
+      bool pushChunk(ChunkBuffer *chunk);
+      ChunkBuffer* getFreeChunk();
+
+      unsigned long getDroppedChunks() const {return droppedChunks;}
+      unsigned long getWrittenChunks() const {return writtenChunks;}
+      uint64_t getBytesWritten() const {return bytesWritten;}
+
+    protected:
+      void run();
+
+    private:
+      void writeChunk(ChunkBuffer *chunk);
+
+      FILE *file;
+      int compressionLevel;
+      unsigned int maxPendingChunks;
+      volatile bool stop;
+      std::list<ChunkBuffer*> pendingChunks;
+      std::list<ChunkBuffer*> freeChunks;
+      std::vector<ChunkInfo> chunkIndex;
+      std::vector<unsigned char> compressBuffer;
+      utils::Mutex queueMutex;
+      utils::WaitCondition queueCondition;
+      unsigned long droppedChunks, writtenChunks;
+      uint64_t bytesWritten;
+    }; // end of class LogWriter
+
+    /**
+     * \brief Reads a log file written by the LogWriter.
+     */
+    class LogReader {
+    public:
+      LogReader();
+      ~LogReader();
+
+      bool open(const std::string &filename);
+      void close();
+
+      const std::vector<ChunkInfo>& getChunks() const {return chunks;}
+      const std::map<uint32_t, StreamSchema>& getSchemas() const {
+        return schemas;
+      }
+
+      /**
+       * \brief returns the index of the first chunk that contains samples
+       *        at or after \a simTime.
+       */
+      size_t findChunk(double simTime) const;
+
+      /**
+       * \brief decompresses the chunk with the given index into \a records.
+       */
+      bool readChunk(size_t chunkIndex, std::vector<char> *records);
+
+      /**
+       * \brief advances \a pos to the values of the next SAMPLE record.
+       *        SCHEMA records on the way are added to the schema table.
+       * \return The schema of the sample or \c NULL at the end of the
+       *         records or on a format error. The caller has to consume
+       *         the values with serialize::readValues or skipValues.
+       */
+      const StreamSchema* nextSample(const char **pos, const char *end,
+                                     double *simTime);
+
+    private:
+      bool readIndex();
+      bool scanChunks();
+      bool readChunkHeader(uint64_t offset, ChunkInfo *info,
+                           uint32_t *compressedSize, uint32_t *rawSize);
+
+      FILE *file;
+      std::vector<ChunkInfo> chunks;
+      std::map<uint32_t, StreamSchema> schemas;
+      std::vector<unsigned char> compressBuffer;
+    }; // end of class LogReader
+
+  } // end of namespace data_broker_recorder
+} // end of namespace mars
+
+#endif // DATA_BROKER_RECORDER_LOG_H
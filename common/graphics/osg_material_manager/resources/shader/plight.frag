@@ -11,11 +11,21 @@ void plight(vec4 base, vec3 n, out vec4 outcol) {
   vec3 reflected;
   float nDotL, rDotE, shadow, diffuseShadow;
   float dist, atten, x, y, s;
-  vec4 shadowCoord = gl_TexCoord[2];
+  vec4 shadowBase = gl_TexCoord[2];
+  vec4 shadowCoord = shadowBase;
   vec2 v;
   vec4 screenPos = (gl_ModelViewProjectionMatrix * modelVertex);
   screenPos /= screenPos.w;
   s = 0.0078125; // 1/128
+  if(useShadow == 1 && osgShadow_numCascades > 0) {
+    // select the cascade by the view depth
+    float depth = -(osg_ViewMatrix * vec4(positionVarying.xyz, 1.0)).z;
+    int cascade = 0;
+    for(int k=1; k<osgShadow_numCascades; ++k) {
+      if(depth > osgShadow_cascadeSplits[k-1]) cascade = k;
+    }
+    shadowBase = osgShadow_cascadeMatrix[cascade] * vec4(positionVarying.xyz, 1.0);
+  }
   for(int i=0; i<numLights; ++i) {
     if(lightIsSet[i]==1) {
       nDotL = max(dot( n, normalize(  -lightVec[i] ) ), 0.0);
@@ -24,11 +34,11 @@ void plight(vec4 base, vec3 n, out vec4 outcol) {
       if(useShadow == 1) {
         shadow = 0;
         if(shadowSamples == 1) {
-          shadow += shadow2DProj( osgShadow_shadowTexture, gl_TexCoord[2] ).r * invShadowSamples;
+          shadow += shadow2DProj( osgShadow_shadowTexture, shadowBase ).r * invShadowSamples;
         }
         else {
           float da = 128/shadowSamples;
-          float w = gl_TexCoord[2].w*invShadowTextureSize;
+          float w = shadowBase.w*invShadowTextureSize;
           vec2 offset = floor(da*screenPos.xy*10)*shadowSamples;
           for(int k=0; k<shadowSamples; ++k) {
             for(int l=0; l<shadowSamples; ++l) {
@@ -36,7 +46,7 @@ void plight(vec4 base, vec3 n, out vec4 outcol) {
               y = offset.y*s + l*s;
               v = texture2D( NoiseMap, vec2(x,y)).xy-0.5;
               v *= 8;
-              shadowCoord = gl_TexCoord[2] + vec4(v.x*w, v.y*w, 0.0, 0);
+              shadowCoord = shadowBase + vec4(v.x*w, v.y*w, 0.0, 0);
               shadow += shadow2DProj( osgShadow_shadowTexture, shadowCoord ).r * invShadowSamples;
             }
           }
@@ -2,7 +2,7 @@ float rnd(float x, float y) {
   return fract(sin(dot(vec2(x,y) ,vec2(12.9898,78.233))) * 43758.5453);
 }
 
-void plight(vec4 v, vec4 scol) {
+void plight(vec4 v, vec4 scol, vec4 viewPos) {
   // save the vertex to eye vector in world space
   eyeVec = osg_ViewMatrixInverse[3].xyz-v.xyz;
   for(int i=0; i<numLights; ++i) {
@@ -16,7 +16,7 @@ void plight(vec4 v, vec4 scol) {
       specular[i] = lightSpecular[i]*scol;
       spotDir[i] = lightSpotDir[i];
       if(useShadow == 1) {
-        vec4 eye = vec4((gl_ModelViewMatrix * gl_Vertex).xyz, 1.);
+        vec4 eye = vec4(viewPos.xyz, 1.);
         // generate coords for shadow mapping
         gl_TexCoord[2].s = dot( eye, gl_EyePlaneS[2] );
         gl_TexCoord[2].t = dot( eye, gl_EyePlaneT[2] );
@@ -446,6 +446,7 @@ namespace osg_material_manager {
         stateSet->removeAttribute(lastProgram.get());
         lastProgram = NULL;
       }
+      instancedProgram = NULL;
       disableTexture("normalMap");
       stateSet->setTextureAttributeAndModes(NOISE_MAP_UNIT, noiseMap,
                                             osg::StateAttribute::OFF);
@@ -464,6 +465,47 @@ namespace osg_material_manager {
     stateSet->removeUniform(envMapScaleUniform.get());
     stateSet->removeUniform(terrainScaleZUniform.get());
     stateSet->removeUniform(terrainDimUniform.get());
+    bool hasTexture = checkTexture("environmentMap") || checkTexture("diffuseMap") || checkTexture("normalMap");
+    osg::Program *glslProgram = generateProgram(false);
+    instancedProgram = NULL;
+    if(checkTexture("normalMap") || checkTexture("environmentMap")) {
+      stateSet->addUniform(bumpNorFacUniform.get());
+    }
+    else {
+      stateSet->removeUniform(bumpNorFacUniform.get());
+    }
+    stateSet->addUniform(noiseMapUniform.get());
+
+    if(hasTexture) {
+      stateSet->addUniform(texScaleUniform.get());
+      stateSet->addUniform(sinUniform.get());
+      stateSet->addUniform(cosUniform.get());
+    }
+    else {
+      stateSet->removeUniform(texScaleUniform.get());
+    }
+
+    if(lastProgram.valid()) {
+      stateSet->removeAttribute(lastProgram.get());
+    }
+    stateSet->setAttributeAndModes(glslProgram,
+                                   osg::StateAttribute::ON);
+
+    stateSet->removeUniform(shadowSamplesUniform.get());
+    stateSet->removeUniform(invShadowSamplesUniform.get());
+    stateSet->removeUniform(invShadowTextureSizeUniform.get());
+    stateSet->removeUniform(shadowScaleUniform.get());
+
+    stateSet->addUniform(shadowSamplesUniform.get());
+    stateSet->addUniform(invShadowSamplesUniform.get());
+    stateSet->addUniform(invShadowTextureSizeUniform.get());
+    stateSet->addUniform(shadowScaleUniform.get());
+
+    lastProgram = glslProgram;
+  }
+
+  osg::Program* OsgMaterial::generateProgram(bool instanced) {
+    osg::StateSet* stateSet = getOrCreateStateSet();
     ShaderGenerator shaderGenerator;
     vector<string> args;
 
@@ -498,8 +540,44 @@ namespace osg_material_manager {
                                  {"diffuse[0]", "vec4(0.5)+diffuse[0] * (1+offset.x)"} );
         vertexShader->addMainVar( (GLSLVariable)
                                   { "vec4", "specularCol", "gl_FrontMaterial.specular*(0.5+offset.w)" }, -1);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec3", "vNormal", "gl_Normal" }, -1);
+      }
+      else if(instanced) {
+        // every instance has the three upper rows of its model matrix in
+        // the texture buffer
+        vertexShader->enableExtension("GL_ARB_draw_instanced");
+        vertexShader->enableExtension("GL_EXT_gpu_shader4");
+        vertexShader->addUniform( (GLSLUniform)
+                                  { "samplerBuffer", "instanceMatrices" } );
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "int", "instanceTexel", "3*gl_InstanceIDARB" }, -150);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "instanceRow0", "texelFetchBuffer(instanceMatrices, instanceTexel)" }, -140);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "instanceRow1", "texelFetchBuffer(instanceMatrices, instanceTexel+1)" }, -140);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "instanceRow2", "texelFetchBuffer(instanceMatrices, instanceTexel+2)" }, -140);
+        // dividing by the squared scale of the axes turns the model matrix
+        // into the inverse transposed needed for the normals
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec3", "instanceScale2", "instanceRow0.xyz*instanceRow0.xyz + instanceRow1.xyz*instanceRow1.xyz + instanceRow2.xyz*instanceRow2.xyz" }, -130);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec3", "instanceNormal", "gl_Normal / instanceScale2" }, -125);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec3", "vNormal", "vec3(dot(instanceRow0.xyz, instanceNormal), dot(instanceRow1.xyz, instanceNormal), dot(instanceRow2.xyz, instanceNormal))" }, -124);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "vModelPos", "vec4(dot(instanceRow0, gl_Vertex), dot(instanceRow1, gl_Vertex), dot(instanceRow2, gl_Vertex), 1.0)" }, -120);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "vViewPos", "gl_ModelViewMatrix * vModelPos " }, -110);
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "vWorldPos", "osg_ViewMatrixInverse * vViewPos " }, -100);
+        vertexShader->addMainVar( (GLSLVariable)
+                            { "vec4", "specularCol", "gl_FrontMaterial.specular" }, -90);
       }
       else {
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec3", "vNormal", "gl_Normal" }, -125);
         vertexShader->addMainVar( (GLSLVariable)
                                   { "vec4", "vModelPos", "gl_Vertex" }, -120);
         vertexShader->addMainVar( (GLSLVariable)
@@ -622,6 +700,9 @@ namespace osg_material_manager {
         stringstream s;
         s << maxNumLights;
         map["mappings"]["numLights"] = s.str();
+        s.str("");
+        s << MAX_SHADOW_CASCADES;
+        map["mappings"]["numShadowCascades"] = s.str();
         YamlShader *plightFrag = new YamlShader((string)map["name"], args, map, resPath);
         /*PixelLightFrag *plightFrag = new PixelLightFrag(args, maxNumLights,
                                                         resPath,
@@ -674,14 +755,16 @@ namespace osg_material_manager {
     else {
       glslProgram = shaderGenerator.generate();
       if(map.hasKey("printShader") && (bool)map["printShader"]) {
+        std::string prefix = "shader_sources/" + name;
+        if(instanced) prefix += "_instanced";
         std::string source = shaderGenerator.generateSource(SHADER_TYPE_VERTEX);
-        std::string filename = "shader_sources/" + name + "_vert.c";
+        std::string filename = prefix + "_vert.c";
         createDirectory("shader_sources");
         FILE *f = fopen(filename.c_str(), "w");
         fprintf(f, "%s", source.c_str());
         fclose(f);
         source = shaderGenerator.generateSource(SHADER_TYPE_FRAGMENT);
-        filename = "shader_sources/" + name + "_frag.c";
+        filename = prefix + "_frag.c";
         f = fopen(filename.c_str(), "w");
         fprintf(f, "%s", source.c_str());
         fclose(f);
@@ -689,42 +772,23 @@ namespace osg_material_manager {
     }
     if(checkTexture("normalMap") || checkTexture("environmentMap")) {
       glslProgram->addBindAttribLocation( "vertexTangent", TANGENT_UNIT );
-      stateSet->addUniform(bumpNorFacUniform.get());
     }
-    else {
-      stateSet->removeUniform(bumpNorFacUniform.get());
-    }
-    stateSet->addUniform(noiseMapUniform.get());
-
-    if(hasTexture) {
-      stateSet->addUniform(texScaleUniform.get());
-      stateSet->addUniform(sinUniform.get());
-      stateSet->addUniform(cosUniform.get());
-    }
-    else {
-      stateSet->removeUniform(texScaleUniform.get());
+    if(clearShaderEntry) {
+      map.erase("shader");
     }
+    return glslProgram;
+  }
 
-    if(lastProgram.valid()) {
-      stateSet->removeAttribute(lastProgram.get());
+  osg::Program* OsgMaterial::getInstancedProgram() {
+    if(!lastProgram.valid() || map.hasKey("shaderSources") ||
+       map.hasKey("instancing") || checkTexture("normalMap") ||
+       checkTexture("environmentMap")) {
+      return NULL;
     }
-    stateSet->setAttributeAndModes(glslProgram,
-                                   osg::StateAttribute::ON);
-
-    stateSet->removeUniform(shadowSamplesUniform.get());
-    stateSet->removeUniform(invShadowSamplesUniform.get());
-    stateSet->removeUniform(invShadowTextureSizeUniform.get());
-    stateSet->removeUniform(shadowScaleUniform.get());
-
-    stateSet->addUniform(shadowSamplesUniform.get());
-    stateSet->addUniform(invShadowSamplesUniform.get());
-    stateSet->addUniform(invShadowTextureSizeUniform.get());
-    stateSet->addUniform(shadowScaleUniform.get());
-
-    lastProgram = glslProgram;
-    if(clearShaderEntry) {
-      map.erase("shader");
+    if(!instancedProgram.valid()) {
+      instancedProgram = generateProgram(true);
     }
+    return instancedProgram.get();
   }
 
   void OsgMaterial::setNoiseImage(osg::Image *i) {
@@ -49,8 +49,10 @@
 #define SHADOW_MAP_UNIT 2
 #define BUMP_MAP_UNIT 3
 #define NOISE_MAP_UNIT 4
+#define INSTANCE_MATRIX_UNIT 6
 #define TANGENT_UNIT 7
 #define DEFAULT_UV_UNIT 0
+#define MAX_SHADOW_CASCADES 4
 
 #define SHADER_LIGHT_IS_SET                1 << 0
 #define SHADER_LIGHT_IS_DIRECTIONAL        1 << 1
@@ -87,6 +89,15 @@ namespace osg_material_manager {
     void setNormalMap(const std::string &normalMap);
     void setBumpMap(const std::string &bumpMap);
     void updateShader(bool reload=false);
+    /**
+     * Returns a variant of the material shader for hardware instancing:
+     * the model matrix of every instance is read from a texture buffer
+     * bound to INSTANCE_MATRIX_UNIT ("instanceMatrices") which holds the
+     * three upper rows of the matrix as three RGBA texels per instance.
+     * Returns NULL if the material uses no generated shader or needs
+     * tangents, which are not transformed per instance.
+     */
+    osg::Program* getInstancedProgram();
     void edit(const std::string &key, const std::string &value);
 
     void setMaxNumLights(int n);
@@ -106,9 +117,11 @@ namespace osg_material_manager {
     bool checkTexture(std::string name);
 
   protected:
+    osg::Program* generateProgram(bool instanced);
+
     std::vector<osg::ref_ptr<MaterialNode> > materialNodeVector;
 
-    osg::ref_ptr<osg::Program> lastProgram;
+    osg::ref_ptr<osg::Program> lastProgram, instancedProgram;
     osg::ref_ptr<osg::Uniform> noiseMapUniform;
     osg::ref_ptr<osg::Uniform> bumpNorFacUniform;
     osg::ref_ptr<osg::Uniform> texScaleUniform;
@@ -28,6 +28,7 @@
 
 #include "PointsFactory.hpp"
 #include "PointsP.hpp"
+#include "PointsStreamP.hpp"
 
 namespace osg_points {
 
@@ -42,4 +43,9 @@ namespace osg_points {
     return points;
   }
 
+  PointsStream* PointsFactory::createPointsStream(size_t chunkSize,
+                                                  size_t numChunks) {
+    return new PointsStreamP(chunkSize, numChunks);
+  }
+
 } // end of namespace: osg_points
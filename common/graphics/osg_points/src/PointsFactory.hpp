@@ -28,6 +28,7 @@
 #define OSG_POINTS_FACTORY_H
 
 #include "Points.hpp"
+#include "PointsStream.hpp"
 
 namespace osg_points {
 
@@ -40,6 +41,12 @@ namespace osg_points {
     ~PointsFactory();
 
     Points* createPoints(void);
+    /**
+     * \brief creates a stream that shows up to \a chunkSize * \a numChunks
+     *        points.
+     */
+    PointsStream* createPointsStream(size_t chunkSize=65536,
+                                     size_t numChunks=16);
 
   };
 
@@ -0,0 +1,74 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file PointsStream.hpp
+ * \brief Interface of a point cloud that is continuously appended to,
+ *        e.g. by a scanning laser sensor.
+ **/
+
+#ifndef OSG_POINTS_STREAM_H
+#define OSG_POINTS_STREAM_H
+
+#include <cstddef>
+
+namespace osg_points {
+
+  enum StreamColorMode {
+    COLOR_BY_HEIGHT,
+    COLOR_BY_INTENSITY
+  };
+
+  /**
+   * The stream keeps a fixed number of points. Once it is full, the oldest
+   * points are replaced by the new ones. The points are colored by their
+   * height or intensity in a shader and fade out with their age.
+   */
+  class PointsStream {
+
+  public:
+    PointsStream() {}
+    virtual ~PointsStream() {}
+
+    /**
+     * \brief queues points for display. Can be called from any thread,
+     *        the data is copied before the call returns.
+     * \param points \a numPoints times x, y, z
+     * \param intensities one value per point or \c NULL
+     * \param time time stamp of the points in seconds
+     */
+    virtual void appendPoints(const float *points, const float *intensities,
+                              size_t numPoints, double time) = 0;
+    virtual void clear() = 0;
+    virtual void setColorMode(StreamColorMode mode) = 0;
+    /** \brief the value range that is mapped onto the color ramp */
+    virtual void setColorRange(float min, float max) = 0;
+    /**
+     * \brief points older than \a seconds (relative to the newest point)
+     *        are invisible. A value <= 0 disables the fading.
+     */
+    virtual void setFadeTime(double seconds) = 0;
+    virtual void setPointSize(double size) = 0;
+    virtual void* getOSGNode() = 0;
+  };
+
+} // end of namespace: osg_points
+
+#endif // OSG_POINTS_STREAM_H
@@ -0,0 +1,249 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "PointsStreamP.hpp"
+
+#include <osg/Program>
+#include <osg/Shader>
+#include <OpenThreads/ScopedLock>
+
+namespace osg_points {
+
+  // attribute location of the intensity / time stamp array
+  static const unsigned int DATA_ATTRIB = 6;
+
+  static const char *vertexSource =
+    "#version 120\n"
+    "attribute vec2 pointData;\n"
+    "uniform float currentTime;\n"
+    "uniform float fadeTime;\n"
+    "uniform int colorMode;\n"
+    "uniform vec2 colorRange;\n"
+    "varying vec4 color;\n"
+    "\n"
+    "// blue -> cyan -> green -> yellow -> red\n"
+    "vec3 ramp(float v) {\n"
+    "  v = clamp(v, 0.0, 1.0)*4.0;\n"
+    "  return clamp(vec3(v-2.0, v < 2.0 ? v : 4.0-v, 2.0-v), 0.0, 1.0);\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "  float value = colorMode == 0 ? gl_Vertex.z : pointData.x;\n"
+    "  float range = max(colorRange.y-colorRange.x, 0.0001);\n"
+    "  float alpha = 1.0;\n"
+    "  if(fadeTime > 0.0) {\n"
+    "    alpha = clamp(1.0-(currentTime-pointData.y)/fadeTime, 0.0, 1.0);\n"
+    "  }\n"
+    "  color = vec4(ramp((value-colorRange.x)/range), alpha);\n"
+    "  gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+    "}\n";
+
+  static const char *fragmentSource =
+    "#version 120\n"
+    "varying vec4 color;\n"
+    "\n"
+    "void main() {\n"
+    "  if(color.a <= 0.0) discard;\n"
+    "  gl_FragColor = color;\n"
+    "}\n";
+
+  class StreamUpdateCallback : public osg::NodeCallback {
+  public:
+    StreamUpdateCallback(PointsStreamP *stream) : stream(stream) {}
+
+    void operator()(osg::Node *node, osg::NodeVisitor *nv) {
+      stream->flush();
+      traverse(node, nv);
+    }
+
+  private:
+    PointsStreamP *stream;
+  };
+
+  PointsStreamP::PointsStreamP(size_t chunkSize, size_t numChunks) :
+    chunkSize(chunkSize), currentChunk(0), clearPending(false),
+    haveTimeBase(false), timeBase(0.0), lastTime(0.0) {
+
+    if(numChunks < 2) numChunks = 2;
+    node = new osg::Geode;
+    chunks.resize(numChunks);
+    for(size_t i=0; i<numChunks; ++i) {
+      Chunk &chunk = chunks[i];
+      chunk.count = 0;
+      chunk.vertices = new osg::Vec3Array(chunkSize);
+      chunk.vertices->setDataVariance(osg::Object::DYNAMIC);
+      chunk.data = new osg::Vec2Array(chunkSize);
+      chunk.data->setDataVariance(osg::Object::DYNAMIC);
+      chunk.geom = new osg::Geometry;
+      chunk.geom->setDataVariance(osg::Object::DYNAMIC);
+      chunk.geom->setUseDisplayList(false);
+      chunk.geom->setUseVertexBufferObjects(true);
+      chunk.geom->setVertexArray(chunk.vertices.get());
+      chunk.geom->setVertexAttribArray(DATA_ATTRIB, chunk.data.get());
+      chunk.geom->setVertexAttribBinding(DATA_ATTRIB,
+                                         osg::Geometry::BIND_PER_VERTEX);
+      chunk.drawArray = new osg::DrawArrays(GL_POINTS, 0, 0);
+      chunk.geom->addPrimitiveSet(chunk.drawArray.get());
+      node->addDrawable(chunk.geom.get());
+    }
+
+    osg::StateSet *states = node->getOrCreateStateSet();
+    pointSize = new osg::Point(2.0);
+    states->setAttributeAndModes(pointSize.get(), osg::StateAttribute::ON);
+    states->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    states->setMode(GL_BLEND, osg::StateAttribute::ON);
+    states->setRenderBinDetails(10, "RenderBin");
+    createShader();
+
+    node->setUpdateCallback(new StreamUpdateCallback(this));
+    this->addChild(node.get());
+  }
+
+  PointsStreamP::~PointsStreamP(void) {
+    node->setUpdateCallback(NULL);
+  }
+
+  void PointsStreamP::createShader() {
+    osg::StateSet *states = node->getOrCreateStateSet();
+    osg::ref_ptr<osg::Program> program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, vertexSource));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT,
+                                       fragmentSource));
+    program->addBindAttribLocation("pointData", DATA_ATTRIB);
+    states->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+
+    currentTimeUniform = new osg::Uniform("currentTime", 0.0f);
+    fadeTimeUniform = new osg::Uniform("fadeTime", 0.0f);
+    colorModeUniform = new osg::Uniform("colorMode", (int)COLOR_BY_HEIGHT);
+    colorRangeUniform = new osg::Uniform("colorRange", osg::Vec2(0.0f, 2.0f));
+    states->addUniform(currentTimeUniform.get());
+    states->addUniform(fadeTimeUniform.get());
+    states->addUniform(colorModeUniform.get());
+    states->addUniform(colorRangeUniform.get());
+  }
+
+  void PointsStreamP::appendPoints(const float *points,
+                                   const float *intensities,
+                                   size_t numPoints, double time) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(pendingMutex);
+    if(!haveTimeBase) {
+      timeBase = time;
+      haveTimeBase = true;
+    }
+    if(time > lastTime) lastTime = time;
+    // more points than the ring can show are dropped from the front
+    size_t capacity = chunkSize*chunks.size();
+    if(numPoints > capacity) {
+      points += (numPoints-capacity)*3;
+      if(intensities) intensities += numPoints-capacity;
+      numPoints = capacity;
+    }
+    if(pendingData.size()/2 + numPoints > capacity) {
+      size_t drop = pendingData.size()/2 + numPoints - capacity;
+      pendingPoints.erase(pendingPoints.begin(),
+                          pendingPoints.begin()+drop*3);
+      pendingData.erase(pendingData.begin(), pendingData.begin()+drop*2);
+    }
+    pendingPoints.insert(pendingPoints.end(), points, points+numPoints*3);
+    float t = (float)(time-timeBase);
+    for(size_t i=0; i<numPoints; ++i) {
+      pendingData.push_back(intensities ? intensities[i] : 0.0f);
+      pendingData.push_back(t);
+    }
+  }
+
+  void PointsStreamP::flush() {
+    double now;
+    bool doClear;
+    {
+      OpenThreads::ScopedLock<OpenThreads::Mutex> lock(pendingMutex);
+      flushPoints.swap(pendingPoints);
+      flushData.swap(pendingData);
+      pendingPoints.clear();
+      pendingData.clear();
+      doClear = clearPending;
+      clearPending = false;
+      now = lastTime-timeBase;
+    }
+
+    if(doClear) {
+      for(size_t i=0; i<chunks.size(); ++i) {
+        chunks[i].count = 0;
+        chunks[i].drawArray->setCount(0);
+        chunks[i].geom->dirtyBound();
+      }
+      currentChunk = 0;
+    }
+
+    size_t numPoints = flushData.size()/2;
+    size_t n = 0;
+    while(n < numPoints) {
+      Chunk *chunk = &chunks[currentChunk];
+      if(chunk->count == chunkSize) {
+        currentChunk = (currentChunk+1) % chunks.size();
+        chunk = &chunks[currentChunk];
+        chunk->count = 0;
+      }
+      size_t num = chunkSize-chunk->count;
+      if(num > numPoints-n) num = numPoints-n;
+      const float *p = &flushPoints[n*3];
+      const float *d = &flushData[n*2];
+      for(size_t i=0; i<num; ++i, p+=3, d+=2) {
+        (*chunk->vertices)[chunk->count+i].set(p[0], p[1], p[2]);
+        (*chunk->data)[chunk->count+i].set(d[0], d[1]);
+      }
+      chunk->count += num;
+      chunk->vertices->dirty();
+      chunk->data->dirty();
+      chunk->drawArray->setCount(chunk->count);
+      chunk->geom->dirtyBound();
+      n += num;
+    }
+    currentTimeUniform->set((float)now);
+  }
+
+  void PointsStreamP::clear() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(pendingMutex);
+    pendingPoints.clear();
+    pendingData.clear();
+    clearPending = true;
+  }
+
+  void PointsStreamP::setColorMode(StreamColorMode mode) {
+    colorModeUniform->set((int)mode);
+  }
+
+  void PointsStreamP::setColorRange(float min, float max) {
+    colorRangeUniform->set(osg::Vec2(min, max));
+  }
+
+  void PointsStreamP::setFadeTime(double seconds) {
+    fadeTimeUniform->set((float)seconds);
+  }
+
+  void PointsStreamP::setPointSize(double size) {
+    pointSize->setSize(size);
+  }
+
+  void* PointsStreamP::getOSGNode() {
+    return (void*)(osg::Node*)node.get();
+  }
+
+} // end of namespace: osg_points
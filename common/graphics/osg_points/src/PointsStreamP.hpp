@@ -0,0 +1,100 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file PointsStreamP.hpp
+ * \brief OSG implementation of the PointsStream.
+ **/
+
+#ifndef OSG_POINTS_STREAM_P_H
+#define OSG_POINTS_STREAM_P_H
+
+#include "PointsStream.hpp"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Point>
+#include <osg/Uniform>
+#include <OpenThreads/Mutex>
+
+#include <vector>
+
+namespace osg_points {
+
+  /**
+   * The points are stored in a ring of chunks. Every chunk is a geometry
+   * with a preallocated vertex buffer object of \c chunkSize points. New
+   * points are written behind the last point of the current chunk; when
+   * the ring is full the oldest chunk is reused. Thus only the chunks that
+   * received points are uploaded again in a frame.
+   *
+   * appendPoints() only copies the points into a pending buffer. They are
+   * moved into the chunks during the update traversal.
+   */
+  class PointsStreamP : public osg::Group, public PointsStream {
+
+  public:
+    PointsStreamP(size_t chunkSize, size_t numChunks);
+    ~PointsStreamP();
+
+    void appendPoints(const float *points, const float *intensities,
+                      size_t numPoints, double time);
+    void clear();
+    void setColorMode(StreamColorMode mode);
+    void setColorRange(float min, float max);
+    void setFadeTime(double seconds);
+    void setPointSize(double size);
+    void* getOSGNode();
+
+    /** \brief moves the pending points into the chunks */
+    void flush();
+
+  private:
+    struct Chunk {
+      osg::ref_ptr<osg::Geometry> geom;
+      osg::ref_ptr<osg::Vec3Array> vertices;
+      // x: intensity, y: time stamp relative to timeBase
+      osg::ref_ptr<osg::Vec2Array> data;
+      osg::ref_ptr<osg::DrawArrays> drawArray;
+      size_t count;
+    };
+
+    void createShader();
+
+    size_t chunkSize;
+    std::vector<Chunk> chunks;
+    size_t currentChunk;
+
+    OpenThreads::Mutex pendingMutex;
+    std::vector<float> pendingPoints, pendingData;
+    std::vector<float> flushPoints, flushData;
+    bool clearPending;
+    bool haveTimeBase;
+    double timeBase, lastTime;
+
+    osg::ref_ptr<osg::Geode> node;
+    osg::ref_ptr<osg::Point> pointSize;
+    osg::ref_ptr<osg::Uniform> currentTimeUniform, fadeTimeUniform;
+    osg::ref_ptr<osg::Uniform> colorModeUniform, colorRangeUniform;
+  };
+
+} // end of namespace: osg_points
+
+#endif // OSG_POINTS_STREAM_P_H
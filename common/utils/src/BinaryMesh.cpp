@@ -0,0 +1,454 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BinaryMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#ifndef WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace mars {
+  namespace utils {
+
+    static const char BINARY_MESH_MAGIC[8] = {'M', 'A', 'R', 'S',
+                                              'B', 'O', 'B', 'J'};
+
+    static uint64_t align8(uint64_t offset) {
+      return (offset + 7) & ~(uint64_t)7;
+    }
+
+    // spreads the lower 10 bits of v to every third bit
+    static uint32_t spreadBits(uint32_t v) {
+      v &= 0x3ff;
+      v = (v | (v << 16)) & 0x030000ff;
+      v = (v | (v << 8)) & 0x0300f00f;
+      v = (v | (v << 4)) & 0x030c30c3;
+      v = (v | (v << 2)) & 0x09249249;
+      return v;
+    }
+
+    namespace {
+
+      struct WeldKey {
+        long long x, y, z;
+        bool operator<(const WeldKey &o) const {
+          if(x != o.x) return x < o.x;
+          if(y != o.y) return y < o.y;
+          return z < o.z;
+        }
+      };
+
+      struct Triangle {
+        uint32_t code;
+        uint32_t v[3];
+        bool operator<(const Triangle &o) const {
+          return code < o.code;
+        }
+      };
+
+      struct ArrayWriter {
+        FILE *file;
+        uint64_t offset;
+        bool ok;
+
+        void write(const void *data, size_t bytes) {
+          if(bytes && fwrite(data, 1, bytes, file) != bytes) ok = false;
+          offset += bytes;
+        }
+        void pad() {
+          static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+          write(zeros, (size_t)(align8(offset) - offset));
+        }
+      };
+
+    } // end of anonymous namespace
+
+    BinaryMesh::BinaryMesh() : data(NULL), size(0), mapped(false),
+                               header(NULL) {
+    }
+
+    BinaryMesh::~BinaryMesh() {
+      close();
+    }
+
+    bool BinaryMesh::isBinaryMesh(const std::string &filename) {
+      FILE *file = fopen(filename.c_str(), "rb");
+      if(!file) return false;
+      char magic[8];
+      bool result = (fread(magic, 1, 8, file) == 8 &&
+                     memcmp(magic, BINARY_MESH_MAGIC, 8) == 0);
+      fclose(file);
+      return result;
+    }
+
+    bool BinaryMesh::open(const std::string &filename) {
+      close();
+#ifndef WIN32
+      int fd = ::open(filename.c_str(), O_RDONLY);
+      if(fd < 0) return false;
+      struct stat st;
+      if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BinaryMeshHeader)) {
+        ::close(fd);
+        return false;
+      }
+      void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if(p == MAP_FAILED) return false;
+      data = (const char*)p;
+      size = (size_t)st.st_size;
+      mapped = true;
+#else
+      FILE *file = fopen(filename.c_str(), "rb");
+      if(!file) return false;
+      fseek(file, 0, SEEK_END);
+      long fileSize = ftell(file);
+      fseek(file, 0, SEEK_SET);
+      if(fileSize < (long)sizeof(BinaryMeshHeader)) {
+        fclose(file);
+        return false;
+      }
+      // malloc returns memory aligned for any type
+      char *buffer = (char*)malloc(fileSize);
+      if(!buffer || fread(buffer, 1, fileSize, file) != (size_t)fileSize) {
+        free(buffer);
+        fclose(file);
+        return false;
+      }
+      fclose(file);
+      data = buffer;
+      size = (size_t)fileSize;
+#endif
+      header = (const BinaryMeshHeader*)data;
+      if(!validate()) {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    void BinaryMesh::close() {
+      if(!data) return;
+#ifndef WIN32
+      if(mapped) munmap((void*)data, size);
+#else
+      free((void*)data);
+#endif
+      data = NULL;
+      header = NULL;
+      size = 0;
+      mapped = false;
+    }
+
+    bool BinaryMesh::validate() const {
+      const BinaryMeshHeader &h = *header;
+      if(memcmp(h.magic, BINARY_MESH_MAGIC, 8) != 0) return false;
+      if(h.version != BINARY_MESH_VERSION) {
+        fprintf(stderr, "BinaryMesh: unsupported version %u\n", h.version);
+        return false;
+      }
+      if(h.numIndices % 3 || h.numCollisionIndices % 3) return false;
+
+      struct {uint64_t offset, bytes;} arrays[] = {
+        {h.partsOffset, (uint64_t)h.numParts*sizeof(BinaryMeshPart)},
+        {h.positionsOffset, (uint64_t)h.numVertices*12},
+        {h.normalsOffset, (uint64_t)h.numVertices*12},
+        {h.texcoordsOffset, h.hasTexcoords ? (uint64_t)h.numVertices*8 : 0},
+        {h.indicesOffset, (uint64_t)h.numIndices*4},
+        {h.collisionVerticesOffset, (uint64_t)h.numCollisionVertices*12},
+        {h.collisionIndicesOffset, (uint64_t)h.numCollisionIndices*4}};
+      for(size_t i=0; i<sizeof(arrays)/sizeof(arrays[0]); ++i) {
+        if(arrays[i].offset % 8 || arrays[i].offset > size ||
+           arrays[i].bytes > size - arrays[i].offset) {
+          fprintf(stderr, "BinaryMesh: file is truncated or broken\n");
+          return false;
+        }
+      }
+
+      const BinaryMeshPart *parts = getParts();
+      for(uint32_t i=0; i<h.numParts; ++i) {
+        if((uint64_t)parts[i].firstIndex + parts[i].numIndices > h.numIndices ||
+           ((uint64_t)parts[i].firstCollisionIndex +
+            parts[i].numCollisionIndices > h.numCollisionIndices)) {
+          return false;
+        }
+      }
+      const uint32_t *indices = getIndices();
+      for(uint32_t i=0; i<h.numIndices; ++i) {
+        if(indices[i] >= h.numVertices) return false;
+      }
+      indices = getCollisionIndices();
+      for(uint32_t i=0; i<h.numCollisionIndices; ++i) {
+        if(indices[i] >= h.numCollisionVertices) return false;
+      }
+      return true;
+    }
+
+    const BinaryMeshPart* BinaryMesh::getParts() const {
+      return (const BinaryMeshPart*)(data + header->partsOffset);
+    }
+
+    const float* BinaryMesh::getPositions() const {
+      return (const float*)(data + header->positionsOffset);
+    }
+
+    const float* BinaryMesh::getNormals() const {
+      return (const float*)(data + header->normalsOffset);
+    }
+
+    const float* BinaryMesh::getTexcoords() const {
+      if(!header->hasTexcoords) return NULL;
+      return (const float*)(data + header->texcoordsOffset);
+    }
+
+    const uint32_t* BinaryMesh::getIndices() const {
+      return (const uint32_t*)(data + header->indicesOffset);
+    }
+
+    const float* BinaryMesh::getCollisionVertices() const {
+      return (const float*)(data + header->collisionVerticesOffset);
+    }
+
+    const uint32_t* BinaryMesh::getCollisionIndices() const {
+      return (const uint32_t*)(data + header->collisionIndicesOffset);
+    }
+
+    bool BinaryMesh::write(const std::string &filename,
+                           const std::vector<BinaryMeshSource> &sources) {
+      BinaryMeshHeader h;
+      memset(&h, 0, sizeof(h));
+      memcpy(h.magic, BINARY_MESH_MAGIC, 8);
+      h.version = BINARY_MESH_VERSION;
+      h.numParts = (uint32_t)sources.size();
+      h.hasTexcoords = 1;
+
+      // render mesh
+      std::vector<float> positions, normals, texcoords;
+      std::vector<uint32_t> indices;
+      std::vector<BinaryMeshPart> parts(sources.size());
+      for(size_t i=0; i<sources.size(); ++i) {
+        const BinaryMeshSource &s = sources[i];
+        size_t numVertices = s.positions.size()/3;
+        if(s.normals.size() != s.positions.size() || s.indices.size() % 3 ||
+           (!s.texcoords.empty() && s.texcoords.size() != numVertices*2)) {
+          fprintf(stderr, "BinaryMesh: inconsistent arrays in part \"%s\"\n",
+                  s.name.c_str());
+          return false;
+        }
+        if(s.texcoords.empty() && numVertices) h.hasTexcoords = 0;
+        memset(parts[i].name, 0, sizeof(parts[i].name));
+        strncpy(parts[i].name, s.name.c_str(), sizeof(parts[i].name)-1);
+        parts[i].firstIndex = (uint32_t)indices.size();
+        parts[i].numIndices = (uint32_t)s.indices.size();
+        uint32_t base = (uint32_t)(positions.size()/3);
+        for(size_t k=0; k<s.indices.size(); ++k) {
+          if(s.indices[k] >= numVertices) {
+            fprintf(stderr, "BinaryMesh: index out of range in part \"%s\"\n",
+                    s.name.c_str());
+            return false;
+          }
+          indices.push_back(base + s.indices[k]);
+        }
+        positions.insert(positions.end(), s.positions.begin(),
+                         s.positions.end());
+        normals.insert(normals.end(), s.normals.begin(), s.normals.end());
+        texcoords.insert(texcoords.end(), s.texcoords.begin(),
+                         s.texcoords.end());
+      }
+      if(!h.hasTexcoords) texcoords.clear();
+      h.numVertices = (uint32_t)(positions.size()/3);
+      h.numIndices = (uint32_t)indices.size();
+
+      for(int k=0; k<3; ++k) {
+        h.bboxMin[k] = h.numVertices ? positions[k] : 0;
+        h.bboxMax[k] = h.numVertices ? positions[k] : 0;
+      }
+      for(size_t i=0; i<positions.size(); i+=3) {
+        for(int k=0; k<3; ++k) {
+          h.bboxMin[k] = std::min(h.bboxMin[k], positions[i+k]);
+          h.bboxMax[k] = std::max(h.bboxMax[k], positions[i+k]);
+        }
+      }
+
+      // weld the collision vertices on a grid relative to the mesh size
+      double diag = 0;
+      for(int k=0; k<3; ++k) {
+        diag += ((double)h.bboxMax[k]-h.bboxMin[k])*(h.bboxMax[k]-h.bboxMin[k]);
+      }
+      double cell = sqrt(diag)*1e-6;
+      if(cell <= 0) cell = 1e-9;
+      std::map<WeldKey, uint32_t> welded;
+      std::vector<uint32_t> weldMap(h.numVertices);
+      std::vector<float> collisionVertices;
+      for(uint32_t i=0; i<h.numVertices; ++i) {
+        WeldKey key;
+        key.x = (long long)floor(positions[i*3]/cell + 0.5);
+        key.y = (long long)floor(positions[i*3+1]/cell + 0.5);
+        key.z = (long long)floor(positions[i*3+2]/cell + 0.5);
+        std::map<WeldKey, uint32_t>::iterator it = welded.find(key);
+        if(it == welded.end()) {
+          uint32_t index = (uint32_t)(collisionVertices.size()/3);
+          welded[key] = index;
+          collisionVertices.insert(collisionVertices.end(),
+                                   positions.begin()+i*3,
+                                   positions.begin()+i*3+3);
+          weldMap[i] = index;
+        } else {
+          weldMap[i] = it->second;
+        }
+      }
+      h.numCollisionVertices = (uint32_t)(collisionVertices.size()/3);
+
+      std::vector<uint32_t> collisionIndices;
+      double volume = 0, com[3] = {0, 0, 0}, cov[3][3] = {{0}};
+      for(size_t p=0; p<parts.size(); ++p) {
+        std::vector<Triangle> triangles;
+        for(uint32_t i=0; i<parts[p].numIndices; i+=3) {
+          Triangle t;
+          for(int k=0; k<3; ++k) {
+            t.v[k] = weldMap[indices[parts[p].firstIndex+i+k]];
+          }
+          if(t.v[0] == t.v[1] || t.v[1] == t.v[2] || t.v[0] == t.v[2]) {
+            continue;
+          }
+          uint32_t q[3];
+          for(int k=0; k<3; ++k) {
+            double c = (collisionVertices[t.v[0]*3+k] +
+                        collisionVertices[t.v[1]*3+k] +
+                        collisionVertices[t.v[2]*3+k]) / 3.0;
+            double range = (double)h.bboxMax[k] - h.bboxMin[k];
+            q[k] = range > 0 ? (uint32_t)((c - h.bboxMin[k]) / range * 1023.0) : 0;
+          }
+          t.code = spreadBits(q[0]) | (spreadBits(q[1]) << 1) | (spreadBits(q[2]) << 2);
+          triangles.push_back(t);
+        }
+        std::stable_sort(triangles.begin(), triangles.end());
+
+        parts[p].firstCollisionIndex = (uint32_t)collisionIndices.size();
+        parts[p].numCollisionIndices = (uint32_t)triangles.size()*3;
+        for(size_t i=0; i<triangles.size(); ++i) {
+          double v[3][3];
+          for(int k=0; k<3; ++k) {
+            collisionIndices.push_back(triangles[i].v[k]);
+            for(int j=0; j<3; ++j) {
+              v[k][j] = collisionVertices[triangles[i].v[k]*3+j];
+            }
+          }
+          // signed tetrahedron to the origin
+          double det = (v[0][0]*(v[1][1]*v[2][2] - v[1][2]*v[2][1]) -
+                        v[0][1]*(v[1][0]*v[2][2] - v[1][2]*v[2][0]) +
+                        v[0][2]*(v[1][0]*v[2][1] - v[1][1]*v[2][0]));
+          double sum[3];
+          for(int j=0; j<3; ++j) sum[j] = v[0][j] + v[1][j] + v[2][j];
+          volume += det/6.0;
+          for(int j=0; j<3; ++j) {
+            com[j] += det*sum[j]/24.0;
+            for(int l=0; l<3; ++l) {
+              cov[j][l] += det/120.0*(v[0][j]*v[0][l] + v[1][j]*v[1][l] +
+                                      v[2][j]*v[2][l] + sum[j]*sum[l]);
+            }
+          }
+        }
+      }
+      h.numCollisionIndices = (uint32_t)collisionIndices.size();
+
+      if(volume != 0) {
+        // inverted winding gives a negative volume
+        double sign = volume < 0 ? -1 : 1;
+        volume *= sign;
+        for(int j=0; j<3; ++j) {
+          com[j] *= sign/volume;
+          for(int l=0; l<3; ++l) cov[j][l] *= sign;
+        }
+        for(int j=0; j<3; ++j) {
+          for(int l=0; l<3; ++l) cov[j][l] -= volume*com[j]*com[l];
+        }
+        double trace = cov[0][0] + cov[1][1] + cov[2][2];
+        h.volume = (float)volume;
+        for(int j=0; j<3; ++j) h.centerOfMass[j] = (float)com[j];
+        h.inertia[0] = (float)(trace - cov[0][0]);
+        h.inertia[1] = (float)(trace - cov[1][1]);
+        h.inertia[2] = (float)(trace - cov[2][2]);
+        h.inertia[3] = (float)-cov[0][1];
+        h.inertia[4] = (float)-cov[0][2];
+        h.inertia[5] = (float)-cov[1][2];
+      }
+
+      // layout
+      uint64_t offset = align8(sizeof(BinaryMeshHeader));
+      h.partsOffset = offset;
+      offset = align8(offset + parts.size()*sizeof(BinaryMeshPart));
+      h.positionsOffset = offset;
+      offset = align8(offset + positions.size()*4);
+      h.normalsOffset = offset;
+      offset = align8(offset + normals.size()*4);
+      h.texcoordsOffset = offset;
+      offset = align8(offset + texcoords.size()*4);
+      h.indicesOffset = offset;
+      offset = align8(offset + indices.size()*4);
+      h.collisionVerticesOffset = offset;
+      offset = align8(offset + collisionVertices.size()*4);
+      h.collisionIndicesOffset = offset;
+
+      FILE *file = fopen(filename.c_str(), "wb");
+      if(!file) {
+        fprintf(stderr, "BinaryMesh: could not open \"%s\" for writing\n",
+                filename.c_str());
+        return false;
+      }
+      ArrayWriter w = {file, 0, true};
+      w.write(&h, sizeof(h));
+      w.pad();
+      if(!parts.empty()) w.write(&parts[0], parts.size()*sizeof(BinaryMeshPart));
+      w.pad();
+      if(!positions.empty()) w.write(&positions[0], positions.size()*4);
+      w.pad();
+      if(!normals.empty()) w.write(&normals[0], normals.size()*4);
+      w.pad();
+      if(!texcoords.empty()) w.write(&texcoords[0], texcoords.size()*4);
+      w.pad();
+      if(!indices.empty()) w.write(&indices[0], indices.size()*4);
+      w.pad();
+      if(!collisionVertices.empty()) {
+        w.write(&collisionVertices[0], collisionVertices.size()*4);
+      }
+      w.pad();
+      if(!collisionIndices.empty()) {
+        w.write(&collisionIndices[0], collisionIndices.size()*4);
+      }
+      fclose(file);
+      if(!w.ok) {
+        fprintf(stderr, "BinaryMesh: error while writing \"%s\"\n",
+                filename.c_str());
+      }
+      return w.ok;
+    }
+
+  } // end of namespace utils
+} // end of namespace mars
@@ -0,0 +1,136 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MARS_UTILS_BINARYMESH_H
+#define MARS_UTILS_BINARYMESH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace utils {
+
+    const uint32_t BINARY_MESH_VERSION = 3;
+
+    /**
+     * The header of a versioned .bobj file. The first .bobj format was a
+     * plain stream of OBJ records without header; it is still read by the
+     * graphics. All data is stored in the byte order of the writing host
+     * (little endian on all supported platforms) and every array starts at
+     * an 8 byte aligned offset, so the file can be used directly from a
+     * memory mapping.
+     */
+    struct BinaryMeshHeader {
+      char magic[8]; ///< "MARSBOBJ"
+      uint32_t version;
+      uint32_t numParts;
+      /** the render mesh: indexed triangles with per vertex normals */
+      uint32_t numVertices, numIndices;
+      /**
+       * The collision mesh: the positions of the render mesh welded, the
+       * degenerated triangles removed and the triangles of every part
+       * sorted along a Morton curve, which gives the bounding volume tree
+       * built by the collider a good memory locality.
+       */
+      uint32_t numCollisionVertices, numCollisionIndices;
+      uint32_t hasTexcoords;
+      uint32_t reserved;
+      float bboxMin[3], bboxMax[3];
+      /**
+       * Mass properties of the collision mesh for a density of 1; the
+       * inertia (xx, yy, zz, xy, xz, yz) is given at the center of mass.
+       * Only meaningful for closed meshes. Used for the mass of mesh nodes
+       * by interfaces::getPhysicsFromBinaryMesh.
+       */
+      float volume;
+      float centerOfMass[3];
+      float inertia[6];
+      uint64_t partsOffset;
+      uint64_t positionsOffset, normalsOffset, texcoordsOffset, indicesOffset;
+      uint64_t collisionVerticesOffset, collisionIndicesOffset;
+    };
+
+    /**
+     * A named object of the source file (e.g. an OBJ group). The index
+     * ranges refer to the index arrays of the whole file.
+     */
+    struct BinaryMeshPart {
+      char name[64];
+      uint32_t firstIndex, numIndices;
+      uint32_t firstCollisionIndex, numCollisionIndices;
+    };
+
+    /** \brief Input of BinaryMesh::write. */
+    struct BinaryMeshSource {
+      std::string name;
+      std::vector<float> positions; ///< x, y, z per vertex
+      std::vector<float> normals;   ///< x, y, z per vertex
+      std::vector<float> texcoords; ///< u, v per vertex or empty
+      std::vector<uint32_t> indices; ///< three per triangle
+    };
+
+    /**
+     * \brief Read-only view of a versioned .bobj file mapped into memory.
+     */
+    class BinaryMesh {
+    public:
+      BinaryMesh();
+      ~BinaryMesh();
+
+      /** \brief returns \c true if the file starts with the magic bytes */
+      static bool isBinaryMesh(const std::string &filename);
+      static bool write(const std::string &filename,
+                        const std::vector<BinaryMeshSource> &parts);
+
+      /**
+       * \brief Maps the file and checks that all arrays and indices are
+       *        inside of it.
+       * \return \c false for missing, legacy or broken files
+       */
+      bool open(const std::string &filename);
+      void close();
+
+      const BinaryMeshHeader* getHeader() const {return header;}
+      const BinaryMeshPart* getParts() const;
+      const float* getPositions() const;
+      const float* getNormals() const;
+      /** \return NULL if the mesh has no texture coordinates */
+      const float* getTexcoords() const;
+      const uint32_t* getIndices() const;
+      const float* getCollisionVertices() const;
+      const uint32_t* getCollisionIndices() const;
+
+    private:
+      BinaryMesh(const BinaryMesh&);
+      BinaryMesh& operator=(const BinaryMesh&);
+
+      bool validate() const;
+
+      const char *data;
+      size_t size;
+      bool mapped;
+      const BinaryMeshHeader *header;
+    }; // end of class BinaryMesh
+
+  } // end of namespace utils
+} // end of namespace mars
+
+#endif // MARS_UTILS_BINARYMESH_H
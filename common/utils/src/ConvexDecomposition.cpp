@@ -0,0 +1,951 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ConvexDecomposition.h"
+
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace mars {
+  namespace utils {
+
+    static const char CONVEX_HULLS_MAGIC[8] = {'M', 'A', 'R', 'S',
+                                               'H', 'U', 'L', 'L'};
+    /** increase if the decomposition changes to invalidate the caches */
+    static const uint32_t CONVEX_HULLS_VERSION = 1;
+
+    namespace {
+
+      /** the number of candidate cut planes per axis */
+      const int numCuts = 7;
+      /** hulls in cache files are not expected to be larger */
+      const uint32_t maxCachedPoints = 1 << 20;
+
+      void cross(const double *a, const double *b, const double *c,
+                 double *n) {
+        double u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+        double v[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+        n[0] = u[1]*v[2] - u[2]*v[1];
+        n[1] = u[2]*v[0] - u[0]*v[2];
+        n[2] = u[0]*v[1] - u[1]*v[0];
+      }
+
+      double dot(const double *a, const double *b) {
+        return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+      }
+
+      double distance2(const double *a, const double *b) {
+        double d[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+        return dot(d, d);
+      }
+
+      struct Face {
+        uint32_t v[3];
+        /** the outward normal; n*p + d is the signed distance of p */
+        double n[3], d;
+        /** the points above the face that are not assigned to another */
+        std::vector<uint32_t> outside;
+        bool removed;
+      };
+
+      class HullBuilder {
+      public:
+        explicit HullBuilder(const std::vector<double> &points)
+          : points(points), epsilon(0) {}
+
+        bool build(size_t maxVertices);
+        void write(ConvexHull *hull) const;
+
+      private:
+        const double* position(uint32_t p) const {return &points[p*3];}
+        double distance(const Face &f, uint32_t p) const {
+          return dot(f.n, position(p)) + f.d;
+        }
+        static uint64_t edgeKey(uint32_t a, uint32_t b) {
+          return ((uint64_t)a << 32) | b;
+        }
+        uint32_t addFace(uint32_t a, uint32_t b, uint32_t c);
+        void removeFace(uint32_t f);
+        void addPoint(uint32_t face, uint32_t eye);
+
+        const std::vector<double> &points;
+        std::vector<Face> faces;
+        /** the face on the left of every directed edge */
+        std::map<uint64_t, uint32_t> edges;
+        double epsilon;
+      };
+
+      uint32_t HullBuilder::addFace(uint32_t a, uint32_t b, uint32_t c) {
+        Face f;
+        f.v[0] = a;
+        f.v[1] = b;
+        f.v[2] = c;
+        cross(position(a), position(b), position(c), f.n);
+        double length = sqrt(dot(f.n, f.n));
+        if(length > 0) {
+          for(int k=0; k<3; ++k) f.n[k] /= length;
+        }
+        f.d = -dot(f.n, position(a));
+        f.removed = false;
+        uint32_t index = (uint32_t)faces.size();
+        faces.push_back(f);
+        edges[edgeKey(a, b)] = index;
+        edges[edgeKey(b, c)] = index;
+        edges[edgeKey(c, a)] = index;
+        return index;
+      }
+
+      void HullBuilder::removeFace(uint32_t f) {
+        Face &face = faces[f];
+        for(int k=0; k<3; ++k) {
+          std::map<uint64_t, uint32_t>::iterator it;
+          it = edges.find(edgeKey(face.v[k], face.v[(k+1)%3]));
+          if(it != edges.end() && it->second == f) edges.erase(it);
+        }
+        std::vector<uint32_t>().swap(face.outside);
+        face.removed = true;
+      }
+
+      bool HullBuilder::build(size_t maxVertices) {
+        uint32_t numPoints = (uint32_t)(points.size()/3);
+        faces.clear();
+        edges.clear();
+        if(numPoints < 4) return false;
+
+        // start with the largest tetrahedron spanned by the extreme points
+        uint32_t extremes[6] = {0, 0, 0, 0, 0, 0};
+        double scale = 0;
+        for(uint32_t p=0; p<numPoints; ++p) {
+          const double *v = position(p);
+          for(int k=0; k<3; ++k) {
+            if(v[k] < position(extremes[k*2])[k]) extremes[k*2] = p;
+            if(v[k] > position(extremes[k*2+1])[k]) extremes[k*2+1] = p;
+            scale = std::max(scale, fabs(v[k]));
+          }
+        }
+        epsilon = 3e-9*scale;
+        uint32_t a = 0, b = 0;
+        double best = 0;
+        for(int i=0; i<6; ++i) {
+          for(int j=i+1; j<6; ++j) {
+            double d = distance2(position(extremes[i]), position(extremes[j]));
+            if(d > best) {
+              best = d;
+              a = extremes[i];
+              b = extremes[j];
+            }
+          }
+        }
+        if(sqrt(best) <= epsilon) return false;
+        double lineLength2 = best;
+        uint32_t c = 0;
+        best = 0;
+        for(uint32_t p=0; p<numPoints; ++p) {
+          double n[3];
+          cross(position(a), position(b), position(p), n);
+          double d = dot(n, n)/lineLength2;
+          if(d > best) {
+            best = d;
+            c = p;
+          }
+        }
+        if(sqrt(best) <= epsilon) return false;
+        double n[3];
+        cross(position(a), position(b), position(c), n);
+        double length = sqrt(dot(n, n));
+        for(int k=0; k<3; ++k) n[k] /= length;
+        double offset = -dot(n, position(a));
+        uint32_t d = 0;
+        best = 0;
+        for(uint32_t p=0; p<numPoints; ++p) {
+          double distance = fabs(dot(n, position(p)) + offset);
+          if(distance > best) {
+            best = distance;
+            d = p;
+          }
+        }
+        if(best <= epsilon) return false;
+
+        const uint32_t simplex[4] = {a, b, c, d};
+        double center[3];
+        for(int k=0; k<3; ++k) {
+          center[k] = (position(a)[k] + position(b)[k] +
+                       position(c)[k] + position(d)[k])*0.25;
+        }
+        static const int tetrahedron[4][3] = {{0, 1, 2}, {0, 1, 3},
+                                              {0, 2, 3}, {1, 2, 3}};
+        for(int i=0; i<4; ++i) {
+          uint32_t u = simplex[tetrahedron[i][0]];
+          uint32_t v = simplex[tetrahedron[i][1]];
+          uint32_t w = simplex[tetrahedron[i][2]];
+          cross(position(u), position(v), position(w), n);
+          if(dot(n, center) - dot(n, position(u)) > 0) std::swap(v, w);
+          addFace(u, v, w);
+        }
+        for(uint32_t p=0; p<numPoints; ++p) {
+          if(p == a || p == b || p == c || p == d) continue;
+          for(uint32_t f=0; f<4; ++f) {
+            if(distance(faces[f], p) > epsilon) {
+              faces[f].outside.push_back(p);
+              break;
+            }
+          }
+        }
+
+        // add the farthest point until all points are inside
+        size_t numVertices = 4;
+        while(!maxVertices || numVertices < maxVertices) {
+          uint32_t face = 0, eye = 0;
+          best = 0;
+          for(uint32_t f=0; f<faces.size(); ++f) {
+            const Face &current = faces[f];
+            for(size_t i=0; i<current.outside.size(); ++i) {
+              double distance = this->distance(current, current.outside[i]);
+              if(distance > best) {
+                best = distance;
+                face = f;
+                eye = current.outside[i];
+              }
+            }
+          }
+          if(best <= 0) break;
+          addPoint(face, eye);
+          ++numVertices;
+        }
+        return true;
+      }
+
+      void HullBuilder::addPoint(uint32_t face, uint32_t eye) {
+        // the faces seen from the eye; collected by walking over the edges
+        // so that rounding can not produce a second visible region
+        std::vector<char> visited(faces.size(), 0);
+        std::vector<uint32_t> stack(1, face), visible;
+        std::vector<std::pair<uint32_t, uint32_t> > horizon;
+        visited[face] = 1;
+        while(!stack.empty()) {
+          uint32_t f = stack.back();
+          stack.pop_back();
+          visible.push_back(f);
+          for(int k=0; k<3; ++k) {
+            uint32_t a = faces[f].v[k], b = faces[f].v[(k+1)%3];
+            std::map<uint64_t, uint32_t>::iterator it;
+            it = edges.find(edgeKey(b, a));
+            if(it != edges.end()) {
+              uint32_t g = it->second;
+              if(visited[g]) continue;
+              if(distance(faces[g], eye) > epsilon) {
+                visited[g] = 1;
+                stack.push_back(g);
+                continue;
+              }
+            }
+            horizon.push_back(std::make_pair(a, b));
+          }
+        }
+
+        std::vector<uint32_t> orphans;
+        for(size_t i=0; i<visible.size(); ++i) {
+          const std::vector<uint32_t> &outside = faces[visible[i]].outside;
+          for(size_t k=0; k<outside.size(); ++k) {
+            if(outside[k] != eye) orphans.push_back(outside[k]);
+          }
+          removeFace(visible[i]);
+        }
+        std::vector<uint32_t> created;
+        for(size_t i=0; i<horizon.size(); ++i) {
+          created.push_back(addFace(horizon[i].first, horizon[i].second, eye));
+        }
+        for(size_t i=0; i<orphans.size(); ++i) {
+          for(size_t k=0; k<created.size(); ++k) {
+            if(distance(faces[created[k]], orphans[i]) > epsilon) {
+              faces[created[k]].outside.push_back(orphans[i]);
+              break;
+            }
+          }
+        }
+      }
+
+      void HullBuilder::write(ConvexHull *hull) const {
+        std::vector<int> remap(points.size()/3, -1);
+        hull->points.clear();
+        hull->triangles.clear();
+        for(size_t f=0; f<faces.size(); ++f) {
+          if(faces[f].removed) continue;
+          for(int k=0; k<3; ++k) {
+            uint32_t v = faces[f].v[k];
+            if(remap[v] < 0) {
+              remap[v] = (int)(hull->points.size()/3);
+              for(int j=0; j<3; ++j) hull->points.push_back(position(v)[j]);
+            }
+            hull->triangles.push_back((uint32_t)remap[v]);
+          }
+        }
+      }
+
+      double getVolume(const ConvexHull &hull) {
+        if(hull.points.empty()) return 0;
+        const double *o = &hull.points[0];
+        double volume = 0;
+        for(size_t t=0; t+2<hull.triangles.size(); t+=3) {
+          const double *a = &hull.points[hull.triangles[t]*3];
+          const double *b = &hull.points[hull.triangles[t+1]*3];
+          const double *c = &hull.points[hull.triangles[t+2]*3];
+          double n[3], u[3] = {a[0]-o[0], a[1]-o[1], a[2]-o[2]};
+          cross(a, b, c, n);
+          volume += dot(u, n)/6.0;
+        }
+        return volume;
+      }
+
+      /** clips a triangle to the side of the plane where s is not positive */
+      void clipTriangle(const double *p, const double *s, double sign,
+                        std::vector<double> *out) {
+        double polygon[4][3];
+        int n = 0;
+        for(int k=0; k<3; ++k) {
+          int j = (k+1)%3;
+          double sk = sign*s[k], sj = sign*s[j];
+          if(sk <= 0) {
+            for(int i=0; i<3; ++i) polygon[n][i] = p[k*3+i];
+            ++n;
+          }
+          if((sk < 0 && sj > 0) || (sk > 0 && sj < 0)) {
+            double t = sk/(sk-sj);
+            for(int i=0; i<3; ++i) {
+              polygon[n][i] = p[k*3+i] + t*(p[j*3+i]-p[k*3+i]);
+            }
+            ++n;
+          }
+        }
+        for(int k=1; k+1<n; ++k) {
+          out->insert(out->end(), polygon[0], polygon[0]+3);
+          out->insert(out->end(), polygon[k], polygon[k]+3);
+          out->insert(out->end(), polygon[k+1], polygon[k+1]+3);
+        }
+      }
+
+      void splitTriangles(const std::vector<double> &triangles, int axis,
+                          double value, std::vector<double> *below,
+                          std::vector<double> *above) {
+        below->clear();
+        above->clear();
+        size_t numTriangles = triangles.size()/9;
+        for(size_t t=0; t<numTriangles; ++t) {
+          const double *p = &triangles[t*9];
+          double s[3];
+          for(int k=0; k<3; ++k) s[k] = p[k*3+axis] - value;
+          if(s[0] <= 0 && s[1] <= 0 && s[2] <= 0) {
+            below->insert(below->end(), p, p+9);
+          }
+          else if(s[0] >= 0 && s[1] >= 0 && s[2] >= 0) {
+            above->insert(above->end(), p, p+9);
+          }
+          else {
+            clipTriangle(p, s, 1.0, below);
+            clipTriangle(p, s, -1.0, above);
+          }
+        }
+      }
+
+      enum CellState {
+        CELL_OUTSIDE,
+        CELL_SURFACE,
+        CELL_INSIDE
+      };
+
+      /** \brief the mesh sampled on a regular grid with an empty border */
+      struct VoxelGrid {
+        int n[3];
+        double origin[3], size;
+        std::vector<unsigned char> cells;
+
+        size_t index(int x, int y, int z) const {
+          return ((size_t)z*n[1] + y)*n[0] + x;
+        }
+
+        /** \brief the cells whose centers are in [bmin, bmax) on \a axis */
+        void getRange(int axis, double bmin, double bmax,
+                      int *first, int *last) const {
+          *first = std::max(0, (int)ceil((bmin - origin[axis])/size - 0.5));
+          *last = std::min(n[axis]-1,
+                           (int)ceil((bmax - origin[axis])/size - 0.5) - 1);
+        }
+
+        void build(const std::vector<double> &triangles, const double *bmin,
+                   const double *bmax, unsigned int resolution);
+      };
+
+      void VoxelGrid::build(const std::vector<double> &triangles,
+                            const double *bmin, const double *bmax,
+                            unsigned int resolution) {
+        double extent = 0;
+        for(int k=0; k<3; ++k) extent = std::max(extent, bmax[k] - bmin[k]);
+        size = extent/std::max(resolution, 1u);
+        for(int k=0; k<3; ++k) {
+          n[k] = (int)ceil((bmax[k] - bmin[k])/size) + 2;
+          origin[k] = bmin[k] - size;
+        }
+        cells.assign((size_t)n[0]*n[1]*n[2], CELL_OUTSIDE);
+
+        // mark the cells of samples at most half a cell apart
+        size_t numTriangles = triangles.size()/9;
+        for(size_t t=0; t<numTriangles; ++t) {
+          const double *p = &triangles[t*9];
+          double edge = std::max(std::max(distance2(p, p+3),
+                                          distance2(p+3, p+6)),
+                                 distance2(p+6, p));
+          int m = std::max(1, (int)ceil(sqrt(edge)/(size*0.5)));
+          for(int i=0; i<=m; ++i) {
+            for(int j=0; i+j<=m; ++j) {
+              int c[3];
+              for(int k=0; k<3; ++k) {
+                double x = p[k] + (p[3+k]-p[k])*i/m + (p[6+k]-p[k])*j/m;
+                c[k] = std::min(n[k]-1, std::max(0, (int)floor(
+                  (x - origin[k])/size)));
+              }
+              cells[index(c[0], c[1], c[2])] = CELL_SURFACE;
+            }
+          }
+        }
+
+        // everything that can not be reached from the border is inside
+        std::vector<unsigned char> reached(cells.size(), 0);
+        std::vector<size_t> stack(1, 0);
+        reached[0] = 1;
+        while(!stack.empty()) {
+          size_t i = stack.back();
+          stack.pop_back();
+          int c[3] = {(int)(i % n[0]), (int)((i / n[0]) % n[1]),
+                      (int)(i / ((size_t)n[0]*n[1]))};
+          for(int f=0; f<6; ++f) {
+            int d[3] = {c[0], c[1], c[2]};
+            d[f/2] += (f % 2) ? 1 : -1;
+            if(d[f/2] < 0 || d[f/2] >= n[f/2]) continue;
+            size_t j = index(d[0], d[1], d[2]);
+            if(reached[j] || cells[j] != CELL_OUTSIDE) continue;
+            reached[j] = 1;
+            stack.push_back(j);
+          }
+        }
+        for(size_t i=0; i<cells.size(); ++i) {
+          if(cells[i] == CELL_OUTSIDE && !reached[i]) cells[i] = CELL_INSIDE;
+        }
+      }
+
+      /**
+       * \brief the solid of the mesh inside of an axis aligned box; the
+       *        parts are the leaves of a k-d tree
+       */
+      struct Part {
+        double bmin[3], bmax[3];
+        /** the surface clipped to the box; nine coordinates per triangle */
+        std::vector<double> triangles;
+        /** the volume of the outside cells within the hull */
+        double concavity;
+        /** the volume of the hull */
+        double volume;
+      };
+
+      /**
+       * \brief computes the hull of the part and measures its concavity:
+       *        the volume of the outside cells within the hull
+       *
+       * The hull is spanned by the clipped surface and the corners of the
+       * inside cells at the faces of the box, clamped to the box.
+       * \return \c false if the part is flat.
+       */
+      bool evaluatePart(const VoxelGrid &grid, size_t maxVertices,
+                        Part *part, ConvexHull *hull) {
+        part->concavity = part->volume = 0;
+        std::vector<double> points(part->triangles);
+        int first[3], last[3];
+        for(int k=0; k<3; ++k) {
+          grid.getRange(k, part->bmin[k], part->bmax[k], &first[k], &last[k]);
+        }
+        double p[3];
+        for(int z=first[2]; z<=last[2]; ++z) {
+          for(int y=first[1]; y<=last[1]; ++y) {
+            for(int x=first[0]; x<=last[0]; ++x) {
+              int c[3] = {x, y, z};
+              bool border = false;
+              for(int k=0; k<3; ++k) {
+                border = border || c[k] == first[k] || c[k] == last[k];
+              }
+              if(!border || grid.cells[grid.index(x, y, z)] != CELL_INSIDE) {
+                continue;
+              }
+              for(int corner=0; corner<8; ++corner) {
+                for(int k=0; k<3; ++k) {
+                  p[k] = grid.origin[k] +
+                    (c[k] + ((corner >> k) & 1))*grid.size;
+                  p[k] = std::min(part->bmax[k], std::max(part->bmin[k],
+                                                          p[k]));
+                }
+                points.insert(points.end(), p, p+3);
+              }
+            }
+          }
+        }
+        if(!computeConvexHull(points, maxVertices, hull)) return false;
+        part->volume = getVolume(*hull);
+        if(part->volume <= 0) return false;
+
+        size_t numFaces = hull->triangles.size()/3;
+        double cellVolume = grid.size*grid.size*grid.size;
+        std::vector<double> planes(numFaces*4);
+        for(size_t f=0; f<numFaces; ++f) {
+          double *plane = &planes[f*4];
+          const double *a = &hull->points[hull->triangles[f*3]*3];
+          cross(a, &hull->points[hull->triangles[f*3+1]*3],
+                &hull->points[hull->triangles[f*3+2]*3], plane);
+          double length = sqrt(dot(plane, plane));
+          if(length > 0) {
+            for(int k=0; k<3; ++k) plane[k] /= length;
+          }
+          plane[3] = -dot(plane, a);
+        }
+        for(int z=first[2]; z<=last[2]; ++z) {
+          for(int y=first[1]; y<=last[1]; ++y) {
+            for(int x=first[0]; x<=last[0]; ++x) {
+              if(grid.cells[grid.index(x, y, z)] != CELL_OUTSIDE) continue;
+              p[0] = grid.origin[0] + (x + 0.5)*grid.size;
+              p[1] = grid.origin[1] + (y + 0.5)*grid.size;
+              p[2] = grid.origin[2] + (z + 0.5)*grid.size;
+              size_t f = 0;
+              while(f < numFaces && dot(&planes[f*4], p) + planes[f*4+3] < 0) {
+                ++f;
+              }
+              if(f == numFaces) part->concavity += cellVolume;
+            }
+          }
+        }
+        return true;
+      }
+
+      struct Cut {
+        Cut() : valid(false), faceArea(0) {}
+
+        bool valid;
+        Part below, above;
+        /** the area of the triangles of the mesh in the cut plane */
+        double faceArea;
+      };
+
+      /**
+       * \brief whether cut \a a is better than cut \a b
+       *
+       * The cut that leaves less concavity wins. Of equal cuts the one
+       * that splits off the flatter part wins, e.g. the bottom of a tray
+       * instead of a slice through its middle, then the one that follows
+       * a face of the mesh and then the one that splits off more volume.
+       */
+      bool isBetterCut(const Cut &a, const Cut &b, double epsilon) {
+        if(!b.valid) return true;
+        double costA = a.below.concavity + a.above.concavity;
+        double costB = b.below.concavity + b.above.concavity;
+        if(costA < costB - epsilon) return true;
+        if(costA > costB + epsilon) return false;
+        const Part &flatA = (a.below.concavity < a.above.concavity) ?
+          a.below : a.above;
+        const Part &flatB = (b.below.concavity < b.above.concavity) ?
+          b.below : b.above;
+        if(flatA.concavity < flatB.concavity - epsilon) return true;
+        if(flatA.concavity > flatB.concavity + epsilon) return false;
+        if(a.faceArea != b.faceArea) return a.faceArea > b.faceArea;
+        return flatA.volume > flatB.volume;
+      }
+
+      /** \brief the area of the triangles in the plane \a value on \a axis */
+      double getFaceArea(const std::vector<double> &triangles, int axis,
+                         double value, double epsilon) {
+        double area = 0;
+        for(size_t t=0; t+8<triangles.size(); t+=9) {
+          const double *p = &triangles[t];
+          if(fabs(p[axis] - value) > epsilon ||
+             fabs(p[3+axis] - value) > epsilon ||
+             fabs(p[6+axis] - value) > epsilon) {
+            continue;
+          }
+          double n[3];
+          cross(p, p+3, p+6, n);
+          area += 0.5*sqrt(dot(n, n));
+        }
+        return area;
+      }
+
+      /**
+       * \brief splits the part at \a value on \a axis and keeps the cut in
+       *        \a best if it is better.
+       * \return \c true if the cut was kept.
+       */
+      bool tryCut(const VoxelGrid &grid, const Part &part, int axis,
+                  double value, Cut *best) {
+        Cut cut;
+        Part &b = cut.below, &a = cut.above;
+        for(int k=0; k<3; ++k) {
+          b.bmin[k] = a.bmin[k] = part.bmin[k];
+          b.bmax[k] = a.bmax[k] = part.bmax[k];
+        }
+        b.bmax[axis] = a.bmin[axis] = value;
+        splitTriangles(part.triangles, axis, value, &b.triangles,
+                       &a.triangles);
+        ConvexHull hull;
+        if(!evaluatePart(grid, 0, &b, &hull) ||
+           !evaluatePart(grid, 0, &a, &hull)) {
+          return false;
+        }
+        cut.valid = true;
+        cut.faceArea = getFaceArea(part.triangles, axis, value,
+                                   1e-3*grid.size);
+        // the concavity is counted in cells
+        if(!isBetterCut(cut, *best, 0.5*grid.size*grid.size*grid.size)) {
+          return false;
+        }
+        *best = cut;
+        return true;
+      }
+
+      /**
+       * \brief cuts the part by the candidate plane that gives the smallest
+       *        summed concavity of both sides
+       *
+       * The best of the evenly spaced planes is refined on the vertex
+       * coordinates next to it, so that the cut can follow an edge of the
+       * mesh.
+       * \return \c false if no plane splits the part into two solids
+       */
+      bool splitPart(const VoxelGrid &grid, const Part &part, Part *below,
+                     Part *above) {
+        // cut inside of the surface, or inside of the box if it is empty
+        double bmin[3], bmax[3];
+        for(int k=0; k<3; ++k) {
+          bmin[k] = part.bmax[k];
+          bmax[k] = part.bmin[k];
+        }
+        for(size_t i=0; i<part.triangles.size(); ++i) {
+          bmin[i%3] = std::min(bmin[i%3], part.triangles[i]);
+          bmax[i%3] = std::max(bmax[i%3], part.triangles[i]);
+        }
+        if(part.triangles.empty()) {
+          for(int k=0; k<3; ++k) {
+            bmin[k] = part.bmin[k];
+            bmax[k] = part.bmax[k];
+          }
+        }
+        Cut best;
+        int bestAxis = -1;
+        double bestValue = 0.0, step = 0.0;
+        for(int axis=0; axis<3; ++axis) {
+          double extent = bmax[axis] - bmin[axis];
+          if(extent <= grid.size) continue;
+          for(int i=1; i<=numCuts; ++i) {
+            double value = bmin[axis] + extent*i/(numCuts+1);
+            if(tryCut(grid, part, axis, value, &best)) {
+              bestAxis = axis;
+              bestValue = value;
+              step = extent/(numCuts+1);
+            }
+          }
+        }
+        if(!best.valid) return false;
+
+        std::vector<double> values;
+        for(size_t i=bestAxis; i<part.triangles.size(); i+=3) {
+          if(fabs(part.triangles[i] - bestValue) < step) {
+            values.push_back(part.triangles[i]);
+          }
+        }
+        std::sort(values.begin(), values.end());
+        std::vector<double> distinct;
+        for(size_t i=0; i<values.size(); ++i) {
+          if(distinct.empty() || values[i] - distinct.back() > 1e-3*grid.size) {
+            distinct.push_back(values[i]);
+          }
+        }
+        // at most 2*numCuts refinement planes
+        size_t stride = distinct.size()/(2*numCuts) + 1;
+        for(size_t i=0; i<distinct.size(); i+=stride) {
+          tryCut(grid, part, bestAxis, distinct[i], &best);
+        }
+        *below = best.below;
+        *above = best.above;
+        return true;
+      }
+
+      /**
+       * \brief returns the principal axes of the hull points as columns
+       *        of a rotation matrix and their mean
+       */
+      void getPrincipalAxes(const ConvexHull &hull, Eigen::Matrix3d *axes,
+                            Eigen::Vector3d *mean) {
+        size_t numPoints = hull.points.size()/3;
+        mean->setZero();
+        axes->setIdentity();
+        if(!numPoints) return;
+        for(size_t i=0; i<numPoints; ++i) {
+          *mean += Eigen::Vector3d(hull.points[i*3], hull.points[i*3+1],
+                                   hull.points[i*3+2]);
+        }
+        *mean /= (double)numPoints;
+        Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+        for(size_t i=0; i<numPoints; ++i) {
+          Eigen::Vector3d d = Eigen::Vector3d(hull.points[i*3],
+                                              hull.points[i*3+1],
+                                              hull.points[i*3+2]) - *mean;
+          covariance += d*d.transpose();
+        }
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+        if(solver.info() != Eigen::Success) return;
+        *axes = solver.eigenvectors();
+        if(axes->determinant() < 0) axes->col(0) *= -1;
+      }
+
+      void getBounds(const ConvexHull &hull, const Eigen::Matrix3d &axes,
+                     Eigen::Vector3d *bmin, Eigen::Vector3d *bmax) {
+        size_t numPoints = hull.points.size()/3;
+        bmin->setZero();
+        bmax->setZero();
+        for(size_t i=0; i<numPoints; ++i) {
+          Eigen::Vector3d p = axes.transpose()*Eigen::Vector3d(
+            hull.points[i*3], hull.points[i*3+1], hull.points[i*3+2]);
+          if(i == 0) *bmin = *bmax = p;
+          *bmin = bmin->cwiseMin(p);
+          *bmax = bmax->cwiseMax(p);
+        }
+      }
+
+      void hashBytes(uint64_t *hash, const void *data, size_t size) {
+        const unsigned char *bytes = (const unsigned char*)data;
+        for(size_t i=0; i<size; ++i) {
+          *hash ^= bytes[i];
+          *hash *= 1099511628211ULL;
+        }
+      }
+
+    } // end of anonymous namespace
+
+    bool computeConvexHull(const std::vector<double> &points,
+                           size_t maxVertices, ConvexHull *hull) {
+      HullBuilder builder(points);
+      if(!builder.build(maxVertices ? std::max(maxVertices, (size_t)4) : 0)) {
+        return false;
+      }
+      builder.write(hull);
+      return true;
+    }
+
+    bool decomposeConvex(const std::vector<double> &positions,
+                         const std::vector<uint32_t> &indices,
+                         const ConvexDecompositionParams &params,
+                         std::vector<ConvexHull> *hulls) {
+      hulls->clear();
+      size_t numVertices = positions.size()/3;
+      std::vector<Part> parts(1);
+      for(size_t i=0; i+2<indices.size(); i+=3) {
+        for(int k=0; k<3; ++k) {
+          if(indices[i+k] >= numVertices) return false;
+          const double *p = &positions[indices[i+k]*3];
+          parts[0].triangles.insert(parts[0].triangles.end(), p, p+3);
+        }
+      }
+      if(parts[0].triangles.empty()) return false;
+
+      double bmin[3], bmax[3];
+      for(int k=0; k<3; ++k) bmin[k] = bmax[k] = parts[0].triangles[k];
+      for(size_t i=0; i<parts[0].triangles.size(); ++i) {
+        bmin[i%3] = std::min(bmin[i%3], parts[0].triangles[i]);
+        bmax[i%3] = std::max(bmax[i%3], parts[0].triangles[i]);
+      }
+      if(distance2(bmin, bmax) <= 0) return false;
+      VoxelGrid grid;
+      grid.build(parts[0].triangles, bmin, bmax, params.resolution);
+      for(int k=0; k<3; ++k) {
+        parts[0].bmin[k] = grid.origin[k];
+        parts[0].bmax[k] = grid.origin[k] + grid.n[k]*grid.size;
+      }
+      ConvexHull hull;
+      if(!evaluatePart(grid, 0, &parts[0], &hull)) return false;
+      double threshold = params.concavity*parts[0].volume;
+
+      // always split the most concave part
+      while(parts.size() < params.maxHulls) {
+        size_t worst = 0;
+        for(size_t i=1; i<parts.size(); ++i) {
+          if(parts[i].concavity > parts[worst].concavity) worst = i;
+        }
+        if(parts[worst].concavity <= threshold) break;
+        Part below, above;
+        if(!splitPart(grid, parts[worst], &below, &above)) {
+          parts[worst].concavity = 0;
+          continue;
+        }
+        parts[worst] = below;
+        parts.push_back(above);
+      }
+
+      for(size_t i=0; i<parts.size(); ++i) {
+        if(evaluatePart(grid, params.maxHullVertices, &parts[i], &hull)) {
+          hulls->push_back(hull);
+        }
+      }
+      return !hulls->empty();
+    }
+
+    void fitBox(const ConvexHull &hull, Vector *center, Quaternion *rotation,
+                Vector *size) {
+      Eigen::Matrix3d axes;
+      Eigen::Vector3d mean, bmin, bmax;
+      getPrincipalAxes(hull, &axes, &mean);
+      getBounds(hull, axes, &bmin, &bmax);
+      *center = axes*((bmin + bmax)*0.5);
+      *rotation = Quaternion(axes);
+      *size = bmax - bmin;
+    }
+
+    void fitCapsule(const ConvexHull &hull, Vector *center,
+                    Quaternion *rotation, double *radius, double *length) {
+      Eigen::Matrix3d axes, frame;
+      Eigen::Vector3d mean, bmin, bmax;
+      getPrincipalAxes(hull, &axes, &mean);
+      getBounds(hull, axes, &bmin, &bmax);
+      Eigen::Vector3d extent = bmax - bmin;
+      int longest = 0;
+      extent.maxCoeff(&longest);
+      // a cyclic permutation keeps the frame right handed
+      for(int k=0; k<3; ++k) frame.col(k) = axes.col((longest+k+1)%3);
+      Eigen::Vector3d mid = axes*((bmin + bmax)*0.5);
+
+      size_t numPoints = hull.points.size()/3;
+      double r2 = 0;
+      std::vector<double> radial(numPoints), axial(numPoints);
+      for(size_t i=0; i<numPoints; ++i) {
+        Eigen::Vector3d p = frame.transpose()*(Eigen::Vector3d(
+          hull.points[i*3], hull.points[i*3+1], hull.points[i*3+2]) - mid);
+        radial[i] = p.x()*p.x() + p.y()*p.y();
+        axial[i] = fabs(p.z());
+        r2 = std::max(r2, radial[i]);
+      }
+      // the caps have to reach the points at the ends
+      double halfLength = 0;
+      for(size_t i=0; i<numPoints; ++i) {
+        halfLength = std::max(halfLength, axial[i] - sqrt(r2 - radial[i]));
+      }
+      *center = mid;
+      *rotation = Quaternion(frame);
+      *radius = sqrt(r2);
+      *length = halfLength*2.0;
+    }
+
+    uint64_t hashConvexDecomposition(const std::vector<double> &positions,
+                                     const std::vector<uint32_t> &indices,
+                                     const ConvexDecompositionParams &params) {
+      // FNV-1a
+      uint64_t hash = 14695981039346656037ULL;
+      uint32_t counts[5] = {CONVEX_HULLS_VERSION, params.maxHulls,
+                            params.maxHullVertices, params.resolution,
+                            (uint32_t)indices.size()};
+      hashBytes(&hash, counts, sizeof(counts));
+      hashBytes(&hash, &params.concavity, sizeof(double));
+      if(!positions.empty()) {
+        hashBytes(&hash, &positions[0], positions.size()*sizeof(double));
+      }
+      if(!indices.empty()) {
+        hashBytes(&hash, &indices[0], indices.size()*sizeof(uint32_t));
+      }
+      return hash;
+    }
+
+    bool writeConvexHulls(const std::string &filename, uint64_t hash,
+                          const std::vector<ConvexHull> &hulls) {
+      FILE *file = fopen(filename.c_str(), "wb");
+      if(!file) {
+        fprintf(stderr, "ConvexDecomposition: could not open \"%s\" for "
+                "writing\n", filename.c_str());
+        return false;
+      }
+      uint32_t header[2] = {CONVEX_HULLS_VERSION, (uint32_t)hulls.size()};
+      bool ok = (fwrite(CONVEX_HULLS_MAGIC, 1, 8, file) == 8 &&
+                 fwrite(header, sizeof(uint32_t), 2, file) == 2 &&
+                 fwrite(&hash, sizeof(uint64_t), 1, file) == 1);
+      for(size_t i=0; ok && i<hulls.size(); ++i) {
+        const ConvexHull &hull = hulls[i];
+        uint32_t counts[2] = {(uint32_t)hull.points.size(),
+                              (uint32_t)hull.triangles.size()};
+        ok = (fwrite(counts, sizeof(uint32_t), 2, file) == 2 &&
+              fwrite(&hull.points[0], sizeof(double), counts[0],
+                     file) == counts[0] &&
+              fwrite(&hull.triangles[0], sizeof(uint32_t), counts[1],
+                     file) == counts[1]);
+      }
+      if(fclose(file) != 0) ok = false;
+      if(!ok) {
+        fprintf(stderr, "ConvexDecomposition: error while writing \"%s\"\n",
+                filename.c_str());
+        remove(filename.c_str());
+      }
+      return ok;
+    }
+
+    bool readConvexHulls(const std::string &filename, uint64_t hash,
+                         std::vector<ConvexHull> *hulls) {
+      FILE *file = fopen(filename.c_str(), "rb");
+      if(!file) return false;
+      char magic[8];
+      uint32_t header[2];
+      uint64_t fileHash;
+      bool ok = (fread(magic, 1, 8, file) == 8 &&
+                 memcmp(magic, CONVEX_HULLS_MAGIC, 8) == 0 &&
+                 fread(header, sizeof(uint32_t), 2, file) == 2 &&
+                 header[0] == CONVEX_HULLS_VERSION &&
+                 fread(&fileHash, sizeof(uint64_t), 1, file) == 1 &&
+                 fileHash == hash);
+      std::vector<ConvexHull> result;
+      if(ok) result.resize(header[1]);
+      for(size_t i=0; ok && i<result.size(); ++i) {
+        ConvexHull &hull = result[i];
+        uint32_t counts[2];
+        ok = (fread(counts, sizeof(uint32_t), 2, file) == 2 &&
+              counts[0] > 0 && counts[0] % 3 == 0 &&
+              counts[0] <= maxCachedPoints*3 &&
+              counts[1] > 0 && counts[1] % 3 == 0 &&
+              counts[1] <= maxCachedPoints*6);
+        if(!ok) break;
+        hull.points.resize(counts[0]);
+        hull.triangles.resize(counts[1]);
+        ok = (fread(&hull.points[0], sizeof(double), counts[0],
+                    file) == counts[0] &&
+              fread(&hull.triangles[0], sizeof(uint32_t), counts[1],
+                    file) == counts[1]);
+        for(size_t k=0; ok && k<hull.triangles.size(); ++k) {
+          if(hull.triangles[k] >= counts[0]/3) ok = false;
+        }
+      }
+      fclose(file);
+      if(ok) hulls->swap(result);
+      return ok;
+    }
+
+  } // end of namespace utils
+} // end of namespace mars
@@ -0,0 +1,129 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file ConvexDecomposition.h
+ * \brief Approximates triangle meshes by sets of convex hulls.
+ *
+ * The decomposition follows the greedy scheme of V-HACD: the mesh is
+ * voxelized to tell the inside from the outside, then the part with the
+ * deepest concavity is cut by the axis aligned plane that minimizes the
+ * summed concavity of both sides, until the requested number of parts is
+ * reached or no part is concave anymore. The concavity of a part is the
+ * volume of the outside voxels within its convex hull. The hulls
+ * are spanned by the clipped mesh, so they follow the surface more closely
+ * than the voxels.
+ *
+ * The results are meant to be computed once per mesh and kept in a cache
+ * file named by hashConvexDecomposition().
+ */
+
+#ifndef MARS_UTILS_CONVEX_DECOMPOSITION_H
+#define MARS_UTILS_CONVEX_DECOMPOSITION_H
+
+#include "Vector.h"
+#include "Quaternion.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace utils {
+
+    /** \brief A closed convex polyhedron. */
+    struct ConvexHull {
+      std::vector<double> points;      ///< x, y, z per vertex
+      /** three per face, counter-clockwise seen from the outside */
+      std::vector<uint32_t> triangles;
+    };
+
+    struct ConvexDecompositionParams {
+      ConvexDecompositionParams() : maxHulls(16), maxHullVertices(32),
+                                    concavity(0.02), resolution(32) {}
+
+      /** the mesh is not split into more parts than this */
+      unsigned int maxHulls;
+      /** larger hulls are reduced to their most extreme vertices */
+      unsigned int maxHullVertices;
+      /** parts are only split if their concavity is larger than this
+       *  fraction of the volume of the hull of the mesh */
+      double concavity;
+      /** voxels along the longest side of the mesh */
+      unsigned int resolution;
+    };
+
+    /**
+     * \brief Computes the convex hull of a point cloud (quickhull).
+     * \param maxVertices If not 0, only the most extreme points are added
+     *        until the hull has this many vertices; the hull is then
+     *        slightly smaller than the point cloud.
+     * \return \c false if all points lie on a plane.
+     */
+    bool computeConvexHull(const std::vector<double> &points,
+                           size_t maxVertices, ConvexHull *hull);
+
+    /**
+     * \brief Splits a triangle mesh into convex hulls.
+     * \param positions x, y, z per vertex
+     * \param indices three per triangle
+     * \return \c false if the mesh is empty or flat.
+     */
+    bool decomposeConvex(const std::vector<double> &positions,
+                         const std::vector<uint32_t> &indices,
+                         const ConvexDecompositionParams &params,
+                         std::vector<ConvexHull> *hulls);
+
+    /**
+     * \brief Fits an oriented box along the principal axes of a hull.
+     * \param size The full edge lengths in the rotated frame.
+     */
+    void fitBox(const ConvexHull &hull, Vector *center, Quaternion *rotation,
+                Vector *size);
+
+    /**
+     * \brief Fits a capsule along the longest principal axis of a hull.
+     *
+     * The capsule contains all points of the hull. Like the capsules of
+     * ODE it is aligned with the z axis of \a rotation and \a length does
+     * not include the caps.
+     */
+    void fitCapsule(const ConvexHull &hull, Vector *center,
+                    Quaternion *rotation, double *radius, double *length);
+
+    /** \brief Hashes the input of decomposeConvex() to name cache files. */
+    uint64_t hashConvexDecomposition(const std::vector<double> &positions,
+                                     const std::vector<uint32_t> &indices,
+                                     const ConvexDecompositionParams &params);
+
+    bool writeConvexHulls(const std::string &filename, uint64_t hash,
+                          const std::vector<ConvexHull> &hulls);
+
+    /**
+     * \return \c false if the file is missing or broken or was written for
+     *         another hash.
+     */
+    bool readConvexHulls(const std::string &filename, uint64_t hash,
+                         std::vector<ConvexHull> *hulls);
+
+  } // end of namespace utils
+} // end of namespace mars
+
+#endif // MARS_UTILS_CONVEX_DECOMPOSITION_H
@@ -0,0 +1,432 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <queue>
+
+namespace mars {
+  namespace utils {
+
+    namespace {
+
+      /** weight of the planes that keep the boundary edges in place */
+      const double boundaryWeight = 10.0;
+      /** the minimal cosine between the normals of a triangle before and
+       *  after a collapse */
+      const double minNormalCos = 0.2;
+
+      /** the upper triangle of the symmetric 4x4 matrix of summed planes */
+      struct Quadric {
+        double a[10];
+
+        Quadric() {
+          for(int i=0; i<10; ++i) a[i] = 0.0;
+        }
+
+        void addPlane(const double *n, double d, double w) {
+          a[0] += w*n[0]*n[0]; a[1] += w*n[0]*n[1]; a[2] += w*n[0]*n[2];
+          a[3] += w*n[0]*d;    a[4] += w*n[1]*n[1]; a[5] += w*n[1]*n[2];
+          a[6] += w*n[1]*d;    a[7] += w*n[2]*n[2]; a[8] += w*n[2]*d;
+          a[9] += w*d*d;
+        }
+
+        void add(const Quadric &q) {
+          for(int i=0; i<10; ++i) a[i] += q.a[i];
+        }
+
+        double error(const double *p) const {
+          const double x = p[0], y = p[1], z = p[2];
+          return (a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x +
+                  a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y +
+                  a[7]*z*z + 2*a[8]*z + a[9]);
+        }
+      };
+
+      struct WeldKey {
+        long long x, y, z;
+        bool operator<(const WeldKey &o) const {
+          if(x != o.x) return x < o.x;
+          if(y != o.y) return y < o.y;
+          return z < o.z;
+        }
+      };
+
+      /** moves the point \c from onto the point \c to */
+      struct Collapse {
+        double cost;
+        uint32_t from, to;
+        uint32_t fromVersion, toVersion;
+        // std::priority_queue returns the largest element first
+        bool operator<(const Collapse &o) const {
+          return cost > o.cost;
+        }
+      };
+
+      void cross(const double *a, const double *b, const double *c,
+                 double *n) {
+        double u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+        double v[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+        n[0] = u[1]*v[2] - u[2]*v[1];
+        n[1] = u[2]*v[0] - u[0]*v[2];
+        n[2] = u[0]*v[1] - u[1]*v[0];
+      }
+
+      double dot(const double *a, const double *b) {
+        return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+      }
+
+      class Simplifier {
+      public:
+        explicit Simplifier(const BinaryMeshSource &input);
+
+        void run(size_t targetTriangles);
+        void write(BinaryMeshSource *output) const;
+
+      private:
+        const double* position(uint32_t p) const {return &points[p*3];}
+        bool hasPoint(uint32_t t, uint32_t p) const {
+          return (corners[t*3] == p || corners[t*3+1] == p ||
+                  corners[t*3+2] == p);
+        }
+        void getNeighbors(uint32_t p, std::vector<uint32_t> *neighbors) const;
+        void pushCollapse(uint32_t from, uint32_t to);
+        bool canCollapse(uint32_t from, uint32_t to) const;
+        void collapse(uint32_t from, uint32_t to);
+
+        const BinaryMeshSource &input;
+        /** the welded positions */
+        std::vector<double> points;
+        std::vector<Quadric> quadrics;
+        std::vector<uint32_t> versions;
+        std::vector<char> removedPoints;
+        std::vector<std::vector<uint32_t> > pointTriangles;
+        /** the welded point of each triangle corner */
+        std::vector<uint32_t> corners;
+        /** the input vertex that gives the normal and texture coordinate */
+        std::vector<uint32_t> attributes;
+        std::vector<char> removedTriangles;
+        size_t numTriangles;
+        std::priority_queue<Collapse> queue;
+      };
+
+      Simplifier::Simplifier(const BinaryMeshSource &input)
+        : input(input), numTriangles(0) {
+        size_t numVertices = input.positions.size()/3;
+
+        // weld on a grid relative to the mesh size like BinaryMesh does
+        double bmin[3] = {0, 0, 0}, bmax[3] = {0, 0, 0};
+        for(size_t i=0; i<numVertices; ++i) {
+          for(int k=0; k<3; ++k) {
+            double v = input.positions[i*3+k];
+            if(i == 0 || v < bmin[k]) bmin[k] = v;
+            if(i == 0 || v > bmax[k]) bmax[k] = v;
+          }
+        }
+        double diag = 0;
+        for(int k=0; k<3; ++k) diag += (bmax[k]-bmin[k])*(bmax[k]-bmin[k]);
+        double cell = sqrt(diag)*1e-6;
+        if(cell <= 0) cell = 1e-9;
+        std::map<WeldKey, uint32_t> welded;
+        std::vector<uint32_t> pointOf(numVertices);
+        for(size_t i=0; i<numVertices; ++i) {
+          WeldKey key;
+          key.x = (long long)floor(input.positions[i*3]/cell + 0.5);
+          key.y = (long long)floor(input.positions[i*3+1]/cell + 0.5);
+          key.z = (long long)floor(input.positions[i*3+2]/cell + 0.5);
+          std::map<WeldKey, uint32_t>::iterator it = welded.find(key);
+          if(it == welded.end()) {
+            pointOf[i] = welded[key] = (uint32_t)(points.size()/3);
+            for(int k=0; k<3; ++k) points.push_back(input.positions[i*3+k]);
+          } else {
+            pointOf[i] = it->second;
+          }
+        }
+        size_t numPoints = points.size()/3;
+        quadrics.resize(numPoints);
+        versions.resize(numPoints, 0);
+        removedPoints.resize(numPoints, 0);
+        pointTriangles.resize(numPoints);
+
+        size_t numInput = input.indices.size()/3;
+        corners.resize(numInput*3);
+        attributes = input.indices;
+        removedTriangles.resize(numInput, 0);
+        std::map<std::pair<uint32_t, uint32_t>, int> edges;
+        for(uint32_t t=0; t<numInput; ++t) {
+          uint32_t *c = &corners[t*3];
+          for(int k=0; k<3; ++k) c[k] = pointOf[input.indices[t*3+k]];
+          if(c[0] == c[1] || c[1] == c[2] || c[2] == c[0]) {
+            removedTriangles[t] = 1;
+            continue;
+          }
+          ++numTriangles;
+          for(int k=0; k<3; ++k) {
+            pointTriangles[c[k]].push_back(t);
+            uint32_t a = c[k], b = c[(k+1)%3];
+            ++edges[std::make_pair(std::min(a, b), std::max(a, b))];
+          }
+          double n[3];
+          cross(position(c[0]), position(c[1]), position(c[2]), n);
+          double length = sqrt(dot(n, n));
+          if(length <= 0) continue;
+          for(int k=0; k<3; ++k) n[k] /= length;
+          // weighted by the area of the triangle
+          double d = -dot(n, position(c[0]));
+          for(int k=0; k<3; ++k) quadrics[c[k]].addPlane(n, d, length*0.5);
+        }
+
+        // keep the boundary in place
+        for(uint32_t t=0; t<numInput; ++t) {
+          if(removedTriangles[t]) continue;
+          const uint32_t *c = &corners[t*3];
+          double n[3];
+          cross(position(c[0]), position(c[1]), position(c[2]), n);
+          double length = sqrt(dot(n, n));
+          if(length <= 0) continue;
+          for(int k=0; k<3; ++k) n[k] /= length;
+          for(int k=0; k<3; ++k) {
+            uint32_t a = c[k], b = c[(k+1)%3];
+            if(edges[std::make_pair(std::min(a, b), std::max(a, b))] != 1) {
+              continue;
+            }
+            const double *pa = position(a), *pb = position(b);
+            double e[3] = {pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2]};
+            double m[3] = {e[1]*n[2] - e[2]*n[1],
+                           e[2]*n[0] - e[0]*n[2],
+                           e[0]*n[1] - e[1]*n[0]};
+            double mLength = sqrt(dot(m, m));
+            if(mLength <= 0) continue;
+            for(int j=0; j<3; ++j) m[j] /= mLength;
+            double d = -dot(m, pa);
+            double w = boundaryWeight*dot(e, e);
+            quadrics[a].addPlane(m, d, w);
+            quadrics[b].addPlane(m, d, w);
+          }
+        }
+
+        std::map<std::pair<uint32_t, uint32_t>, int>::iterator it;
+        for(it=edges.begin(); it!=edges.end(); ++it) {
+          pushCollapse(it->first.first, it->first.second);
+          pushCollapse(it->first.second, it->first.first);
+        }
+      }
+
+      void Simplifier::pushCollapse(uint32_t from, uint32_t to) {
+        Collapse c;
+        c.cost = (quadrics[from].error(position(to)) +
+                  quadrics[to].error(position(to)));
+        c.from = from;
+        c.to = to;
+        c.fromVersion = versions[from];
+        c.toVersion = versions[to];
+        queue.push(c);
+      }
+
+      void Simplifier::getNeighbors(uint32_t p,
+                                    std::vector<uint32_t> *neighbors) const {
+        neighbors->clear();
+        const std::vector<uint32_t> &triangles = pointTriangles[p];
+        for(size_t i=0; i<triangles.size(); ++i) {
+          uint32_t t = triangles[i];
+          if(removedTriangles[t]) continue;
+          for(int k=0; k<3; ++k) {
+            if(corners[t*3+k] != p) neighbors->push_back(corners[t*3+k]);
+          }
+        }
+        std::sort(neighbors->begin(), neighbors->end());
+        neighbors->erase(std::unique(neighbors->begin(), neighbors->end()),
+                         neighbors->end());
+      }
+
+      bool Simplifier::canCollapse(uint32_t from, uint32_t to) const {
+        const std::vector<uint32_t> &triangles = pointTriangles[from];
+        size_t shared = 0;
+        for(size_t i=0; i<triangles.size(); ++i) {
+          uint32_t t = triangles[i];
+          if(removedTriangles[t]) continue;
+          if(hasPoint(t, to)) {
+            ++shared;
+            continue;
+          }
+          // the remaining triangles must not flip or degenerate
+          const uint32_t *c = &corners[t*3];
+          const double *p[3], *q[3];
+          for(int k=0; k<3; ++k) {
+            p[k] = position(c[k]);
+            q[k] = (c[k] == from) ? position(to) : p[k];
+          }
+          double n0[3], n1[3];
+          cross(p[0], p[1], p[2], n0);
+          cross(q[0], q[1], q[2], n1);
+          double l0 = dot(n0, n0), l1 = dot(n1, n1);
+          if(l1 <= 0) return false;
+          if(l0 > 0 && dot(n0, n1) < minNormalCos*sqrt(l0*l1)) return false;
+        }
+        if(shared == 0) return false;
+
+        // link condition: the end points may only share the opposite
+        // points of the triangles on the edge
+        std::vector<uint32_t> a, b, common;
+        getNeighbors(from, &a);
+        getNeighbors(to, &b);
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                              std::back_inserter(common));
+        return common.size() == shared;
+      }
+
+      void Simplifier::collapse(uint32_t from, uint32_t to) {
+        quadrics[to].add(quadrics[from]);
+        removedPoints[from] = 1;
+        ++versions[to];
+        std::vector<uint32_t> &triangles = pointTriangles[from];
+        std::vector<uint32_t> &target = pointTriangles[to];
+        // the triangles on the edge tell which vertex of the target
+        // continues a vertex of the removed point; on a seam these differ
+        // for both sides of the edge
+        std::map<uint32_t, uint32_t> continued;
+        for(size_t i=0; i<triangles.size(); ++i) {
+          uint32_t t = triangles[i];
+          if(removedTriangles[t] || !hasPoint(t, to)) continue;
+          uint32_t a = 0, b = 0;
+          for(int k=0; k<3; ++k) {
+            if(corners[t*3+k] == from) a = attributes[t*3+k];
+            else if(corners[t*3+k] == to) b = attributes[t*3+k];
+          }
+          continued[a] = b;
+          removedTriangles[t] = 1;
+          --numTriangles;
+        }
+        for(size_t i=0; i<triangles.size(); ++i) {
+          uint32_t t = triangles[i];
+          if(removedTriangles[t]) continue;
+          for(int k=0; k<3; ++k) {
+            if(corners[t*3+k] != from) continue;
+            corners[t*3+k] = to;
+            std::map<uint32_t, uint32_t>::iterator it;
+            it = continued.find(attributes[t*3+k]);
+            if(it != continued.end()) attributes[t*3+k] = it->second;
+          }
+          target.push_back(t);
+        }
+        std::vector<uint32_t>().swap(triangles);
+        size_t n = 0;
+        for(size_t i=0; i<target.size(); ++i) {
+          if(!removedTriangles[target[i]]) target[n++] = target[i];
+        }
+        target.resize(n);
+
+        std::vector<uint32_t> neighbors;
+        getNeighbors(to, &neighbors);
+        for(size_t i=0; i<neighbors.size(); ++i) {
+          pushCollapse(to, neighbors[i]);
+          pushCollapse(neighbors[i], to);
+        }
+      }
+
+      void Simplifier::run(size_t targetTriangles) {
+        while(numTriangles > targetTriangles && !queue.empty()) {
+          Collapse c = queue.top();
+          queue.pop();
+          if(removedPoints[c.from] || removedPoints[c.to] ||
+             versions[c.from] != c.fromVersion ||
+             versions[c.to] != c.toVersion) {
+            continue;
+          }
+          if(canCollapse(c.from, c.to)) collapse(c.from, c.to);
+        }
+      }
+
+      void Simplifier::write(BinaryMeshSource *output) const {
+        bool texcoords = !input.texcoords.empty();
+        output->name = input.name;
+        output->positions.clear();
+        output->normals.clear();
+        output->texcoords.clear();
+        output->indices.clear();
+        // a vertex of the output is a welded position with the normal and
+        // texture coordinate of an input vertex
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> vertices;
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t>::iterator it;
+        for(size_t t=0; t<removedTriangles.size(); ++t) {
+          if(removedTriangles[t]) continue;
+          for(int k=0; k<3; ++k) {
+            uint32_t v = attributes[t*3+k];
+            std::pair<uint32_t, uint32_t> key(corners[t*3+k], v);
+            it = vertices.find(key);
+            if(it != vertices.end()) {
+              output->indices.push_back(it->second);
+              continue;
+            }
+            uint32_t index = (uint32_t)(output->positions.size()/3);
+            vertices[key] = index;
+            output->indices.push_back(index);
+            const double *p = position(key.first);
+            for(int j=0; j<3; ++j) {
+              output->positions.push_back((float)p[j]);
+              output->normals.push_back(input.normals[v*3+j]);
+            }
+            if(texcoords) {
+              output->texcoords.push_back(input.texcoords[v*2]);
+              output->texcoords.push_back(input.texcoords[v*2+1]);
+            }
+          }
+        }
+      }
+
+    } // end of anonymous namespace
+
+    bool simplifyMesh(const BinaryMeshSource &input, double ratio,
+                      BinaryMeshSource *output) {
+      size_t numVertices = input.positions.size()/3;
+      if(input.positions.size() % 3 ||
+         input.normals.size() != input.positions.size() ||
+         input.indices.size() % 3 ||
+         (!input.texcoords.empty() &&
+          input.texcoords.size() != numVertices*2)) {
+        fprintf(stderr, "simplifyMesh: inconsistent arrays in \"%s\"\n",
+                input.name.c_str());
+        return false;
+      }
+      for(size_t i=0; i<input.indices.size(); ++i) {
+        if(input.indices[i] >= numVertices) {
+          fprintf(stderr, "simplifyMesh: index out of range in \"%s\"\n",
+                  input.name.c_str());
+          return false;
+        }
+      }
+      if(ratio >= 1.0) {
+        *output = input;
+        return true;
+      }
+      Simplifier simplifier(input);
+      double target = std::max(ratio, 0.0)*(input.indices.size()/3);
+      simplifier.run((size_t)(target + 0.5));
+      simplifier.write(output);
+      return true;
+    }
+
+  } // end of namespace utils
+} // end of namespace mars
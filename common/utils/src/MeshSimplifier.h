@@ -0,0 +1,58 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file MeshSimplifier.h
+ * \brief Reduces triangle meshes for distant levels of detail.
+ *
+ * The simplifier collapses edges in the order of their quadric error
+ * (Garland and Heckbert). An edge is always collapsed into one of its
+ * end points, so the kept vertices do not move and their normals and
+ * texture coordinates stay valid. The topology is built on the welded
+ * positions: vertices that only differ in their normal or texture
+ * coordinate (seams) move together and no cracks open. Boundary edges
+ * are protected by additional planes orthogonal to their triangle, and
+ * collapses that would flip a triangle or make the mesh non-manifold
+ * are skipped.
+ */
+
+#ifndef MARS_UTILS_MESH_SIMPLIFIER_H
+#define MARS_UTILS_MESH_SIMPLIFIER_H
+
+#include "BinaryMesh.h"
+
+namespace mars {
+  namespace utils {
+
+    /**
+     * \brief Simplifies one part of a mesh.
+     * \param ratio The fraction of triangles to keep; a mesh that can not
+     *        be simplified that far keeps more triangles.
+     * \param output Receives the unused vertices removed; the name is
+     *        copied from \a input.
+     * \return \c false if the arrays of \a input are inconsistent.
+     */
+    bool simplifyMesh(const BinaryMeshSource &input, double ratio,
+                      BinaryMeshSource *output);
+
+  } // end of namespace utils
+} // end of namespace mars
+
+#endif // MARS_UTILS_MESH_SIMPLIFIER_H
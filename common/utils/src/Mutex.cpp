@@ -19,6 +19,7 @@
  */
 
 #include "Mutex.h"
+#include "Trace.h"
 
 #include <errno.h>
 
@@ -59,7 +60,18 @@ namespace mars {
     }
   
     MutexError Mutex::lock() {
-      int rc = pthread_mutex_lock(&myMutex->m);
+      int rc;
+      if(Trace::isEnabled()) {
+        // only contended locks show up in the trace
+        rc = pthread_mutex_trylock(&myMutex->m);
+        if(rc == EBUSY) {
+          double start = getClockMs();
+          rc = pthread_mutex_lock(&myMutex->m);
+          Trace::complete("lock", "mutex wait", start, getClockMs());
+        }
+      } else {
+        rc = pthread_mutex_lock(&myMutex->m);
+      }
       switch(rc) {
       case 0:
         return MUTEX_ERROR_NO_ERROR;
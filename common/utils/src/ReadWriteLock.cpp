@@ -19,6 +19,7 @@
  */
 
 #include "ReadWriteLock.h"
+#include "Trace.h"
 
 #include <pthread.h>
 
@@ -43,10 +44,24 @@ namespace mars {
 
     void ReadWriteLock::lockForRead() {
       // TODO error checking?
+      if(Trace::isEnabled()) {
+        if(tryLockForRead()) return;
+        double start = getClockMs();
+        pthread_rwlock_rdlock(&myReadWriteLock->rw);
+        Trace::complete("lock", "read lock wait", start, getClockMs());
+        return;
+      }
       pthread_rwlock_rdlock(&myReadWriteLock->rw);
     }
     void ReadWriteLock::lockForWrite() {
       // TODO error checking?
+      if(Trace::isEnabled()) {
+        if(tryLockForWrite()) return;
+        double start = getClockMs();
+        pthread_rwlock_wrlock(&myReadWriteLock->rw);
+        Trace::complete("lock", "write lock wait", start, getClockMs());
+        return;
+      }
       pthread_rwlock_wrlock(&myReadWriteLock->rw);
     }
     bool ReadWriteLock::tryLockForRead() {
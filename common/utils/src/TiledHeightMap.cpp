@@ -0,0 +1,198 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "TiledHeightMap.h"
+#include "MutexLocker.h"
+
+#include <cmath>
+
+namespace mars {
+  namespace utils {
+
+    TiledHeightMap::TiledHeightMap(int width, int height, double targetWidth,
+                                   double targetHeight, int tileSize)
+      : width(width), height(height), tileSize(tileSize),
+        version(1), refCount(1) {
+      if(this->tileSize < 1) this->tileSize = 1;
+      stepX = (width > 1) ? targetWidth / (width-1) : targetWidth;
+      stepY = (height > 1) ? targetHeight / (height-1) : targetHeight;
+      numTilesX = (width + this->tileSize - 1) / this->tileSize;
+      numTilesY = (height + this->tileSize - 1) / this->tileSize;
+      heights.resize(width*height, 0.0);
+      tileMin.resize(numTilesX*numTilesY, 0.0);
+      tileMax.resize(numTilesX*numTilesY, 0.0);
+      tileVersion.resize(numTilesX*numTilesY, 1);
+    }
+
+    TiledHeightMap::~TiledHeightMap() {
+    }
+
+    void TiledHeightMap::ref() {
+      MutexLocker locker(&refMutex);
+      ++refCount;
+    }
+
+    void TiledHeightMap::unref() {
+      refMutex.lock();
+      bool last = (--refCount == 0);
+      refMutex.unlock();
+      if(last) delete this;
+    }
+
+    void TiledHeightMap::setHeights(const double *pixelData, double scale) {
+      lock.lockForWrite();
+      for(size_t i=0; i<heights.size(); ++i) {
+        heights[i] = pixelData[i]*scale;
+      }
+      ++version;
+      for(size_t i=0; i<tileVersion.size(); ++i) {
+        tileVersion[i] = version;
+        updateTile(i);
+      }
+      lock.unlock();
+    }
+
+    void TiledHeightMap::setHeight(int x, int y, double h) {
+      if(x < 0 || y < 0 || x >= width || y >= height) return;
+      lock.lockForWrite();
+      heights[y*width+x] = h;
+      int tile = (y/tileSize)*numTilesX + x/tileSize;
+      tileVersion[tile] = ++version;
+      updateTile(tile);
+      lock.unlock();
+    }
+
+    double TiledHeightMap::interpolateHeight(double x, double y) const {
+      double fx = x / stepX, fy = y / stepY;
+      if(fx < 0.0) fx = 0.0;
+      if(fy < 0.0) fy = 0.0;
+      if(fx > width-1) fx = width-1;
+      if(fy > height-1) fy = height-1;
+      int x1 = (int)fx, y1 = (int)fy;
+      int x2 = (x1 < width-1) ? x1+1 : x1;
+      int y2 = (y1 < height-1) ? y1+1 : y1;
+      fx -= x1;
+      fy -= y1;
+      double h1 = getHeight(x1, y1)*(1.0-fx) + getHeight(x2, y1)*fx;
+      double h2 = getHeight(x1, y2)*(1.0-fx) + getHeight(x2, y2)*fx;
+      return h1*(1.0-fy) + h2*fy;
+    }
+
+    bool TiledHeightMap::deformSphere(double x, double y, double z,
+                                      double radius) {
+      int x1 = (int)ceil((x-radius) / stepX);
+      int y1 = (int)ceil((y-radius) / stepY);
+      int x2 = (int)floor((x+radius) / stepX);
+      int y2 = (int)floor((y+radius) / stepY);
+      if(x1 < 0) x1 = 0;
+      if(y1 < 0) y1 = 0;
+      if(x2 > width-1) x2 = width-1;
+      if(y2 > height-1) y2 = height-1;
+      if(x1 > x2 || y1 > y2) return false;
+
+      double r2 = radius*radius;
+      bool changed = false;
+      lock.lockForWrite();
+      // the sphere does not reach down to the terrain
+      if(z-radius >= getMaxHeight(x1, y1, x2, y2)) {
+        lock.unlock();
+        return false;
+      }
+      unsigned long newVersion = version+1;
+      for(int j=y1; j<=y2; ++j) {
+        double dy = j*stepY - y;
+        for(int i=x1; i<=x2; ++i) {
+          double dx = i*stepX - x;
+          double d2 = r2 - dx*dx - dy*dy;
+          if(d2 < 0.0) continue;
+          double h = z - sqrt(d2);
+          double &sample = heights[j*width+i];
+          if(h < sample) {
+            sample = h;
+            tileVersion[(j/tileSize)*numTilesX + i/tileSize] = newVersion;
+            changed = true;
+          }
+        }
+      }
+      if(changed) {
+        version = newVersion;
+        for(int ty=y1/tileSize; ty<=y2/tileSize; ++ty) {
+          for(int tx=x1/tileSize; tx<=x2/tileSize; ++tx) {
+            int tile = ty*numTilesX+tx;
+            if(tileVersion[tile] == newVersion) updateTile(tile);
+          }
+        }
+      }
+      lock.unlock();
+      return changed;
+    }
+
+    double TiledHeightMap::getMaxHeight(int x1, int y1, int x2, int y2) const {
+      double max = -HUGE_VAL;
+      for(int ty=y1/tileSize; ty<=y2/tileSize; ++ty) {
+        for(int tx=x1/tileSize; tx<=x2/tileSize; ++tx) {
+          if(tileMax[ty*numTilesX+tx] > max) max = tileMax[ty*numTilesX+tx];
+        }
+      }
+      return max;
+    }
+
+    void TiledHeightMap::getTileRange(int tile, int *x1, int *y1,
+                                      int *x2, int *y2) const {
+      *x1 = (tile % numTilesX)*tileSize;
+      *y1 = (tile / numTilesX)*tileSize;
+      *x2 = (*x1 + tileSize < width) ? *x1 + tileSize : width;
+      *y2 = (*y1 + tileSize < height) ? *y1 + tileSize : height;
+    }
+
+    void TiledHeightMap::getChangedTiles(unsigned long since,
+                                         std::vector<int> *tiles) const {
+      for(size_t i=0; i<tileVersion.size(); ++i) {
+        if(tileVersion[i] > since) tiles->push_back(i);
+      }
+    }
+
+    void TiledHeightMap::getHeightBounds(double *min, double *max) const {
+      *min = *max = 0.0;
+      for(size_t i=0; i<tileMin.size(); ++i) {
+        if(i == 0 || tileMin[i] < *min) *min = tileMin[i];
+        if(i == 0 || tileMax[i] > *max) *max = tileMax[i];
+      }
+    }
+
+    void TiledHeightMap::updateTile(int tile) {
+      int x1, y1, x2, y2;
+      getTileRange(tile, &x1, &y1, &x2, &y2);
+      double min = heights[y1*width+x1];
+      double max = min;
+      for(int y=y1; y<y2; ++y) {
+        for(int x=x1; x<x2; ++x) {
+          double h = heights[y*width+x];
+          if(h < min) min = h;
+          else if(h > max) max = h;
+        }
+      }
+      tileMin[tile] = min;
+      tileMax[tile] = max;
+    }
+
+  } // end of namespace utils
+} // end of namespace mars
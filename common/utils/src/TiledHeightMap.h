@@ -0,0 +1,121 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * \file TiledHeightMap.h
+ * \brief Height samples of a terrain shared by the physics and the
+ *        graphics.
+ *
+ * The samples are stored row-major, row \c y lies at
+ * y*targetHeight/(height-1) and column \c x at x*targetWidth/(width-1)
+ * measured from the corner of the terrain. The samples are grouped into
+ * square tiles. Every change increments the version of the map and stores
+ * it in the tiles it touched, so a reader that remembers the version it
+ * last synchronized only has to update the tiles returned by
+ * getChangedTiles().
+ *
+ * Writers hold the write lock, so the map can be deformed from any
+ * thread. Readers have to lock the map for reading; the physics holds the
+ * read lock during its collision pass, in which ODE samples the heights.
+ *
+ * The map is reference counted because the graphics representation of a
+ * terrain can outlive the simulation node.
+ */
+
+#ifndef MARS_UTILS_TILED_HEIGHT_MAP_H
+#define MARS_UTILS_TILED_HEIGHT_MAP_H
+
+#include "Mutex.h"
+#include "ReadWriteLock.h"
+
+#include <vector>
+
+namespace mars {
+  namespace utils {
+
+    class TiledHeightMap {
+    public:
+      TiledHeightMap(int width, int height, double targetWidth,
+                     double targetHeight, int tileSize=32);
+
+      void ref();
+      /** \brief deletes the map if this was the last reference */
+      void unref();
+
+      void lockForRead() {lock.lockForRead();}
+      void unlock() {lock.unlock();}
+
+      /** \brief copies \a pixelData multiplied by \a scale */
+      void setHeights(const double *pixelData, double scale);
+      void setHeight(int x, int y, double h);
+
+      double getHeight(int x, int y) const {return heights[y*width+x];}
+      /** \brief bilinear height at a position relative to the corner */
+      double interpolateHeight(double x, double y) const;
+
+      /**
+       * \brief lowers the terrain to the lower half of a sphere at a
+       *        position relative to the corner.
+       * \return \c true if any sample was changed.
+       */
+      bool deformSphere(double x, double y, double z, double radius);
+
+      int getNumSamplesX() const {return width;}
+      int getNumSamplesY() const {return height;}
+      double getStepX() const {return stepX;}
+      double getStepY() const {return stepY;}
+
+      unsigned long getVersion() const {return version;}
+      int getTileSize() const {return tileSize;}
+      int getNumTilesX() const {return numTilesX;}
+      int getNumTilesY() const {return numTilesY;}
+      /** \brief the samples [x1, x2) x [y1, y2) of a tile */
+      void getTileRange(int tile, int *x1, int *y1, int *x2, int *y2) const;
+      /** \brief appends the tiles changed after version \a since */
+      void getChangedTiles(unsigned long since, std::vector<int> *tiles) const;
+      void getHeightBounds(double *min, double *max) const;
+
+    private:
+      ~TiledHeightMap();
+      // disallow copying
+      TiledHeightMap(const TiledHeightMap &);
+      TiledHeightMap &operator=(const TiledHeightMap &);
+
+      void updateTile(int tile);
+      /** \brief upper bound of the samples [x1, x2] x [y1, y2] */
+      double getMaxHeight(int x1, int y1, int x2, int y2) const;
+
+      int width, height;
+      double stepX, stepY;
+      int tileSize, numTilesX, numTilesY;
+      std::vector<double> heights;
+      std::vector<double> tileMin, tileMax;
+      std::vector<unsigned long> tileVersion;
+      volatile unsigned long version;
+      ReadWriteLock lock;
+      Mutex refMutex;
+      int refCount;
+    }; // end of class TiledHeightMap
+
+  } // end of namespace utils
+} // end of namespace mars
+
+#endif /* MARS_UTILS_TILED_HEIGHT_MAP_H */
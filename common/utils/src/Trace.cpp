@@ -0,0 +1,231 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "Trace.h"
+
+#include <pthread.h>
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+#ifdef _MSC_VER
+#  include <windows.h>
+#  define TRACE_MEMORY_BARRIER() MemoryBarrier()
+#else
+#  define TRACE_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+namespace mars {
+  namespace utils {
+
+    struct TraceEvent {
+      const char *category, *name;
+      double start, end;
+    };
+
+    /**
+     * Only the owning thread writes the events. An event is complete once
+     * \c written was incremented past it; the exporter checks \c written
+     * again after copying to drop events that were overwritten meanwhile.
+     */
+    struct TraceBuffer {
+      unsigned long id;
+      unsigned long size;
+      TraceEvent *events;
+      volatile unsigned long written;
+      /** events before this index were dropped by Trace::clear() */
+      unsigned long cleared;
+      std::string threadName;
+    };
+
+    volatile bool Trace::enabled = false;
+
+    // a plain pthread mutex since utils::Mutex reports its waits here
+    static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+    // the buffers of finished threads are kept to export their spans
+    static std::vector<TraceBuffer*> buffers;
+    static std::set<std::string> internedStrings;
+    static unsigned long bufferSize = 1 << 16;
+    static pthread_key_t bufferKey;
+    static pthread_once_t bufferKeyOnce = PTHREAD_ONCE_INIT;
+
+    static void createBufferKey() {
+      pthread_key_create(&bufferKey, NULL);
+    }
+
+    static TraceBuffer* getThreadBuffer() {
+      pthread_once(&bufferKeyOnce, createBufferKey);
+      TraceBuffer *b = (TraceBuffer*)pthread_getspecific(bufferKey);
+      if(!b) {
+        b = new TraceBuffer;
+        b->events = NULL;
+        b->written = 0;
+        b->cleared = 0;
+        pthread_mutex_lock(&registryMutex);
+        b->id = buffers.size() + 1;
+        b->size = bufferSize;
+        buffers.push_back(b);
+        pthread_mutex_unlock(&registryMutex);
+        pthread_setspecific(bufferKey, b);
+      }
+      return b;
+    }
+
+    void Trace::setEnabled(bool enable) {
+      enabled = enable;
+    }
+
+    void Trace::complete(const char *category, const char *name,
+                         double startMs, double endMs) {
+      if(!enabled) return;
+      TraceBuffer *b = getThreadBuffer();
+      if(!b->events) {
+        // allocated on the first span to not burden threads never traced
+        TraceEvent *events = new TraceEvent[b->size];
+        pthread_mutex_lock(&registryMutex);
+        b->events = events;
+        pthread_mutex_unlock(&registryMutex);
+      }
+      unsigned long n = b->written;
+      TraceEvent &e = b->events[n % b->size];
+      e.category = category;
+      e.name = name;
+      e.start = startMs;
+      e.end = endMs;
+      TRACE_MEMORY_BARRIER();
+      b->written = n + 1;
+    }
+
+    void Trace::setThreadName(const std::string &name) {
+      TraceBuffer *b = getThreadBuffer();
+      pthread_mutex_lock(&registryMutex);
+      b->threadName = name;
+      pthread_mutex_unlock(&registryMutex);
+    }
+
+    const char* Trace::intern(const std::string &s) {
+      pthread_mutex_lock(&registryMutex);
+      const char *result = internedStrings.insert(s).first->c_str();
+      pthread_mutex_unlock(&registryMutex);
+      return result;
+    }
+
+    void Trace::setBufferSize(unsigned long events) {
+      pthread_mutex_lock(&registryMutex);
+      bufferSize = events ? events : 1;
+      pthread_mutex_unlock(&registryMutex);
+    }
+
+    void Trace::clear() {
+      pthread_mutex_lock(&registryMutex);
+      for(size_t i=0; i<buffers.size(); ++i) {
+        buffers[i]->cleared = buffers[i]->written;
+      }
+      pthread_mutex_unlock(&registryMutex);
+    }
+
+    static void writeJsonString(FILE *file, const char *s) {
+      fputc('"', file);
+      for(; *s; ++s) {
+        unsigned char c = *s;
+        if(c == '"' || c == '\\') {
+          fputc('\\', file);
+          fputc(c, file);
+        } else if(c < 0x20) {
+          fprintf(file, "\\u%04x", c);
+        } else {
+          fputc(c, file);
+        }
+      }
+      fputc('"', file);
+    }
+
+    bool Trace::writeChromeJson(const std::string &filename) {
+      FILE *file = fopen(filename.c_str(), "w");
+      if(!file) return false;
+
+      // copy the events of every thread without stopping the writers
+      std::vector<std::vector<TraceEvent> > events;
+      std::vector<TraceBuffer> threads;
+      pthread_mutex_lock(&registryMutex);
+      events.resize(buffers.size());
+      for(size_t i=0; i<buffers.size(); ++i) {
+        const TraceBuffer *b = buffers[i];
+        threads.push_back(*b);
+        if(!b->events) continue;
+        unsigned long end = b->written;
+        TRACE_MEMORY_BARRIER();
+        unsigned long begin = b->cleared;
+        if(end > b->size && end - b->size > begin) begin = end - b->size;
+        std::vector<TraceEvent> &copy = events[i];
+        for(unsigned long k=begin; k<end; ++k) {
+          copy.push_back(b->events[k % b->size]);
+        }
+        TRACE_MEMORY_BARRIER();
+        // the slot of event k is rewritten once event k+size is recorded
+        unsigned long now = b->written;
+        if(now >= begin + b->size) {
+          unsigned long valid = now - b->size + 1;
+          copy.erase(copy.begin(), copy.begin() +
+                     (valid < end ? valid - begin : copy.size()));
+        }
+      }
+      pthread_mutex_unlock(&registryMutex);
+
+      double origin = -1.0;
+      for(size_t i=0; i<events.size(); ++i) {
+        for(size_t k=0; k<events[i].size(); ++k) {
+          if(origin < 0.0 || events[i][k].start < origin) {
+            origin = events[i][k].start;
+          }
+        }
+      }
+
+      fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+      fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"tid\":0,\"args\":{\"name\":\"mars\"}}");
+      for(size_t i=0; i<threads.size(); ++i) {
+        if(threads[i].threadName.empty()) continue;
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%lu,\"args\":{\"name\":", threads[i].id);
+        writeJsonString(file, threads[i].threadName.c_str());
+        fprintf(file, "}}");
+      }
+      for(size_t i=0; i<events.size(); ++i) {
+        for(size_t k=0; k<events[i].size(); ++k) {
+          const TraceEvent &e = events[i][k];
+          fprintf(file, ",\n{\"name\":");
+          writeJsonString(file, e.name);
+          fprintf(file, ",\"cat\":");
+          writeJsonString(file, e.category);
+          fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+                  "\"ts\":%.3f,\"dur\":%.3f}", threads[i].id,
+                  (e.start - origin)*1000.0, (e.end - e.start)*1000.0);
+        }
+      }
+      fprintf(file, "\n]}\n");
+      bool ok = !ferror(file);
+      return (fclose(file) == 0) && ok;
+    }
+
+  } // end of namespace utils
+} // end of namespace mars
@@ -27,6 +27,7 @@
   #include <io.h>
 #else
   #include <sys/time.h>
+  #include <time.h>
   #include <unistd.h>
 #endif
 
@@ -89,6 +90,27 @@ namespace mars {
       return getTime() - start;
     }
 
+    /**
+     * @return monotonic time in milliseconds with sub-millisecond
+     *         resolution; only meaningful as difference of two calls
+     */
+    inline double getClockMs() {
+#ifdef WIN32
+      LARGE_INTEGER count, frequency;
+      QueryPerformanceCounter(&count);
+      QueryPerformanceFrequency(&frequency);
+      return count.QuadPart*1000.0/frequency.QuadPart;
+#elif defined(__linux__)
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec*1000.0 + ts.tv_nsec*0.000001;
+#else
+      struct timeval timer;
+      gettimeofday(&timer, NULL);
+      return timer.tv_sec*1000.0 + timer.tv_usec*0.001;
+#endif
+    }
+
     /**
      * sleeps for at least the specified time.
      * @param milliseconds time to sleep in milliseconds
@@ -39,6 +39,7 @@
 #include <osgDB/ReadFile>
 
 #include "../GraphicsManager.h"
+#include "../InstanceManager.h"
 
 namespace mars {
   namespace graphics {
@@ -62,6 +63,18 @@ namespace mars {
 
     osg::ref_ptr<osg::Material> DrawObject::selectionMaterial = makeSelectionMaterial();
 
+    /**
+     * Used as cull callback of the scale transform while the instance
+     * group draws the object: the nodes stay in the graph for picking but
+     * are not drawn.
+     */
+    class SkipDrawCallback : public osg::NodeCallback {
+    public:
+      virtual void operator()(osg::Node*, osg::NodeVisitor*) {}
+    };
+
+    static osg::ref_ptr<osg::NodeCallback> skipDrawCallback = new SkipDrawCallback;
+
     DrawObject::DrawObject(GraphicsManager *g)
       : id_(0),
         nodeMask_(0xff),
@@ -76,10 +89,16 @@ namespace mars {
         sharedStateGroup(false),
         showSelected(true),
         isHidden(true),
-        brightness(1.0) {
+        brightness(1.0),
+        ownState_(false),
+        instanceGroup_(NULL),
+        instanceIndex_(0) {
     }
 
     DrawObject::~DrawObject() {
+      if(g && g->getInstanceManager()) {
+        g->getInstanceManager()->removeObject(this);
+      }
       if(materialNode.valid()) materialNode->removeChild(posTransform_.get());
       if(!sharedStateGroup) {
         // todo: remove materialnode from manager
@@ -124,6 +143,7 @@ namespace mars {
       for(std::list< osg::ref_ptr< osg::Geode > >::iterator it = geodes.begin();
           it != geodes.end(); ++it) {
         group_->addChild(it->get());
+        geodes_.push_back(*it);
         for(unsigned int i=0; i<it->get()->getNumDrawables(); ++i) {
           osg::Drawable *draw = it->get()->getDrawable(i);
           geometry_.push_back(draw->asGeometry());
@@ -219,14 +239,17 @@ namespace mars {
         materialNode = g->getMaterialNode(name);
         materialNode->setBrightness(brightness);
       }
+      materialName_ = name;
       if(show_) {
         show();
       }
+      invalidateInstance();
     }
 
     void DrawObject::setPosition(const Vector &_pos) {
       position_ = _pos;
       posTransform_->setPosition(osg::Vec3(position_.x(), position_.y(), position_.z()));
+      if(instanceGroup_) instanceGroup_->setDirty(instanceIndex_);
     }
 
     void DrawObject::setQuaternion(const Quaternion &q) {
@@ -234,6 +257,7 @@ namespace mars {
       oQuat.set(q.x(), q.y(), q.z(), q.w());
       posTransform_->setAttitude(oQuat);
       quaternion_ = q;
+      if(instanceGroup_) instanceGroup_->setDirty(instanceIndex_);
     }
 
     void DrawObject::setScale(const Vector &scale) {
@@ -245,6 +269,7 @@ namespace mars {
                            scale.x() * geometrySize_.x(),
                            scale.y() * geometrySize_.y(),
                            scale.z() * geometrySize_.z());
+      if(instanceGroup_) instanceGroup_->setDirty(instanceIndex_);
     }
 
     void DrawObject::setScaledSize(const Vector &scaledSize) {
@@ -257,10 +282,12 @@ namespace mars {
     void DrawObject::removeBits(unsigned int bits) {
       nodeMask_ &= ~bits;
       posTransform_->setNodeMask(nodeMask_);
+      invalidateInstance();
     }
     void DrawObject::setBits(unsigned int bits) {
       nodeMask_ = bits;
       posTransform_->setNodeMask(nodeMask_);
+      invalidateInstance();
     }
 
     void DrawObject::setShowSelected(bool val) {
@@ -304,6 +331,7 @@ namespace mars {
 
         }
       }
+      invalidateInstance();
     }
 
     void DrawObject::setRenderBinNumber(int number) {
@@ -315,6 +343,8 @@ namespace mars {
         state->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF);
       }
       state->setRenderBinDetails(number, "RenderBin");
+      ownState_ = true;
+      invalidateInstance();
     }
 
     bool DrawObject::containsNode(osg::Node* node) {
@@ -329,18 +359,21 @@ namespace mars {
       hide();
       isHidden = false;
       materialNode->addChild(posTransform_.get());
+      invalidateInstance();
     }
 
     void DrawObject::hide() {
       if(!materialNode.valid()) return;
       isHidden = true;
       materialNode->removeChild(posTransform_.get());
+      invalidateInstance();
     }
 
     void DrawObject::seperateMaterial() {
       if(!materialNode.valid()) return;
       materialNode->removeChild(posTransform_.get());
       posTransform_->setStateSet(materialNode->getOrCreateStateSet());
+      invalidateInstance();
     }
 
     void DrawObject::showNormals(bool val) {
@@ -351,6 +384,7 @@ namespace mars {
         else {
           scaleTransform_->removeChild(normal_geode.get());
         }
+        invalidateInstance();
       }
     }
 
@@ -359,6 +393,43 @@ namespace mars {
       if(materialNode.valid()) {
         materialNode->setBrightness(brightness);
       }
+      invalidateInstance();
+    }
+
+    bool DrawObject::isInstanceable(void) const {
+      if(!materialNode.valid() || sharedStateGroup || isHidden || ownState_ ||
+         lod.valid() || geodes_.empty() || materialName_.empty()) {
+        return false;
+      }
+      if(selected_ && selectable_) return false;
+      // no normals, laser or other additional nodes
+      return (posTransform_->getStateSet() == NULL &&
+              posTransform_->getNumChildren() == 1 &&
+              posTransform_->getChild(0) == scaleTransform_.get() &&
+              scaleTransform_->getNumChildren() == 1 &&
+              scaleTransform_->getChild(0) == group_.get());
+    }
+
+    void DrawObject::setInstanceGroup(InstanceGroup *group, unsigned int index) {
+      instanceGroup_ = group;
+      instanceIndex_ = index;
+    }
+
+    void DrawObject::setDrawInstanced(bool val) {
+      scaleTransform_->setCullCallback(val ? skipDrawCallback.get() : NULL);
+    }
+
+    osg::Matrix DrawObject::getInstanceMatrix(void) const {
+      osg::Matrix m;
+      posTransform_->computeLocalToWorldMatrix(m, NULL);
+      m.preMult(scaleTransform_->getMatrix());
+      return m;
+    }
+
+    void DrawObject::invalidateInstance(void) {
+      if(g && g->getInstanceManager()) {
+        g->getInstanceManager()->invalidate(this);
+      }
     }
 
     void DrawObject::collideSphere(Vector pos, sReal radius) {
@@ -58,6 +58,7 @@ namespace mars {
   namespace graphics {
 
     class GraphicsManager;
+    class InstanceGroup;
 
     class DrawObject {
     public:
@@ -94,6 +95,7 @@ namespace mars {
       void setNodeMask(unsigned int mask) {
         nodeMask_ = mask;
         group_->setNodeMask(mask);
+        invalidateInstance();
       }
       void setBrightness(double v);
       void setRenderBinNumber(int number);
@@ -151,6 +153,26 @@ namespace mars {
 
       void seperateMaterial();
 
+      const std::string& getMaterialName(void) const {return materialName_;}
+      const std::list< osg::ref_ptr<osg::Geode> >& getGeodes(void) const {
+        return geodes_;
+      }
+      double getBrightness(void) const {return brightness;}
+      /**
+       * \brief returns \c true if the object is drawn unmodified with the
+       *        shared geodes and material and thus can be instanced
+       */
+      bool isInstanceable(void) const;
+      void setInstanceGroup(InstanceGroup *group, unsigned int index);
+      unsigned int getInstanceIndex(void) const {return instanceIndex_;}
+      /**
+       * \brief skips the drawing of the own nodes while the instance group
+       *        draws the object
+       */
+      void setDrawInstanced(bool val);
+      /** \brief the model matrix including the scale */
+      osg::Matrix getInstanceMatrix(void) const;
+
     protected:
       unsigned long id_;
       unsigned int nodeMask_;
@@ -173,6 +195,13 @@ namespace mars {
       bool isHidden;
       double brightness;
       GraphicsManager *g;
+      std::string materialName_;
+      std::list< osg::ref_ptr<osg::Geode> > geodes_;
+      bool ownState_;
+      InstanceGroup *instanceGroup_;
+      unsigned int instanceIndex_;
+
+      void invalidateInstance(void);
       virtual std::list< osg::ref_ptr< osg::Geode > > createGeometry() = 0;
     }; // end of class DrawObject
 
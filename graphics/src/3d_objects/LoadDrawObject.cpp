@@ -26,18 +26,187 @@
  */
 
 #include "LoadDrawObject.h"
+#include "../GraphicsManager.h"
 #include "gui_helper_functions.h"
 
+#include <mars/utils/BinaryMesh.h>
+#include <mars/utils/MeshSimplifier.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/Logging.hpp>
+
 #include <osg/ComputeBoundsVisitor>
 #include <osg/CullFace>
+#include <osg/TriangleIndexFunctor>
+
+#include <sys/stat.h>
 
 #include <iostream>
+#include <cfloat>
 #include <cstdio>
+#include <cstring>
+#include <set>
 
 namespace mars {
   namespace graphics {
 
     using namespace std;
+    using mars::utils::BinaryMeshSource;
+
+    namespace {
+
+      /** the meshes whose levels of detail were logged already */
+      std::set<std::string> loggedLODMeshes;
+
+      struct CollectTriangles {
+        std::vector<uint32_t> *indices;
+        uint32_t base;
+
+        void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+          indices->push_back(base + i1);
+          indices->push_back(base + i2);
+          indices->push_back(base + i3);
+        }
+      };
+
+      struct CountTriangles {
+        unsigned long count;
+
+        void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+          (void)i1; (void)i2; (void)i3;
+          ++count;
+        }
+      };
+
+      unsigned long countTriangles(const std::list< osg::ref_ptr< osg::Geode > > &geodes) {
+        osg::TriangleIndexFunctor<CountTriangles> functor;
+        functor.count = 0;
+        std::list< osg::ref_ptr< osg::Geode > >::const_iterator it;
+        for(it=geodes.begin(); it!=geodes.end(); ++it) {
+          if(!it->valid()) continue;
+          for(unsigned int i=0; i<(*it)->getNumDrawables(); ++i) {
+            (*it)->getDrawable(i)->accept(functor);
+          }
+        }
+        return functor.count;
+      }
+
+      /**
+       * Converts the triangles of a geode into a part of a .bobj file.
+       * Missing vertex normals are smoothed from the triangles; the loaded
+       * geometry itself is not changed since it is shared by all objects
+       * using the same file.
+       */
+      BinaryMeshSource getMeshSource(osg::Geode *geode) {
+        BinaryMeshSource part;
+        part.name = geode->getName();
+        bool texcoords = true;
+        for(unsigned int i=0; i<geode->getNumDrawables(); ++i) {
+          osg::Geometry *geometry = geode->getDrawable(i)->asGeometry();
+          if(!geometry) continue;
+          osg::Vec3Array *vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+          osg::Vec3Array *normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+          osg::Vec2Array *uvs = dynamic_cast<osg::Vec2Array*>(geometry->getTexCoordArray(0));
+          if(!vertices || vertices->empty()) continue;
+          if(normals && normals->size() != vertices->size()) normals = NULL;
+          if(!uvs || uvs->size() != vertices->size()) texcoords = false;
+
+          size_t base = part.positions.size()/3;
+          size_t first = part.indices.size();
+          osg::TriangleIndexFunctor<CollectTriangles> functor;
+          functor.indices = &part.indices;
+          functor.base = (uint32_t)base;
+          geometry->accept(functor);
+
+          for(size_t k=0; k<vertices->size(); ++k) {
+            for(int j=0; j<3; ++j) {
+              part.positions.push_back((*vertices)[k][j]);
+              part.normals.push_back(normals ? (*normals)[k][j] : 0.0f);
+            }
+            if(texcoords) {
+              part.texcoords.push_back((*uvs)[k][0]);
+              part.texcoords.push_back((*uvs)[k][1]);
+            }
+          }
+          if(normals) continue;
+          for(size_t k=first; k<part.indices.size(); k+=3) {
+            const uint32_t *t = &part.indices[k];
+            osg::Vec3 p[3];
+            for(int j=0; j<3; ++j) {
+              p[j].set(part.positions[t[j]*3], part.positions[t[j]*3+1],
+                       part.positions[t[j]*3+2]);
+            }
+            // weighted by the area
+            osg::Vec3 n = (p[1]-p[0]) ^ (p[2]-p[0]);
+            for(int j=0; j<3; ++j) {
+              for(int l=0; l<3; ++l) part.normals[t[j]*3+l] += n[l];
+            }
+          }
+          for(size_t k=base; k<part.positions.size()/3; ++k) {
+            osg::Vec3 n(part.normals[k*3], part.normals[k*3+1],
+                        part.normals[k*3+2]);
+            if(n.normalize() <= 0) n.set(0, 0, 1);
+            for(int l=0; l<3; ++l) part.normals[k*3+l] = n[l];
+          }
+        }
+        if(!texcoords) part.texcoords.clear();
+        return part;
+      }
+
+      osg::ref_ptr<osg::Geode> createGeode(const BinaryMeshSource &part) {
+        size_t numVertices = part.positions.size()/3;
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(numVertices);
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array(numVertices);
+        memcpy(&(*vertices)[0], &part.positions[0], numVertices*12);
+        memcpy(&(*normals)[0], &part.normals[0], numVertices*12);
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get());
+        geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+        if(!part.texcoords.empty()) {
+          osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array(numVertices);
+          memcpy(&(*texcoords)[0], &part.texcoords[0], numVertices*8);
+          geometry->setTexCoordArray(0, texcoords.get());
+        }
+        geometry->addPrimitiveSet(new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES,
+                                                            part.indices.begin(),
+                                                            part.indices.end()));
+        geometry->setUseDisplayList(false);
+        geometry->setUseVertexBufferObjects(true);
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode();
+        geode->addDrawable(geometry.get());
+        geode->setName(part.name);
+        return geode;
+      }
+
+      /** e.g. "tree.lod200.bobj" for 20 % of the triangles of "tree.obj" */
+      std::string getLODFilename(const std::string &filename,
+                                 const std::string &objname, double ratio) {
+        std::string base = filename;
+        size_t slash = filename.find_last_of("/\\");
+        size_t dot = filename.rfind('.');
+        if(dot != std::string::npos &&
+           (slash == std::string::npos || dot > slash)) {
+          base = filename.substr(0, dot);
+        }
+        if(!objname.empty()) base += "." + objname;
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".lod%03d.bobj", (int)(ratio*1000+0.5));
+        return base + suffix;
+      }
+
+      bool isUpToDate(const std::string &cacheFile, const std::string &source) {
+        struct stat cacheStat, sourceStat;
+        if(stat(cacheFile.c_str(), &cacheStat) ||
+           stat(source.c_str(), &sourceStat)) {
+          return false;
+        }
+        if(cacheStat.st_mtime < sourceStat.st_mtime) return false;
+        // rewrites caches of an older format version
+        utils::BinaryMesh cache;
+        return cache.open(cacheFile);
+      }
+
+    } // end of anonymous namespace
 
     LoadDrawObject::LoadDrawObject(GraphicsManager *g,
                                    configmaps::ConfigMap &map,
@@ -75,7 +244,99 @@ namespace mars {
       if(filename[0] != '/') {
         filename = p+"/"+filename;
       }
-      return loadGeodes(filename, (std::string)info_["origname"]);
+      std::string objname = (std::string)info_["origname"];
+      geodes = loadGeodes(filename, objname);
+      // hand made levels of detail take precedence
+      if(!lod.valid() && g->getMeshLODSettings().enabled &&
+         !(info_.hasKey("autoLOD") && !(bool)info_["autoLOD"])) {
+        createLODGeodes(geodes, filename, objname);
+      }
+      return geodes;
+    }
+
+    void LoadDrawObject::createLODGeodes(const std::list< osg::ref_ptr< osg::Geode > > &geodes,
+                                         const std::string &filename,
+                                         const std::string &objname) {
+      const MeshLODSettings &settings = g->getMeshLODSettings();
+      std::vector<unsigned long> triangles(1, countTriangles(geodes));
+      if(settings.ratios.empty() || !triangles[0] ||
+         triangles[0] < (unsigned long)settings.minTriangles) {
+        return;
+      }
+      osg::BoundingSphere bound;
+      std::list< osg::ref_ptr< osg::Geode > >::const_iterator it;
+      for(it=geodes.begin(); it!=geodes.end(); ++it) {
+        if(it->valid()) bound.expandBy((*it)->getBound());
+      }
+      if(!bound.valid() || bound.radius() <= 0) return;
+
+      // every level is reduced from the previous one
+      std::vector<BinaryMeshSource> parts;
+      double partsRatio = 1.0;
+      std::vector< std::list< osg::ref_ptr< osg::Geode > > > levels;
+      for(size_t i=0; i<settings.ratios.size(); ++i) {
+        double ratio = settings.ratios[i];
+        std::string lodFile = getLODFilename(filename, objname, ratio);
+        std::list< osg::ref_ptr< osg::Geode > > level;
+        if(isUpToDate(lodFile, filename)) {
+          level = loadGeodes(lodFile, "");
+        }
+        if(level.empty()) {
+          if(parts.empty()) {
+            for(it=geodes.begin(); it!=geodes.end(); ++it) {
+              if(it->valid()) parts.push_back(getMeshSource(it->get()));
+            }
+            partsRatio = 1.0;
+          }
+          std::vector<BinaryMeshSource> reduced;
+          for(size_t k=0; k<parts.size(); ++k) {
+            BinaryMeshSource part;
+            utils::simplifyMesh(parts[k], ratio/partsRatio, &part);
+            if(!part.indices.empty()) reduced.push_back(part);
+          }
+          parts.swap(reduced);
+          partsRatio = ratio;
+          if(parts.empty()) break;
+          if(utils::BinaryMesh::write(lodFile, parts)) {
+            level = loadGeodes(lodFile, "");
+          }
+          if(level.empty()) {
+            // e.g. a read only directory: keep the level in memory
+            for(size_t k=0; k<parts.size(); ++k) {
+              level.push_back(createGeode(parts[k]));
+            }
+          }
+        }
+        unsigned long n = countTriangles(level);
+        if(!n || n >= triangles.back()) continue;
+        triangles.push_back(n);
+        levels.push_back(level);
+      }
+      if(levels.empty()) return;
+
+      // the distances are given in the coordinates of the mesh, so they
+      // scale with the object
+      float start = bound.radius()*settings.distance;
+      lod = new osg::LOD();
+      for(it=geodes.begin(); it!=geodes.end(); ++it) {
+        if(it->valid()) lod->addChild(it->get(), 0.0f, start);
+      }
+      for(size_t i=0; i<levels.size(); ++i) {
+        float end = (i+1 < levels.size()) ? start*2.0f : FLT_MAX;
+        addLODGeodes(levels[i], start, end);
+        start = end;
+      }
+      // once per mesh, not for every instance
+      if(loggedLODMeshes.insert(filename + ":" + objname).second) {
+        std::string counts;
+        for(size_t i=0; i<triangles.size(); ++i) {
+          char count[32];
+          snprintf(count, sizeof(count), " %lu", triangles[i]);
+          counts += count;
+        }
+        LOG_INFO("LoadDrawObject: triangles of the levels of detail of %s:%s",
+                 filename.c_str(), counts.c_str());
+      }
     }
 
     std::list< osg::ref_ptr< osg::Geode > > LoadDrawObject::loadGeodes(std::string filename, std::string objname) {
@@ -88,8 +349,20 @@ namespace mars {
           std::cerr << "LoadDrawObject: no node loaded" << std::endl;
           return geodes; // TODO: error message
         }
-        found = true;
-        geodes.push_back(loadedNode->asGeode());
+        // versioned .bobj files with several parts are loaded as group
+        osg::ref_ptr<osg::Group> readGroup = loadedNode->asGroup();
+        if(readGroup.valid()) {
+          for (unsigned int i = 0; i < readGroup->getNumChildren(); ++i) {
+            osg::ref_ptr<osg::Node> readNode = readGroup->getChild(i);
+            if (objname == "" || readNode->getName() == objname) {
+              geodes.push_back(readNode->asGeode());
+              found = true;
+            }
+          }
+        } else {
+          found = true;
+          geodes.push_back(loadedNode->asGeode());
+        }
       }
       // import an .STL file
       else if((filename.substr(filename.size()-4, 4) == ".STL") ||
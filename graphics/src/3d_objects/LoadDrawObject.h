@@ -58,6 +58,16 @@ namespace mars {
     private:
       std::list< osg::ref_ptr< osg::Geode > > loadGeodes(std::string filename,
                                                          std::string objname);
+      /**
+       * \brief Adds the given geodes and reduced versions of them as levels
+       *        of detail.
+       *
+       * The reduced meshes are cached as .bobj files next to \a filename
+       * and only generated again if the mesh file is newer.
+       */
+      void createLODGeodes(const std::list< osg::ref_ptr< osg::Geode > > &geodes,
+                           const std::string &filename,
+                           const std::string &objname);
     };
 
   } // end of namespace graphics
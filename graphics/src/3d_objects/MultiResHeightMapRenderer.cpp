@@ -27,6 +27,9 @@
 #endif
 
 #include "MultiResHeightMapRenderer.h"
+#include <mars/utils/TiledHeightMap.h>
+#include <algorithm>
+#include <vector>
 #include <cstdlib>
 #include <cassert>
 #include <cmath>
@@ -61,6 +64,8 @@ namespace mars {
 
     maxNumSubTiles = 100;
     heightData = NULL;
+    heightMap = NULL;
+    heightMapVersion = 0;
     numSubTiles = 0;
     prepare();
 
@@ -75,6 +80,7 @@ namespace mars {
   }
 
   MultiResHeightMapRenderer::~MultiResHeightMapRenderer() {
+    if(heightMap) heightMap->unref();
     clear();
     delete[] vboIds;
     vboIds = NULL;
@@ -89,6 +95,7 @@ namespace mars {
     glBufferData = (PFNGLBUFFERDATAPROC) wglGetProcAddress("glBufferData");
     glMapBuffer = (PFNGLMAPBUFFERPROC) wglGetProcAddress("glMapBuffer");
     glUnmapBuffer = (PFNGLUNMAPBUFFERPROC) wglGetProcAddress("glUnmapBuffer");
+    glBufferSubData = (PFNGLBUFFERSUBDATAPROC) wglGetProcAddress("glBufferSubData");
 #endif
 
     // Generate 2 VBOs
@@ -209,6 +216,8 @@ namespace mars {
 
     if(!isInitialized) initialize();
 
+    syncHeightMap();
+
     if(dirty) {
       glBindBuffer(GL_ARRAY_BUFFER, vboIds[0]);
       VertexData *vertices = (VertexData*)glMapBuffer(GL_ARRAY_BUFFER,
@@ -853,6 +862,78 @@ namespace mars {
     return heightData[gridY][gridX];
   }
 
+  void MultiResHeightMapRenderer::setHeightMap(utils::TiledHeightMap *map) {
+    if(map && (map->getNumSamplesX() != width ||
+               map->getNumSamplesY() != height)) {
+      fprintf(stderr, "MultiResHeightMapRenderer::setHeightMap the height map has a different size\n");
+      return;
+    }
+    if(map) map->ref();
+    if(heightMap) heightMap->unref();
+    heightMap = map;
+    // take over all tiles in the next render()
+    heightMapVersion = 0;
+  }
+
+  void MultiResHeightMapRenderer::syncHeightMap() {
+    std::vector<int> changed;
+    std::vector<int>::iterator it;
+    int x1, y1, x2, y2;
+
+    if(!heightMap || heightMap->getVersion() == heightMapVersion) return;
+    heightMap->lockForRead();
+    heightMap->getChangedTiles(heightMapVersion, &changed);
+    heightMapVersion = heightMap->getVersion();
+    for(it = changed.begin(); it != changed.end(); ++it) {
+      heightMap->getTileRange(*it, &x1, &y1, &x2, &y2);
+      for(int y = y1; y < y2; ++y) {
+        for(int x = x1; x < x2; ++x) {
+          heightData[y][x] = heightMap->getHeight(x, y);
+          if(y==0 || x==0 || y==height-1 || x==width-1) {
+            heightData[y][x] -= 0.1;
+          }
+        }
+      }
+    }
+    heightMap->unlock();
+
+    // a dirty buffer is rewritten completely anyway
+    if(dirty) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vboIds[0]);
+    for(it = changed.begin(); it != changed.end(); ++it) {
+      heightMap->getTileRange(*it, &x1, &y1, &x2, &y2);
+      // the normals two samples around the tile depend on it
+      uploadVertices(x1-2, y1-2, x2+2, y2+2);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  /**
+   * Recalculates the vertices [x1, x2) x [y1, y2) and uploads them row by
+   * row into the bound vertex buffer.
+   */
+  void MultiResHeightMapRenderer::uploadVertices(int x1, int y1,
+                                                 int x2, int y2) {
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, getLowResVertexCntX());
+    y2 = std::min(y2, getLowResVertexCntY());
+    if(x1 >= x2) return;
+
+    for(int y = y1; y < y2; ++y) {
+      int index = y*getLowResVertexCntX() + x1;
+      for(int x = x1; x < x2; ++x) {
+        vertices[index+x-x1].position[2] = heightData[y][x] * scaleZ;
+        getNormal(x, y, getLowResVertexCntX(), getLowResVertexCntY(),
+                  stepX, stepY, heightData,
+                  vertices[index+x-x1].normal,
+                  vertices[index+x-x1].tangent, true);
+      }
+      glBufferSubData(GL_ARRAY_BUFFER, index*sizeof(VertexData),
+                      (x2-x1)*sizeof(VertexData), vertices+index);
+    }
+  }
+
   void MultiResHeightMapRenderer::setOffset(double x, double y, double z) {
     if((x == offset[0]) && (y == offset[1]) && (z == offset[2]))
       return;
@@ -33,6 +33,7 @@ GLEW_FUN_EXPORT PFNGLDELETEBUFFERSPROC glDeleteBuffers;
 GLEW_FUN_EXPORT PFNGLBUFFERDATAPROC glBufferData;
 GLEW_FUN_EXPORT PFNGLMAPBUFFERPROC glMapBuffer;
 GLEW_FUN_EXPORT PFNGLUNMAPBUFFERPROC glUnmapBuffer;
+GLEW_FUN_EXPORT PFNGLBUFFERSUBDATAPROC glBufferSubData;
 #endif
 
 #include <GL/gl.h>
@@ -42,6 +43,10 @@ GLEW_FUN_EXPORT PFNGLUNMAPBUFFERPROC glUnmapBuffer;
 
 namespace mars {
 
+  namespace utils {
+    class TiledHeightMap;
+  }
+
   struct SubTile {
     int x, y;                    // x, y position of low res cell
     int indicesArrayOffset;      // offset in indices array
@@ -74,6 +79,11 @@ namespace mars {
     void setHeight(unsigned int gridX, unsigned int gridY, double height);
     double getHeight(unsigned int gridX, unsigned int gridY);
     void setOffset(double x, double y, double z);
+    /**
+     * \brief takes the heights from \a heightMap; changed tiles of the map
+     *        are uploaded in the next render().
+     */
+    void setHeightMap(utils::TiledHeightMap *heightMap);
     void setDrawSolid(bool drawSolid);
     void setDrawWireframe(bool drawWireframe);
 
@@ -149,6 +159,11 @@ namespace mars {
     void normalize(float *v);
 
     std::list<FootPrint> footPrints;
+    utils::TiledHeightMap *heightMap;
+    unsigned long heightMapVersion;
+
+    void syncHeightMap();
+    void uploadVertices(int x1, int y1, int x2, int y2);
 
     void collideSphereI(double xPos, double yPos, double zPos, double radius);
     void fillOriginal(int x, int y);
@@ -40,6 +40,8 @@ namespace mars {
       osg::Vec3 p3;
     } SphereFace;
 
+    osg::ref_ptr<osg::Geode> SphereDrawObject::sharedSphere = NULL;
+
     SphereDrawObject::SphereDrawObject(GraphicsManager *g)
       : DrawObject(g) {
     }
@@ -214,12 +216,17 @@ namespace mars {
     }
 
     std::list< osg::ref_ptr< osg::Geode > > SphereDrawObject::createGeometry() {
+      std::list< osg::ref_ptr< osg::Geode > > geodes;
+      // all spheres share the unit sphere and are scaled by the transform
+      if(sharedSphere.valid()) {
+        geodes.push_back(sharedSphere);
+        return geodes;
+      }
       osg::ref_ptr<osg::Vec3Array> vertices(new osg::Vec3Array());
       osg::ref_ptr<osg::Vec3Array> normals(new osg::Vec3Array());
       osg::ref_ptr<osg::Vec2Array> uv(new osg::Vec2Array());
       osg::Vec3 zero(0.0f, 0.0f, 0.0f);
       osg::Geometry *geom = new osg::Geometry();
-      std::list< osg::ref_ptr< osg::Geode > > geodes;
 
       createGeometry(vertices.get(), normals.get(), uv.get(),
                      1.0, zero, zero, false, 2);
@@ -235,9 +242,9 @@ namespace mars {
 
       geom->setUseDisplayList(false);
       geom->setUseVertexBufferObjects(true);
-      osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-      geode->addDrawable(geom);
-      geodes.push_back(geode);
+      sharedSphere = new osg::Geode;
+      sharedSphere->addDrawable(geom);
+      geodes.push_back(sharedSphere);
 
       return geodes;
     }
@@ -54,7 +54,7 @@ namespace mars {
       //virtual void setScaledSize(const mars::utils::Vector &scaledSize);
 
     protected:
-      static osg::ref_ptr<osg::Geode> sharedCube;
+      static osg::ref_ptr<osg::Geode> sharedSphere;
       virtual std::list< osg::ref_ptr< osg::Geode > > createGeometry();
 
     }; // end of class SphereDrawObject
@@ -35,9 +35,12 @@
 #include <mars/interfaces/MARSDefs.h>
 #include <mars/utils/Vector.h>
 #include <mars/interfaces/terrainStruct.h>
+#include <mars/utils/TiledHeightMap.h>
 
 #include <configmaps/ConfigMap.hpp>
 
+#include <osg/NodeCallback>
+
 #include <string>
 #include <vector>
 #include <list>
@@ -58,28 +61,29 @@ namespace mars {
       std::string objectName;
     }; // end of struct TerrainDrawObject2Info
 
-    struct SubTile {
-      double xPos, yPos;
-      double **heightData;
-      double xRes, yRes;
-      double xSize, ySize;
-      int xCount, yCount;
-      double vStart;
-      double vCount;
-      int where;
-      int frame;
-      int mapIndex;
-      int x, y;
-      osg::ref_ptr<osg::DrawElementsUInt> pSet;
+    /**
+     * The geometry of one tile of the height map; the vertices [x1, x2] x
+     * [y1, y2] of the terrain grid.
+     */
+    struct TerrainTile {
+      int x1, y1, x2, y2;
       osg::ref_ptr<osg::Vec3Array> vertices;
+      osg::ref_ptr<osg::Vec3Array> normals;
       osg::ref_ptr<osg::Vec4Array> tangents;
       osg::ref_ptr<osg::Vec2Array> texcoords;
-      osg::ref_ptr<osg::Vec3Array> normals;
-      osg::ref_ptr<osg::Vec3Array> normal_debug;
-      osg::ref_ptr<osg::Geometry> normalGeom;
       osg::ref_ptr<osg::Geometry> geom;
-      osg::ref_ptr<osg::Geode> geode;
-    }; // end of struct SubTile
+    }; // end of struct TerrainTile
+
+    class TerrainDrawObject;
+
+    /** \brief takes over deformations of the height map each frame */
+    class TerrainUpdateCallback : public osg::NodeCallback {
+    public:
+      TerrainUpdateCallback(TerrainDrawObject *terrain) : terrain(terrain) {}
+      virtual void operator()(osg::Node *node, osg::NodeVisitor *nv);
+    private:
+      TerrainDrawObject *terrain;
+    }; // end of class TerrainUpdateCallback
 
     class TerrainDrawObject : public DrawObject {
 
@@ -91,7 +95,8 @@ namespace mars {
       virtual void generateTangents();
       virtual void collideSphere(mars::utils::Vector pos,
                                  mars::interfaces::sReal radius);
-      static int countSubTiles;
+      /** \brief updates the tiles changed in the height map */
+      void syncHeightMap();
 
 #ifdef USE_VERTEX_BUFFER
       virtual void setSelected(bool val);
@@ -107,19 +112,17 @@ namespace mars {
 #endif
 
       mars::interfaces::terrainStruct info;
-      osg::ref_ptr<osg::Vec4Array> tangents;
-      osg::ref_ptr<osg::Geometry> geom;
+      unsigned long heightMapVersion;
+      std::vector<TerrainTile> tiles;
+      int numTilesX;
+      osg::ref_ptr<osg::Geode> updateGeode;
 
-      osg::ref_ptr<osg::Vec3Array> vertices;
-      osg::ref_ptr<osg::Vec2Array> texcoords;
-      osg::ref_ptr<osg::Vec3Array> normals;
       osg::ref_ptr<osg::Vec3Array> normal_debug;
       osg::ref_ptr<osg::Geometry> normal_geom;
 
       double **height_data;
 
       int tangentUnit;
-      int num_y, num_x;
       double x_step, y_step;
       double x_step2, y_step2;
       double tex_scale_x, tex_scale_y;
@@ -127,29 +130,15 @@ namespace mars {
       std::vector<std::vector<LoadDrawObjectPSetBox*>*> gridPSets;
       virtual std::list< osg::ref_ptr< osg::Geode > > createGeometry();
 
-      std::map<int, SubTile*> subTiles;
-      std::vector<SubTile*> vSubTiles;
       configmaps::ConfigMap map;
 
-      void createNewSubTile(SubTile *newSubTile, mars::utils::Vector pos,
-                            double radius);
       mars::utils::Vector getNormal(int x, int y, int mx, int my,
                        double x_step, double y_step,
                        double **height_data, osg::Vec3d* t,
                        bool skipBorder = false);
-
-      int rectangleIntersect(const osg::Vec3& first_leftup,
-                             const osg::Vec3& first_downright,
-                             const osg::Vec3& second_leftup,
-                             const osg::Vec3& second_downright);
-      osg::Vec3d intersectReplacementSphere(osg::Vec3 center, double radius,
-                                            osg::Vec3 vertex);
-      void cutHole(int x1, int x2, int y1, int y2);
-      bool adaptSubtile(SubTile* tile, mars::utils::Vector pos, double radius);
-      void removeSubTile(SubTile *tile);
-      void updateShadowObject(mars::utils::Vector pos);
-      void drawSubTile(SubTile *tile);
-      double getHeight(int x, int y, SubTile *tile);
+      void readHeights(int x1, int y1, int x2, int y2);
+      void updateVertices(int x1, int y1, int x2, int y2);
+      void setVertex(TerrainTile *tile, int x, int y);
 
     }; // end of class TerrainDrawObject
 
@@ -109,6 +109,10 @@ namespace mars {
       mrhmr->collideSphere(xPos, yPos, zPos, radius);
     }
 
+    void VertexBufferTerrain::setHeightMap(utils::TiledHeightMap *heightMap) {
+      mrhmr->setHeightMap(heightMap);
+    }
+
     osg::BoundingBox VertexBufferTerrain::computeBound() const {
       return osg::BoundingBox(0.0, 0.0, 0.0, width, height, scale);
     }
@@ -63,6 +63,7 @@ namespace mars {
 
       virtual void drawImplementation(osg::RenderInfo& renderInfo) const;
       void collideSphere(double xPos, double yPos, double zPos, double radius);
+      void setHeightMap(utils::TiledHeightMap *heightMap);
       virtual osg::BoundingBox computeBound() const;
       void setSelected(bool val);
 
@@ -28,6 +28,7 @@
 #include "GraphicsManager.h"
 #include "config.h"
 #include <mars/utils/misc.h>
+#include <mars/utils/Trace.h>
 
 //#include <osgUtil/Optimizer>
 
@@ -62,8 +63,12 @@
 
 #include "wrapper/OSGNodeStruct.h"
 #include "QtOsgMixGraphicsWidget.h"
+#include "InstanceManager.h"
 
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
 #include <cassert>
 #include <stdexcept>
 
@@ -82,6 +87,8 @@ namespace mars {
 
     static int ReceivesShadowTraversalMask = 0x1000;
     static int CastsShadowTraversalMask = 0x2000;
+    // casters that do not move are rendered into the static shadow cache
+    static int StaticCastsShadowTraversalMask = 0x4000;
 
 
     GraphicsManager::GraphicsManager(lib_manager::LibManager *theManager,
@@ -110,8 +117,13 @@ namespace mars {
         set_window_prop(0),
         initialized(false),
         activeWindow(NULL),
-        materialManager(NULL) {
+        materialManager(NULL),
+        instanceManager(NULL) {
       //osg::setNotifyLevel( osg::WARN );
+      instanceManager = new InstanceManager(this);
+      meshLOD.enabled = false;
+      meshLOD.distance = 0.0;
+      meshLOD.minTriangles = 0;
 
       // first check if we have the cfg_manager lib
 
@@ -125,6 +137,8 @@ namespace mars {
         libManager->releaseLibrary("cfg_manager");
       }
       if(materialManager) libManager->releaseLibrary("osg_material_manager");
+      delete instanceManager;
+      instanceManager = NULL;
       //fprintf(stderr, "Delete mars_graphics\n");
     }
 
@@ -197,6 +211,15 @@ namespace mars {
           shadowSamples = cfg->getOrCreateProperty("Graphics",
                                                    "shadowSamples",
                                                    1, this);
+          shadowCascades = cfg->getOrCreateProperty("Graphics",
+                                                    "shadowCascades",
+                                                    3, this);
+          shadowDistance = cfg->getOrCreateProperty("Graphics",
+                                                    "shadowDistance",
+                                                    200.0, this);
+          shadowStaticCache = cfg->getOrCreateProperty("Graphics",
+                                                       "shadowStaticCache",
+                                                       true, this);
           showGridProp = cfg->getOrCreateProperty("Graphics", "showGrid",
                                                   false, this);
           showCoordsProp = cfg->getOrCreateProperty("Graphics", "showCoords",
@@ -204,6 +227,36 @@ namespace mars {
           showSelectionProp = cfg->getOrCreateProperty("Graphics",
                                                        "showSelection",
                                                        true, this);
+          instancingProp = cfg->getOrCreateProperty("Graphics", "instancing",
+                                                    true, this);
+          instanceManager->setEnabled(instancingProp.bValue);
+          instancingMinProp = cfg->getOrCreateProperty("Graphics",
+                                                       "instancing min instances",
+                                                       8, this);
+          instanceManager->setMinInstances(instancingMinProp.iValue);
+
+          autoLODProp = cfg->getOrCreateProperty("Graphics", "autoLOD",
+                                                 true, this);
+          meshLOD.enabled = autoLODProp.bValue;
+          autoLODRatiosProp = cfg->getOrCreateProperty("Graphics",
+                                                       "autoLODRatios",
+                                                       string("0.5 0.2 0.05"),
+                                                       this);
+          setLODRatios(autoLODRatiosProp.sValue);
+          autoLODDistanceProp = cfg->getOrCreateProperty("Graphics",
+                                                         "autoLODDistance",
+                                                         15.0, this);
+          meshLOD.distance = autoLODDistanceProp.dValue;
+          autoLODMinTrianglesProp = cfg->getOrCreateProperty("Graphics",
+                                                             "autoLODMinTriangles",
+                                                             2000, this);
+          meshLOD.minTriangles = autoLODMinTrianglesProp.iValue;
+          smallFeatureCullingProp = cfg->getOrCreateProperty("Graphics",
+                                                             "smallFeatureCulling",
+                                                             2.0, this);
+          sensorLODScaleProp = cfg->getOrCreateProperty("Graphics",
+                                                        "sensorLODScale",
+                                                        2.0, this);
         }
         else {
           marsShadow.bValue = false;
@@ -305,6 +358,10 @@ namespace mars {
 #endif
           shadowMap = new ShadowMap;
           shadowMap->setShadowTextureSize(shadowTextureSize.iValue);
+          shadowMap->setStaticCastsShadowTraversalMask(StaticCastsShadowTraversalMask);
+          shadowMap->setNumCascades(shadowCascades.iValue);
+          shadowMap->setShadowDistance(shadowDistance.dValue);
+          shadowMap->setUseStaticCache(shadowStaticCache.bValue);
           shadowMap->initTexture();
           shadowStateset = shadowedScene->getOrCreateStateSet();
           shadowMap->applyState(shadowStateset.get());
@@ -585,6 +642,8 @@ namespace mars {
       activeWindow = gw;
       gw->setName(name);
       gw->setClearColor(graphicOptions.clearColor);
+      gw->setSmallFeatureCulling(smallFeatureCullingProp.dValue);
+      if(rtt) gw->setLODScale(sensorLODScaleProp.dValue);
       viewer->addView(gw->getView());
       if(graphicsWindows.size() == 0) {
         gw->grabFocus();
@@ -709,6 +768,7 @@ namespace mars {
     }
 
     void GraphicsManager::draw() {
+      MARS_TRACE_SCOPE("graphics", "draw");
       std::list<interfaces::GraphicsUpdateInterface*>::iterator it;
       std::vector<GraphicsWidget*>::iterator iter;
 
@@ -760,8 +820,14 @@ namespace mars {
         materialManager->setShadowScale(shadowMap->getTexScale());
       }
 
+      // upload the poses of the instanced objects
+      instanceManager->update();
+
       // Render a complete new frame.
-      if(viewer) viewer->frame();
+      if(viewer) {
+        MARS_TRACE_SCOPE("graphics", "frame");
+        viewer->frame();
+      }
       ++framecount;
       for(it=graphicsUpdateObjects.begin();
           it!=graphicsUpdateObjects.end(); ++it) {
@@ -865,7 +931,14 @@ namespace mars {
       drawObjects_[id] = drawObject;
 
       if(snode.isShadowCaster) {
-        mask |= CastsShadowTraversalMask;
+        if(snode.movable) {
+          mask |= CastsShadowTraversalMask;
+        }
+        else {
+          mask |= StaticCastsShadowTraversalMask;
+          staticShadowCasters[id] = 0;
+          if(shadowMap.valid()) shadowMap->dirtyStaticCasters();
+        }
       }
       if(snode.isShadowReceiver) {
         mask |= ReceivesShadowTraversalMask;
@@ -926,6 +999,8 @@ namespace mars {
       //osgUtil::Optimizer optimizer;
       //optimizer.optimize(shadowedScene.get());
 
+      instanceManager->addObject(drawObject->object());
+
       // todo: handle preview mode
       // todo: this will not work if material.exists = false
       return id;
@@ -935,6 +1010,9 @@ namespace mars {
       OSGNodeStruct *ns = findDrawObject(id);
       if(ns == NULL) return;
       DrawObject *drawObject = ns->object();
+      if(staticShadowCasters.erase(id) && shadowMap.valid()) {
+        shadowMap->dirtyStaticCasters();
+      }
       if (drawObject) {
         drawObject->hide();
         scene->removeChild(drawObject->getPosTransform());
@@ -988,11 +1066,40 @@ namespace mars {
 
     void GraphicsManager::setDrawObjectPos(unsigned long id, const Vector &pos) {
       OSGNodeStruct *ns = findDrawObject(id);
-      if(ns != NULL) ns->object()->setPosition(pos);
+      if(ns == NULL) return;
+      if(!staticShadowCasters.empty() &&
+         pos != ns->object()->getPosition()) {
+        checkStaticShadowCaster(id, ns->object());
+      }
+      ns->object()->setPosition(pos);
     }
     void GraphicsManager::setDrawObjectRot(unsigned long id, const Quaternion &q) {
       OSGNodeStruct *ns = findDrawObject(id);
-      if(ns != NULL) ns->object()->setQuaternion(q);
+      if(ns == NULL) return;
+      if(!staticShadowCasters.empty() &&
+         !q.isApprox(ns->object()->getQuaternion())) {
+        checkStaticShadowCaster(id, ns->object());
+      }
+      ns->object()->setQuaternion(q);
+    }
+
+    void GraphicsManager::checkStaticShadowCaster(unsigned long id,
+                                                  DrawObject *drawObject) {
+      map<unsigned long, unsigned int>::iterator it = staticShadowCasters.find(id);
+      if(it == staticShadowCasters.end()) return;
+      if(shadowMap.valid()) shadowMap->dirtyStaticCasters();
+      // the frame of the first placement + 1; an object that is moved in
+      // another frame again is rendered as dynamic caster from now on
+      if(it->second == 0 || it->second == framecount+1) {
+        it->second = framecount+1;
+        return;
+      }
+      staticShadowCasters.erase(it);
+      osg::PositionAttitudeTransform *transform = drawObject->getPosTransform();
+      transform->setNodeMask((transform->getNodeMask() &
+                              ~StaticCastsShadowTraversalMask) |
+                             CastsShadowTraversalMask);
+      instanceManager->invalidate(drawObject);
     }
     void GraphicsManager::setDrawObjectScale(unsigned long id, const Vector &ext) {
       OSGNodeStruct *ns = findDrawObject(id);
@@ -1990,6 +2097,24 @@ namespace mars {
         return;
       }
 
+      if(_property.paramId == shadowCascades.paramId) {
+        shadowCascades.iValue = _property.iValue;
+        if(shadowMap.valid()) shadowMap->setNumCascades(shadowCascades.iValue);
+        return;
+      }
+
+      if(_property.paramId == shadowDistance.paramId) {
+        shadowDistance.dValue = _property.dValue;
+        if(shadowMap.valid()) shadowMap->setShadowDistance(shadowDistance.dValue);
+        return;
+      }
+
+      if(_property.paramId == shadowStaticCache.paramId) {
+        shadowStaticCache.bValue = _property.bValue;
+        if(shadowMap.valid()) shadowMap->setUseStaticCache(shadowStaticCache.bValue);
+        return;
+      }
+
       if(_property.paramId == backfaceCulling.paramId) {
         if((backfaceCulling.bValue = _property.bValue))
           globalStateset->setAttributeAndModes(cull, osg::StateAttribute::ON);
@@ -2025,6 +2150,54 @@ namespace mars {
         }
         return;
       }
+
+      if(_property.paramId == instancingProp.paramId) {
+        instancingProp.bValue = _property.bValue;
+        instanceManager->setEnabled(instancingProp.bValue);
+        return;
+      }
+
+      if(_property.paramId == instancingMinProp.paramId) {
+        instancingMinProp.iValue = _property.iValue;
+        instanceManager->setMinInstances(instancingMinProp.iValue);
+        return;
+      }
+
+      // the level of detail settings are used for meshes loaded afterwards
+      if(_property.paramId == autoLODProp.paramId) {
+        meshLOD.enabled = autoLODProp.bValue = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == autoLODRatiosProp.paramId) {
+        autoLODRatiosProp.sValue = _property.sValue;
+        setLODRatios(autoLODRatiosProp.sValue);
+        return;
+      }
+
+      if(_property.paramId == autoLODDistanceProp.paramId) {
+        meshLOD.distance = autoLODDistanceProp.dValue = _property.dValue;
+        return;
+      }
+
+      if(_property.paramId == autoLODMinTrianglesProp.paramId) {
+        meshLOD.minTriangles = autoLODMinTrianglesProp.iValue = _property.iValue;
+        return;
+      }
+
+      if(_property.paramId == smallFeatureCullingProp.paramId) {
+        smallFeatureCullingProp.dValue = _property.dValue;
+        for(size_t i=0; i<graphicsWindows.size(); ++i) {
+          graphicsWindows[i]->setSmallFeatureCulling(smallFeatureCullingProp.dValue);
+        }
+        return;
+      }
+
+      // used for render to texture windows created afterwards
+      if(_property.paramId == sensorLODScaleProp.paramId) {
+        sensorLODScaleProp.dValue = _property.dValue;
+        return;
+      }
     }
 
     void GraphicsManager::emitGeometryChange(unsigned long win_id, int left,
@@ -2088,6 +2261,20 @@ namespace mars {
       if(materialManager) materialManager->setDrawLineLaser(val);
     }
 
+    void GraphicsManager::setLODRatios(const std::string &ratios) {
+      std::istringstream stream(ratios);
+      double ratio;
+      meshLOD.ratios.clear();
+      while(stream >> ratio) {
+        if(ratio > 0.0 && ratio < 1.0) meshLOD.ratios.push_back(ratio);
+      }
+      std::sort(meshLOD.ratios.begin(), meshLOD.ratios.end(),
+                std::greater<double>());
+      meshLOD.ratios.erase(std::unique(meshLOD.ratios.begin(),
+                                       meshLOD.ratios.end()),
+                           meshLOD.ratios.end());
+    }
+
     void GraphicsManager::setUseShader(bool val) {
       if(materialManager) materialManager->setUseShader(val);
       if(val) {
@@ -84,6 +84,7 @@ namespace mars {
     class OSGNodeStruct;
     class OSGHudElementStruct;
     class HUDElement;
+    class InstanceManager;
 
 
     //mapping and control structs
@@ -102,6 +103,23 @@ namespace mars {
       bool free;
     };
 
+    /**
+     * settings of the levels of detail generated for loaded meshes
+     */
+    struct MeshLODSettings {
+      bool enabled;
+      /** triangle ratios of the reduced levels, in decreasing order */
+      std::vector<double> ratios;
+      /**
+       * the distance in bounding radii of the mesh at which the first
+       * reduced level is shown; every further level starts at twice the
+       * distance of the previous one
+       */
+      double distance;
+      /** meshes with less triangles are not reduced */
+      int minTriangles;
+    };
+
     typedef std::map< unsigned long, osg::ref_ptr<OSGNodeStruct> > DrawObjects;
     typedef std::list< osg::ref_ptr<OSGNodeStruct> > DrawObjectList;
     typedef std::list< osg::ref_ptr<OSGHudElementStruct> > HUDElements;
@@ -306,6 +324,8 @@ namespace mars {
       osg_material_manager::MaterialNode* getMaterialNode(const std::string &name);
       void setDrawLineLaser(bool val);
       osg_material_manager::MaterialNode* getSharedStateGroup(unsigned long id);
+      InstanceManager* getInstanceManager() const {return instanceManager;}
+      const MeshLODSettings& getMeshLODSettings() const {return meshLOD;}
       void setUseShadow(bool v);
       void setShadowSamples(int v);
       virtual std::vector<interfaces::MaterialData> getMaterialList() const;
@@ -363,6 +383,8 @@ namespace mars {
       void *image_data;
       double tex_x, tex_y;
       unsigned int framecount;
+      // draw ids of the static shadow casters and when they were placed
+      std::map<unsigned long, unsigned int> staticShadowCasters;
       bool useFog, useNoise, drawLineLaser;
       int hudWidth, hudHeight;
 
@@ -401,24 +423,34 @@ namespace mars {
         multisamples, noiseProp, brightness, marsShader, backfaceCulling,
         drawLineLaserProp, drawMainCamera, marsShadow, hudWidthProp,
         hudHeightProp, defaultMaxNumNodeLights, shadowTextureSize,
-        showGridProp, showCoordsProp, showSelectionProp;
+        showGridProp, showCoordsProp, showSelectionProp, instancingProp,
+        instancingMinProp;
       cfg_manager::cfgPropertyStruct grab_frames;
       cfg_manager::cfgPropertyStruct resources_path;
       cfg_manager::cfgPropertyStruct configPath;
       cfg_manager::cfgPropertyStruct shadowSamples;
+      cfg_manager::cfgPropertyStruct shadowCascades, shadowDistance,
+        shadowStaticCache;
+      cfg_manager::cfgPropertyStruct autoLODProp, autoLODRatiosProp,
+        autoLODDistanceProp, autoLODMinTrianglesProp, smallFeatureCullingProp,
+        sensorLODScaleProp;
+      MeshLODSettings meshLOD;
       int ignore_next_resize;
       bool set_window_prop;
       osg::ref_ptr<osg::CullFace> cull;
       bool initialized;
       GraphicsWidget *activeWindow;
       osg_material_manager::OsgMaterialManager *materialManager;
+      InstanceManager *instanceManager;
       void setupCFG(void);
+      void checkStaticShadowCaster(unsigned long id, DrawObject *drawObject);
 
       unsigned long findCoreObject(unsigned long draw_id) const;
       void setMultisampling(int num_samples);
       void setBrightness(double val);
       void setUseNoise(bool val);
       void setUseShader(bool val);
+      void setLODRatios(const std::string &ratios);
 
       void initDefaultLight();
       void setColor(utils::Color *c, const std::string &key,
@@ -1094,6 +1094,18 @@ namespace mars {
       }
     }
 
+    bool GraphicsWidget::getImageData(char *buffer, size_t size,
+                                      int &width, int &height) {
+      if(isRTTWidget) {
+        width = rttImage->s();
+        height = rttImage->t();
+        if((size_t)width*height*4 > size) return false;
+        memcpy(buffer, rttImage->data(), width*height*4);
+        return true;
+      }
+      return postDrawCallback->getImageData(buffer, size, width, height);
+    }
+
     void GraphicsWidget::getRTTDepthData(float* buffer, int& width, int& height)
     {
       if(isRTTWidget) {
@@ -1749,5 +1761,24 @@ namespace mars {
       }
     }
 
+    void GraphicsWidget::setLODScale(double scale) {
+      osg::ref_ptr<osg::Camera> camera = getMainCamera();
+      if(camera.valid()) camera->setLODScale(scale);
+    }
+
+    void GraphicsWidget::setSmallFeatureCulling(double pixelSize) {
+      osg::ref_ptr<osg::Camera> camera = getMainCamera();
+      if(!camera.valid()) return;
+      osg::CullSettings::CullingMode mode = camera->getCullingMode();
+      if(pixelSize > 0.0) {
+        camera->setSmallFeatureCullingPixelSize(pixelSize);
+        mode |= osg::CullSettings::SMALL_FEATURE_CULLING;
+      }
+      else {
+        mode &= ~osg::CullSettings::SMALL_FEATURE_CULLING;
+      }
+      camera->setCullingMode(mode);
+    }
+
   } // end of namespace graphics
 } // end of namespace mars
@@ -181,6 +181,8 @@ namespace mars {
        * */
       virtual void getImageData(char *buffer, int &width, int &height);
       virtual void getImageData(void **data, int &width, int &height);
+      virtual bool getImageData(char *buffer, size_t size,
+                                int &width, int &height);
 
       /**
        * This function copies the depth image in the given buffer.
@@ -203,6 +205,8 @@ namespace mars {
 
       virtual void setHUDViewOffsets(double x1, double y1,
                                      double x2, double y2);
+      virtual void setLODScale(double scale);
+      virtual void setSmallFeatureCulling(double pixelSize);
 
       void grabFocus();
       void unsetFocus();
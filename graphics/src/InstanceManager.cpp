@@ -0,0 +1,358 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "InstanceManager.h"
+#include "GraphicsManager.h"
+#include "3d_objects/DrawObject.h"
+
+#include <osg/ComputeBoundsVisitor>
+#include <osgUtil/IntersectionVisitor>
+
+#include <mars/osg_material_manager/OsgMaterial.h>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * The bounding box of the instanced geometries is the union of the
+     * bounds of all members.
+     */
+    class InstanceBoundCallback : public osg::Drawable::ComputeBoundingBoxCallback {
+    public:
+      virtual osg::BoundingBox computeBound(const osg::Drawable &) const {
+        return bb;
+      }
+      osg::BoundingBox bb;
+    };
+
+    /**
+     * The instanced geometry only has a meaning for rendering; picking
+     * and bounds computations use the nodes of the members.
+     */
+    class InstanceNode : public osg::Group {
+    public:
+      virtual void traverse(osg::NodeVisitor &nv) {
+        if(dynamic_cast<osgUtil::IntersectionVisitor*>(&nv) ||
+           dynamic_cast<osg::ComputeBoundsVisitor*>(&nv)) {
+          return;
+        }
+        osg::Group::traverse(nv);
+      }
+    };
+
+    InstanceGroup::InstanceGroup(GraphicsManager *g, DrawObject *first)
+      : g(g), active(false), resized(false) {
+      materialName = first->getMaterialName();
+      brightness = first->getBrightness();
+      nodeMask = first->getPosTransform()->getNodeMask() &
+        first->getObject()->getNodeMask();
+      sourceGeodes.assign(first->getGeodes().begin(), first->getGeodes().end());
+    }
+
+    InstanceGroup::~InstanceGroup() {
+      if(active) deactivate();
+      for(size_t i=0; i<members.size(); ++i) {
+        members[i]->setInstanceGroup(NULL, 0);
+      }
+    }
+
+    void InstanceGroup::add(DrawObject *object) {
+      unsigned int index = members.size();
+      members.push_back(object);
+      dirty.push_back(false);
+      object->setInstanceGroup(this, index);
+      setDirty(index);
+      if(active) object->setDrawInstanced(true);
+      resized = true;
+    }
+
+    void InstanceGroup::remove(DrawObject *object) {
+      unsigned int index = object->getInstanceIndex();
+      if(index >= members.size() || members[index] != object) return;
+      object->setDrawInstanced(false);
+      object->setInstanceGroup(NULL, 0);
+      // the last member takes the free slot
+      DrawObject *last = members.back();
+      members.pop_back();
+      dirty.pop_back();
+      if(last != object) {
+        members[index] = last;
+        last->setInstanceGroup(this, index);
+        dirty[index] = false;
+        setDirty(index);
+      }
+      resized = true;
+    }
+
+    void InstanceGroup::setDirty(unsigned int index) {
+      if(index < dirty.size() && !dirty[index]) {
+        dirty[index] = true;
+        dirtyIndices.push_back(index);
+      }
+    }
+
+    bool InstanceGroup::update(bool activate) {
+      if(activate) {
+        osg_material_manager::OsgMaterial *material = NULL;
+        if(!members.empty() && members[0]->getStateGroup()) {
+          material = members[0]->getStateGroup()->getMaterial().get();
+        }
+        osg::Program *p = material ? material->getInstancedProgram() : NULL;
+        if(!p) {
+          activate = false;
+        }
+        else if(p != program.get()) {
+          // the material shader was regenerated
+          if(root.valid()) {
+            osg::StateSet *state = root->getOrCreateStateSet();
+            if(program.valid()) state->removeAttribute(program.get());
+            state->setAttributeAndModes(p, osg::StateAttribute::ON);
+          }
+          program = p;
+        }
+      }
+      if(activate && !active) this->activate();
+      else if(!activate && active) deactivate();
+
+      if(!active) {
+        for(size_t i=0; i<dirtyIndices.size(); ++i) {
+          if(dirtyIndices[i] < dirty.size()) dirty[dirtyIndices[i]] = false;
+        }
+        dirtyIndices.clear();
+        resized = false;
+        return false;
+      }
+
+      bool changed = !dirtyIndices.empty() || resized;
+      if(resized) {
+        if((size_t)matrixImage->s() < 3*members.size()) {
+          // grow by doubling, all matrices are written again
+          int capacity = matrixImage->s() ? matrixImage->s()/3 : 16;
+          while((size_t)capacity < members.size()) capacity *= 2;
+          matrixImage->allocateImage(3*capacity, 1, 1, GL_RGBA, GL_FLOAT);
+          for(size_t i=0; i<members.size(); ++i) setDirty(i);
+        }
+        for(size_t i=0; i<geometries.size(); ++i) {
+          for(unsigned int k=0; k<geometries[i]->getNumPrimitiveSets(); ++k) {
+            geometries[i]->getPrimitiveSet(k)->setNumInstances(members.size());
+          }
+        }
+        resized = false;
+      }
+      for(size_t i=0; i<dirtyIndices.size(); ++i) {
+        unsigned int index = dirtyIndices[i];
+        if(index < members.size()) {
+          writeMatrix(index);
+          dirty[index] = false;
+        }
+      }
+      dirtyIndices.clear();
+
+      if(changed) {
+        matrixImage->dirty();
+        osg::BoundingBox bb;
+        for(size_t i=0; i<members.size(); ++i) {
+          bb.expandBy(members[i]->getPosTransform()->getBound());
+        }
+        boundCallback->bb = bb;
+        for(size_t i=0; i<geometries.size(); ++i) {
+          geometries[i]->dirtyBound();
+        }
+      }
+      return true;
+    }
+
+    void InstanceGroup::activate(void) {
+      if(!materialNode.valid()) {
+        materialNode = g->getMaterialNode(materialName);
+        if(!materialNode.valid()) return;
+        materialNode->setBrightness(brightness);
+      }
+      if(!root.valid()) {
+        root = new InstanceNode;
+        root->setNodeMask(nodeMask);
+        boundCallback = new InstanceBoundCallback;
+        matrixImage = new osg::Image;
+        matrixTexture = new osg::TextureBuffer;
+        matrixTexture->setInternalFormat(GL_RGBA32F_ARB);
+        matrixTexture->setImage(matrixImage.get());
+        // changed every frame, the draw thread has to finish with them
+        // before the next update
+        matrixTexture->setDataVariance(osg::Object::DYNAMIC);
+
+        for(size_t i=0; i<sourceGeodes.size(); ++i) {
+          osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+          geode->setStateSet(sourceGeodes[i]->getStateSet());
+          for(unsigned int k=0; k<sourceGeodes[i]->getNumDrawables(); ++k) {
+            osg::Geometry *source = sourceGeodes[i]->getDrawable(k)->asGeometry();
+            if(!source) continue;
+            // the vertex arrays are shared, the primitive sets get the
+            // number of instances
+            osg::ref_ptr<osg::Geometry> geometry =
+              new osg::Geometry(*source, osg::CopyOp::DEEP_COPY_PRIMITIVES);
+            geometry->setUseDisplayList(false);
+            geometry->setUseVertexBufferObjects(true);
+            geometry->setComputeBoundingBoxCallback(boundCallback.get());
+            geometry->setDataVariance(osg::Object::DYNAMIC);
+            geode->addDrawable(geometry.get());
+            geometries.push_back(geometry);
+          }
+          root->addChild(geode.get());
+        }
+
+        osg::StateSet *state = root->getOrCreateStateSet();
+        state->setDataVariance(osg::Object::DYNAMIC);
+        state->setTextureAttribute(INSTANCE_MATRIX_UNIT, matrixTexture.get());
+        state->addUniform(new osg::Uniform("instanceMatrices",
+                                           INSTANCE_MATRIX_UNIT));
+        state->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+      }
+
+      for(size_t i=0; i<members.size(); ++i) {
+        members[i]->setDrawInstanced(true);
+        setDirty(i);
+      }
+      resized = true;
+      materialNode->addChild(root.get());
+      active = true;
+    }
+
+    void InstanceGroup::deactivate(void) {
+      materialNode->removeChild(root.get());
+      for(size_t i=0; i<members.size(); ++i) {
+        members[i]->setDrawInstanced(false);
+      }
+      active = false;
+    }
+
+    void InstanceGroup::writeMatrix(unsigned int index) {
+      // OSG matrices transform row vectors, the shader needs the rows of
+      // the transposed matrix
+      osg::Matrix m = members[index]->getInstanceMatrix();
+      float *d = (float*)matrixImage->data() + 12*index;
+      for(int row=0; row<3; ++row) {
+        for(int col=0; col<4; ++col) {
+          d[4*row+col] = m(col, row);
+        }
+      }
+    }
+
+    bool InstanceManager::GroupKey::operator<(const GroupKey &other) const {
+      if(material != other.material) return material < other.material;
+      if(geodes != other.geodes) return geodes < other.geodes;
+      if(nodeMask != other.nodeMask) return nodeMask < other.nodeMask;
+      return brightness < other.brightness;
+    }
+
+    InstanceManager::InstanceManager(GraphicsManager *g)
+      : g(g), enabled(true), minInstances(8) {
+    }
+
+    InstanceManager::~InstanceManager() {
+      std::map<GroupKey, InstanceGroup*>::iterator it;
+      for(it=groups.begin(); it!=groups.end(); ++it) {
+        delete it->second;
+      }
+    }
+
+    void InstanceManager::setEnabled(bool enabled) {
+      this->enabled = enabled;
+    }
+
+    void InstanceManager::setMinInstances(unsigned int n) {
+      minInstances = n < 2 ? 2 : n;
+    }
+
+    void InstanceManager::addObject(DrawObject *object) {
+      objects.insert(object);
+      invalid.insert(object);
+    }
+
+    void InstanceManager::removeObject(DrawObject *object) {
+      objects.erase(object);
+      invalid.erase(object);
+      std::map<DrawObject*, GroupKey>::iterator it = objectKeys.find(object);
+      if(it == objectKeys.end()) return;
+      std::map<GroupKey, InstanceGroup*>::iterator group = groups.find(it->second);
+      group->second->remove(object);
+      if(group->second->size() == 0) {
+        delete group->second;
+        groups.erase(group);
+      }
+      objectKeys.erase(it);
+    }
+
+    void InstanceManager::invalidate(DrawObject *object) {
+      if(objects.find(object) != objects.end()) invalid.insert(object);
+    }
+
+    bool InstanceManager::getKey(DrawObject *object, GroupKey *key) const {
+      if(!object->isInstanceable()) return false;
+      key->material = object->getMaterialName();
+      key->geodes.clear();
+      const std::list< osg::ref_ptr<osg::Geode> > &geodes = object->getGeodes();
+      std::list< osg::ref_ptr<osg::Geode> >::const_iterator it;
+      for(it=geodes.begin(); it!=geodes.end(); ++it) {
+        key->geodes.push_back(it->get());
+      }
+      key->nodeMask = object->getPosTransform()->getNodeMask() &
+        object->getObject()->getNodeMask();
+      key->brightness = object->getBrightness();
+      return true;
+    }
+
+    void InstanceManager::update(void) {
+      std::set<DrawObject*>::iterator it;
+      for(it=invalid.begin(); it!=invalid.end(); ++it) {
+        DrawObject *object = *it;
+        GroupKey key;
+        bool instanceable = getKey(object, &key);
+        std::map<DrawObject*, GroupKey>::iterator old = objectKeys.find(object);
+        if(old != objectKeys.end()) {
+          if(instanceable && !(old->second < key) && !(key < old->second)) {
+            continue;
+          }
+          std::map<GroupKey, InstanceGroup*>::iterator group = groups.find(old->second);
+          group->second->remove(object);
+          if(group->second->size() == 0) {
+            delete group->second;
+            groups.erase(group);
+          }
+          objectKeys.erase(old);
+        }
+        if(!instanceable) continue;
+
+        std::map<GroupKey, InstanceGroup*>::iterator group = groups.find(key);
+        if(group == groups.end()) {
+          group = groups.insert(std::make_pair(key, new InstanceGroup(g, object))).first;
+        }
+        group->second->add(object);
+        objectKeys[object] = key;
+      }
+      invalid.clear();
+
+      std::map<GroupKey, InstanceGroup*>::iterator group;
+      for(group=groups.begin(); group!=groups.end(); ++group) {
+        group->second->update(enabled && group->second->size() >= minInstances);
+      }
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
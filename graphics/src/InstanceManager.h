@@ -0,0 +1,154 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file InstanceManager.h
+ * \brief Draws draw objects that share geometry and material with one
+ *        instanced draw call.
+ */
+
+#ifndef MARS_GRAPHICS_INSTANCE_MANAGER_H
+#define MARS_GRAPHICS_INSTANCE_MANAGER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "InstanceManager.h"
+#endif
+
+#include <osg/Group>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Image>
+#include <osg/Program>
+#include <osg/TextureBuffer>
+
+#include <mars/osg_material_manager/MaterialNode.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    class DrawObject;
+    class GraphicsManager;
+    class InstanceBoundCallback;
+
+    /**
+     * All draw objects with the same geometry, material, brightness and
+     * node mask. If the group is active its members only keep their scene
+     * graph nodes for picking and the group draws them with one instanced
+     * draw call per geometry. The model matrices are stored in a texture
+     * buffer that is updated for the members that moved since the last
+     * frame.
+     */
+    class InstanceGroup {
+    public:
+      InstanceGroup(GraphicsManager *g, DrawObject *first);
+      ~InstanceGroup();
+
+      void add(DrawObject *object);
+      void remove(DrawObject *object);
+      size_t size(void) const {return members.size();}
+
+      /** \brief marks the matrix of the member with the index for upload */
+      void setDirty(unsigned int index);
+      /**
+       * \brief activates or deactivates the group and uploads the changed
+       *        matrices; returns false if it could not be activated
+       */
+      bool update(bool activate);
+
+    private:
+      void activate(void);
+      void deactivate(void);
+      void writeMatrix(unsigned int index);
+
+      GraphicsManager *g;
+      std::string materialName;
+      double brightness;
+      unsigned int nodeMask;
+      std::vector< osg::ref_ptr<osg::Geode> > sourceGeodes;
+
+      bool active;
+      std::vector<DrawObject*> members;
+      std::vector<unsigned int> dirtyIndices;
+      std::vector<bool> dirty;
+      bool resized;
+
+      osg::ref_ptr<osg_material_manager::MaterialNode> materialNode;
+      osg::ref_ptr<osg::Group> root;
+      std::vector< osg::ref_ptr<osg::Geometry> > geometries;
+      osg::ref_ptr<InstanceBoundCallback> boundCallback;
+      osg::ref_ptr<osg::Image> matrixImage;
+      osg::ref_ptr<osg::TextureBuffer> matrixTexture;
+      osg::ref_ptr<osg::Program> program;
+    }; // end of class InstanceGroup
+
+    /**
+     * Groups the registered draw objects by geometry and material. The
+     * cube, sphere and mesh objects share their geodes, so all objects
+     * created from the same primitive or mesh file end up in the same
+     * group. Groups with at least \c minInstances members are drawn
+     * instanced; selected, hidden or otherwise individually modified
+     * objects are drawn on their own.
+     */
+    class InstanceManager {
+    public:
+      InstanceManager(GraphicsManager *g);
+      ~InstanceManager();
+
+      void setEnabled(bool enabled);
+      void setMinInstances(unsigned int n);
+
+      void addObject(DrawObject *object);
+      void removeObject(DrawObject *object);
+      /**
+       * \brief the object is regrouped on the next update, has to be
+       *        called if anything of the grouping key changed
+       */
+      void invalidate(DrawObject *object);
+      /** \brief has to be called once per frame before rendering */
+      void update(void);
+
+    private:
+      struct GroupKey {
+        std::string material;
+        std::vector<osg::Geode*> geodes;
+        unsigned int nodeMask;
+        double brightness;
+        bool operator<(const GroupKey &other) const;
+      };
+
+      bool getKey(DrawObject *object, GroupKey *key) const;
+
+      GraphicsManager *g;
+      bool enabled;
+      unsigned int minInstances;
+      std::set<DrawObject*> objects, invalid;
+      std::map<DrawObject*, GroupKey> objectKeys;
+      std::map<GroupKey, InstanceGroup*> groups;
+    }; // end of class InstanceManager
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif /* MARS_GRAPHICS_INSTANCE_MANAGER_H */
@@ -99,5 +99,21 @@ namespace mars {
       pthread_mutex_unlock(imageMutex);
     }
 
+    bool PostDrawCallback::getImageData(char *buffer, size_t size,
+                                        int &width, int &height) {
+      bool copied = false;
+      pthread_mutex_lock(imageMutex);
+      if(_image->valid()) {
+        width = _image->s();
+        height = _image->t();
+        if((size_t)width*height*4 <= size) {
+          memcpy(buffer, _image->data(), width*height*4);
+          copied = true;
+        }
+      }
+      pthread_mutex_unlock(imageMutex);
+      return copied;
+    }
+
   } // end of namespace graphics
 } // end of namespace mars
@@ -43,6 +43,7 @@ namespace mars {
       void setSaveGrab(bool grab);
 
       void getImageData(void **data, int &width, int &height);
+      bool getImageData(char *buffer, size_t size, int &width, int &height);
 
     private:
       osg::Image* _image;
@@ -37,6 +37,8 @@
 #endif
 
 #include <mars/utils/mathUtils.h>
+#include <mars/utils/BinaryMesh.h>
+#include <mars/interfaces/utils.h>
 
 namespace mars {
   namespace graphics {
@@ -247,6 +249,9 @@ namespace mars {
     }
 
     void GuiHelper::getPhysicsFromMesh(mars::interfaces::NodeData* node) {
+      if(mars::interfaces::getPhysicsFromBinaryMesh(node)) {
+        return;
+      }
       if(node->filename.substr(node->filename.size()-5, 5) == ".bobj") {
         getPhysicsFromNode(node, GuiHelper::readBobjFromFile(node->filename));
       }
@@ -376,6 +381,56 @@ namespace mars {
     }
 
 
+    /**
+     * Creates the node of a versioned .bobj file: a geode for a single part
+     * or a group with one named geode per part that share the arrays.
+     */
+    static osg::ref_ptr<osg::Node> readBinaryMesh(const std::string &filename) {
+      mars::utils::BinaryMesh file;
+      if(!file.open(filename)) return 0;
+      const mars::utils::BinaryMeshHeader *header = file.getHeader();
+      const mars::utils::BinaryMeshPart *parts = file.getParts();
+
+      osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(header->numVertices);
+      osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array(header->numVertices);
+      osg::ref_ptr<osg::Vec2Array> texcoords;
+      if(header->numVertices) {
+        memcpy(&(*vertices)[0], file.getPositions(), header->numVertices*12);
+        memcpy(&(*normals)[0], file.getNormals(), header->numVertices*12);
+        if(file.getTexcoords()) {
+          texcoords = new osg::Vec2Array(header->numVertices);
+          memcpy(&(*texcoords)[0], file.getTexcoords(), header->numVertices*8);
+        }
+      }
+
+      osg::ref_ptr<osg::Group> group = new osg::Group();
+      for(uint32_t i=0; i<header->numParts; ++i) {
+        const uint32_t *indices = file.getIndices() + parts[i].firstIndex;
+        osg::ref_ptr<osg::DrawElementsUInt> primitives;
+        primitives = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES,
+                                               indices,
+                                               indices + parts[i].numIndices);
+        osg::Geometry* geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get());
+        geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+        if(texcoords.valid()) {
+          geometry->setTexCoordArray(0, texcoords.get());
+        }
+        geometry->addPrimitiveSet(primitives.get());
+        osg::Geode *geode = new osg::Geode();
+        geode->addDrawable(geometry);
+        geode->setName(parts[i].name);
+        group->addChild(geode);
+      }
+      if(group->getNumChildren() == 1) {
+        osg::ref_ptr<osg::Node> geode = group->getChild(0);
+        geode->setName("bobj");
+        return geode;
+      }
+      return group.get();
+    }
+
     osg::ref_ptr<osg::Node> GuiHelper::readBobjFromFile(const std::string &filename) {
 
       std::vector<nodeFileStruct>::iterator iter;
@@ -387,6 +442,14 @@ namespace mars {
       nodeFileStruct newNodeFile;
       newNodeFile.fileName = filename;
 
+      if(mars::utils::BinaryMesh::isBinaryMesh(filename)) {
+        newNodeFile.node = readBinaryMesh(filename);
+        if(newNodeFile.node.valid()) {
+          GuiHelper::nodeFiles.push_back(newNodeFile);
+        }
+        return newNodeFile.node;
+      }
+
       FILE* input = fopen(filename.c_str(), "rb");
       if(!input) return 0;
 
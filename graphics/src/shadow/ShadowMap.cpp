@@ -33,6 +33,7 @@
 #include <osg/ComputeBoundsVisitor>
 #include <osg/PolygonOffset>
 #include <osg/CullFace>
+#include <osg/Depth>
 #include <osg/io_utils>
 
 #ifdef HAVE_OSG_VERSION_H
@@ -41,7 +42,9 @@
   #include <osg/Export>
 #endif
 
+#include <algorithm>
 #include <cstdio>
+#include <cmath>
 
 using namespace osgShadow;
 
@@ -56,11 +59,54 @@ using namespace osgShadow;
 namespace mars {
   namespace graphics {
 
+    // the cascades are fitted with this margin to the frustum slices and
+    // keep their bounds (and the static cache) while the slice fits in
+    static const double cascadeMargin = 1.25;
+    // weight of the logarithmic split scheme against the uniform one
+    static const double cascadeSplitLambda = 0.75;
+
+    /**
+     * Renders the children of the camera (the copy of the static cache)
+     * and the shadow casting scene.
+     */
+    class DepthCameraCullCallback : public osg::NodeCallback {
+    public:
+      DepthCameraCullCallback(ShadowTechnique *st) : shadowTechnique(st) {}
+
+      virtual void operator()(osg::Node *node, osg::NodeVisitor *nv) {
+        traverse(node, nv);
+        if(shadowTechnique->getShadowedScene()) {
+          shadowTechnique->getShadowedScene()->osg::Group::traverse(*nv);
+        }
+      }
+
+    private:
+      ShadowTechnique *shadowTechnique;
+    };
+
+    static const char *copyDepthVertexSource =
+      "varying vec2 texCoord;\n"
+      "void main() {\n"
+      "  texCoord = gl_Vertex.xy;\n"
+      "  gl_Position = vec4(gl_Vertex.xy*2.0-1.0, 0.0, 1.0);\n"
+      "}\n";
+
+    static const char *copyDepthFragmentSource =
+      "uniform sampler2D staticDepth;\n"
+      "varying vec2 texCoord;\n"
+      "void main() {\n"
+      "  gl_FragDepth = texture2D(staticDepth, texCoord).r;\n"
+      "}\n";
+
     ShadowMap::ShadowMap() {
       shadowTextureUnit = 2;
       centerObject = NULL;
       radius = 1.0;
       shadowTextureSize = 2048;
+      numCascades = 0;
+      shadowDistance = 200.0;
+      useStaticCache = true;
+      staticCastsShadowTraversalMask = 0;
       // create own uniforms
       createUniforms();
     }
@@ -71,6 +117,10 @@ namespace mars {
       centerObject = copy.centerObject;
       radius = 1.0;
       shadowTextureSize = 2048;
+      numCascades = copy.numCascades;
+      shadowDistance = copy.shadowDistance;
+      useStaticCache = copy.useStaticCache;
+      staticCastsShadowTraversalMask = copy.staticCastsShadowTraversalMask;
       // create own uniforms
       createUniforms();
     }
@@ -99,11 +149,60 @@ namespace mars {
       textureScaleUniform = new osg::Uniform("osgShadow_textureScale",
                                             1.0f);
       uniformList.push_back(textureScaleUniform.get());
+
+      numCascadesUniform = new osg::Uniform("osgShadow_numCascades", 0);
+      numCascadesUniform->setDataVariance(osg::Object::DYNAMIC);
+      uniformList.push_back(numCascadesUniform.get());
+      cascadeSplitsUniform = new osg::Uniform("osgShadow_cascadeSplits",
+                                              osg::Vec4());
+      cascadeSplitsUniform->setDataVariance(osg::Object::DYNAMIC);
+      uniformList.push_back(cascadeSplitsUniform.get());
+      cascadeMatrixUniform = new osg::Uniform(osg::Uniform::FLOAT_MAT4,
+                                              "osgShadow_cascadeMatrix",
+                                              MAX_SHADOW_CASCADES);
+      cascadeMatrixUniform->setDataVariance(osg::Object::DYNAMIC);
+      uniformList.push_back(cascadeMatrixUniform.get());
+    }
+
+    void ShadowMap::setNumCascades(int n) {
+      if(n < 0) n = 0;
+      if(n > MAX_SHADOW_CASCADES) n = MAX_SHADOW_CASCADES;
+      if(n == numCascades) return;
+      numCascades = n;
+      // the cascades are placed side by side in the shadow texture
+      if(texture.valid()) {
+        texture->setTextureSize(std::max(numCascades, 1)*shadowTextureSize,
+                                shadowTextureSize);
+        texture->dirtyTextureObject();
+      }
+      _dirty = true;
+    }
+
+    void ShadowMap::setShadowDistance(double v) {
+      shadowDistance = v;
+      for(size_t i=0; i<cascades.size(); ++i) {
+        cascades[i].valid = false;
+      }
+    }
+
+    void ShadowMap::setUseStaticCache(bool v) {
+      useStaticCache = v;
+      for(size_t i=0; i<cascades.size(); ++i) {
+        cascades[i].staticQuad->setNodeMask(useStaticCache ? ~0u : 0u);
+        cascades[i].staticDirty = true;
+      }
+    }
+
+    void ShadowMap::dirtyStaticCasters() {
+      for(size_t i=0; i<cascades.size(); ++i) {
+        cascades[i].staticDirty = true;
+      }
     }
 
     void ShadowMap::initTexture() {
       texture = new osg::Texture2D;
-      texture->setTextureSize(shadowTextureSize, shadowTextureSize);
+      texture->setTextureSize(std::max(numCascades, 1)*shadowTextureSize,
+                              shadowTextureSize);
       texture->setInternalFormat(GL_DEPTH_COMPONENT);
       texture->setShadowComparison(true);
       texture->setShadowTextureMode(osg::Texture2D::LUMINANCE);
@@ -145,47 +244,120 @@ namespace mars {
                                          osg::StateAttribute::ON);
     }
 
+    osg::Camera* ShadowMap::createDepthCamera(osg::Texture2D *depthTexture,
+                                              int x) {
+      // create the camera
+      osg::Camera *camera = new osg::Camera;
+      camera->setReferenceFrame(osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT);
+      camera->setCullCallback(new DepthCameraCullCallback(this));
+      camera->setClearMask(GL_DEPTH_BUFFER_BIT);
+      //_camera->setClearMask(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+      camera->setClearColor(osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+      camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+      // set viewport
+      camera->setViewport(x, 0, shadowTextureSize, shadowTextureSize);
+      // set the camera to render before the main camera.
+      camera->setRenderOrder(osg::Camera::PRE_RENDER);
+      // tell the camera to use OpenGL frame buffer object where supported.
+      camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+      //camera->setRenderTargetImplementation(osg::Camera::SEPERATE_WINDOW);
+      // attach the texture and use it as the color buffer.
+      camera->attach(osg::Camera::DEPTH_BUFFER, depthTexture);
+      osg::StateSet* stateset = camera->getOrCreateStateSet();
+
+      // cull front faces so that only backfaces contribute to depth map
+      osg::ref_ptr<osg::CullFace> cull_face = new osg::CullFace;
+      cull_face->setMode(osg::CullFace::FRONT);
+      stateset->setAttribute(cull_face.get(), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+      stateset->setMode(GL_CULL_FACE, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+
+      // negative polygonoffset - move the backface nearer to the eye point so that backfaces
+      // shadow themselves
+      float factor = 1.2;
+      float units =  1.2;
+
+      osg::ref_ptr<osg::PolygonOffset> polygon_offset = new osg::PolygonOffset;
+      polygon_offset->setFactor(factor);
+      polygon_offset->setUnits(units);
+      stateset->setAttribute(polygon_offset.get(), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+      stateset->setMode(GL_POLYGON_OFFSET_FILL, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+      return camera;
+    }
+
+    void ShadowMap::initCascades() {
+      cascades.clear();
+      if(!copyDepthProgram.valid()) {
+        copyDepthProgram = new osg::Program;
+        copyDepthProgram->addShader(new osg::Shader(osg::Shader::VERTEX,
+                                                    copyDepthVertexSource));
+        copyDepthProgram->addShader(new osg::Shader(osg::Shader::FRAGMENT,
+                                                    copyDepthFragmentSource));
+      }
+
+      for(int i=0; i<numCascades; ++i) {
+        Cascade cascade;
+        cascade.radius = 0.0;
+        cascade.valid = false;
+        cascade.staticDirty = true;
+
+        cascade.staticTexture = new osg::Texture2D;
+        cascade.staticTexture->setTextureSize(shadowTextureSize,
+                                              shadowTextureSize);
+        cascade.staticTexture->setInternalFormat(GL_DEPTH_COMPONENT);
+        cascade.staticTexture->setFilter(osg::Texture2D::MIN_FILTER,
+                                         osg::Texture2D::NEAREST);
+        cascade.staticTexture->setFilter(osg::Texture2D::MAG_FILTER,
+                                         osg::Texture2D::NEAREST);
+        cascade.staticTexture->setWrap(osg::Texture2D::WRAP_S,
+                                       osg::Texture2D::CLAMP_TO_EDGE);
+        cascade.staticTexture->setWrap(osg::Texture2D::WRAP_T,
+                                       osg::Texture2D::CLAMP_TO_EDGE);
+
+        // the static casters are only rendered if the cascade changed
+        cascade.staticCamera = createDepthCamera(cascade.staticTexture.get(), 0);
+        cascade.staticCamera->setRenderOrder(osg::Camera::PRE_RENDER, 2*i);
+        cascade.camera = createDepthCamera(texture.get(), i*shadowTextureSize);
+        cascade.camera->setRenderOrder(osg::Camera::PRE_RENDER, 2*i+1);
+
+        // screen aligned quad that writes the static depth before the
+        // dynamic casters are rendered, the vertex shader ignores the
+        // matrices
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        vertices->push_back(osg::Vec3(0.0f, 0.0f, 0.0f));
+        vertices->push_back(osg::Vec3(1.0f, 0.0f, 0.0f));
+        vertices->push_back(osg::Vec3(1.0f, 1.0f, 0.0f));
+        vertices->push_back(osg::Vec3(0.0f, 1.0f, 0.0f));
+        osg::ref_ptr<osg::Geometry> quad = new osg::Geometry;
+        quad->setVertexArray(vertices.get());
+        quad->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::QUADS, 0, 4));
+        quad->setInitialBound(osg::BoundingBox(-1e6, -1e6, -1e6, 1e6, 1e6, 1e6));
+        cascade.staticQuad = new osg::Geode;
+        cascade.staticQuad->addDrawable(quad.get());
+        cascade.staticQuad->setCullingActive(false);
+        cascade.staticQuad->setNodeMask(useStaticCache ? ~0u : 0u);
+
+        osg::StateSet *state = cascade.staticQuad->getOrCreateStateSet();
+        state->setAttributeAndModes(copyDepthProgram.get(),
+                                    osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+        state->setTextureAttribute(0, cascade.staticTexture.get(),
+                                   osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+        state->addUniform(new osg::Uniform("staticDepth", 0));
+        state->setMode(GL_CULL_FACE, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED);
+        state->setAttributeAndModes(new osg::Depth(osg::Depth::ALWAYS),
+                                    osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+        state->setRenderBinDetails(-1, "RenderBin");
+        cascade.camera->addChild(cascade.staticQuad.get());
+
+        cascades.push_back(cascade);
+      }
+    }
+
     void ShadowMap::init() {
       if (!_shadowedScene) return;
 
       // set up the render to texture camera.
-      {
-        // create the camera
-        camera = new osg::Camera;
-        camera->setReferenceFrame(osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT);
-        camera->setCullCallback(new CameraCullCallback(this));
-        camera->setClearMask(GL_DEPTH_BUFFER_BIT);
-        //_camera->setClearMask(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-        camera->setClearColor(osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
-        camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
-        // set viewport
-        camera->setViewport(0, 0, shadowTextureSize, shadowTextureSize);
-        // set the camera to render before the main camera.
-        camera->setRenderOrder(osg::Camera::PRE_RENDER);
-        // tell the camera to use OpenGL frame buffer object where supported.
-        camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
-        //camera->setRenderTargetImplementation(osg::Camera::SEPERATE_WINDOW);
-        // attach the texture and use it as the color buffer.
-        camera->attach(osg::Camera::DEPTH_BUFFER, texture.get());
-        osg::StateSet* stateset = camera->getOrCreateStateSet();
-
-        // cull front faces so that only backfaces contribute to depth map
-        osg::ref_ptr<osg::CullFace> cull_face = new osg::CullFace;
-        cull_face->setMode(osg::CullFace::FRONT);
-        stateset->setAttribute(cull_face.get(), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
-        stateset->setMode(GL_CULL_FACE, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
-
-        // negative polygonoffset - move the backface nearer to the eye point so that backfaces
-        // shadow themselves
-        float factor = 1.2;
-        float units =  1.2;
-
-        osg::ref_ptr<osg::PolygonOffset> polygon_offset = new osg::PolygonOffset;
-        polygon_offset->setFactor(factor);
-        polygon_offset->setUnits(units);
-        stateset->setAttribute(polygon_offset.get(), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
-        stateset->setMode(GL_POLYGON_OFFSET_FILL, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
-      }
+      camera = createDepthCamera(texture.get(), 0);
+      initCascades();
 
       {
         stateset = new osg::StateSet;
@@ -273,6 +445,19 @@ namespace mars {
       lightDir = osg::Matrix::transform3x3( lightDir, eyeToWorld );
       lightDir.normalize();
 
+      // directional lights without a center object use the cascades
+      if (selectLight && numCascades > 0 && lightpos[3] == 0.0 &&
+          !centerObject && selectLight->getSpotCutoff() >= 90.0f) {
+        const_cast<osg::Light*>(selectLight)->setAmbient(osg::Vec4(0.0f,0.0f,0.0f,1.0f));
+        osg::Vec3 toLight(lightpos.x(), lightpos.y(), lightpos.z());
+        toLight.normalize();
+        if(cullCascades(cv, toLight)) {
+          cv.setTraversalMask( traversalMask );
+          return;
+        }
+      }
+      numCascadesUniform->set(0);
+
       if (selectLight) {
 
         // set to ambient on light to black so that the ambient bias uniform can take it's affect
@@ -290,7 +475,8 @@ namespace mars {
         else {
           // get the bounds of the model.
           osg::ComputeBoundsVisitor cbbv(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN);
-          cbbv.setTraversalMask(getShadowedScene()->getCastsShadowTraversalMask());
+          cbbv.setTraversalMask(getShadowedScene()->getCastsShadowTraversalMask() |
+                                staticCastsShadowTraversalMask);
 
           _shadowedScene->osg::Group::traverse(cbbv);
 
@@ -387,7 +573,8 @@ namespace mars {
           }
         }
 
-        cv.setTraversalMask( getShadowedScene()->getCastsShadowTraversalMask() );
+        cv.setTraversalMask( getShadowedScene()->getCastsShadowTraversalMask() |
+                             staticCastsShadowTraversalMask );
 
         // do RTT camera traversal
         camera->accept(cv);
@@ -399,7 +586,8 @@ namespace mars {
         // and second that will be used as modelview when appling to OpenGL
         texgen->setPlanesFromMatrix( camera->getProjectionMatrix() *
                                      osg::Matrix::translate(1.0,1.0,1.0) *
-                                     osg::Matrix::scale(0.5f,0.5f,0.5f) );
+                                     osg::Matrix::scale(0.5f,0.5f,0.5f) *
+                                     osg::Matrix::scale(1.0/std::max(numCascades, 1), 1.0, 1.0) );
 
         // Place texgen with modelview which removes big offsets (making it float friendly)
         osg::RefMatrix * refMatrix = new osg::RefMatrix
@@ -410,10 +598,13 @@ namespace mars {
 #else
         // compute the matrix which takes a vertex from local coords into tex coords
         // will use this later to specify osg::TexGen..
+        // the texture is shared with the cascades, only the first part
+        // of it is used
         osg::Matrix MVPT = camera->getViewMatrix() *
           camera->getProjectionMatrix() *
           osg::Matrix::translate(1.0,1.0,1.0) *
-          osg::Matrix::scale(0.5f,0.5f,0.5f);
+          osg::Matrix::scale(0.5f,0.5f,0.5f) *
+          osg::Matrix::scale(1.0/std::max(numCascades, 1), 1.0, 1.0);
 
         texgen->setPlanesFromMatrix(MVPT);
         texGenMatrixUniform->set(MVPT);
@@ -426,6 +617,119 @@ namespace mars {
       cv.setTraversalMask( traversalMask );
     }
 
+    bool ShadowMap::cullCascades(osgUtil::CullVisitor &cv,
+                                 const osg::Vec3 &lightDir) {
+      if(cascades.empty()) return false;
+      double fovy, aspect, zNear, zFar;
+      if(!cv.getProjectionMatrix()->getPerspective(fovy, aspect, zNear, zFar)) {
+        return false;
+      }
+      if(zNear < 0.01) zNear = 0.01;
+      if(zFar > shadowDistance) zFar = shadowDistance;
+      if(zFar <= zNear) return false;
+
+      // a changed light direction invalidates all cascades
+      if((lightDir-cascadeLightDir).length2() > 1e-8) {
+        cascadeLightDir = lightDir;
+        for(size_t i=0; i<cascades.size(); ++i) cascades[i].valid = false;
+      }
+
+      osg::Matrix eyeToWorld;
+      eyeToWorld.invert(*cv.getModelViewMatrix());
+      double tanY = tan(osg::DegreesToRadians(fovy)*0.5);
+      double tanX = tanY*aspect;
+      int n = (int)cascades.size();
+      double splitNear = zNear;
+      osg::Vec4 splits;
+      bool haveBounds = false;
+      osg::BoundingSphere sceneBound;
+
+      for(int i=0; i<n; ++i) {
+        Cascade &cascade = cascades[i];
+        double f = (double)(i+1)/n;
+        double splitFar = (cascadeSplitLambda*zNear*pow(zFar/zNear, f) +
+                           (1.0-cascadeSplitLambda)*(zNear+(zFar-zNear)*f));
+        splits[i] = splitFar;
+
+        // bounding sphere of the frustum slice
+        osg::Vec3 corners[8];
+        osg::Vec3 center;
+        for(int k=0; k<8; ++k) {
+          double d = (k < 4) ? splitNear : splitFar;
+          double x = ((k & 1) ? 1.0 : -1.0) * d*tanX;
+          double y = ((k & 2) ? 1.0 : -1.0) * d*tanY;
+          corners[k] = osg::Vec3(x, y, -d) * eyeToWorld;
+          center += corners[k];
+        }
+        center /= 8.0;
+        double sliceRadius = 0.0;
+        for(int k=0; k<8; ++k) {
+          sliceRadius = std::max(sliceRadius, (double)(corners[k]-center).length());
+        }
+        splitNear = splitFar;
+
+        // keep the bounds while the slice fits in and the resolution is
+        // not wasted
+        if(!cascade.valid ||
+           (center-cascade.center).length()+sliceRadius > cascade.radius ||
+           sliceRadius*cascadeMargin*cascadeMargin < cascade.radius) {
+          if(!haveBounds) {
+            osg::ComputeBoundsVisitor cbbv(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN);
+            cbbv.setTraversalMask(getShadowedScene()->getCastsShadowTraversalMask() |
+                                  staticCastsShadowTraversalMask);
+            _shadowedScene->osg::Group::traverse(cbbv);
+            sceneBound.expandBy(cbbv.getBoundingBox());
+            haveBounds = true;
+          }
+          cascade.center = center;
+          cascade.radius = sliceRadius*cascadeMargin;
+          // all casters between the light and the cascade have to be inside
+          double back = cascade.radius;
+          if(sceneBound.valid()) {
+            back += (sceneBound.center()-center).length() + sceneBound.radius();
+          }
+          osg::Vec3 position = center + lightDir*back;
+          cascade.view = osg::Matrix::lookAt(position, center,
+                                             computeOrthogonalVector(lightDir));
+          cascade.projection = osg::Matrix::ortho(-cascade.radius, cascade.radius,
+                                                  -cascade.radius, cascade.radius,
+                                                  0.0, back+cascade.radius);
+          cascade.valid = true;
+          cascade.staticDirty = true;
+        }
+
+        cascade.camera->setViewMatrix(cascade.view);
+        cascade.camera->setProjectionMatrix(cascade.projection);
+        if(useStaticCache) {
+          if(cascade.staticDirty) {
+            cascade.staticCamera->setViewMatrix(cascade.view);
+            cascade.staticCamera->setProjectionMatrix(cascade.projection);
+            cv.setTraversalMask(staticCastsShadowTraversalMask);
+            cascade.staticCamera->accept(cv);
+            cascade.staticDirty = false;
+          }
+          cv.setTraversalMask(getShadowedScene()->getCastsShadowTraversalMask());
+        }
+        else {
+          cv.setTraversalMask(getShadowedScene()->getCastsShadowTraversalMask() |
+                              staticCastsShadowTraversalMask);
+        }
+        cascade.camera->accept(cv);
+
+        // world to the part of the shadow texture used by the cascade
+        osg::Matrix m = (cascade.view * cascade.projection *
+                         osg::Matrix::translate(1.0, 1.0, 1.0) *
+                         osg::Matrix::scale(0.5, 0.5, 0.5) *
+                         osg::Matrix::scale(1.0/n, 1.0, 1.0) *
+                         osg::Matrix::translate((double)i/n, 0.0, 0.0));
+        cascadeMatrixUniform->setElement(i, osg::Matrixf(m));
+      }
+      cascadeSplitsUniform->set(splits);
+      numCascadesUniform->set(n);
+      texscale = cascades[0].radius;
+      return true;
+    }
+
     void ShadowMap::resizeGLObjectBuffers(unsigned int maxSize) {
 #if (OPENSCENEGRAPH_MAJOR_VERSION > 3 || (OPENSCENEGRAPH_MAJOR_VERSION == 3 && OPENSCENEGRAPH_MINOR_VERSION > 4))
       osg::resizeGLObjectBuffers(camera, maxSize);
@@ -433,6 +737,11 @@ namespace mars {
       osg::resizeGLObjectBuffers(texture, maxSize);
       osg::resizeGLObjectBuffers(stateset, maxSize);
       osg::resizeGLObjectBuffers(ls, maxSize);
+      for(size_t i=0; i<cascades.size(); ++i) {
+        osg::resizeGLObjectBuffers(cascades[i].camera, maxSize);
+        osg::resizeGLObjectBuffers(cascades[i].staticCamera, maxSize);
+        osg::resizeGLObjectBuffers(cascades[i].staticTexture, maxSize);
+      }
 #endif
     }
 
@@ -443,6 +752,11 @@ namespace mars {
       osg::releaseGLObjects(texture, state);
       osg::releaseGLObjects(stateset, state);
       osg::releaseGLObjects(ls, state);
+      for(size_t i=0; i<cascades.size(); ++i) {
+        osg::releaseGLObjects(cascades[i].camera, state);
+        osg::releaseGLObjects(cascades[i].staticCamera, state);
+        osg::releaseGLObjects(cascades[i].staticTexture, state);
+      }
 #endif
     }
 
@@ -24,13 +24,21 @@
  * \brief The ShadowMap is a clone of the original osgShadow::ShadowMap but
  *        allows to render the shadow texture in a given area of
  *        a defined node
+ *
+ * For directional lights the shadow texture is split into cascades that
+ * are fitted to slices of the view frustum. The static casters of every
+ * cascade are rendered into an own depth texture that is only updated if
+ * the light or the cascade bounds changed; the dynamic casters are
+ * rendered on top of a copy of it every frame.
  */
 
 #ifndef MARS_GRAPHICS_SHADOW_MAP_H
 #define MARS_GRAPHICS_SHADOW_MAP_H
 
 #include <osg/Camera>
+#include <osg/Geode>
 #include <osg/Material>
+#include <osg/Program>
 #include <osg/MatrixTransform>
 #include <osg/Object>
 #include <osgShadow/ShadowTechnique>
@@ -69,6 +77,24 @@ namespace mars {
         shadowTextureSize = v;
       }
 
+      /**
+       * \brief Sets the number of cascades for directional lights, up to
+       *        MAX_SHADOW_CASCADES; 0 renders one texture for the whole scene.
+       */
+      void setNumCascades(int n);
+      /** \brief the view distance covered by the cascades */
+      void setShadowDistance(double v);
+      void setUseStaticCache(bool v);
+      /**
+       * \brief Nodes with this mask are rendered into the static cache
+       *        instead of every frame.
+       */
+      void setStaticCastsShadowTraversalMask(unsigned int mask) {
+        staticCastsShadowTraversalMask = mask;
+      }
+      /** \brief has to be called if static casters are added, moved or removed */
+      void dirtyStaticCasters();
+
       void initTexture();
       osg::Texture2D* getTexture() {
         return texture.get();
@@ -85,7 +111,20 @@ namespace mars {
       virtual void releaseGLObjects(osg::State* = 0) const;
 
     protected:
+      struct Cascade {
+        osg::ref_ptr<osg::Camera> camera, staticCamera;
+        osg::ref_ptr<osg::Texture2D> staticTexture;
+        osg::ref_ptr<osg::Geode> staticQuad;
+        osg::Vec3 center;
+        double radius;
+        osg::Matrix view, projection;
+        bool valid, staticDirty;
+      };
+
       virtual void createUniforms();
+      osg::Camera* createDepthCamera(osg::Texture2D *depthTexture, int x);
+      void initCascades();
+      bool cullCascades(osgUtil::CullVisitor &cv, const osg::Vec3 &lightDir);
 
       osg::ref_ptr<osg::Camera> camera;
       osg::ref_ptr<osg::TexGen> texgen;
@@ -103,6 +142,17 @@ namespace mars {
       unsigned int shadowTextureUnit;
       int shadowTextureSize;
       float texscale;
+
+      std::vector<Cascade> cascades;
+      int numCascades;
+      double shadowDistance;
+      bool useStaticCache;
+      unsigned int staticCastsShadowTraversalMask;
+      osg::Vec3 cascadeLightDir;
+      osg::ref_ptr<osg::Program> copyDepthProgram;
+      osg::ref_ptr<osg::Uniform> numCascadesUniform;
+      osg::ref_ptr<osg::Uniform> cascadeSplitsUniform;
+      osg::ref_ptr<osg::Uniform> cascadeMatrixUniform;
     }; // end of class ShadowMap
 
   } // end of namespace graphics
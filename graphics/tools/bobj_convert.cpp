@@ -0,0 +1,154 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Converts any mesh OpenSceneGraph can read (OBJ, STL, DAE, ...) into a
+ * versioned .bobj file. Every geode becomes a part named like the geode,
+ * which matches the object names the OBJ loader gives to the children of
+ * the loaded group.
+ *
+ * usage: mars_bobj_convert <input> [<output.bobj>]
+ */
+
+#include <mars/utils/BinaryMesh.h>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/TriangleIndexFunctor>
+#include <osgDB/ReadFile>
+#include <osgUtil/SmoothingVisitor>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using mars::utils::BinaryMesh;
+using mars::utils::BinaryMeshSource;
+
+namespace {
+
+  struct CollectTriangles {
+    std::vector<uint32_t> *indices;
+    uint32_t base;
+
+    void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+      indices->push_back(base + i1);
+      indices->push_back(base + i2);
+      indices->push_back(base + i3);
+    }
+  };
+
+  class CollectParts : public osg::NodeVisitor {
+  public:
+    CollectParts() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN) {}
+
+    void apply(osg::Geode &geode) {
+      osg::Matrix matrix = osg::computeLocalToWorld(getNodePath());
+      osg::Matrix normalMatrix = osg::Matrix::inverse(matrix);
+      BinaryMeshSource part;
+      part.name = geode.getName();
+      if(part.name.empty() && geode.getNumParents()) {
+        part.name = geode.getParent(0)->getName();
+      }
+      bool texcoords = true;
+      for(unsigned int i=0; i<geode.getNumDrawables(); ++i) {
+        osg::Geometry *geometry = geode.getDrawable(i)->asGeometry();
+        if(!geometry) continue;
+        osg::Vec3Array *vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+        osg::Vec3Array *normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+        osg::Vec2Array *uvs = dynamic_cast<osg::Vec2Array*>(geometry->getTexCoordArray(0));
+        if(!vertices || vertices->empty()) continue;
+        if(!normals || normals->size() != vertices->size()) {
+          osgUtil::SmoothingVisitor::smooth(*geometry);
+          normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+          vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+        }
+        if(!uvs || uvs->size() != vertices->size()) texcoords = false;
+
+        osg::TriangleIndexFunctor<CollectTriangles> functor;
+        functor.indices = &part.indices;
+        functor.base = (uint32_t)(part.positions.size()/3);
+        geometry->accept(functor);
+
+        for(size_t k=0; k<vertices->size(); ++k) {
+          osg::Vec3 v = (*vertices)[k] * matrix;
+          osg::Vec3 n(0, 0, 1);
+          if(normals && normals->size() == vertices->size()) {
+            n = osg::Matrix::transform3x3(normalMatrix, (*normals)[k]);
+            n.normalize();
+          }
+          for(int j=0; j<3; ++j) {
+            part.positions.push_back(v[j]);
+            part.normals.push_back(n[j]);
+          }
+          if(texcoords) {
+            part.texcoords.push_back((*uvs)[k][0]);
+            part.texcoords.push_back((*uvs)[k][1]);
+          }
+        }
+      }
+      if(!texcoords) part.texcoords.clear();
+      if(!part.indices.empty()) parts.push_back(part);
+    }
+
+    std::vector<BinaryMeshSource> parts;
+  };
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[]) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <input> [<output.bobj>]\n", argv[0]);
+    return 1;
+  }
+  std::string input = argv[1];
+  std::string output;
+  if(argc > 2) {
+    output = argv[2];
+  } else {
+    output = input.substr(0, input.rfind('.')) + ".bobj";
+  }
+
+  osg::ref_ptr<osg::Node> node = osgDB::readNodeFile(input);
+  if(!node.valid()) {
+    fprintf(stderr, "could not read \"%s\"\n", input.c_str());
+    return 1;
+  }
+  CollectParts collect;
+  node->accept(collect);
+  if(collect.parts.empty()) {
+    fprintf(stderr, "no triangles found in \"%s\"\n", input.c_str());
+    return 1;
+  }
+  if(!BinaryMesh::write(output, collect.parts)) return 1;
+
+  BinaryMesh mesh;
+  if(!mesh.open(output)) {
+    fprintf(stderr, "could not read back \"%s\"\n", output.c_str());
+    return 1;
+  }
+  const mars::utils::BinaryMeshHeader *h = mesh.getHeader();
+  printf("%s: %u parts, %u vertices, %u triangles, collision: %u vertices, "
+         "%u triangles, volume %g\n", output.c_str(), h->numParts,
+         h->numVertices, h->numIndices/3, h->numCollisionVertices,
+         h->numCollisionIndices/3, h->volume);
+  return 0;
+}
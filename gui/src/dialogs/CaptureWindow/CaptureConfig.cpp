@@ -32,6 +32,7 @@
 #include <QDir>
 
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/data_broker/DataBrokerInterface.h>
 
 namespace mars {
   namespace gui {
@@ -44,11 +45,14 @@ namespace mars {
       frame_rate = 15;
       win_id = 0;
       imageProcess = 0;
+      frameDue = triggerStarted = false;
+      dueTime = nextFrameTime = lastSimTime = 0;
+      missedFrames = 0;
     }
 
     CaptureConfig::~CaptureConfig() {
       if(capture) stopCapture();
-      while(isRunning()) msleep(10);
+      wait();
     }
   
     void CaptureConfig::setWindowID(unsigned long id) {
@@ -66,7 +70,10 @@ namespace mars {
     }
 
     void CaptureConfig::stopCapture(void) {
+      triggerMutex.lock();
       capture = false;
+      triggerCondition.wakeAll();
+      triggerMutex.unlock();
     }
 
     QString CaptureConfig::getState(void) {
@@ -75,9 +82,13 @@ namespace mars {
 
       if(imageProcess) {
         state = imageProcess->getState();
+        unsigned long dropped = imageProcess->getDropped();
         switch(state) {
         case 1:
           r_state.append("is capturing");
+          if(dropped) {
+            r_state.append(QString(" (%1 frames dropped)").arg(dropped));
+          }
           break;
         case 2:
           r_state.append("wait for finishing");
@@ -91,13 +102,65 @@ namespace mars {
       return r_state;
     }
 
+    void CaptureConfig::receiveData(const data_broker::DataInfo &info,
+                                    const data_broker::DataPackage &package,
+                                    int callbackParam) {
+      double simTime, period = 1000.0/frame_rate;
+      if(!package.get(0, &simTime)) return;
+
+      triggerMutex.lock();
+      if(!triggerStarted || simTime < lastSimTime) {
+        // first frame or the simulation was reset
+        nextFrameTime = simTime;
+        triggerStarted = true;
+      }
+      lastSimTime = simTime;
+      if(simTime >= nextFrameTime) {
+        // the previous frame wasn't grabbed in time
+        if(frameDue) ++missedFrames;
+        // steps longer than the frame period skip frames
+        unsigned long skipped = (unsigned long)((simTime - nextFrameTime) / period);
+        missedFrames += skipped;
+        nextFrameTime += (skipped+1)*period;
+        frameDue = true;
+        dueTime = simTime;
+        triggerCondition.wakeOne();
+      }
+      triggerMutex.unlock();
+    }
+
+    void CaptureConfig::grabImage(double simTime) {
+      myImage *image = imageProcess->getFreeImage();
+      if(!image) {
+        // all buffers are waiting for the encoder
+        imageProcess->dropImage();
+        return;
+      }
+      int width = 0, height = 0;
+      bool grabbed = gw->getImageData((char*)image->data, image->size,
+                                      width, height);
+      if(!grabbed && width > 0 && height > 0) {
+        imageProcess->resizeImage(image, width, height);
+        grabbed = gw->getImageData((char*)image->data, image->size,
+                                   width, height);
+      }
+      if(grabbed) {
+        if(width != image->width || height != image->height) {
+          imageProcess->resizeImage(image, width, height);
+        }
+        image->simTime = simTime;
+        imageProcess->addImage(image);
+      } else {
+        imageProcess->releaseImage(image);
+        // no image was rendered yet
+        if(width > 0 && height > 0) imageProcess->dropImage();
+      }
+    }
+
     void CaptureConfig::run(void) {
 
       // init capture
       QString logFolder, num;
-      void *data;
-      int width, height;
-      myImage newImage;
   
       logFolder = QDateTime().currentDateTime().toString("yyyy_MM_dd_hh_mm");
       logFolder.append("_win_");
@@ -116,22 +179,41 @@ namespace mars {
         capture = false;
       }
 
+      triggerMutex.lock();
+      frameDue = triggerStarted = false;
+      missedFrames = 0;
+      triggerMutex.unlock();
+      bool simTimeTrigger = capture && control->dataBroker;
+      if(simTimeTrigger) {
+        control->dataBroker->registerSyncReceiver(this, "mars_sim", "simTime");
+      }
+
       // update capture
       while(capture) {
-        if(gw) {
-          data = 0;
-          gw->getImageData(&data, width, height);
-          if(data) {
-            newImage.data = data;
-            newImage.width = width;
-            newImage.height = height;
-            imageProcess->addImage(newImage);
-          }
+        triggerMutex.lock();
+        if(simTimeTrigger) {
+          if(!frameDue && capture) triggerCondition.wait(&triggerMutex);
+        } else {
+          // without data broker fall back to the wall clock
+          triggerCondition.wait(&triggerMutex, 1000/frame_rate);
+          frameDue = capture;
+          dueTime = 0;
         }
-        msleep(1000/frame_rate);
+        bool due = frameDue;
+        double simTime = dueTime;
+        unsigned long missed = missedFrames;
+        frameDue = false;
+        missedFrames = 0;
+        triggerMutex.unlock();
+
+        if(missed) imageProcess->dropImage(missed);
+        if(due && gw) grabImage(simTime);
       }
 
       // deinit capture
+      if(simTimeTrigger) {
+        control->dataBroker->unregisterSyncReceiver(this, "mars_sim", "simTime");
+      }
       if(gw) gw->setGrabFrames(false);
       delete imageProcess;
       imageProcess = 0;
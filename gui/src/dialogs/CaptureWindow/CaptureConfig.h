@@ -32,8 +32,11 @@
 #endif
 
 #include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/data_broker/ReceiverInterface.h>
 
 #include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 
 #include "ImageProcess.h"
 
@@ -46,7 +49,16 @@ namespace mars {
 
   namespace gui {
 
-    class CaptureConfig : public QThread {
+    /**
+     * Captures the frames of a window every 1000/frame_rate ms of simulation
+     * time ("mars_sim"/"simTime"), so the video runs in simulation time
+     * independent of how fast the simulation runs. The simulation thread
+     * only triggers the grab, the image is read by this thread. Frames
+     * that can't be grabbed in time or don't find a free buffer are
+     * dropped and counted.
+     */
+    class CaptureConfig : public QThread,
+                          public data_broker::ReceiverInterface {
       Q_OBJECT
 
       public:
@@ -62,17 +74,28 @@ namespace mars {
       bool isCapturing(void) {return capturing;}
       QString getState(void);
 
+      virtual void receiveData(const data_broker::DataInfo &info,
+                               const data_broker::DataPackage &package,
+                               int callbackParam);
+
     protected:
       void run(void);
 
     private:
+      void grabImage(double simTime);
+
       interfaces::ControlCenter* control;
       interfaces::GraphicsWindowInterface *gw;
       interfaces::GraphicsCameraInterface* gc;
       ImageProcess *imageProcess;
       bool capture, capturing;
       int frame_rate;
-      std::vector<myImage> imageList;
+
+      QMutex triggerMutex;
+      QWaitCondition triggerCondition;
+      bool frameDue, triggerStarted;
+      double dueTime, nextFrameTime, lastSimTime;
+      unsigned long missedFrames;
 
       unsigned long win_id;
     };
@@ -20,52 +20,233 @@
 
 #include "ImageProcess.h"
 #include <cstdio>
+#include <cstdlib>
+
+#if defined(__SSSE3__)
+  #include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+#endif
 
 namespace mars {
   namespace gui {
 
-    ImageProcess::ImageProcess(QString folder, int framerate) {
+    class ImageConverter : public QThread {
+    public:
+      ImageConverter(ImageProcess *imageProcess)
+        : imageProcess(imageProcess) {}
+
+    protected:
+      void run(void) {
+        imageProcess->runConverter();
+      }
+
+    private:
+      ImageProcess *imageProcess;
+    };
+
+    ImageProcess::ImageProcess(QString folder, int framerate,
+                               int numBuffers, int numThreads) {
       this->folder = folder;
       processing = true;
-      start();
       state = 1;
+      percent = 0;
       width = height = 0;
       writer = 0;
+      frameCount = nextFrame = 0;
+      written = dropped = 0;
       this->framerate = framerate;
-      fprintf(stderr, "created ImagePorcess\n");
+
+      myImage image;
+      image.data = image.converted = 0;
+      image.size = 0;
+      image.width = image.height = image.stride = 0;
+      image.frame = 0;
+      image.simTime = 0;
+      image.state = IMAGE_FREE;
+      imageList.resize(numBuffers < 2 ? 2 : numBuffers, image);
+
+      if(numThreads <= 0) {
+        numThreads = QThread::idealThreadCount() - 1;
+        if(numThreads > 4) numThreads = 4;
+      }
+      if(numThreads < 1) numThreads = 1;
+      for(int i=0; i<numThreads; ++i) {
+        converters.push_back(new ImageConverter(this));
+        converters.back()->start();
+      }
+      start();
+      fprintf(stderr, "created ImageProcess\n");
     }
 
     ImageProcess::~ImageProcess() {
-      bool wait = true;
-
       state = 2;
-      while(wait) {
-        listMutex.lock();
-        if(imageList.size() == 0) wait = false;
-        listMutex.unlock();
-        msleep(100);
+      listMutex.lock();
+      processing = false;
+      convertCondition.wakeAll();
+      writeCondition.wakeAll();
+      listMutex.unlock();
+
+      for(size_t i=0; i<converters.size(); ++i) {
+        converters[i]->wait();
+        delete converters[i];
       }
+      wait();
 
-      processing = false;
-      while(isRunning()) msleep(100);
+      for(size_t i=0; i<imageList.size(); ++i) {
+        free(imageList[i].data);
+        free(imageList[i].converted);
+      }
+      fprintf(stderr, "destroyed ImageProcess: %lu frames written, %lu dropped\n",
+              written, dropped);
+    }
+
+    myImage* ImageProcess::getFreeImage(void) {
+      myImage *image = 0;
+      listMutex.lock();
+      if(processing) {
+        for(size_t i=0; i<imageList.size(); ++i) {
+          if(imageList[i].state == IMAGE_FREE) {
+            image = &imageList[i];
+            image->state = IMAGE_GRABBING;
+            break;
+          }
+        }
+      }
+      listMutex.unlock();
+      return image;
+    }
 
-      fprintf(stderr, "destroyed ImagePorcess\n");
+    void ImageProcess::resizeImage(myImage *image, int width, int height) {
+      // the rows of an IplImage are 4 byte aligned
+      int stride = (width*3 + 3) & ~3;
+      size_t size = (size_t)width*height*4;
+      if(size > image->size) {
+        free(image->data);
+        image->data = (unsigned char*)malloc(size);
+        image->size = size;
+      }
+      if(width != image->width || height != image->height) {
+        free(image->converted);
+        image->converted = (unsigned char*)malloc((size_t)stride*height);
+      }
+      image->width = width;
+      image->height = height;
+      image->stride = stride;
+    }
+
+    void ImageProcess::addImage(myImage *image) {
+      listMutex.lock();
+      if(processing) {
+        image->frame = frameCount++;
+        image->state = IMAGE_GRABBED;
+        convertCondition.wakeOne();
+      } else {
+        image->state = IMAGE_FREE;
+        ++dropped;
+      }
+      listMutex.unlock();
+    }
+
+    void ImageProcess::releaseImage(myImage *image) {
+      listMutex.lock();
+      image->state = IMAGE_FREE;
+      listMutex.unlock();
     }
 
-    void ImageProcess::addImage(myImage image) {
+    void ImageProcess::dropImage(unsigned long count) {
       listMutex.lock();
-      if(processing) imageList.push_back(image);
+      dropped += count;
+      listMutex.unlock();
+    }
+
+    unsigned long ImageProcess::getWritten(void) {
+      QMutexLocker locker(&listMutex);
+      return written;
+    }
+
+    unsigned long ImageProcess::getDropped(void) {
+      QMutexLocker locker(&listMutex);
+      return dropped;
+    }
+
+    void ImageProcess::convertImage(const unsigned char *src,
+                                    unsigned char *dest,
+                                    int width, int height, int destStride) {
+#if defined(__SSSE3__)
+      // packs the first three bytes of four pixels into the lower 12 bytes
+      const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+                                         12, 13, 14, -1, -1, -1, -1);
+#endif
+      for(int i=0; i<height; ++i) {
+        const unsigned char *s = src + (size_t)(height-1-i)*width*4;
+        unsigned char *d = dest + (size_t)i*destStride;
+        int k = 0;
+#if defined(__SSSE3__)
+        for(; k+16<=width; k+=16, s+=64, d+=48) {
+          __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask);
+          __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+16)), mask);
+          __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+32)), mask);
+          __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+48)), mask);
+          _mm_storeu_si128((__m128i*)d,
+                           _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+          _mm_storeu_si128((__m128i*)(d+16),
+                           _mm_or_si128(_mm_srli_si128(p1, 4),
+                                        _mm_slli_si128(p2, 8)));
+          _mm_storeu_si128((__m128i*)(d+32),
+                           _mm_or_si128(_mm_srli_si128(p2, 8),
+                                        _mm_slli_si128(p3, 4)));
+        }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        for(; k+16<=width; k+=16, s+=64, d+=48) {
+          uint8x16x4_t bgra = vld4q_u8(s);
+          uint8x16x3_t bgr;
+          bgr.val[0] = bgra.val[0];
+          bgr.val[1] = bgra.val[1];
+          bgr.val[2] = bgra.val[2];
+          vst3q_u8(d, bgr);
+        }
+#endif
+        for(; k<width; ++k, s+=4, d+=3) {
+          d[0] = s[0];
+          d[1] = s[1];
+          d[2] = s[2];
+        }
+      }
+    }
+
+    void ImageProcess::runConverter(void) {
+      listMutex.lock();
+      while(true) {
+        // convert the oldest frame first to keep the writer busy
+        myImage *image = 0;
+        for(size_t i=0; i<imageList.size(); ++i) {
+          if(imageList[i].state == IMAGE_GRABBED &&
+             (!image || imageList[i].frame < image->frame)) {
+            image = &imageList[i];
+          }
+        }
+        if(image) {
+          image->state = IMAGE_CONVERTING;
+          listMutex.unlock();
+          convertImage(image->data, image->converted,
+                       image->width, image->height, image->stride);
+          listMutex.lock();
+          image->state = IMAGE_CONVERTED;
+          writeCondition.wakeOne();
+        } else if(processing) {
+          convertCondition.wait(&listMutex);
+        } else {
+          break;
+        }
+      }
       listMutex.unlock();
     }
 
     void ImageProcess::run(void) {
-      myImage newImage;
-      uchar *data = 0;
-      uchar *dest, *src;
       QString num;
       IplImage *cvImage = 0;
 
-      imageCount = 0;
       file_count = 0;
 
       file = folder;
@@ -74,58 +255,54 @@ namespace mars {
       file.append(num);
       file.append(".avi");
 
-      while(processing) {
-        listMutex.lock();
-        if(imageList.size() > 0) {
-
-          // get first image
-          newImage = imageList[0];
-          imageList.erase(imageList.begin());
-          listMutex.unlock();
-      
-          if(width == 0) {
-            width = newImage.width;
-            height = newImage.height;
-            writer = cvCreateVideoWriter(qPrintable(file),
-                                         //-1, framerate,
-                                         CV_FOURCC('X', 'V', 'I', 'D'), framerate,
-                                         //CV_FOURCC('M', 'J', 'P', 'G'), framerate,
-                                         cvSize(width, height), 1); 
-            cvImage = cvCreateImageHeader(cvSize(width, height), IPL_DEPTH_8U, 3);
-            data = (uchar*)malloc(width*height*3);
-            cvImage->imageData = (char*)data;
-          }
-          // convert to standard rgb image
-          for (int i=0; i<newImage.height; ++i) {
-            for(int k=0; k<newImage.width; ++k) {
-              dest = data + ((newImage.height-1)*(newImage.width)*3-
-                             i*newImage.width*3 + k*3);
-
-              src  = (uchar*)newImage.data + (i*newImage.width*4) + k*4;
-
-              memcpy(dest, src, 3);
-            }
-          }
-
-          // save new Image
-          if(writer) {
-            cvWriteFrame(writer, cvImage);
-            ++imageCount;
+      listMutex.lock();
+      while(processing || nextFrame < frameCount) {
+        myImage *image = 0;
+        for(size_t i=0; i<imageList.size(); ++i) {
+          if(imageList[i].state == IMAGE_CONVERTED &&
+             imageList[i].frame == nextFrame) {
+            image = &imageList[i];
+            break;
           }
+        }
+        if(!image) {
+          writeCondition.wait(&listMutex);
+          continue;
+        }
+        listMutex.unlock();
 
-          // free memory
-          free(newImage.data);
+        bool write = true;
+        if(width == 0) {
+          width = image->width;
+          height = image->height;
+          writer = cvCreateVideoWriter(qPrintable(file),
+                                       //-1, framerate,
+                                       CV_FOURCC('X', 'V', 'I', 'D'), framerate,
+                                       //CV_FOURCC('M', 'J', 'P', 'G'), framerate,
+                                       cvSize(width, height), 1);
+          cvImage = cvCreateImageHeader(cvSize(width, height), IPL_DEPTH_8U, 3);
         }
-        else {
-          listMutex.unlock();
-          msleep(4);
+        else if(image->width != width || image->height != height) {
+          // the video size is fixed by the first frame
+          write = false;
+        }
+
+        if(writer && write) {
+          cvImage->imageData = (char*)image->converted;
+          cvWriteFrame(writer, cvImage);
         }
+
+        listMutex.lock();
+        if(writer && write) ++written;
+        else ++dropped;
+        image->state = IMAGE_FREE;
+        ++nextFrame;
       }
-  
+      listMutex.unlock();
+
       // clean up
-      if(writer) cvReleaseVideoWriter(&writer);  
+      if(writer) cvReleaseVideoWriter(&writer);
       if(cvImage) cvReleaseImageHeader(&cvImage);
-      if(data) free(data);
     }
 
   } // end of namespace gui
@@ -23,6 +23,7 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
 #include <vector>
 
 #ifdef WIN32
@@ -36,29 +37,92 @@
 namespace mars {
   namespace gui {
 
+    class ImageConverter;
+
+    /**
+     * A buffer of the frame pool. The grabbed image is stored as BGRA with
+     * the rows bottom up as read from OpenGL, the converted image as BGR
+     * with the rows top down and \c stride bytes per row.
+     */
     struct myImage {
-      void *data;
+      unsigned char *data;
+      unsigned char *converted;
+      size_t size;
       int width;
       int height;
+      int stride;
+      unsigned long frame;
+      double simTime;
+      int state;
     };
 
+    /**
+     * Writes the captured frames of one window into a video file.
+     *
+     * The frames are taken from a fixed pool of buffers: if all buffers are
+     * in use because the encoding falls behind, getFreeImage() returns NULL
+     * and the frame has to be dropped instead of growing the memory. The
+     * swizzling of the frames is done by several converter threads, this
+     * thread writes the converted frames in the order they were added.
+     */
     class ImageProcess : public QThread {
     public:
-      ImageProcess(QString folder, int framerate);
+      /**
+       * \param numThreads number of converter threads, 0 chooses it from
+       *        the number of cores
+       */
+      ImageProcess(QString folder, int framerate, int numBuffers = 8,
+                   int numThreads = 0);
+      /** \brief writes all pending frames before returning */
       ~ImageProcess();
-      void addImage(myImage image);
+
+      /** \brief returns a free buffer of the pool or NULL if there is none */
+      myImage* getFreeImage(void);
+      /** \brief (re)allocates the buffers of an image for the given size */
+      void resizeImage(myImage *image, int width, int height);
+      /** \brief queues a filled image for conversion and writing */
+      void addImage(myImage *image);
+      /** \brief returns an unused image to the pool */
+      void releaseImage(myImage *image);
+      /** \brief counts frames that could not be captured */
+      void dropImage(unsigned long count = 1);
+
+      unsigned long getWritten(void);
+      unsigned long getDropped(void);
       int getState(void) {return state;}
       int getPercent(void) {return percent;}
 
+      /**
+       * Converts BGRA rows bottom up into BGR rows top down. Uses SSSE3 or
+       * NEON if the compiler targets it.
+       */
+      static void convertImage(const unsigned char *src, unsigned char *dest,
+                               int width, int height, int destStride);
+
     protected:
       void run(void);
-  
+
     private:
+      friend class ImageConverter;
+
+      enum ImageState {
+        IMAGE_FREE = 0,
+        IMAGE_GRABBING,
+        IMAGE_GRABBED,
+        IMAGE_CONVERTING,
+        IMAGE_CONVERTED
+      };
+
+      void runConverter(void);
+
       QMutex listMutex;
+      QWaitCondition convertCondition, writeCondition;
       std::vector<myImage> imageList;
+      std::vector<ImageConverter*> converters;
       bool processing;
       QString folder, file;
-      int imageCount;
+      unsigned long frameCount, nextFrame;
+      unsigned long written, dropped;
       int state;
       int percent;
       int file_count;
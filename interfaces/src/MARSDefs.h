@@ -71,6 +71,16 @@ namespace mars {
       NUMBER_OF_NODE_TYPES
     };
 
+    // Definition of the collision proxies that replace the trimesh of a
+    // mesh node
+    enum CollisionProxy {
+      COLLISION_PROXY_NONE=0,
+      COLLISION_PROXY_HULLS,
+      COLLISION_PROXY_BOXES,
+      COLLISION_PROXY_CAPSULES,
+      NUMBER_OF_COLLISION_PROXIES
+    };
+
     // Definition of Joint Types
     enum JointType {
       JOINT_TYPE_UNDEFINED=0,
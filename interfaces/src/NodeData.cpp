@@ -68,6 +68,14 @@ namespace mars {
         "empty"
       };
 
+    //synchronize this list with the enum CollisionProxy in MARSDefs.h
+    static const char* sCollisionProxyNames[NUMBER_OF_COLLISION_PROXIES] = {
+        "none",
+        "hulls",
+        "boxes",
+        "capsules"
+      };
+
     const char* NodeData::toString(const NodeType &type) {
       if (type > 0 && type < NUMBER_OF_NODE_TYPES) {
         return sTypeNames[type];
@@ -262,6 +270,29 @@ namespace mars {
       GET_VALUE("angular_damping", angular_damping, Double);
       GET_VALUE("angular_low", angular_low, Double);
 
+      GET_VALUE("sleep", sleep, Bool);
+      GET_VALUE("sleep_linear_threshold", sleep_linear_threshold, Double);
+      GET_VALUE("sleep_angular_threshold", sleep_angular_threshold, Double);
+      GET_VALUE("sleep_time", sleep_time, Double);
+
+      if((it = config->find("collision_proxy")) != config->end()) {
+        std::string proxyName = trim((std::string)it->second);
+        int proxy;
+        for(proxy = 0; proxy < NUMBER_OF_COLLISION_PROXIES; ++proxy) {
+          if(proxyName == sCollisionProxyNames[proxy]) break;
+        }
+        if(proxy < NUMBER_OF_COLLISION_PROXIES) {
+          collision_proxy = (CollisionProxy)proxy;
+        }
+        else {
+          LOG_ERROR("unknown collision_proxy \"%s\" for node: %s",
+                    proxyName.c_str(), name.c_str());
+        }
+      }
+      GET_VALUE("proxy_max_hulls", proxy_max_hulls, Int);
+      GET_VALUE("proxy_max_vertices", proxy_max_vertices, Int);
+      GET_VALUE("proxy_concavity", proxy_concavity, Double);
+
       GET_VALUE("shadow_id", shadow_id, Int);
       GET_VALUE("shadowcaster", isShadowCaster, Bool);
       GET_VALUE("shadowreceiver", isShadowReceiver, Bool);
@@ -365,6 +396,19 @@ namespace mars {
       SET_VALUE("angular_damping", angular_damping, writeDefaults);
       SET_VALUE("angular_low", angular_low, writeDefaults);
 
+      SET_VALUE("sleep", sleep, writeDefaults);
+      SET_VALUE("sleep_linear_threshold", sleep_linear_threshold, writeDefaults);
+      SET_VALUE("sleep_angular_threshold", sleep_angular_threshold, writeDefaults);
+      SET_VALUE("sleep_time", sleep_time, writeDefaults);
+
+      if(writeDefaults || collision_proxy != defaultNode.collision_proxy) {
+        std::string tmp = sCollisionProxyNames[collision_proxy];
+        (*config)["collision_proxy"] = tmp;
+      }
+      SET_VALUE("proxy_max_hulls", proxy_max_hulls, writeDefaults);
+      SET_VALUE("proxy_max_vertices", proxy_max_vertices, writeDefaults);
+      SET_VALUE("proxy_concavity", proxy_concavity, writeDefaults);
+
       SET_VALUE("shadow_id", shadow_id, writeDefaults);
       SET_VALUE("shadowcaster", isShadowCaster, writeDefaults);
       SET_VALUE("shadowreceiver", isShadowReceiver, writeDefaults);
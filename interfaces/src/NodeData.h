@@ -28,9 +28,11 @@
 
 #include <mars/utils/Vector.h>
 #include <mars/utils/Quaternion.h>
+#include <mars/utils/ConvexDecomposition.h>
 
 #include <string>
 #include <map>
+#include <vector>
 
 
 namespace mars {
@@ -88,6 +90,15 @@ namespace mars {
         angular_damping = 0;
         angular_treshold = 0;
         angular_low  = 0;
+        sleep = false;
+        sleep_linear_threshold = 0.01;
+        sleep_angular_threshold = 0.01;
+        sleep_time = 0.5;
+        collision_proxy = COLLISION_PROXY_NONE;
+        proxy_max_hulls = 16;
+        proxy_max_vertices = 32;
+        proxy_concavity = 0.02;
+        proxy_hulls.clear();
         shadow_id = 0;
         isShadowCaster = true;
         isShadowReceiver = true;
@@ -340,7 +351,9 @@ namespace mars {
       /**
        * Generally the inertia of the physical body is calculated by the physicMode
        * and the mass of a node. In case of a mesh the inertia is calculated for
-       * a box with the size given by NodeData::extent. If this boolean is set to
+       * a box with the size given by NodeData::extent, or from the closed
+       * collision mesh of a versioned .bobj file, which then also sets
+       * NodeData::mass and this flag. If this boolean is set to
        * \c true, the inertia array (NodeData::inertia) is used instead.
        * \verbatim Default value: false \endverbatim
        */
@@ -372,6 +385,43 @@ namespace mars {
       sReal angular_damping;
       sReal angular_treshold;
       sReal angular_low;
+
+      /**
+       * If sleeping is enabled in the simulation and this value is \c true,
+       * the physical body of the node is disabled as soon as its linear
+       * velocity stays below NodeData::sleep_linear_threshold (in m/s) and
+       * its angular velocity below NodeData::sleep_angular_threshold (in
+       * rad/s) for NodeData::sleep_time seconds. The body is enabled again
+       * on contact with an active body or if it is moved or a force is
+       * applied. \verbatim Default value: false, 0.01, 0.01, 0.5 \endverbatim
+       */
+      bool sleep;
+      sReal sleep_linear_threshold;
+      sReal sleep_angular_threshold;
+      sReal sleep_time;
+
+      /**
+       * Replaces the trimesh of a movable mesh node by an approximate convex
+       * decomposition of the mesh ("hulls") or by one box or capsule fitted
+       * to every hull ("boxes", "capsules"). The mesh is split until it has
+       * NodeData::proxy_max_hulls parts or the empty space in the hull of
+       * every part is below NodeData::proxy_concavity times the volume of
+       * the hull of the whole mesh. Every hull
+       * keeps at most NodeData::proxy_max_vertices vertices. Static mesh
+       * nodes keep their trimesh. Convex hulls only collide with trimeshes
+       * and cylinders if ODE is built with libccd.
+       * \verbatim Default value: COLLISION_PROXY_NONE, 16, 32, 0.02 \endverbatim
+       */
+      CollisionProxy collision_proxy;
+      int proxy_max_hulls;
+      int proxy_max_vertices;
+      sReal proxy_concavity;
+      /**
+       * The hulls of the decomposition in the frame of NodeData::mesh. They
+       * are filled by the simulation from the proxy cache and not saved.
+       */
+      std::vector<utils::ConvexHull> proxy_hulls;
+
       int shadow_id;
 
       bool isShadowCaster;
@@ -0,0 +1,95 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MARS_INTERFACES_STATE_BUFFER_H
+#define MARS_INTERFACES_STATE_BUFFER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "StateBuffer.h"
+#endif
+
+#include <vector>
+#include <cstring>
+
+namespace mars {
+
+  namespace interfaces {
+
+    /**
+     * \brief A byte buffer used to take in-memory snapshots of the
+     *        simulation state.
+     *
+     * The objects of the simulation write their internal state in a fixed
+     * order via write() and read it back in the same order via read().
+     * The values are copied bytewise, thus only plain data types (including
+     * utils::Vector and utils::Quaternion) may be stored and a snapshot is
+     * only valid within the process that created it. A read beyond the end
+     * of the buffer fails and marks the buffer as bad.
+     */
+    class StateBuffer {
+    public:
+      StateBuffer() : readPos(0), valid(true) {}
+      explicit StateBuffer(const std::vector<char> &data) :
+        data(data), readPos(0), valid(true) {}
+
+      template<typename T>
+      void write(const T &value) {
+        writeRaw(&value, sizeof(T));
+      }
+
+      template<typename T>
+      bool read(T *value) {
+        return readRaw(value, sizeof(T));
+      }
+
+      void writeRaw(const void *src, size_t size) {
+        size_t pos = data.size();
+        data.resize(pos + size);
+        if(size) memcpy(&data[pos], src, size);
+      }
+
+      bool readRaw(void *dst, size_t size) {
+        if(!valid || readPos + size > data.size()) {
+          valid = false;
+          return false;
+        }
+        if(size) memcpy(dst, &data[readPos], size);
+        readPos += size;
+        return true;
+      }
+
+      /** \brief returns \c false if a read failed on this buffer */
+      bool good() const {return valid;}
+      bool atEnd() const {return readPos == data.size();}
+      void rewind() {readPos = 0; valid = true;}
+      void clear() {data.clear(); rewind();}
+
+      std::vector<char> data;
+
+    private:
+      size_t readPos;
+      bool valid;
+    }; // end of class StateBuffer
+
+  } // end of namespace interfaces
+
+} // end of namespace mars
+
+#endif /* MARS_INTERFACES_STATE_BUFFER_H */
@@ -35,6 +35,7 @@
 #include "GraphicsCameraInterface.h"
 #include "GraphicsEventInterface.h"
 #include <mars/utils/Color.h>
+#include <cstddef>
 
 namespace osg{
     class Group;
@@ -68,6 +69,15 @@ namespace mars {
        * */
       virtual void getImageData(char *buffer, int &width, int &height) = 0;
       virtual void getImageData(void **data, int &width, int &height) = 0;
+      /**
+       * Copies the image data into a buffer of \a size bytes without
+       * allocating memory. If the buffer is too small nothing is copied,
+       * but width and height are still set to the size of the image.
+       *
+       * @return \c true if the image was copied
+       * */
+      virtual bool getImageData(char *buffer, size_t size,
+                                int &width, int &height) = 0;
       
       /**
        * This function copies the depth image in the given buffer.
@@ -87,6 +97,19 @@ namespace mars {
       virtual void setHUDViewOffsets(double x1, double y1,
                                      double x2, double y2) = 0;
 
+      /**
+       * \brief Scales the distances used to select the levels of detail.
+       *
+       * Values above 1 switch to coarser levels earlier, e.g. for camera
+       * sensors that do not need the full detail.
+       */
+      virtual void setLODScale(double scale) = 0;
+      /**
+       * \brief Culls objects that are smaller than \a pixelSize on the
+       *        screen; 0 disables the small feature culling.
+       */
+      virtual void setSmallFeatureCulling(double pixelSize) = 0;
+
     }; // end of class GraphicsWindowInterface
 
   } // end of namespace interfaces
@@ -26,6 +26,7 @@
 #endif
 
 #include "core_objects_exchange.h"
+#include "StateBuffer.h"
 
 #include <configmaps/ConfigData.h>
 #include <mars/utils/Quaternion.h>
@@ -104,6 +105,15 @@ namespace mars {
         return configmaps::ConfigMap();
       }
 
+      /**
+       * \brief Stores the internal state of the sensor. Sensors that only
+       *        sample the current state of the simulation don't need to
+       *        implement the methods. Sensors that accumulate values over
+       *        time (e.g. averaging or scanning sensors) have to.
+       */
+      virtual void saveState(StateBuffer *state) const {}
+      virtual bool restoreState(StateBuffer *state) {return true;}
+
       //Should be proteted due to compability of old code currently direct accessable
       unsigned long id;
       std::string name; //Todo naming bei mehreren robotern
@@ -282,6 +292,34 @@ namespace mars {
 
     }; // end of class BaseGridIntersectionSensor
 
+
+    /**
+     * \brief Receives the points of a scanning sensor as soon as they are
+     *        measured, e.g. for visualization.
+     */
+    class PointCloudReceiver {
+    public:
+      virtual ~PointCloudReceiver() {}
+
+      /**
+       * Called from the simulation thread. The buffers belong to the sensor
+       * and are only valid during the call.
+       * \param points \a numPoints times x, y, z in the world frame
+       * \param intensities one value per point (e.g. the measured distance)
+       * \param time the simulation time of the measurement in ms
+       */
+      virtual void receivePoints(unsigned long sensorId, const float *points,
+                                 const float *intensities, size_t numPoints,
+                                 double time) = 0;
+    }; // end of class PointCloudReceiver
+
+    class PointCloudSource {
+    public:
+      virtual ~PointCloudSource() {}
+      virtual void addPointCloudReceiver(PointCloudReceiver *receiver) = 0;
+      virtual void removePointCloudReceiver(PointCloudReceiver *receiver) = 0;
+    }; // end of class PointCloudSource
+
   } // end of namespace interfaces
 
 } // end of namespace mars
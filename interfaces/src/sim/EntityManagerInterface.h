@@ -50,6 +50,9 @@ namespace mars {
       virtual const std::map<unsigned long, sim::SimEntity*>* subscribeToEntityCreation(
         EntitySubscriberInterface* newsub) = 0;
 
+      /**removes a subscriber, e.g. before it is destroyed*/
+      virtual void unsubscribeFromEntityCreation(EntitySubscriberInterface* sub) = 0;
+
       /**creates a new entity with the given name and returns its id*/
       virtual unsigned long addEntity(const std::string &name) = 0;
 
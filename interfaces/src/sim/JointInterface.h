@@ -76,6 +76,8 @@ namespace mars {
       virtual void setHighStop(sReal lowStop) = 0;
       virtual void setLowStop2(sReal lowStop) = 0;
       virtual void setHighStop2(sReal lowStop) = 0;
+      virtual void saveState(StateBuffer *state) const = 0;
+      virtual bool restoreState(StateBuffer *state) = 0;
     };
 
   } // end of namespace interfaces
@@ -36,6 +36,7 @@
 
 #include "../JointData.h"
 #include "../core_objects_exchange.h"
+#include "../StateBuffer.h"
 
 namespace mars {
 
@@ -114,6 +115,12 @@ namespace mars {
        */
       virtual std::vector<sim::SimJoint*> getSimJoints(void) = 0;
 
+      /**
+       * \brief Returns the joints that are attached to the node with id
+       *        \a node_id, ordered by their id.
+       */
+      virtual std::vector<sim::SimJoint*> getSimJointsOfNode(unsigned long node_id) = 0;
+
       /**
        * \brief Reattaches the joints that are connected to the node 
        *        with id \a node_id.
@@ -208,6 +215,8 @@ namespace mars {
                                 interfaces::sReal highStop2) = 0;
       virtual void edit(interfaces::JointId id, const std::string &key,
                         const std::string &value) = 0;
+      virtual void saveState(StateBuffer *state) = 0;
+      virtual bool restoreState(StateBuffer *state) = 0;
     };
 
   } // end of namespace interfaces
@@ -37,6 +37,7 @@
 #endif
 
 #include "../MotorData.h"
+#include "../StateBuffer.h"
 
 namespace mars {
 
@@ -324,6 +325,13 @@ namespace mars {
       virtual void connectMimics() = 0;
       virtual void edit(MotorId id, const std::string &key,
                         const std::string &value) = 0;
+
+      /**
+       * \brief Stores the controller state (e.g. the integrated error) of
+       *        all motors into \a state.
+       */
+      virtual void saveState(StateBuffer *state) = 0;
+      virtual bool restoreState(StateBuffer *state) = 0;
     }; // class MotorManagerInterface
 
   } // end of namespace interfaces
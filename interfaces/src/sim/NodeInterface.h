@@ -81,6 +81,18 @@ namespace mars {
       virtual void getMass(sReal *mass, sReal *inertia=0) const = 0;
       virtual const utils::Vector getContactForce(void) const = 0;
       virtual sReal getCollisionDepth(void) const = 0;
+      /**
+       * \brief Returns \c true if the body of the node is disabled because
+       *        it came to rest.
+       */
+      virtual bool isSleeping(void) const = 0;
+      /**
+       * \brief Stores the dynamic state of the node. The body is set to the
+       *        stored state while saving, so that a restore reproduces the
+       *        exact same values.
+       */
+      virtual void saveState(StateBuffer *state) = 0;
+      virtual bool restoreState(StateBuffer *state) = 0;
     };
 
   } // end of namespace interfaces
@@ -38,6 +38,7 @@
 #include "../sensor_bases.h"
 #include "../NodeData.h"
 #include "../nodeState.h"
+#include "../StateBuffer.h"
 
 #include <mars/utils/Vector.h>
 #include <mars/utils/Quaternion.h>
@@ -363,6 +364,20 @@ namespace mars {
        */
       virtual const utils::Quaternion getRotation(NodeId id) const = 0;
 
+      /**
+       * \brief Returns the positions and orientations of several nodes while
+       * locking the node manager only once.
+       *
+       * \param ids The ids of the nodes.
+       * \param positions Is resized to the number of \a ids and filled with
+       *                  the positions. Unknown nodes get a zero position.
+       * \param rotations Is resized to the number of \a ids and filled with
+       *                  the orientations. Unknown nodes get the identity.
+       */
+      virtual void getPoses(const std::vector<NodeId> &ids,
+                            std::vector<utils::Vector> *positions,
+                            std::vector<utils::Quaternion> *rotations) const = 0;
+
       /**
        * \brief Sets the current orientation of a node.
        *
@@ -548,6 +563,13 @@ namespace mars {
        */
       virtual void updateDynamicNodes(sReal calc_ms, bool physics_thread=true) = 0;
 
+      /**
+       * \brief Returns the number of dynamic nodes and how many of them were
+       *        sleeping in the last call of updateDynamicNodes.
+       */
+      virtual void getSleepingStats(unsigned long *numSleeping,
+                                    unsigned long *numDynamic) const = 0;
+
       /**
        * \brief This function destroys all nodes within the simulation.
        *
@@ -791,6 +813,16 @@ namespace mars {
        */
       virtual void edit(NodeId id, const std::string &key,
                         const std::string &value) = 0;
+
+      /** Stores the dynamic state of all nodes into \a state.
+       * \see SimulatorInterface::saveSnapshot
+       */
+      virtual void saveState(StateBuffer *state) = 0;
+
+      /** Restores the dynamic state of all nodes from \a state.
+       * \return \c false if the stored nodes do not match the current scene.
+       */
+      virtual bool restoreState(StateBuffer *state) = 0;
     };
 
   } // end of namespace interfaces
@@ -32,6 +32,7 @@
 #endif
 
 #include "../MARSDefs.h"
+#include "../StateBuffer.h"
 
 #include <mars/utils/Vector.h>
 
@@ -49,6 +50,28 @@ namespace mars {
       PHYSICS_UNKNOWN,
     };
 
+    /**
+     * \brief The collision space used to find the geom pairs that have to
+     *        be tested for contacts.
+     */
+    enum Broadphase {
+      BROADPHASE_HASH = 0, /**< multi resolution hash grid */
+      BROADPHASE_SAP,      /**< sweep and prune */
+      BROADPHASE_QUADTREE, /**< quadtree over the x-y extent of the scene */
+      BROADPHASE_SIMPLE,   /**< tests all pairs, for debugging */
+    };
+
+    /**
+     * \brief Counters of the collision detection of the last step.
+     */
+    struct ContactCacheStats {
+      unsigned long broadphasePairs; /**< pairs with overlapping AABBs */
+      unsigned long narrowPhaseCalls; /**< geom pairs tested via dCollide */
+      unsigned long narrowPhaseSkipped; /**< pairs served from the cache */
+      unsigned long cachedPairs; /**< pairs in the cache after the step */
+      unsigned long contacts; /**< contact joints created in the step */
+    };
+
     class PhysicsInterface {
 
     public:
@@ -58,6 +81,63 @@ namespace mars {
       bool fast_step;
       bool draw_contact_points;
       sReal world_cfm, world_erp;
+      /**
+       * If \c true, the contacts of a geom pair are reused as long as the
+       * relative transform of the pair changes less than
+       * \c contact_cache_tolerance (in m and rad) since the last collision
+       * test of the pair.
+       */
+      bool contact_cache;
+      sReal contact_cache_tolerance;
+      /**
+       * If \c true, the bodies of nodes with NodeData::sleep set are
+       * disabled when they come to rest.
+       */
+      bool sleeping;
+      /**
+       * The broadphase can be changed at any time, the geoms are moved
+       * into the new collision space with the next step.
+       */
+      Broadphase broadphase;
+      /**
+       * Number of threads running the narrow phase. With more than one
+       * thread the pairs of the broadphase are collected first and
+       * collided in parallel. The contacts are created in the same order
+       * as with a single thread. All pairs of one heightfield are collided
+       * by one thread, as are all trimesh pairs if ODE lacks thread local
+       * collision data.
+       */
+      int collision_threads;
+      /**
+       * Number of threads solving the independent islands of the world.
+       * Since every island is solved on its own, the result does not
+       * depend on the number of threads. Only used for the normal step:
+       * the quick step reorders the constraints with ODE's global random
+       * generator, which would make the result depend on the order in
+       * which the islands are solved.
+       */
+      int island_threads;
+      /**
+       * If \c true, stepTheWorld measures the time of the collision
+       * detection and stores it in \c collision_ms.
+       */
+      bool profiling;
+      double collision_ms;
+      /**
+       * If \c true, the static meshes that share their contact parameters
+       * are merged into one trimesh and the static primitives are grouped
+       * in one sub-space before the next step (see bakeStaticGeoms). A
+       * change of a static node, saveState and restoreState split them
+       * again; they are merged again before the following step.
+       *
+       * Static boxes and the other primitives are not triangulated. A
+       * baked box would only be a shell of triangles, so an object that
+       * penetrates it deeper than the contact depth, e.g. after a large
+       * step, would fall inside instead of being pushed out. They keep
+       * their colliders, and the broadphase sees their sub-space as one
+       * geom.
+       */
+      bool bake_static_geoms;
 
       virtual ~PhysicsInterface() {}
       virtual void initTheWorld(void) = 0;
@@ -67,6 +147,23 @@ namespace mars {
       virtual const utils::Vector getCenterOfMass(const std::vector<NodeInterface*> &nodes) const = 0;
       virtual int checkCollisions(void) = 0;
       virtual sReal getVectorCollision(const utils::Vector &pos, const utils::Vector &ray) const = 0;
+      /**
+       * \brief Stores the state of the world that is not owned by a node or
+       *        joint, e.g. the random seed and the collision order.
+       *        Has to be called after the nodes stored their state.
+       */
+      virtual void saveState(StateBuffer *state) = 0;
+      virtual bool restoreState(StateBuffer *state) = 0;
+      virtual ContactCacheStats getContactCacheStats(void) const = 0;
+      /**
+       * \brief Merges the static meshes into one trimesh per set of
+       *        contact parameters and groups the static primitives in one
+       *        sub-space. The contacts with the merged mesh are still
+       *        reported for the original nodes. The primitives stay
+       *        separate geoms (see bake_static_geoms).
+       * \return The number of merged or grouped nodes.
+       */
+      virtual int bakeStaticGeoms(void) = 0;
     };
 
   } // end of namespace interfaces
@@ -35,12 +35,45 @@
 #include <mars/interfaces/MARSDefs.h> // for sReal
 
 #include <string>
+#include <set>
 
 namespace mars {
   namespace interfaces {
 
     class ControlCenter;
 
+    /**
+     * \brief The thread in which the simulator calls PluginInterface::update.
+     */
+    enum PluginThreadMode {
+      /** in the physics thread, in the order the plugins were added */
+      PLUGIN_THREAD_PHYSICS = 0,
+      /**
+       * concurrently with the other parallel plugins after the physics
+       * step; the next step starts when all of them returned
+       */
+      PLUGIN_THREAD_PARALLEL,
+      /**
+       * in an own thread that never blocks the physics; the plugin has to
+       * lock the data it shares with the simulation itself
+       */
+      PLUGIN_THREAD_ASYNC
+    };
+
+    struct PluginUpdatePolicy {
+      PluginUpdatePolicy() : thread(PLUGIN_THREAD_PHYSICS), period_ms(0) {}
+
+      PluginThreadMode thread;
+      /** simulation time between two updates, 0 to update every step */
+      sReal period_ms;
+      /**
+       * The data a parallel plugin reads and writes in update, e.g.
+       * "motors" or "controllers". Parallel plugins that write data
+       * another one reads or writes are run one after the other.
+       */
+      std::set<std::string> reads, writes;
+    };
+
     /**
      * The interface to load plugin dynamically into the simulation
      *
@@ -54,6 +87,14 @@ namespace mars {
       virtual void init(void) = 0;
       virtual void handleError(void) {};
       virtual void getSomeData(void* data) {(void)data;};
+      /**
+       * \brief Queried once when the plugin is added to the simulation.
+       *        The default updates the plugin every step in the physics
+       *        thread.
+       */
+      virtual PluginUpdatePolicy getUpdatePolicy(void) const {
+        return PluginUpdatePolicy();
+      }
 
     protected:
       ControlCenter *control;
@@ -197,6 +197,12 @@ namespace mars {
                                              BaseConfig *config,
                                              bool reload=false)=0;
 
+      /**
+       * \brief Stores the internal state of all sensors into \a state.
+       * \see BaseSensor::saveState
+       */
+      virtual void saveState(StateBuffer *state) = 0;
+      virtual bool restoreState(StateBuffer *state) = 0;
 
     }; // class SensorManagerInterface
 
@@ -47,6 +47,42 @@ namespace mars {
 
   namespace interfaces {
 
+    /**
+     * \brief The parts of Simulator::step that are timed separately.
+     */
+    enum StepStage {
+      STEP_STAGE_PRE_PHYSICS = 0, /**< mars_sim/prePhysicsUpdate receivers */
+      STEP_STAGE_COLLISION,       /**< broad and narrow phase */
+      STEP_STAGE_SOLVER,          /**< the rest of stepTheWorld */
+      STEP_STAGE_NODES,           /**< updateDynamicNodes incl. node sensors */
+      STEP_STAGE_JOINTS,
+      STEP_STAGE_MOTORS,
+      STEP_STAGE_CONTROLLERS,
+      STEP_STAGE_DATA_BROKER,     /**< simTime push and timed receivers */
+      STEP_STAGE_PLUGINS,
+      STEP_STAGE_POST_PHYSICS,    /**< mars_sim/postPhysicsUpdate receivers */
+      NUMBER_OF_STEP_STAGES
+    };
+
+    /**
+     * \brief Wall time spent in the stages of the steps since the last
+     *        reset of the profile.
+     */
+    struct StepProfile {
+      unsigned long steps;
+      double totalMs;
+      double stageMs[NUMBER_OF_STEP_STAGES];
+
+      static const char* stageName(int stage) {
+        static const char *names[NUMBER_OF_STEP_STAGES] = {
+          "pre_physics", "collision", "solver", "nodes", "joints", "motors",
+          "controllers", "data_broker", "plugins", "post_physics"
+        };
+        return (stage >= 0 && stage < NUMBER_OF_STEP_STAGES) ? names[stage]
+                                                              : "unknown";
+      }
+    };
+
     class SimulatorInterface {
     public:
 
@@ -59,6 +95,23 @@ namespace mars {
       virtual void StartSimulation() = 0;
       virtual void StopSimulation() = 0;
       virtual void resetSim(bool resetGraphics=true) = 0;
+      /**
+       * \brief Stores the dynamic state of the current scene (sim time,
+       *        body states, joint feedback, motor controller and sensor
+       *        state) into \a snapshot.
+       *
+       * In contrast to resetSim no objects are destroyed or created when
+       * a snapshot is restored. Stepping the simulation after
+       * restoreSnapshot reproduces the trajectory that followed the
+       * saveSnapshot call bit by bit as long as the scene is not changed
+       * in between. A snapshot can only be restored within the same
+       * process and the same scene.
+       */
+      virtual void saveSnapshot(std::vector<char> *snapshot) = 0;
+      /**
+       * \return \c false if the snapshot does not match the current scene.
+       */
+      virtual bool restoreSnapshot(const std::vector<char> &snapshot) = 0;
       virtual bool isSimRunning() const = 0;
       virtual bool startStopTrigger() = 0;
       virtual void singleStep(void) = 0;
@@ -104,6 +157,11 @@ namespace mars {
       virtual void finishedDraw(void) = 0;
       virtual void allowDraw(void) = 0;
       virtual bool getAllowDraw(void) = 0;
+      /**
+       * \brief Waits until drawing is allowed or \a timeout_ms elapsed.
+       * \return \c true if drawing is allowed
+       */
+      virtual bool waitForDraw(unsigned long timeout_ms) = 0;
       virtual bool getSyncGraphics(void) = 0;
 
       //plugins
@@ -117,6 +175,15 @@ namespace mars {
        */
       virtual unsigned long getTime() = 0;
 
+      /**
+       * \brief Enables timing of the stages of each step. The clock is
+       *        only read while profiling is enabled.
+       */
+      virtual void setStepProfiling(bool enable) = 0;
+      /** \brief copies the accumulated timings into \a profile */
+      virtual void getStepProfile(StepProfile *profile) = 0;
+      virtual void resetStepProfile(void) = 0;
+
     };
 
 
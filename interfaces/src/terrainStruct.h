@@ -26,6 +26,10 @@
 
 namespace mars {
 
+  namespace utils {
+    class TiledHeightMap;
+  }
+
   namespace interfaces {
 
     /**
@@ -39,7 +43,8 @@ namespace mars {
           texScaleX(0.1),
           texScaleY(0.1),
           pixelData(NULL),
-          mesh(0) {}
+          mesh(0),
+          heightMap(NULL) {}
 
       std::string name; //the joints name
       std::string srcname;
@@ -52,6 +57,9 @@ namespace mars {
       double texScaleX, texScaleY; // texture scaling - a value of 0 will fit the complete terrain
       double *pixelData;
       int mesh;
+      // scaled heights shared by the physics and the graphics; created by
+      // the NodeManager and released by the SimNode
+      utils::TiledHeightMap *heightMap;
 
     }; // end of struct terrainStruct
 
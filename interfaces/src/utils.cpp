@@ -28,11 +28,16 @@
 
 #include "utils.h"
 
+#include <mars/utils/BinaryMesh.h>
+#include <mars/utils/ConvexDecomposition.h>
+#include <mars/utils/mathUtils.h>
+
 #include <cstdio>
 #include <cmath>
 #include <sstream>
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 namespace mars {
   namespace interfaces {
@@ -105,7 +110,174 @@ namespace mars {
                 << text << "\"." << std::endl;
       return JOINT_TYPE_UNDEFINED;
     }
-    
+
+    /**
+     * Sets the mass and inertia of \a node from the mass properties of the
+     * collision mesh, scaled like its vertices. ODE keeps the center of
+     * mass of a body at the body origin, so the inertia is taken around
+     * the node origin like the one of the bounding box used for other
+     * meshes.
+     */
+    static void setMassFromBinaryMesh(const BinaryMeshHeader *header,
+                                      const Vector &scale, NodeData *node) {
+      // the volume scales with the product of the axis scales and the
+      // second moments additionally with the scales of their two axes
+      double det = scale.x()*scale.y()*scale.z();
+      double volume = header->volume*det;
+      if(volume <= 0) return;
+
+      const float *in = header->inertia;
+      double halfTrace = (in[0] + in[1] + in[2])*0.5;
+      double cov[3][3];
+      for(int j=0; j<3; ++j) cov[j][j] = halfTrace - in[j];
+      cov[0][1] = cov[1][0] = -in[3];
+      cov[0][2] = cov[2][0] = -in[4];
+      cov[1][2] = cov[2][1] = -in[5];
+
+      double mass = node->density > 0 ? node->density*volume : node->mass;
+      double density = mass/volume;
+      Vector com;
+      for(int k=0; k<3; ++k) {
+        com[k] = (header->centerOfMass[k] - node->pivot[k])*scale[k];
+      }
+      double trace = 0;
+      for(int j=0; j<3; ++j) {
+        for(int l=0; l<3; ++l) {
+          cov[j][l] = (cov[j][l]*det*scale[j]*scale[l]*density +
+                       mass*com[j]*com[l]);
+        }
+        trace += cov[j][j];
+      }
+      for(int j=0; j<3; ++j) {
+        for(int l=0; l<3; ++l) {
+          node->inertia[j][l] = (j == l ? trace : 0) - cov[j][l];
+        }
+      }
+      node->mass = mass;
+      node->inertia_set = true;
+    }
+
+    bool getPhysicsFromBinaryMesh(NodeData *node) {
+      BinaryMesh file;
+      if(!file.open(node->filename)) return false;
+      const BinaryMeshHeader *header = file.getHeader();
+      const BinaryMeshPart *parts = file.getParts();
+      const float *vertices = file.getCollisionVertices();
+      const uint32_t *indices = file.getCollisionIndices();
+
+      bool named = false;
+      for(uint32_t i=0; i<header->numParts; ++i) {
+        if(node->origName == parts[i].name) named = true;
+      }
+
+      // collect the triangles and compact the used vertices
+      vector<int> remap(header->numCollisionVertices, -1);
+      vector<uint32_t> used;
+      vector<int> triangles;
+      for(uint32_t i=0; i<header->numParts; ++i) {
+        if(named && node->origName != parts[i].name) continue;
+        for(uint32_t k=0; k<parts[i].numCollisionIndices; ++k) {
+          uint32_t v = indices[parts[i].firstCollisionIndex+k];
+          if(remap[v] < 0) {
+            remap[v] = (int)used.size();
+            used.push_back(v);
+          }
+          triangles.push_back(remap[v]);
+        }
+      }
+
+      Vector bbMin(0, 0, 0), bbMax(0, 0, 0);
+      for(size_t i=0; i<used.size(); ++i) {
+        Vector v(vertices[used[i]*3], vertices[used[i]*3+1],
+                 vertices[used[i]*3+2]);
+        if(i == 0) bbMin = bbMax = v;
+        bbMin = bbMin.cwiseMin(v);
+        bbMax = bbMax.cwiseMax(v);
+      }
+      Vector ex = bbMax - bbMin;
+
+      if (node->map.find("loadSizeFromMesh") != node->map.end()) {
+        if (node->map["loadSizeFromMesh"]) {
+          Vector physicalScale;
+          vectorFromConfigItem(&(node->map["physicalScale"][0]), &physicalScale);
+          node->ext = Vector(ex.x()*physicalScale.x(), ex.y()*physicalScale.y(),
+                             ex.z()*physicalScale.z());
+        }
+      }
+
+      Vector scale(1, 1, 1);
+      for(int k=0; k<3; ++k) {
+        if(ex[k] != 0) scale[k] = node->ext[k] / ex[k];
+      }
+
+      node->mesh.setZero();
+      if(!used.empty()) {
+        node->mesh.vertices = new mydVector3[used.size()];
+      }
+      if(!triangles.empty()) {
+        node->mesh.indices = new int[triangles.size()];
+      }
+      for(size_t i=0; i<used.size(); ++i) {
+        for(int k=0; k<3; ++k) {
+          node->mesh.vertices[i][k] = ((vertices[used[i]*3+k] - node->pivot[k]) *
+                                       scale[k]);
+        }
+      }
+      for(size_t i=0; i<triangles.size(); ++i) {
+        node->mesh.indices[i] = triangles[i];
+      }
+      node->mesh.vertexcount = (int)used.size();
+      node->mesh.indexcount = (int)triangles.size();
+
+      // the mass properties are stored for the whole file only
+      if(!named && !node->inertia_set && header->volume > 0 &&
+         (node->density > 0 || node->mass > 0)) {
+        setMassFromBinaryMesh(header, scale, node);
+      }
+      return true;
+    }
+
+    bool getCollisionProxies(NodeData *node, const std::string &cacheDir) {
+      node->proxy_hulls.clear();
+      if(node->collision_proxy == COLLISION_PROXY_NONE) return true;
+
+      vector<double> positions(node->mesh.vertexcount*3);
+      vector<uint32_t> indices(node->mesh.indexcount);
+      for(int i=0; i<node->mesh.vertexcount; ++i) {
+        for(int k=0; k<3; ++k) {
+          positions[i*3+k] = node->mesh.vertices[i][k];
+        }
+      }
+      for(int i=0; i<node->mesh.indexcount; ++i) {
+        if(node->mesh.indices[i] < 0 ||
+           node->mesh.indices[i] >= node->mesh.vertexcount) {
+          return false;
+        }
+        indices[i] = (uint32_t)node->mesh.indices[i];
+      }
+
+      ConvexDecompositionParams params;
+      params.maxHulls = (unsigned int)std::max(node->proxy_max_hulls, 1);
+      params.maxHullVertices = (unsigned int)std::max(node->proxy_max_vertices,
+                                                      4);
+      params.concavity = node->proxy_concavity;
+      // the mesh is already scaled, so the hash changes with the size
+      uint64_t hash = hashConvexDecomposition(positions, indices, params);
+      char name[32];
+      snprintf(name, sizeof(name), "%016llx.hulls", (unsigned long long)hash);
+      string filename;
+      if(cacheDir.empty()) filename = node->filename + "." + name;
+      else filename = cacheDir + "/" + name;
+
+      if(readConvexHulls(filename, hash, &node->proxy_hulls)) return true;
+      if(!decomposeConvex(positions, indices, params, &node->proxy_hulls)) {
+        return false;
+      }
+      // the hulls are used even if the cache can not be written
+      writeConvexHulls(filename, hash, node->proxy_hulls);
+      return true;
+    }
+
   } // end of namespace interfaces
 
 } // end of namespace mars
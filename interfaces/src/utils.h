@@ -48,6 +48,26 @@ namespace mars {
      */
     const char* getJointTypeString(JointType type);
 
+    /**\brief Fills the collision mesh of a mesh node from a versioned
+     * .bobj file without loading the visual representation. Uses the parts
+     * named like \c origName or all parts if none matches and applies the
+     * scaling and pivot like the graphics do for other formats. If all
+     * parts are used and no inertia is given, the mass and inertia are
+     * taken from the mass properties of the file instead of the bounding
+     * box (see BinaryMeshHeader::volume).
+     * \return \c false if the file is not a versioned .bobj file.
+     */
+    bool getPhysicsFromBinaryMesh(NodeData *node);
+
+    /**\brief Fills NodeData::proxy_hulls of a mesh node that selects a
+     * collision proxy. The decomposition of NodeData::mesh is read from a
+     * cache file named by its hash or computed and written to it. The file
+     * is stored in \c cacheDir or next to the mesh file if \c cacheDir is
+     * empty.
+     * \return \c false if the mesh could not be decomposed.
+     */
+    bool getCollisionProxies(NodeData *node, const std::string &cacheDir);
+
   } // end of namespace interfaces
 
 } // namespace mars
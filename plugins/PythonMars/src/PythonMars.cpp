@@ -58,6 +58,9 @@ namespace mars {
       }
 
       PythonMars::~PythonMars() {
+        while(!sensorClouds.empty()) {
+          removeSensorCloud(sensorClouds.begin()->first);
+        }
         if(materialManager) libManager->releaseLibrary("osg_material_manager");
       }
 
@@ -307,6 +310,54 @@ namespace mars {
             }
           }
 
+          if(map.hasKey("SensorPointCloud") && map["SensorPointCloud"].isMap()) {
+            ConfigMap::iterator it = map["SensorPointCloud"].beginMap();
+            for(; it!=map["SensorPointCloud"].endMap(); ++it) {
+              const std::string &name = it->first;
+              ConfigMap &cmd = it->second;
+              if(cmd.hasKey("remove")) {
+                removeSensorCloud(name);
+                continue;
+              }
+              if(sensorClouds.find(name) == sensorClouds.end()) {
+                unsigned long id = control->sensors->getSensorID(name);
+                PointCloudSource *source;
+                source = dynamic_cast<PointCloudSource*>(control->sensors->getSimSensor(id));
+                if(!source) {
+                  LOG_ERROR("PythonMars: sensor \"%s\" provides no point cloud",
+                            name.c_str());
+                  continue;
+                }
+                SensorCloud *cloud = new SensorCloud;
+                cloud->sensorId = id;
+                cloud->stream = pf->createPointsStream();
+                control->graphics->addOSGNode(cloud->stream->getOSGNode());
+                source->addPointCloudReceiver(cloud);
+                sensorClouds[name] = cloud;
+              }
+              osg_points::PointsStream *stream = sensorClouds[name]->stream;
+              if(cmd.hasKey("fadeTime")) {
+                stream->setFadeTime((double)cmd["fadeTime"]);
+              }
+              if(cmd.hasKey("pointSize")) {
+                stream->setPointSize((double)cmd["pointSize"]);
+              }
+              if(cmd.hasKey("colorMode")) {
+                std::string mode = cmd["colorMode"];
+                if(mode == "intensity") {
+                  stream->setColorMode(osg_points::COLOR_BY_INTENSITY);
+                }
+                else {
+                  stream->setColorMode(osg_points::COLOR_BY_HEIGHT);
+                }
+              }
+              if(cmd.hasKey("colorRange")) {
+                stream->setColorRange((double)cmd["colorRange"][0],
+                                      (double)cmd["colorRange"][1]);
+              }
+            }
+          }
+
           if(map.hasKey("Lines")) {
             ConfigMap::iterator it = map["Lines"].beginMap();
             for(; it!=map["Lines"].endMap(); ++it) {
@@ -382,8 +433,30 @@ namespace mars {
         guiMapMutex.unlock();
       }
 
+      void PythonMars::removeSensorCloud(const std::string &name) {
+        std::map<std::string, SensorCloud*>::iterator it;
+        it = sensorClouds.find(name);
+        if(it == sensorClouds.end()) return;
+        SensorCloud *cloud = it->second;
+        PointCloudSource *source;
+        source = dynamic_cast<PointCloudSource*>(control->sensors->getSimSensor(cloud->sensorId));
+        if(source) source->removePointCloudReceiver(cloud);
+        if(control->graphics) {
+          control->graphics->removeOSGNode(cloud->stream->getOSGNode());
+        }
+        delete cloud->stream;
+        delete cloud;
+        sensorClouds.erase(it);
+      }
+
       void PythonMars::reset() {
         motorMap.clear();
+        nodeMap.clear();
+        sensorMap.clear();
+        // the sensors are recreated on reset
+        while(!sensorClouds.empty()) {
+          removeSensorCloud(sensorClouds.begin()->first);
+        }
         //plugin->reload();
       }
 
@@ -416,7 +489,16 @@ namespace mars {
             std::string name = (*it)["name"];
 
             if(type == "Node") {
-              unsigned long id = control->nodes->getID(name);
+              // the ids are resolved once, the requests are sent every step
+              unsigned long id;
+              std::map<std::string, unsigned long>::iterator nit;
+              nit = nodeMap.find(name);
+              if(nit != nodeMap.end()) {
+                id = nit->second;
+              }
+              else if((id = control->nodes->getID(name))) {
+                nodeMap[name] = id;
+              }
               Vector pos = control->nodes->getPosition(id);
               Quaternion rot = control->nodes->getRotation(id);
               sendMap["Nodes"][name]["pos"]["x"] = pos.x();
@@ -429,7 +511,15 @@ namespace mars {
             }
 
             if(type == "Sensor") {
-              unsigned long id = control->sensors->getSensorID(name);
+              unsigned long id;
+              std::map<std::string, unsigned long>::iterator sit;
+              sit = sensorMap.find(name);
+              if(sit != sensorMap.end()) {
+                id = sit->second;
+              }
+              else if((id = control->sensors->getSensorID(name))) {
+                sensorMap[name] = id;
+              }
               sReal *data;
               int num = control->sensors->getSensorData(id, &data);
               for(int i=0; i<num; ++i) {
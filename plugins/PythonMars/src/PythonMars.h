@@ -39,9 +39,11 @@
 #include <mars/interfaces/MARSDefs.h>
 #include <mars/data_broker/ReceiverInterface.h>
 #include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/interfaces/sensor_bases.h>
 #include <mars/utils/Mutex.h>
 #include <osg_points/Points.hpp>
 #include <osg_points/PointsFactory.hpp>
+#include <osg_points/PointsStream.hpp>
 #include <osg_lines/Lines.h>
 #include <osg_lines/LinesFactory.h>
 #include <mars/osg_material_manager/OsgMaterialManager.h>
@@ -65,6 +67,18 @@ namespace mars {
         std::vector<osg_lines::Vector> toAppend;
       };
 
+      // streams the points of a scanning sensor into a point cloud
+      struct SensorCloud : public interfaces::PointCloudReceiver {
+        unsigned long sensorId;
+        osg_points::PointsStream *stream;
+
+        void receivePoints(unsigned long sensorId, const float *points,
+                           const float *intensities, size_t numPoints,
+                           double time) {
+          stream->appendPoints(points, intensities, numPoints, time*0.001);
+        }
+      };
+
       struct CameraStruct {
         unsigned long id;
         double *data, *pydata;
@@ -114,12 +128,13 @@ namespace mars {
         //PythonMars_MainWin *plugin_win;
         utils::Mutex gpMutex, mutex, guiMapMutex, mutexPoints, mutexCamera;
         shared_ptr<Module> plugin;
-        std::map<std::string, unsigned long> motorMap;
+        std::map<std::string, unsigned long> motorMap, nodeMap, sensorMap;
         configmaps::ConfigItem requestMap;
         bool pythonException;
         std::map<std::string, PointStruct> points;
         std::map<std::string, LineStruct> lines;
         std::map<std::string, CameraStruct> cameras;
+        std::map<std::string, SensorCloud*> sensorClouds;
         osg_material_manager::OsgMaterialManager *materialManager;
         osg_points::PointsFactory *pf;
         osg_lines::LinesFactory *lf;
@@ -128,6 +143,8 @@ namespace mars {
         double updateTime;
         std::vector<configmaps::ConfigMap> guiMaps;
 
+        void removeSensorCloud(const std::string &name);
+
         }; // end of class definition PythonMars
 
     } // end of namespace PythonMars
@@ -37,6 +37,10 @@
 #include <mars/sim/SimJoint.h>
 #include <mars/utils/mathUtils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace mars {
   namespace plugins {
     namespace connectors {
@@ -45,7 +49,7 @@ namespace mars {
       using namespace mars::interfaces;
 
       Connectors::Connectors(lib_manager::LibManager *theManager)
-        : MarsPluginTemplateGUI(theManager, "Connectors") {
+        : MarsPluginTemplateGUI(theManager, "Connectors"), indexDirty(true) {
       }
 
       void Connectors::init() {
@@ -61,9 +65,12 @@ namespace mars {
           cfgautoconnect.bValue = false;
           cfgbreakable.bValue = false;
         }
-        gui->addGenericMenuAction("../Control/", 0, NULL, 0, "", 0, -1); // separator
-        gui->addGenericMenuAction("../Control/Connect available connectors", 1, this);
-        gui->addGenericMenuAction("../Control/Disconnect all connectors", 2, this);
+        // no menu without a gui, e.g. in mars_bench
+        if(gui) {
+          gui->addGenericMenuAction("../Control/", 0, NULL, 0, "", 0, -1); // separator
+          gui->addGenericMenuAction("../Control/Connect available connectors", 1, this);
+          gui->addGenericMenuAction("../Control/Disconnect all connectors", 2, this);
+        }
         //maleconnectors.clear();
         //femaleconnectors.clear();
       }
@@ -71,8 +78,9 @@ namespace mars {
       void Connectors::connect(std::string male, std::string female) {
         fprintf(stderr, "Create connection: %s, %s\n", male.c_str(), female.c_str());
         interfaces::JointData jointdata;
-        jointdata.nodeIndex1 = control->nodes->getID((std::string)(maleconnectors[male]["link"]));
-        jointdata.nodeIndex2 = control->nodes->getID((std::string)(femaleconnectors[female]["link"]));
+        // the node ids were resolved when the connectors were registered
+        jointdata.nodeIndex1 = (unsigned long)maleconnectors[male]["nodeid"];
+        jointdata.nodeIndex2 = (unsigned long)femaleconnectors[female]["nodeid"];
         jointdata.type = interfaces::JOINT_TYPE_FIXED;
         jointdata.name = "connector_"+male+"_"+female;
         unsigned long jointid = control->joints->addJoint(&jointdata);
@@ -83,6 +91,7 @@ namespace mars {
           femaleconnectors[female]["jointid"] = jointid;
           femaleconnectors[female]["partner"] = male;
           connections[male] = female;
+          indexDirty = true;
         }
       }
 
@@ -120,6 +129,7 @@ namespace mars {
           // now reset partner
           (it->second)["jointid"] = 0;
           (it->second)["partner"] = "";
+          indexDirty = true;
         }
       }
       void Connectors::registerEntity(sim::SimEntity* entity) {
@@ -146,6 +156,7 @@ namespace mars {
               fprintf(stderr, "Adding female connector: %s\n", ((std::string)(tmpmap["name"])).c_str());
             }
           }
+          indexDirty = true;
         }
       }
 
@@ -155,37 +166,137 @@ namespace mars {
       Connectors::~Connectors() {
       }
 
-      bool Connectors::mated(std::string malename, std::string femalename) {
-        unsigned long maleid = maleconnectors[malename]["nodeid"];
-        unsigned long femaleid = femaleconnectors[femalename]["nodeid"];
-        utils::Vector malerot = control->nodes->getRotation(maleid)*Vector(1.0, 0.0, 0.0);
-        utils::Vector femalerot = control->nodes->getRotation(femaleid)*Vector(1.0, 0.0, 0.0);
+      bool Connectors::mated(size_t male, size_t female) {
+        const ConnectorType &type = typeIndex[connectorIndex[male].type];
+        utils::Vector malerot = rotations[male]*Vector(1.0, 0.0, 0.0);
+        utils::Vector femalerot = rotations[female]*Vector(1.0, 0.0, 0.0);
         sReal angle = utils::angleBetween(malerot, femalerot);
 
         //TODO: this is a hard-coded hack, should be defined in type
-        sReal distance = utils::distanceBetween(control->nodes->getPosition(maleid),
-          control->nodes->getPosition(femaleid));
-        //fprintf(stderr, "distance/angle: %i, %i, %g/%g\n", maleid, femaleid, distance, angle);
-        return (distance <= ((double)(connectortypes[maleconnectors[malename]["type"]]["distance"]))
-          && angle < ((double)(connectortypes[maleconnectors[malename]["type"]]["angle"])));
+        sReal distance = utils::distanceBetween(positions[male],
+                                                positions[female]);
+        return (distance <= type.distance && angle < type.angle);
+      }
 
+      /**
+       * Resolves the node ids, types and connection states of all
+       * connectors once. The index is rebuilt whenever connectors are
+       * added, connected or disconnected.
+       */
+      void Connectors::rebuildIndex() {
+        std::map<std::string, size_t> typeIds;
+        std::map<std::string, configmaps::ConfigMap>::iterator it;
+
+        typeIndex.clear();
+        for(it = connectortypes.begin(); it != connectortypes.end(); ++it) {
+          ConnectorType type;
+          type.name = it->first;
+          type.distance = type.angle = 0.0;
+          // connections of types without a maximal force never break
+          type.maxForce = std::numeric_limits<double>::max();
+          if(it->second.hasKey("distance")) type.distance = (double)it->second["distance"];
+          if(it->second.hasKey("angle")) type.angle = (double)it->second["angle"];
+          if(it->second.hasKey("maxforce")) type.maxForce = (double)it->second["maxforce"];
+          // avoid degenerated cells for types with a zero distance
+          type.cellSize = std::max(type.distance, 0.001);
+          typeIds[type.name] = typeIndex.size();
+          typeIndex.push_back(type);
+        }
+
+        connectorIndex.clear();
+        indexNodeIds.clear();
+        // males first, both in name order to keep the order of the
+        // connections independent of the spatial hash
+        for(int i=0; i<2; ++i) {
+          std::map<std::string, configmaps::ConfigMap> &connectors = (i == 0) ? maleconnectors : femaleconnectors;
+          for(it = connectors.begin(); it != connectors.end(); ++it) {
+            std::map<std::string, size_t>::iterator tit;
+            tit = typeIds.find((std::string)it->second["type"]);
+            if(tit == typeIds.end()) continue;
+            IndexedConnector connector;
+            connector.name = it->first;
+            connector.nodeid = (unsigned long)it->second["nodeid"];
+            connector.type = tit->second;
+            connector.male = (i == 0);
+            connector.connected = (it->second.hasKey("partner") &&
+                                   !((std::string)it->second["partner"]).empty());
+            connector.jointid = 0;
+            if(connector.connected && it->second.hasKey("jointid")) {
+              connector.jointid = (unsigned long)it->second["jointid"];
+            }
+            connectorIndex.push_back(connector);
+            indexNodeIds.push_back(connector.nodeid);
+          }
+        }
+        indexDirty = false;
       }
 
+      /**
+       * Sorts the free female connectors into a uniform grid per connector
+       * type and only tests the females in the neighbouring cells of each
+       * free male connector. Of all matching females the one with the
+       * lowest name is connected, as before.
+       */
       void Connectors::checkForPossibleConnections() {
-        std::string malename, femalename, maletype, femaletype;
-        for (std::map<std::string, configmaps::ConfigMap>::iterator mit= maleconnectors.begin();
-          mit!=maleconnectors.end(); ++mit) {
-          malename = (std::string)mit->second["name"];
-          maletype = (std::string)mit->second["type"];
-          for (std::map<std::string, configmaps::ConfigMap>::iterator fit= femaleconnectors.begin();
-            fit!=femaleconnectors.end(); ++fit) {
-            femalename = (std::string)fit->second["name"];
-            femaletype = (std::string)fit->second["type"];
-            if (maletype.compare(femaletype) == 0 && mated(malename, femalename)
-          && ((std::string)mit->second["partner"]).empty() && ((std::string)fit->second["partner"]).empty()) {
-              connect(malename, femalename);
+        if(indexDirty) rebuildIndex();
+        if(connectorIndex.empty()) return;
+        control->nodes->getPoses(indexNodeIds, &positions, &rotations);
+
+        for(size_t t=0; t<typeIndex.size(); ++t) {
+          typeIndex[t].cells.clear();
+        }
+        for(size_t i=0; i<connectorIndex.size(); ++i) {
+          const IndexedConnector &connector = connectorIndex[i];
+          if(connector.male || connector.connected) continue;
+          ConnectorType &type = typeIndex[connector.type];
+          CellEntry entry;
+          entry.x = (int)floor(positions[i].x() / type.cellSize);
+          entry.y = (int)floor(positions[i].y() / type.cellSize);
+          entry.z = (int)floor(positions[i].z() / type.cellSize);
+          entry.connector = i;
+          type.cells.push_back(entry);
+        }
+        for(size_t t=0; t<typeIndex.size(); ++t) {
+          std::sort(typeIndex[t].cells.begin(), typeIndex[t].cells.end());
+        }
+
+        for(size_t m=0; m<connectorIndex.size(); ++m) {
+          if(!connectorIndex[m].male || connectorIndex[m].connected) continue;
+          const ConnectorType &type = typeIndex[connectorIndex[m].type];
+          if(type.cells.empty()) continue;
+          int cx = (int)floor(positions[m].x() / type.cellSize);
+          int cy = (int)floor(positions[m].y() / type.cellSize);
+          int cz = (int)floor(positions[m].z() / type.cellSize);
+          size_t best = connectorIndex.size();
+          for(int dx=-1; dx<=1; ++dx) {
+            for(int dy=-1; dy<=1; ++dy) {
+              for(int dz=-1; dz<=1; ++dz) {
+                CellEntry key;
+                key.x = cx+dx;
+                key.y = cy+dy;
+                key.z = cz+dz;
+                key.connector = 0;
+                std::vector<CellEntry>::const_iterator fit;
+                fit = std::lower_bound(type.cells.begin(), type.cells.end(), key);
+                for(; fit != type.cells.end() && fit->x == key.x &&
+                      fit->y == key.y && fit->z == key.z; ++fit) {
+                  size_t f = fit->connector;
+                  if(f < best && !connectorIndex[f].connected && mated(m, f)) {
+                    best = f;
+                  }
+                }
               }
             }
+          }
+          if(best < connectorIndex.size()) {
+            connect(connectorIndex[m].name, connectorIndex[best].name);
+            if(connections.find(connectorIndex[m].name) != connections.end()) {
+              connectorIndex[m].connected = true;
+              connectorIndex[best].connected = true;
+              connectorIndex[m].jointid = (unsigned long)maleconnectors[connectorIndex[m].name]["jointid"];
+              connectorIndex[best].jointid = connectorIndex[m].jointid;
+            }
+          }
         }
       }
 
@@ -196,11 +307,20 @@ namespace mars {
         }
         // the following is experimental and not working yet
         if (cfgbreakable.bValue) {
-          for (std::map<std::string, std::string>::iterator it = connections.begin(); it!=connections.end(); ++it) {
-            utils::Vector forcevec = control->joints->getSimJoint(maleconnectors[it->first]["jointid"])->getJointLoad();
+          // the joint ids and forces come from the index, thus no
+          // connector or type is looked up by name per step
+          if(indexDirty) rebuildIndex();
+          for(size_t m=0; m<connectorIndex.size(); ++m) {
+            IndexedConnector &connector = connectorIndex[m];
+            if(!connector.male || !connector.connected) continue;
+            sim::SimJoint *joint = control->joints->getSimJoint(connector.jointid);
+            if(!joint) continue;
+            utils::Vector forcevec = joint->getJointLoad();
             //fprintf(stderr, "JointLoad: %g\n", forcevec.norm());
-            if (forcevec.norm() > (double)(connectortypes[maleconnectors[it->first]["type"]]["maxforce"])) {
-              disconnect(it->first);
+            if (forcevec.norm() > typeIndex[connector.type].maxForce) {
+              // the index is rebuilt before its next use
+              disconnect(connector.name);
+              connector.connected = false;
             }
           }
         }
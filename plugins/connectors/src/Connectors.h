@@ -40,9 +40,12 @@
 #include <mars/interfaces/sim/EntitySubscriberInterface.h>
 #include <mars/data_broker/ReceiverInterface.h>
 #include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/utils/Vector.h>
+#include <mars/utils/Quaternion.h>
 #include <configmaps/ConfigData.h>
 
 #include <string>
+#include <vector>
 
 namespace mars {
 
@@ -87,12 +90,58 @@ namespace mars {
         void registerEntity(sim::SimEntity* entity);
 
       private:
+        /**
+         * An entry of the spatial hash: the grid cell of a female connector.
+         */
+        struct CellEntry {
+          int x, y, z;
+          size_t connector;
+          bool operator<(const CellEntry &other) const {
+            if(x != other.x) return x < other.x;
+            if(y != other.y) return y < other.y;
+            if(z != other.z) return z < other.z;
+            return connector < other.connector;
+          }
+        };
+
+        /**
+         * A connector type with its values resolved from the ConfigMap and
+         * the spatial hash of its free female connectors. The cell size
+         * equals the connection distance, thus only the neighbouring cells
+         * of a male connector have to be searched.
+         */
+        struct ConnectorType {
+          std::string name;
+          double distance, angle, cellSize, maxForce;
+          std::vector<CellEntry> cells;
+        };
+
+        struct IndexedConnector {
+          std::string name;
+          interfaces::NodeId nodeid;
+          unsigned long jointid;
+          size_t type;
+          bool male;
+          bool connected;
+        };
+
         cfg_manager::cfgPropertyStruct cfgautoconnect, cfgbreakable;
         std::map<std::string, configmaps::ConfigMap> maleconnectors;
         std::map<std::string, configmaps::ConfigMap> femaleconnectors;
         std::map<std::string, configmaps::ConfigMap> connectortypes;
         std::map<std::string, std::string> connections;
-        bool mated(std::string malename, std::string femalename);
+
+        // connector index used by checkForPossibleConnections and by the
+        // breakable check in update
+        std::vector<IndexedConnector> connectorIndex;
+        std::vector<ConnectorType> typeIndex;
+        std::vector<interfaces::NodeId> indexNodeIds;
+        std::vector<utils::Vector> positions;
+        std::vector<utils::Quaternion> rotations;
+        bool indexDirty;
+
+        bool mated(size_t male, size_t female);
+        void rebuildIndex();
         void checkForPossibleConnections();
 
 
@@ -0,0 +1,391 @@
+/*
+ *  Copyright 2015, 2016 DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "EntityTreeModel.h"
+
+#include <mars/interfaces/sim/NodeManagerInterface.h>
+
+#include <algorithm>
+#include <set>
+
+namespace mars {
+  using namespace interfaces;
+  namespace plugins {
+
+    // the number of node items created per fetchMore call
+    static const size_t fetchBatch = 256;
+
+    EntityTreeModel::EntityTreeModel(ControlCenter *control, QObject *parent)
+      : QAbstractItemModel(parent), control(control), nodeCategory(NULL) {
+      root = new Item;
+      root->parent = NULL;
+      root->row = 0;
+      root->nodeId = 0;
+      root->nodes = false;
+    }
+
+    EntityTreeModel::~EntityTreeModel() {
+      dropItem(root);
+    }
+
+    QModelIndex EntityTreeModel::index(int row, int column,
+                                       const QModelIndex &parent) const {
+      Item *p = item(parent);
+      if(column != 0 || row < 0 || (size_t)row >= p->children.size()) {
+        return QModelIndex();
+      }
+      return createIndex(row, 0, p->children[row]);
+    }
+
+    QModelIndex EntityTreeModel::parent(const QModelIndex &index) const {
+      if(!index.isValid()) return QModelIndex();
+      return indexOf(item(index)->parent);
+    }
+
+    int EntityTreeModel::rowCount(const QModelIndex &parent) const {
+      if(parent.column() > 0) return 0;
+      return item(parent)->children.size();
+    }
+
+    int EntityTreeModel::columnCount(const QModelIndex &parent) const {
+      (void)parent;
+      return 1;
+    }
+
+    QVariant EntityTreeModel::data(const QModelIndex &index, int role) const {
+      if(!index.isValid() || role != Qt::DisplayRole) return QVariant();
+      return item(index)->text;
+    }
+
+    bool EntityTreeModel::hasChildren(const QModelIndex &parent) const {
+      const Item *i = item(parent);
+      if(!i->children.empty()) return true;
+      return i->nodes && !pendingNodes(i).empty();
+    }
+
+    bool EntityTreeModel::canFetchMore(const QModelIndex &parent) const {
+      const Item *i = item(parent);
+      return i->nodes && i->children.size() < pendingNodes(i).size();
+    }
+
+    void EntityTreeModel::fetchMore(const QModelIndex &parent) {
+      fetch(item(parent), fetchBatch);
+    }
+
+    void EntityTreeModel::beginBuild() {
+      beginResetModel();
+      for(size_t i=0; i<root->children.size(); ++i) {
+        dropItem(root->children[i]);
+      }
+      root->children.clear();
+      nodeCategory = NULL;
+      nodeNames.clear();
+      nodeParent.clear();
+      nodeChildren.clear();
+      nodeItems.clear();
+    }
+
+    void EntityTreeModel::endBuild() {
+      endResetModel();
+    }
+
+    void EntityTreeModel::clear() {
+      beginBuild();
+      endBuild();
+    }
+
+    QModelIndex EntityTreeModel::addCategory(const std::string &name) {
+      return indexOf(newItem(root, QString::fromStdString(name)));
+    }
+
+    QModelIndex EntityTreeModel::addItem(const QModelIndex &parent,
+                                         const QString &text) {
+      return indexOf(newItem(item(parent), text));
+    }
+
+    void EntityTreeModel::setNodes(const std::vector<core_objects_exchange> &nodes) {
+      std::vector<unsigned long> ids;
+      nodeCategory = newItem(root, "nodes");
+      nodeCategory->nodes = true;
+      for(size_t i=0; i<nodes.size(); ++i) {
+        nodeNames[nodes[i].index] = nodes[i].name;
+        ids.push_back(nodes[i].index);
+      }
+      placeNodes(ids, true);
+    }
+
+    void EntityTreeModel::syncNodes(const std::vector<core_objects_exchange> &nodes) {
+      std::map<unsigned long, std::string> current;
+      std::map<unsigned long, std::string>::iterator it, nt;
+      std::vector<unsigned long> removed, added;
+
+      if(!nodeCategory) return;
+      for(size_t i=0; i<nodes.size(); ++i) {
+        current[nodes[i].index] = nodes[i].name;
+      }
+      for(it=nodeNames.begin(); it!=nodeNames.end(); ++it) {
+        if(!current.count(it->first)) removed.push_back(it->first);
+      }
+      for(size_t i=0; i<removed.size(); ++i) {
+        removeNode(removed[i]);
+      }
+
+      for(it=current.begin(); it!=current.end(); ++it) {
+        nt = nodeNames.find(it->first);
+        if(nt == nodeNames.end()) {
+          nodeNames[it->first] = it->second;
+          added.push_back(it->first);
+        }
+        else if(nt->second != it->second) {
+          nt->second = it->second;
+          std::map<unsigned long, Item*>::iterator iit;
+          iit = nodeItems.find(it->first);
+          if(iit != nodeItems.end()) {
+            iit->second->text = (QString::number(it->first) + ":" +
+                                 QString::fromStdString(it->second));
+            QModelIndex index = indexOf(iit->second);
+            emit dataChanged(index, index);
+          }
+        }
+      }
+      placeNodes(added, false);
+    }
+
+    void EntityTreeModel::removeNode(unsigned long id) {
+      std::map<unsigned long, unsigned long>::iterator pt;
+      pt = nodeParent.find(id);
+      if(pt == nodeParent.end()) return;
+      unsigned long parent = pt->second;
+      Item *container = parent ? NULL : nodeCategory;
+      if(parent) {
+        std::map<unsigned long, Item*>::iterator it = nodeItems.find(parent);
+        if(it != nodeItems.end()) container = it->second;
+      }
+
+      // the items of a container are created in the order of its ids,
+      // thus the node is at the same row as in the id list
+      std::vector<unsigned long> &siblings = nodeChildren[parent];
+      size_t row = std::find(siblings.begin(), siblings.end(), id) - siblings.begin();
+      if(container && row < container->children.size()) {
+        beginRemoveRows(indexOf(container), row, row);
+        Item *removed = container->children[row];
+        container->children.erase(container->children.begin() + row);
+        for(size_t i=row; i<container->children.size(); ++i) {
+          container->children[i]->row = i;
+        }
+        dropItem(removed);
+        endRemoveRows();
+      }
+      if(row < siblings.size()) siblings.erase(siblings.begin() + row);
+
+      // the children of the node move to its parent
+      std::vector<unsigned long> children;
+      std::map<unsigned long, std::vector<unsigned long> >::iterator ct;
+      ct = nodeChildren.find(id);
+      if(ct != nodeChildren.end()) {
+        children.swap(ct->second);
+        nodeChildren.erase(ct);
+      }
+      nodeParent.erase(pt);
+      nodeNames.erase(id);
+      size_t fetched = siblings.size();
+      for(size_t i=0; i<children.size(); ++i) {
+        nodeParent[children[i]] = parent;
+        siblings.push_back(children[i]);
+      }
+      if(container && container->children.size() == fetched) {
+        fetch(container, fetchBatch);
+      }
+    }
+
+    void EntityTreeModel::removeItem(const QModelIndex &index) {
+      if(!index.isValid()) return;
+      Item *i = item(index);
+      // nodes have to be removed with removeNode
+      if(i->nodes) return;
+      Item *parent = i->parent;
+      int row = i->row;
+      beginRemoveRows(indexOf(parent), row, row);
+      parent->children.erase(parent->children.begin() + row);
+      for(size_t k=row; k<parent->children.size(); ++k) {
+        parent->children[k]->row = k;
+      }
+      dropItem(i);
+      endRemoveRows();
+    }
+
+    QModelIndex EntityTreeModel::nodeIndex(unsigned long id) {
+      std::vector<unsigned long> path;
+      std::map<unsigned long, Item*>::iterator it;
+      std::map<unsigned long, unsigned long>::iterator pt;
+      unsigned long current = id;
+
+      if(!nodeCategory) return QModelIndex();
+      // walk up to the first node that already has an item
+      while(current && (it = nodeItems.find(current)) == nodeItems.end()) {
+        pt = nodeParent.find(current);
+        if(pt == nodeParent.end()) return QModelIndex();
+        path.push_back(current);
+        current = pt->second;
+      }
+      Item *container = current ? it->second : nodeCategory;
+      for(size_t i=path.size(); i>0; --i) {
+        const std::vector<unsigned long> &ids = pendingNodes(container);
+        size_t row = std::find(ids.begin(), ids.end(), path[i-1]) - ids.begin();
+        if(row >= ids.size()) return QModelIndex();
+        if(row >= container->children.size()) {
+          fetch(container, row + 1 - container->children.size());
+        }
+        container = container->children[row];
+      }
+      return indexOf(container);
+    }
+
+    unsigned long EntityTreeModel::nodeId(const QModelIndex &index) const {
+      return index.isValid() ? item(index)->nodeId : 0;
+    }
+
+    EntityTreeModel::Item* EntityTreeModel::item(const QModelIndex &index) const {
+      if(!index.isValid()) return root;
+      return static_cast<Item*>(index.internalPointer());
+    }
+
+    QModelIndex EntityTreeModel::indexOf(Item *item) const {
+      if(!item || item == root) return QModelIndex();
+      return createIndex(item->row, 0, item);
+    }
+
+    EntityTreeModel::Item* EntityTreeModel::newItem(Item *parent,
+                                                    const QString &text) {
+      Item *i = new Item;
+      i->text = text;
+      i->parent = parent;
+      i->row = parent->children.size();
+      i->nodeId = 0;
+      i->nodes = false;
+      parent->children.push_back(i);
+      return i;
+    }
+
+    void EntityTreeModel::dropItem(Item *item) {
+      std::vector<Item*> stack(1, item);
+      while(!stack.empty()) {
+        Item *i = stack.back();
+        stack.pop_back();
+        stack.insert(stack.end(), i->children.begin(), i->children.end());
+        if(i->nodeId) nodeItems.erase(i->nodeId);
+        delete i;
+      }
+    }
+
+    const std::vector<unsigned long>& EntityTreeModel::pendingNodes(const Item *item) const {
+      static const std::vector<unsigned long> none;
+      std::map<unsigned long, std::vector<unsigned long> >::const_iterator it;
+      it = nodeChildren.find(item->nodeId);
+      return it != nodeChildren.end() ? it->second : none;
+    }
+
+    void EntityTreeModel::fetch(Item *item, size_t count) {
+      if(!item->nodes) return;
+      const std::vector<unsigned long> &ids = pendingNodes(item);
+      size_t first = item->children.size();
+      size_t last = std::min(ids.size(), first + count);
+      if(first >= last) return;
+      beginInsertRows(indexOf(item), first, last-1);
+      for(size_t i=first; i<last; ++i) {
+        Item *child = newItem(item, QString::number(ids[i]) + ":" +
+                              QString::fromStdString(nodeNames[ids[i]]));
+        child->nodeId = ids[i];
+        child->nodes = true;
+        nodeItems[ids[i]] = child;
+      }
+      endInsertRows();
+    }
+
+    /**
+     * Walks the nodes connected to each of \a ids depth first and adds the
+     * ones that are not in the forest yet below the node from which they
+     * were reached. Outside of a build, a new node that is connected to a
+     * node of the forest becomes its child, and containers whose items were
+     * all fetched get the items of the new nodes right away.
+     */
+    void EntityTreeModel::placeNodes(const std::vector<unsigned long> &ids,
+                                     bool building) {
+      std::map<unsigned long, size_t> grown;
+      std::map<unsigned long, size_t>::iterator gt;
+      std::set<unsigned long> visited;
+      std::vector<std::pair<unsigned long, unsigned long> > stack;
+      std::vector<unsigned long> connected;
+
+      for(size_t i=0; i<ids.size(); ++i) {
+        if(nodeParent.count(ids[i]) || visited.count(ids[i])) continue;
+        unsigned long parent = 0;
+        if(!building) {
+          connected = control->nodes->getConnectedNodes(ids[i]);
+          for(size_t k=0; k<connected.size(); ++k) {
+            if(nodeParent.count(connected[k])) {
+              parent = connected[k];
+              break;
+            }
+          }
+        }
+        stack.push_back(std::make_pair(ids[i], parent));
+        while(!stack.empty()) {
+          unsigned long id = stack.back().first;
+          parent = stack.back().second;
+          stack.pop_back();
+          if(!visited.insert(id).second || nodeParent.count(id)) continue;
+
+          if(nodeNames.count(id)) {
+            std::vector<unsigned long> &children = nodeChildren[parent];
+            if(!building && !grown.count(parent)) {
+              grown[parent] = children.size();
+            }
+            children.push_back(id);
+            nodeParent[id] = parent;
+            parent = id;
+          }
+
+          // push in reverse order to visit the children in their order
+          connected = control->nodes->getConnectedNodes(id);
+          for(size_t k=connected.size(); k>0; --k) {
+            if(!visited.count(connected[k-1]) &&
+               !nodeParent.count(connected[k-1])) {
+              stack.push_back(std::make_pair(connected[k-1], parent));
+            }
+          }
+        }
+      }
+
+      for(gt=grown.begin(); gt!=grown.end(); ++gt) {
+        Item *container = gt->first ? NULL : nodeCategory;
+        if(gt->first) {
+          std::map<unsigned long, Item*>::iterator it = nodeItems.find(gt->first);
+          if(it != nodeItems.end()) container = it->second;
+        }
+        if(container && container->children.size() == gt->second) {
+          fetch(container, fetchBatch);
+        }
+      }
+    }
+
+  } // end of namespace plugins
+} // end of namespace mars
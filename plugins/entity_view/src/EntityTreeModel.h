@@ -0,0 +1,149 @@
+/*
+ *  Copyright 2015, 2016 DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file EntityTreeModel.h
+ * \brief The item model of the SelectionTree.
+ */
+
+#ifndef ENTITY_TREE_MODEL_H
+#define ENTITY_TREE_MODEL_H
+
+#ifdef _PRINT_HEADER_
+#warning "EntityTreeModel.h"
+#endif
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/core_objects_exchange.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <QAbstractItemModel>
+
+namespace mars {
+  namespace plugins {
+
+    /**
+     * \brief Holds the categories of the SelectionTree (nodes, joints,
+     *        motors, ...) and their items.
+     *
+     * The nodes are arranged as a forest: a node that is connected to
+     * another one (same group or joint) becomes the child of the node from
+     * which it was reached first. The forest is only kept as node ids. The
+     * items of the children of a node are created in batches by fetchMore()
+     * when the view expands or scrolls to the node, so opening the view on
+     * a large scene does not create an item per node.
+     *
+     * Nodes can be added and removed incrementally with syncNodes() and
+     * removeNode(). The other categories are rebuilt as a whole between
+     * beginBuild() and endBuild().
+     */
+    class EntityTreeModel : public QAbstractItemModel {
+      Q_OBJECT
+
+    public:
+      explicit EntityTreeModel(interfaces::ControlCenter *control,
+                               QObject *parent = NULL);
+      ~EntityTreeModel();
+
+      QModelIndex index(int row, int column,
+                        const QModelIndex &parent = QModelIndex()) const;
+      QModelIndex parent(const QModelIndex &index) const;
+      int rowCount(const QModelIndex &parent = QModelIndex()) const;
+      int columnCount(const QModelIndex &parent = QModelIndex()) const;
+      QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+      bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+      bool canFetchMore(const QModelIndex &parent) const;
+      void fetchMore(const QModelIndex &parent);
+
+      /** \brief removes all items and starts a model reset */
+      void beginBuild();
+      void endBuild();
+      /** \brief removes all items */
+      void clear();
+
+      /**
+       * \brief adds a top level item. Only allowed between beginBuild()
+       *        and endBuild().
+       */
+      QModelIndex addCategory(const std::string &name);
+      /** \brief adds an item. Only allowed between beginBuild() and endBuild(). */
+      QModelIndex addItem(const QModelIndex &parent, const QString &text);
+      /**
+       * \brief adds the "nodes" category and arranges \a nodes in it.
+       *        Only allowed between beginBuild() and endBuild().
+       */
+      void setNodes(const std::vector<interfaces::core_objects_exchange> &nodes);
+
+      /**
+       * \brief adds the nodes that are not in the model yet, removes the
+       *        ones that are no longer in \a nodes and updates renamed ones.
+       */
+      void syncNodes(const std::vector<interfaces::core_objects_exchange> &nodes);
+      /** \brief removes a node; its children move to its parent */
+      void removeNode(unsigned long id);
+      /** \brief removes a non node item and its children */
+      void removeItem(const QModelIndex &index);
+
+      /**
+       * \return The index of the node \a id. The items on the path to the
+       *         node are fetched if they do not exist yet.
+       */
+      QModelIndex nodeIndex(unsigned long id);
+      /** \return The node id of \a index or 0 if it is not a node. */
+      unsigned long nodeId(const QModelIndex &index) const;
+
+    private:
+      struct Item {
+        QString text;
+        Item *parent;
+        std::vector<Item*> children;
+        int row;
+        // the id of a node item, 0 for all other items
+        unsigned long nodeId;
+        // set for the node category and the node items, whose children
+        // are fetched from nodeChildren
+        bool nodes;
+      };
+
+      interfaces::ControlCenter *control;
+      Item *root, *nodeCategory;
+      std::map<unsigned long, std::string> nodeNames;
+      // node id -> parent node id; 0 for the nodes below the category
+      std::map<unsigned long, unsigned long> nodeParent;
+      // node id -> child node ids; the key 0 holds the top level nodes
+      std::map<unsigned long, std::vector<unsigned long> > nodeChildren;
+      std::map<unsigned long, Item*> nodeItems;
+
+      Item* item(const QModelIndex &index) const;
+      QModelIndex indexOf(Item *item) const;
+      Item* newItem(Item *parent, const QString &text);
+      void dropItem(Item *item);
+      const std::vector<unsigned long>& pendingNodes(const Item *item) const;
+      void fetch(Item *item, size_t count);
+      void placeNodes(const std::vector<unsigned long> &ids, bool building);
+    }; // end of class EntityTreeModel
+
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // ENTITY_TREE_MODEL_H
@@ -26,12 +26,15 @@
 #include <mars/interfaces/sim/MotorManagerInterface.h>
 #include <mars/interfaces/sim/SensorManagerInterface.h>
 #include <mars/interfaces/sim/ControllerManagerInterface.h>
+#include <mars/interfaces/sim/EntityManagerInterface.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/utils/misc.h>
 #include <mars/utils/mathUtils.h>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
+#include <QItemSelectionModel>
+#include <QPersistentModelIndex>
 
 using namespace std;
 
@@ -44,16 +47,20 @@ namespace mars {
                                  config_map_gui::DataWidget *dw,
                                  QWidget *parent) :
       dw(dw), main_gui::BaseWidget(parent, c->cfg, "SelectionTree") {
-      filled = false;
       control = c;
       editCategory = 0;
       this->setWindowTitle(tr("Node Selection"));
 
       selectAllowed = true;
-      treeWidget = new QTreeWidget(this);
-      treeWidget->setHeaderHidden(true);
-      treeWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
-      connect(treeWidget, SIGNAL(itemSelectionChanged()), this, SLOT(selectNodes()));
+      model = new EntityTreeModel(control, this);
+      treeView = new QTreeView(this);
+      treeView->setHeaderHidden(true);
+      treeView->setUniformRowHeights(true);
+      treeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+      treeView->setModel(model);
+      connect(treeView->selectionModel(),
+              SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
+              this, SLOT(selectNodes()));
       connect(dw, SIGNAL(valueChanged(std::string, std::string)), this, SLOT(valueChanged(std::string, std::string)));
       //connect(treeWidget, SIGNAL(itemSelectionChanged()), this, SIGNAL(itemSelectionChanged()));
       if(control->graphics) {
@@ -68,10 +75,14 @@ namespace mars {
       ld.toConfigMap(&defaultLight);
 
       createTree();
+      // nodes of entities that are loaded later are added incrementally
+      if(control->entities) {
+        control->entities->subscribeToEntityCreation(this);
+      }
 
       QVBoxLayout *layout = new QVBoxLayout;
       QHBoxLayout *hlayout = new QHBoxLayout;
-      layout->addWidget(treeWidget);
+      layout->addWidget(treeView);
       QPushButton *button = new QPushButton("Delete Entities");
       connect(button, SIGNAL(clicked()), this, SLOT(deleteEntities()));
       hlayout->addWidget(button);
@@ -80,69 +91,31 @@ namespace mars {
       hlayout->addWidget(button);
       layout->addLayout(hlayout);
       setLayout(layout);
-      filled = true;
     }
 
 
     SelectionTree::~SelectionTree() {
-    }
-
-    void SelectionTree::fill(unsigned long id, QTreeWidgetItem *current) {
-      QStringList temp;
-
-      for (unsigned int i = 0; i < simNodes.size(); i++) {
-        if (simNodes[i].index == id) {
-          bool found = false;
-          for (unsigned int k = 0; k < present.size() && !found; k++) {
-            if (present[k] == id) found = true;
-          }
-          if (found == false) {
-            temp << QString::number(id) + ":" + QString::fromStdString(simNodes[i].name);
-            QTreeWidgetItem *next = new QTreeWidgetItem(temp);
-            // todo: should read the selected state in the simulation
-            nodeItemMap[id] = next;
-            current->addChild(next);
-            current = next;
-            present.push_back(id);
-          }
-          simNodes.erase(simNodes.begin()+i);
-          break;
-        }
+      if(control->entities) {
+        control->entities->unsubscribeFromEntityCreation(this);
       }
+    }
 
-      vector<unsigned long> children = control->nodes->getConnectedNodes(id);
-      vector<unsigned long> newNodes;
-
-      for(size_t i=0; i<children.size(); i++)  {
-        bool found = false;
-        for(size_t k = 0; k<present.size() && !found; k++) {
-          if(present[k] == children[i]) {
-            found = true;
-          }
-        }
-        if(!found) {
-          newNodes.push_back(children[i]);
-        }
-      }
+    void SelectionTree::registerEntity(sim::SimEntity *entity) {
+      (void)entity;
+      // the entity reports no node list and can be created by any thread;
+      // the model is compared with the node list in the gui thread
+      QMetaObject::invokeMethod(this, "syncNodes", Qt::QueuedConnection);
+    }
 
-      for (unsigned int i = 0; i < newNodes.size(); i++) {
-        fill(newNodes[i], current);
-      }
+    void SelectionTree::syncNodes(void) {
+      control->nodes->getListNodes(&simNodes);
+      model->syncNodes(simNodes);
     }
 
     void SelectionTree::createTree()  {
-      std::vector<interfaces::core_objects_exchange> tmpList;
-      present.clear();
-      control->nodes->getListNodes(&tmpList);
-      simNodes = tmpList;
-      QStringList temp;
-      temp << "nodes";
-      QTreeWidgetItem *current = new QTreeWidgetItem(temp);
-      treeWidget->addTopLevelItem(current);
-
-      while(simNodes.size() > 0) fill(simNodes[0].index, current);
-      tmpList.swap(simNodes);
-      //treeWidget->expandAll();
+      model->beginBuild();
+      control->nodes->getListNodes(&simNodes);
+      model->setNodes(simNodes);
 
       control->joints->getListJoints(&simJoints);
       addCoreExchange(simJoints, "joints");
@@ -156,126 +129,112 @@ namespace mars {
       control->controllers->getListController(&simControllers);
       addCoreExchange(simControllers, "controllers");
 
-      temp.clear();
-      temp << "materials";
-      current = new QTreeWidgetItem(temp);
-      treeWidget->addTopLevelItem(current);
+      QModelIndex current = model->addCategory("materials");
       std::vector<interfaces::MaterialData> mList;
       mList = control->graphics->getMaterialList();
       materialMap.clear();
       for(size_t i=0; i<mList.size(); ++i) {
-        temp.clear();
-        temp << QString::fromStdString(mList[i].name);
         configmaps::ConfigMap map;
         mList[i].toConfigMap(&map);
         materialMap[mList[i].name] = map;
         //map.toYamlStream(std::cerr);
-        QTreeWidgetItem *next = new QTreeWidgetItem(temp);
-        current->addChild(next);
+        model->addItem(current, QString::fromStdString(mList[i].name));
       }
 
       if(control->graphics) {
         { // handle lights
           lightMap.clear();
-          temp.clear();
-          temp << "lights";
-          current = new QTreeWidgetItem(temp);
-          treeWidget->addTopLevelItem(current);
+          current = model->addCategory("lights");
           std::vector<interfaces::LightData*> simLights;
           control->graphics->getLights(&simLights);
           for(size_t i=0; i<simLights.size(); ++i) {
-            temp.clear();
-            temp << QString::fromStdString(simLights[i]->name);
             configmaps::ConfigMap map;
             simLights[i]->toConfigMap(&map);
             lightMap[simLights[i]->name] = map;
             //map.toYamlStream(std::cerr);
-            QTreeWidgetItem *next = new QTreeWidgetItem(temp);
-            current->addChild(next);
+            model->addItem(current, QString::fromStdString(simLights[i]->name));
           }
         }
         { // handle windows
           lightMap.clear();
-          temp.clear();
-          temp << "graphics";
-          current = new QTreeWidgetItem(temp);
-          treeWidget->addTopLevelItem(current);
-          temp.clear();
-          temp << "scene";
-          QTreeWidgetItem *next = new QTreeWidgetItem(temp);
-          current->addChild(next);
+          current = model->addCategory("graphics");
+          model->addItem(current, "scene");
           std::vector<unsigned long> ids;
           control->graphics->getList3DWindowIDs(&ids);
           for(auto it: ids) {
             GraphicsWindowInterface *gw = control->graphics->get3DWindow(it);
-            temp.clear();
             std::string gwName = gw->getName();
             if(gwName.empty()) {
-              temp << QString::number(it) + ":window";
+              model->addItem(current, QString::number(it) + ":window");
             }
             else {
-              temp << QString::number(it) + gwName.c_str();
+              model->addItem(current, QString::number(it) + gwName.c_str());
             }
-            QTreeWidgetItem *next = new QTreeWidgetItem(temp);
-            current->addChild(next);
           }
         }
       }
+      model->endBuild();
     }
 
     void SelectionTree::reset(void) {
-      while (treeWidget->topLevelItemCount() > 0)
-        (void)treeWidget->takeTopLevelItem(0);
-      present.clear();
+      model->clear();
+      // the ids are only valid for the tree that is replaced
+      selectedNodes.clear();
+    }
+
+    /**
+     * \return The text of the top level item (category) of \a index or an
+     *         empty string if \a index is a top level item itself.
+     */
+    QString SelectionTree::category(const QModelIndex &index) const {
+      QModelIndex parent = index.parent();
+      if(!parent.isValid()) return QString();
+      while(parent.parent().isValid()) parent = parent.parent();
+      return parent.data().toString();
     }
 
     void SelectionTree::selectNodes(void) {
       if(selectAllowed) { // handle selection state
-        int n;
-        unsigned long id;
-        QList<QTreeWidgetItem*> selectedItems = treeWidget->selectedItems();
-        std::vector<unsigned long> ids;
-        for(size_t i=0; i<selectedItems.size(); ++i) {
-          n = selectedItems[i]->text(0).indexOf(":");
-          QTreeWidgetItem *parent = selectedItems[i]->parent();
-          if(!parent) continue;
-          while(parent->parent()) parent = parent->parent();
-          if(parent->text(0) == "nodes") {
-            ids.push_back(selectedItems[i]->text(0).left(n).toULong());
-          }
+        QModelIndexList selected = treeView->selectionModel()->selectedIndexes();
+        std::set<unsigned long> ids;
+        for(int i=0; i<selected.size(); ++i) {
+          unsigned long id = model->nodeId(selected[i]);
+          if(id) ids.insert(id);
         }
-        bool selected;
         /* todo: get drawid2 should be used, so far we assume every node
            uses two ids */
+        // only the nodes whose selection state changed are updated
         unsigned long drawID;
-        for(size_t i=0; i<simNodes.size(); ++i) {
-          drawID = control->nodes->getDrawID(simNodes[i].index);
+        std::set<unsigned long>::iterator it;
+        for(it=selectedNodes.begin(); it!=selectedNodes.end(); ++it) {
+          if(ids.count(*it)) continue;
+          drawID = control->nodes->getDrawID(*it);
           if(!drawID) continue;
-          selected = false;
-          for(size_t k=0; k<ids.size(); ++k) {
-            if(ids[k] == simNodes[i].index) {
-              selected = true;
-              ids.erase(ids.begin()+k);
-              break;
-            }
-          }
-          control->graphics->setDrawObjectSelected(drawID, selected);
-          control->graphics->setDrawObjectSelected(drawID+1, selected);
+          control->graphics->setDrawObjectSelected(drawID, false);
+          control->graphics->setDrawObjectSelected(drawID+1, false);
+        }
+        for(it=ids.begin(); it!=ids.end(); ++it) {
+          if(selectedNodes.count(*it)) continue;
+          drawID = control->nodes->getDrawID(*it);
+          if(!drawID) continue;
+          control->graphics->setDrawObjectSelected(drawID, true);
+          control->graphics->setDrawObjectSelected(drawID+1, true);
         }
+        selectedNodes.swap(ids);
       }
 
       { // handle config map gui
-        QTreeWidgetItem* currentItem = treeWidget->currentItem();
-        if(currentItem) {
-          QTreeWidgetItem *parent = currentItem->parent();
-          if(!parent) return;
-          while(parent->parent()) parent = parent->parent();
-          int n = currentItem->text(0).indexOf(":");
+        QModelIndex currentIndex = treeView->currentIndex();
+        if(currentIndex.isValid()) {
+          QString parentText = category(currentIndex);
+          if(parentText.isEmpty()) return;
+          QString text = currentIndex.data().toString();
+          int n = text.indexOf(":");
           nodeData.index = motorData.index = jointData.index = 0;
           currentLight.clear();
           currentMaterial.clear();
           // todo: remove current information (motorData, currentLigth etc.)
-          if(n>-1 && parent->text(0) != "graphics") {
+          if(n>-1 && parentText != "graphics") {
             std::vector<std::string> editPattern;
             std::vector<std::string> filePattern;
             std::vector<std::string> colorPattern;
@@ -283,8 +242,8 @@ namespace mars {
             std::vector<std::vector<std::string> > dropDownValues;
             configmaps::ConfigMap map;
             std::string name;
-            unsigned long id = currentItem->text(0).left(n).toULong();
-            if(parent->text(0) == "nodes") {
+            unsigned long id = text.left(n).toULong();
+            if(parentText == "nodes") {
               nodeData = control->nodes->getFullNode(id);
               name = nodeData.name;
               std::string preStr = "../"+name+"/";
@@ -304,7 +263,7 @@ namespace mars {
               updateNodeMap(map);
               editCategory = 1;
             }
-            else if(parent->text(0) == "joints") {
+            else if(parentText == "joints") {
               jointData = control->joints->getFullJoint(id);
               jointData.toConfigMap(&map);
               name = jointData.name;
@@ -325,7 +284,7 @@ namespace mars {
               dropDownValues[0].push_back("custom");
               editCategory = 2;
             }
-            else if(parent->text(0) == "motors") {
+            else if(parentText == "motors") {
               motorData = control->motors->getFullMotor(id);
               motorData.toConfigMap(&map);
               name = motorData.name;
@@ -347,7 +306,7 @@ namespace mars {
               dropDownValues[0].push_back("DC");
               editCategory = 3;
             }
-            else if(parent->text(0) == "sensors") {
+            else if(parentText == "sensors") {
               const BaseSensor *sensor = control->sensors->getFullSensor(id);
               map = sensor->createConfig();
               name = sensor->name;
@@ -359,10 +318,10 @@ namespace mars {
             dw->setDropDownPattern(dropDownPattern, dropDownValues);
             dw->setConfigMap(name, map);
           }
-          else if(parent->text(0) == "controllers") {
+          else if(parentText == "controllers") {
             editCategory = 4;
           }
-          else if(parent->text(0) == "materials") {
+          else if(parentText == "materials") {
             std::vector<std::string> editPattern;
             std::vector<std::string> filePattern;
             std::vector<std::string> colorPattern;
@@ -389,7 +348,7 @@ namespace mars {
             colorPattern.push_back("*/specularColor");
             colorPattern.push_back("*/emissionColor");
 
-            currentMaterial = materialMap[currentItem->text(0).toStdString()];
+            currentMaterial = materialMap[text.toStdString()];
             configmaps::ConfigMap map = defaultMaterial;
             map.append(currentMaterial);
             dw->setEditPattern(editPattern);
@@ -398,7 +357,7 @@ namespace mars {
             dw->setConfigMap(currentMaterial["name"], map);
             editCategory = 5;
           }
-          else if(parent->text(0) == "lights") {
+          else if(parentText == "lights") {
             std::vector<std::string> editPattern;
             std::vector<std::string> filePattern;
             std::vector<std::string> colorPattern;
@@ -420,7 +379,7 @@ namespace mars {
             colorPattern.push_back("*/ambient");
             colorPattern.push_back("*/diffuse");
             colorPattern.push_back("*/specular");
-            std::string lightName = currentItem->text(0).toStdString();
+            std::string lightName = text.toStdString();
             currentLight = lightMap[lightName];
             configmaps::ConfigMap map = defaultLight;
             map.append(currentLight);
@@ -430,8 +389,8 @@ namespace mars {
             dw->setConfigMap(lightName, map);
             editCategory = 6;
           }
-          else if(parent->text(0) == "graphics") {
-            std::string item = currentItem->text(0).toStdString();
+          else if(parentText == "graphics") {
+            std::string item = text.toStdString();
             if(item == "scene") {
               std::vector<std::string> editPattern;
               std::vector<std::string> filePattern;
@@ -571,45 +530,53 @@ namespace mars {
     void SelectionTree::deleteEntities(void) {
       int n;
       unsigned long id;
-      QList<QTreeWidgetItem*> selectedItems = treeWidget->selectedItems();
-      std::vector<unsigned long> ids;
-      for(size_t i=0; i<selectedItems.size(); ++i) {
-        n = selectedItems[i]->text(0).indexOf(":");
-        QTreeWidgetItem *parent = selectedItems[i]->parent();
-        if(!parent) continue;
-        while(parent->parent()) parent = parent->parent();
-        if(parent->text(0) == "nodes") {
-          id = selectedItems[i]->text(0).left(n).toULong();
-          for(int k=0; k<selectedItems[i]->childCount(); ++k) {
-            selectedItems[i]->parent()->addChild(selectedItems[i]->child(k)->clone());
-          }
-          selectedItems[i]->parent()->removeChild(selectedItems[i]);
+      // the removal of an item invalidates the plain indices of the others
+      QModelIndexList selected = treeView->selectionModel()->selectedIndexes();
+      QList<QPersistentModelIndex> selectedItems;
+      for(int i=0; i<selected.size(); ++i) {
+        selectedItems.push_back(QPersistentModelIndex(selected[i]));
+      }
+      for(int i=0; i<selectedItems.size(); ++i) {
+        // removed with the subtree of an item deleted before
+        if(!selectedItems[i].isValid()) continue;
+        QModelIndex index = selectedItems[i];
+        QString parentText = category(index);
+        if(parentText.isEmpty()) continue;
+        QString text = index.data().toString();
+        n = text.indexOf(":");
+        if(parentText == "nodes") {
+          // the children of the node move to its parent
+          id = model->nodeId(index);
+          model->removeNode(id);
+          selectedNodes.erase(id);
           control->nodes->removeNode(id);
           if(nodeData.index == id) dw->clearGUI();
 
         }
         // todo: delete joints / motors / etc.
-        else if(parent->text(0) == "joints") {
-          id = selectedItems[i]->text(0).left(n).toULong();
-          selectedItems[i]->parent()->removeChild(selectedItems[i]);
+        else if(parentText == "joints") {
+          if(n < 0) continue;
+          id = text.left(n).toULong();
+          model->removeItem(index);
           control->joints->removeJoint(id);
           if(jointData.index == id) dw->clearGUI();
         }
-        else if(parent->text(0) == "motors") {
-          id = selectedItems[i]->text(0).left(n).toULong();
-          selectedItems[i]->parent()->removeChild(selectedItems[i]);
+        else if(parentText == "motors") {
+          if(n < 0) continue;
+          id = text.left(n).toULong();
+          model->removeItem(index);
           control->motors->removeMotor(id);
           if(motorData.index == id) dw->clearGUI();
         }
-        else if(parent->text(0) == "sensors") {
+        else if(parentText == "sensors") {
         }
-        else if(parent->text(0) == "controllers") {
+        else if(parentText == "controllers") {
         }
-        else if(parent->text(0) == "materials") {
+        else if(parentText == "materials") {
         }
-        else if(parent->text(0) == "lights") {
+        else if(parentText == "lights") {
           if(control->graphics) {
-            std::string name = selectedItems[i]->text(0).toStdString();
+            std::string name = text.toStdString();
             std::vector<interfaces::LightData*> simLights;
             control->graphics->getLights(&simLights);
             for(size_t i=0; i<simLights.size(); ++i) {
@@ -619,16 +586,17 @@ namespace mars {
               }
             }
           }
-          selectedItems[i]->parent()->removeChild(selectedItems[i]);
+          model->removeItem(index);
         }
       }
     }
 
     void SelectionTree::update(void) {
+      treeView->setUpdatesEnabled(false);
       reset();
       dw->clearGUI();
       createTree();
-      // todo: more intelligent update
+      treeView->setUpdatesEnabled(true);
     }
 
     void SelectionTree::closeEvent(QCloseEvent* event) {
@@ -760,47 +728,46 @@ namespace mars {
 
     void SelectionTree::selectEvent(unsigned long int id, bool mode) {
       selectAllowed = false;
-      treeWidget->setSelectionMode(QAbstractItemView::MultiSelection);
-      if(nodeItemMap.find(id) != nodeItemMap.end()) {
+      treeView->setSelectionMode(QAbstractItemView::MultiSelection);
+      // creates the items on the path to the node if necessary
+      QModelIndex index = model->nodeIndex(id);
+      if(index.isValid()) {
+        QItemSelectionModel *selection = treeView->selectionModel();
         if(mode) {
-          QTreeWidgetItem* parent = nodeItemMap[id]->parent();
-          while(parent) {
-            treeWidget->expandItem(parent);
-            parent = parent->parent();
+          QModelIndex parent = index.parent();
+          while(parent.isValid()) {
+            treeView->expand(parent);
+            parent = parent.parent();
           }
-          treeWidget->setCurrentItem(nodeItemMap[id]);
+          selection->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
+          treeView->scrollTo(index);
         }
-        nodeItemMap[id]->setSelected(mode);
+        selection->select(index, mode ? QItemSelectionModel::Select :
+                          QItemSelectionModel::Deselect);
+        if(mode) selectedNodes.insert(id);
+        else selectedNodes.erase(id);
       }
       selectAllowed = true;
-      treeWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
+      treeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     }
 
     void SelectionTree::addCoreExchange(const std::vector<interfaces::core_objects_exchange> &objects, std::string category) {
       std::vector<interfaces::core_objects_exchange>::const_iterator it;
       std::vector<std::string> path;
       std::vector<std::string>::iterator pt;
-      std::map<std::string, QTreeWidgetItem*> treeMap;
-      QTreeWidgetItem *current, *top, *next;
-      QStringList temp;
-      temp << category.c_str();
-      top = new QTreeWidgetItem(temp);
-      treeWidget->addTopLevelItem(top);
+      std::map<std::string, QModelIndex> treeMap;
+      QModelIndex current, top;
+      top = model->addCategory(category);
       for(it=objects.begin(); it!=objects.end(); ++it) {
         path = explodeString('/', it->name);
         current = top;
         for(pt=path.begin(); pt!=path.end(); ++pt) {
-          temp.clear();
           if(pt==path.end()-1) {
-            temp << QString::number(it->index) + ":" + QString::fromStdString(*pt);
-            current->addChild(new QTreeWidgetItem(temp));
+            model->addItem(current, QString::number(it->index) + ":" + QString::fromStdString(*pt));
           }
           else {
             if(treeMap.find(*pt) == treeMap.end()) {
-              temp << QString::fromStdString(*pt);
-              next = new QTreeWidgetItem(temp);
-              current->addChild(next);
-              treeMap[*pt] = next;
+              treeMap[*pt] = model->addItem(current, QString::fromStdString(*pt));
             }
             current = treeMap[*pt];
           }
@@ -41,16 +41,21 @@
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/core_objects_exchange.h>
 #include <mars/interfaces/graphics/GraphicsEventClient.h>
+#include <mars/interfaces/sim/EntitySubscriberInterface.h>
 
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include "EntityTreeModel.h"
+
+#include <set>
+
+#include <QTreeView>
 #include <mars/config_map_gui/DataWidget.h>
 
 namespace mars {
   namespace plugins {
 
     class SelectionTree : public main_gui::BaseWidget,
-                          public interfaces::GraphicsEventClient {
+                          public interfaces::GraphicsEventClient,
+                          public interfaces::EntitySubscriberInterface {
       Q_OBJECT
 
       public:
@@ -58,20 +63,22 @@ namespace mars {
                     config_map_gui::DataWidget *dw, QWidget *parent = NULL);
       ~SelectionTree();
       void selectEvent(unsigned long int id, bool mode);
+      // called by the EntityManager, possibly from another thread
+      void registerEntity(sim::SimEntity *entity);
 
     private:
       config_map_gui::DataWidget *dw;
       interfaces::ControlCenter *control;
-      bool filled, selectAllowed;
+      bool selectAllowed;
       int editCategory;
       int currentWindowID;
       std::vector<interfaces::core_objects_exchange> simNodes, simJoints;
       std::vector<interfaces::core_objects_exchange> simMotors, simSensors;
       std::vector<interfaces::core_objects_exchange> simControllers;
       std::map<std::string, configmaps::ConfigMap> materialMap, lightMap;
-      std::vector<unsigned long> present;
-      std::map<unsigned long, QTreeWidgetItem*> nodeItemMap;
-      QTreeWidget *treeWidget;
+      std::set<unsigned long> selectedNodes;
+      EntityTreeModel *model;
+      QTreeView *treeView;
       interfaces::NodeData nodeData;
       interfaces::JointData jointData;
       interfaces::MotorData motorData;
@@ -81,10 +88,10 @@ namespace mars {
       configmaps::ConfigMap defaultMaterial, defaultLight;
 
       void closeEvent(QCloseEvent* event);
-      void fill(unsigned long id, QTreeWidgetItem *current = NULL);
       void reset(void);
       void createTree();
       void addCoreExchange(const std::vector<interfaces::core_objects_exchange> &objects, std::string category);
+      QString category(const QModelIndex &index) const;
       void updateNodeMap(configmaps::ConfigMap &map);
 
     signals:
@@ -96,6 +103,7 @@ namespace mars {
       void valueChanged(std::string name, std::string value);
       void deleteEntities(void);
       void update(void);
+      void syncNodes(void);
     };
 
   } // end of namespace plugins
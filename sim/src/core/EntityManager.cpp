@@ -25,6 +25,7 @@
 #include <mars/interfaces/sim/EntitySubscriberInterface.h>
 #include <mars/utils/MutexLocker.h>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -46,6 +47,7 @@ namespace mars {
       unsigned long id = 0;
       MutexLocker locker(&iMutex);
       entities[id = getNextId()] = new SimEntity(control, name);
+      nameIndex.set(id, name);
       notifySubscribers(entities[id]);
       return id;
     }
@@ -54,6 +56,7 @@ namespace mars {
       unsigned long id = 0;
       MutexLocker locker(&iMutex);
       entities[id = getNextId()] = entity;
+      nameIndex.set(id, entity->getName());
       notifySubscribers(entity);
       return id;
     }
@@ -66,21 +69,20 @@ namespace mars {
     }
 
     const std::map<unsigned long, SimEntity*>* EntityManager::subscribeToEntityCreation(interfaces::EntitySubscriberInterface* newsub) {
+      MutexLocker locker(&iMutex);
       subscribers.push_back(newsub);
       return &entities;
     }
 
+    void EntityManager::unsubscribeFromEntityCreation(interfaces::EntitySubscriberInterface* sub) {
+      MutexLocker locker(&iMutex);
+      subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), sub),
+                        subscribers.end());
+    }
+
     void EntityManager::addNode(const std::string& entityName, long unsigned int nodeId,
         const std::string& nodeName) {
-      SimEntity *entity = 0;
-      //iterate over all robots to find the robot with the given name
-      for (std::map<unsigned long, SimEntity*>::iterator iter = entities.begin();
-          iter != entities.end(); ++iter) {
-        if (iter->second->getName() == entityName) {
-          entity = iter->second;
-          break;
-        }
-      }
+      SimEntity *entity = getEntity(entityName);
       if (entity) {
         MutexLocker locker(&iMutex);
         entity->addNode(nodeId, nodeName);
@@ -89,40 +91,28 @@ namespace mars {
 
     void EntityManager::addMotor(const std::string& entityName, long unsigned int motorId,
         const std::string& motorName) {
-      //iterate over all robots to find the robot with the given name
-      for (std::map<unsigned long, SimEntity*>::iterator iter = entities.begin();
-          iter != entities.end(); ++iter) {
-        if (iter->second->getName() == entityName) {
-          MutexLocker locker(&iMutex);
-          iter->second->addMotor(motorId, motorName);
-          break;
-        }
+      SimEntity *entity = getEntity(entityName);
+      if (entity) {
+        MutexLocker locker(&iMutex);
+        entity->addMotor(motorId, motorName);
       }
     }
 
     void EntityManager::addJoint(const std::string& entityName, long unsigned int jointId,
         const std::string& jointName) {
-      //iterate over all robots to find the robot with the given name
-      for (std::map<unsigned long, SimEntity*>::iterator iter = entities.begin();
-          iter != entities.end(); ++iter) {
-        if (iter->second->getName() == entityName) {
-          MutexLocker locker(&iMutex);
-          iter->second->addJoint(jointId, jointName);
-          break;
-        }
+      SimEntity *entity = getEntity(entityName);
+      if (entity) {
+        MutexLocker locker(&iMutex);
+        entity->addJoint(jointId, jointName);
       }
     }
 
     void EntityManager::addController(const std::string& entityName,
         long unsigned int controllerId) {
-      //iterate over all robots to find the robot with the given name
-      for (std::map<unsigned long, SimEntity*>::iterator iter = entities.begin();
-          iter != entities.end(); ++iter) {
-        if (iter->second->getName() == entityName) {
-          MutexLocker locker(&iMutex);
-          iter->second->addController(controllerId);
-          break;
-        }
+      SimEntity *entity = getEntity(entityName);
+      if (entity) {
+        MutexLocker locker(&iMutex);
+        entity->addController(controllerId);
       }
     }
 
@@ -144,22 +134,13 @@ namespace mars {
     }
 
     SimEntity* EntityManager::getEntity(const std::string& name) {
-      for (std::map<unsigned long, SimEntity*>::iterator iter = entities.begin();
-          iter != entities.end(); ++iter) {
-        if (iter->second->getName() == name) {
-          return iter->second;
-        }
-      }
-      return 0;
+      return getEntity(nameIndex.find(name));
     }
 
     SimEntity* EntityManager::getEntity(long unsigned int id) {
-      //TODO replace with find
-      for (std::map<unsigned long, SimEntity*>::iterator iter = entities.begin();
-          iter != entities.end(); ++iter) {
-        if (iter->first == id) {
-          return iter->second;
-        }
+      std::map<unsigned long, SimEntity*>::iterator iter = entities.find(id);
+      if (iter != entities.end()) {
+        return iter->second;
       }
       return 0;
     }
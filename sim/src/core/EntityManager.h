@@ -29,14 +29,14 @@
  * TODO delete robots after use
  * TODO handle node deletion (see NodeManager)
  * TODO allow to add nodes to robots via their ids instead of names;
- * TODO possible optimization store the index(iterator) of the last accessed robot as 
- *      it is likely to be accessed again while nodes and motors are added
  */
 
 #ifndef ENTITY_MANAGER_H
 #define ENTITY_MANAGER_H
 
 #include <map>
+#include "ObjectIndex.h"
+
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/graphics/GraphicsEventClient.h>
 #include <mars/interfaces/sim/EntityManagerInterface.h>
@@ -78,6 +78,7 @@ namespace mars {
        */
       // callback for entity creation
       virtual const std::map<unsigned long, SimEntity*>* subscribeToEntityCreation(interfaces::EntitySubscriberInterface* newsub);
+      virtual void unsubscribeFromEntityCreation(interfaces::EntitySubscriberInterface* sub);
 
       virtual SimEntity* getEntity(const std::string &name);
 
@@ -113,6 +114,8 @@ namespace mars {
       /**the id assigned to the next created entity; use getNextId function*/
       unsigned long next_entity_id;
       std::map<unsigned long, SimEntity*> entities;
+      // entity name -> ids; the callers resolve entities by name
+      ObjectIndex<std::string> nameIndex;
 
       /**returns the id to be assigned to the next entity*/
       unsigned long getNextId() {
@@ -120,6 +120,7 @@ namespace mars {
         //    newJoint->setSJoint(*jointS);
         newJoint->setPhysicalJoint(newJointInterface);
         simJoints[jointS->index] = newJoint;
+        addToIndex(*jointS);
         iMutex.unlock();
         control->sim->sceneHasChanged(false);
         return jointS->index;
@@ -193,6 +194,7 @@ namespace mars {
 
       if (iter != simJoints.end()) {
         tmpJoint = iter->second;
+        removeFromIndex(tmpJoint->getSJoint());
         simJoints.erase(iter);
       }
 
@@ -239,15 +241,26 @@ namespace mars {
     }
 
 
+    std::vector<SimJoint*> JointManager::getSimJointsOfNode(unsigned long node_id) {
+      vector<SimJoint*> v_simJoints;
+      MutexLocker locker(&iMutex);
+      map<unsigned long, set<unsigned long> >::iterator it = nodeJoints.find(node_id);
+      if (it == nodeJoints.end())
+        return v_simJoints;
+      set<unsigned long>::iterator jt;
+      for (jt = it->second.begin(); jt != it->second.end(); ++jt)
+        v_simJoints.push_back(simJoints[*jt]);
+      return v_simJoints;
+    }
+
     void JointManager::reattacheJoints(unsigned long node_id) {
-      map<unsigned long, SimJoint*>::iterator iter;
       MutexLocker locker(&iMutex);
-      for (iter = simJoints.begin(); iter != simJoints.end(); iter++) {
-        if (iter->second->getSJoint().nodeIndex1 == node_id ||
-            iter->second->getSJoint().nodeIndex2 == node_id) {
-          iter->second->reattachJoint();
-        }
-      }
+      map<unsigned long, set<unsigned long> >::iterator it = nodeJoints.find(node_id);
+      if (it == nodeJoints.end())
+        return;
+      set<unsigned long>::iterator jt;
+      for (jt = it->second.begin(); jt != it->second.end(); ++jt)
+        simJoints[*jt]->reattachJoint();
     }
 
     void JointManager::reloadJoints(void) {
@@ -275,11 +288,30 @@ namespace mars {
         delete simJoints.begin()->second;
         simJoints.erase(simJoints.begin());
       }
+      nameIndex.clear();
+      nodeJoints.clear();
       control->sim->sceneHasChanged(false);
 
       next_joint_id = 1;
     }
 
+    void JointManager::addToIndex(const JointData &joint) {
+      nameIndex.set(joint.index, joint.name);
+      if (joint.nodeIndex1) nodeJoints[joint.nodeIndex1].insert(joint.index);
+      if (joint.nodeIndex2) nodeJoints[joint.nodeIndex2].insert(joint.index);
+    }
+
+    void JointManager::removeFromIndex(const JointData &joint) {
+      unsigned long nodes[2] = {joint.nodeIndex1, joint.nodeIndex2};
+      nameIndex.remove(joint.index);
+      for (int i = 0; i < 2; ++i) {
+        map<unsigned long, set<unsigned long> >::iterator it = nodeJoints.find(nodes[i]);
+        if (it == nodeJoints.end()) continue;
+        it->second.erase(joint.index);
+        if (it->second.empty()) nodeJoints.erase(it);
+      }
+    }
+
     std::list<JointData>::iterator JointManager::getReloadJoint(unsigned long id) {
       std::list<JointData>::iterator iter = simJointsReload.begin();
       for(;iter!=simJointsReload.end(); ++iter) {
@@ -377,14 +409,8 @@ namespace mars {
 
 
     unsigned long JointManager::getID(const std::string& joint_name) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
       MutexLocker locker(&iMutex);
-      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
-        JointData joint = iter->second->getSJoint();
-        if (joint.name == joint_name)
-          return joint.index;
-      }
-      return 0;
+      return nameIndex.find(joint_name);
     }
 
     bool JointManager::getDataBrokerNames(unsigned long id, std::string *groupName,
@@ -550,5 +576,28 @@ namespace mars {
       }
     }
 
+    void JointManager::saveState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      map<unsigned long, SimJoint*>::iterator iter;
+      state->write(simJoints.size());
+      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
+        state->write(iter->first);
+        iter->second->saveState(state);
+      }
+    }
+
+    bool JointManager::restoreState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      map<unsigned long, SimJoint*>::iterator iter;
+      size_t numJoints;
+      unsigned long id;
+      if(!state->read(&numJoints) || numJoints != simJoints.size()) return false;
+      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
+        if(!state->read(&id) || id != iter->first) return false;
+        if(!iter->second->restoreState(state)) return false;
+      }
+      return true;
+    }
+
   } // end of namespace sim
 } // end of namespace mars
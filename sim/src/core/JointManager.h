@@ -33,6 +33,8 @@
   #warning "JointManager.h"
 #endif
 
+#include "ObjectIndex.h"
+
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/JointManagerInterface.h>
 #include <mars/utils/Mutex.h>
@@ -59,6 +61,7 @@ namespace mars {
       virtual void removeJointByIDs(unsigned long id1, unsigned long id2);
       virtual SimJoint* getSimJoint(unsigned long id);
       virtual std::vector<SimJoint*> getSimJoints(void);
+      virtual std::vector<SimJoint*> getSimJointsOfNode(unsigned long node_id);
       virtual void reattacheJoints(unsigned long node_id);
       virtual void reloadJoints(void);
       virtual void updateJoints(interfaces::sReal calc_ms);
@@ -91,15 +94,22 @@ namespace mars {
       virtual void setHighStop2(unsigned long id, interfaces::sReal highStop2);
       virtual void edit(interfaces::JointId id, const std::string &key,
                         const std::string &value);
+      virtual void saveState(interfaces::StateBuffer *state);
+      virtual bool restoreState(interfaces::StateBuffer *state);
 
     private:
       unsigned long next_joint_id;
       std::map<unsigned long, SimJoint*> simJoints;
+      ObjectIndex<std::string> nameIndex;
+      // the ids of the joints attached to a node (node 0 is not indexed)
+      std::map<unsigned long, std::set<unsigned long> > nodeJoints;
       std::list<interfaces::JointData> simJointsReload;
       interfaces::ControlCenter *control;
       mutable utils::Mutex iMutex;
       interfaces::JointManagerInterface* getJointInterface(unsigned long node_id);
       std::list<interfaces::JointData>::iterator getReloadJoint(unsigned long id);
+      void addToIndex(const interfaces::JointData &joint);
+      void removeFromIndex(const interfaces::JointData &joint);
 
     };
 
@@ -96,6 +96,7 @@ namespace mars {
       newMotor->setSMotor(*motorS);
       iMutex.lock();
       simMotors[newMotor->getIndex()] = newMotor;
+      nameIndex.set(newMotor->getIndex(), newMotor->getName());
       iMutex.unlock();
       control->sim->sceneHasChanged(false);
 
@@ -168,8 +169,10 @@ namespace mars {
     void MotorManager::editMotor(const MotorData &motorS) {
       MutexLocker locker(&iMutex);
       map<unsigned long, SimMotor*>::iterator iter = simMotors.find(motorS.index);
-      if (iter != simMotors.end())
+      if (iter != simMotors.end()) {
         iter->second->setSMotor(motorS);
+        nameIndex.set(motorS.index, iter->second->getName());
+      }
     }
 
 
@@ -226,6 +229,7 @@ namespace mars {
       if (iter != simMotors.end()) {
         tmpMotor = iter->second;
         simMotors.erase(iter);
+        nameIndex.remove(index);
         if (tmpMotor)
           delete tmpMotor;
       }
@@ -273,9 +277,9 @@ namespace mars {
     SimMotor* MotorManager::getSimMotorByName(const std::string &name) const {
       MutexLocker locker(&iMutex);
       std::map<unsigned long, SimMotor*>::const_iterator iter;
-      for (iter = simMotors.begin(); iter != simMotors.end(); iter++)
-        if (iter->second->getName() == name)
-          return iter->second;
+      iter = simMotors.find(nameIndex.find(name));
+      if (iter != simMotors.end())
+        return iter->second;
       return NULL;
     }
 
@@ -386,14 +390,8 @@ namespace mars {
      * \return Id of the motor if it exists, otherwise 0
      */
     unsigned long MotorManager::getID(const std::string& name) const {
-      map<unsigned long, SimMotor*>::const_iterator iter;
       MutexLocker locker(&iMutex);
-
-      for (iter = simMotors.begin(); iter != simMotors.end(); iter++) {
-        if (iter->second->getName() == name)
-          return iter->first;
-      }
-      return 0;
+      return nameIndex.find(name);
     }
 
 
@@ -431,6 +429,7 @@ namespace mars {
       for(iter = simMotors.begin(); iter != simMotors.end(); iter++)
         delete iter->second;
       simMotors.clear();
+      nameIndex.clear();
       mimicmotors.clear();
       if(clear_all) simMotorsReload.clear();
       next_motor_id = 1;
@@ -579,5 +578,28 @@ namespace mars {
       }
     }
 
+    void MotorManager::saveState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      map<unsigned long, SimMotor*>::iterator iter;
+      state->write(simMotors.size());
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        state->write(iter->first);
+        iter->second->saveState(state);
+      }
+    }
+
+    bool MotorManager::restoreState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      map<unsigned long, SimMotor*>::iterator iter;
+      size_t numMotors;
+      unsigned long id;
+      if(!state->read(&numMotors) || numMotors != simMotors.size()) return false;
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        if(!state->read(&id) || id != iter->first) return false;
+        if(!iter->second->restoreState(state)) return false;
+      }
+      return true;
+    }
+
   } // end of namespace sim
 } // end of namespace mars
@@ -38,6 +38,8 @@
   #warning "MotorManager.h"
 #endif
 
+#include "ObjectIndex.h"
+
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/MotorManagerInterface.h>
 #include <mars/utils/Mutex.h>
@@ -316,6 +318,8 @@ namespace mars {
       virtual void connectMimics();
       virtual void edit(interfaces::MotorId id, const std::string &key,
                         const std::string &value);
+      virtual void saveState(interfaces::StateBuffer *state);
+      virtual bool restoreState(interfaces::StateBuffer *state);
 
     private:
       //! the id of the next motor that is added to the simulation
@@ -324,6 +328,9 @@ namespace mars {
       //! a container for all motors currently present in the simulation
       std::map<unsigned long, SimMotor*> simMotors;
 
+      //! the ids of the motors in simMotors by name
+      ObjectIndex<std::string> nameIndex;
+
       //! a containter for all motors that are reloaded after a reset of the simulation
       std::list<interfaces::MotorData> simMotorsReload;
 
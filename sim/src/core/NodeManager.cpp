@@ -36,12 +36,14 @@
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/terrainStruct.h>
 #include <mars/interfaces/Logging.hpp>
+#include <mars/cfg_manager/CFGManagerInterface.h>
 
 #include <lib_manager/LibManager.hpp>
 
 #include <mars/interfaces/utils.h>
 #include <mars/utils/mathUtils.h>
 #include <mars/utils/misc.h>
+#include <mars/utils/TiledHeightMap.h>
 
 #include <stdexcept>
 
@@ -67,6 +69,7 @@ namespace mars {
                                                  next_node_id(1),
                                                  update_all_nodes(false),
                                                  visual_rep(1),
+                                                 numSleepingNodes(0),
                                                  maxGroupID(0),
                                                  control(c),
                                                  libManager(theManager)
@@ -123,6 +126,7 @@ namespace mars {
           }
           reloadNode.terrain = new(terrainStruct);
           *(reloadNode.terrain) = *(nodeS->terrain);
+          reloadNode.terrain->heightMap = NULL;
           control->loadCenter->loadHeightmap->readPixelData(reloadNode.terrain);
           if(!reloadNode.terrain->pixelData) {
             LOG_ERROR("NodeManager::addNode: could not load image for terrain");
@@ -151,7 +155,8 @@ namespace mars {
       }
 
       // convert obj to ode mesh
-      if((nodeS->physicMode == NODE_TYPE_MESH) && (nodeS->terrain == 0) ) {
+      if((nodeS->physicMode == NODE_TYPE_MESH) && (nodeS->terrain == 0) &&
+         !getPhysicsFromBinaryMesh(nodeS)) {
         if(!control->loadCenter) {
           LOG_ERROR("NodeManager:: loadCenter is missing, can not create Node");
           return INVALID_ID;
@@ -171,6 +176,19 @@ namespace mars {
         }
         control->loadCenter->loadMesh->getPhysicsFromMesh(nodeS);
       }
+      if((nodeS->physicMode == NODE_TYPE_MESH) && (nodeS->terrain == 0) &&
+         nodeS->movable && nodeS->collision_proxy != COLLISION_PROXY_NONE) {
+        std::string cacheDir;
+        if(control->cfg) {
+          cacheDir = control->cfg->getOrCreateProperty("Simulator",
+                                                       "collision proxy cache",
+                                                       std::string("")).sValue;
+        }
+        if(!getCollisionProxies(nodeS, cacheDir)) {
+          LOG_WARN("NodeManager::addNode: could not decompose the mesh of "
+                   "node \"%s\"; using the trimesh", nodeS->name.c_str());
+        }
+      }
       if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain ) {
         if(!nodeS->terrain->pixelData) {
           if(!control->loadCenter) {
@@ -197,6 +215,13 @@ namespace mars {
             return INVALID_ID;
           }
         }
+        if(!nodeS->terrain->heightMap) {
+          terrainStruct *t = nodeS->terrain;
+          t->heightMap = new utils::TiledHeightMap(t->width, t->height,
+                                                   t->targetWidth,
+                                                   t->targetHeight);
+          t->heightMap->setHeights(t->pixelData, t->scale);
+        }
       }
 
       // this should be done somewhere else
@@ -231,6 +256,7 @@ namespace mars {
         simNodes[nodeS->index] = newNode;
         if (nodeS->movable)
           simNodesDyn[nodeS->index] = newNode;
+        updateIndex(newNode);
         iMutex.unlock();
         control->sim->sceneHasChanged(false);
         NodeId id;
@@ -288,6 +314,7 @@ namespace mars {
         simNodes[nodeS->index] = newNode;
         if (nodeS->movable)
           simNodesDyn[nodeS->index] = newNode;
+        updateIndex(newNode);
         iMutex.unlock();
         control->sim->sceneHasChanged(false);
         if(control->graphics) {
@@ -316,6 +343,7 @@ namespace mars {
     NodeId NodeManager::addTerrain(terrainStruct* terrain) {
       NodeData newNode;
       terrainStruct *newTerrain = new terrainStruct(*terrain);
+      newTerrain->heightMap = NULL;
       sRotation trot = {0, 0, 0};
 
       newNode.name = terrain->name;
@@ -618,6 +646,7 @@ namespace mars {
       if (iter != simNodes.end()) {
         tmpNode = iter->second; //iter->second is a pointer to the SimNode associated with the map
         simNodes.erase(iter);
+        removeFromIndex(id);
       }
 
       iter = nodesToUpdate.find(id);
@@ -718,6 +747,27 @@ namespace mars {
     }
 
 
+    void NodeManager::getPoses(const std::vector<NodeId> &ids,
+                               std::vector<Vector> *positions,
+                               std::vector<Quaternion> *rotations) const {
+      positions->resize(ids.size());
+      rotations->resize(ids.size());
+      MutexLocker locker(&iMutex);
+      NodeMap::const_iterator iter;
+      for(size_t i=0; i<ids.size(); ++i) {
+        iter = simNodes.find(ids[i]);
+        if(iter != simNodes.end()) {
+          (*positions)[i] = iter->second->getPosition();
+          (*rotations)[i] = iter->second->getRotation();
+        }
+        else {
+          (*positions)[i] = Vector(0.0, 0.0, 0.0);
+          (*rotations)[i] = Quaternion::Identity();
+        }
+      }
+    }
+
+
     const Vector NodeManager::getLinearVelocity(NodeId id) const {
       Vector vel(0.0,0.0,0.0);
       MutexLocker locker(&iMutex);
@@ -1135,6 +1185,7 @@ namespace mars {
         if(tmp.terrain) {
           tmp.terrain = new(terrainStruct);
           *(tmp.terrain) = *(iter->terrain);
+          tmp.terrain->heightMap = NULL;
           tmp.terrain->pixelData = (double*)calloc((tmp.terrain->width*
                                                      tmp.terrain->height),
                                                     sizeof(double));
@@ -1206,11 +1257,26 @@ namespace mars {
     void NodeManager::updateDynamicNodes(sReal calc_ms, bool physics_thread) {
       MutexLocker locker(&iMutex);
       NodeMap::iterator iter;
+      bool wasSleeping;
+      numSleepingNodes = 0;
       for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
+        wasSleeping = iter->second->isSleeping();
         iter->second->update(calc_ms, physics_thread);
+        if(iter->second->isSleeping()) {
+          numSleepingNodes++;
+          // the graphics get the resting pose once
+          if(!wasSleeping) nodesToUpdate[iter->first] = iter->second;
+        }
       }
     }
 
+    void NodeManager::getSleepingStats(unsigned long *numSleeping,
+                                       unsigned long *numDynamic) const {
+      MutexLocker locker(&iMutex);
+      *numSleeping = numSleepingNodes;
+      *numDynamic = simNodesDyn.size();
+    }
+
     void NodeManager::preGraphicsUpdate() {
       NodeMap::iterator iter;
       if(!control->graphics)
@@ -1232,6 +1298,7 @@ namespace mars {
       }
       else {
         for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
+          if(iter->second->isSleeping()) continue;
           control->graphics->setDrawObjectPos(iter->second->getGraphicsID(),
                                               iter->second->getVisualPosition());
           control->graphics->setDrawObjectRot(iter->second->getGraphicsID(),
@@ -1266,6 +1333,8 @@ namespace mars {
         removeNode(simNodes.begin()->first, false, clearGraphics);
       simNodes.clear();
       simNodesDyn.clear();
+      nameIndex.clear();
+      groupIndex.clear();
       if(clear_all) simNodesReload.clear();
       next_node_id = 1;
       iMutex.unlock();
@@ -1492,17 +1561,24 @@ namespace mars {
     }
 
     NodeId NodeManager::getID(const std::string& node_name) const {
+      MutexLocker locker(&iMutex);
+      return nameIndex.find(node_name);
+    }
 
-      iMutex.lock();
-      NodeMap::const_iterator iter;
-      for(iter = simNodes.begin(); iter != simNodes.end(); iter++) {
-        if (iter->second->getName() == node_name)  {
-          iMutex.unlock();
-          return iter->first;
-        }
-      }
-      iMutex.unlock();
-      return INVALID_ID;
+    /**
+     * \brief Updates the name and group index of \a node. The caller has to
+     *        hold iMutex.
+     */
+    void NodeManager::updateIndex(const SimNode *node) {
+      NodeId id = node->getID();
+      nameIndex.set(id, node->getName());
+      if(node->getGroupID() != 0) groupIndex.set(id, node->getGroupID());
+      else groupIndex.remove(id);
+    }
+
+    void NodeManager::removeFromIndex(NodeId id) {
+      nameIndex.remove(id);
+      groupIndex.remove(id);
     }
 
     void NodeManager::pushToUpdate(SimNode* node) {
@@ -1522,12 +1598,11 @@ namespace mars {
         return connected;
 
       SimNode* current = iter->second;
-      std::vector<SimJoint*> simJoints = control->joints->getSimJoints();
+      std::vector<SimJoint*> simJoints = control->joints->getSimJointsOfNode(id);
 
-      if (current->getGroupID() != 0)
-        for (iter = simNodes.begin(); iter != simNodes.end(); iter++)
-          if (iter->second->getGroupID() == current->getGroupID())
-            connected.push_back(iter->first);
+      const ObjectIndex<int>::IdSet *group = groupIndex.get(current->getGroupID());
+      if (group)
+        connected.insert(connected.end(), group->begin(), group->end());
 
       for (size_t i = 0; i < simJoints.size(); i++) {
         if (simJoints[i]->getAttachedNode() &&
@@ -1821,13 +1896,15 @@ namespace mars {
         control->graphics->setDrawObjectScale(editedNode->getGraphicsID2(), nodeS->ext);
       }
       editedNode->changeNode(nodeS);
-      if(sNode.groupID != 0 || nodeS->groupID != 0) {
-        for(auto it: simNodes) {
-          if(it.second->getGroupID() == sNode.groupID ||
-             it.second->getGroupID() == nodeS->groupID) {
-            control->joints->reattacheJoints(it.second->getID());
-          }
-        }
+      updateIndex(editedNode);
+      std::set<NodeId> groupNodes;
+      const ObjectIndex<int>::IdSet *group = groupIndex.get(sNode.groupID);
+      if(group) groupNodes.insert(group->begin(), group->end());
+      group = groupIndex.get(nodeS->groupID);
+      if(group) groupNodes.insert(group->begin(), group->end());
+      for(std::set<NodeId>::iterator it = groupNodes.begin();
+          it != groupNodes.end(); ++it) {
+        control->joints->reattacheJoints(*it);
       }
       control->joints->reattacheJoints(nodeS->index);
 
@@ -1836,5 +1913,33 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Stores the dynamic state of all nodes ordered by their id.
+     */
+    void NodeManager::saveState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      NodeMap::iterator iter;
+      state->write(simNodes.size());
+      for(iter = simNodes.begin(); iter != simNodes.end(); iter++) {
+        state->write(iter->first);
+        iter->second->saveState(state);
+      }
+    }
+
+    bool NodeManager::restoreState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      NodeMap::iterator iter;
+      size_t numNodes;
+      NodeId id;
+      if(!state->read(&numNodes) || numNodes != simNodes.size()) return false;
+      for(iter = simNodes.begin(); iter != simNodes.end(); iter++) {
+        if(!state->read(&id) || id != iter->first) return false;
+        if(!iter->second->restoreState(state)) return false;
+      }
+      // also move the static nodes in the graphics
+      update_all_nodes = true;
+      return true;
+    }
+
   } // end of namespace sim
 } // end of namespace mars
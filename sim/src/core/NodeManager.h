@@ -32,6 +32,8 @@
   #warning "NodeManager.h"
 #endif
 
+#include "ObjectIndex.h"
+
 #include <mars/utils/Mutex.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
@@ -87,6 +89,9 @@ namespace mars {
       virtual const utils::Vector getPosition(interfaces::NodeId id) const;
       virtual void setRotation(interfaces::NodeId id, const utils::Quaternion &rot);
       virtual const utils::Quaternion getRotation(interfaces::NodeId id) const;
+      virtual void getPoses(const std::vector<interfaces::NodeId> &ids,
+                            std::vector<utils::Vector> *positions,
+                            std::vector<utils::Quaternion> *rotations) const;
       virtual const utils::Vector getLinearVelocity(interfaces::NodeId id) const;
       virtual const utils::Vector getAngularVelocity(interfaces::NodeId id) const;
       virtual const utils::Vector getLinearAcceleration(interfaces::NodeId id) const;
@@ -106,6 +111,8 @@ namespace mars {
       virtual void setReloadFriction(interfaces::NodeId id, interfaces::sReal friction1,
                                      interfaces::sReal friction2);
       virtual void updateDynamicNodes(interfaces::sReal calc_ms, bool physics_thread = true);
+      virtual void getSleepingStats(unsigned long *numSleeping,
+                                    unsigned long *numDynamic) const;
       virtual void clearAllNodes(bool clear_all=false, bool clearGraphics=true);
       virtual void setReloadAngle(interfaces::NodeId id, const utils::sRotation &angle);
       virtual void setContactParams(interfaces::NodeId id, const interfaces::contact_params &cp);
@@ -158,6 +165,8 @@ namespace mars {
       virtual unsigned long getMaxGroupID() { return maxGroupID; }
       virtual void edit(interfaces::NodeId id, const std::string &key,
                         const std::string &value);
+      virtual void saveState(interfaces::StateBuffer *state);
+      virtual bool restoreState(interfaces::StateBuffer *state);
 
     private:
       interfaces::NodeId next_node_id;
@@ -166,6 +175,10 @@ namespace mars {
       NodeMap simNodes;
       NodeMap simNodesDyn;
       NodeMap nodesToUpdate;
+      unsigned long numSleepingNodes;
+      // name and group (without group 0) of the nodes in simNodes
+      ObjectIndex<std::string> nameIndex;
+      ObjectIndex<int> groupIndex;
       std::list<interfaces::NodeData> simNodesReload;
       unsigned long maxGroupID;
       lib_manager::LibManager *libManager;
@@ -215,6 +228,8 @@ namespace mars {
       void removeNode(interfaces::NodeId id, bool lock,
                       bool clearGraphics=true);
       void pushToUpdate(SimNode* node);
+      void updateIndex(const SimNode *node);
+      void removeFromIndex(interfaces::NodeId id);
 
       void printNodeMasses(bool onlysum);
       void changeNode(SimNode *editedNode, interfaces::NodeData *nodeS);
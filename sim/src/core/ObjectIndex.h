@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file ObjectIndex.h
+ * \brief Secondary index (e.g. name or group) over the ids of the objects
+ *        stored in one of the managers.
+ */
+
+#ifndef OBJECT_INDEX_H
+#define OBJECT_INDEX_H
+
+#ifdef _PRINT_HEADER_
+  #warning "ObjectIndex.h"
+#endif
+
+#include <cstddef>
+#include <map>
+#include <set>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * \brief Maps a key to the ids of all objects that currently have that
+     *        key.
+     *
+     * Several objects may share the same key (e.g. nodes with the same
+     * name). find() then returns the smallest id, which is the object a
+     * linear search over the id ordered manager maps would have found. The
+     * index does no locking, it is guarded by the mutex of its manager.
+     *
+     * The ids of a key have to be ordered, hence the std::set. The keys use
+     * a std::map as well, since mars_sim is not built with C++11 flags and
+     * std::unordered_map is not available with older compilers. The
+     * lookups are only used to resolve a name once; per step the callers
+     * keep the resolved id or Sim* pointer.
+     */
+    template <typename Key>
+    class ObjectIndex {
+    public:
+      typedef std::set<unsigned long> IdSet;
+
+      /** \brief adds \a id or moves it to \a key if it is already indexed */
+      void set(unsigned long id, const Key &key) {
+        typename std::map<unsigned long, Key>::iterator it = keys.find(id);
+        if(it != keys.end()) {
+          if(it->second == key) return;
+          erase(id, it->second);
+          it->second = key;
+        }
+        else {
+          keys[id] = key;
+        }
+        ids[key].insert(id);
+      }
+
+      void remove(unsigned long id) {
+        typename std::map<unsigned long, Key>::iterator it = keys.find(id);
+        if(it == keys.end()) return;
+        erase(id, it->second);
+        keys.erase(it);
+      }
+
+      /** \return the smallest id stored for \a key or 0 */
+      unsigned long find(const Key &key) const {
+        const IdSet *set = get(key);
+        return set ? *set->begin() : 0;
+      }
+
+      /** \return all ids stored for \a key or \c NULL */
+      const IdSet* get(const Key &key) const {
+        typename std::map<Key, IdSet>::const_iterator it = ids.find(key);
+        return it != ids.end() ? &it->second : NULL;
+      }
+
+      void clear() {
+        ids.clear();
+        keys.clear();
+      }
+
+    private:
+      void erase(unsigned long id, const Key &key) {
+        typename std::map<Key, IdSet>::iterator it = ids.find(key);
+        if(it == ids.end()) return;
+        it->second.erase(id);
+        if(it->second.empty()) ids.erase(it);
+      }
+
+      std::map<Key, IdSet> ids;
+      std::map<unsigned long, Key> keys;
+    }; // end of class ObjectIndex
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif // OBJECT_INDEX_H
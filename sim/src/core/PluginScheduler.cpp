@@ -0,0 +1,344 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "PluginScheduler.h"
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/misc.h>
+#include <mars/utils/Trace.h>
+
+namespace mars {
+  namespace sim {
+
+    using namespace utils;
+    using namespace interfaces;
+
+    static const int NUM_BUCKETS = 9;
+    static const double bucketLimits[NUM_BUCKETS-1] = {0.1, 0.5, 1, 2, 5,
+                                                       10, 20, 50};
+    static const char *bucketNames[NUM_BUCKETS] = {"<0.1ms", "<0.5ms",
+                                                   "<1ms", "<2ms", "<5ms",
+                                                   "<10ms", "<20ms",
+                                                   "<50ms", ">=50ms"};
+    // the latency is published every PUBLISH_INTERVAL updates
+    static const unsigned long PUBLISH_INTERVAL = 20;
+
+    static bool intersects(const std::set<std::string> &a,
+                           const std::set<std::string> &b) {
+      std::set<std::string>::const_iterator it = a.begin(), jt = b.begin();
+      while(it != a.end() && jt != b.end()) {
+        if(*it < *jt) ++it;
+        else if(*jt < *it) ++jt;
+        else return true;
+      }
+      return false;
+    }
+
+    static bool conflicts(const PluginUpdatePolicy &a,
+                          const PluginUpdatePolicy &b) {
+      return (intersects(a.writes, b.writes) || intersects(a.writes, b.reads) ||
+              intersects(a.reads, b.writes));
+    }
+
+    struct PluginScheduler::Record {
+      pluginStruct plugin;
+      PluginUpdatePolicy policy;
+      sReal elapsed;
+      sReal queuedTime;
+      AsyncThread *thread;
+      unsigned long updates;
+      double sum, max;
+      unsigned long histogram[NUM_BUCKETS];
+      unsigned long dbId;
+      data_broker::DataPackage dbPackage;
+      const char *traceName;
+    };
+
+    class PluginScheduler::Worker : public Thread {
+    public:
+      Worker(PluginScheduler *scheduler, unsigned long generation)
+        : scheduler(scheduler), generation(generation) {}
+
+    protected:
+      void run() {
+        Trace::setThreadName("plugin worker");
+        scheduler->workerLoop(generation);
+      }
+
+    private:
+      PluginScheduler *scheduler;
+      unsigned long generation;
+    };
+
+    /**
+     * Runs the updates of an asynchronous plugin. If the plugin is
+     * triggered while it is still updating, the time is added to the next
+     * update.
+     */
+    class PluginScheduler::AsyncThread : public Thread {
+    public:
+      AsyncThread(PluginScheduler *scheduler, Record *record)
+        : scheduler(scheduler), record(record), pending(0), due(false),
+          quit(false) {}
+
+      void trigger(sReal time_ms) {
+        mutex.lock();
+        pending += time_ms;
+        due = true;
+        condition.wakeOne();
+        mutex.unlock();
+      }
+
+      void stop() {
+        mutex.lock();
+        quit = true;
+        condition.wakeOne();
+        mutex.unlock();
+        wait();
+      }
+
+    protected:
+      void run() {
+        Trace::setThreadName(record->plugin.name);
+        mutex.lock();
+        while(true) {
+          while(!due && !quit) condition.wait(&mutex);
+          if(quit) break;
+          sReal time_ms = pending;
+          pending = 0;
+          due = false;
+          mutex.unlock();
+          scheduler->update(record, time_ms);
+          mutex.lock();
+        }
+        mutex.unlock();
+      }
+
+    private:
+      PluginScheduler *scheduler;
+      Record *record;
+      Mutex mutex;
+      WaitCondition condition;
+      sReal pending;
+      bool due, quit;
+    };
+
+    PluginScheduler::PluginScheduler(ControlCenter *control)
+      : control(control), nextTask(0), busyWorkers(0), generation(0),
+        quit(false) {
+    }
+
+    PluginScheduler::~PluginScheduler() {
+      while(!records.empty()) {
+        removePlugin(records.begin()->first);
+      }
+      mutex.lock();
+      quit = true;
+      startCondition.wakeAll();
+      mutex.unlock();
+      for(size_t i=0; i<workers.size(); ++i) {
+        workers[i]->wait();
+        delete workers[i];
+      }
+    }
+
+    void PluginScheduler::addPlugin(const pluginStruct &plugin) {
+      if(records.count(plugin.p_interface)) return;
+      Record *record = new Record;
+      record->plugin = plugin;
+      record->policy = plugin.p_interface->getUpdatePolicy();
+      record->elapsed = record->queuedTime = 0;
+      record->thread = NULL;
+      record->updates = 0;
+      record->sum = record->max = 0;
+      for(int i=0; i<NUM_BUCKETS; ++i) record->histogram[i] = 0;
+      record->dbId = 0;
+      record->traceName = Trace::intern(plugin.name);
+      record->dbPackage.add("updates", 0ul);
+      record->dbPackage.add("mean", 0.0);
+      record->dbPackage.add("max", 0.0);
+      for(int i=0; i<NUM_BUCKETS; ++i) {
+        record->dbPackage.add(bucketNames[i], 0ul);
+      }
+      if(control->dataBroker) {
+        record->dbId = control->dataBroker->pushData("mars_sim",
+                                                     "plugins/" + plugin.name +
+                                                     "/latency",
+                                                     record->dbPackage, NULL,
+                                                     data_broker::DATA_PACKAGE_READ_FLAG);
+      }
+      if(record->policy.thread == PLUGIN_THREAD_ASYNC) {
+        record->thread = new AsyncThread(this, record);
+        record->thread->start();
+      }
+      records[plugin.p_interface] = record;
+    }
+
+    void PluginScheduler::removePlugin(PluginInterface *plugin) {
+      std::map<PluginInterface*, Record*>::iterator it = records.find(plugin);
+      if(it == records.end()) return;
+      if(it->second->thread) {
+        it->second->thread->stop();
+        delete it->second->thread;
+      }
+      delete it->second;
+      records.erase(it);
+    }
+
+    bool PluginScheduler::schedule(PluginInterface *plugin, sReal calc_ms,
+                                   sReal *time_ms) {
+      std::map<PluginInterface*, Record*>::iterator it = records.find(plugin);
+      if(it == records.end()) {
+        *time_ms = calc_ms;
+        return true;
+      }
+      Record *record = it->second;
+      record->elapsed += calc_ms;
+      if(record->elapsed < record->policy.period_ms) return false;
+      *time_ms = record->elapsed;
+      record->elapsed = 0;
+      switch(record->policy.thread) {
+      case PLUGIN_THREAD_PARALLEL:
+        record->queuedTime = *time_ms;
+        queued.push_back(record);
+        return false;
+      case PLUGIN_THREAD_ASYNC:
+        record->thread->trigger(*time_ms);
+        return false;
+      default:
+        return true;
+      }
+    }
+
+    void PluginScheduler::runPlugin(PluginInterface *plugin, sReal time_ms) {
+      std::map<PluginInterface*, Record*>::iterator it = records.find(plugin);
+      if(it == records.end()) plugin->update(time_ms);
+      else update(it->second, time_ms);
+    }
+
+    static size_t findRoot(std::vector<size_t> &parent, size_t i) {
+      while(parent[i] != i) i = parent[i];
+      return i;
+    }
+
+    /**
+     * Plugins that conflict in their read and write sets, directly or
+     * through other plugins, are put into the same task and updated in the
+     * order they were queued.
+     */
+    void PluginScheduler::runParallel(void) {
+      if(queued.empty()) return;
+      std::vector<size_t> parent(queued.size());
+      std::map<size_t, size_t> taskOfRoot;
+      tasks.clear();
+      for(size_t i=0; i<queued.size(); ++i) {
+        parent[i] = i;
+        for(size_t k=0; k<i; ++k) {
+          if(conflicts(queued[i]->policy, queued[k]->policy)) {
+            parent[findRoot(parent, i)] = findRoot(parent, k);
+          }
+        }
+      }
+      for(size_t i=0; i<queued.size(); ++i) {
+        size_t root = findRoot(parent, i);
+        if(!taskOfRoot.count(root)) {
+          taskOfRoot[root] = tasks.size();
+          tasks.push_back(Task());
+        }
+        tasks[taskOfRoot[root]].push_back(queued[i]);
+      }
+      queued.clear();
+
+      mutex.lock();
+      while(workers.size()+1 < tasks.size()) {
+        workers.push_back(new Worker(this, generation));
+        workers.back()->start();
+      }
+      nextTask = 0;
+      busyWorkers = (int)workers.size();
+      ++generation;
+      startCondition.wakeAll();
+      runTasks();
+      while(busyWorkers) doneCondition.wait(&mutex);
+      mutex.unlock();
+    }
+
+    /**
+     * Takes tasks until none is left. Has to be called with locked mutex,
+     * the mutex is released while a task is processed.
+     */
+    void PluginScheduler::runTasks(void) {
+      while(nextTask < tasks.size()) {
+        Task &task = tasks[nextTask++];
+        mutex.unlock();
+        for(size_t i=0; i<task.size(); ++i) {
+          update(task[i], task[i]->queuedTime);
+        }
+        mutex.lock();
+      }
+    }
+
+    void PluginScheduler::workerLoop(unsigned long seenGeneration) {
+      mutex.lock();
+      while(true) {
+        while(!quit && generation == seenGeneration) {
+          startCondition.wait(&mutex);
+        }
+        if(quit) break;
+        seenGeneration = generation;
+        runTasks();
+        if(--busyWorkers == 0) doneCondition.wakeAll();
+      }
+      mutex.unlock();
+    }
+
+    void PluginScheduler::update(Record *record, sReal time_ms) {
+      double start = getClockMs();
+      record->plugin.p_interface->update(time_ms);
+      double end = getClockMs();
+      double latency = end - start;
+      Trace::complete("plugins", record->traceName, start, end);
+
+      int bucket = 0;
+      while(bucket < NUM_BUCKETS-1 && latency >= bucketLimits[bucket]) {
+        ++bucket;
+      }
+      record->histogram[bucket]++;
+      record->sum += latency;
+      if(latency > record->max) record->max = latency;
+      if(++record->updates % PUBLISH_INTERVAL) return;
+
+      if(control->dataBroker && record->dbId) {
+        data_broker::DataPackage &package = record->dbPackage;
+        package[0].set(record->updates);
+        package[1].set(record->sum / PUBLISH_INTERVAL);
+        package[2].set(record->max);
+        for(int i=0; i<NUM_BUCKETS; ++i) {
+          package[3+i].set(record->histogram[i]);
+        }
+        control->dataBroker->pushData(record->dbId, package);
+      }
+      record->sum = record->max = 0;
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
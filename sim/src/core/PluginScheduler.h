@@ -0,0 +1,111 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file PluginScheduler.h
+ * \brief Calls the update of the simulation plugins according to their
+ *        PluginUpdatePolicy and measures their latency.
+ */
+
+#ifndef PLUGIN_SCHEDULER_H
+#define PLUGIN_SCHEDULER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "PluginScheduler.h"
+#endif
+
+#include <mars/interfaces/sim/PluginInterface.h>
+#include <mars/data_broker/DataPackage.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <map>
+#include <vector>
+
+namespace mars {
+
+  namespace interfaces {
+    class ControlCenter;
+  }
+
+  namespace sim {
+
+    /**
+     * The latency of every plugin is published on the DataBroker as
+     * "mars_sim"/"plugins/<name>/latency": the number of updates, mean and
+     * maximum of the last updates in ms and a histogram over all updates.
+     *
+     * The scheduler is guarded by the plugin lock of the Simulator:
+     * addPlugin and removePlugin have to be called with the lock held for
+     * writing, the other methods with the lock held for reading.
+     */
+    class PluginScheduler {
+    public:
+      PluginScheduler(interfaces::ControlCenter *control);
+      ~PluginScheduler();
+
+      void addPlugin(const interfaces::pluginStruct &plugin);
+      /** \brief waits for a running asynchronous update of the plugin */
+      void removePlugin(interfaces::PluginInterface *plugin);
+
+      /**
+       * \brief Advances the update timer of the plugin by one step.
+       *
+       * Due parallel plugins are queued for runParallel(), due
+       * asynchronous plugins are triggered.
+       * \return \c true if the plugin runs in the physics thread and is
+       *         due; it has to be updated with runPlugin() then
+       * \param time_ms the time since the last update of the plugin
+       */
+      bool schedule(interfaces::PluginInterface *plugin,
+                    interfaces::sReal calc_ms, interfaces::sReal *time_ms);
+      void runPlugin(interfaces::PluginInterface *plugin,
+                     interfaces::sReal time_ms);
+      /** \brief runs the queued parallel plugins and waits for them */
+      void runParallel(void);
+
+    private:
+      struct Record;
+      class Worker;
+      class AsyncThread;
+      typedef std::vector<Record*> Task;
+
+      void update(Record *record, interfaces::sReal time_ms);
+      void runTasks(void);
+      void workerLoop(unsigned long seenGeneration);
+
+      interfaces::ControlCenter *control;
+      std::map<interfaces::PluginInterface*, Record*> records;
+      std::vector<Record*> queued;
+
+      std::vector<Worker*> workers;
+      utils::Mutex mutex;
+      utils::WaitCondition startCondition, doneCondition;
+      std::vector<Task> tasks;
+      size_t nextTask;
+      int busyWorkers;
+      unsigned long generation;
+      bool quit;
+    }; // end of class PluginScheduler
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif // PLUGIN_SCHEDULER_H
@@ -0,0 +1,204 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RealTimePacer.h"
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/Logging.hpp>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/utils/misc.h>
+
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+namespace mars {
+  namespace sim {
+
+    using namespace interfaces;
+
+    // the statistics are published every PUBLISH_INTERVAL steps
+    static const unsigned long PUBLISH_INTERVAL = 100;
+
+    using utils::getClockMs;
+
+    static void sleepUntil(double time_ms) {
+#ifdef __linux__
+      struct timespec ts;
+      ts.tv_sec = (time_t)(time_ms*0.001);
+      ts.tv_nsec = (long)((time_ms - ts.tv_sec*1000.0)*1000000.0);
+      if(ts.tv_nsec >= 1000000000) {
+        ts.tv_sec += 1;
+        ts.tv_nsec -= 1000000000;
+      }
+      // the deadline is absolute, so an interrupted sleep just continues
+      while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR);
+#else
+      double diff = time_ms - getClockMs();
+      if(diff >= 1.0) utils::msleep((unsigned int)diff);
+#endif
+    }
+
+    RealTimePacer::RealTimePacer(ControlCenter *control)
+      : control(control), catchUp(CATCHUP_SKIP), maxBurst(10),
+        priority(0), appliedPriority(0), cpu(-1), appliedCpu(-1),
+        started(false), deadline(0), lastReturn(0), slowdown(1),
+        steps(0), overruns(0), jitterSum(0), jitterMax(0), dropped(0),
+        periodSum(0), dbId(0) {
+      dbPackage.add("jitter mean", 0.0);
+      dbPackage.add("jitter max", 0.0);
+      dbPackage.add("overruns", 0ul);
+      dbPackage.add("dropped", 0.0);
+      dbPackage.add("realtime factor", 1.0);
+    }
+
+    RealTimePacer::CatchUp RealTimePacer::getCatchUp(const std::string &name) {
+      if(name == "skip") return CATCHUP_SKIP;
+      if(name == "burst") return CATCHUP_BURST;
+      if(name == "slow") return CATCHUP_SLOW;
+      LOG_WARN("RealTimePacer: unknown catch up policy \"%s\", using \"skip\"",
+               name.c_str());
+      return CATCHUP_SKIP;
+    }
+
+    void RealTimePacer::setCatchUp(CatchUp catchUp) {
+      this->catchUp = catchUp;
+    }
+
+    void RealTimePacer::setMaxBurst(int maxBurst) {
+      this->maxBurst = maxBurst < 1 ? 1 : maxBurst;
+    }
+
+    void RealTimePacer::setPriority(int priority) {
+      this->priority = priority;
+    }
+
+    void RealTimePacer::setCpu(int cpu) {
+      this->cpu = cpu;
+    }
+
+    void RealTimePacer::reset(void) {
+      started = false;
+      slowdown = 1;
+    }
+
+    void RealTimePacer::wait(sReal step_ms) {
+      applyThreadSettings();
+      double now = getClockMs();
+      if(!started) {
+        deadline = lastReturn = now;
+        started = true;
+      }
+
+      if(catchUp == CATCHUP_SLOW) {
+        // stretch the period to the time the last step needed, recover
+        // slowly to avoid oscillating around the step size
+        double needed = (now - lastReturn) / step_ms;
+        if(needed > slowdown) slowdown = needed;
+        else slowdown = 0.9*slowdown + 0.1*(needed < 1 ? 1 : needed);
+      } else {
+        slowdown = 1;
+      }
+
+      deadline += step_ms*slowdown;
+      if(now < deadline) {
+        sleepUntil(deadline);
+        now = getClockMs();
+      }
+
+      double lateness = now - deadline;
+      if(lateness < 0) lateness = 0;
+      jitterSum += lateness;
+      if(lateness > jitterMax) jitterMax = lateness;
+
+      if(lateness > step_ms) {
+        ++overruns;
+        if(catchUp == CATCHUP_BURST && lateness <= maxBurst*step_ms) {
+          // keep the deadlines, the next steps won't sleep
+        } else {
+          dropped += lateness;
+          deadline = now;
+        }
+      }
+
+      periodSum += now - lastReturn;
+      lastReturn = now;
+      if(++steps % PUBLISH_INTERVAL == 0) publish(step_ms);
+    }
+
+    void RealTimePacer::applyThreadSettings(void) {
+      if(priority == appliedPriority && cpu == appliedCpu) return;
+#ifdef __linux__
+      if(priority != appliedPriority) {
+        struct sched_param param;
+        int policy = priority > 0 ? SCHED_FIFO : SCHED_OTHER;
+        param.sched_priority = priority > 0 ? priority : 0;
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if(err) {
+          LOG_WARN("RealTimePacer: could not set the priority to %d: %s",
+                   priority, strerror(err));
+        }
+      }
+      if(cpu != appliedCpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(cpu < 0) {
+          for(int i=0; i<CPU_SETSIZE; ++i) CPU_SET(i, &set);
+        } else {
+          CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if(err) {
+          LOG_WARN("RealTimePacer: could not pin the physics thread to cpu %d: %s",
+                   cpu, strerror(err));
+        }
+      }
+#else
+      LOG_WARN("RealTimePacer: thread priority and cpu affinity are only supported on Linux");
+#endif
+      appliedPriority = priority;
+      appliedCpu = cpu;
+    }
+
+    void RealTimePacer::publish(sReal step_ms) {
+      double realtimeFactor = periodSum > 0 ? PUBLISH_INTERVAL*step_ms / periodSum : 1.0;
+      if(control->dataBroker) {
+        if(!dbId) {
+          dbId = control->dataBroker->pushData("mars_sim", "realtime",
+                                               dbPackage, NULL,
+                                               data_broker::DATA_PACKAGE_READ_FLAG);
+        }
+        dbPackage[0].set(jitterSum / PUBLISH_INTERVAL);
+        dbPackage[1].set(jitterMax);
+        dbPackage[2].set(overruns);
+        dbPackage[3].set(dropped);
+        dbPackage[4].set(realtimeFactor);
+        control->dataBroker->pushData(dbId, dbPackage);
+      }
+      jitterSum = jitterMax = periodSum = 0;
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file RealTimePacer.h
+ * \brief Paces the simulation steps to the wall clock using absolute
+ *        deadlines.
+ */
+
+#ifndef REAL_TIME_PACER_H
+#define REAL_TIME_PACER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "RealTimePacer.h"
+#endif
+
+#include <mars/interfaces/MARSDefs.h>
+#include <mars/data_broker/DataPackage.h>
+
+#include <string>
+
+namespace mars {
+
+  namespace interfaces {
+    class ControlCenter;
+  }
+
+  namespace sim {
+
+    /**
+     * The deadline of a step is the deadline of the previous step plus the
+     * step size, so the sleep time doesn't accumulate drift. If the
+     * simulation falls more than one step behind, the CatchUp policy
+     * decides what happens:
+     * - SKIP: the missed time is dropped and pacing continues from now
+     * - BURST: the late steps are run without sleeping until the
+     *   simulation caught up; if it is more than \c maxBurst steps behind
+     *   the rest is dropped
+     * - SLOW: the step period is stretched so that the simulation runs
+     *   evenly slower than real time until the steps fit again
+     *
+     * The lateness of every wake-up (jitter), the number of overruns, the
+     * dropped time and the achieved real-time factor are published as
+     * "mars_sim"/"realtime".
+     *
+     * All methods except the setters have to be called by the physics
+     * thread; the priority and cpu affinity are applied to the thread
+     * calling wait().
+     */
+    class RealTimePacer {
+    public:
+      enum CatchUp {
+        CATCHUP_SKIP = 0,
+        CATCHUP_BURST,
+        CATCHUP_SLOW
+      };
+
+      RealTimePacer(interfaces::ControlCenter *control);
+
+      /** \brief returns CATCHUP_SKIP for unknown names */
+      static CatchUp getCatchUp(const std::string &name);
+
+      void setCatchUp(CatchUp catchUp);
+      void setMaxBurst(int maxBurst);
+      /**
+       * \brief runs the physics thread with SCHED_FIFO at the given
+       *        priority, 0 restores the normal scheduling
+       */
+      void setPriority(int priority);
+      /** \brief pins the physics thread to a cpu, -1 to unpin */
+      void setCpu(int cpu);
+
+      /** \brief starts a new deadline sequence, e.g. after a pause */
+      void reset(void);
+      /** \brief sleeps until the deadline of the next step */
+      void wait(interfaces::sReal step_ms);
+
+    private:
+      void applyThreadSettings(void);
+      void publish(interfaces::sReal step_ms);
+
+      interfaces::ControlCenter *control;
+      CatchUp catchUp;
+      int maxBurst;
+      int priority, appliedPriority;
+      int cpu, appliedCpu;
+
+      bool started;
+      double deadline;  ///< wall clock in ms
+      double lastReturn;
+      double slowdown;
+
+      unsigned long steps, overruns;
+      double jitterSum, jitterMax, dropped, periodSum;
+      unsigned long dbId;
+      data_broker::DataPackage dbPackage;
+    }; // end of class RealTimePacer
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif // REAL_TIME_PACER_H
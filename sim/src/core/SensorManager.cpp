@@ -169,12 +169,8 @@ namespace mars {
 
     unsigned long SensorManager::getSensorID(std::string name) const {
       MutexLocker locker(&iMutex);
-      std::map<unsigned long, BaseSensor*>::const_iterator it;
-      for(it = simSensors.begin(); it != simSensors.end(); it++){
-        if(it->second->name.compare(name) == 0){
-          return it->first;
-        }
-      }
+      unsigned long id = nameIndex.find(name);
+      if(id) return id;
       printf("Cannot find Sensor with name: \"%s\"\n",name.c_str());
       return 0;
     }
@@ -191,6 +187,7 @@ namespace mars {
       if (iter != simSensors.end()) {
         tmpSensor = iter->second;
         simSensors.erase(iter);
+        nameIndex.remove(index);
         if (tmpSensor)
           delete tmpSensor;
       }
@@ -266,6 +263,7 @@ namespace mars {
         delete sensor;
       }
       simSensors.clear();
+      nameIndex.clear();
       if(clear_all) simSensorsReload.clear();
       next_sensor_id = 1;
     }
@@ -323,6 +321,7 @@ namespace mars {
       BaseSensor *sensor = ((*it).second)(this->control,config);
       iMutex.lock();
       simSensors[id] = sensor;
+      nameIndex.set(id, sensor->name);
       iMutex.unlock();
   
       if(!reload) {
@@ -348,5 +347,30 @@ namespace mars {
       return createAndAddSensor(type, cfg);
     }
 
+    void SensorManager::saveState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      map<unsigned long, BaseSensor*>::iterator iter;
+      state->write(simSensors.size());
+      for(iter = simSensors.begin(); iter != simSensors.end(); iter++) {
+        state->write(iter->first);
+        iter->second->saveState(state);
+      }
+    }
+
+    bool SensorManager::restoreState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      map<unsigned long, BaseSensor*>::iterator iter;
+      size_t numSensors;
+      unsigned long id;
+      if(!state->read(&numSensors) || numSensors != simSensors.size()) {
+        return false;
+      }
+      for(iter = simSensors.begin(); iter != simSensors.end(); iter++) {
+        if(!state->read(&id) || id != iter->first) return false;
+        if(!iter->second->restoreState(state)) return false;
+      }
+      return true;
+    }
+
   } // end of namespace sim
 } // end of namespace mars
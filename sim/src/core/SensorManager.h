@@ -38,6 +38,8 @@
   #warning "SensorManager.h"
 #endif
 
+#include "ObjectIndex.h"
+
 #include <mars/interfaces/sim/SensorManagerInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/utils/Mutex.h>
@@ -207,6 +209,9 @@ namespace mars {
       virtual interfaces::BaseSensor* createAndAddSensor(configmaps::ConfigMap* config, bool reload=true);
       virtual interfaces::BaseSensor* createAndAddSensor(const std::string &type_name,interfaces::BaseConfig *config, bool reload=false);
 
+      virtual void saveState(interfaces::StateBuffer *state);
+      virtual bool restoreState(interfaces::StateBuffer *state);
+
   
     private:
 
@@ -216,6 +221,9 @@ namespace mars {
       //! a containter for all sensors currently present in the simulation
       std::map<unsigned long, interfaces::BaseSensor*> simSensors;
 
+      //! the ids of the sensors in simSensors by name
+      ObjectIndex<std::string> nameIndex;
+
       //! a containter for all sensors that are loaded after a reset of the simulation
       std::vector<SensorReloadHelper> simSensorsReload;
   
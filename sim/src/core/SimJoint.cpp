@@ -616,6 +616,45 @@ namespace mars {
       dbPackageMapping.add("motorTorque", &motor_torque);
     }
 
+    void SimJoint::saveState(StateBuffer *state) const {
+      state->write(position1);
+      state->write(position2);
+      state->write(velocity1);
+      state->write(velocity2);
+      state->write(anchor);
+      state->write(axis1);
+      state->write(axis2);
+      state->write(f1);
+      state->write(f2);
+      state->write(t1);
+      state->write(t2);
+      state->write(axis1_torque);
+      state->write(axis2_torque);
+      state->write(joint_load);
+      state->write(motor_torque);
+      if(physical_joint) physical_joint->saveState(state);
+    }
+
+    bool SimJoint::restoreState(StateBuffer *state) {
+      state->read(&position1);
+      state->read(&position2);
+      state->read(&velocity1);
+      state->read(&velocity2);
+      state->read(&anchor);
+      state->read(&axis1);
+      state->read(&axis2);
+      state->read(&f1);
+      state->read(&f2);
+      state->read(&t1);
+      state->read(&t2);
+      state->read(&axis1_torque);
+      state->read(&axis2_torque);
+      state->read(&joint_load);
+      state->read(&motor_torque);
+      if(physical_joint && !physical_joint->restoreState(state)) return false;
+      return state->good();
+    }
+
 
   } // end of namespace sim
 } // end of namespace mars
@@ -110,6 +110,8 @@ namespace mars {
       void attachMotor(unsigned char axis_index);
       void detachMotor(unsigned char axis_index);
       void updateStepSize(void);
+      void saveState(interfaces::StateBuffer *state) const;
+      bool restoreState(interfaces::StateBuffer *state);
 
       // getters
       const utils::Vector getAnchor(void) const;
@@ -807,5 +807,49 @@ namespace mars {
         }
       };
 
+    /**
+     * \brief Stores the controller state and the estimated values of the
+     * motor. The configuration of the motor (sMotor) is not part of the
+     * state.
+     */
+    void SimMotor::saveState(StateBuffer *state) const {
+      state->write(sMotor.value);
+      state->write(controlValue);
+      state->write(time);
+      state->write(position1);
+      state->write(position2);
+      state->write(velocity);
+      state->write(joint_velocity);
+      state->write(effort);
+      state->write(tmpmaxeffort);
+      state->write(tmpmaxspeed);
+      state->write(current);
+      state->write(temperature);
+      state->write(error);
+      state->write(last_error);
+      state->write(integ_error);
+      state->write(active);
+    }
+
+    bool SimMotor::restoreState(StateBuffer *state) {
+      state->read(&sMotor.value);
+      state->read(&controlValue);
+      state->read(&time);
+      state->read(&position1);
+      state->read(&position2);
+      state->read(&velocity);
+      state->read(&joint_velocity);
+      state->read(&effort);
+      state->read(&tmpmaxeffort);
+      state->read(&tmpmaxspeed);
+      state->read(&current);
+      state->read(&temperature);
+      state->read(&error);
+      state->read(&last_error);
+      state->read(&integ_error);
+      state->read(&active);
+      return state->good();
+    }
+
   } // end of namespace sim
 } // end of namespace mars
@@ -72,6 +72,8 @@ namespace mars {
       void updateController();
       void activate(void);
       void deactivate(void);
+      void saveState(interfaces::StateBuffer *state) const;
+      bool restoreState(interfaces::StateBuffer *state);
       void attachJoint(SimJoint *joint);
       void attachPlayJoint(SimJoint *joint);
       void estimateCurrent();
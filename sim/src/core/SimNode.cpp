@@ -23,6 +23,7 @@
 #include <mars/data_broker/DataBrokerInterface.h>
 #include <mars/utils/Color.h>
 #include <mars/utils/MutexLocker.h>
+#include <mars/utils/TiledHeightMap.h>
 #include <mars/interfaces/terrainStruct.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
@@ -74,6 +75,7 @@ namespace mars {
       graphics_id = 0;
       graphics_id2 = 0;
       update_ray = false;
+      sleeping = false;
       visual_rep = 1;
 
       dbPackageMapping.add("id", &sNode.index);
@@ -136,6 +138,7 @@ namespace mars {
       }
       if (sNode.terrain) {
         if(sNode.terrain->pixelData) free(sNode.terrain->pixelData);
+        if(sNode.terrain->heightMap) sNode.terrain->heightMap->unref();
         delete sNode.terrain;
         sNode.terrain = 0;
       }
@@ -510,6 +513,11 @@ namespace mars {
       if (my_interface) {
         Vector damping;
         sReal d;
+        // a sleeping node is updated once to get its resting state and is
+        // skipped afterwards until the physics wakes it up
+        bool asleep = my_interface->isSleeping();
+        if(asleep && sleeping) return;
+        sleeping = asleep;
         last_l_vel = l_vel;
         last_a_vel = a_vel;
         // update the position and rotation of the node
@@ -536,6 +544,12 @@ namespace mars {
         //d = fabs(a_vel.length());
         d = fabs(a_vel.norm());
 
+        if(sleeping) {
+          // setting the velocities for the damping would wake the node up
+          checkNodeState();
+          return;
+        }
+
         // here we can handle damping
         if (sNode.linear_damping != 0) {
           damping = l_vel;
@@ -687,6 +701,11 @@ namespace mars {
       return ground_contact;
     }
 
+    bool SimNode::isSleeping(void) const {
+      MutexLocker locker(&iMutex);
+      return sleeping;
+    }
+
     sReal SimNode::getGroundContactForce(void) const {
       MutexLocker locker(&iMutex);
       return ground_contact_force;
@@ -860,5 +879,42 @@ namespace mars {
                                                      "mars_sim/simTimer");
       }
     }
+
+    void SimNode::saveState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      state->write(sNode.pos);
+      state->write(sNode.rot);
+      state->write(l_vel);
+      state->write(last_l_vel);
+      state->write(a_vel);
+      state->write(last_a_vel);
+      state->write(l_acc);
+      state->write(a_acc);
+      state->write(f);
+      state->write(t);
+      state->write(ground_contact);
+      state->write(ground_contact_force);
+      state->write(sleeping);
+      if(my_interface) my_interface->saveState(state);
+    }
+
+    bool SimNode::restoreState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      state->read(&sNode.pos);
+      state->read(&sNode.rot);
+      state->read(&l_vel);
+      state->read(&last_l_vel);
+      state->read(&a_vel);
+      state->read(&last_a_vel);
+      state->read(&l_acc);
+      state->read(&a_acc);
+      state->read(&f);
+      state->read(&t);
+      state->read(&ground_contact);
+      state->read(&ground_contact_force);
+      state->read(&sleeping);
+      if(my_interface && !my_interface->restoreState(state)) return false;
+      return state->good();
+    }
   } // end of namespace sim
 } // end of namespace mars
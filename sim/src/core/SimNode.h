@@ -118,6 +118,7 @@ namespace mars {
       void getCoreExchange(interfaces::core_objects_exchange *obj) const;
       void getPhysicalState(interfaces::nodeState *state) const;
       bool getGroundContact(void) const;      
+      bool isSleeping(void) const; ///< returns if the body came to rest and is disabled
       void getMass(interfaces::sReal *mass, interfaces::sReal *inertia) const;
       void getContactPoints(std::vector<utils::Vector> *contact_points) const;
       void getContactIDs(std::list<interfaces::NodeId> *ids) const;
@@ -187,6 +188,9 @@ namespace mars {
       void setCullMask(int mask);
       void setBrightness(double v);
 
+      void saveState(interfaces::StateBuffer *state);
+      bool restoreState(interfaces::StateBuffer *state);
+
     private:
       interfaces::ControlCenter *control;
       interfaces::NodeData sNode;
@@ -207,6 +211,7 @@ namespace mars {
       int vel_ptr;
       unsigned long graphics_id, graphics_id2;
       bool update_ray;
+      bool sleeping;
       int visual_rep;
       mutable utils::Mutex iMutex;
       // stuff for dataBroker communication
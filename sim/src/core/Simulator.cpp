@@ -38,6 +38,8 @@
 #include "Controller.h"
 
 #include <mars/utils/misc.h>
+#include <mars/utils/MutexLocker.h>
+#include <mars/utils/Trace.h>
 #include <mars/interfaces/SceneParseException.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/sim/LoadCenter.h>
@@ -45,6 +47,7 @@
 #include <mars/data_broker/DataBrokerInterface.h>
 #include <lib_manager/LibInterface.hpp>
 #include <mars/interfaces/Logging.hpp>
+#include <mars/interfaces/StateBuffer.h>
 
 #include <signal.h>
 #include <getopt.h>
@@ -68,6 +71,21 @@ namespace mars {
     using namespace utils;
     using namespace interfaces;
 
+    // "MSNP" and the version of the snapshot layout
+    static const unsigned int SNAPSHOT_MAGIC = 0x504e534d;
+    static const unsigned int SNAPSHOT_VERSION = 1;
+
+    static Broadphase getBroadphase(const string &name) {
+      if(name == "sap") return BROADPHASE_SAP;
+      if(name == "quadtree") return BROADPHASE_QUADTREE;
+      if(name == "simple") return BROADPHASE_SIMPLE;
+      if(name != "hash") {
+        LOG_WARN("Simulator: unknown broadphase \"%s\", using \"hash\"",
+                 name.c_str());
+      }
+      return BROADPHASE_HASH;
+    }
+
     void hard_exit(int signal) {
       exit(signal);
     }
@@ -78,13 +96,16 @@ namespace mars {
     Simulator::Simulator(lib_manager::LibManager *theManager) :
       lib_manager::LibInterface(theManager),
       exit_sim(false), allow_draw(true),
-      sync_graphics(false), physics_mutex_count(0), physics(0),
-      haveNewPlugin(false) {
+      sync_graphics(false), sim_finished(false), physics_next_ticket(0),
+      physics_serving_ticket(0), physics(0),
+      haveNewPlugin(false), havePluginModeSwitches(false) {
 
       config_dir = DEFAULT_CONFIG_DIR;
       calc_time = 0;
       avg_step_time = avg_log_time = 0;
       count = 0;
+      profiling = false;
+      resetStepProfile();
       config_dir = ".";
 
       std_port = 1600;
@@ -98,6 +119,7 @@ namespace mars {
       // set the calculation step size in ms
       calc_ms      = 10; //defaultCFG->getInt("physics", "calc_ms", 10);
       my_real_time = 0;
+      pacerResetRequested = false;
       show_time = 0;
       // to synchronise drawing and physics
       sync_time = 40;
@@ -117,7 +139,11 @@ namespace mars {
       control->loadCenter = new LoadCenter();
       control->sim = (SimulatorInterface*)this;
       control->cfg = 0;//defaultCFG;
+      pluginScheduler = new PluginScheduler(control);
+      realTimePacer = new RealTimePacer(control);
       dbSimTimePackage.add("simTime", 0.);
+      dbSleepingPackage.add("sleeping", 0ul);
+      dbSleepingPackage.add("dynamic", 0ul);
       // load optional libs
       checkOptionalDependency("data_broker");
       checkOptionalDependency("cfg_manager");
@@ -134,6 +160,11 @@ namespace mars {
         utils::msleep(1);
       //fprintf(stderr, "Delete mars_sim\n");
 
+      delete pluginScheduler;
+      delete realTimePacer;
+      if(utils::Trace::isEnabled()) {
+        writeTrace();
+      }
       if (control->controllers) delete control->controllers;
 
       if(control->cfg) {
@@ -176,6 +207,10 @@ namespace mars {
                                                       NULL,
                                                       data_broker::DATA_PACKAGE_READ_FLAG);
           getTimeMutex.unlock();
+          dbSleepingId = control->dataBroker->pushData("mars_sim", "sleeping",
+                                                       dbSleepingPackage,
+                                                       NULL,
+                                                       data_broker::DATA_PACKAGE_READ_FLAG);
           control->dataBroker->createTimer("mars_sim/simTimer");
           control->dataBroker->createTrigger("mars_sim/prePhysicsUpdate");
           control->dataBroker->createTrigger("mars_sim/postPhysicsUpdate");
@@ -268,6 +303,14 @@ namespace mars {
       gravity.z() = cfgGZ.dValue;
       physics->world_gravity = gravity;
       physics->draw_contact_points = cfgDrawContact.bValue;
+      physics->contact_cache = cfgContactCache.bValue;
+      physics->contact_cache_tolerance = cfgContactCacheTolerance.dValue;
+      physics->sleeping = cfgSleeping.bValue;
+      physics->broadphase = getBroadphase(cfgBroadphase.sValue);
+      physics->bake_static_geoms = cfgBakeStatic.bValue;
+      physics->collision_threads = cfgCollisionThreads.iValue;
+      physics->island_threads = cfgIslandThreads.iValue;
+      physics->profiling = profiling;
 #ifndef __linux__
       this->setStackSize(16777216);
       fprintf(stderr, "INFO: set physics stack size to: %lu\n", getStackSize());
@@ -309,24 +352,33 @@ namespace mars {
        *
        */
     void Simulator::run() {
+      utils::Trace::setThreadName("physics");
 
       while (!kill_sim) {
         stepping_mutex.lock();
-        if(simulationStatus == STOPPING)
+        if(simulationStatus == STOPPING) {
           simulationStatus = STOPPED;
+          stepping_wc.wakeAll();
+        }
 
         if(!isSimRunning()) {
-          stepping_wc.wait(&stepping_mutex);
-          if(kill_sim){
-            stepping_mutex.unlock();
-            break;
+          // stepping_wc is woken on every state change, so check again
+          while(!isSimRunning() && !kill_sim) {
+            stepping_wc.wait(&stepping_mutex);
           }
+          // don't count the pause as overrun
+          pacerResetRequested = true;
+        }
+        if(kill_sim) {
+          stepping_mutex.unlock();
+          break;
         }
 
         if (sync_graphics && !sync_count) {
-            msleep(2);
-            stepping_mutex.unlock();
-            continue;
+          // woken by finishedDraw or any state change
+          stepping_wc.wait(&stepping_mutex);
+          stepping_mutex.unlock();
+          continue;
         }
 
         if(simulationStatus == STEPPING){
@@ -334,24 +386,30 @@ namespace mars {
         }
         stepping_mutex.unlock();
 
+        // physicsThreadLock is fair, so threads waiting for the lock get
+        // it before the next step without sleeping here
         if(my_real_time) {
           myRealTime();
-        } else if(physics_mutex_count > 0) {
-          // if not in realtime this thread would lock the physicsThread right
-          // after releasing it. If an other thread is trying to lock
-          // it (physics_mutex_count > 0) we sleep so it has a chance.
-          msleep(1);
         }
         step();
       }
+      stepping_mutex.lock();
       simulationStatus = STOPPED;
+      sim_finished = true;
+      stepping_wc.wakeAll();
+      stepping_mutex.unlock();
       // here everything of the physical simulation can be closed
     }
 
     void Simulator::step(bool setState) {
       std::vector<pluginStruct>::iterator p_iter;
       long time;
+      sReal plugin_ms;
       Status oldState;
+      double stageStart = 0.0, stepStart = 0.0;
+      MARS_TRACE_SCOPE("step", "step");
+      // the stage times are needed for the profile and for the trace
+      bool timing = profiling || utils::Trace::isEnabled();
 
       physicsThreadLock();
 
@@ -361,20 +419,38 @@ namespace mars {
       }
 
       if(show_time) time = utils::getTime();
+      if(timing) stepStart = stageStart = utils::getClockMs();
 
       if(control->dataBroker) {
         control->dataBroker->trigger("mars_sim/prePhysicsUpdate");
       }
+      if(timing) profileStage(STEP_STAGE_PRE_PHYSICS, &stageStart);
       physics->stepTheWorld();
+      if(timing) {
+        profileStage(STEP_STAGE_SOLVER, &stageStart);
+        stageMs[STEP_STAGE_COLLISION] = physics->collision_ms;
+        stageMs[STEP_STAGE_SOLVER] -= physics->collision_ms;
+      }
 
       if(show_time) {
         avg_step_time += getTimeDiff(time);
       }
 
       control->nodes->updateDynamicNodes(calc_ms); //Moved update to here, otherwise RaySensor is one step behind the world every time
+      if(physics->sleeping && control->dataBroker) {
+        unsigned long numSleeping, numDynamic;
+        control->nodes->getSleepingStats(&numSleeping, &numDynamic);
+        dbSleepingPackage[0].set(numSleeping);
+        dbSleepingPackage[1].set(numDynamic);
+        control->dataBroker->pushData(dbSleepingId, dbSleepingPackage);
+      }
+      if(timing) profileStage(STEP_STAGE_NODES, &stageStart);
       control->joints->updateJoints(calc_ms);
+      if(timing) profileStage(STEP_STAGE_JOINTS, &stageStart);
       control->motors->updateMotors(calc_ms);
+      if(timing) profileStage(STEP_STAGE_MOTORS, &stageStart);
       control->controllers->updateControllers(calc_ms);
+      if(timing) profileStage(STEP_STAGE_CONTROLLERS, &stageStart);
 
       if(show_time)
         time = utils::getTime();
@@ -387,6 +463,7 @@ namespace mars {
                                       dbSimTimePackage);
         control->dataBroker->stepTimer("mars_sim/simTimer", calc_ms);
       }
+      if(timing) profileStage(STEP_STAGE_DATA_BROKER, &stageStart);
 
       if(show_time) {
         avg_log_time += getTimeDiff(time);
@@ -396,52 +473,80 @@ namespace mars {
           count = 0;
           fprintf(stderr, "Step World: %g\n", avg_step_time);
           fprintf(stderr, "debug_log_time: %g\n", avg_log_time);
+          ContactCacheStats stats = physics->getContactCacheStats();
+          fprintf(stderr, "broadphase: %lu pairs  %lu contacts\n",
+                  stats.broadphasePairs, stats.contacts);
+          if(physics->contact_cache) {
+            fprintf(stderr, "narrow phase: %lu calls  %lu skipped  %lu cached pairs\n",
+                    stats.narrowPhaseCalls, stats.narrowPhaseSkipped,
+                    stats.cachedPairs);
+          }
           avg_step_time = avg_log_time = 0.0;
         }
       }
 
+      if(havePluginModeSwitches) {
+        pluginLocker.lockForWrite();
+        applyPluginModeSwitches();
+        pluginLocker.unlock();
+      }
+
       pluginLocker.lockForRead();
 
-      // It is possible for plugins to call switchPluginUpdateMode during
-      // the update call and get removed from the activePlugins list there.
-      // We use erased_active to notify this loop about an erasure.
-      for(unsigned int i = 0; i < activePlugins.size();) {
-        erased_active = false;
+      // Plugins that are not due or don't run in the physics thread are
+      // skipped here; the parallel ones are run by runParallel below.
+      // Plugins calling switchPluginUpdateMode during the update call
+      // only queue the switch, so activePlugins stays unchanged here.
+      for(unsigned int i = 0; i < activePlugins.size(); ++i) {
+        if(!pluginScheduler->schedule(activePlugins[i].p_interface, calc_ms,
+                                      &plugin_ms))
+          continue;
         if(show_time)
           time = utils::getTime();
 
-        activePlugins[i].p_interface->update(calc_ms);
-
-        if(!erased_active) {
-          if(show_time) {
-            time = getTimeDiff(time);
-            activePlugins[i].timer += time;
-            activePlugins[i].t_count++;
-            if(activePlugins[i].t_count > 20) {
-              activePlugins[i].timer /= activePlugins[i].t_count;
-              activePlugins[i].t_count = 0;
-              fprintf(stderr, "debug_time: %s: %g\n",
-                      activePlugins[i].name.c_str(),
-                      activePlugins[i].timer);
-              activePlugins[i].timer = 0.0;
-            }
+        pluginScheduler->runPlugin(activePlugins[i].p_interface, plugin_ms);
+
+        if(show_time) {
+          time = getTimeDiff(time);
+          activePlugins[i].timer += time;
+          activePlugins[i].t_count++;
+          if(activePlugins[i].t_count > 20) {
+            activePlugins[i].timer /= activePlugins[i].t_count;
+            activePlugins[i].t_count = 0;
+            fprintf(stderr, "debug_time: %s: %g\n",
+                    activePlugins[i].name.c_str(),
+                    activePlugins[i].timer);
+            activePlugins[i].timer = 0.0;
           }
-          ++i;
         }
       }
+      pluginScheduler->runParallel();
       pluginLocker.unlock();
+      if(timing) profileStage(STEP_STAGE_PLUGINS, &stageStart);
       if (sync_graphics) {
         calc_time += calc_ms;
         if (calc_time >= sync_time) {
+          stepping_mutex.lock();
           sync_count = 0;
-          if(control->graphics)
-            this->allowDraw();
+          stepping_mutex.unlock();
+          // also without graphics, for loops that draw via waitForDraw
+          this->allowDraw();
           calc_time = 0;
         }
       }
       if(control->dataBroker) {
         control->dataBroker->trigger("mars_sim/postPhysicsUpdate");
       }
+      if(timing) profileStage(STEP_STAGE_POST_PHYSICS, &stageStart);
+      if(profiling) {
+        profileMutex.lock();
+        for(int i=0; i<NUMBER_OF_STEP_STAGES; ++i) {
+          stepProfile.stageMs[i] += stageMs[i];
+        }
+        stepProfile.totalMs += stageStart - stepStart;
+        ++stepProfile.steps;
+        profileMutex.unlock();
+      }
 
       if(setState) {
         simulationStatus = oldState;
@@ -450,6 +555,63 @@ namespace mars {
       physicsThreadUnlock();
     }
 
+    void Simulator::profileStage(StepStage stage, double *start) {
+      double now = utils::getClockMs();
+      stageMs[stage] = now - *start;
+      // stepTheWorld traces its collision and solver spans itself
+      if(stage != STEP_STAGE_SOLVER) {
+        utils::Trace::complete("step", StepProfile::stageName(stage),
+                               *start, now);
+      }
+      *start = now;
+    }
+
+    void Simulator::setStepProfiling(bool enable) {
+      physicsThreadLock();
+      profiling = enable;
+      if(physics) physics->profiling = enable;
+      physicsThreadUnlock();
+    }
+
+    void Simulator::setTracing(bool enable) {
+      if(enable == utils::Trace::isEnabled()) return;
+      if(enable) {
+        utils::Trace::clear();
+        utils::Trace::setEnabled(true);
+      } else {
+        utils::Trace::setEnabled(false);
+        writeTrace();
+      }
+    }
+
+    void Simulator::writeTrace() {
+      std::string filename = "mars_trace.json";
+      if(control->cfg) {
+        filename = control->cfg->getOrCreateProperty("Simulator", "trace file",
+                                                     filename).sValue;
+      }
+      if(utils::Trace::writeChromeJson(filename)) {
+        LOG_INFO("Simulator: wrote trace to %s", filename.c_str());
+      } else {
+        LOG_ERROR("Simulator: could not write trace to %s", filename.c_str());
+      }
+    }
+
+    void Simulator::getStepProfile(StepProfile *profile) {
+      MutexLocker locker(&profileMutex);
+      *profile = stepProfile;
+    }
+
+    void Simulator::resetStepProfile(void) {
+      MutexLocker locker(&profileMutex);
+      stepProfile.steps = 0;
+      stepProfile.totalMs = 0.0;
+      for(int i=0; i<NUMBER_OF_STEP_STAGES; ++i) {
+        stepProfile.stageMs[i] = 0.0;
+        stageMs[i] = 0.0;
+      }
+    }
+
     /**
      * \return \c true if started, \c false if stopped
      */
@@ -468,6 +630,7 @@ namespace mars {
         break;
       case STOPPED:
         simulationStatus = RUNNING;
+        stepping_wc.wakeAll();
         break;
       case STEPPING:
          simulationStatus = RUNNING;
@@ -484,64 +647,12 @@ namespace mars {
 
     }
 
-    //consider the case where the time step is smaller than 1 ms
     void Simulator::myRealTime() {
-#ifdef __linux__  //__unix__, wenn Darwin das mitmacht.
-      //used to remember last time this function was called
-      //and as absolute (minimum) wake-up time.
-      static struct timespec ts;
-      static bool tsNeedsInit = true;
-      if (tsNeedsInit)
-        {
-          int retval = clock_gettime(CLOCK_MONOTONIC, &ts);
-          if (retval != 0)
-            {
-              throw std::runtime_error("clock_gettime(CLOCK_MONOTONIC, ...) failed");
-            }
-          tsNeedsInit = false;
-        }
-
-      //schedule minimum sleep time
-      ts.tv_nsec += calc_ms * 1000000;
-
-      //the nsec value may not exceed one second
-      while (ts.tv_nsec > 1000000000)
-        {
-          ts.tv_nsec -= 1000000000;
-          ts.tv_sec += 1;
-        }
-
-      //sleep...
-      int retval = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0);
-      if (retval != 0)
-        {
-          std::cerr << "WARNING: Your system is too slow!" << std::endl;
-        }
-
-      //remember time
-      retval = clock_gettime(CLOCK_MONOTONIC, &ts);
-      if (retval != 0)
-        {
-          throw std::runtime_error("clock_gettime(CLOCK_MONOTONIC, ...) failed");
-        }
-#else
-      static long myTime = utils::getTime();
-      long timeDiff = getTimeDiff(myTime);
-
-      if(show_time) {
-        fprintf(stderr, "timeDiff: %ld\n", timeDiff);
-      }
-      if(timeDiff < calc_ms) {
-        long valSleep = calc_ms - timeDiff;
-        msleep(valSleep);
-        myTime = utils::getTime();
-        if(show_time) {
-          fprintf(stderr, "sleep time: %ld\n", valSleep);
-        }
-      } else {
-        myTime += timeDiff;
+      if(pacerResetRequested) {
+        pacerResetRequested = false;
+        realTimePacer->reset();
       }
-#endif
+      realTimePacer->wait(calc_ms);
     }
 
 
@@ -590,11 +701,11 @@ namespace mars {
         lo.wasRunning = wasrunning;
         lo.robotname = robotname;
         filesToLoad.push_back(lo);
-        externalMutex.unlock();
 
         while(blocking && !filesToLoad.empty()){
-            msleep(10);
+            requests_wc.wait(&externalMutex);
         }
+        externalMutex.unlock();
         return 1;
     }
 
@@ -663,14 +774,7 @@ namespace mars {
       processRequests();
 
       if (reloadSim) {
-        while (simulationStatus != STOPPED) {
-
-          if(simulationStatus == RUNNING) {
-            StopSimulation();
-          }
-
-          msleep(10);
-        }
+        stopSimulationAndWait();
         reloadSim = false;
         control->controllers->setLoadingAllowed(false);
 
@@ -686,19 +790,27 @@ namespace mars {
         }
         reloadGraphics = true;
       }
+      drawMutex.lock();
       allow_draw = 0;
+      drawMutex.unlock();
+      stepping_mutex.lock();
       sync_count = 1;
+      stepping_wc.wakeAll();
+      stepping_mutex.unlock();
 
-      // Add plugins that have been added via Simulator::addPlugin
-      if(haveNewPlugin) {
+      // Add plugins that have been added via Simulator::addPlugin and
+      // apply the update mode switches requested since the last call
+      if(haveNewPlugin || havePluginModeSwitches) {
         pluginLocker.lockForWrite();
         for (unsigned int i=0; i<newPlugins.size(); i++) {
           allPlugins.push_back(newPlugins[i]);
           activePlugins.push_back(newPlugins[i]);
           newPlugins[i].p_interface->init();
+          pluginScheduler->addPlugin(newPlugins[i]);
         }
         newPlugins.clear();
         haveNewPlugin = false;
+        applyPluginModeSwitches();
         pluginLocker.unlock();
       }
 
@@ -773,6 +885,74 @@ namespace mars {
     }
 
 
+    /**
+     * \brief Stores the dynamic state of the scene into \a snapshot.
+     *
+     * The world state is written after the node states since restoring a
+     * node changes the order of the geoms in the collision space (see
+     * WorldPhysics::saveState).
+     */
+    void Simulator::saveSnapshot(std::vector<char> *snapshot) {
+      StateBuffer state;
+      double simTime;
+
+      state.write(SNAPSHOT_MAGIC);
+      state.write(SNAPSHOT_VERSION);
+      physicsThreadLock();
+      getTimeMutex.lock();
+      simTime = dbSimTimePackage[0].d;
+      getTimeMutex.unlock();
+      state.write(simTime);
+      control->nodes->saveState(&state);
+      control->joints->saveState(&state);
+      control->motors->saveState(&state);
+      control->sensors->saveState(&state);
+      physics->saveState(&state);
+      physicsThreadUnlock();
+      snapshot->swap(state.data);
+    }
+
+    /**
+     * \brief Restores a snapshot taken by saveSnapshot.
+     *
+     * The number and ids of the objects in the snapshot have to match the
+     * current scene. If they don't, the state of the scene is undefined
+     * after the call and the scene should be reset.
+     */
+    bool Simulator::restoreSnapshot(const std::vector<char> &snapshot) {
+      StateBuffer state(snapshot);
+      unsigned int magic, version;
+      double simTime;
+      bool ok;
+
+      if(!state.read(&magic) || magic != SNAPSHOT_MAGIC ||
+         !state.read(&version) || version != SNAPSHOT_VERSION) {
+        LOG_ERROR("Simulator: invalid snapshot");
+        return false;
+      }
+      physicsThreadLock();
+      ok = (state.read(&simTime) &&
+            control->nodes->restoreState(&state) &&
+            control->joints->restoreState(&state) &&
+            control->motors->restoreState(&state) &&
+            control->sensors->restoreState(&state) &&
+            physics->restoreState(&state) &&
+            state.atEnd());
+      if(ok) {
+        getTimeMutex.lock();
+        dbSimTimePackage[0].d = simTime;
+        getTimeMutex.unlock();
+        if(control->dataBroker) {
+          control->dataBroker->pushData(dbSimTimeId, dbSimTimePackage);
+        }
+      }
+      physicsThreadUnlock();
+      if(!ok) {
+        LOG_ERROR("Simulator: the snapshot does not match the current scene");
+      }
+      return ok;
+    }
+
     void Simulator::reloadWorld(void) {
       control->nodes->reloadNodes(reloadGraphics);
       control->joints->reloadJoints();
@@ -856,21 +1036,24 @@ namespace mars {
       return;
     }
 
+    /**
+     * The physics lock is a ticket lock: the threads get the lock in the
+     * order they asked for it. Thus the physics thread can't take the lock
+     * again right after a step while other threads are waiting.
+     */
     void Simulator::physicsThreadLock(void) {
-      // physics_mutex_count is used to see how many threads are trying to
-      // acquire the lock. Also see Simulator::run() on how this is used.
-      physicsCountMutex.lock();
-      physics_mutex_count++;
-      physicsCountMutex.unlock();
       physicsMutex.lock();
+      unsigned long ticket = physics_next_ticket++;
+      while(ticket != physics_serving_ticket) {
+        physics_wc.wait(&physicsMutex);
+      }
+      physicsMutex.unlock();
     }
 
     void Simulator::physicsThreadUnlock(void) {
-      // physics_mutex_count is used to see how many threads are trying to
-      // acquire the lock. Also see Simulator::run() on how this is used.
-      physicsCountMutex.lock();
-      physics_mutex_count--;
-      physicsCountMutex.unlock();
+      physicsMutex.lock();
+      ++physics_serving_ticket;
+      physics_wc.wakeAll();
       physicsMutex.unlock();
     }
 
@@ -885,14 +1068,16 @@ namespace mars {
     void Simulator::exitMars(void) {
       stepping_mutex.lock();
       kill_sim = 1;
+      // the physics thread may wait for a state change or a frame
       stepping_wc.wakeAll();
-      stepping_mutex.unlock();
       if(isCurrentThread()) {
+        stepping_mutex.unlock();
         return;
       }
-      while(this->isRunning()) {
-        msleep(1);
+      while(this->isRunning() && !sim_finished) {
+        stepping_wc.wait(&stepping_mutex);
       }
+      stepping_mutex.unlock();
     }
 
     void Simulator::connectNodes(unsigned long id1, unsigned long id2) {
@@ -924,41 +1109,67 @@ namespace mars {
       stepping_mutex.unlock();
     }
 
+    /**
+     * Plugins call this from init() and update(), i.e. while step() or
+     * finishedDraw() hold the pluginLocker. So the switch is only queued
+     * here and applied by the next step() or finishedDraw() call under the
+     * write lock.
+     */
     void Simulator::switchPluginUpdateMode(int mode, PluginInterface *pl) {
+      pluginModeMutex.lock();
+      pluginModeSwitches.push_back(std::make_pair(mode, pl));
+      havePluginModeSwitches = true;
+      pluginModeMutex.unlock();
+    }
+
+    /**
+     * Applies the switches queued by switchPluginUpdateMode. The
+     * pluginLocker has to be locked for writing.
+     */
+    void Simulator::applyPluginModeSwitches(void) {
+      std::vector<std::pair<int, PluginInterface*> > switches;
       std::vector<pluginStruct>::iterator p_iter;
-      bool afound = false;
-      bool gfound = false;
 
-      for(p_iter=activePlugins.begin(); p_iter!=activePlugins.end();
-          p_iter++) {
-        if((*p_iter).p_interface == pl) {
-          afound = true;
-          if(!(mode & PLUGIN_SIM_MODE)) {
-            activePlugins.erase(p_iter);
-            erased_active = true;
+      pluginModeMutex.lock();
+      switches.swap(pluginModeSwitches);
+      havePluginModeSwitches = false;
+      pluginModeMutex.unlock();
+
+      for(size_t i=0; i<switches.size(); ++i) {
+        int mode = switches[i].first;
+        PluginInterface *pl = switches[i].second;
+        bool afound = false;
+        bool gfound = false;
+
+        for(p_iter=activePlugins.begin(); p_iter!=activePlugins.end();
+            p_iter++) {
+          if((*p_iter).p_interface == pl) {
+            afound = true;
+            if(!(mode & PLUGIN_SIM_MODE))
+              activePlugins.erase(p_iter);
+            break;
           }
-          break;
         }
-      }
 
-      for(p_iter=guiPlugins.begin(); p_iter!=guiPlugins.end();
-          p_iter++) {
-        if((*p_iter).p_interface == pl) {
-          gfound = true;
-          if(!(mode & PLUGIN_GUI_MODE))
-            guiPlugins.erase(p_iter);
-          break;
+        for(p_iter=guiPlugins.begin(); p_iter!=guiPlugins.end();
+            p_iter++) {
+          if((*p_iter).p_interface == pl) {
+            gfound = true;
+            if(!(mode & PLUGIN_GUI_MODE))
+              guiPlugins.erase(p_iter);
+            break;
+          }
         }
-      }
 
-      for(p_iter=allPlugins.begin(); p_iter!=allPlugins.end();
-          p_iter++) {
-        if((*p_iter).p_interface == pl) {
-          if(mode & PLUGIN_SIM_MODE && !afound)
-            activePlugins.push_back(*p_iter);
-          if(mode & PLUGIN_GUI_MODE && !gfound)
-            guiPlugins.push_back(*p_iter);
-          break;
+        for(p_iter=allPlugins.begin(); p_iter!=allPlugins.end();
+            p_iter++) {
+          if((*p_iter).p_interface == pl) {
+            if(mode & PLUGIN_SIM_MODE && !afound)
+              activePlugins.push_back(*p_iter);
+            if(mode & PLUGIN_GUI_MODE && !gfound)
+              guiPlugins.push_back(*p_iter);
+            break;
+          }
         }
       }
     }
@@ -1049,6 +1260,18 @@ namespace mars {
 
       pluginLocker.lockForWrite();
 
+      pluginScheduler->removePlugin(pl);
+
+      // drop the queued switches of the plugin
+      pluginModeMutex.lock();
+      for(size_t i=0; i<pluginModeSwitches.size();) {
+        if(pluginModeSwitches[i].second == pl)
+          pluginModeSwitches.erase(pluginModeSwitches.begin() + i);
+        else
+          ++i;
+      }
+      pluginModeMutex.unlock();
+
       for(p_iter=activePlugins.begin(); p_iter!=activePlugins.end();
           p_iter++) {
         if((*p_iter).p_interface == pl) {
@@ -1088,7 +1311,10 @@ namespace mars {
 
 
     void Simulator::setSyncThreads(bool value) {
+      stepping_mutex.lock();
       sync_graphics = value;
+      stepping_wc.wakeAll();
+      stepping_mutex.unlock();
     }
 
     /**
@@ -1103,7 +1329,45 @@ namespace mars {
      * This method is used for gui and simulation synchronization.
      */
     void Simulator::allowDraw(void) {
+      drawMutex.lock();
       allow_draw = 1;
+      draw_wc.wakeAll();
+      drawMutex.unlock();
+    }
+
+    /**
+     * Blocks until the simulation allows the next frame to be drawn or
+     * the timeout elapsed. Used by loops without an own timer, e.g. the
+     * main loop without Qt.
+     * \return \c true if drawing is allowed
+     */
+    bool Simulator::waitForDraw(unsigned long timeout_ms) {
+      drawMutex.lock();
+      if(!allow_draw) {
+        draw_wc.wait(&drawMutex, timeout_ms);
+      }
+      bool allowed = allow_draw;
+      drawMutex.unlock();
+      return allowed;
+    }
+
+    /**
+     * Stops the simulation and waits until the physics thread finished the
+     * current step.
+     * \return \c true if the simulation was running
+     */
+    bool Simulator::stopSimulationAndWait(void) {
+      stepping_mutex.lock();
+      bool wasRunning = (simulationStatus == RUNNING);
+      if(simulationStatus != STOPPED) {
+        simulationStatus = STOPPING;
+        stepping_wc.wakeAll();
+      }
+      while(simulationStatus != STOPPED && isRunning() && !isCurrentThread()) {
+        stepping_wc.wait(&stepping_mutex);
+      }
+      stepping_mutex.unlock();
+      return wasRunning;
     }
 
     /**
@@ -1120,22 +1384,14 @@ namespace mars {
     void Simulator::processRequests() {
       externalMutex.lock();
       if(filesToLoad.size() > 0) {
-        bool wasrunning = false;
-        while (simulationStatus != STOPPED) {
-
-          if(simulationStatus == RUNNING) {
-            StopSimulation();
-            wasrunning = true;
-          }
-
-          msleep(10);
-        }
+        bool wasrunning = stopSimulationAndWait();
 
         for(unsigned int i=0;i<filesToLoad.size();i++){
           loadScene_internal(filesToLoad[i].filename, false,
                              filesToLoad[i].robotname);
         }
         filesToLoad.clear();
+        requests_wc.wakeAll();
 
         if(wasrunning) {
           StartSimulation();
@@ -1170,6 +1426,28 @@ namespace mars {
 
       if(_property.paramId == cfgRealtime.paramId) {
         my_real_time = _property.bValue;
+        // the pacer is reset by the physics thread in myRealTime
+        pacerResetRequested = true;
+        return;
+      }
+
+      if(_property.paramId == cfgRealtimeCatchUp.paramId) {
+        realTimePacer->setCatchUp(RealTimePacer::getCatchUp(_property.sValue));
+        return;
+      }
+
+      if(_property.paramId == cfgRealtimeMaxBurst.paramId) {
+        realTimePacer->setMaxBurst(_property.iValue);
+        return;
+      }
+
+      if(_property.paramId == cfgRealtimePriority.paramId) {
+        realTimePacer->setPriority(_property.iValue);
+        return;
+      }
+
+      if(_property.paramId == cfgRealtimeCpu.paramId) {
+        realTimePacer->setCpu(_property.iValue);
         return;
       }
 
@@ -1193,6 +1471,46 @@ namespace mars {
         return;
       }
 
+      if(_property.paramId == cfgContactCache.paramId) {
+        physics->contact_cache = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == cfgContactCacheTolerance.paramId) {
+        physics->contact_cache_tolerance = _property.dValue;
+        return;
+      }
+
+      if(_property.paramId == cfgSleeping.paramId) {
+        physics->sleeping = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == cfgBroadphase.paramId) {
+        physics->broadphase = getBroadphase(_property.sValue);
+        return;
+      }
+
+      if(_property.paramId == cfgBakeStatic.paramId) {
+        physics->bake_static_geoms = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == cfgTrace.paramId) {
+        setTracing(_property.bValue);
+        return;
+      }
+
+      if(_property.paramId == cfgCollisionThreads.paramId) {
+        physics->collision_threads = _property.iValue;
+        return;
+      }
+
+      if(_property.paramId == cfgIslandThreads.paramId) {
+        physics->island_threads = _property.iValue;
+        return;
+      }
+
       if(_property.paramId == cfgGX.paramId) {
         gravity.x() = _property.dValue;
         physics->world_gravity = gravity;
@@ -1245,6 +1563,27 @@ namespace mars {
                                                       false, this);
       my_real_time = cfgRealtime.bValue;
 
+      cfgRealtimeCatchUp = control->cfg->getOrCreateProperty("Simulator",
+                                                             "realtime catch up",
+                                                             std::string("skip"),
+                                                             this);
+      realTimePacer->setCatchUp(RealTimePacer::getCatchUp(cfgRealtimeCatchUp.sValue));
+
+      cfgRealtimeMaxBurst = control->cfg->getOrCreateProperty("Simulator",
+                                                              "realtime max burst",
+                                                              (int)10, this);
+      realTimePacer->setMaxBurst(cfgRealtimeMaxBurst.iValue);
+
+      cfgRealtimePriority = control->cfg->getOrCreateProperty("Simulator",
+                                                              "realtime priority",
+                                                              (int)0, this);
+      realTimePacer->setPriority(cfgRealtimePriority.iValue);
+
+      cfgRealtimeCpu = control->cfg->getOrCreateProperty("Simulator",
+                                                         "realtime cpu",
+                                                         (int)-1, this);
+      realTimePacer->setCpu(cfgRealtimeCpu.iValue);
+
       cfgDebugTime = control->cfg->getOrCreateProperty("Simulator", "debug time",
                                                        false, this);
 
@@ -1257,6 +1596,37 @@ namespace mars {
       cfgDrawContact = control->cfg->getOrCreateProperty("Simulator", "draw contacts",
                                                          false, this);
 
+      cfgContactCache = control->cfg->getOrCreateProperty("Simulator", "contact cache",
+                                                          false, this);
+
+      cfgContactCacheTolerance = control->cfg->getOrCreateProperty("Simulator",
+                                                                   "contact cache tolerance",
+                                                                   1e-5, this);
+
+      cfgSleeping = control->cfg->getOrCreateProperty("Simulator", "sleeping",
+                                                      false, this);
+
+      cfgBroadphase = control->cfg->getOrCreateProperty("Simulator", "broadphase",
+                                                        std::string("hash"), this);
+
+      cfgBakeStatic = control->cfg->getOrCreateProperty("Simulator",
+                                                        "bake static geometry",
+                                                        false, this);
+
+      cfgTrace = control->cfg->getOrCreateProperty("Simulator", "trace",
+                                                   false, this);
+      control->cfg->getOrCreateProperty("Simulator", "trace file",
+                                        std::string("mars_trace.json"), this);
+      setTracing(cfgTrace.bValue);
+
+      cfgCollisionThreads = control->cfg->getOrCreateProperty("Simulator",
+                                                              "collision threads",
+                                                              (int)1, this);
+
+      cfgIslandThreads = control->cfg->getOrCreateProperty("Simulator",
+                                                           "island threads",
+                                                           (int)1, this);
+
       cfgGX = control->cfg->getOrCreateProperty("Simulator", "Gravity x",
                                                 0.0, this);
 
@@ -45,7 +45,12 @@
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
 
+#include "PluginScheduler.h"
+#include "RealTimePacer.h"
+
 #include <iostream>
+#include <utility>
+#include <vector>
 
 
 namespace mars {
@@ -120,12 +125,14 @@ namespace mars {
         stepping_mutex.lock();
         if(simulationStatus != STOPPED) {
           simulationStatus = STOPPING;
-          //stepping_wc.wakeAll();
+          stepping_wc.wakeAll();
         }
         stepping_mutex.unlock();
       }
 
       virtual void resetSim(bool resetGraphics=true);
+      virtual void saveSnapshot(std::vector<char> *snapshot);
+      virtual bool restoreSnapshot(const std::vector<char> &snapshot);
       virtual bool isSimRunning() const;
       bool startStopTrigger(); ///< Starts and pauses the simulation.
       virtual void singleStep(void);
@@ -169,6 +176,7 @@ namespace mars {
       virtual void postGraphicsUpdate(void);
       virtual void finishedDraw(void);
       void allowDraw(void); ///< Allows the osgWidget to draw a frame.
+      virtual bool waitForDraw(unsigned long timeout_ms);
 
       virtual bool getAllowDraw(void) {
         return allow_draw;
@@ -213,6 +221,10 @@ namespace mars {
        */
       virtual unsigned long getTime();
 
+      virtual void setStepProfiling(bool enable);
+      virtual void getStepProfile(interfaces::StepProfile *profile);
+      virtual void resetStepProfile(void);
+
     private:
 
       struct LoadOptions {
@@ -238,6 +250,9 @@ namespace mars {
       Status simulationStatus;
       interfaces::sReal sync_time;
       bool my_real_time;
+      RealTimePacer *realTimePacer;
+      /// Set by other threads to have myRealTime reset the pacer.
+      volatile bool pacerResetRequested;
       bool fast_step;      
 
 
@@ -245,21 +260,41 @@ namespace mars {
       bool allow_draw;
       bool sync_graphics;
       int cameraMenuCheckedIndex;
+      utils::Mutex drawMutex;
+      utils::WaitCondition draw_wc; ///< Woken when drawing is allowed.
 
       // threads
-      bool erased_active;
       utils::ReadWriteLock pluginLocker;
+      // update mode switches queued by switchPluginUpdateMode
+      std::vector<std::pair<int, interfaces::PluginInterface*> > pluginModeSwitches;
+      volatile bool havePluginModeSwitches;
+      utils::Mutex pluginModeMutex;
+      void applyPluginModeSwitches(void);
+      PluginScheduler *pluginScheduler;
       int sync_count;
       utils::Mutex externalMutex;
+      utils::WaitCondition requests_wc; ///< Woken when filesToLoad is processed.
       utils::Mutex coreMutex;
-      utils::Mutex physicsMutex;
-      utils::Mutex physicsCountMutex;
+      utils::Mutex physicsMutex; ///< Guards the tickets of the physics lock.
+      utils::WaitCondition physics_wc;
       utils::Mutex stepping_mutex; ///< Used for preventing active waiting for a single step or start event.
-      utils::WaitCondition stepping_wc; ///< Used for preventing active waiting for a single step or start event.
+      utils::WaitCondition stepping_wc; ///< Woken on every change of the simulation status, sync_count and sim_finished.
+      bool sim_finished; ///< Set when the physics thread left run().
       utils::Mutex getTimeMutex;
-      int physics_mutex_count;
+      unsigned long physics_next_ticket, physics_serving_ticket;
+      bool stopSimulationAndWait(void);
       double avg_log_time, avg_step_time;
       int count;
+
+      // step profiling
+      void profileStage(interfaces::StepStage stage, double *start);
+      bool profiling;
+      double stageMs[interfaces::NUMBER_OF_STEP_STAGES]; ///< of the running step
+      interfaces::StepProfile stepProfile;
+      utils::Mutex profileMutex;
+      // trace export, see utils::Trace
+      void setTracing(bool enable);
+      void writeTrace();
       interfaces::sReal calc_time;
       
       // physics
@@ -270,6 +305,7 @@ namespace mars {
       utils::Vector gravity;
       unsigned long dbPhysicsUpdateId;
       unsigned long dbSimTimeId;
+      unsigned long dbSleepingId;
       unsigned long realStartTime;
 
       // plugins
@@ -291,6 +327,13 @@ namespace mars {
       cfg_manager::cfgPropertyStruct cfgCalcMs, cfgFaststep;
       cfg_manager::cfgPropertyStruct cfgRealtime, cfgDebugTime;
       cfg_manager::cfgPropertyStruct cfgSyncGui, cfgDrawContact;
+      cfg_manager::cfgPropertyStruct cfgContactCache, cfgContactCacheTolerance;
+      cfg_manager::cfgPropertyStruct cfgSleeping;
+      cfg_manager::cfgPropertyStruct cfgBroadphase, cfgCollisionThreads;
+      cfg_manager::cfgPropertyStruct cfgBakeStatic;
+      cfg_manager::cfgPropertyStruct cfgIslandThreads, cfgTrace;
+      cfg_manager::cfgPropertyStruct cfgRealtimeCatchUp, cfgRealtimeMaxBurst;
+      cfg_manager::cfgPropertyStruct cfgRealtimePriority, cfgRealtimeCpu;
       cfg_manager::cfgPropertyStruct cfgGX, cfgGY, cfgGZ;
       cfg_manager::cfgPropertyStruct cfgWorldErp, cfgWorldCfm;
       cfg_manager::cfgPropertyStruct cfgVisRep;
@@ -301,6 +344,7 @@ namespace mars {
       // data
       data_broker::DataPackage dbPhysicsUpdatePackage;
       data_broker::DataPackage dbSimTimePackage;
+      data_broker::DataPackage dbSleepingPackage;
 
       // IceServer comServer;
 
@@ -1395,5 +1395,96 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Returns the ODE functions and the parameters that hold the
+     * motor state of the joint.
+     *
+     * \return The number of parameters in \a params.
+     */
+    int JointPhysics::getMotorParams(dJointID *motorJoint, const int **params,
+                                     dReal (**getParam)(dJointID, int),
+                                     void (**setParam)(dJointID, int, dReal)) const {
+      static const int motorParams[] = {dParamVel, dParamFMax,
+                                        dParamVel2, dParamFMax2,
+                                        dParamVel3, dParamFMax3};
+      *motorJoint = jointId;
+      *params = motorParams;
+      switch(joint_type) {
+      case JOINT_TYPE_HINGE:
+        *getParam = dJointGetHingeParam;
+        *setParam = dJointSetHingeParam;
+        return 2;
+      case JOINT_TYPE_HINGE2:
+        *getParam = dJointGetHinge2Param;
+        *setParam = dJointSetHinge2Param;
+        return 4;
+      case JOINT_TYPE_SLIDER:
+        *getParam = dJointGetSliderParam;
+        *setParam = dJointSetSliderParam;
+        return 2;
+      case JOINT_TYPE_UNIVERSAL:
+        *getParam = dJointGetUniversalParam;
+        *setParam = dJointSetUniversalParam;
+        return 4;
+      case JOINT_TYPE_BALL:
+        if(!ball_motor) return 0;
+        *motorJoint = ball_motor;
+        *getParam = dJointGetAMotorParam;
+        *setParam = dJointSetAMotorParam;
+        return 6;
+      default:
+        return 0;
+      }
+    }
+
+    /**
+     * \brief Writes the feedback of the last step, which also contains the
+     * constraint force used for warm starting the solver, and the motor
+     * parameters into the state buffer.
+     */
+    void JointPhysics::saveState(StateBuffer *state) const {
+      MutexLocker locker(&(theWorld->iMutex));
+      dJointID motorJoint;
+      const int *params;
+      dReal (*getParam)(dJointID, int);
+      void (*setParam)(dJointID, int, dReal);
+      int numParams = getMotorParams(&motorJoint, &params,
+                                     &getParam, &setParam);
+
+      state->write(joint_type);
+      state->write(feedback);
+      state->write(motor_torque);
+      state->write(axis1_torque);
+      state->write(axis2_torque);
+      state->write(joint_load);
+      for(int i=0; i<numParams; ++i) {
+        state->write(getParam(motorJoint, params[i]));
+      }
+    }
+
+    bool JointPhysics::restoreState(StateBuffer *state) {
+      MutexLocker locker(&(theWorld->iMutex));
+      dJointID motorJoint;
+      const int *params;
+      dReal (*getParam)(dJointID, int);
+      void (*setParam)(dJointID, int, dReal);
+      int numParams = getMotorParams(&motorJoint, &params,
+                                     &getParam, &setParam);
+      int type;
+
+      if(!state->read(&type) || type != joint_type) return false;
+      state->read(&feedback);
+      state->read(&motor_torque);
+      state->read(&axis1_torque);
+      state->read(&axis2_torque);
+      state->read(&joint_load);
+      for(int i=0; i<numParams; ++i) {
+        dReal value;
+        if(!state->read(&value)) return false;
+        setParam(motorJoint, params[i], value);
+      }
+      return state->good();
+    }
+
   } // end of namespace sim
 } // end of namespace mars
@@ -86,6 +86,8 @@ namespace mars {
       virtual void setHighStop(interfaces::sReal highStop);
       virtual void setLowStop2(interfaces::sReal lowStop2);
       virtual void setHighStop2(interfaces::sReal highStop2);
+      virtual void saveState(interfaces::StateBuffer *state) const;
+      virtual bool restoreState(interfaces::StateBuffer *state);
 
     private:
       WorldPhysics* theWorld;
@@ -100,6 +102,9 @@ namespace mars {
       dReal motor_torque;
 
       void calculateCfmErp(const interfaces::JointData *jointS);
+      int getMotorParams(dJointID *motorJoint, const int **params,
+                         dReal (**getParam)(dJointID, int),
+                         void (**setParam)(dJointID, int, dReal)) const;
 
       ///create a joint from type Hing
       void createHinge(interfaces::JointData* jointS,
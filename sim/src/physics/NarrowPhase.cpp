@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "NarrowPhase.h"
+
+#include <mars/utils/Thread.h>
+#include <mars/utils/Trace.h>
+
+namespace mars {
+  namespace sim {
+
+    using namespace utils;
+
+    class NarrowPhase::Worker : public Thread {
+    public:
+      Worker(NarrowPhase *narrowPhase, unsigned long generation)
+        : narrowPhase(narrowPhase), generation(generation) {}
+
+    protected:
+      void run() {
+        Trace::setThreadName("collision worker");
+#ifdef ODE11
+        dAllocateODEDataForThread(dAllocateMaskAll);
+#endif
+        narrowPhase->workerLoop(generation);
+#ifdef ODE11
+        dCleanupODEAllDataForThread();
+#endif
+      }
+
+    private:
+      NarrowPhase *narrowPhase;
+      unsigned long generation;
+    };
+
+    NarrowPhase::NarrowPhase() : pairs(NULL), tasks(NULL), nextTask(0),
+                                 busyWorkers(0), generation(0),
+                                 quit(false) {
+    }
+
+    NarrowPhase::~NarrowPhase() {
+      stopWorkers();
+    }
+
+    void NarrowPhase::setNumThreads(int numThreads) {
+      if(numThreads < 1) numThreads = 1;
+      if(numThreads == getNumThreads()) return;
+      stopWorkers();
+      for(int i=1; i<numThreads; ++i) {
+        workers.push_back(new Worker(this, generation));
+        workers.back()->start();
+      }
+    }
+
+    int NarrowPhase::getNumThreads() const {
+      return (int)workers.size()+1;
+    }
+
+    void NarrowPhase::stopWorkers() {
+      mutex.lock();
+      quit = true;
+      startCondition.wakeAll();
+      mutex.unlock();
+      for(size_t i=0; i<workers.size(); ++i) {
+        workers[i]->wait();
+        delete workers[i];
+      }
+      workers.clear();
+      quit = false;
+    }
+
+    void NarrowPhase::run(std::vector<CollisionPair> *pairs,
+                          const std::vector<Task> &tasks) {
+      mutex.lock();
+      this->pairs = pairs;
+      this->tasks = &tasks;
+      nextTask = 0;
+      busyWorkers = (int)workers.size();
+      ++generation;
+      startCondition.wakeAll();
+      runTasks();
+      while(busyWorkers) doneCondition.wait(&mutex);
+      this->pairs = NULL;
+      this->tasks = NULL;
+      mutex.unlock();
+    }
+
+    /**
+     * Takes tasks until none is left. Has to be called with locked mutex,
+     * the mutex is released while a task is processed.
+     */
+    void NarrowPhase::runTasks() {
+      MARS_TRACE_SCOPE("physics", "narrow phase");
+      while(nextTask < tasks->size()) {
+        const Task &task = (*tasks)[nextTask++];
+        mutex.unlock();
+        for(size_t i=0; i<task.size(); ++i) {
+          CollisionPair &pair = (*pairs)[task[i]];
+          if(pair.contacts.size() < (size_t)pair.maxNumContacts) {
+            pair.contacts.resize(pair.maxNumContacts);
+          }
+          if(pair.exclusive) exclusiveMutex.lock();
+          pair.numc = dCollide(pair.g1, pair.g2, pair.maxNumContacts,
+                               &pair.contacts[0], sizeof(dContactGeom));
+          if(pair.exclusive) exclusiveMutex.unlock();
+        }
+        mutex.lock();
+      }
+    }
+
+    void NarrowPhase::workerLoop(unsigned long seenGeneration) {
+      mutex.lock();
+      while(true) {
+        while(!quit && generation == seenGeneration) {
+          startCondition.wait(&mutex);
+        }
+        if(quit) break;
+        seenGeneration = generation;
+        runTasks();
+        if(--busyWorkers == 0) doneCondition.wakeAll();
+      }
+      mutex.unlock();
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,106 @@
+/*
+ *  Copyright 2016, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file NarrowPhase.h
+ * \brief Runs dCollide for a list of geom pairs in several threads.
+ */
+
+#ifndef NARROW_PHASE_H
+#define NARROW_PHASE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "NarrowPhase.h"
+#endif
+
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <vector>
+
+#include <ode/ode.h>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * A geom pair found by the broadphase. If \c test is set, the pair is
+     * collided by NarrowPhase::run and \c numc holds the number of contacts
+     * afterwards, otherwise \c numc is -1. The geoms \c g1 and \c g2 are
+     * given to dCollide; they are \c o1 and \c o2 or a copy of them that
+     * is used by one thread only. Pairs with \c exclusive set are collided
+     * one after the other by all threads.
+     */
+    struct CollisionPair {
+      dGeomID o1, o2;
+      dGeomID g1, g2;
+      int maxNumContacts;
+      bool test, exclusive;
+      int numc;
+      std::vector<dContactGeom> contacts;
+    };
+
+    /**
+     * \brief Collides geom pairs in a set of worker threads.
+     *
+     * The pairs are grouped into tasks by the caller. The pairs of one task
+     * are collided in order by the same thread, so pairs that share a geom
+     * whose collider keeps temporary data in the geom (e.g. heightfields)
+     * have to be put into the same task. The calling thread works on the
+     * tasks as well.
+     */
+    class NarrowPhase {
+    public:
+      typedef std::vector<size_t> Task;
+
+      NarrowPhase();
+      ~NarrowPhase();
+
+      /** \brief sets the number of threads including the calling thread */
+      void setNumThreads(int numThreads);
+      int getNumThreads() const;
+
+      /** \brief returns when all pairs of all tasks are collided */
+      void run(std::vector<CollisionPair> *pairs,
+               const std::vector<Task> &tasks);
+
+    private:
+      class Worker;
+
+      void stopWorkers();
+      void runTasks();
+      void workerLoop(unsigned long seenGeneration);
+
+      std::vector<Worker*> workers;
+      utils::Mutex mutex;
+      utils::Mutex exclusiveMutex;
+      utils::WaitCondition startCondition, doneCondition;
+      std::vector<CollisionPair> *pairs;
+      const std::vector<Task> *tasks;
+      size_t nextTask;
+      int busyWorkers;
+      unsigned long generation;
+      bool quit;
+    }; // end of class NarrowPhase
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif // NARROW_PHASE_H
@@ -41,9 +41,13 @@
 #include <mars/interfaces/Logging.hpp>
 #include <mars/utils/MutexLocker.h>
 #include <mars/utils/mathUtils.h>
+#include <mars/utils/TiledHeightMap.h>
+#include <mars/utils/ConvexDecomposition.h>
 #include <mars/interfaces/sensor_bases.h>
 #include <mars/interfaces/terrainStruct.h>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <set>
 
 
@@ -78,7 +82,9 @@ namespace mars {
       composite = false;
       //node_data.num_ground_collisions = 0;
       node_data.setZero();
-      height_data = 0;
+      terrain = 0;
+      heightMap = 0;
+      heightMapVersion = 0;
       dMassSetZero(&nMass);
     }
 
@@ -97,13 +103,21 @@ namespace mars {
       std::vector<sensor_list_element>::iterator iter;
       MutexLocker locker(&(theWorld->iMutex));
 
+      if(nGeom && !nBody) theWorld->unbakeStaticGeoms();
       if(nBody) theWorld->destroyBody(nBody, this);
 
-      if(nGeom) dGeomDestroy(nGeom);
+      if(nGeom) {
+        dGeomDestroy(nGeom);
+        theWorld->clearContactCache();
+      }
+      destroyProxies(&proxies);
 
       if(myVertices) free(myVertices);
       if(myIndices) free(myIndices);
-      if(height_data) free(height_data);
+      if(heightMap) {
+        theWorld->removeTerrain(this);
+        heightMap->unref();
+      }
 
       // TODO: how does this loop work? why doesn't it run forever?
       for(iter = sensor_list.begin(); iter != sensor_list.end();) {
@@ -200,6 +214,7 @@ namespace mars {
         }
         node_data.id = node->index;
         dGeomSetData(nGeom, &node_data);
+        setSleepParams(node);
         locker.unlock();
         setContactParams(node->c_params);
         return 1;
@@ -275,6 +290,7 @@ namespace mars {
       dReal npos[3];
       Vector offset;
       MutexLocker locker(&(theWorld->iMutex));
+      wakeUp();
 
       if(composite) {
         if(move_group) {
@@ -310,6 +326,7 @@ namespace mars {
           //std::cout << " " << pos.z();
           dGeomSetOffsetWorldPosition(nGeom, (dReal)pos.x(), (dReal)pos.y(),
                                       (dReal)pos.z());
+          updateProxies();
           // here we have to recalculate the mass
           theWorld->resetCompositeMass(nBody);
           return offset;
@@ -329,6 +346,7 @@ namespace mars {
           //offset.x() = pos->x - (sReal)(tpos[0]);
           //offset.y() = pos->y - (sReal)(tpos[1]);
           //offset.z() = pos->z - (sReal)(tpos[2]);
+          theWorld->unbakeStaticGeoms();
           dGeomSetPosition(nGeom, (dReal)pos.x(), (dReal)pos.y(), (dReal)pos.z());
           return offset;
         }
@@ -513,6 +531,7 @@ namespace mars {
       dMatrix3 R;
       dVector3 pos, new_pos, new2_pos;
       MutexLocker locker(&(theWorld->iMutex));
+      wakeUp();
 
       pos[0] = pos[1] = pos[2] = 0;
       tmp[1] = (dReal)q.x();
@@ -532,6 +551,7 @@ namespace mars {
         if(composite && !move_group) {
           dGeomGetQuaternion(nGeom, tmp2);
           dGeomSetOffsetWorldQuaternion(nGeom, tmp);
+          updateProxies();
         }
         else if (composite) {
           dGeomGetQuaternion(nGeom, tmp2);
@@ -551,6 +571,7 @@ namespace mars {
         }
       }
       else if(nGeom) {
+        theWorld->unbakeStaticGeoms();
         dGeomGetQuaternion(nGeom, tmp2);
         dGeomSetQuaternion(nGeom, tmp);
       }
@@ -636,6 +657,12 @@ namespace mars {
                                   node->mesh.vertexcount,
                                   myIndices, node->mesh.indexcount);
       nGeom = dCreateTriMesh(theWorld->getSpace(), myTriMeshData, 0, 0, 0);
+      if(node->movable && node->collision_proxy != COLLISION_PROXY_NONE &&
+         !node->proxy_hulls.empty()) {
+        // the trimesh only gives the frame of the node to the proxies
+        createProxies(node);
+        dGeomDisable(nGeom);
+      }
 
       // at this moment we set the mass properties as the mass of the
       // bounding box if no mass and inertia is set by the user
@@ -796,16 +823,23 @@ namespace mars {
 
     bool NodePhysics::createHeightfield(NodeData* node) {
       dMatrix3 R;
-      unsigned long size;
-      int x, y;
+      double minHeight, maxHeight;
       terrain = node->terrain;
-      size = terrain->width*terrain->height;
-      if(!height_data) height_data = (dReal*)calloc(size, sizeof(dReal));
-      for(x=0; x<terrain->height; x++) {
-        for(y=0; y<terrain->width; y++) {
-          height_data[(terrain->height-(x+1))*terrain->width+y] = (dReal)terrain->pixelData[x*terrain->width+y];
-        }
+      // the heightfield reads the samples shared with the graphics
+      if(terrain->heightMap) {
+        heightMap = terrain->heightMap;
+        heightMap->ref();
+      }
+      else {
+        heightMap = new utils::TiledHeightMap(terrain->width, terrain->height,
+                                              terrain->targetWidth,
+                                              terrain->targetHeight);
+        heightMap->setHeights(terrain->pixelData, terrain->scale);
       }
+      heightMap->lockForRead();
+      heightMapVersion = heightMap->getVersion();
+      heightMap->getHeightBounds(&minHeight, &maxHeight);
+      heightMap->unlock();
       // build the ode representation
       dHeightfieldDataID heightid = dGeomHeightfieldDataCreate();
 
@@ -816,18 +850,118 @@ namespace mars {
                                         terrain->width, terrain->height,
                                         REAL(1.0), REAL( 0.0 ),
                                         REAL(1.0), 0);
-      // Give some very bounds which, while conservative,
-      // makes AABB computation more accurate than +/-INF.
-      dGeomHeightfieldDataSetBounds(heightid, REAL(-terrain->scale*2.0),
-                                    REAL(terrain->scale*2.0));
-      //dGeomHeightfieldDataSetBounds(heightid, -terrain->scale, terrain->scale);
+      // the bounds are taken from the tiles and refitted by
+      // updateHeightfield() when the terrain is deformed
+      dGeomHeightfieldDataSetBounds(heightid, REAL(minHeight),
+                                    REAL(maxHeight));
       nGeom = dCreateHeightfield(theWorld->getSpace(), heightid, 1);
       dRSetIdentity(R);
       dRFromAxisAndAngle(R, 1, 0, 0, M_PI/2);
       dGeomSetRotation(nGeom, R);
+      theWorld->addTerrain(this);
       return true;
     }
 
+    /**
+     * \brief Creates a convex geom for every hull of NodeData::proxy_hulls
+     * or a box or capsule fitted to it.
+     *
+     * The proxies are attached to the body of the node by updateProxies().
+     */
+    void NodePhysics::createProxies(NodeData *node) {
+      for(size_t i=0; i<node->proxy_hulls.size(); ++i) {
+        const ConvexHull &hull = node->proxy_hulls[i];
+        proxy_geom *proxy = new proxy_geom;
+        Vector center(0, 0, 0);
+        Quaternion q = Quaternion::Identity();
+        if(node->collision_proxy == COLLISION_PROXY_BOXES) {
+          Vector size;
+          fitBox(hull, &center, &q, &size);
+          proxy->geom = dCreateBox(theWorld->getSpace(), (dReal)size.x(),
+                                   (dReal)size.y(), (dReal)size.z());
+        }
+        else if(node->collision_proxy == COLLISION_PROXY_CAPSULES) {
+          double radius, length;
+          fitCapsule(hull, &center, &q, &radius, &length);
+          proxy->geom = dCreateCapsule(theWorld->getSpace(), (dReal)radius,
+                                       (dReal)length);
+        }
+        else {
+          size_t numFaces = hull.triangles.size()/3;
+          proxy->points.assign(hull.points.begin(), hull.points.end());
+          for(size_t f=0; f<numFaces; ++f) {
+            const dReal *a = &proxy->points[hull.triangles[f*3]*3];
+            const dReal *b = &proxy->points[hull.triangles[f*3+1]*3];
+            const dReal *c = &proxy->points[hull.triangles[f*3+2]*3];
+            dVector3 u, v, n;
+            for(int k=0; k<3; ++k) {
+              u[k] = b[k] - a[k];
+              v[k] = c[k] - a[k];
+            }
+            dCROSS(n, =, u, v);
+            dNormalize3(n);
+            // ODE expects the planes as n*p = d
+            proxy->planes.push_back(n[0]);
+            proxy->planes.push_back(n[1]);
+            proxy->planes.push_back(n[2]);
+            proxy->planes.push_back(dDOT(n, a));
+            proxy->polygons.push_back(3);
+            for(int k=0; k<3; ++k) {
+              proxy->polygons.push_back(hull.triangles[f*3+k]);
+            }
+          }
+          proxy->geom = dCreateConvex(theWorld->getSpace(),
+                                      &proxy->planes[0], numFaces,
+                                      &proxy->points[0],
+                                      hull.points.size()/3,
+                                      &proxy->polygons[0]);
+        }
+        proxy->pos[0] = (dReal)center.x();
+        proxy->pos[1] = (dReal)center.y();
+        proxy->pos[2] = (dReal)center.z();
+        proxy->rot[0] = (dReal)q.w();
+        proxy->rot[1] = (dReal)q.x();
+        proxy->rot[2] = (dReal)q.y();
+        proxy->rot[3] = (dReal)q.z();
+        dGeomSetData(proxy->geom, &node_data);
+        proxies.push_back(proxy);
+      }
+    }
+
+    /**
+     * \brief Attaches the collision proxies to the body and places them
+     * relative to the offset of the node geom. Has to be called with locked
+     * iMutex whenever the offset of the node geom changes.
+     */
+    void NodePhysics::updateProxies(void) {
+      if(proxies.empty() || !nBody) return;
+      const dReal *offsetPos = dGeomGetOffsetPosition(nGeom);
+      dQuaternion offsetRot, rot;
+      dMatrix3 R;
+      dVector3 pos;
+      dGeomGetOffsetQuaternion(nGeom, offsetRot);
+      dQtoR(offsetRot, R);
+      for(size_t i=0; i<proxies.size(); ++i) {
+        proxy_geom *proxy = proxies[i];
+        if(dGeomGetBody(proxy->geom) != nBody) {
+          dGeomSetBody(proxy->geom, nBody);
+        }
+        dMULTIPLY0_331(pos, R, proxy->pos);
+        dGeomSetOffsetPosition(proxy->geom, offsetPos[0] + pos[0],
+                               offsetPos[1] + pos[1], offsetPos[2] + pos[2]);
+        dQMultiply0(rot, offsetRot, proxy->rot);
+        dGeomSetOffsetQuaternion(proxy->geom, rot);
+      }
+    }
+
+    void NodePhysics::destroyProxies(std::vector<proxy_geom*> *proxies) {
+      for(size_t i=0; i<proxies->size(); ++i) {
+        dGeomDestroy((*proxies)[i]->geom);
+        delete (*proxies)[i];
+      }
+      proxies->clear();
+    }
+
     /**
      * This method sets some properties for the node. The properties includes
      * the posistion, the rotation, the movability and the coposite group number
@@ -878,6 +1012,7 @@ namespace mars {
         addMassToCompositeBody(nBody, &bodyMass);
         dBodySetMass(nBody, &bodyMass);
       }
+      updateProxies();
 #ifdef _DEBUG_MASS_
       fprintf(stderr, "%mass id: %d %g\n", node->index, nMass.mass);
       fprintf(stderr, "\t%g\t%g\t%g\n", nMass.I[0], nMass.I[1], nMass.I[2]);
@@ -903,6 +1038,7 @@ namespace mars {
       Vector npos;
       dMatrix3 R;
       MutexLocker locker(&(theWorld->iMutex));
+      wakeUp();
   
       tmp[1] = (dReal)rotation.x();
       tmp[2] = (dReal)rotation.y();
@@ -947,6 +1083,7 @@ namespace mars {
           pos[1] = new_pos[1] + (dReal)rotation_point.y();
           pos[2] = new_pos[2] + (dReal)rotation_point.z();
           dGeomSetOffsetWorldPosition(nGeom, pos[0], pos[1], pos[2]);
+          updateProxies();
           npos.x() = (sReal)(pos[0]);
           npos.y() = (sReal)(pos[1]);
           npos.z() = (sReal)(pos[2]);
@@ -960,6 +1097,7 @@ namespace mars {
 
         }*/
       else if(nGeom) {
+        if(!nBody) theWorld->unbakeStaticGeoms();
         dGeomGetQuaternion(nGeom, tmp2);
         dQMultiply0(tmp3, tmp, tmp2);
         dGeomSetQuaternion(nGeom, tmp3);
@@ -1007,6 +1145,8 @@ namespace mars {
       MutexLocker locker(&(theWorld->iMutex));
 
       if(nGeom && theWorld && theWorld->existsWorld()) {
+        // the old geom may be part of a baked mesh
+        if(!nBody) theWorld->unbakeStaticGeoms();
         if(composite) {
           dGeomGetQuaternion(nGeom, rotation);
           tpos = dGeomGetPosition(nGeom);
@@ -1017,6 +1157,8 @@ namespace mars {
         // deferre destruction of geom until after the successful creation of 
         // a new geom
         dGeomID tmpGeomId = nGeom;
+        std::vector<proxy_geom*> oldProxies;
+        oldProxies.swap(proxies);
         // first we create a ode geometry for the node
         bool success = false;
         switch(node->physicMode) {
@@ -1044,6 +1186,7 @@ namespace mars {
           break;
         }
         if(!success) {
+          proxies.swap(oldProxies);
           fprintf(stderr, "creation of body geometry failed.\n");
           return 0;
         }
@@ -1052,6 +1195,8 @@ namespace mars {
           nBody = NULL;
         }
         dGeomDestroy(tmpGeomId);
+        destroyProxies(&oldProxies);
+        theWorld->clearContactCache();
         // now the geom is rebuild and we have to reconnect it to the body
         // and reset the mass of the body
         if(!node->movable) {
@@ -1091,9 +1236,11 @@ namespace mars {
                 theWorld->resetCompositeMass(nBody);
               }
             }
+            updateProxies();
           }
         }
         dGeomSetData(nGeom, &node_data);
+        setSleepParams(node);
         locker.unlock();
         setContactParams(node->c_params);
       }
@@ -1123,8 +1270,11 @@ namespace mars {
      */
     void NodePhysics::setLinearVelocity(const Vector &velocity) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetLinearVel(nBody, (dReal)velocity.x(),
-                                  (dReal)velocity.y(), (dReal)velocity.z());
+      if(nBody) {
+        wakeUp();
+        dBodySetLinearVel(nBody, (dReal)velocity.x(),
+                          (dReal)velocity.y(), (dReal)velocity.z());
+      }
     }
 
     /**
@@ -1138,8 +1288,11 @@ namespace mars {
      */
     void NodePhysics::setAngularVelocity(const Vector &velocity) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetAngularVel(nBody, (dReal)velocity.x(),
-                                   (dReal)velocity.y(), (dReal)velocity.z());
+      if(nBody) {
+        wakeUp();
+        dBodySetAngularVel(nBody, (dReal)velocity.x(),
+                           (dReal)velocity.y(), (dReal)velocity.z());
+      }
     }
 
     /**
@@ -1153,8 +1306,10 @@ namespace mars {
      */
     void NodePhysics::setForce(const Vector &f) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetForce(nBody, (dReal)f.x(),
-                              (dReal)f.y(), (dReal)f.z());
+      if(nBody) {
+        wakeUp();
+        dBodySetForce(nBody, (dReal)f.x(), (dReal)f.y(), (dReal)f.z());
+      }
     }
 
     /**
@@ -1168,8 +1323,10 @@ namespace mars {
      */
     void NodePhysics::setTorque(const Vector &t) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetTorque(nBody, (dReal)t.x(),
-                               (dReal)t.y(), (dReal)t.z());
+      if(nBody) {
+        wakeUp();
+        dBodySetTorque(nBody, (dReal)t.x(), (dReal)t.y(), (dReal)t.z());
+      }
     }
 
     /**
@@ -1184,6 +1341,7 @@ namespace mars {
     void NodePhysics::addForce(const Vector &f, const Vector &p) {
       MutexLocker locker(&(theWorld->iMutex));
       if(nBody) {
+        wakeUp();
         dBodyAddForceAtPos(nBody, 
                            (dReal)f.x(), (dReal)f.y(), (dReal)f.z(),
                            (dReal)p.x(), (dReal)p.y(), (dReal)p.z());
@@ -1201,6 +1359,7 @@ namespace mars {
     void NodePhysics::addForce(const Vector &f) {
       MutexLocker locker(&(theWorld->iMutex));
       if(nBody) {
+        wakeUp();
         dBodyAddForce(nBody, (dReal)f.x(), (dReal)f.y(), (dReal)f.z());
       }
     }
@@ -1216,7 +1375,10 @@ namespace mars {
      */
     void NodePhysics::addTorque(const Vector &t) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodyAddTorque(nBody, (dReal)t.x(), (dReal)t.y(), (dReal)t.z());
+      if(nBody) {
+        wakeUp();
+        dBodyAddTorque(nBody, (dReal)t.x(), (dReal)t.y(), (dReal)t.z());
+      }
     }
 
     bool NodePhysics::getGroundContact(void) const {
@@ -1296,6 +1458,7 @@ namespace mars {
 
       gpos = dGeomGetPosition(nGeom);
       dGeomSetOffsetWorldPosition(nGeom, gpos[0]+x, gpos[1]+y, gpos[2]+z);
+      updateProxies();
     }
 
     void NodePhysics::addMassToCompositeBody(dBodyID theBody, dMass *bodyMass) {
@@ -1335,16 +1498,54 @@ namespace mars {
     }
 
     dReal NodePhysics::heightCallback(int x, int y) {
+      // the rows of the heightfield run against the rows of the map
+      return (dReal)heightMap->getHeight(x, terrain->height-1-y);
+    }
+
+    void NodePhysics::lockHeightMap(void) {
+      if(heightMap) heightMap->lockForRead();
+    }
+
+    void NodePhysics::unlockHeightMap(void) {
+      if(heightMap) heightMap->unlock();
+    }
 
-      return (dReal)height_data[(y*terrain->width)+x]*terrain->scale;
+    void NodePhysics::updateHeightfield(void) {
+      double minHeight, maxHeight;
+      dVector3 pos;
+
+      if(!nGeom || heightMap->getVersion() == heightMapVersion) return;
+      heightMapVersion = heightMap->getVersion();
+      heightMap->getHeightBounds(&minHeight, &maxHeight);
+      dGeomHeightfieldDataSetBounds(dGeomHeightfieldGetHeightfieldData(nGeom),
+                                    REAL(minHeight), REAL(maxHeight));
+      // moving the geom in place recomputes its AABB from the new bounds
+      dCopyVector3(pos, dGeomGetPosition(nGeom));
+      dGeomSetPosition(nGeom, pos[0], pos[1], pos[2]);
+      theWorld->clearContactCache(nGeom);
     }
 
     void NodePhysics::setContactParams(contact_params& c_params) {
       MutexLocker locker(&(theWorld->iMutex));
       node_data.c_params = c_params;
       if(nGeom) {
-        dGeomSetCollideBits(nGeom, c_params.coll_bitmask);
         dGeomSetCategoryBits(nGeom, c_params.coll_bitmask);
+        // ODE tests a pair if the category bits of one geom match the
+        // collide bits of the other; without collide bits static geoms
+        // are never paired with each other in the broadphase
+        if(dGeomGetBody(nGeom)) {
+          dGeomSetCollideBits(nGeom, c_params.coll_bitmask);
+        }
+        else {
+          // the baked meshes are grouped by the contact parameters
+          theWorld->unbakeStaticGeoms();
+          dGeomSetCollideBits(nGeom, 0);
+        }
+      }
+      // proxies are only created for movable nodes
+      for(size_t i=0; i<proxies.size(); ++i) {
+        dGeomSetCategoryBits(proxies[i]->geom, c_params.coll_bitmask);
+        dGeomSetCollideBits(proxies[i]->geom, c_params.coll_bitmask);
       }
     }
 
@@ -1381,6 +1582,11 @@ namespace mars {
   
       //case SENSOR_TYPE_RAY:
       if(polarSensor){
+        // the rays would hit the own triangles of a baked mesh
+        if(!nBody) {
+          node_data.bake = false;
+          theWorld->unbakeStaticGeoms();
+        }
         sle.sensor = sensor;
         sle.updateTime = 0.0;
         //sensor.count_data = sensor.resolution;
@@ -1691,13 +1897,22 @@ namespace mars {
      */
     void NodePhysics::destroyNode(void) {
       MutexLocker locker(&(theWorld->iMutex));
+      if(nGeom && !nBody) theWorld->unbakeStaticGeoms();
       if(nBody) theWorld->destroyBody(nBody, this);
 
-      if(nGeom) dGeomDestroy(nGeom);
+      if(nGeom) {
+        dGeomDestroy(nGeom);
+        theWorld->clearContactCache();
+      }
+      destroyProxies(&proxies);
 
       if(myVertices) free(myVertices);
       if(myIndices) free(myIndices);
       if(myTriMeshData) dGeomTriMeshDataDestroy(myTriMeshData);
+      if(heightMap) {
+        theWorld->removeTerrain(this);
+        heightMap->unref();
+      }
 
       nBody = 0;
       nGeom = 0;
@@ -1707,7 +1922,8 @@ namespace mars {
       composite = false;
       //node_data.num_ground_collisions = 0;
       node_data.setZero();
-      height_data = 0;
+      terrain = 0;
+      heightMap = 0;
     }
 
     void NodePhysics::setInertiaMass(NodeData* node) {
@@ -1747,10 +1963,169 @@ namespace mars {
 
     sReal NodePhysics::getCollisionDepth(void) const {
       if(nGeom && theWorld) {
-        return theWorld->getCollisionDepth(nGeom);
+        if(proxies.empty()) return theWorld->getCollisionDepth(nGeom);
+        sReal depth = 0.0;
+        for(size_t i=0; i<proxies.size(); ++i) {
+          depth = std::max(depth,
+                           theWorld->getCollisionDepth(proxies[i]->geom));
+        }
+        return depth;
       }
       return 0.0;
     }
 
+    bool NodePhysics::isSleeping(void) const {
+      MutexLocker locker(&(theWorld->iMutex));
+      return nBody && !dBodyIsEnabled(nBody);
+    }
+
+    /**
+     * \brief Enables the body of the node if it was disabled by the
+     *        sleeping of the world. Has to be called with locked iMutex.
+     */
+    void NodePhysics::wakeUp(void) {
+      if(nBody && !dBodyIsEnabled(nBody)) dBodyEnable(nBody);
+    }
+
+    /**
+     * \brief Sets the auto disable parameters of the body.
+     *
+     * The thresholds of a composite body are taken from the node that was
+     * added last. Whether the body may sleep at all is decided by the world,
+     * since every node of the body has to allow it.
+     */
+    void NodePhysics::setSleepParams(NodeData *node) {
+      node_data.sleep = node->sleep;
+      if(!nBody) return;
+      dBodySetAutoDisableLinearThreshold(nBody, (dReal)node->sleep_linear_threshold);
+      dBodySetAutoDisableAngularThreshold(nBody, (dReal)node->sleep_angular_threshold);
+      dBodySetAutoDisableTime(nBody, (dReal)node->sleep_time);
+      dBodySetAutoDisableSteps(nBody, 0);
+      theWorld->updateAutoDisable(nBody);
+    }
+
+    /**
+     * \brief Resets the auto disable counters of \a body to the full idle
+     *        time and steps and clears its velocity samples. The enabled
+     *        flag of the body is kept.
+     *
+     * ODE has no getters for the counters, but dBodyEnable sets them to the
+     * idle time and steps of the body.
+     */
+    static void resetAutoDisableState(dBodyID body) {
+      bool enabled = dBodyIsEnabled(body);
+      dBodyEnable(body);
+      dBodySetAutoDisableAverageSamplesCount(
+        body, dBodyGetAutoDisableAverageSamplesCount(body));
+      if(!enabled) dBodyDisable(body);
+    }
+
+    /**
+     * \brief Writes the body state, the contact state of the last step and
+     * the update timers of the ray sensors into the state buffer.
+     *
+     * dBodySetQuaternion normalizes the given quaternion. To get the same
+     * values after a restore, the saved quaternion is also applied to the
+     * body while saving. In the same way the auto disable counters of the
+     * body, which can not be read from ODE, are reset while saving and
+     * restoring, so a sleeping world continues identically after a restore.
+     */
+    void NodePhysics::saveState(StateBuffer *state) {
+      MutexLocker locker(&(theWorld->iMutex));
+      bool hasBody = (nBody != 0);
+      state->write(hasBody);
+      if(nBody) {
+        dQuaternion q;
+        memcpy(q, dBodyGetQuaternion(nBody), sizeof(dQuaternion));
+        state->writeRaw(dBodyGetPosition(nBody), sizeof(dReal)*3);
+        state->writeRaw(q, sizeof(dQuaternion));
+        state->writeRaw(dBodyGetLinearVel(nBody), sizeof(dReal)*3);
+        state->writeRaw(dBodyGetAngularVel(nBody), sizeof(dReal)*3);
+        state->writeRaw(dBodyGetForce(nBody), sizeof(dReal)*3);
+        state->writeRaw(dBodyGetTorque(nBody), sizeof(dReal)*3);
+        state->write(dBodyIsEnabled(nBody));
+        dBodySetQuaternion(nBody, q);
+        resetAutoDisableState(nBody);
+      }
+      else if(nGeom && dGeomGetClass(nGeom) != dPlaneClass) {
+        state->writeRaw(dGeomGetPosition(nGeom), sizeof(dReal)*3);
+        state->writeRaw(dGeomGetRotation(nGeom), sizeof(dMatrix3));
+      }
+
+      state->write(node_data.num_ground_collisions);
+      state->write(node_data.contact_points.size());
+      for(size_t i=0; i<node_data.contact_points.size(); ++i) {
+        state->write(node_data.contact_points[i]);
+      }
+      state->write(node_data.contact_ids.size());
+      std::list<unsigned long>::const_iterator it;
+      for(it=node_data.contact_ids.begin(); it!=node_data.contact_ids.end();
+          ++it) {
+        state->write(*it);
+      }
+      state->write(sensor_list.size());
+      for(size_t i=0; i<sensor_list.size(); ++i) {
+        state->write(sensor_list[i].updateTime);
+      }
+    }
+
+    bool NodePhysics::restoreState(StateBuffer *state) {
+      MutexLocker locker(&(theWorld->iMutex));
+      bool hasBody;
+      size_t size;
+
+      if(!state->read(&hasBody) || hasBody != (nBody != 0)) return false;
+      if(nBody) {
+        dReal pos[3], lvel[3], avel[3], force[3], torque[3];
+        dQuaternion q;
+        int enabled;
+        state->readRaw(pos, sizeof(pos));
+        state->readRaw(q, sizeof(dQuaternion));
+        state->readRaw(lvel, sizeof(lvel));
+        state->readRaw(avel, sizeof(avel));
+        state->readRaw(force, sizeof(force));
+        state->readRaw(torque, sizeof(torque));
+        if(!state->read(&enabled)) return false;
+        dBodySetPosition(nBody, pos[0], pos[1], pos[2]);
+        dBodySetQuaternion(nBody, q);
+        dBodySetLinearVel(nBody, lvel[0], lvel[1], lvel[2]);
+        dBodySetAngularVel(nBody, avel[0], avel[1], avel[2]);
+        dBodySetForce(nBody, force[0], force[1], force[2]);
+        dBodySetTorque(nBody, torque[0], torque[1], torque[2]);
+        if(enabled) dBodyEnable(nBody);
+        else dBodyDisable(nBody);
+        resetAutoDisableState(nBody);
+      }
+      else if(nGeom && dGeomGetClass(nGeom) != dPlaneClass) {
+        dReal pos[3];
+        dMatrix3 R;
+        state->readRaw(pos, sizeof(pos));
+        if(!state->readRaw(R, sizeof(dMatrix3))) return false;
+        dGeomSetPosition(nGeom, pos[0], pos[1], pos[2]);
+        dGeomSetRotation(nGeom, R);
+      }
+
+      // the feedback structs of the last step are already freed
+      node_data.ground_feedbacks.clear();
+      state->read(&node_data.num_ground_collisions);
+      if(!state->read(&size)) return false;
+      node_data.contact_points.resize(size);
+      for(size_t i=0; i<size; ++i) {
+        state->read(&node_data.contact_points[i]);
+      }
+      if(!state->read(&size)) return false;
+      node_data.contact_ids.clear();
+      for(size_t i=0; i<size; ++i) {
+        unsigned long id = 0;
+        state->read(&id);
+        node_data.contact_ids.push_back(id);
+      }
+      if(!state->read(&size) || size != sensor_list.size()) return false;
+      for(size_t i=0; i<sensor_list.size(); ++i) {
+        state->read(&sensor_list[i].updateTime);
+      }
+      return state->good();
+    }
+
   } // end of namespace sim
 } // end of namespace mars
@@ -41,6 +41,10 @@
 #endif
 
 namespace mars {
+  namespace utils {
+    class TiledHeightMap;
+  }
+
   namespace sim {
 
     /*
@@ -53,6 +57,9 @@ namespace mars {
         num_ground_collisions = 0;
         ray_sensor = 0;
         sense_contact_force = 1;
+        sleep = 1;
+        bake = 1;
+        baked = 0;
         value = 0;
         c_params.setZero();
       }
@@ -69,11 +76,29 @@ namespace mars {
       interfaces::contact_params c_params;
       bool ray_sensor;
       bool sense_contact_force;
+      bool sleep;
+      /** static geoms are only merged into a baked mesh if set */
+      bool bake;
+      /** set while the geom is merged into a baked mesh */
+      bool baked;
       interfaces::sReal value;
       dGeomID parent_geom;
       dBodyID parent_body;
     };
 
+    /**
+     * A collision proxy of a mesh node, placed relative to the frame of the
+     * node. A convex geom keeps its arrays here since ODE does not copy them.
+     */
+    struct proxy_geom {
+      dGeomID geom;
+      dVector3 pos;
+      dQuaternion rot;
+      std::vector<dReal> planes;
+      std::vector<dReal> points;
+      std::vector<unsigned int> polygons;
+    };
+
     struct sensor_list_element {
       interfaces::BaseSensor *sensor;
       geom_data *gd;
@@ -125,6 +150,9 @@ namespace mars {
       virtual void getMass(interfaces::sReal *mass, interfaces::sReal *inertia=0) const;
       virtual const utils::Vector getContactForce(void) const;
       virtual interfaces::sReal getCollisionDepth(void) const;
+      virtual bool isSleeping(void) const;
+      virtual void saveState(interfaces::StateBuffer *state);
+      virtual bool restoreState(interfaces::StateBuffer *state);
       void addCompositeOffset(dReal x, dReal y, dReal z);
       ///return the body; this function is created to make it possible to get the 
       ///body from joint physics s
@@ -132,7 +160,15 @@ namespace mars {
       dMass getODEMass(void) const;
       void addMassToCompositeBody(dBodyID theBody, dMass *bodyMass);
       void getAbsMass(dMass *pMass) const;
+      /** \brief called by ODE; the height map has to be locked for reading */
       dReal heightCallback(int x, int y);
+      /**
+       * \brief refits the heightfield bounds after the terrain changed.
+       *        The height map has to be locked for reading.
+       */
+      void updateHeightfield(void);
+      void lockHeightMap(void);
+      void unlockHeightMap(void);
 
     protected:
       WorldPhysics *theWorld;
@@ -145,8 +181,12 @@ namespace mars {
       bool composite;
       geom_data node_data;
       interfaces::terrainStruct *terrain;
-      dReal *height_data;
+      utils::TiledHeightMap *heightMap;
+      unsigned long heightMapVersion;
       std::vector<sensor_list_element> sensor_list;
+      /** replace the disabled trimesh of a mesh node; see
+       *  NodeData::collision_proxy */
+      std::vector<proxy_geom*> proxies;
       bool createMesh(interfaces::NodeData *node);
       bool createBox(interfaces::NodeData *node);
       bool createSphere(interfaces::NodeData *node);
@@ -154,8 +194,13 @@ namespace mars {
       bool createCylinder(interfaces::NodeData *node);
       bool createPlane(interfaces::NodeData *node);
       bool createHeightfield(interfaces::NodeData *node);
+      void createProxies(interfaces::NodeData *node);
+      void updateProxies(void);
+      static void destroyProxies(std::vector<proxy_geom*> *proxies);
       void setProperties(interfaces::NodeData *node);
       void setInertiaMass(interfaces::NodeData *node);
+      void setSleepParams(interfaces::NodeData *node);
+      void wakeUp(void);
     };
 
   } // end of namespace sim
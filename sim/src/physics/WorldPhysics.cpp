@@ -41,11 +41,18 @@
 
 
 #include <mars/utils/MutexLocker.h>
+#include <mars/utils/misc.h>
+#include <mars/utils/Trace.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/interfaces/Logging.hpp>
 
+#include <set>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
 namespace mars {
   namespace sim {
 
@@ -54,6 +61,21 @@ namespace mars {
 
     PhysicsError WorldPhysics::error = PHYSICS_NO_ERROR;
 
+    /**
+     * The static meshes of one set of contact parameters merged into one
+     * trimesh. The original geoms stay disabled in the space and
+     * every triangle refers to the geom_data of its original geom.
+     */
+    struct StaticBake {
+      dGeomID geom;
+      dTriMeshDataID meshData;
+      std::vector<dReal> vertices;
+      std::vector<dTriIndex> indices;
+      std::vector<geom_data*> triangleData;
+      std::vector<dGeomID> geoms;
+      geom_data data;
+    };
+
     void myMessageFunction(int errnum, const char *msg, va_list ap) {
       CPP_UNUSED(errnum);
       LOG_INFO(msg, ap);
@@ -100,6 +122,28 @@ namespace mars {
       num_contacts = 0;
       create_contacts = 1;
       log_contacts = 0;
+      contact_cache = false;
+      contact_cache_tolerance = 1e-5;
+      sleeping = old_sleeping = false;
+      broadphase = old_broadphase = BROADPHASE_HASH;
+      tunedNumGeoms = 0;
+      broadphasePairs = 0;
+      collision_threads = 1;
+      island_threads = old_island_threads = 1;
+      profiling = false;
+      collision_ms = 0.0;
+      old_fast_step = false;
+      bake_static_geoms = old_bake_static_geoms = false;
+      bakeDirty = true;
+      staticSpace = 0;
+#ifdef ODE_THREADING
+      threading = 0;
+      threadPool = 0;
+#endif
+      gatherPairs = false;
+      numCollisionPairs = 0;
+      cacheStep = 0;
+      cacheStats = ContactCacheStats();
 
       // the step size in seconds
       step_size = 0.01;
@@ -110,7 +154,9 @@ namespace mars {
       // for ode-0.11
       dInitODE2(0);
       dAllocateODEDataForThread(dAllocateMaskAll);
+      trimeshThreadSafe = dCheckConfiguration("ODE_EXT_mt_collisions");
 #else
+      trimeshThreadSafe = false;
       dInitODE();
 #endif
       dSetErrorHandler (myErrorFunction);
@@ -131,6 +177,7 @@ namespace mars {
     WorldPhysics::~WorldPhysics(void) {
       // free the ode objects
       freeTheWorld();
+      narrowPhaseThreads.setNumThreads(1);
       // and close the ODE ...
       MutexLocker locker(&iMutex);
       dCloseODE();
@@ -154,7 +201,9 @@ namespace mars {
       if (!world_init) {
         //LOG_DEBUG("init physics world");
         world = dWorldCreate();
-        space = dHashSpaceCreate(0);
+        old_broadphase = broadphase;
+        tunedNumGeoms = 0;
+        space = createSpace();
         contactgroup = dJointGroupCreate(0);
 
         old_gravity = world_gravity;
@@ -190,9 +239,14 @@ namespace mars {
       MutexLocker locker(&iMutex);
       if(world_init) {
         //LOG_DEBUG("free physics world");
+        freeIslandThreads();
+        releaseBakes();
+        bakeDirty = true;
         dJointGroupDestroy(contactgroup);
         dSpaceDestroy(space);
+        space = 0;
         dWorldDestroy(world);
+        contactCache.clear();
         world_init = 0;
       }
       // else debug something
@@ -225,6 +279,7 @@ namespace mars {
      */
     void WorldPhysics::stepTheWorld(void) {
       MutexLocker locker(&iMutex);
+      MARS_TRACE_SCOPE("physics", "stepTheWorld");
       std::vector<dJointFeedback*>::iterator iter;
       geom_data* data;
       int i;
@@ -247,26 +302,101 @@ namespace mars {
           dWorldSetERP(world, (dReal)world_erp);
         }
 
-        /// first clear the collision counters of all geoms
-        for(i=0; i<dSpaceGetNumGeoms(space); i++) {
-          data = (geom_data*)dGeomGetData(dSpaceGetGeom(space, i));
+        if(old_sleeping != sleeping) {
+          old_sleeping = sleeping;
+          for(i=0; i<dSpaceGetNumGeoms(space); i++) {
+            dBodyID body = dGeomGetBody(dSpaceGetGeom(space, i));
+            if(body) updateAutoDisable(body);
+          }
+        }
+
+        if(old_bake_static_geoms != bake_static_geoms) {
+          old_bake_static_geoms = bake_static_geoms;
+          if(!bake_static_geoms) unbakeStaticGeoms();
+        }
+        if(bake_static_geoms && bakeDirty) bakeGeoms();
+
+        updateBroadphase();
+        updateIslandThreads();
+
+        /// first clear the collision counters of all geoms; sleeping
+        /// bodies get no new contacts with the static world or with each
+        /// other, so they keep the contacts of the step in which they
+        /// fell asleep, including the feedback of the contact forces
+        std::set<dJointFeedback*> keptFeedbacks;
+        int numGeoms = dSpaceGetNumGeoms(space);
+        int numStatic = staticSpace ? dSpaceGetNumGeoms(staticSpace) : 0;
+        for(i=0; i<numGeoms+numStatic; i++) {
+          dGeomID geom = (i < numGeoms ? dSpaceGetGeom(space, i) :
+                          dSpaceGetGeom(staticSpace, i-numGeoms));
+          if(dGeomIsSpace(geom)) continue;
+          dBodyID body = dGeomGetBody(geom);
+          data = (geom_data*)dGeomGetData(geom);
+          if(body && !dBodyIsEnabled(body)) {
+            keptFeedbacks.insert(data->ground_feedbacks.begin(),
+                                 data->ground_feedbacks.end());
+            continue;
+          }
           data->num_ground_collisions = 0;
           data->contact_ids.clear();
           data->contact_points.clear();
           data->ground_feedbacks.clear();
         }
+        std::vector<dJointFeedback*> feedbacks;
         for(iter = contact_feedback_list.begin();
             iter != contact_feedback_list.end(); iter++) {
-          free((*iter));
+          if(keptFeedbacks.count(*iter)) feedbacks.push_back(*iter);
+          else free((*iter));
         }
-        contact_feedback_list.clear();
+        contact_feedback_list.swap(feedbacks);
         draw_intern.clear();
         /// then we have to clear the contacts
         dJointGroupEmpty(contactgroup);
+        /// the height maps stay locked for reading until the collision
+        /// pass is done, since they may be deformed by other threads
+        /// (e.g. GraphicsManager::collideSphere); deformed terrains need
+        /// new bounds before the broadphase
+        lockTerrains();
+        for(size_t t=0; t<terrains.size(); ++t) {
+          terrains[t]->updateHeightfield();
+        }
         /// first check for collisions
+        bool timing = profiling || utils::Trace::isEnabled();
+        double collisionStart = timing ? utils::getClockMs() : 0.0;
         num_contacts = log_contacts = 0;
         create_contacts = 1;
-        dSpaceCollide(space,this, &WorldPhysics::callbackForward);
+        ++cacheStep;
+        cacheStats.narrowPhaseCalls = cacheStats.narrowPhaseSkipped = 0;
+        cacheStats.contacts = 0;
+        broadphasePairs = 0;
+        narrowPhaseThreads.setNumThreads(collision_threads);
+        if(collision_threads > 1) {
+          gatherPairs = true;
+          numCollisionPairs = 0;
+          dSpaceCollide(space,this, &WorldPhysics::callbackForward);
+          gatherPairs = false;
+          collidePairs();
+        }
+        else {
+          dSpaceCollide(space,this, &WorldPhysics::callbackForward);
+        }
+        unlockTerrains();
+        cacheStats.broadphasePairs = broadphasePairs;
+        /// remove the pairs that are not close to each other anymore
+        ContactCache::iterator it = contactCache.begin();
+        while(it != contactCache.end()) {
+          if(!contact_cache || it->second.lastStep != cacheStep) {
+            contactCache.erase(it++);
+          }
+          else ++it;
+        }
+        cacheStats.cachedPairs = contactCache.size();
+        if(timing) {
+          double collisionEnd = utils::getClockMs();
+          collision_ms = collisionEnd - collisionStart;
+          utils::Trace::complete("physics", "collision", collisionStart,
+                                 collisionEnd);
+        }
         
         drawLock.lock();
         draw_extern.swap(draw_intern);
@@ -274,6 +404,7 @@ namespace mars {
 
         /// then calculate the next state for a time of step_size seconds
         try {
+          MARS_TRACE_SCOPE("physics", "solver");
           if(fast_step) dWorldQuickStep(world, step_size);
           else dWorldStep(world, step_size);
         } catch (...) {
@@ -432,19 +563,14 @@ namespace mars {
      * in the simulation.
      */
     void WorldPhysics::nearCallback (dGeomID o1, dGeomID o2) {
-      int i;
       int numc;
-      //up to MAX_CONTACTS contact per Box-box
-      //dContact contact[MAX_CONTACTS];
-      dVector3 v1, v;
-      //dMatrix3 R;
-      dReal dot;
   
       if (dGeomIsSpace(o1) || dGeomIsSpace(o2)) {
         /// test if a space is colliding with something
         dSpaceCollide2(o1,o2,this,& WorldPhysics::callbackForward);
         return;
       }
+      ++broadphasePairs;
   
       /// exit without doing anything if the two bodies are connected by a joint 
       dBodyID b1=dGeomGetBody(o1);
@@ -463,6 +589,8 @@ namespace mars {
         if(geom_data1->parent_body == dGeomGetBody(o2)) {
           return;
         }
+        // a baked mesh has to report its nearest triangle
+        if(!staticBakes.empty() && getBake(o2)) dGeomRaySetClosestHit(o1, 1);
         
         numc = dCollide(o2, o1, 1|CONTACTS_UNIMPORTANT, &(contact.geom), sizeof(dContact));
         if(numc) {
@@ -480,6 +608,7 @@ namespace mars {
         if(geom_data2->parent_body == dGeomGetBody(o1)) {
           return;
         }
+        if(!staticBakes.empty() && getBake(o1)) dGeomRaySetClosestHit(o2, 1);
         numc = dCollide(o2, o1, 1|CONTACTS_UNIMPORTANT, &(contact.geom), sizeof(dContact));
         if(numc) {
           if(contact.geom.depth < geom_data2->value)
@@ -494,14 +623,75 @@ namespace mars {
 
       if(!b1 && !b2 && !geom_data1->ray_sensor && !geom_data2->ray_sensor) return;
 
-      int maxNumContacts = 0;
+      /// sleeping bodies don't need contacts among each other or with the
+      /// static world; they are enabled by contacts with active bodies and
+      /// keep the contacts of their last active step (see stepTheWorld)
+      if((!b1 || !dBodyIsEnabled(b1)) && (!b2 || !dBodyIsEnabled(b2))) return;
+
+      if(gatherPairs) addCollisionPair(o1, o2);
+      else handlePair(o1, o2, NULL);
+    }
+
+    static int getMaxNumContacts(geom_data *geom_data1, geom_data *geom_data2) {
       if(geom_data1->c_params.max_num_contacts <
          geom_data2->c_params.max_num_contacts) {
-        maxNumContacts = geom_data1->c_params.max_num_contacts;
+        return geom_data1->c_params.max_num_contacts;
       }
-      else {
-        maxNumContacts = geom_data2->c_params.max_num_contacts;
+      return geom_data2->c_params.max_num_contacts;
+    }
+
+    /**
+     * \brief Returns the geom_data of the original geom that is hit by a
+     *        contact with a baked mesh, or \a data if \a bake is NULL.
+     */
+    static geom_data* getContactData(const StaticBake *bake, geom_data *data,
+                                     int triangle, const dReal *pos) {
+      dReal aabb[6];
+
+      if(!bake) return data;
+      if(triangle >= 0 && (size_t)triangle < bake->triangleData.size()) {
+        return bake->triangleData[triangle];
+      }
+      // not all colliders report the triangle; take the geom whose
+      // bounding box contains the contact
+      for(size_t i=0; i<bake->geoms.size(); ++i) {
+        dGeomGetAABB(bake->geoms[i], aabb);
+        if(pos[0] >= aabb[0] && pos[0] <= aabb[1] &&
+           pos[1] >= aabb[2] && pos[1] <= aabb[3] &&
+           pos[2] >= aabb[4] && pos[2] <= aabb[5]) {
+          return (geom_data*)dGeomGetData(bake->geoms[i]);
+        }
       }
+      return data;
+    }
+
+    /**
+     * \brief Creates the contacts of a geom pair that passed the tests of
+     *        nearCallback.
+     *
+     * If \a pair is given, the result of its narrow phase is used instead
+     * of calling dCollide.
+     */
+    void WorldPhysics::handlePair(dGeomID o1, dGeomID o2,
+                                  const CollisionPair *pair) {
+      int i;
+      int numc;
+      //up to MAX_CONTACTS contact per Box-box
+      //dContact contact[MAX_CONTACTS];
+      dVector3 v1, v;
+      //dMatrix3 R;
+      dReal dot;
+
+      dBodyID b1=dGeomGetBody(o1);
+      dBodyID b2=dGeomGetBody(o2);
+
+      geom_data* geom_data1 = (geom_data*)dGeomGetData(o1);
+      geom_data* geom_data2 = (geom_data*)dGeomGetData(o2);
+      geom_data *contact_data1, *contact_data2;
+      StaticBake *bake1 = staticBakes.empty() ? NULL : getBake(o1);
+      StaticBake *bake2 = staticBakes.empty() ? NULL : getBake(o2);
+
+      int maxNumContacts = getMaxNumContacts(geom_data1, geom_data2);
       dContact *contact = new dContact[maxNumContacts];
 
 
@@ -654,7 +844,7 @@ namespace mars {
         contact[i] = contact[0];
       }
 
-      numc=dCollide(o1,o2, maxNumContacts, &contact[0].geom,sizeof(dContact));
+      numc = collide(o1, o2, maxNumContacts, contact, pair);
       if(numc){ 
         dJointFeedback *fb;
         draw_item item;
@@ -662,6 +852,7 @@ namespace mars {
 
         num_contacts++;
         if(create_contacts) {
+          cacheStats.contacts += numc;
           fb = 0;
           item.id = 0;
           item.type = DRAW_LINE;
@@ -703,35 +894,43 @@ namespace mars {
             dJointID c=dJointCreateContact(world,contactgroup,contact+i);
             dJointAttach(c,b1,b2);
 
-            geom_data1->num_ground_collisions += numc;
-            geom_data2->num_ground_collisions += numc;
+            // the contacts of a baked mesh belong to the node of the
+            // triangle
+            contact_data1 = getContactData(bake1, geom_data1,
+                                           contact[i].geom.side1,
+                                           contact[i].geom.pos);
+            contact_data2 = getContactData(bake2, geom_data2,
+                                           contact[i].geom.side2,
+                                           contact[i].geom.pos);
+            contact_data1->num_ground_collisions += numc;
+            contact_data2->num_ground_collisions += numc;
 
             contact_point.x() = contact[i].geom.pos[0];
             contact_point.y() = contact[i].geom.pos[1];
             contact_point.z() = contact[i].geom.pos[2];
 
-            geom_data1->contact_ids.push_back(geom_data2->id);
-            geom_data2->contact_ids.push_back(geom_data1->id);
-            geom_data1->contact_points.push_back(contact_point);
-            geom_data2->contact_points.push_back(contact_point);
+            contact_data1->contact_ids.push_back(contact_data2->id);
+            contact_data2->contact_ids.push_back(contact_data1->id);
+            contact_data1->contact_points.push_back(contact_point);
+            contact_data2->contact_points.push_back(contact_point);
             //if(dGeomGetClass(o1) == dPlaneClass) {
             fb = 0;
-            if(geom_data2->sense_contact_force) {
+            if(contact_data2->sense_contact_force) {
               fb = (dJointFeedback*)malloc(sizeof(dJointFeedback));
               dJointSetFeedback(c, fb);
               contact_feedback_list.push_back(fb);
-              geom_data2->ground_feedbacks.push_back(fb);
-              geom_data2->node1 = false;
+              contact_data2->ground_feedbacks.push_back(fb);
+              contact_data2->node1 = false;
             } 
             //else if(dGeomGetClass(o2) == dPlaneClass) {
-            if(geom_data1->sense_contact_force) {
+            if(contact_data1->sense_contact_force) {
               if(!fb) {
                 fb = (dJointFeedback*)malloc(sizeof(dJointFeedback));
                 dJointSetFeedback(c, fb);
                 contact_feedback_list.push_back(fb);
               }
-              geom_data1->ground_feedbacks.push_back(fb);
-              geom_data1->node1 = true;
+              contact_data1->ground_feedbacks.push_back(fb);
+              contact_data1->node1 = true;
             }
           }
         }
@@ -739,6 +938,296 @@ namespace mars {
       delete[] contact;
     }
 
+    static void getGeomFrame(dGeomID geom, dVector3 pos, dMatrix3 rot) {
+      if(dGeomIsPlaceable(geom)) {
+        const dReal *p = dGeomGetPosition(geom);
+        const dReal *r = dGeomGetRotation(geom);
+        pos[0] = p[0];
+        pos[1] = p[1];
+        pos[2] = p[2];
+        memcpy(rot, r, sizeof(dMatrix3));
+      }
+      else {
+        // planes are not placeable and are defined in world coordinates
+        pos[0] = pos[1] = pos[2] = 0;
+        dRSetIdentity(rot);
+      }
+    }
+
+    /**
+     * \brief Computes the frame of o1 and the pose of o2 relative to it:
+     *        relPos = r1^T * (p2 - p1), relRot = r1^T * r2
+     */
+    static void getRelativeFrame(dGeomID o1, dGeomID o2, dVector3 p1,
+                                 dMatrix3 r1, dVector3 relPos,
+                                 dMatrix3 relRot) {
+      dVector3 p2, d;
+      dMatrix3 r2;
+      int i, j;
+
+      getGeomFrame(o1, p1, r1);
+      getGeomFrame(o2, p2, r2);
+      for(i=0; i<3; i++) d[i] = p2[i] - p1[i];
+      memset(relRot, 0, sizeof(dMatrix3));
+      for(i=0; i<3; i++) {
+        relPos[i] = r1[i]*d[0] + r1[4+i]*d[1] + r1[8+i]*d[2];
+        for(j=0; j<3; j++) {
+          relRot[i*4+j] = r1[i]*r2[j] + r1[4+i]*r2[4+j] + r1[8+i]*r2[8+j];
+        }
+      }
+    }
+
+    /**
+     * \brief Returns \c true if the contacts of the cache entry can be
+     *        used for the given relative pose of the pair.
+     */
+    static bool isCacheValid(const ContactCacheEntry &entry,
+                             int maxNumContacts, const dVector3 relPos,
+                             const dMatrix3 relRot, dReal tolerance) {
+      if(!entry.lastStep || entry.maxNumContacts != maxNumContacts) {
+        return false;
+      }
+      for(int i=0; i<3; i++) {
+        if(fabs(relPos[i] - entry.relPos[i]) > tolerance) return false;
+        for(int j=0; j<3; j++) {
+          if(fabs(relRot[i*4+j] - entry.relRot[i*4+j]) > tolerance) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    /**
+     * \brief Returns \c true if collide() will take the contacts of the
+     *        pair from the contact cache.
+     */
+    bool WorldPhysics::isCached(dGeomID o1, dGeomID o2,
+                                int maxNumContacts) const {
+      dVector3 p1, relPos;
+      dMatrix3 r1, relRot;
+
+      if(!contact_cache) return false;
+      ContactCache::const_iterator it;
+      it = contactCache.find(std::make_pair(o1, o2));
+      if(it == contactCache.end()) return false;
+      getRelativeFrame(o1, o2, p1, r1, relPos, relRot);
+      return isCacheValid(it->second, maxNumContacts, relPos, relRot,
+                          contact_cache_tolerance);
+    }
+
+    /**
+     * \brief Runs the narrow phase for the geom pair or takes the contacts
+     *        from the contact cache.
+     *
+     * If the contact cache is enabled and the relative transform of the
+     * geoms changed less than contact_cache_tolerance since the pair was
+     * last tested, the contacts of that test are moved along with o1 and
+     * dCollide is skipped. Otherwise the contacts are calculated, or taken
+     * from \a pair if it was already collided, and stored in the cache.
+     *
+     * pre:
+     *     - contact has space for maxNumContacts entries
+     *
+     * post:
+     *     - the geom part of the first n contacts is set and n is returned
+     */
+    int WorldPhysics::collide(dGeomID o1, dGeomID o2, int maxNumContacts,
+                              dContact *contact, const CollisionPair *pair) {
+      dVector3 p1, d, relPos;
+      dMatrix3 r1, relRot;
+      int i, k, numc;
+
+      if(!contact_cache) {
+        return narrowPhase(o1, o2, maxNumContacts, contact, pair);
+      }
+
+      getRelativeFrame(o1, o2, p1, r1, relPos, relRot);
+      ContactCacheEntry &entry = contactCache[std::make_pair(o1, o2)];
+      if(isCacheValid(entry, maxNumContacts, relPos, relRot,
+                      contact_cache_tolerance)) {
+        entry.lastStep = cacheStep;
+        cacheStats.narrowPhaseSkipped++;
+        numc = (int)entry.contacts.size();
+        for(k=0; k<numc; k++) {
+          const dContactGeom &c = entry.contacts[k];
+          contact[k].geom = c;
+          for(i=0; i<3; i++) {
+            contact[k].geom.pos[i] = p1[i] + (r1[i*4]*c.pos[0] +
+                                              r1[i*4+1]*c.pos[1] +
+                                              r1[i*4+2]*c.pos[2]);
+            contact[k].geom.normal[i] = (r1[i*4]*c.normal[0] +
+                                         r1[i*4+1]*c.normal[1] +
+                                         r1[i*4+2]*c.normal[2]);
+          }
+        }
+        return numc;
+      }
+
+      numc = narrowPhase(o1, o2, maxNumContacts, contact, pair);
+      memcpy(entry.relPos, relPos, sizeof(dVector3));
+      memcpy(entry.relRot, relRot, sizeof(dMatrix3));
+      entry.maxNumContacts = maxNumContacts;
+      entry.lastStep = cacheStep;
+      entry.contacts.resize(numc);
+      for(k=0; k<numc; k++) {
+        dContactGeom &c = entry.contacts[k];
+        c = contact[k].geom;
+        for(i=0; i<3; i++) d[i] = contact[k].geom.pos[i] - p1[i];
+        for(i=0; i<3; i++) {
+          c.pos[i] = r1[i]*d[0] + r1[4+i]*d[1] + r1[8+i]*d[2];
+          c.normal[i] = (r1[i]*contact[k].geom.normal[0] +
+                         r1[4+i]*contact[k].geom.normal[1] +
+                         r1[8+i]*contact[k].geom.normal[2]);
+        }
+      }
+      return numc;
+    }
+
+    int WorldPhysics::narrowPhase(dGeomID o1, dGeomID o2, int maxNumContacts,
+                                  dContact *contact,
+                                  const CollisionPair *pair) {
+      cacheStats.narrowPhaseCalls++;
+      if(pair && pair->numc >= 0) {
+        for(int k=0; k<pair->numc; k++) {
+          contact[k].geom = pair->contacts[k];
+        }
+        return pair->numc;
+      }
+      return dCollide(o1, o2, maxNumContacts, &contact[0].geom,
+                      sizeof(dContact));
+    }
+
+    /**
+     * \brief Stores a pair found by the broadphase for the parallel
+     *        narrow phase.
+     */
+    void WorldPhysics::addCollisionPair(dGeomID o1, dGeomID o2) {
+      if(numCollisionPairs == collisionPairs.size()) {
+        collisionPairs.resize(numCollisionPairs+1);
+      }
+      CollisionPair &pair = collisionPairs[numCollisionPairs++];
+      pair.o1 = pair.g1 = o1;
+      pair.o2 = pair.g2 = o2;
+      pair.exclusive = false;
+      pair.maxNumContacts = getMaxNumContacts((geom_data*)dGeomGetData(o1),
+                                              (geom_data*)dGeomGetData(o2));
+      pair.test = !isCached(o1, o2, pair.maxNumContacts);
+      pair.numc = -1;
+    }
+
+    /**
+     * \brief Returns \c true if dCollide only reads the geom. Other
+     *        colliders keep temporary data in the geom (heightfield) or
+     *        coherence data (trimesh), so the pairs of such a geom have
+     *        to be collided by one thread.
+     */
+    static bool isSharedGeom(dGeomID geom) {
+      switch(dGeomGetClass(geom)) {
+      case dSphereClass:
+      case dBoxClass:
+      case dCapsuleClass:
+      case dCylinderClass:
+      case dPlaneClass:
+      case dRayClass:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    /**
+     * \brief Creates a heightfield geom outside of any space that shares
+     *        the height data and the pose of \a heightfield.
+     */
+    static dGeomID copyHeightfield(dGeomID heightfield) {
+      dGeomID copy = dCreateHeightfield(
+        0, dGeomHeightfieldGetHeightfieldData(heightfield), 1);
+      dGeomSetPosition(copy, dGeomGetPosition(heightfield)[0],
+                       dGeomGetPosition(heightfield)[1],
+                       dGeomGetPosition(heightfield)[2]);
+      dGeomSetRotation(copy, dGeomGetRotation(heightfield));
+      return copy;
+    }
+
+    static size_t findRoot(std::vector<size_t> &parent, size_t i) {
+      while(parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+      }
+      return i;
+    }
+
+    /**
+     * \brief Collides the gathered pairs in parallel and creates their
+     *        contacts in the order the broadphase found them, which gives
+     *        the same result as the serial collision step.
+     */
+    void WorldPhysics::collidePairs(void) {
+      std::map<dGeomID, size_t> owner;
+      std::map<dGeomID, size_t>::iterator it;
+      std::vector<size_t> parent(numCollisionPairs);
+      std::map<size_t, size_t> taskOfRoot;
+      std::map<dGeomID, size_t> numHeightfieldPairs;
+      std::map<std::pair<dGeomID, size_t>, dGeomID> copies;
+      std::map<std::pair<dGeomID, size_t>, dGeomID>::iterator ct;
+      size_t numThreads = (size_t)narrowPhaseThreads.getNumThreads();
+      size_t i, root;
+
+      // pairs that share a geom which is not read only go into one task.
+      // The heightfield collider writes its temporary buffers into the
+      // heightfield geom, so the pairs of a heightfield are spread round
+      // robin over one copy of it per thread. Without thread local
+      // collision data the trimesh colliders share one cache; the pairs of
+      // different trimeshes still go into different tasks, but are
+      // collided one after the other (CollisionPair::exclusive).
+      tasks.clear();
+      for(i=0; i<numCollisionPairs; ++i) {
+        CollisionPair &pair = collisionPairs[i];
+        parent[i] = i;
+        if(!pair.test) continue;
+        for(int k=0; k<2; ++k) {
+          dGeomID &key = k ? pair.g2 : pair.g1;
+          if(isSharedGeom(key)) continue;
+          if(dGeomGetClass(key) == dHeightfieldClass && numThreads > 1) {
+            size_t n = numHeightfieldPairs[key]++ % numThreads;
+            dGeomID &copy = copies[std::make_pair(key, n)];
+            if(!copy) copy = copyHeightfield(key);
+            key = copy;
+          }
+          if(!trimeshThreadSafe && dGeomGetClass(key) == dTriMeshClass) {
+            pair.exclusive = true;
+          }
+          it = owner.find(key);
+          if(it == owner.end()) owner[key] = i;
+          else parent[findRoot(parent, i)] = findRoot(parent, it->second);
+        }
+      }
+      for(i=0; i<numCollisionPairs; ++i) {
+        if(!collisionPairs[i].test) continue;
+        root = findRoot(parent, i);
+        if(!taskOfRoot.count(root)) {
+          taskOfRoot[root] = tasks.size();
+          tasks.push_back(NarrowPhase::Task());
+        }
+        tasks[taskOfRoot[root]].push_back(i);
+      }
+
+      narrowPhaseThreads.run(&collisionPairs, tasks);
+      for(i=0; i<numCollisionPairs; ++i) {
+        CollisionPair &pair = collisionPairs[i];
+        // the contacts refer to the geoms of the world, not to the copies
+        for(int k=0; k<pair.numc; ++k) {
+          pair.contacts[k].g1 = pair.o1;
+          pair.contacts[k].g2 = pair.o2;
+        }
+        handlePair(pair.o1, pair.o2, &pair);
+      }
+      for(ct=copies.begin(); ct!=copies.end(); ++ct) {
+        dGeomDestroy(ct->second);
+      }
+    }
+
     /**
      * \brief This static function is used to project a normal function
      *   pointer to a method from a class
@@ -836,8 +1325,11 @@ namespace mars {
 
     int WorldPhysics::handleCollision(dGeomID theGeom) {
       ray_collision = 0;
+      // the height maps may be deformed by other threads meanwhile
+      lockTerrains();
       dSpaceCollide2(theGeom, (dGeomID)space, this,
                      &WorldPhysics::callbackForward);
+      unlockTerrains();
       return ray_collision;
     }
 
@@ -849,11 +1341,23 @@ namespace mars {
       dBodyID b1;
       dBodyID b2;
 
-      for(int i=0; i<dSpaceGetNumGeoms(space); i++) {
-        otherGeom = dSpaceGetGeom(space, i);
-
-        if(!(dGeomGetCollideBits(theGeom) & dGeomGetCollideBits(otherGeom)))
+      // the static primitives are tested in their sub-space (see bakeGeoms)
+      int numGeoms = dSpaceGetNumGeoms(space);
+      int numStatic = staticSpace ? dSpaceGetNumGeoms(staticSpace) : 0;
+      lockTerrains();
+      for(int i=0; i<numGeoms+numStatic; i++) {
+        otherGeom = (i < numGeoms ? dSpaceGetGeom(space, i) :
+                     dSpaceGetGeom(staticSpace, i-numGeoms));
+        if(dGeomIsSpace(otherGeom)) continue;
+
+        // the collide bits of static geoms are cleared, the category bits
+        // hold the collision bitmask of every geom
+        if(!(dGeomGetCategoryBits(theGeom) & dGeomGetCategoryBits(otherGeom)))
           continue;
+        // the disabled original geoms of a baked mesh are tested instead
+        if(!staticBakes.empty() && getBake(otherGeom)) continue;
+        // the other geoms of the same node, e.g. its collision proxies
+        if(dGeomGetData(otherGeom) == dGeomGetData(theGeom)) continue;
 
         b1 = dGeomGetBody(theGeom);
         b2 = dGeomGetBody(otherGeom);
@@ -868,6 +1372,7 @@ namespace mars {
             depth = contact[0].geom.depth;
         }
       }
+      unlockTerrains();
 
       return depth;
     }
@@ -876,7 +1381,9 @@ namespace mars {
       MutexLocker locker(&iMutex);
       num_contacts = log_contacts = 0;
       create_contacts = 0;
-      dSpaceCollide(space,this, &WorldPhysics::callbackForward);	
+      lockTerrains();
+      dSpaceCollide(space,this, &WorldPhysics::callbackForward);
+      unlockTerrains();
       return num_contacts;
     }
 
@@ -891,11 +1398,24 @@ namespace mars {
   
       dGeomID theGeom = dCreateRay(space, depth);
       dGeomRaySet(theGeom, pos.x(), pos.y(), pos.z(), ray.x(), ray.y(), ray.z()); 
-
-      for(int i=0; i<dSpaceGetNumGeoms(space); i++) {
-        otherGeom = dSpaceGetGeom(space, i);
-
-        if(!(dGeomGetCollideBits(theGeom) & dGeomGetCollideBits(otherGeom)))
+      // report the nearest triangle of meshes
+      dGeomRaySetClosestHit(theGeom, 1);
+
+      int numGeoms = dSpaceGetNumGeoms(space);
+      int numStatic = staticSpace ? dSpaceGetNumGeoms(staticSpace) : 0;
+      lockTerrains();
+      for(int i=0; i<numGeoms+numStatic; i++) {
+        otherGeom = (i < numGeoms ? dSpaceGetGeom(space, i) :
+                     dSpaceGetGeom(staticSpace, i-numGeoms));
+        if(dGeomIsSpace(otherGeom)) continue;
+
+        // baked geoms are found via the tree of their mesh; other
+        // disabled geoms, e.g. of sensors, are hit as before
+        if(!dGeomIsEnabled(otherGeom)) {
+          geom_data *data = (geom_data*)dGeomGetData(otherGeom);
+          if(data && data->baked) continue;
+        }
+        if(!(dGeomGetCategoryBits(theGeom) & dGeomGetCategoryBits(otherGeom)))
           continue;
         numc = dCollide(theGeom, otherGeom, 1 | CONTACTS_UNIMPORTANT,
                         &(contact[0].geom), sizeof(dContact));
@@ -904,10 +1424,620 @@ namespace mars {
             depth = contact[0].geom.depth;
         }
       }
+      unlockTerrains();
 
       dGeomDestroy(theGeom);
       return depth;
     }
 
+    /**
+     * \brief Stores the state of the world that is not part of the nodes:
+     * the seed of the ODE random number generator, which is used by the
+     * quick step solver to reorder the constraints, and the order of the
+     * geoms in the collision space, which defines the order in which the
+     * contacts are created.
+     *
+     * Moving a body changes the order of the geoms in the space. Thus, the
+     * world state has to be saved and restored after the node states.
+     *
+     * The baked meshes and the static sub-space are not stored. Both
+     * saveState and restoreState split them, so the original run and the
+     * restored one merge the same geoms in the same order before their
+     * next step.
+     */
+    void WorldPhysics::saveState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      if(world_init) unbakeStaticGeoms();
+      int numGeoms = world_init ? dSpaceGetNumGeoms(space) : 0;
+
+      state->write(dRandGetSeed());
+      state->write(numGeoms);
+      for(int i=0; i<numGeoms; ++i) {
+        state->write(dSpaceGetGeom(space, i));
+      }
+      // the cache decides which pairs run the narrow phase in the next step
+      state->write((unsigned long)contactCache.size());
+      for(ContactCache::const_iterator it=contactCache.begin();
+          it!=contactCache.end(); ++it) {
+        unsigned long numc = it->second.contacts.size();
+        state->write(it->first);
+        state->write(it->second.relPos);
+        state->write(it->second.relRot);
+        state->write(it->second.maxNumContacts);
+        state->write(numc);
+        if(numc) {
+          state->writeRaw(&it->second.contacts[0], numc*sizeof(dContactGeom));
+        }
+      }
+    }
+
+    bool WorldPhysics::restoreState(StateBuffer *state) {
+      MutexLocker locker(&iMutex);
+      unsigned long seed;
+      int numGeoms;
+      std::vector<dGeomID> geoms;
+      std::set<dGeomID> currentGeoms;
+
+      if(!state->read(&seed) || !state->read(&numGeoms)) return false;
+      if(!world_init) {
+        unsigned long numPairs;
+        return numGeoms == 0 && state->read(&numPairs) && numPairs == 0;
+      }
+      unbakeStaticGeoms();
+      if(numGeoms != dSpaceGetNumGeoms(space)) return false;
+      for(int i=0; i<numGeoms; ++i) {
+        currentGeoms.insert(dSpaceGetGeom(space, i));
+      }
+      geoms.resize(numGeoms);
+      for(int i=0; i<numGeoms; ++i) {
+        if(!state->read(&geoms[i]) || !currentGeoms.count(geoms[i])) {
+          return false;
+        }
+      }
+
+      ContactCache cache;
+      unsigned long numPairs;
+      if(!state->read(&numPairs)) return false;
+      for(unsigned long n=0; n<numPairs; ++n) {
+        std::pair<dGeomID, dGeomID> key;
+        ContactCacheEntry entry;
+        unsigned long numc;
+        if(!state->read(&key) || !currentGeoms.count(key.first) ||
+           !currentGeoms.count(key.second) ||
+           !state->read(&entry.relPos) || !state->read(&entry.relRot) ||
+           !state->read(&entry.maxNumContacts) || !state->read(&numc)) {
+          return false;
+        }
+        entry.lastStep = cacheStep;
+        entry.contacts.resize(numc);
+        if(numc && !state->readRaw(&entry.contacts[0],
+                                   numc*sizeof(dContactGeom))) {
+          return false;
+        }
+        cache[key] = entry;
+      }
+
+      dRandSetSeed(seed);
+      // dSpaceAdd inserts the geom at the front of the list
+      for(int i=0; i<numGeoms; ++i) {
+        dSpaceRemove(space, geoms[i]);
+      }
+      for(int i=numGeoms-1; i>=0; --i) {
+        dSpaceAdd(space, geoms[i]);
+      }
+      contactCache.swap(cache);
+      return true;
+    }
+
+    ContactCacheStats WorldPhysics::getContactCacheStats(void) const {
+      MutexLocker locker(&iMutex);
+      return cacheStats;
+    }
+
+    /**
+     * \brief Enables or disables the auto disabling of a body.
+     *
+     * A body is allowed to sleep if sleeping is enabled for the world and
+     * all nodes of the body have NodeData::sleep set. Has to be called with
+     * locked iMutex.
+     */
+    void WorldPhysics::updateAutoDisable(dBodyID theBody) {
+      bool canSleep = sleeping;
+      dGeomID geom;
+      geom_data *data;
+
+      for(geom = dBodyGetFirstGeom(theBody); geom && canSleep;
+          geom = dBodyGetNextGeom(geom)) {
+        data = (geom_data*)dGeomGetData(geom);
+        if(data && !data->sleep) canSleep = false;
+      }
+      dBodySetAutoDisableFlag(theBody, canSleep);
+      if(!canSleep && !dBodyIsEnabled(theBody)) dBodyEnable(theBody);
+    }
+
+    /**
+     * \brief Gets the bounding box of all finite geoms of the space as
+     *        min x, max x, min y, max y, min z, max z. Has to be called
+     *        with locked iMutex.
+     * \return \c false if the space has no finite geom.
+     */
+    bool WorldPhysics::getGeomBounds(dReal bounds[6]) const {
+      dReal aabb[6];
+      bool found = false;
+      for(int i=0; space && i<dSpaceGetNumGeoms(space); ++i) {
+        dGeomGetAABB(dSpaceGetGeom(space, i), aabb);
+        // skip planes and other infinite geoms
+        if(!(aabb[1]-aabb[0] < dInfinity && aabb[3]-aabb[2] < dInfinity &&
+             aabb[5]-aabb[4] < dInfinity)) continue;
+        for(int k=0; k<3; ++k) {
+          if(!found || aabb[k*2] < bounds[k*2]) bounds[k*2] = aabb[k*2];
+          if(!found || aabb[k*2+1] > bounds[k*2+1]) {
+            bounds[k*2+1] = aabb[k*2+1];
+          }
+        }
+        found = true;
+      }
+      return found;
+    }
+
+    /**
+     * \brief Creates an empty collision space of the type selected by
+     *        broadphase. Has to be called with locked iMutex.
+     *
+     * The quadtree is fitted to the extent of the geoms in the current
+     * space plus a margin of a quarter of that extent, so the geoms can
+     * move a bit before the tree has to be rebuilt (see updateBroadphase).
+     */
+    dSpaceID WorldPhysics::createSpace(void) {
+      switch(broadphase) {
+      case BROADPHASE_SAP:
+        return dSweepAndPruneSpaceCreate(0, dSAP_AXES_XYZ);
+      case BROADPHASE_SIMPLE:
+        return dSimpleSpaceCreate(0);
+      case BROADPHASE_QUADTREE: {
+        dVector3 center = {0, 0, 0, 0};
+        dVector3 extents = {500, 500, 500, 0};
+        dReal bounds[6];
+        if(getGeomBounds(bounds)) {
+          for(int k=0; k<3; ++k) {
+            center[k] = 0.5*(bounds[k*2]+bounds[k*2+1]);
+            extents[k] = 0.625*(bounds[k*2+1]-bounds[k*2]) + 1.0;
+          }
+        }
+        for(int k=0; k<3; ++k) {
+          quadTreeBounds[k*2] = center[k] - extents[k];
+          quadTreeBounds[k*2+1] = center[k] + extents[k];
+        }
+        return dQuadTreeSpaceCreate(0, center, extents, 6);
+      }
+      default:
+        return dHashSpaceCreate(0);
+      }
+    }
+
+    /**
+     * \brief Moves all geoms into a new collision space. Has to be called
+     *        with locked iMutex.
+     */
+    void WorldPhysics::rebuildSpace(void) {
+      int numGeoms = dSpaceGetNumGeoms(space);
+      std::vector<dGeomID> geoms(numGeoms);
+      for(int i=0; i<numGeoms; ++i) {
+        geoms[i] = dSpaceGetGeom(space, i);
+      }
+      dSpaceID newSpace = createSpace();
+      for(int i=0; i<numGeoms; ++i) {
+        dSpaceRemove(space, geoms[i]);
+      }
+      // keep the order of the geoms, dSpaceAdd inserts at the front
+      for(int i=numGeoms-1; i>=0; --i) {
+        dSpaceAdd(newSpace, geoms[i]);
+      }
+      dSpaceDestroy(space);
+      space = newSpace;
+    }
+
+    /**
+     * \brief Returns \c true if the quadtree still fits the geoms: they
+     *        have not left its region in x and y and the region is at most
+     *        four times as large as their extent.
+     */
+    static bool quadTreeFits(const dReal region[6], const dReal bounds[6]) {
+      for(int k=0; k<2; ++k) {
+        if(bounds[k*2] < region[k*2] || bounds[k*2+1] > region[k*2+1]) {
+          return false;
+        }
+        if(region[k*2+1]-region[k*2] > 4.0*(bounds[k*2+1]-bounds[k*2]) + 2.0) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    /**
+     * \brief Applies a change of the broadphase and adapts the collision
+     *        space to the geoms. The hash levels are tuned whenever the
+     *        number of geoms changed, the quadtree is rebuilt only if the
+     *        bounds of the world do not fit its region anymore. Has to be
+     *        called with locked iMutex.
+     */
+    void WorldPhysics::updateBroadphase(void) {
+      int numGeoms = dSpaceGetNumGeoms(space);
+      bool rebuild = old_broadphase != broadphase;
+      dReal bounds[6];
+      if(!rebuild && broadphase == BROADPHASE_QUADTREE) {
+        // one pass over the bounding boxes, which are needed by the
+        // collision test of this step anyway
+        rebuild = getGeomBounds(bounds) && !quadTreeFits(quadTreeBounds,
+                                                         bounds);
+      }
+      if(rebuild) {
+        old_broadphase = broadphase;
+        rebuildSpace();
+        tunedNumGeoms = -1;
+      }
+      if(broadphase == BROADPHASE_HASH && numGeoms != tunedNumGeoms) {
+        tuneHashLevels();
+      }
+      tunedNumGeoms = numGeoms;
+    }
+
+    /**
+     * \brief Sets the cell sizes of the hash space to range from the
+     *        smallest to the largest finite geom. Larger geoms are tested
+     *        against all others anyway. Has to be called with locked iMutex.
+     */
+    void WorldPhysics::tuneHashLevels(void) {
+      dReal minSize = dInfinity, maxSize = 0;
+      dReal aabb[6];
+
+      for(int i=0; i<dSpaceGetNumGeoms(space); ++i) {
+        dGeomID geom = dSpaceGetGeom(space, i);
+        // the static sub-space spans the world and is tested against all
+        // geoms anyway
+        if(dGeomIsSpace(geom)) continue;
+        dGeomGetAABB(geom, aabb);
+        dReal size = std::max(aabb[1]-aabb[0],
+                              std::max(aabb[3]-aabb[2], aabb[5]-aabb[4]));
+        if(!(size < dInfinity)) continue;
+        if(size < minSize) minSize = size;
+        if(size > maxSize) maxSize = size;
+      }
+      if(maxSize <= 0) return;
+      if(minSize < 0.001) minSize = 0.001;
+      int minLevel = (int)floor(log(minSize)/log(2.0));
+      int maxLevel = (int)ceil(log(maxSize)/log(2.0));
+      if(minLevel < -10) minLevel = -10;
+      if(maxLevel > 20) maxLevel = 20;
+      if(maxLevel < minLevel) maxLevel = minLevel;
+      dHashSpaceSetLevels(space, minLevel, maxLevel);
+    }
+
+    /**
+     * \brief Hands the islands of the world to a thread pool if more than
+     *        one island thread is requested. Has to be called with locked
+     *        iMutex.
+     */
+    void WorldPhysics::updateIslandThreads(void) {
+      int numThreads = island_threads > 1 ? island_threads : 1;
+      if(numThreads == old_island_threads && fast_step == old_fast_step) {
+        return;
+      }
+#ifdef ODE_THREADING
+      if(numThreads != old_island_threads) {
+        freeIslandThreads();
+        if(numThreads > 1) {
+          threading = dThreadingAllocateMultiThreadedImplementation();
+          threadPool = dThreadingAllocateThreadPool(numThreads, 0,
+                                                    dAllocateFlagBasicData,
+                                                    NULL);
+          dThreadingThreadPoolServeMultiThreadedImplementation(threadPool,
+                                                               threading);
+          dWorldSetStepThreadingImplementation(
+            world, dThreadingImplementationGetFunctions(threading), threading);
+        }
+      }
+      if(threading) {
+        dWorldSetStepIslandsProcessingMaxThreadCount(world,
+                                                     fast_step ? 1 : numThreads);
+      }
+#else
+      if(numThreads > 1 && numThreads != old_island_threads) {
+        LOG_WARN("WorldPhysics: ode was built without threading support, "
+                 "the islands are solved in one thread");
+      }
+#endif
+      old_island_threads = numThreads;
+      old_fast_step = fast_step;
+    }
+
+    /**
+     * \brief Stops the island threads. Has to be called with locked iMutex
+     *        before the world is destroyed.
+     */
+    void WorldPhysics::freeIslandThreads(void) {
+#ifdef ODE_THREADING
+      if(threading) {
+        dThreadingImplementationShutdownProcessing(threading);
+        dThreadingFreeThreadPool(threadPool);
+        dWorldSetStepThreadingImplementation(world, NULL, NULL);
+        dThreadingFreeImplementation(threading);
+        threading = 0;
+        threadPool = 0;
+      }
+#endif
+      old_island_threads = 1;
+    }
+
+    /**
+     * \brief Removes all pairs from the contact cache.
+     *
+     * Has to be called with locked iMutex whenever a geom is destroyed,
+     * since a new geom can get the ID of the destroyed one.
+     */
+    void WorldPhysics::clearContactCache(void) {
+      contactCache.clear();
+    }
+
+    void WorldPhysics::clearContactCache(dGeomID geom) {
+      ContactCache::iterator it = contactCache.begin();
+      while(it != contactCache.end()) {
+        if(it->first.first == geom || it->first.second == geom) {
+          contactCache.erase(it++);
+        }
+        else ++it;
+      }
+    }
+
+    /**
+     * \brief Registers a heightfield whose bounds are refitted before each
+     *        collision test. Called with iMutex locked.
+     */
+    void WorldPhysics::addTerrain(NodePhysics *node) {
+      terrains.push_back(node);
+    }
+
+    void WorldPhysics::removeTerrain(NodePhysics *node) {
+      std::vector<NodePhysics*>::iterator it;
+      it = std::find(terrains.begin(), terrains.end(), node);
+      if(it != terrains.end()) terrains.erase(it);
+    }
+
+    void WorldPhysics::lockTerrains(void) const {
+      for(size_t t=0; t<terrains.size(); ++t) {
+        terrains[t]->lockHeightMap();
+      }
+    }
+
+    void WorldPhysics::unlockTerrains(void) const {
+      for(size_t t=0; t<terrains.size(); ++t) {
+        terrains[t]->unlockHeightMap();
+      }
+    }
+
+    /**
+     * \brief Appends the world space triangles of a static mesh to \a bake.
+     */
+    static void appendTriangles(StaticBake *bake, dGeomID geom) {
+      geom_data *data = (geom_data*)dGeomGetData(geom);
+      size_t firstVertex = bake->vertices.size() / 4;
+      dVector3 v[3];
+      int n = dGeomTriMeshGetTriangleCount(geom);
+
+      for(int i=0; i<n; ++i) {
+        // the vertices are returned in world coordinates
+        dGeomTriMeshGetTriangle(geom, i, &v[0], &v[1], &v[2]);
+        for(int j=0; j<3; ++j) {
+          bake->vertices.push_back(v[j][0]);
+          bake->vertices.push_back(v[j][1]);
+          bake->vertices.push_back(v[j][2]);
+          bake->vertices.push_back(0);
+          bake->indices.push_back((dTriIndex)(firstVertex + i*3 + j));
+        }
+      }
+      bake->triangleData.insert(bake->triangleData.end(), n, data);
+      bake->geoms.push_back(geom);
+    }
+
+    static bool sameContactParams(const contact_params &a,
+                                  const contact_params &b) {
+      return (a.max_num_contacts == b.max_num_contacts &&
+              a.erp == b.erp && a.cfm == b.cfm &&
+              a.friction1 == b.friction1 && a.friction2 == b.friction2 &&
+              a.motion1 == b.motion1 && a.motion2 == b.motion2 &&
+              a.fds1 == b.fds1 && a.fds2 == b.fds2 &&
+              a.bounce == b.bounce && a.bounce_vel == b.bounce_vel &&
+              a.approx_pyramid == b.approx_pyramid &&
+              a.coll_bitmask == b.coll_bitmask &&
+              a.depth_correction == b.depth_correction);
+    }
+
+    int WorldPhysics::bakeStaticGeoms(void) {
+      MutexLocker locker(&iMutex);
+      if(!world_init) return 0;
+      return bakeGeoms();
+    }
+
+    /**
+     * \brief Returns \c true for the finite primitives that are moved into
+     *        the static sub-space by bakeGeoms.
+     */
+    static bool isStaticPrimitive(dGeomID geom) {
+      switch(dGeomGetClass(geom)) {
+      case dBoxClass:
+      case dSphereClass:
+      case dCapsuleClass:
+      case dCylinderClass:
+      case dConvexClass:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    /**
+     * \brief Merges the static meshes of each set of contact parameters
+     *        into one trimesh and moves the static primitives into one
+     *        sub-space. Has to be called with locked iMutex.
+     *
+     * The original meshes are disabled, so the broadphase only sees the
+     * merged mesh and ray casts use its tree. They stay in the space to
+     * keep the geom_data of the nodes, which receive the contacts of their
+     * triangles.
+     *
+     * Primitives are not triangulated: a box of triangles is only a shell,
+     * and an object that penetrates it deeper than the contact depth falls
+     * inside. They keep their geoms and colliders instead and are moved
+     * into a quadtree sub-space, which the broadphase of the world sees as
+     * one geom; nearCallback collides it via dSpaceCollide2. Planes and
+     * height maps stay in the world space.
+     */
+    int WorldPhysics::bakeGeoms(void) {
+      std::vector<StaticBake*> groups;
+      std::vector<dGeomID> primitives;
+      StaticBake *bake;
+      geom_data *data;
+      dGeomID geom;
+      int numMerged = 0;
+
+      unbakeStaticGeoms();
+      bakeDirty = false;
+      for(int i=0; i<dSpaceGetNumGeoms(space); ++i) {
+        geom = dSpaceGetGeom(space, i);
+        if(dGeomIsSpace(geom)) continue;
+        if(dGeomGetBody(geom) || !dGeomIsEnabled(geom)) continue;
+        data = (geom_data*)dGeomGetData(geom);
+        if(!data || data->ray_sensor || !data->bake) continue;
+        if(isStaticPrimitive(geom)) {
+          primitives.push_back(geom);
+          continue;
+        }
+        if(dGeomGetClass(geom) != dTriMeshClass) continue;
+        // the friction direction is given in the frame of the node
+        if(data->c_params.friction_direction1) continue;
+        bake = NULL;
+        for(size_t g=0; g<groups.size() && !bake; ++g) {
+          if(sameContactParams(groups[g]->data.c_params, data->c_params)) {
+            bake = groups[g];
+          }
+        }
+        if(!bake) {
+          bake = new StaticBake;
+          bake->data.id = 0;
+          bake->data.sense_contact_force = false;
+          bake->data.c_params = data->c_params;
+          groups.push_back(bake);
+        }
+        appendTriangles(bake, geom);
+      }
+
+      for(size_t g=0; g<groups.size(); ++g) {
+        bake = groups[g];
+        // a single geom is tested faster by its own collider
+        if(bake->geoms.size() < 2 || bake->indices.empty()) {
+          delete bake;
+          continue;
+        }
+        bake->meshData = dGeomTriMeshDataCreate();
+        dGeomTriMeshDataBuildSimple(bake->meshData, &bake->vertices[0],
+                                    bake->vertices.size() / 4,
+                                    &bake->indices[0], bake->indices.size());
+        bake->geom = dCreateTriMesh(space, bake->meshData, 0, 0, 0);
+        dGeomSetData(bake->geom, &bake->data);
+        dGeomSetCategoryBits(bake->geom, bake->data.c_params.coll_bitmask);
+        dGeomSetCollideBits(bake->geom, 0);
+        for(size_t i=0; i<bake->geoms.size(); ++i) {
+          dGeomDisable(bake->geoms[i]);
+          ((geom_data*)dGeomGetData(bake->geoms[i]))->baked = true;
+        }
+        numMerged += (int)bake->geoms.size();
+        staticBakes.push_back(bake);
+      }
+
+      // a single geom is tested faster in the world space
+      if(primitives.size() > 1) {
+        dVector3 center = {0, 0, 0, 0};
+        dVector3 extents = {0, 0, 0, 0};
+        dReal bounds[6], aabb[6];
+        for(size_t i=0; i<primitives.size(); ++i) {
+          dGeomGetAABB(primitives[i], aabb);
+          for(int k=0; k<3; ++k) {
+            if(!i || aabb[k*2] < bounds[k*2]) bounds[k*2] = aabb[k*2];
+            if(!i || aabb[k*2+1] > bounds[k*2+1]) bounds[k*2+1] = aabb[k*2+1];
+          }
+        }
+        for(int k=0; k<3; ++k) {
+          center[k] = 0.5*(bounds[k*2]+bounds[k*2+1]);
+          extents[k] = 0.5*(bounds[k*2+1]-bounds[k*2]) + 0.1;
+        }
+        // about one geom per leaf of the tree
+        int depth = 1;
+        while(depth < 8 && ((size_t)1 << (2*depth)) < primitives.size()) {
+          ++depth;
+        }
+        staticSpace = dQuadTreeSpaceCreate(space, center, extents, depth);
+        // the geoms belong to their nodes
+        dSpaceSetCleanup(staticSpace, 0);
+        for(size_t i=0; i<primitives.size(); ++i) {
+          dSpaceRemove(space, primitives[i]);
+          dSpaceAdd(staticSpace, primitives[i]);
+        }
+        staticGeoms.swap(primitives);
+        numMerged += (int)staticGeoms.size();
+      }
+      clearContactCache();
+      if(!staticBakes.empty() || staticSpace) {
+        LOG_INFO("WorldPhysics: merged %d static geoms into %lu meshes and "
+                 "%lu grouped primitives", numMerged,
+                 (unsigned long)staticBakes.size(),
+                 (unsigned long)staticGeoms.size());
+      }
+      return numMerged;
+    }
+
+    /**
+     * \brief Splits the baked meshes into their original geoms again. Has
+     *        to be called with locked iMutex before a static geom is
+     *        changed or destroyed. The geoms are merged again before the
+     *        next step if bake_static_geoms is set.
+     */
+    void WorldPhysics::unbakeStaticGeoms(void) {
+      bakeDirty = true;
+      if(staticBakes.empty() && !staticSpace) return;
+      releaseBakes();
+      clearContactCache();
+    }
+
+    void WorldPhysics::releaseBakes(void) {
+      for(size_t i=0; i<staticBakes.size(); ++i) {
+        StaticBake *bake = staticBakes[i];
+        for(size_t k=0; k<bake->geoms.size(); ++k) {
+          dGeomEnable(bake->geoms[k]);
+          ((geom_data*)dGeomGetData(bake->geoms[k]))->baked = false;
+        }
+        dGeomDestroy(bake->geom);
+        dGeomTriMeshDataDestroy(bake->meshData);
+        delete bake;
+      }
+      staticBakes.clear();
+      if(staticSpace) {
+        // dSpaceAdd inserts at the front; keep the order of the geoms
+        for(size_t i=staticGeoms.size(); i>0; --i) {
+          dSpaceRemove(staticSpace, staticGeoms[i-1]);
+          dSpaceAdd(space, staticGeoms[i-1]);
+        }
+        dSpaceDestroy(staticSpace);
+        staticSpace = 0;
+        staticGeoms.clear();
+      }
+    }
+
+    StaticBake* WorldPhysics::getBake(dGeomID geom) const {
+      for(size_t i=0; i<staticBakes.size(); ++i) {
+        if(staticBakes[i]->geom == geom) return staticBakes[i];
+      }
+      return NULL;
+    }
+
   } // end of namespace sim
 } // end of namespace mars
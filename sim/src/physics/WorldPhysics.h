@@ -42,7 +42,10 @@
 #include <mars/interfaces/sim/PhysicsInterface.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 
+#include "NarrowPhase.h"
+
 #include <vector>
+#include <map>
 
 #include <ode/ode.h>
 
@@ -50,6 +53,7 @@ namespace mars {
   namespace sim {
 
     class NodePhysics;
+    struct StaticBake;
 
     /**
      * The struct is used to handle some sensors in the physical
@@ -78,6 +82,22 @@ namespace mars {
       std::vector<NodePhysics*> comp_nodes;
     };
 
+    /**
+     * The contacts of a geom pair from the last collision test. The contact
+     * positions and normals are stored in the frame of the first geom,
+     * relPos and relRot give the pose of the second geom in that frame.
+     */
+    struct ContactCacheEntry {
+      ContactCacheEntry() : maxNumContacts(0), lastStep(0) {}
+      dVector3 relPos;
+      dMatrix3 relRot;
+      int maxNumContacts;
+      unsigned long lastStep;
+      std::vector<dContactGeom> contacts;
+    };
+
+    typedef std::map<std::pair<dGeomID, dGeomID>, ContactCacheEntry> ContactCache;
+
     /**
      * Declaration of the physical class, that implements the
      * physics interface.
@@ -94,6 +114,10 @@ namespace mars {
       virtual void update(std::vector<interfaces::draw_item> *drawItems);
       virtual int checkCollisions(void);
       virtual interfaces::sReal getVectorCollision(const utils::Vector &pos, const utils::Vector &ray) const;
+      virtual void saveState(interfaces::StateBuffer *state);
+      virtual bool restoreState(interfaces::StateBuffer *state);
+      virtual interfaces::ContactCacheStats getContactCacheStats(void) const;
+      virtual int bakeStaticGeoms(void);
 
       // this functions are used by the other physical classes
       dWorldID getWorld(void) const;
@@ -105,6 +129,19 @@ namespace mars {
       void moveCompositeMassCenter(dBodyID theBody, dReal x, dReal y, dReal z);
       int handleCollision(dGeomID theGeom);
       interfaces::sReal getCollisionDepth(dGeomID theGeom);
+      void clearContactCache(void);
+      /** \brief drops the cached contacts of \a geom */
+      void clearContactCache(dGeomID geom);
+      void addTerrain(NodePhysics *node);
+      void removeTerrain(NodePhysics *node);
+      /**
+       * \brief locks the height maps of the terrains for reading while
+       *        ODE samples them, so other threads can not deform them
+       */
+      void lockTerrains(void) const;
+      void unlockTerrains(void) const;
+      void unbakeStaticGeoms(void);
+      void updateAutoDisable(dBodyID theBody);
       mutable utils::Mutex iMutex;
 
       static interfaces::PhysicsError error;
@@ -119,16 +156,60 @@ namespace mars {
       interfaces::ControlCenter *control;
       utils::Vector old_gravity;
       interfaces::sReal old_cfm, old_erp;
+      bool old_sleeping;
+      interfaces::Broadphase old_broadphase;
+      int tunedNumGeoms;
+      /** the region of the quadtree: min x, max x, min y, ... */
+      dReal quadTreeBounds[6];
+      int old_island_threads;
+      bool old_fast_step;
+      bool old_bake_static_geoms, bakeDirty;
+#ifdef ODE_THREADING
+      dThreadingImplementationID threading;
+      dThreadingThreadPoolID threadPool;
+#endif
 
       std::vector<body_nbr_tupel> comp_body_list;
       std::vector<interfaces::draw_item> draw_intern;
       std::vector<interfaces::draw_item> draw_extern;
       std::vector<dJointFeedback*> contact_feedback_list;
+      std::vector<NodePhysics*> terrains;
+      std::vector<StaticBake*> staticBakes;
+      /** the static primitives grouped by bakeGeoms, in the world space */
+      dSpaceID staticSpace;
+      std::vector<dGeomID> staticGeoms;
       bool create_contacts, log_contacts;
       int num_contacts;
       int ray_collision;
+      ContactCache contactCache;
+      unsigned long cacheStep;
+      unsigned long broadphasePairs;
+      bool gatherPairs, trimeshThreadSafe;
+      std::vector<CollisionPair> collisionPairs;
+      size_t numCollisionPairs;
+      std::vector<NarrowPhase::Task> tasks;
+      NarrowPhase narrowPhaseThreads;
+      interfaces::ContactCacheStats cacheStats;
+      bool getGeomBounds(dReal bounds[6]) const;
+      dSpaceID createSpace(void);
+      void rebuildSpace(void);
+      void updateBroadphase(void);
+      void tuneHashLevels(void);
+      void updateIslandThreads(void);
+      void freeIslandThreads(void);
+      int bakeGeoms(void);
+      void releaseBakes(void);
+      StaticBake* getBake(dGeomID geom) const;
       // this functions are for the collision implementation
       void nearCallback (dGeomID o1, dGeomID o2);
+      void handlePair(dGeomID o1, dGeomID o2, const CollisionPair *pair);
+      int collide(dGeomID o1, dGeomID o2, int maxNumContacts, dContact *contact,
+                  const CollisionPair *pair);
+      int narrowPhase(dGeomID o1, dGeomID o2, int maxNumContacts,
+                      dContact *contact, const CollisionPair *pair);
+      bool isCached(dGeomID o1, dGeomID o2, int maxNumContacts) const;
+      void addCollisionPair(dGeomID o1, dGeomID o2);
+      void collidePairs(void);
       static void callbackForward(void *data, dGeomID o1, dGeomID o2);
     };
 
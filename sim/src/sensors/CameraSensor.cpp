@@ -104,6 +104,7 @@ namespace mars {
           gc = gw->getCameraInterface();
           control->graphics->addGraphicsUpdateInterface(this);
           gc->setFrustumFromRad(config.opening_width/180.0*M_PI, config.opening_height/180.0*M_PI, 0.5, 100);
+          if(config.lodScale > 0.0) gw->setLODScale(config.lodScale);
         }
       }
 
@@ -351,6 +352,9 @@ namespace mars {
         cfg->enabled = true;
       }
 
+      if((it = config->find("lod_scale")) != config->end())
+        cfg->lodScale = it->second;
+
       if((it = config->find("hud_size")) != config->end()) {
         cfg->hud_width = it->second["x"];
         cfg->hud_height = it->second["y"];
@@ -437,6 +441,10 @@ namespace mars {
       (*tmpCfg)["x"] = config.hud_width;
       (*tmpCfg)["y"] = config.hud_height;
 
+      if(config.lodScale > 0.0) {
+        cfg["lod_scale"] = config.lodScale;
+      }
+
       return cfg;
     }
 
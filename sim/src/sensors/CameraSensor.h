@@ -75,6 +75,7 @@ namespace mars {
         hud_height = -1;
         depthImage = false;
         frameOffset = 1;
+        lodScale = 0.0;
       }
 
       unsigned long attached_node;
@@ -91,6 +92,9 @@ namespace mars {
       int hud_height;
       bool depthImage;
       bool enabled;
+      /** scale of the level of detail distances; 0 keeps the default of
+       *  the graphics */
+      double lodScale;
     };
 
     class CameraSensor : public interfaces::BaseNodeSensor,
@@ -60,6 +60,8 @@ namespace mars {
       static interfaces::BaseConfig* parseConfig(interfaces::ControlCenter *control,
                                                  configmaps::ConfigMap *config);
       virtual configmaps::ConfigMap createConfig() const;
+      virtual void saveState(interfaces::StateBuffer *state) const;
+      virtual bool restoreState(interfaces::StateBuffer *state);
 
     protected:
       std::string typeName;
@@ -134,5 +134,21 @@ namespace mars {
       return i;
     }
 
+    void NodeArraySensor::saveState(StateBuffer *state) const {
+      state->write(doubleArray.size());
+      for(size_t i=0; i<doubleArray.size(); ++i) {
+        state->write(doubleArray[i]);
+      }
+    }
+
+    bool NodeArraySensor::restoreState(StateBuffer *state) {
+      size_t size;
+      if(!state->read(&size) || size != doubleArray.size()) return false;
+      for(size_t i=0; i<size; ++i) {
+        state->read(&doubleArray[i]);
+      }
+      return state->good();
+    }
+
   } // end of namespace sim
 } // end of namespace mars
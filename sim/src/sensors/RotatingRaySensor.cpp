@@ -36,6 +36,7 @@
 #include <mars/cfg_manager/CFGManagerInterface.h>
 #include <mars/utils/MutexLocker.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -168,7 +169,8 @@ namespace mars {
     }
 
     RotatingRaySensor::~RotatingRaySensor(void) {
-      control->graphics->removeDrawItems((DrawInterface*)this);
+      if(control->graphics)
+        control->graphics->removeDrawItems((DrawInterface*)this);
       control->dataBroker->unregisterTimedReceiver(this, "*", "*", "mars_sim/simTimer");
       closeThread = true;
       this->wait();
@@ -237,6 +239,13 @@ namespace mars {
       // data[] contains all the measured distances according to the define directions.
       assert((int)data.size() == config.bands * config.lasers);
 
+      receiverMutex.lock();
+      bool publish = !receivers.empty();
+      if(publish) {
+        slicePoints.clear();
+        sliceDistances.clear();
+      }
+
       int i = 0; // data_counter
       utils::Vector local_ray, tmpvec;
       for(int b=0; b<config.bands; ++b) {
@@ -255,11 +264,27 @@ namespace mars {
             // This necessitates a back-transformation (world2node) in getPointcloud().
             tmpvec = current_pose * local_ray;
             toCloud->push_back(tmpvec); // Scale normalized vector.
+            if(publish) {
+              slicePoints.push_back(tmpvec.x());
+              slicePoints.push_back(tmpvec.y());
+              slicePoints.push_back(tmpvec.z());
+              sliceDistances.push_back(data[i]);
+            }
           }
         }
       }
       num_points += data.size();
 
+      if(publish && !sliceDistances.empty()) {
+        double time = control->sim->getTime();
+        std::vector<PointCloudReceiver*>::iterator it;
+        for(it=receivers.begin(); it!=receivers.end(); ++it) {
+          (*it)->receivePoints(config.id, &slicePoints[0], &sliceDistances[0],
+                               sliceDistances.size(), time);
+        }
+      }
+      receiverMutex.unlock();
+
       update_available = true;
     }
 
@@ -285,6 +310,22 @@ namespace mars {
       }
     }
 
+    void RotatingRaySensor::addPointCloudReceiver(PointCloudReceiver *receiver) {
+      MutexLocker locker(&receiverMutex);
+      if(std::find(receivers.begin(), receivers.end(), receiver) == receivers.end()) {
+        receivers.push_back(receiver);
+        slicePoints.reserve(data.size()*3);
+        sliceDistances.reserve(data.size());
+      }
+    }
+
+    void RotatingRaySensor::removePointCloudReceiver(PointCloudReceiver *receiver) {
+      MutexLocker locker(&receiverMutex);
+      std::vector<PointCloudReceiver*>::iterator it;
+      it = std::find(receivers.begin(), receivers.end(), receiver);
+      if(it != receivers.end()) receivers.erase(it);
+    }
+
     utils::Quaternion RotatingRaySensor::turn() {  
       
       // If the scan is full the pointcloud will be copied.
@@ -436,5 +477,39 @@ namespace mars {
       return config;
     }
 
+    void RotatingRaySensor::saveState(StateBuffer *state) const {
+      MutexLocker locker(&mutex_pointcloud);
+      std::list<utils::Vector>::const_iterator it;
+      state->write(turning_offset);
+      state->write(orientation_offset);
+      state->write(nsamples);
+      poseMutex.lock();
+      state->write(current_pose);
+      poseMutex.unlock();
+      state->write(toCloud->size());
+      for(it=toCloud->begin(); it!=toCloud->end(); ++it) {
+        state->write(*it);
+      }
+    }
+
+    bool RotatingRaySensor::restoreState(StateBuffer *state) {
+      MutexLocker locker(&mutex_pointcloud);
+      size_t numPoints;
+      state->read(&turning_offset);
+      state->read(&orientation_offset);
+      state->read(&nsamples);
+      poseMutex.lock();
+      state->read(&current_pose);
+      poseMutex.unlock();
+      if(!state->read(&numPoints)) return false;
+      toCloud->clear();
+      for(size_t i=0; i<numPoints; ++i) {
+        utils::Vector p;
+        if(!state->read(&p)) return false;
+        toCloud->push_back(p);
+      }
+      return true;
+    }
+
   } // end of namespace sim
 } // end of namespace mars
@@ -91,6 +91,7 @@ namespace mars {
       public interfaces::SensorInterface, // Stores the ControlCenter* control pointer.
       public data_broker::ReceiverInterface,
       public interfaces::DrawInterface,
+      public interfaces::PointCloudSource,
       utils::Thread {
 
     public:
@@ -134,6 +135,14 @@ namespace mars {
        * Inherited from DrawInterface.
        */
       virtual void update(std::vector<interfaces::draw_item>* drawItems);
+
+      /**
+       * The receivers get the points of every measurement (one slice of
+       * the scan) in the world frame directly from receiveData().
+       * Inherited from PointCloudSource.
+       */
+      virtual void addPointCloudReceiver(interfaces::PointCloudReceiver *receiver);
+      virtual void removePointCloudReceiver(interfaces::PointCloudReceiver *receiver);
       
       /**
        * Config methods all part of BaseSensor.
@@ -145,6 +154,12 @@ namespace mars {
 
       const RotatingRayConfig& getConfig() const;
 
+      /**
+       * Stores the turning state and the points of the running scan.
+       */
+      virtual void saveState(interfaces::StateBuffer *state) const;
+      virtual bool restoreState(interfaces::StateBuffer *state);
+
       /**
        * Turns the sensor during each simulation step.
        * As soon as a full scan has been done (depends on the number of bands)
@@ -192,7 +207,10 @@ namespace mars {
       long rotationIndices[4];
       double turning_step;
       int nsamples;
-      mutable mars::utils::Mutex mutex_pointcloud, poseMutex;
+      mutable mars::utils::Mutex mutex_pointcloud, poseMutex, receiverMutex;
+      std::vector<interfaces::PointCloudReceiver*> receivers;
+      // points and distances of the last slice for the receivers
+      std::vector<float> slicePoints, sliceDistances;
       Eigen::Affine3d current_pose;
       bool closeThread;
       unsigned int num_points;
@@ -25,6 +25,8 @@
 #include <QTimer>
 
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
 
 namespace mars {
   namespace viz {
@@ -53,6 +55,8 @@ namespace mars {
       QTimer *graphicsTimer;
       mars::interfaces::GraphicsManagerInterface *graphics;
       bool runFinished;
+      mars::utils::Mutex runMutex;
+      mars::utils::WaitCondition runCondition;
 
     }; // end of class GraphicsTimer
 